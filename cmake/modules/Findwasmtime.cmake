@@ -0,0 +1,17 @@
+# Try to find the wasmtime C API
+#
+# Once done, this will define
+#
+# WASMTIME_FOUND
+# WASMTIME_INCLUDE_DIR
+# WASMTIME_LIBRARY
+
+find_path(WASMTIME_INCLUDE_DIR NAMES wasmtime.h)
+
+find_library(WASMTIME_LIBRARY NAMES wasmtime)
+
+include(FindPackageHandleStandardArgs)
+find_package_handle_standard_args(wasmtime
+  REQUIRED_VARS WASMTIME_LIBRARY WASMTIME_INCLUDE_DIR)
+
+mark_as_advanced(WASMTIME_INCLUDE_DIR WASMTIME_LIBRARY)
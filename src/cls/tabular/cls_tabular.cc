@@ -11,14 +11,21 @@
 #include "cls_tabular.h"
 #include "cls_tabular_utils.h"
 #include "cls_tabular_processing.h"
+#include "cls_tabular_wasm.h"
 
 #include <errno.h>
 #include <string>
 #include <sstream>
 #include <boost/lexical_cast.hpp>
 #include <time.h>
+#include <atomic>
+#include <cmath>
+#include <list>
+#include <mutex>
+#include <unordered_map>
 #include "re2/re2.h"
 #include "include/types.h"
+#include "include/rados.h"
 #include "objclass/objclass.h"
 
 
@@ -35,6 +42,8 @@ cls_method_handle_t h_exec_runstats_op;
 cls_method_handle_t h_build_index;
 cls_method_handle_t h_exec_build_sky_index_op;
 cls_method_handle_t h_transform_db_op;
+cls_method_handle_t h_build_rollup_op;
+cls_method_handle_t h_append_fb_op;
 cls_method_handle_t h_freelockobj_query_op;
 cls_method_handle_t h_inittable_group_obj_query_op;
 cls_method_handle_t h_getlockobj_query_op;
@@ -106,6 +115,125 @@ int set_fb_seq_num(cls_method_context_t hctx, unsigned int fb_seq_num) {
     return 0;
 }
 
+/*
+ * Read hints. Each read of table data is classified so the object store can
+ * keep analytic scans from flushing its cache (with bluestore, see
+ * bluestore_cache_scan_resistant):
+ *   scan of the object or of all its fbs   : FADVISE_SEQUENTIAL
+ *   index driven read of an fb             : FADVISE_RANDOM
+ *   index driven read of a hot fb          : FADVISE_WILLNEED
+ *   one time full reads (index build etc.) : FADVISE_SEQUENTIAL|DONTNEED
+ * An fb is hot once read HOT_FB_READS times by index lookups on this osd.
+ * fbs are told apart by the oid, size and mtime of their object along with
+ * their off/len, so a rewritten object starts cold again.
+ */
+static const int SCAN_READ_FLAGS = CEPH_OSD_OP_FLAG_FADVISE_SEQUENTIAL;
+static const int ONCE_READ_FLAGS = CEPH_OSD_OP_FLAG_FADVISE_SEQUENTIAL |
+                                   CEPH_OSD_OP_FLAG_FADVISE_DONTNEED;
+static std::mutex hot_fb_lock;
+static std::unordered_map<std::string, int> hot_fb_reads;
+
+static std::string hot_fb_obj_id(cls_method_context_t hctx)
+{
+    std::string oid;
+    uint64_t size = 0;
+    time_t mtime = 0;
+    if (cls_get_oid(hctx, &oid) < 0 or
+        cls_cxx_stat(hctx, &size, &mtime) < 0)
+        return "";
+    return oid + "." + std::to_string(size) + "." + std::to_string(mtime);
+}
+
+static int index_read_flags(const std::string& obj_id, int off, int len)
+{
+    if (obj_id.empty())
+        return CEPH_OSD_OP_FLAG_FADVISE_RANDOM;
+
+    std::string key = obj_id + ":" + std::to_string(off) + ":" +
+                      std::to_string(len);
+    std::lock_guard<std::mutex> l(hot_fb_lock);
+
+    // coarse bound on the tracked fbs, start over when full.
+    if (hot_fb_reads.size() >= Tables::HOT_FB_TRACK_MAX and
+        hot_fb_reads.find(key) == hot_fb_reads.end())
+        hot_fb_reads.clear();
+
+    if (++hot_fb_reads[key] >= Tables::HOT_FB_READS)
+        return CEPH_OSD_OP_FLAG_FADVISE_WILLNEED;
+    return CEPH_OSD_OP_FLAG_FADVISE_RANDOM;
+}
+
+/*
+ * Reads the seq of encoded bls of an object one at a time, holding at most
+ * about INDEX_BUILD_READ_SIZE bytes of the object (or one bl, if larger) in
+ * memory rather than reading the whole object at once.
+ */
+class obj_bl_reader {
+    cls_method_context_t hctx;
+    uint64_t obj_size = 0;
+    uint64_t read_off = 0;     // next obj off to read
+    uint64_t pending_off = 0;  // obj off of the pending bytes
+    bufferlist pending;        // read but not yet consumed
+
+    // read until at least need bytes are pending, or the end of the obj
+    int fill(uint64_t need) {
+        while (pending.length() < need and read_off < obj_size) {
+            bufferlist b;
+            uint64_t len = std::max<uint64_t>(Tables::INDEX_BUILD_READ_SIZE,
+                                              need - pending.length());
+            int ret = cls_cxx_read2(hctx, read_off, len, &b, ONCE_READ_FLAGS);
+            if (ret < 0)
+                return ret;
+            if (b.length() == 0)
+                break;
+            read_off += b.length();
+            pending.claim_append(b);
+        }
+        return 0;
+    }
+
+public:
+    explicit obj_bl_reader(cls_method_context_t ctx) : hctx(ctx) {}
+
+    int init() {
+        return cls_cxx_stat(hctx, &obj_size, NULL);
+    }
+
+    // get the next bl and its obj off, returns 0 at the end of the obj.
+    int next(uint64_t* off, bufferlist* bl) {
+        const uint32_t len_size = sizeof(uint32_t);  // encoded bl len
+        int ret = fill(len_size);
+        if (ret < 0)
+            return ret;
+        if (pending.length() == 0)
+            return 0;
+
+        uint32_t len = 0;
+        try {
+            bufferlist::iterator it = pending.begin();
+            ::decode(len, it);
+            ret = fill(len_size + len);
+            if (ret < 0)
+                return ret;
+            it = pending.begin();
+            bl->clear();
+            ::decode(*bl, it);
+        } catch (const buffer::error &err) {
+            CLS_ERR("ERROR: obj_bl_reader: decoding bl at off=%lu",
+                    pending_off);
+            return -EINVAL;
+        }
+
+        *off = pending_off;
+        bufferlist rest;
+        rest.substr_of(pending, len_size + len,
+                       pending.length() - len_size - len);
+        pending.swap(rest);
+        pending_off += len_size + len;
+        return 1;
+    }
+};
+
 /*
  * Build a skyhook index, insert to omap.
  * Index types are
@@ -144,9 +272,12 @@ int exec_build_sky_index_op(cls_method_context_t hctx, bufferlist *in, bufferlis
     std::string key;
     std::map<std::string, bufferlist> fbs_index;
     std::map<std::string, bufferlist> recs_index;
-    std::map<std::string, bufferlist> rids_index;
     std::map<std::string, bufferlist> txt_index;
 
+    // text index tokenizer state, reused for all rows
+    std::vector<Tables::text_token> txt_tokens;
+    std::string txt_word;
+
     // extract the index op instructions from the input bl
     idx_op op;
     try {
@@ -157,10 +288,33 @@ int exec_build_sky_index_op(cls_method_context_t hctx, bufferlist *in, bufferlis
         return -EINVAL;
     }
     Tables::schema_vec idx_schema = Tables::schemaFromString(op.idx_schema_str);
+    std::string text_delims = op.idx_text_delims;
+    if (text_delims.empty())
+        text_delims = " \t\r\f\v\n"; // whitespace chars
+
+    // covering index, the index and include col vals of each row are
+    // stored in its entry so that queries over them need not read the data.
+    Tables::schema_vec include_schema = \
+        Tables::schemaFromString(op.idx_include_str);
+    if (!include_schema.empty() and op.idx_type != Tables::SIT_IDX_REC) {
+        CLS_ERR("ERROR: exec_build_sky_index_op: include cols are only "
+                "supported for IDX_REC indexes");
+        return -EINVAL;
+    }
+    std::set<int> covered_cols;
+    if (!include_schema.empty()) {
+        for (auto it = idx_schema.begin(); it != idx_schema.end(); ++it)
+            covered_cols.insert(it->idx);
+        for (auto it = include_schema.begin(); it != include_schema.end(); ++it)
+            covered_cols.insert(it->idx);
+    }
+    std::string covered_schema_str;
+    bool has_dead_rows = false;  // the covering entries do not record them
 
-    // obj contains one bl that itself wraps a seq of encoded bls of skyhook fb
-    bufferlist wrapped_bls;
-    ret = cls_cxx_read(hctx, 0, 0, &wrapped_bls);
+    // obj contains a seq of encoded bls of skyhook fb, streamed so that the
+    // whole obj is not held in memory along with the index entries.
+    obj_bl_reader reader(hctx);
+    ret = reader.init();
     if (ret < 0) {
         CLS_ERR("ERROR: exec_build_sky_index_op: reading obj. %d", ret);
         return ret;
@@ -168,20 +322,32 @@ int exec_build_sky_index_op(cls_method_context_t hctx, bufferlist *in, bufferlis
 
     // decode and process each wrapped bl (each bl contains 1 flatbuf)
     uint64_t off = 0;
-    ceph::bufferlist::iterator it = wrapped_bls.begin();
-    uint64_t obj_len = it.get_remaining();
-    while (it.get_remaining() > 0) {
-        off = obj_len - it.get_remaining();
-        ceph::bufferlist bl;
-        try {
-            ::decode(bl, it);  // unpack the next bl
-        } catch (ceph::buffer::error&) {
-            assert(Tables::BuildSkyIndexDecodeBlsErr==0);
-        }
+    ceph::bufferlist bl;
+    while ((ret = reader.next(&off, &bl)) > 0) {
 
         const char* fb = bl.c_str();   // get fb as contiguous bytes
         int fb_len = bl.length();
+
+        // index keys are built from the col vals, so dictionary encoded
+        // cols are decoded first, fb_len remains the size of the stored fb.
+        flatbuffers::FlatBufferBuilder decoded;
+        if (Tables::hasSkyDicts(fb)) {
+            std::string errmsg;
+            ret = Tables::decodeSkyDicts(fb, fb_len, decoded, errmsg);
+            if (ret != 0) {
+                CLS_ERR("ERROR: exec_build_sky_index_op: %s", errmsg.c_str());
+                return -EINVAL;
+            }
+            fb = reinterpret_cast<const char*>(decoded.GetBufferPointer());
+        }
         Tables::sky_root root = Tables::getSkyRoot(fb, fb_len);
+        for (auto it = root.delete_vec.begin(); it != root.delete_vec.end();
+             ++it) {
+            if (*it) {
+                has_dead_rows = true;
+                break;
+            }
+        }
 
         // DATA LOCATION INDEX (PHYSICAL data reference):
 
@@ -213,6 +379,17 @@ int exec_build_sky_index_op(cls_method_context_t hctx, bufferlist *in, bufferlis
                                              root.table_name,
                                              index_cols);
         }
+        Tables::schema_vec data_schema;
+        if (!covered_cols.empty()) {
+            data_schema = Tables::schemaFromString(root.data_schema);
+            Tables::schema_vec covered_schema;
+            for (auto it = data_schema.begin(); it != data_schema.end(); ++it) {
+                if (covered_cols.count(it->idx))
+                    covered_schema.push_back(*it);
+            }
+            covered_schema_str = Tables::schemaToString(covered_schema);
+        }
+
         if (op.idx_type == Tables::SIT_IDX_REC or
             op.idx_type == Tables::SIT_IDX_TXT) {
 
@@ -235,8 +412,11 @@ int exec_build_sky_index_op(cls_method_context_t hctx, bufferlist *in, bufferlis
 
                 case Tables::SIT_IDX_RID: {
 
-                    // key_data is just the RID val
-                    key_data = Tables::u64tostr(rec.RID);
+                    // key_data is just the RID val, encoded as for IDX_REC
+                    // keys so that the same index lookups apply.
+                    key_data.clear();
+                    Tables::appendIndexKeyData(key_data, Tables::SDT_UINT64,
+                                               static_cast<uint64_t>(rec.RID));
 
                     // create the entry, encode into bufferlist, update map
                     bufferlist rec_bl;
@@ -254,9 +434,9 @@ int exec_build_sky_index_op(cls_method_context_t hctx, bufferlist *in, bufferlis
                     auto row = rec.data.AsVector();
                     for (unsigned i = 0; i < idx_schema.size(); i++) {
                         if (i > 0) key_data += Tables::IDX_KEY_DELIM_INNER;
-                        key_data += Tables::buildKeyData(
-                                            idx_schema[i].type,
-                                            row[idx_schema[i].idx].AsUInt64());
+                        Tables::appendIndexKeyData(key_data,
+                                                   idx_schema[i].type,
+                                                   row[idx_schema[i].idx]);
                     }
 
                     // to enforce uniqueness, append RID to key data
@@ -270,6 +450,24 @@ int exec_build_sky_index_op(cls_method_context_t hctx, bufferlist *in, bufferlis
                     // create the entry, encode into bufferlist, update map
                     bufferlist rec_bl;
                     struct idx_rec_entry rec_ent(fb_seq_num, i, rec.RID);
+                    if (!covered_cols.empty()) {
+                        flexbuffers::Builder flexbldr;
+                        flexbldr.Vector([&]() {
+                            for (auto it = data_schema.begin();
+                                      it != data_schema.end(); ++it) {
+                                if (covered_cols.count(it->idx))
+                                    Tables::flexAddColVal(flexbldr,
+                                                          row[it->idx],
+                                                          it->type);
+                                else
+                                    flexbldr.Null();
+                            }
+                        });
+                        flexbldr.Finish();
+                        const std::vector<uint8_t>& buf = flexbldr.GetBuffer();
+                        rec_ent.cols_data.assign(buf.begin(), buf.end());
+                        rec_ent.nullbits = rec.nullbits;
+                    }
                     ::encode(rec_ent, rec_bl);
                     key = key_data_prefix + key_data;
                     recs_index[key] = rec_bl;
@@ -277,69 +475,50 @@ int exec_build_sky_index_op(cls_method_context_t hctx, bufferlist *in, bufferlis
                 }
                 case Tables::SIT_IDX_TXT: {
 
-                    // add each word in the row to a words vector, store as
-                    // lower case and and preserve word sequence order.
-                    std::vector<std::pair<std::string, int>> words;
-                    std::string text_delims;
-                    if (!op.idx_text_delims.empty())
-                        text_delims = op.idx_text_delims;
-                    else
-                        text_delims = " \t\r\f\v\n"; // whitespace chars
+                    // tokenize the words of each text col in the row, the
+                    // tokens point into the fb so no words are copied, and
+                    // the token and key buffers are reused for all rows.
                     auto row = rec.data.AsVector();
-                    for (unsigned i = 0; i < idx_schema.size(); i++) {
-                        if (i > 0) key_data += Tables::IDX_KEY_DELIM_INNER;
-                        std::string line = \
-                            row[idx_schema[i].idx].AsString().str();
-                        boost::trim(line);
-                        if (line.empty())
-                            continue;
-                        vector<std::string> elems;
-                        boost::split(elems, line, boost::is_any_of(text_delims),
-                                            boost::token_compress_on);
-                        for (uint32_t i = 0; i < elems.size(); i++) {
-                            std::string word = \
-                                    boost::algorithm::to_lower_copy(elems[i]);
-                            boost::trim(word);
+                    for (unsigned j = 0; j < idx_schema.size(); j++) {
+                        auto text = row[idx_schema[j].idx].AsString();
+                        txt_tokens.clear();
+                        Tables::tokenizeText(text.c_str(), text.length(),
+                                             text_delims, txt_tokens);
+
+                        // now create a key and val (an entry struct) for
+                        // each word extracted from the text
+                        for (auto it = txt_tokens.begin();
+                                  it != txt_tokens.end(); ++it) {
 
                             // skip stopwords?
-                            if (op.idx_ignore_stopwords and
-                                Tables::IDX_STOPWORDS.count(word) > 0) {
+                            if (op.idx_ignore_stopwords) {
+                                txt_word.assign(it->data, it->len);
+                                boost::algorithm::to_lower(txt_word);
+                                boost::trim(txt_word);
+                                if (Tables::IDX_STOPWORDS.count(txt_word) > 0)
                                     continue;
-
                             }
-                            words.push_back(std::make_pair(elems[i], i));
-                        }
-                    }
-                    // now create a key and val (an entry struct) for each
-                    // word extracted from line
-                    for (auto it = words.begin(); it != words.end(); ++it) {
-
-                        key_data.clear();
-                        std::string word = it->first;
-                        key_data += word;
-
-                        // add the RID for uniqueness,
-                        // in case of repeated words within all rows
-                        key_data += (Tables::IDX_KEY_DELIM_OUTER +
-                                     Tables::IDX_KEY_DELIM_UNIQUE +
-                                     Tables::IDX_KEY_DELIM_INNER +
-                                     std::to_string(rec.RID));
 
-                        // add the word pos for uniqueness,
-                        // in case of repeated words within same row
-                        int word_pos = it->second;
-                        key_data += (Tables::IDX_KEY_DELIM_INNER +
-                                     std::to_string(word_pos));
-
-                        // create the entry, encode into bufferlist, update map
-                        bufferlist txt_bl;
-                        struct idx_txt_entry txt_ent(fb_seq_num, i,
-                                                     rec.RID, word_pos);
-                        ::encode(txt_ent, txt_bl);
-                        key = key_data_prefix + key_data;
-                        txt_index[key] = txt_bl;
-                        /*CLS_LOG(20,"kv=%s",
-                                 (key+";"+txt_ent.toString()).c_str());*/
+                            // add the RID for uniqueness, in case of
+                            // repeated words within all rows, and the word
+                            // pos in case of repeated words within same row
+                            key.assign(key_data_prefix);
+                            key.append(it->data, it->len);
+                            key += (Tables::IDX_KEY_DELIM_OUTER +
+                                    Tables::IDX_KEY_DELIM_UNIQUE +
+                                    Tables::IDX_KEY_DELIM_INNER +
+                                    std::to_string(rec.RID) +
+                                    Tables::IDX_KEY_DELIM_INNER +
+                                    std::to_string(it->pos));
+
+                            // create the entry, encode into bufferlist,
+                            // update map
+                            bufferlist txt_bl;
+                            struct idx_txt_entry txt_ent(fb_seq_num, i,
+                                                         rec.RID, it->pos);
+                            ::encode(txt_ent, txt_bl);
+                            txt_index[key] = txt_bl;
+                        }
                     }
                     break;
                 }
@@ -351,7 +530,7 @@ int exec_build_sky_index_op(cls_method_context_t hctx, bufferlist *in, bufferlis
             }
 
             // IDX_REC/IDX_RID batch insert to omap (minimize IOs)
-            if (recs_index.size() > op.idx_batch_size) {
+            if (recs_index.size() >= op.idx_batch_size) {
                 ret = cls_cxx_map_set_vals(hctx, &recs_index);
                 if (ret < 0) {
                     CLS_ERR("exec_build_sky_index_op: error setting recs index entries %d", ret);
@@ -361,7 +540,7 @@ int exec_build_sky_index_op(cls_method_context_t hctx, bufferlist *in, bufferlis
             }
 
             // IDX_TXT batch insert to omap (minimize IOs)
-            if (txt_index.size() > op.idx_batch_size) {
+            if (txt_index.size() >= op.idx_batch_size) {
                 ret = cls_cxx_map_set_vals(hctx, &txt_index);
                 if (ret < 0) {
                     CLS_ERR("exec_build_sky_index_op: error setting recs index entries %d", ret);
@@ -372,7 +551,7 @@ int exec_build_sky_index_op(cls_method_context_t hctx, bufferlist *in, bufferlis
         }  // end foreach row
 
         // IDX_FB batch insert to omap (minimize IOs)
-        if (fbs_index.size() > op.idx_batch_size) {
+        if (fbs_index.size() >= op.idx_batch_size) {
             ret = cls_cxx_map_set_vals(hctx, &fbs_index);
             if (ret < 0) {
                 CLS_ERR("exec_build_sky_index_op: error setting fbs index entries %d", ret);
@@ -381,6 +560,10 @@ int exec_build_sky_index_op(cls_method_context_t hctx, bufferlist *in, bufferlis
             fbs_index.clear();
         }
     }  // end while decode wrapped_bls
+    if (ret < 0) {
+        CLS_ERR("ERROR: exec_build_sky_index_op: reading obj. %d", ret);
+        return ret;
+    }
 
 
     // IDX_TXT insert remaining entries to omap
@@ -419,8 +602,19 @@ int exec_build_sky_index_op(cls_method_context_t hctx, bufferlist *in, bufferlis
     // LASTLY insert a marker key to indicate this index exists,
     // here we are using the key prefix with no data vals
     // TODO: make this a valid entry (not empty_bl), but with empty vals.
+    // for covering indexes the marker holds the schema of the covered cols,
+    // unless the obj has dead rows, since index only plans do not read the
+    // fbs' delete vectors, see build_index_only_fb.
+    if (has_dead_rows and !covered_schema_str.empty()) {
+        CLS_LOG(20, "exec_build_sky_index_op: obj has dead rows, "
+                "index only plans disabled");
+        covered_schema_str.clear();
+    }
     bufferlist empty_bl;
-    empty_bl.append("");
+    if (covered_schema_str.empty())
+        empty_bl.append("");
+    else
+        ::encode(covered_schema_str, empty_bl);
     std::map<std::string, bufferlist> index_exists_marker;
     index_exists_marker[key_data_prefix] = empty_bl;
     ret = cls_cxx_map_set_vals(hctx, &index_exists_marker);
@@ -656,6 +850,293 @@ read_fbs_index(
 }
 
 
+/*
+ * Lookup the col chunk entries of one col of an object in the col chunk
+ * layout (see transform_db_op). Set the reads info with the off/len of the
+ * col's chunk in each row group, keyed by row group seq num.
+ */
+static
+int
+read_col_chunks_index(
+    cls_method_context_t hctx,
+    std::string key_col_prefix,
+    std::map<int, struct Tables::read_info>& reads)
+{
+    const int max_to_get = 1024;
+
+    // the prefix alone is the layout marker key, start after it.
+    std::string start_after = key_col_prefix;
+    bool more = true;
+    while (more) {
+        std::map<std::string, bufferlist> key_val_map;
+        int ret = cls_cxx_map_get_vals(hctx, start_after, key_col_prefix,
+                                       max_to_get, &key_val_map, &more);
+        if (ret < 0 && ret != -ENOENT) {
+            CLS_ERR("Cannot read col chunk entries for key=%s",
+                    key_col_prefix.c_str());
+            return ret;
+        }
+        if (ret == -ENOENT || key_val_map.empty())
+            break;
+
+        for (auto it = key_val_map.begin(); it != key_val_map.end(); ++it) {
+            struct idx_fb_entry fb_ent;
+            try {
+                bufferlist::iterator bit = it->second.begin();
+                ::decode(fb_ent, bit);
+            } catch (const buffer::error &err) {
+                CLS_ERR("ERROR: decoding idx_fb_ent for key=%s",
+                        it->first.c_str());
+                return -EINVAL;
+            }
+            int seq = std::stoi(it->first.substr(key_col_prefix.length()));
+            reads[seq] = Tables::read_info(seq, fb_ent.off, fb_ent.len, {});
+        }
+        start_after = key_val_map.rbegin()->first;
+    }
+    return 0;
+}
+
+/*
+ * Read the rollups of a table from the omap of the object (see rollup_info),
+ * keyed by their omap key.
+ */
+static
+int
+read_rollups(
+    cls_method_context_t hctx,
+    std::string key_rollup_prefix,
+    std::map<std::string, rollup_info>& rollups)
+{
+    const int max_to_get = 64;
+
+    std::string start_after = "";
+    bool more = true;
+    while (more) {
+        std::map<std::string, bufferlist> key_val_map;
+        int ret = cls_cxx_map_get_vals(hctx, start_after, key_rollup_prefix,
+                                       max_to_get, &key_val_map, &more);
+        if (ret < 0 && ret != -ENOENT) {
+            CLS_ERR("Cannot read rollup entries for key=%s",
+                    key_rollup_prefix.c_str());
+            return ret;
+        }
+        if (ret == -ENOENT || key_val_map.empty())
+            break;
+
+        for (auto it = key_val_map.begin(); it != key_val_map.end(); ++it) {
+            rollup_info rollup;
+            try {
+                bufferlist::iterator bit = it->second.begin();
+                ::decode(rollup, bit);
+            } catch (const buffer::error &err) {
+                CLS_ERR("ERROR: decoding rollup_info for key=%s",
+                        it->first.c_str());
+                return -EINVAL;
+            }
+            rollups[it->first] = rollup;
+        }
+        start_after = key_val_map.rbegin()->first;
+    }
+    return 0;
+}
+
+/*
+ * Remove the omap entries of the object whose keys start with key_prefix,
+ * e.g., all of the entries of the indexes of a type on a table.
+ */
+static
+int
+remove_omap_prefix(
+    cls_method_context_t hctx,
+    std::string key_prefix)
+{
+    const int max_to_get = 1024;
+
+    std::string start_after = "";
+    bool more = true;
+    while (more) {
+        std::map<std::string, bufferlist> key_val_map;
+        int ret = cls_cxx_map_get_vals(hctx, start_after, key_prefix,
+                                       max_to_get, &key_val_map, &more);
+        if (ret < 0 && ret != -ENOENT) {
+            CLS_ERR("Cannot read entries for key=%s", key_prefix.c_str());
+            return ret;
+        }
+        if (ret == -ENOENT || key_val_map.empty())
+            break;
+
+        for (auto it = key_val_map.begin(); it != key_val_map.end(); ++it) {
+            ret = cls_cxx_map_remove_key(hctx, it->first);
+            if (ret < 0 && ret != -ENOENT) {
+                CLS_ERR("Cannot remove entry for key=%s", it->first.c_str());
+                return ret;
+            }
+        }
+        start_after = key_val_map.rbegin()->first;
+    }
+    return 0;
+}
+
+/*
+ * Add the rows of an fb (an encoded fbmeta bl) to the rollup.
+ */
+static
+int
+rollup_add_fb(
+    bufferlist& bl,
+    Tables::schema_vec& data_schema,
+    Tables::schema_vec& group_schema,
+    rollup_info& rollup)
+{
+    using namespace Tables;
+
+    sky_meta fbmeta = getSkyMeta(&bl);
+    if (fbmeta.blob_format != SFT_FLATBUF_FLEX_ROW) {
+        CLS_ERR("ERROR: rollup_add_fb: format %d not supported",
+                fbmeta.blob_format);
+        return -EOPNOTSUPP;
+    }
+
+    std::string errmsg;
+    int ret = rollupAddRows(data_schema,
+                            group_schema,
+                            rollup.agg_preds,
+                            fbmeta.blob_data,
+                            fbmeta.blob_size,
+                            rollup.groups,
+                            errmsg);
+    if (ret != 0) {
+        CLS_ERR("ERROR: rollupAddRows %s", errmsg.c_str());
+        CLS_ERR("ERROR: TablesErrCodes::%d", ret);
+        return -EINVAL;
+    }
+    rollup.fb_seq++;
+    return 0;
+}
+
+/*
+ * Answer a global agg query from a rollup of the table that matches it (see
+ * rollupMatchesQuery) and covers the whole object. Returns 1 with the
+ * partial agg row of the object in result_bl if answered, 0 if not.
+ */
+static
+int
+query_rollup(
+    cls_method_context_t hctx,
+    query_op& op,
+    Tables::schema_vec& data_schema,
+    Tables::schema_vec& query_schema,
+    Tables::predicate_vec& query_preds,
+    bufferlist& result_bl)
+{
+    using namespace Tables;
+
+    std::map<std::string, rollup_info> rollups;
+    int ret = read_rollups(hctx,
+                           buildRollupKeyPrefix(op.db_schema_name,
+                                                op.table_name),
+                           rollups);
+    if (ret < 0)
+        return ret;
+    if (rollups.empty())
+        return 0;
+
+    uint64_t obj_size = 0;
+    ret = cls_cxx_stat(hctx, &obj_size, NULL);
+    if (ret < 0)
+        return ret;
+
+    std::string data_schema_str = schemaToString(data_schema);
+    for (auto it = rollups.begin(); it != rollups.end(); ++it) {
+        rollup_info& rollup = it->second;
+
+        // stale, or over another schema of the table
+        if (rollupIsStale(rollup, obj_size) or
+            rollup.data_schema != data_schema_str)
+            continue;
+
+        schema_vec group_schema = schemaFromColNames(data_schema,
+                                                     rollup.group_cols);
+        predicate_vec rollup_aggs = predsFromString(data_schema,
+                                                    rollup.agg_preds);
+        std::vector<int> agg_map;
+        bool match = rollupMatchesQuery(query_preds, rollup_aggs,
+                                        group_schema, agg_map);
+        for (auto p : rollup_aggs)
+            delete p;
+        if (!match)
+            continue;
+
+        std::string errmsg;
+        ret = rollupMergeGroups(query_preds, agg_map, rollup.groups, errmsg);
+        if (ret != 0) {
+            CLS_ERR("ERROR: rollupMergeGroups %s", errmsg.c_str());
+            CLS_ERR("ERROR: TablesErrCodes::%d", ret);
+            return -EINVAL;
+        }
+
+        predicate_vec agg_preds;
+        for (auto p : query_preds) {
+            if (p->isGlobalAgg())
+                agg_preds.push_back(p);
+        }
+        flatbuffers::FlatBufferBuilder result_builder(1024);
+        buildAggResultFb(result_builder, agg_preds, query_schema,
+                         op.db_schema_name, op.table_name);
+        flatbuffers::FlatBufferBuilder fbmeta_builder;
+        createFbMeta(&fbmeta_builder,
+                     SFT_FLATBUF_FLEX_ROW,
+                     reinterpret_cast<unsigned char*>(
+                        result_builder.GetBufferPointer()),
+                     result_builder.GetSize());
+        result_bl.append(reinterpret_cast<const char*>(
+                         fbmeta_builder.GetBufferPointer()),
+                         fbmeta_builder.GetSize());
+
+        CLS_LOG(20, "query_rollup: answered from %s over %u fbs, %lu groups",
+                it->first.c_str(), rollup.fb_seq, rollup.groups.size());
+        return 1;
+    }
+    return 0;
+}
+
+/*
+ * Read one col chunk extent into data and extract its single col table.
+ * The table refers to data, which must outlive it.
+ */
+static
+int
+read_col_chunk(
+    cls_method_context_t hctx,
+    const struct Tables::read_info& ri,
+    bufferlist& data,
+    std::shared_ptr<arrow::Table>* table)
+{
+    bufferlist b;
+    int ret = cls_cxx_read2(hctx, ri.off, ri.len, &b, SCAN_READ_FLAGS);
+    if (ret < 0) {
+        CLS_ERR("ERROR: read_col_chunk: reading obj at off=%d;len=%d %d",
+                ri.off, ri.len, ret);
+        return ret;
+    }
+    try {
+        bufferlist::iterator it = b.begin();
+        ::decode(data, it);
+    } catch (const buffer::error &err) {
+        CLS_ERR("ERROR: read_col_chunk: decoding chunk at off=%d", ri.off);
+        return -EINVAL;
+    }
+    Tables::sky_meta meta = Tables::getSkyMeta(&data);
+    if (meta.blob_format != Tables::SFT_ARROW) {
+        CLS_ERR("ERROR: read_col_chunk: chunk format %d", meta.blob_format);
+        return -EINVAL;
+    }
+    return Tables::extract_arrow_from_string(table, meta.blob_data,
+                                             meta.blob_size);
+}
+
+
 
 
 /*
@@ -685,6 +1166,73 @@ sky_index_exists (cls_method_context_t hctx, std::string key_prefix)
 }
 
 
+/*
+    Check if an IDX_RID/IDX_REC index exists only with an older key data
+    format (see IDX_KEY_DATA_VERSION), which is not read, the index must be
+    rebuilt to be used.
+*/
+static
+bool
+sky_index_legacy (
+    cls_method_context_t hctx,
+    int idx_type,
+    std::string schema_name,
+    std::string table_name,
+    std::vector<std::string> index_cols)
+{
+    if (idx_type != SIT_IDX_RID and idx_type != SIT_IDX_REC)
+        return false;
+    for (int v = 1; v < IDX_KEY_DATA_VERSION; v++) {
+        std::string key_prefix = buildKeyPrefix(idx_type, schema_name,
+                                                table_name, index_cols, v);
+        if (sky_index_exists(hctx, key_prefix)) {
+            CLS_LOG(20, "sky_index_legacy: ignoring index %s of key data "
+                    "version %d, rebuild it", key_prefix.c_str(), v);
+            return true;
+        }
+    }
+    return false;
+}
+
+
+/*
+    Check if the index entries hold the vals of all of the given cols, i.e.,
+    the index was built with include cols (see idx_op) covering the query.
+    The RID is always available from the entry itself.
+*/
+static
+bool
+sky_index_covers(
+        cls_method_context_t hctx,
+        std::string key_prefix,
+        const std::set<int>& cols)
+{
+    bufferlist bl;
+    int ret = cls_cxx_map_get_val(hctx, key_prefix, &bl);
+    if (ret < 0 or bl.length() == 0)
+        return false;
+
+    std::string covered_schema_str;
+    try {
+        bufferlist::iterator it = bl.begin();
+        ::decode(covered_schema_str, it);
+    } catch (const buffer::error &err) {
+        CLS_ERR("ERROR: decoding index marker covered schema");
+        return false;
+    }
+
+    std::set<int> covered;
+    Tables::schema_vec covered_schema = \
+        Tables::schemaFromString(covered_schema_str);
+    for (auto it = covered_schema.begin(); it != covered_schema.end(); ++it)
+        covered.insert(it->idx);
+    for (auto it = cols.begin(); it != cols.end(); ++it) {
+        if (*it != Tables::RID_COL_INDEX and !covered.count(*it))
+            return false;
+    }
+    return true;
+}
+
 /*
     Decide to use index or not.
     Check statistics and index predicates, if expected selectivity is high
@@ -730,200 +1278,483 @@ use_sky_index(
     return use_index;
 }
 
+/*
+ * Build an SFT_FLATBUF_FLEX_ROW table from the entries of a covering index,
+ * for index only plans. The entries hold their rows' vals of the covered
+ * cols laid out as data schema rows, so the table is processed as usual.
+ * All rows are live, as objs with dead rows get no covering index marker,
+ * see exec_build_sky_index_op.
+ */
+static
+void
+build_index_only_fb(
+    flatbuffers::FlatBufferBuilder& flatbldr,
+    const Tables::schema_vec& data_schema,
+    const std::string& db_schema_name,
+    const std::string& table_name,
+    const std::vector<struct idx_rec_entry>& covered_rows) {
+
+    using namespace Tables;
+    delete_vector dead_rows;
+    std::vector<flatbuffers::Offset<Tables::Record>> offs;
+    offs.reserve(covered_rows.size());
+    for (auto it = covered_rows.begin(); it != covered_rows.end(); ++it) {
+        auto row_data = flatbldr.CreateVector(
+            reinterpret_cast<const uint8_t*>(it->cols_data.data()),
+            it->cols_data.size());
+        auto nullbits = flatbldr.CreateVector(it->nullbits);
+        offs.push_back(CreateRecord(flatbldr, it->rid, nullbits, row_data));
+        dead_rows.push_back(0);
+    }
+
+    auto schema = flatbldr.CreateString(schemaToString(data_schema));
+    auto db_schema = flatbldr.CreateString(db_schema_name);
+    auto table_n = flatbldr.CreateString(table_name);
+    auto delete_v = flatbldr.CreateVector(dead_rows);
+    auto rows_v = flatbldr.CreateVector(offs);
+    auto table = CreateTable(flatbldr, SFT_FLATBUF_FLEX_ROW, 2, 1, 1,
+                             schema, db_schema, table_n, delete_v, rows_v,
+                             offs.size());
+    flatbldr.Finish(table);
+}
+
 /*
  * Lookup matching records in omap, based on the index specified and the
  * index predicates.  Set the idx_reads info vector with the corresponding
  * flatbuf off/len and row numbers for each matching record.
+ *
+ * Composite keys are scanned over the combinations of the vals of the
+ * leading eq/in index cols plus the bounds of the next col, and each key
+ * found is checked against the preds on all of the index cols, so the
+ * index preds are applied exactly here. When the leading col has no eq
+ * pred but the next col does, we skip scan over the distinct vals of the
+ * leading col, for up to SKIP_SCAN_MAX_SEEKS vals before scanning the rest.
  */
-
 static
 int
 read_sky_index(
     cls_method_context_t hctx,
+    Tables::schema_vec index_schema,
     Tables::predicate_vec index_preds,
     std::string key_fb_prefix,
     std::string key_data_prefix,
     int index_type,
     int idx_batch_size,
-    std::map<int, struct Tables::read_info>& idx_reads) {
+    std::map<int, struct Tables::read_info>& idx_reads,
+    std::vector<struct idx_rec_entry>* covered_rows = nullptr) {
 
     using namespace Tables;
-    int ret = 0, ret2 = 0;
-    std::vector<std::string> keys;   // to contain all keys found after lookups
+    int ret = 0;
 
-    // for each fb_seq_num, a corresponding read_info struct to
-    // indicate the relevant rows within a given fb.
-    // fb_seq_num is used as key, so that subsequent reads will always be from
-    // a higher byte offset, if that matters.
+    // index only plans keep the matching entries themselves, else we set
+    // the reads of the fbs holding the matching rows.
+    auto add_entry = [&](bufferlist& bl) {
+        if (!covered_rows)
+            return update_idx_reads(hctx, idx_reads, bl,
+                                    key_fb_prefix, key_data_prefix);
+        struct idx_rec_entry rec_ent;
+        try {
+            bufferlist::iterator it = bl.begin();
+            ::decode(rec_ent, it);
+        } catch (const buffer::error &err) {
+            CLS_ERR("ERROR: decoding query idx_rec_ent");
+            return -EINVAL;
+        }
+        covered_rows->push_back(rec_ent);
+        return 0;
+    };
+
+    // txt index keys are the raw words, the index preds would be looked up
+    // by their IDX_REC key encoding and silently match nothing.
+    if (index_type == SIT_IDX_TXT) {
+        CLS_ERR("ERROR: read_sky_index: text index reads not supported");
+        return -EOPNOTSUPP;
+    }
 
-    // build up the key data portion from the idx pred vals.
-    // assumes all indexes here are integers, we extract the predicate vals
-    // as ints and use our uint to padded string method to build the keys
-    std::string key_data;
-    for (unsigned i = 0; i < index_preds.size(); i++) {
-        uint64_t val = 0;
-
-        switch (index_preds[i]->colType()) {
-            case SDT_INT8:
-            case SDT_INT16:
-            case SDT_INT32:
-            case SDT_INT64: {  // TODO: support signed ints in index ranges
-                int64_t v = 0;
-                extract_typedpred_val(index_preds[i], v);
-                val = static_cast<uint64_t>(v);  // force to unsigned for now.
+    // the bounds of each index col, as key data
+    index_range_vec ranges = indexColRanges(index_schema, index_preds);
+    for (auto it = ranges.begin(); it != ranges.end(); ++it) {
+        if (it->has_eq and it->eq_vals.empty())
+            return 0;  // no val can match
+    }
+
+    // scan the keys with the given prefix from key start on, adding the
+    // entries matching all index preds, until the vals of the range col
+    // (if any) are past its bounds.
+    auto scan = [&](const std::string& prefix, const std::string& start,
+                    int range_col) {
+        // start after the key just before start, any keys in between
+        // are skipped below.
+        std::string start_after = start;
+        if (!start_after.empty()) {
+            if (start_after.back() != '\0')
+                start_after.back()--;
+            else
+                start_after.pop_back();
+        }
+        bool more = true;
+        std::vector<std::string> col_vals;
+        while (more) {
+            std::map<std::string, bufferlist> key_val_map;
+            int ret2 = cls_cxx_map_get_vals(hctx, start_after, prefix,
+                                            idx_batch_size, &key_val_map,
+                                            &more);
+            if (ret2 == -ENOENT or (ret2 >= 0 and key_val_map.empty()))
                 break;
+            if (ret2 < 0) {
+                CLS_ERR("cant read map val index rec for idx_rec key %d", ret2);
+                return ret2;
+            }
+            for (auto it = key_val_map.begin(); it != key_val_map.end(); ++it) {
+                const std::string& key = it->first;
+                start_after = key;
+                if (key < start)
+                    continue;
+
+                // skip the index exists marker, it has no key data.
+                if (!splitIndexKeyData(index_schema,
+                                       key.substr(key_data_prefix.size()),
+                                       col_vals))
+                    continue;
+                if (range_col >= 0 and
+                    indexColPastRange(ranges[range_col], col_vals[range_col]))
+                    return 0;
+                bool match = true;
+                for (unsigned j = 0; j < ranges.size() and match; j++)
+                    match = indexColInRange(ranges[j], col_vals[j]);
+                if (!match)
+                    continue;
+
+                // Set the idx_reads info vector with the corresponding
+                // flatbuf off/len and row numbers for each matching record
+                ret2 = add_entry(it->second);
+                if (ret2 < 0)
+                    return ret2;
             }
-            case SDT_UINT8:
-            case SDT_UINT16:
-            case SDT_UINT32:
-            case SDT_UINT64: {
-                extract_typedpred_val(index_preds[i], val);
+        }
+        return 0;
+    };
+
+    // scan the keys under base for the leading eq cols from col c0 on,
+    // each combination of their vals is a key prefix, plus the bounds of
+    // the next col which sets where its scan starts and stops. Past
+    // INDEX_MAX_PROBE_KEYS combinations, the remaining eq cols are range
+    // scanned from their min to max val instead.
+    auto scan_prefixes = [&](const std::string& base, unsigned c0) {
+        std::vector<std::string> prefixes(1, base);
+        unsigned j = c0;
+        for (; j < ranges.size() and ranges[j].has_eq; j++) {
+            if (prefixes.size() * ranges[j].eq_vals.size() >
+                INDEX_MAX_PROBE_KEYS) {
+                CLS_LOG(20, "read_sky_index: %lu in vals on col %u, scanning",
+                        prefixes.size() * ranges[j].eq_vals.size(), j);
                 break;
             }
-            default:
-                assert (BuildSkyIndexUnsupportedColType==0);
+            std::vector<std::string> next_prefixes;
+            next_prefixes.reserve(prefixes.size() * ranges[j].eq_vals.size());
+            for (auto it = prefixes.begin(); it != prefixes.end(); ++it) {
+                for (auto v = ranges[j].eq_vals.begin();
+                          v != ranges[j].eq_vals.end(); ++v) {
+                    std::string p = *it;
+                    if (j > 0)  // add delim for multicol index vals
+                        p += IDX_KEY_DELIM_INNER;
+                    next_prefixes.push_back(p + *v);
+                }
+            }
+            prefixes.swap(next_prefixes);
         }
+        for (auto it = prefixes.begin(); it != prefixes.end(); ++it) {
+            int ret2 = 0;
+            if (j == ranges.size()) {  // all eq, the key or key+unique suffix
+                ret2 = scan(*it, *it, -1);
+            }
+            else {
+                std::string start = *it;
+                if (j > 0)
+                    start += IDX_KEY_DELIM_INNER;
+                if (ranges[j].has_eq)
+                    start += ranges[j].eq_vals.front();
+                else if (ranges[j].has_lo)
+                    start += ranges[j].lo;
+                ret2 = scan(*it, start, j);
+            }
+            if (ret2 < 0)
+                return ret2;
+        }
+        return 0;
+    };
+
+    bool skip_scan = ranges.size() > 1 and !ranges[0].has_eq and
+                     ranges[1].constrained();
+    if (!skip_scan)
+        return scan_prefixes(key_data_prefix, 0);
+
+    // skip scan, find the next leading col val then scan its keys for the
+    // preds on the other cols, then seek past its keys to the next val.
+    std::string start = key_data_prefix;
+    if (ranges[0].has_lo)
+        start += ranges[0].lo;
+    std::string start_after = start;
+    start_after.pop_back();
+    std::vector<std::string> col_vals;
+    for (unsigned seeks = 0; ; seeks++) {
+        if (seeks == SKIP_SCAN_MAX_SEEKS) {
+            // too many leading col vals to seek, scan the rest instead.
+            CLS_LOG(20, "read_sky_index: skip scan, %u leading vals, scanning",
+                    seeks);
+            return scan(key_data_prefix, start_after + '\0', 0);
+        }
+        std::map<std::string, bufferlist> key_val_map;
+        bool more = false;
+        ret = cls_cxx_map_get_vals(hctx, start_after, key_data_prefix, 1,
+                                   &key_val_map, &more);
+        if (ret == -ENOENT or (ret >= 0 and key_val_map.empty()))
+            break;
+        if (ret < 0) {
+            CLS_ERR("cant read map val index rec for idx_rec key %d", ret);
+            return ret;
+        }
+        const std::string& key = key_val_map.begin()->first;
+        start_after = key;
+        if (key < start or
+            !splitIndexKeyData(index_schema,
+                               key.substr(key_data_prefix.size()),
+                               col_vals))
+            continue;
+        if (indexColPastRange(ranges[0], col_vals[0]))
+            break;
 
-        if (i > 0)  // add delim for multicol index vals
-            key_data += IDX_KEY_DELIM_INNER;
-        key_data += buildKeyData(index_preds[i]->colType(), val);
-    }
-    std::string key = key_data_prefix + key_data;
-
-    // Add base key when all index predicates include equality
-    if (check_predicate_ops_all_include_equality(index_preds)) {
-        keys.push_back(key);
-    }
-
-    // Find the starting key for range query keys:
-    // 1. Greater than predicates we start after the base key,
-    // 2. Less than predicates we start after the prefix of the base key.
-    std::string start_after = "";
-    if (check_predicate_ops(index_preds, SOT_geq) or
-        check_predicate_ops(index_preds, SOT_gt)) {
+        std::string lead = key_data_prefix + col_vals[0];
+        if (indexColInRange(ranges[0], col_vals[0])) {
+            ret = scan_prefixes(lead, 1);
+            if (ret < 0)
+                return ret;
+        }
 
-        start_after = key;
+        // all keys with this leading val continue with the inner delim
+        start_after = lead + IDX_KEY_DELIM_INNER;
+        start_after.back()++;
     }
-    else if (check_predicate_ops(index_preds, SOT_lt) or
-             check_predicate_ops(index_preds, SOT_leq)) {
+    return 0;
+}
 
-        start_after = key_data_prefix;
-    }
+/*
+ * OSD load as seen by the query ops of this class, shared by all PGs of the
+ * osd: the number of exec_query_op calls in progress, and a decaying
+ * average of the cpu time they spend evaluating (in cores busy). Used to
+ * decide whether to push the processing back to the client.
+ */
+static std::atomic<int> query_ops_inflight(0);
+static std::mutex query_cpu_lock;
+static double query_cpu_load = 0;    // cores busy
+static uint64_t query_cpu_load_ns = 0;   // time of the last update
+
+struct query_op_inflight {
+    int n;
+    query_op_inflight() { n = ++query_ops_inflight; }
+    ~query_op_inflight() { --query_ops_inflight; }
+};
+
+static double decayed_cpu_load(uint64_t now)
+{
+    const double decay_ns = Tables::PUSHBACK_CPU_DECAY_SEC * 1e9;
+    if (now <= query_cpu_load_ns)
+        return query_cpu_load;
+    return query_cpu_load * std::exp(-(now - query_cpu_load_ns) / decay_ns);
+}
 
-    // Get keys in batches at a time and print row number/ offset detail
-    // Equality query does not loop  TODO: this is not true for non-unique idx!
-    bool stop = false;
-    if (start_after.empty()) stop = true;
+static double get_query_cpu_load()
+{
+    std::lock_guard<std::mutex> l(query_cpu_lock);
+    return decayed_cpu_load(getns());
+}
 
-    // Retrieve keys for range queries in batches of "max_to_get"
-    // until no more keys
-    bool more = true;
-    int max_to_get = idx_batch_size;
-    std::map<std::string, bufferlist> key_val_map;
-    while(!stop) {
-        ret2 = cls_cxx_map_get_vals(hctx, start_after, string(),
-                                    max_to_get, &key_val_map, &more);
+static void add_query_cpu_load(uint64_t eval_ns)
+{
+    std::lock_guard<std::mutex> l(query_cpu_lock);
+    uint64_t now = getns();
+    query_cpu_load = decayed_cpu_load(now) +
+                     eval_ns / (Tables::PUSHBACK_CPU_DECAY_SEC * 1e9);
+    query_cpu_load_ns = now;
+}
 
-        if (ret2 < 0 && ret2 != -ENOENT) {
-            CLS_ERR("cant read map val index rec for idx_rec key %d", ret2);
-            return ret2;
+/*
+ * Compiled query plans, i.e., the schemas, exprs and preds of a query_op,
+ * from its binary QueryPlan if set, else parsed from its text fields. A
+ * query sends the same plan to each of its objects, so the plans are cached
+ * per osd and keyed by a hash of the plan bytes or text. Preds hold per
+ * query agg state, so a plan is checked out of the cache for the duration
+ * of one exec_query_op and reset when checked back in; concurrent calls
+ * with the same plan compile their own copy.
+ */
+struct query_plan {
+    uint64_t hash;
+    std::string text;   // all fields parsed, to verify a cache hit
+    bool binary;        // text is the op's QueryPlan, else its text fields
+    Tables::schema_vec data_schema;
+    Tables::schema_vec query_schema;
+    Tables::expr_vec query_exprs;
+    Tables::schema_vec expr_schema;
+    Tables::predicate_vec query_preds;
+    Tables::schema_vec index_schema;
+    Tables::predicate_vec index_preds;
+    Tables::schema_vec index2_schema;
+    Tables::predicate_vec index2_preds;
+    Tables::sort_vec sort_keys;
+    int errcode;        // malformed plan, the remaining fields are not set
+    std::string errmsg;
+
+    query_plan(const query_op& op, uint64_t h, const std::string& t) :
+        hash(h),
+        text(t),
+        binary(!op.plan.empty()),
+        errcode(0) {
+            if (binary) {
+                compile(Tables::verifyQueryPlan(op.plan.data(),
+                                                op.plan.size()));
+                return;
+            }
+            data_schema = Tables::schemaFromString(op.data_schema);
+            query_schema = Tables::schemaFromString(op.query_schema);
+            errcode = Tables::exprsFromString(data_schema, op.query_exprs,
+                                              query_exprs, errmsg);
+            if (errcode)
+                return;
+            expr_schema = Tables::schemaWithExprs(data_schema, query_exprs);
+            query_preds = Tables::predsFromString(expr_schema,
+                                                  op.query_preds);
+            sort_keys = Tables::sortKeysFromString(query_schema,
+                                                   op.query_sort);
+            if (op.index_read) {
+                index_schema = Tables::schemaFromString(op.index_schema);
+                index_preds = Tables::predsFromString(data_schema,
+                                                      op.index_preds);
+                index2_schema = Tables::schemaFromString(op.index2_schema);
+                index2_preds = Tables::predsFromString(data_schema,
+                                                       op.index2_preds);
+            }
         }
 
-        // If no more entries found break out of the loop
-        if (ret2 == -ENOENT || key_val_map.size() == 0) {
-            break;
+    // from the binary plan, its schemas and preds are read in place
+    void compile(const Tables::QueryPlan* qp) {
+        if (!qp) {
+            errcode = Tables::BadQueryPlan;
+            errmsg = "malformed query plan or unknown plan version";
+            return;
+        }
+        data_schema = Tables::schemaFromPlan(qp->data_schema());
+        query_schema = Tables::schemaFromPlan(qp->query_schema());
+        errcode = Tables::exprsFromString(data_schema,
+            qp->query_exprs() ? qp->query_exprs()->str() : "",
+            query_exprs, errmsg);
+        if (errcode)
+            return;
+        expr_schema = Tables::schemaWithExprs(data_schema, query_exprs);
+        errcode = Tables::predsFromPlan(expr_schema, qp->query_preds(),
+                                        query_preds, errmsg);
+        if (errcode)
+            return;
+        sort_keys = Tables::sortKeysFromString(query_schema,
+            qp->query_sort() ? qp->query_sort()->str() : "");
+        if (qp->index_read()) {
+            index_schema = Tables::schemaFromPlan(qp->index_schema());
+            index2_schema = Tables::schemaFromPlan(qp->index2_schema());
+            errcode = Tables::predsFromPlan(data_schema, qp->index_preds(),
+                                            index_preds, errmsg);
+            if (!errcode)
+                errcode = Tables::predsFromPlan(data_schema,
+                                                qp->index2_preds(),
+                                                index2_preds, errmsg);
         }
+    }
 
-        if (ret2 >= 0) {
-            try {
-                for (auto it = key_val_map.cbegin();
-                          it != key_val_map.cend(); it++) {
-                    const std::string& key1 = it->first;
-                    bufferlist record_bl_entry = it->second;
-
-                    // Break if keyprefix in fetched key does not match that
-                    // passed by user, means we have gone too far, possibly
-                    // into keys for another index.
-                    if (key1.find(key_data_prefix) == std::string::npos) {
-                        stop = true;
-                        break;
-                    }
+    ~query_plan() {
+        for (auto p : query_preds) delete p;
+        for (auto p : index_preds) delete p;
+        for (auto p : index2_preds) delete p;
+    }
 
-                    // If this is the last key, update start_after value
-                    if (std::next(it, 1) == key_val_map.cend()) {
-                        start_after = key1;
-                    }
+    void reset() {
+        for (auto p : query_preds) p->resetAgg();
+        for (auto p : index_preds) p->resetAgg();
+        for (auto p : index2_preds) p->resetAgg();
+    }
+};
 
-                    // break if key matches or exceeds key passed by the user
-                    // prevents going into the next index (next key prefix)
-                    if (check_predicate_ops(index_preds, SOT_lt) or
-                        check_predicate_ops(index_preds, SOT_leq)) {
-                        //~ if(key_val_map.find(key) != key_val_map.end()) {
-                            //~ stop = true;
-                            //~ break;
-                        //~ }
-                        if (key1 == key) {   /// TODO: is this  extra check needed?
-                            stop = true;
-                            break;
-                        }
-                        else if (key1 > key) {  // Special handling for leq
-                            if (check_predicate_ops(index_preds, SOT_leq) and
-                                compare_keys(key, key1)) {
-                                stop = false;
-                            }
-                            else {
-                                stop = true;
-                                break;
-                            }
-                        }
-                    }
+static std::mutex query_plan_lock;
+static std::list<query_plan*> query_plan_cache;  // most recently used first
 
-                    // Skip equality entries in geq query
-                    if (check_predicate_ops(index_preds, SOT_gt) and
-                        compare_keys(key, key1)) {
-                        continue;
-                    }
+static std::string query_plan_text(const query_op& op)
+{
+    std::string t;
+    t.reserve(op.data_schema.size() + op.query_schema.size() +
+              op.query_exprs.size() + op.query_preds.size() +
+              op.index_schema.size() + op.index_preds.size() +
+              op.index2_schema.size() + op.index2_preds.size() +
+              op.query_sort.size() + 10);
+    t.append(op.index_read ? "1" : "0");
+    for (auto f : {&op.data_schema, &op.query_schema, &op.query_exprs,
+                   &op.query_preds, &op.index_schema, &op.index_preds,
+                   &op.index2_schema, &op.index2_preds, &op.query_sort}) {
+        t.push_back('\0');
+        t.append(*f);
+    }
+    return t;
+}
 
-                    // Set the idx_reads info vector with the corresponding
-                    // flatbuf off/len and row numbers for each matching record
-                    ret2 = update_idx_reads(hctx, idx_reads, record_bl_entry,
-                                            key_fb_prefix, key_data_prefix);
-                    if(ret2 < 0)
-                        return ret2;
-                }
-            } catch (const buffer::error &err) {
-                    CLS_ERR("ERROR: decoding query idx_rec_ent");
-                    return -EINVAL;
+static query_plan* get_query_plan(const query_op& op)
+{
+    // a binary plan is its own text, hashed and compared in place
+    bool binary = !op.plan.empty();
+    std::string text_fields;
+    if (!binary)
+        text_fields = query_plan_text(op);
+    const std::string& text = binary ? op.plan : text_fields;
+    uint64_t hash = std::hash<std::string>()(text);
+    {
+        std::lock_guard<std::mutex> l(query_plan_lock);
+        for (auto it = query_plan_cache.begin();
+             it != query_plan_cache.end(); ++it) {
+            if ((*it)->hash == hash and (*it)->binary == binary and
+                (*it)->text == text) {
+                query_plan* plan = *it;
+                query_plan_cache.erase(it);
+                return plan;
             }
         }
     }
+    return new query_plan(op, hash, text);
+}
 
-
-    // lookup key in omap to get the row offset
-    if (!keys.empty()) {
-        for (unsigned i = 0; i < keys.size(); i++) {
-            bufferlist record_bl_entry;
-            ret = cls_cxx_map_get_val(hctx, keys[i], &record_bl_entry);
-            if (ret < 0 && ret != -ENOENT) {
-                CLS_ERR("cant read map val index rec for idx_rec key %d", ret);
-                return ret;
-            }
-            if (ret >= 0) {
-                ret2 = update_idx_reads(hctx,
-                                        idx_reads,
-                                        record_bl_entry,
-                                        key_fb_prefix,
-                                        key_data_prefix);
-                if (ret2 < 0)
-                    return ret2;
-            } else  {
-                // no rec found for key
-            }
+static void put_query_plan(query_plan* plan)
+{
+    plan->reset();
+    query_plan* evicted = nullptr;
+    {
+        std::lock_guard<std::mutex> l(query_plan_lock);
+        query_plan_cache.push_front(plan);
+        if (query_plan_cache.size() > Tables::QUERY_PLAN_CACHE_MAX) {
+            evicted = query_plan_cache.back();
+            query_plan_cache.pop_back();
         }
     }
-    return 0;
+    delete evicted;
 }
 
+// checks a plan out of the cache for one query op, and back in when done.
+// preds added by the op itself are owned here until then.
+struct query_plan_ref {
+    query_plan* plan;
+    Tables::predicate_vec op_preds;
+
+    query_plan_ref(const query_op& op) : plan(get_query_plan(op)) {}
+    ~query_plan_ref() {
+        for (auto p : op_preds) delete p;
+        put_query_plan(plan);
+    }
+    query_plan* operator->() { return plan; }
+};
+
 /*
  * Primary method to process queries
  */
@@ -964,46 +1795,116 @@ int exec_query_op(cls_method_context_t hctx, bufferlist *in, bufferlist *out)
 
     using namespace Tables;
 
+    // under load we decline to process the data, and return it as is to
+    // the client along with the preds it must still apply (push back).
+    // queries with a wasm udf are not pushed back, the client cannot run it.
+    query_op_inflight inflight;
+    std::string pushback_reason;
+    if (!op.fastpath and op.wasm.type == SWU_NONE) {
+        double cpu_load = 0;
+        if (op.pushback_max_inflight > 0 and
+            inflight.n > op.pushback_max_inflight) {
+            pushback_reason = "inflight=" + std::to_string(inflight.n);
+        }
+        else if (op.pushback_max_cpu > 0 and
+                 (cpu_load = get_query_cpu_load()) > op.pushback_max_cpu) {
+            pushback_reason = "cpu=" + std::to_string(cpu_load);
+        }
+        if (!pushback_reason.empty())
+            CLS_LOG(20, "exec_query_op: push back processing, osd load %s",
+                    pushback_reason.c_str());
+    }
+    bool pushback = !pushback_reason.empty();
+
     // hold result of index lookups or read all flatbufs
     bool index1_exists = false;
     bool index2_exists = false;
     bool use_index1 = false;
     bool use_index2 = false;
+    bool index_only = false;
+    bool col_chunks = false;
+    std::vector<struct idx_rec_entry> covered_rows;
     std::map<int, struct read_info> reads;
     std::map<int, struct read_info> idx1_reads;
     std::map<int, struct read_info> idx2_reads;
 
+    // the parsed query, from the plan cache when seen before
+    query_plan_ref plan(op);
+    if (plan->errcode) {
+        CLS_ERR("ERROR: exec_query_op: %s (errcode=%d)",
+                plan->errmsg.c_str(), plan->errcode);
+        return -EINVAL;
+    }
+
     // data_schema is the table's current schema
     // TODO: redundant, this is also stored in the fb, extract from fb?
-    schema_vec data_schema = schemaFromString(op.data_schema);
+    schema_vec& data_schema = plan->data_schema;
 
     // query_schema is the query schema
-    schema_vec query_schema = schemaFromString(op.query_schema);
+    schema_vec& query_schema = plan->query_schema;
+
+    // computed cols, if any, are appended after the data schema cols
+    expr_vec& query_exprs = plan->query_exprs;
+    schema_vec& expr_schema = plan->expr_schema;
 
-    // predicates to be applied, if any
-    predicate_vec query_preds = predsFromString(data_schema,
-                                                op.query_preds);
+    // order by keys, each object's result rows are returned sorted
+    sort_vec& sort_keys = plan->sort_keys;
+
+    // predicates to be applied, if any. the plan's preds are extended
+    // below with the index and semi-join preds for this op only.
+    predicate_vec query_preds = plan->query_preds;
+
+    /* ROLLUPS */
+    //
+    // a global agg query over the aggs of a rollup of the table, whose other
+    // preds are all on the rollup's group cols, is answered from the rollup
+    // without reading the data while the rollup covers the whole object.
+    if (!op.fastpath and !pushback and !op.index_read and
+        op.semijoin_col.empty() and op.sample_type == SST_NONE and
+        op.wasm.type == SWU_NONE and hasAggPreds(query_preds)) {
+        eval_start = getns();
+        ret = query_rollup(hctx, op, data_schema, query_schema, query_preds,
+                           result_bl);
+        if (ret < 0) {
+            CLS_ERR("ERROR: exec_query_op: query_rollup %d", ret);
+            return ret;
+        }
+        if (ret > 0) {
+            eval_ns = getns() - eval_start;
+            add_query_cpu_load(eval_ns);
+            cls_info info(read_ns, eval_ns, "", "");
+            ::encode(info, *out);
+            ::encode(result_bl, *out);
+            return 0;
+        }
+    }
 
     /* INDEXING LOOKUPS */
     //
     // required for index plan or scan plan if index plan not chosen.
-    predicate_vec index_preds;
-    predicate_vec index2_preds;
+    predicate_vec& index_preds = plan->index_preds;
+    predicate_vec& index2_preds = plan->index2_preds;
 
     std::string key_fb_prefix = buildKeyPrefix(SIT_IDX_FB,
                                                op.db_schema_name,
                                                op.table_name);
 
+    // objects in the col chunk layout (see transform_db_op) have no fbs,
+    // the entries of any index built before the transform are not used.
+    std::string key_col_rid_prefix = buildKeyPrefix(SIT_IDX_COL,
+                                                    op.db_schema_name,
+                                                    op.table_name,
+                                                    {RID_INDEX});
+    col_chunks = sky_index_exists(hctx, key_col_rid_prefix);
+    if (op.index_read and col_chunks)
+        CLS_LOG(20, "exec_query_op: col chunk layout, not using indexes");
+
     // lookup correct flatbuf and potentially set specific row nums
     // to be processed next in processFb()
-    if (op.index_read) {
+    if (op.index_read and !col_chunks) {
 
         // get info for index1
-        schema_vec index_schema = \
-                schemaFromString(op.index_schema);
-
-        index_preds = \
-                predsFromString(data_schema, op.index_preds);
+        schema_vec& index_schema = plan->index_schema;
 
         std::vector<std::string> index_cols = \
                 colnamesFromSchema(index_schema);
@@ -1015,10 +1916,7 @@ int exec_query_op(cls_method_context_t hctx, bufferlist *in, bufferlist *out)
                                index_cols);
 
         // get info for index2
-        schema_vec index2_schema = \
-                schemaFromString(op.index2_schema);
-        index2_preds = \
-                predsFromString(data_schema, op.index2_preds);
+        schema_vec& index2_schema = plan->index2_schema;
 
         std::vector<std::string> index2_cols = \
                 colnamesFromSchema(index2_schema);
@@ -1032,6 +1930,9 @@ int exec_query_op(cls_method_context_t hctx, bufferlist *in, bufferlist *out)
         // verify if index1 is present in omap
         index1_exists = sky_index_exists(hctx,
                                          key_data_prefix);
+        if (!index1_exists)
+            sky_index_legacy(hctx, op.index_type, op.db_schema_name,
+                             op.table_name, index_cols);
 
         // check local statistics, decide to use or not.
         if (index1_exists)
@@ -1039,39 +1940,47 @@ int exec_query_op(cls_method_context_t hctx, bufferlist *in, bufferlist *out)
 
         if (index1_exists && use_index1) {
 
-            // check for case of multicol index but not all equality.
-            if (index_cols.size() > 1 and
-                !check_predicate_ops_all_equality(index_preds)) {
-
-                // NOTE: mutlicol indexes only support range queries
-                // over first col (but all cols for equality queries)
-                // so to preserve correctness, here we (redundantly)
-                // add all of the index preds to the query preds
-                // to preserve correctness but we do not remove the
-                // extra non-equality preds from the index preds
-                // since in the future index queries will support
-                // ranges on multicols.
-
-                query_preds.reserve(query_preds.size() +
-                                    index_preds.size());
-                for (unsigned i = 0; i < index_preds.size(); i++) {
-                    query_preds.push_back(index_preds[i]);
-                }
+            // NOTE: the index lookup applies all of the index preds,
+            // including ranges over any col of a multicol index, so they
+            // are not added to the query preds.
+
+            // index only plan, when the entries of a covering index hold
+            // all of the cols used by the query we answer it from the index
+            // lookup alone and do not read the object data.
+            if (op.index_type == SIT_IDX_REC and
+                op.index_plan_type == SIP_IDX_STANDARD and
+                op.semijoin_col.empty() and op.wasm.type == SWU_NONE and
+                !op.fastpath and !pushback) {
+                std::set<int> cols;
+                for (auto it = query_schema.begin(); it != query_schema.end(); ++it)
+                    cols.insert(it->idx);
+                for (auto it = query_preds.begin(); it != query_preds.end(); ++it)
+                    cols.insert((*it)->colIdx());
+                for (auto it = index_preds.begin(); it != index_preds.end(); ++it)
+                    cols.insert((*it)->colIdx());
+                for (auto it = query_exprs.begin(); it != query_exprs.end(); ++it)
+                    exprColIdxs(it->expr, cols);
+                index_only = sky_index_covers(hctx, key_data_prefix, cols);
             }
 
             // index lookup to set the read requests, if any rows match
             ret = read_sky_index(hctx,
+                                 index_schema,
                                  index_preds,
                                  key_fb_prefix,
                                  key_data_prefix,
                                  op.index_type,
                                  op.index_batch_size,
-                                 idx1_reads);
+                                 idx1_reads,
+                                 index_only ? &covered_rows : nullptr);
             if (ret < 0) {
                 CLS_ERR("ERROR: do_index_lookup failed. %d", ret);
                 return ret;
             }
             CLS_LOG(20, "exec_query_op: index1 found %lu entries", idx1_reads.size());
+            if (index_only)
+                CLS_LOG(20, "exec_query_op: index only, %lu covered rows",
+                        covered_rows.size());
 
             reads = idx1_reads;  // populate with reads from index1
 
@@ -1088,6 +1997,10 @@ int exec_query_op(cls_method_context_t hctx, bufferlist *in, bufferlist *out)
                     // verify if index2 is present in omap
                     index2_exists = sky_index_exists(hctx,
                                                      key2_data_prefix);
+                    if (!index2_exists)
+                        sky_index_legacy(hctx, op.index2_type,
+                                         op.db_schema_name, op.table_name,
+                                         index2_cols);
 
                     // check local statistics, decide to use or not.
                     if (index2_exists)
@@ -1097,19 +2010,8 @@ int exec_query_op(cls_method_context_t hctx, bufferlist *in, bufferlist *out)
 
                     if (index2_exists && use_index2) {
 
-                        // check for case of multicol index but not all equality.
-                        if (index2_cols.size() > 1 and
-                            !check_predicate_ops_all_equality(index2_preds)) {
-
-                            // NOTE: same reasoning as above for index1_preds
-                            query_preds.reserve(query_preds.size() +
-                                                index2_preds.size());
-                            for (unsigned i = 0; i < index2_preds.size(); i++) {
-                                query_preds.push_back(index2_preds[i]);
-                            }
-                        }
-
                         ret = read_sky_index(hctx,
+                                             index2_schema,
                                              index2_preds,
                                              key_fb_prefix,
                                              key2_data_prefix,
@@ -1257,6 +2159,70 @@ int exec_query_op(cls_method_context_t hctx, bufferlist *in, bufferlist *out)
     }
 
 
+    // when pushed back, the index lookups above still limit the data
+    // returned, but the client must apply the index preds to its rows too.
+    std::string pushback_preds;
+    if (pushback) {
+        predicate_vec preds = query_preds;
+        if (op.index_read and use_index1)
+            preds.insert(preds.end(), index_preds.begin(), index_preds.end());
+        if (op.index_read and use_index2)
+            preds.insert(preds.end(), index2_preds.begin(), index2_preds.end());
+        pushback_preds = predsToString(preds, expr_schema);
+    }
+
+    // semi-join reduction, the scan drops rows whose join key is not in the
+    // client's filter along with the rows failing the other query preds.
+    // under push back the client applies the filter itself.
+    if (!op.semijoin_col.empty() and !pushback) {
+        schema_vec sv = schemaFromColNames(data_schema, op.semijoin_col);
+        if (sv.size() != 1 or
+            semiJoinKeyKind(sv[0].type) != semiJoinKeyKind(op.semijoin.key_type)) {
+            CLS_ERR("ERROR: exec_query_op: bad semi-join key col %s",
+                    op.semijoin_col.c_str());
+            return -EINVAL;
+        }
+        plan.op_preds.push_back(semiJoinPredicate(sv[0], op.semijoin));
+        addSemiJoinPredicate(query_preds, plan.op_preds.back());
+        CLS_LOG(20, "exec_query_op: semi-join on %s, %s",
+                op.semijoin_col.c_str(), op.semijoin.toString().c_str());
+    }
+
+    // Bernoulli sampled scan, the sample pred drops the unsampled rows along
+    // with the rows failing the other query preds. under push back the
+    // client samples the rows itself.
+    if (op.sample_type == SST_BERNOULLI and !pushback) {
+        plan.op_preds.push_back(new SamplePredicate(op.sample_fraction,
+                                                    op.sample_seed));
+        addSamplePredicate(query_preds, plan.op_preds.back());
+    }
+
+    // wasm filter udf, selects the rows of each fb that are then processed
+    // with the query preds.
+    WasmUdf udf;
+    bool use_udf = (op.wasm.type != SWU_NONE);
+    if (use_udf) {
+        std::string errmsg;
+        if (op.wasm.type != SWU_FILTER) {
+            CLS_ERR("ERROR: exec_query_op: wasm udf type %d is not a filter",
+                    op.wasm.type);
+            return -EINVAL;
+        }
+        ret = udf.init(op.wasm, data_schema, errmsg);
+        if (ret != 0) {
+            CLS_ERR("ERROR: exec_query_op: %s", errmsg.c_str());
+            CLS_ERR("ERROR: TablesErrCodes::%d", ret);
+            return (ret == TablesErrCodes::WasmUdfNotSupported) ?
+                -EOPNOTSUPP : -EINVAL;
+        }
+    }
+
+    // block sampled scan, the fbs (or col chunk row groups) not sampled are
+    // not read at all, identified by their seq num within the obj.
+    bool block_sample = (op.sample_type == SST_BLOCK);
+    uint64_t block_seed = skyHash64(op.sample_seed);
+    uint64_t block_threshold = sampleThreshold(op.sample_fraction);
+
     if (!op.index_read or
         (op.index_read and (!use_index1 and !use_index2))) {
         // if no index read was requested,
@@ -1268,10 +2234,14 @@ int exec_query_op(cls_method_context_t hctx, bufferlist *in, bufferlist *out)
         // 2) read each fb into mem in sequence to hopefully conserve
         //    mem during read + processing.
 
+        // objects in the col chunk layout (see transform_db_op) are read
+        // per row group, only the extents of the cols used by the query.
+
         // default, assume we have plenty of mem avail.
-        bool read_full_object = true;
+        bool read_full_object = !col_chunks;
 
-        if (op.mem_constrain) {
+        // block sampling also reads fb by fb, to skip the unsampled fbs.
+        if ((op.mem_constrain or block_sample) and !col_chunks) {
 
             // try to set the reads[] with the fb sequence
             int ret = read_fbs_index(hctx, key_fb_prefix, reads);
@@ -1285,18 +2255,229 @@ int exec_query_op(cls_method_context_t hctx, bufferlist *in, bufferlist *out)
                 read_full_object = false;
         }
 
-        // if we must read the full object, we set the reads[] to
-        // contain a single read, indicating the entire object.
-        if (read_full_object) {
-            int fb_seq_num = Tables::DATASTRUCT_SEQ_NUM_MIN;
-            int off = 0;
-            int len = 0;
-            std::vector<unsigned int> rnums = {};
-            struct read_info ri(fb_seq_num, off, len, {});
-            reads[fb_seq_num] = ri;
+        // if we must read the full object, we set the reads[] to
+        // contain a single read, indicating the entire object.
+        if (read_full_object) {
+            int fb_seq_num = Tables::DATASTRUCT_SEQ_NUM_MIN;
+            int off = 0;
+            int len = 0;
+            std::vector<unsigned int> rnums = {};
+            struct read_info ri(fb_seq_num, off, len, {});
+            reads[fb_seq_num] = ri;
+        }
+    }
+
+    // col chunk layout, for each row group read the RID chunk and the
+    // chunks of the cols used by the query then process them as one table.
+    // when pushed back or select * all the cols are returned.
+    if (col_chunks) {
+        std::set<int> cols;
+        if (op.fastpath or pushback) {
+            for (auto it = data_schema.begin(); it != data_schema.end(); ++it)
+                cols.insert(it->idx);
+        }
+        else {
+            for (auto it = query_schema.begin(); it != query_schema.end(); ++it)
+                cols.insert(it->idx);
+            for (auto it = query_preds.begin(); it != query_preds.end(); ++it)
+                cols.insert((*it)->colIdx());
+            for (auto it = query_exprs.begin(); it != query_exprs.end(); ++it)
+                exprColIdxs(it->expr, cols);
+            for (auto it = udf.inputCols().begin();
+                 it != udf.inputCols().end(); ++it)
+                cols.insert(it->idx);
+        }
+
+        std::map<int, struct read_info> rid_reads;
+        std::map<int, std::map<int, struct read_info>> col_reads;
+        ret = read_col_chunks_index(hctx,
+                                    buildKeyPrefix(SIT_IDX_COL,
+                                                   op.db_schema_name,
+                                                   op.table_name,
+                                                   {RID_INDEX}),
+                                    rid_reads);
+        if (ret < 0)
+            return ret;
+        for (auto it = data_schema.begin(); it != data_schema.end(); ++it) {
+            if (!cols.count(it->idx))
+                continue;
+            ret = read_col_chunks_index(hctx,
+                                        buildKeyPrefix(SIT_IDX_COL,
+                                                       op.db_schema_name,
+                                                       op.table_name,
+                                                       {it->name}),
+                                        col_reads[it->idx]);
+            if (ret < 0)
+                return ret;
+        }
+
+        if (block_sample) {
+            for (auto it = rid_reads.begin(); it != rid_reads.end(); ) {
+                if (sampleKeep(it->first, block_seed, block_threshold))
+                    ++it;
+                else
+                    it = rid_reads.erase(it);
+            }
+        }
+
+        if (op.debug)
+            CLS_LOG(20, "exec_query_op: col chunks, %lu row groups, %lu of %lu cols",
+                    rid_reads.size(), col_reads.size(), data_schema.size());
+
+        for (auto it = rid_reads.begin(); it != rid_reads.end(); ++it) {
+            int seq = it->first;
+
+            // chunk tables refer to their data bls, held until processed.
+            std::list<bufferlist> chunk_bls;
+            std::map<int, std::shared_ptr<arrow::Table>> chunks;
+            std::shared_ptr<arrow::Table> rid_chunk;
+
+            read_start = getns();
+            chunk_bls.emplace_back();
+            ret = read_col_chunk(hctx, it->second, chunk_bls.back(), &rid_chunk);
+            if (ret < 0)
+                return ret;
+            for (auto cit = col_reads.begin(); cit != col_reads.end(); ++cit) {
+                auto ri = cit->second.find(seq);
+                if (ri == cit->second.end()) {
+                    CLS_ERR("ERROR: exec_query_op: no chunk for col %d row group %d",
+                            cit->first, seq);
+                    return -EINVAL;
+                }
+                chunk_bls.emplace_back();
+                ret = read_col_chunk(hctx, ri->second, chunk_bls.back(),
+                                     &chunks[cit->first]);
+                if (ret < 0)
+                    return ret;
+            }
+            read_ns += getns() - read_start;
+
+            eval_start = getns();
+            std::string errmsg;
+            std::shared_ptr<arrow::Table> input_table;
+            ret = merge_arrow_col_chunks(chunks, rid_chunk, data_schema,
+                                         &input_table, errmsg);
+            if (ret != 0) {
+                CLS_ERR("ERROR: merge_arrow_col_chunks %s", errmsg.c_str());
+                CLS_ERR("ERROR: TablesErrCodes::%d", ret);
+                return -1;
+            }
+
+            // row groups with no rows passing the udf add no result
+            std::vector<uint32_t> rows;
+            if (use_udf) {
+                ret = udf.filterArrowRows(input_table, rows, errmsg);
+                if (ret != 0) {
+                    CLS_ERR("ERROR: WasmUdf %s", errmsg.c_str());
+                    CLS_ERR("ERROR: TablesErrCodes::%d", ret);
+                    return -1;
+                }
+                if (rows.empty()) {
+                    eval_ns += getns() - eval_start;
+                    continue;
+                }
+            }
+
+            std::shared_ptr<arrow::Table> table = input_table;
+            if (!op.fastpath and !pushback) {
+                ret = processArrowCol(&table,
+                                      data_schema,
+                                      query_schema,
+                                      query_preds,
+                                      input_table,
+                                      errmsg,
+                                      rows,
+                                      query_exprs,
+                                      sort_keys);
+                if (ret != 0) {
+                    CLS_ERR("ERROR: processArrowCol %s", errmsg.c_str());
+                    CLS_ERR("ERROR: TablesErrCodes::%d", ret);
+                    return -1;
+                }
+            }
+
+            std::shared_ptr<arrow::Buffer> buffer;
+            convert_arrow_to_buffer(table, &buffer);
+            flatbuffers::FlatBufferBuilder fbmeta_builder;
+            createFbMeta(&fbmeta_builder,
+                         SFT_ARROW,
+                         reinterpret_cast<unsigned char*>(buffer->mutable_data()),
+                         buffer->size());
+            result_bl.append(reinterpret_cast<const char*>(
+                             fbmeta_builder.GetBufferPointer()),
+                             fbmeta_builder.GetSize());
+            eval_ns += getns() - eval_start;
+        }
+    }
+
+    // index only plan, process the rows built from the covering index
+    // entries as a single flexbuf table, no reads are set above.
+    if (index_only) {
+        if (block_sample) {
+            std::vector<struct idx_rec_entry> sampled_rows;
+            for (auto it = covered_rows.begin(); it != covered_rows.end(); ++it) {
+                if (sampleKeep(it->fb_num, block_seed, block_threshold))
+                    sampled_rows.push_back(*it);
+            }
+            covered_rows.swap(sampled_rows);
+        }
+
+        eval_start = getns();
+        flatbuffers::FlatBufferBuilder covered_builder(1024);
+        build_index_only_fb(covered_builder,
+                            data_schema,
+                            op.db_schema_name,
+                            op.table_name,
+                            covered_rows);
+
+        std::string errmsg;
+        flatbuffers::FlatBufferBuilder result_builder(1024);
+        ret = processSkyFb(result_builder,
+                           data_schema,
+                           query_schema,
+                           query_preds,
+                           reinterpret_cast<const char*>(
+                                covered_builder.GetBufferPointer()),
+                           covered_builder.GetSize(),
+                           errmsg,
+                           {},
+                           query_exprs,
+                           sort_keys);
+        if (ret != 0) {
+            CLS_ERR("ERROR: processSkyFb %s", errmsg.c_str());
+            CLS_ERR("ERROR: TablesErrCodes::%d", ret);
+            return -1;
+        }
+
+        flatbuffers::FlatBufferBuilder fbmeta_builder;
+        createFbMeta(&fbmeta_builder,
+                     SFT_FLATBUF_FLEX_ROW,
+                     reinterpret_cast<unsigned char*>(
+                        result_builder.GetBufferPointer()),
+                     result_builder.GetSize());
+        result_bl.append(reinterpret_cast<const char*>(
+                         fbmeta_builder.GetBufferPointer()),
+                         fbmeta_builder.GetSize());
+        eval_ns += getns() - eval_start;
+    }
+
+    // drop the reads of the unsampled fbs, a whole obj read (no fb index)
+    // is instead sampled fb by fb as it is decoded below.
+    if (block_sample) {
+        for (auto it = reads.begin(); it != reads.end(); ) {
+            if (it->second.len == 0 or
+                sampleKeep(it->first, block_seed, block_threshold))
+                ++it;
+            else
+                it = reads.erase(it);
         }
     }
 
+    // identifies the object for the hot fb tracking of index driven reads
+    std::string obj_id;
+    if (op.index_read and (use_index1 or use_index2) and !reads.empty())
+        obj_id = hot_fb_obj_id(hctx);
+
     // now we can decode and process each bl in the obj
     // loop over a list of reads() that may have come from an index lookup
     // or if no index lookup, then a single read with off=0 and len=0 to
@@ -1313,8 +2494,13 @@ int exec_query_op(cls_method_context_t hctx, bufferlist *in, bufferlist *out)
         std::string msg = "off=" + std::to_string(off) +
                           ";len=" + std::to_string(len);
 
+        // index driven reads are point reads, else we are scanning.
+        int read_flags = SCAN_READ_FLAGS;
+        if (op.index_read and (use_index1 or use_index2))
+            read_flags = index_read_flags(obj_id, off, len);
+
         read_start = getns();
-        ret = cls_cxx_read(hctx, off, len, &b);
+        ret = cls_cxx_read2(hctx, off, len, &b, read_flags);
         if (ret < 0) {
           std::string msg = std::to_string(ret) + "reading obj at off="
             + std::to_string(off) + ";len=" + std::to_string(len);
@@ -1325,6 +2511,7 @@ int exec_query_op(cls_method_context_t hctx, bufferlist *in, bufferlist *out)
 
         // begin processing, so we record the evaluation time.
         eval_start = getns();
+        int fb_seq_num = it->first;
         ceph::bufferlist::iterator data_itr = b.begin();
         while (data_itr.get_remaining() > 0) {
 
@@ -1343,6 +2530,12 @@ int exec_query_op(cls_method_context_t hctx, bufferlist *in, bufferlist *out)
                 return -EINVAL;
             }
 
+            // whole obj read under block sampling, skip the unsampled fbs
+            int seq = fb_seq_num++;
+            if (block_sample and len == 0 and
+                !sampleKeep(seq, block_seed, block_threshold))
+                continue;
+
             /*
             * NOTE:
             *
@@ -1359,6 +2552,32 @@ int exec_query_op(cls_method_context_t hctx, bufferlist *in, bufferlist *out)
             // the decoded bl should contain exactly 1 fbmeta
             sky_meta fbmeta = getSkyMeta(&data);
 
+            // the rows of this fb to process, those of an index lookup if
+            // any, less those not passing the udf. fbs with no rows passing
+            // the udf add no result.
+            std::vector<unsigned int> fb_rows = row_nums;
+            if (use_udf) {
+                std::string errmsg;
+                if (fbmeta.blob_format == SFT_FLATBUF_FLEX_ROW) {
+                    ret = udf.filterFlexRows(fbmeta.blob_data,
+                                             fbmeta.blob_size,
+                                             fb_rows, errmsg);
+                }
+                else if (fbmeta.blob_format == SFT_ARROW) {
+                    std::shared_ptr<arrow::Table> table;
+                    extract_arrow_from_string(&table, fbmeta.blob_data,
+                                              fbmeta.blob_size);
+                    ret = udf.filterArrowRows(table, fb_rows, errmsg);
+                }
+                if (ret != 0) {
+                    CLS_ERR("ERROR: WasmUdf %s", errmsg.c_str());
+                    CLS_ERR("ERROR: TablesErrCodes::%d", ret);
+                    return -1;
+                }
+                if (fb_rows.empty())
+                    continue;
+            }
+
             if (op.debug) {
                 CLS_LOG(20, "cls: exec_query_op: fbmeta.blob_format=%d", fbmeta.blob_format);
                 CLS_LOG(20, "cls: exec_query_op: fbmeta.blob_data=0x%p", &fbmeta.blob_data[0]);
@@ -1416,81 +2635,42 @@ int exec_query_op(cls_method_context_t hctx, bufferlist *in, bufferlist *out)
                 int bldr_size = 1024;
                 flatbuffers::FlatBufferBuilder result_builder(bldr_size);
 
-                // temporary toggle for wasm execution testing
-                bool wasm = false;
-
-                if (wasm) {
-
-                    if (op.debug)
-                        CLS_LOG(20, "cls: exec_query_op: case SFT_FLATBUF_FLEX_ROW (wasm)");
-
-                    // convert all params to native char or int types for wasm
-                    char* bldrptr = reinterpret_cast<char*>(&result_builder);
-                    std::string ds = schemaToString(data_schema);
-                    std::string qs = schemaToString(query_schema);
-                    std::string qp = predsToString(query_preds, data_schema);
-                    int ERRMSG_MAX_LEN = 256;
-                    char* errmsg_ptr = (char*) calloc(ERRMSG_MAX_LEN, sizeof(char));
-                    int row_nums_size = static_cast<int>(row_nums.size());
-                    int* row_nums_ptr = (int*) calloc(row_nums_size, sizeof(int));
-                    std::copy(row_nums.begin(), row_nums.end(), row_nums_ptr);
-
-                    ret = processSkyFbWASM(
-                            bldrptr,
-                            bldr_size,
-                            const_cast<char*>(ds.c_str()),
-                            ds.length(),
-                            const_cast<char*>(qs.c_str()),
-                            qs.length(),
-                            const_cast<char*>(qp.c_str()),
-                            qp.length(),
-                            const_cast<char*>(fbmeta.blob_data),
-                            fbmeta.blob_size,
-                            errmsg_ptr,
-                            ERRMSG_MAX_LEN,
-                            row_nums_ptr,
-                            row_nums_size);
-
-                    errmsg.append(errmsg_ptr);
-                    free(errmsg_ptr);
-                    free(row_nums_ptr);
+                // short circuit processing since select * query,
+                // or pushed back to the client under load.
+                if (op.fastpath or pushback) {
+
+                // just create a new fbmeta from the orig data blob.
+                createFbMeta(fbmeta_builder,
+                    SFT_FLATBUF_FLEX_ROW,
+                    reinterpret_cast<unsigned char*>(const_cast<char*>(fbmeta.blob_data)),
+                    fbmeta.blob_size);
                 }
                 else {
+                    // normal case, pass in cpp typed params
+                    ret = processSkyFb(result_builder,
+                                       data_schema,
+                                       query_schema,
+                                       query_preds,
+                                       fbmeta.blob_data,
+                                       fbmeta.blob_size,
+                                       errmsg,
+                                       fb_rows,
+                                       query_exprs,
+                                       sort_keys);
 
-                    // short circuit processing since select * query.
-                    if (op.fastpath) {
 
-                    // just create a new fbmeta from the orig data blob.
-                    createFbMeta(fbmeta_builder,
-                        SFT_FLATBUF_FLEX_ROW,
-                        reinterpret_cast<unsigned char*>(const_cast<char*>(fbmeta.blob_data)),
-                        fbmeta.blob_size);
+                    if (ret != 0) {
+                        CLS_ERR("ERROR: processSkyFb %s", errmsg.c_str());
+                        CLS_ERR("ERROR: TablesErrCodes::%d", ret);
+                        return -1;
                     }
-                    else {
-                        // normal case, pass in cpp typed params
-                        ret = processSkyFb(result_builder,
-                                           data_schema,
-                                           query_schema,
-                                           query_preds,
-                                           fbmeta.blob_data,
-                                           fbmeta.blob_size,
-                                           errmsg,
-                                           row_nums);
-
-
-                        if (ret != 0) {
-                            CLS_ERR("ERROR: processSkyFb %s", errmsg.c_str());
-                            CLS_ERR("ERROR: TablesErrCodes::%d", ret);
-                            return -1;
-                        }
 
-                        createFbMeta(fbmeta_builder,
-                                     SFT_FLATBUF_FLEX_ROW,
-                                     reinterpret_cast<unsigned char*>(
-                                            result_builder.GetBufferPointer()),
-                                            result_builder.GetSize()
-                        );
-                    }
+                    createFbMeta(fbmeta_builder,
+                                 SFT_FLATBUF_FLEX_ROW,
+                                 reinterpret_cast<unsigned char*>(
+                                        result_builder.GetBufferPointer()),
+                                        result_builder.GetSize()
+                    );
                 }
                 break;
             }
@@ -1500,8 +2680,9 @@ int exec_query_op(cls_method_context_t hctx, bufferlist *in, bufferlist *out)
                 if (op.debug)
                     CLS_LOG(20, "cls: exec_query_op: case SFT_ARROW");
 
-                // short circuit processing since select * query.
-                if (op.fastpath) {
+                // short circuit processing since select * query,
+                // or pushed back to the client under load.
+                if (op.fastpath or pushback) {
 
                 // just create a new fbmeta from the orig data blob.
                 createFbMeta(fbmeta_builder,
@@ -1518,7 +2699,9 @@ int exec_query_op(cls_method_context_t hctx, bufferlist *in, bufferlist *out)
                                           fbmeta.blob_data,
                                           fbmeta.blob_size,
                                           errmsg,
-                                          row_nums);
+                                          fb_rows,
+                                          query_exprs,
+                                          sort_keys);
 
                     if (ret != 0) {
                         CLS_ERR("ERROR: processArrowCol %s", errmsg.c_str());
@@ -1563,7 +2746,8 @@ int exec_query_op(cls_method_context_t hctx, bufferlist *in, bufferlist *out)
     if (op.debug)
         CLS_LOG(20, "query_op.encoding result_bl size=%s", std::to_string(result_bl.length()).c_str());
 
-    cls_info info (read_ns, eval_ns, "", "");
+    add_query_cpu_load(eval_ns);
+    cls_info info (read_ns, eval_ns, pushback_preds, pushback_reason);
 
     // add both our cls info struct and our result bl to the output buffer.
     ::encode(info, *out);
@@ -1574,6 +2758,197 @@ int exec_query_op(cls_method_context_t hctx, bufferlist *in, bufferlist *out)
 
 
 
+/*
+ * Build a rollup of the table over the fbs of the object and insert it to
+ * omap, replacing any rollup of the same name (see rollup_info).
+ */
+static
+int build_rollup_op(cls_method_context_t hctx, bufferlist *in, bufferlist *out)
+{
+    rollup_op op;
+    try {
+        bufferlist::iterator it = in->begin();
+        ::decode(op, it);
+    } catch (const buffer::error &err) {
+        CLS_ERR("ERROR: build_rollup_op decoding rollup_op");
+        return -EINVAL;
+    }
+
+    if (op.debug)
+        CLS_LOG(20, "build_rollup_op: op.toString()=%s", op.toString().c_str());
+
+    using namespace Tables;
+
+    boost::trim(op.name);
+    boost::trim(op.group_cols);
+    if (op.name.empty()) {
+        CLS_ERR("ERROR: build_rollup_op: no rollup name");
+        return -EINVAL;
+    }
+
+    schema_vec data_schema = schemaFromString(op.data_schema);
+    schema_vec group_schema = schemaFromColNames(data_schema, op.group_cols);
+    size_t ngroup_cols = op.group_cols.empty() ? 0 :
+        std::count(op.group_cols.begin(), op.group_cols.end(), ',') + 1;
+    if (group_schema.size() != ngroup_cols) {
+        CLS_ERR("ERROR: build_rollup_op: bad group cols %s",
+                op.group_cols.c_str());
+        return -EINVAL;
+    }
+
+    std::string errmsg;
+    predicate_vec aggs = predsFromString(data_schema, op.agg_preds);
+    int ret = rollupCheckAggs(aggs, errmsg);
+    for (auto p : aggs)
+        delete p;
+    if (ret != 0) {
+        CLS_ERR("ERROR: build_rollup_op: %s", errmsg.c_str());
+        return -EINVAL;
+    }
+
+    rollup_info rollup;
+    rollup.data_schema = schemaToString(data_schema);
+    rollup.group_cols = op.group_cols;
+    rollup.agg_preds = op.agg_preds;
+
+    // obj contains a seq of encoded bls of skyhook fb, streamed.
+    obj_bl_reader reader(hctx);
+    ret = reader.init();
+    if (ret < 0) {
+        CLS_ERR("ERROR: build_rollup_op: reading obj. %d", ret);
+        return ret;
+    }
+    uint64_t off = 0;
+    bufferlist bl;
+    while ((ret = reader.next(&off, &bl)) > 0) {
+        ret = rollup_add_fb(bl, data_schema, group_schema, rollup);
+        if (ret < 0)
+            return ret;
+    }
+    if (ret < 0)
+        return ret;
+
+    ret = cls_cxx_stat(hctx, &rollup.obj_size, NULL);
+    if (ret < 0)
+        return ret;
+
+    std::string key = buildRollupKeyPrefix(op.db_schema_name, op.table_name) +
+                      op.name;
+    bufferlist rollup_bl;
+    ::encode(rollup, rollup_bl);
+    ret = cls_cxx_map_set_val(hctx, key, &rollup_bl);
+    if (ret < 0) {
+        CLS_ERR("build_rollup_op: error setting rollup entry %d", ret);
+        return ret;
+    }
+
+    CLS_LOG(20, "build_rollup_op: %s", rollup.toString().c_str());
+    return 0;
+}
+
+/*
+ * Append fbs to the object and add their rows to the object's rollups of
+ * the table, which stay current without rescanning the object. Rollups
+ * already stale (e.g., the object was written to directly) are left as is
+ * and not used by queries until rebuilt.
+ */
+static
+int append_fb_op(cls_method_context_t hctx, bufferlist *in, bufferlist *out)
+{
+    append_op op;
+    try {
+        bufferlist::iterator it = in->begin();
+        ::decode(op, it);
+    } catch (const buffer::error &err) {
+        CLS_ERR("ERROR: append_fb_op decoding append_op");
+        return -EINVAL;
+    }
+
+    if (op.debug)
+        CLS_LOG(20, "append_fb_op: op.toString()=%s", op.toString().c_str());
+
+    using namespace Tables;
+
+    uint64_t obj_size = 0;
+    int ret = cls_cxx_stat(hctx, &obj_size, NULL);
+    if (ret == -ENOENT)
+        obj_size = 0;
+    else if (ret < 0)
+        return ret;
+
+    // a full obj, e.g., a subpartition of a range partitioned table at its
+    // split size, the client continues in a new obj instead.
+    if (op.max_obj_size > 0 and obj_size > 0 and
+        obj_size + op.data.length() > op.max_obj_size) {
+        CLS_LOG(20, "append_fb_op: obj size %lu + %u over the max %lu",
+                obj_size, op.data.length(), op.max_obj_size);
+        return -EFBIG;
+    }
+
+    // the appended fbs, each an encoded fbmeta bl
+    std::vector<bufferlist> fbs;
+    bufferlist::iterator it = op.data.begin();
+    while (it.get_remaining() > 0) {
+        bufferlist bl;
+        try {
+            ::decode(bl, it);
+        } catch (const buffer::error &err) {
+            CLS_ERR("ERROR: append_fb_op: decoding fb %lu", fbs.size());
+            return -EINVAL;
+        }
+        fbs.push_back(bl);
+    }
+
+    std::map<std::string, rollup_info> rollups;
+    if (obj_size > 0) {
+        ret = read_rollups(hctx,
+                           buildRollupKeyPrefix(op.db_schema_name,
+                                                op.table_name),
+                           rollups);
+        if (ret < 0)
+            return ret;
+    }
+
+    std::map<std::string, bufferlist> rollups_bl;
+    for (auto r = rollups.begin(); r != rollups.end(); ++r) {
+        rollup_info& rollup = r->second;
+        if (rollupIsStale(rollup, obj_size)) {
+            CLS_LOG(20, "append_fb_op: rollup %s is stale", r->first.c_str());
+            continue;
+        }
+        schema_vec data_schema = schemaFromString(rollup.data_schema);
+        schema_vec group_schema = schemaFromColNames(data_schema,
+                                                     rollup.group_cols);
+        int r_ret = 0;
+        for (auto fb = fbs.begin(); r_ret == 0 and fb != fbs.end(); ++fb)
+            r_ret = rollup_add_fb(*fb, data_schema, group_schema, rollup);
+        if (r_ret < 0) {
+            // the rollup cannot cover the fbs, it becomes stale.
+            CLS_LOG(20, "append_fb_op: rollup %s not updated %d",
+                    r->first.c_str(), r_ret);
+            continue;
+        }
+        rollup.obj_size = obj_size + op.data.length();
+        ::encode(rollup, rollups_bl[r->first]);
+    }
+
+    ret = cls_cxx_write(hctx, obj_size, op.data.length(), &op.data);
+    if (ret < 0) {
+        CLS_ERR("ERROR: append_fb_op: writing fbs %d", ret);
+        return ret;
+    }
+
+    if (!rollups_bl.empty()) {
+        ret = cls_cxx_map_set_vals(hctx, &rollups_bl);
+        if (ret < 0) {
+            CLS_ERR("append_fb_op: error setting rollup entries %d", ret);
+            return ret;
+        }
+    }
+    return 0;
+}
+
+
 /*
  * Older test method to process queries a through f
  */
@@ -1920,6 +3295,164 @@ int exec_runstats_op(cls_method_context_t hctx, bufferlist *in, bufferlist *out)
 }
 
 
+/*
+ * Function: transform_col_chunks
+ * Description: Rewrite the object in the col chunk layout. Each fbmeta is
+ * a row group, converted to arrow if required, and each of its data cols is
+ * written as a separate SFT_ARROW fbmeta extent, followed by one extent for
+ * its RID and delete vector cols. The off/len of each extent is recorded in
+ * omap keyed by col name and row group seq num, so queries only read the
+ * extents of the cols they use. The prefix only key of the RID entries marks
+ * the object as being in this layout. The fb offsets held by the object's
+ * indexes (IDX_FB, IDX_RID, IDX_REC and IDX_TXT) and the fb counts of its
+ * rollups no longer apply, so these are removed.
+ * @param[in] hctx         : CLS method context
+ * @param[in] query_schema : Cols to transform from flatbuffer rows
+ * @param[in] obj_bl       : The object, a sequence of encoded fbmetas
+ * Return Value: error code
+*/
+static
+int transform_col_chunks(cls_method_context_t hctx,
+                         Tables::schema_vec& query_schema,
+                         bufferlist& obj_bl)
+{
+    using namespace Tables;
+    int ret = 0;
+    bufferlist chunks_bl;
+    std::map<std::string, bufferlist> col_index;
+    std::set<std::pair<std::string, std::string>> tables;
+    unsigned int seq_num = DATASTRUCT_SEQ_NUM_MIN;
+
+    ceph::bufferlist::iterator it = obj_bl.begin();
+    while (it.get_remaining() > 0) {
+        bufferlist bl;
+        try {
+            ::decode(bl, it);  // unpack the next bl
+        } catch (const buffer::error &err) {
+            CLS_ERR("ERROR: decoding object format from BL");
+            return -EINVAL;
+        }
+
+        sky_meta meta = getSkyMeta(&bl);
+        std::string errmsg;
+        std::shared_ptr<arrow::Table> table;
+        if (meta.blob_format == SFT_ARROW) {
+            ret = extract_arrow_from_string(&table, meta.blob_data,
+                                            meta.blob_size);
+        } else if (meta.blob_format == SFT_FLATBUF_FLEX_ROW) {
+            ret = transform_fb_to_arrow(meta.blob_data, meta.blob_size,
+                                        query_schema, errmsg, &table);
+        } else {
+            CLS_ERR("ERROR: transform_col_chunks: format %d", meta.blob_format);
+            return -EINVAL;
+        }
+        if (ret != 0) {
+            CLS_ERR("ERROR: transform_col_chunks: to arrow %s", errmsg.c_str());
+            return -EINVAL;
+        }
+
+        auto metadata = table->schema()->metadata();
+        std::string db_schema_name = metadata->value(METADATA_DB_SCHEMA);
+        std::string table_name = metadata->value(METADATA_TABLE_NAME);
+        std::string key_rid_prefix = buildKeyPrefix(SIT_IDX_COL,
+                                                    db_schema_name,
+                                                    table_name,
+                                                    {RID_INDEX});
+        if (sky_index_exists(hctx, key_rid_prefix)) {
+            CLS_LOG(20, "transform_col_chunks: already in col chunk layout");
+            return 0;
+        }
+        tables.insert(std::make_pair(db_schema_name, table_name));
+
+        std::vector<std::shared_ptr<arrow::Table>> chunks;
+        ret = split_arrow_col_chunks(table, &chunks);
+        if (ret != 0) {
+            CLS_ERR("ERROR: transform_col_chunks: split TablesErrCodes::%d", ret);
+            return -EINVAL;
+        }
+
+        ++seq_num;
+        std::string key_data = buildKeyData(SDT_INT32, seq_num);
+        for (unsigned i = 0; i < chunks.size(); i++) {
+            std::string colname = (i + 1 < chunks.size()) ?
+                                  chunks[i]->schema()->field(0)->name() :
+                                  RID_INDEX;
+
+            std::shared_ptr<arrow::Buffer> buffer;
+            convert_arrow_to_buffer(chunks[i], &buffer);
+            flatbuffers::FlatBufferBuilder meta_builder;
+            createFbMeta(&meta_builder,
+                         SFT_ARROW,
+                         reinterpret_cast<unsigned char*>(buffer->mutable_data()),
+                         buffer->size());
+            bufferlist meta_bl;
+            meta_bl.append(reinterpret_cast<const char*>(
+                               meta_builder.GetBufferPointer()),
+                           meta_builder.GetSize());
+
+            uint32_t off = chunks_bl.length();
+            ::encode(meta_bl, chunks_bl);
+            bufferlist ent_bl;
+            struct idx_fb_entry ent(off, chunks_bl.length() - off);
+            ::encode(ent, ent_bl);
+            col_index[buildKeyPrefix(SIT_IDX_COL, db_schema_name, table_name,
+                                     {colname}) + key_data] = ent_bl;
+        }
+
+        bufferlist empty_bl;
+        empty_bl.append("");
+        col_index[key_rid_prefix] = empty_bl;
+    }
+
+    // cls_cxx_replace truncates the original object and writes full object.
+    ret = cls_cxx_replace(hctx, 0, chunks_bl.length(), &chunks_bl);
+    if (ret < 0) {
+        CLS_ERR("ERROR: writing obj full %d", ret);
+        return ret;
+    }
+    ret = cls_cxx_map_set_vals(hctx, &col_index);
+    if (ret < 0) {
+        CLS_ERR("ERROR: transform_col_chunks: setting col chunk entries %d", ret);
+        return ret;
+    }
+
+    // the prefix of the entries of all indexes of a type on the table, i.e.,
+    // up to its (any) key cols.
+    const size_t cols_len = IDX_KEY_COLS_DEFAULT.size() +
+                            IDX_KEY_DELIM_OUTER.size();
+    for (auto t = tables.begin(); t != tables.end(); ++t) {
+        for (int idx_type : {SIT_IDX_FB, SIT_IDX_RID, SIT_IDX_REC,
+                             SIT_IDX_TXT}) {
+            std::string prefix = buildKeyPrefix(idx_type, t->first,
+                                                t->second);
+            prefix.resize(prefix.size() - cols_len);
+            ret = remove_omap_prefix(hctx, prefix);
+            if (ret < 0)
+                return ret;
+        }
+        // and those of any older key data format
+        for (int idx_type : {SIT_IDX_RID, SIT_IDX_REC}) {
+            for (int v = 1; v < IDX_KEY_DATA_VERSION; v++) {
+                std::string prefix = buildKeyPrefix(idx_type, t->first,
+                                                    t->second,
+                                                    std::vector<std::string>(), v);
+                prefix.resize(prefix.size() - cols_len);
+                ret = remove_omap_prefix(hctx, prefix);
+                if (ret < 0)
+                    return ret;
+            }
+        }
+        ret = remove_omap_prefix(hctx, buildRollupKeyPrefix(t->first,
+                                                            t->second));
+        if (ret < 0)
+            return ret;
+        CLS_LOG(20, "transform_col_chunks: removed the indexes and rollups "
+                "of %s.%s", t->first.c_str(), t->second.c_str());
+    }
+    return 0;
+}
+
+
 /*
  * Function: transform_db_op
  * Description: Method to convert database format.
@@ -1954,13 +3487,21 @@ int transform_db_op(cls_method_context_t hctx, bufferlist *in, bufferlist *out)
     bufferlist encoded_meta_bls;
 
     // TODO: get individual off/len of fbmeta's inside obj and read one at a time.
-    int ret = cls_cxx_read(hctx, 0, 0, &encoded_meta_bls);
+    int ret = cls_cxx_read2(hctx, 0, 0, &encoded_meta_bls, ONCE_READ_FLAGS);
     if (ret < 0) {
         CLS_ERR("ERROR: transform_db_op: reading obj. %d", ret);
         return ret;
     }
 
     using namespace Tables;
+    if (op.col_chunks) {
+        if (op.required_type != SFT_ARROW) {
+            CLS_ERR("ERROR: transform_db_op: col chunks require SFT_ARROW");
+            return -EINVAL;
+        }
+        return transform_col_chunks(hctx, query_schema, encoded_meta_bls);
+    }
+
     ceph::bufferlist::iterator it = encoded_meta_bls.begin();
     while (it.get_remaining() > 0) {
         bufferlist bl;
@@ -2108,67 +3649,115 @@ int example_query_op(cls_method_context_t hctx, bufferlist *in, bufferlist *out)
     return 0;
 }
 
+/*
+ * Run a wasm map udf over all of the rows of the object, returning a single
+ * table of the RID and udf val of each row. Filter udfs are instead applied
+ * by exec_query_op along with the query preds.
+ */
 static
 int wasm_query_op(cls_method_context_t hctx, bufferlist *in, bufferlist *out)
 {
     // unpack the requested op from the inbl.
-    inbl_sample_op op;
+    wasm_udf_op op;
     try {
         bufferlist::iterator it = in->begin();
         ::decode(op, it);
     } catch (const buffer::error &err) {
-        CLS_ERR("ERROR: cls_tabular:example_query_op: decoding inbl_sample_op");
+        CLS_ERR("ERROR: cls_tabular:wasm_query_op: decoding wasm_udf_op");
         return -EINVAL;
     }
 
-    std::string message = op.message;
-    std::string instructions = op.instructions;
-    int counter = op.counter;
-    int func_id = op.func_id;
-
-    CLS_LOG(20, "wasm_query_op: op.message = %s", message.c_str());
-    CLS_LOG(20, "wasm_query_op: op.instructions = %s", instructions.c_str());
-    CLS_LOG(20, "wasm_query_op: op.counter=%s", (std::to_string(counter)).c_str());
-    CLS_LOG(20, "wasm_query_op: op.func_id=%s", (std::to_string(func_id)).c_str());
+    if (op.debug)
+        CLS_LOG(20, "wasm_query_op: op.toString()=%s", op.toString().c_str());
 
     using namespace Tables;
-    //schema_vec data_schema = schemaFromString(op.data_schema);
 
-    int64_t read_timer = getns();
-    int64_t func_timer = 0;
-    int rows_processed = 0;
+    if (op.udf.type != SWU_MAP) {
+        CLS_ERR("ERROR: cls_tabular:wasm_query_op: udf type %d is not a map",
+                op.udf.type);
+        return -EINVAL;
+    }
 
-    switch (func_id) {
-        case 0:
-            CLS_ERR("ERROR: cls_tabular:wasm_query_op: unknown func_id=%d", func_id);
-            return -1;
-            break;
-        case 1: {
-            uint64_t start = getns();
-            rows_processed = example_func(counter);
-            uint64_t end = getns();
-            func_timer = end - start;
-            CLS_LOG(20, "wasm_query_op: function result=%d", rows_processed);
-            break;
+    std::string errmsg;
+    schema_vec data_schema = schemaFromString(op.data_schema);
+    WasmUdf udf;
+    int ret = udf.init(op.udf, data_schema, errmsg);
+    if (ret != 0) {
+        CLS_ERR("ERROR: cls_tabular:wasm_query_op: %s", errmsg.c_str());
+        CLS_ERR("ERROR: TablesErrCodes::%d", ret);
+        return (ret == TablesErrCodes::WasmUdfNotSupported) ?
+            -EOPNOTSUPP : -EINVAL;
+    }
+
+    uint64_t read_start = getns();
+    bufferlist b;
+    ret = cls_cxx_read2(hctx, 0, 0, &b, SCAN_READ_FLAGS);
+    if (ret < 0) {
+        CLS_ERR("ERROR: cls_tabular:wasm_query_op: reading obj %d", ret);
+        return ret;
+    }
+    uint64_t read_ns = getns() - read_start;
+
+    // the udf vals of the rows of all of the fbs
+    uint64_t eval_start = getns();
+    std::vector<uint64_t> rids;
+    std::vector<double> vals;
+    ceph::bufferlist::iterator data_itr = b.begin();
+    while (data_itr.get_remaining() > 0) {
+        bufferlist data;
+        try {
+            ::decode(data, data_itr);
+        } catch (const buffer::error &err) {
+            CLS_ERR("ERROR: cls_tabular:wasm_query_op: decoding data from data_itr");
+            return -EINVAL;
         }
-        default:
-            CLS_ERR("ERROR: cls_tabular:wasm_query_op: unknown func_id %d", func_id);
+        sky_meta fbmeta = getSkyMeta(&data);
+
+        switch (fbmeta.blob_format) {
+            case SFT_FLATBUF_FLEX_ROW:
+                ret = udf.mapFlexRows(fbmeta.blob_data, fbmeta.blob_size,
+                                      rids, vals, errmsg);
+                break;
+            case SFT_ARROW: {
+                std::shared_ptr<arrow::Table> table;
+                extract_arrow_from_string(&table, fbmeta.blob_data,
+                                          fbmeta.blob_size);
+                ret = udf.mapArrowRows(table, rids, vals, errmsg);
+                break;
+            }
+            default:
+                CLS_ERR("ERROR: cls_tabular:wasm_query_op: format %d not supported",
+                        fbmeta.blob_format);
+                return -EINVAL;
+        }
+        if (ret != 0) {
+            CLS_ERR("ERROR: WasmUdf %s", errmsg.c_str());
+            CLS_ERR("ERROR: TablesErrCodes::%d", ret);
             return -1;
+        }
     }
 
-    // encode output info for client.
-    outbl_sample_info info;
-    info.message = "All done with example op.";
-    info.rows_processed = rows_processed;
-    info.read_time_ns = read_timer;
-    info.eval_time_ns = func_timer;
-    ::encode(info, *out);
-
-    // encode result data for client.
+    flatbuffers::FlatBufferBuilder result_builder(1024);
+    buildWasmMapFb(result_builder, op.udf.func, op.table_name, rids, vals);
+    flatbuffers::FlatBufferBuilder fbmeta_builder;
+    createFbMeta(&fbmeta_builder,
+                 SFT_FLATBUF_FLEX_ROW,
+                 reinterpret_cast<unsigned char*>(
+                    result_builder.GetBufferPointer()),
+                 result_builder.GetSize());
     bufferlist result_bl;
-    result_bl.append("result data goes into result bl.");
-    ::encode(result_bl, *out);
+    result_bl.append(reinterpret_cast<const char*>(
+                     fbmeta_builder.GetBufferPointer()),
+                     fbmeta_builder.GetSize());
+    uint64_t eval_ns = getns() - eval_start;
+
+    if (op.debug)
+        CLS_LOG(20, "wasm_query_op: %lu rows mapped", rids.size());
 
+    add_query_cpu_load(eval_ns);
+    cls_info info(read_ns, eval_ns, "", "");
+    ::encode(info, *out);
+    ::encode(result_bl, *out);
     return 0;
 }
 
@@ -2415,6 +4004,12 @@ void __cls_init()
   cls_register_cxx_method(h_class, "transform_db_op",
       CLS_METHOD_RD | CLS_METHOD_WR, transform_db_op, &h_transform_db_op);
 
+  cls_register_cxx_method(h_class, "build_rollup_op",
+      CLS_METHOD_RD | CLS_METHOD_WR, build_rollup_op, &h_build_rollup_op);
+
+  cls_register_cxx_method(h_class, "append_fb_op",
+      CLS_METHOD_RD | CLS_METHOD_WR, append_fb_op, &h_append_fb_op);
+
   cls_register_cxx_method(h_class, "lock_obj_init_op",
       CLS_METHOD_PROMOTE | CLS_METHOD_WR, lock_obj_init_op, &h_inittable_group_obj_query_op);
 
@@ -12,7 +12,9 @@
 #ifndef CLS_TABULAR_H
 #define CLS_TABULAR_H
 
+#include <algorithm>
 #include <include/types.h>
+#include "common/bloom_filter.hpp"
 
 
 void cls_log_message(std::string msg, bool is_err, int log_level);
@@ -108,6 +110,188 @@ enum CompressionType {
     // etc.
 };
 
+/*
+ * Semi-join reduction filter over the join key vals of a (filtered)
+ * dimension table, built by the client from the dimension query result and
+ * sent with the fact table query, where the cls drops rows whose join key is
+ * not in the filter before projecting and serializing them.  Keys are in the
+ * canonical form of semiJoinKey(), small builds are sent exactly and larger
+ * builds as a bloom filter, whose false positives are removed by the join.
+ */
+struct semijoin_filter {
+  int key_type;                   // SDT type of the build side key col
+  bool use_bloom;
+  std::vector<std::string> keys;  // exact keys, if !use_bloom
+  bloom_filter bloom;
+
+  semijoin_filter() : key_type(0), use_bloom(false) {}
+
+  size_t size() const {
+    return use_bloom ? bloom.element_count() : keys.size();
+  }
+
+  // serialize the fields into bufferlist to be sent over the wire
+  void encode(bufferlist& bl) const {
+    ENCODE_START(1, 1, bl);
+    ::encode(key_type, bl);
+    ::encode(use_bloom, bl);
+    ::encode(keys, bl);
+    ::encode(bloom, bl);
+    ENCODE_FINISH(bl);
+  }
+
+  // deserialize the fields from the bufferlist into this struct
+  void decode(bufferlist::iterator& bl) {
+    DECODE_START(1, bl);
+    ::decode(key_type, bl);
+    ::decode(use_bloom, bl);
+    ::decode(keys, bl);
+    ::decode(bloom, bl);
+    DECODE_FINISH(bl);
+  }
+
+  std::string toString() const {
+    std::string s;
+    s.append("semijoin_filter:");
+    s.append(" .key_type=" + std::to_string(key_type));
+    s.append(" .use_bloom=" + std::to_string(use_bloom));
+    s.append(" .nkeys=" + std::to_string(size()));
+    if (use_bloom)
+      s.append(" .bloom_bytes=" + std::to_string(bloom.size() / 8));
+    return s;
+  }
+};
+WRITE_CLASS_ENCODER(semijoin_filter)
+
+/*
+ * A WebAssembly user defined function, a filter applied with the query
+ * preds or a map computing a val per row, run within the cls over batches
+ * of the vals of its input cols (see cls_tabular_wasm.h for its interface).
+ * Compiled modules are cached per osd by the hash of the module binary.
+ */
+struct wasm_udf {
+  int type;             // SkyWasmUdfType enum, SWU_NONE if no udf
+  std::string module;   // wasm binary
+  std::string func;     // name of the exported udf
+  std::string cols;     // input col names, comma separated
+  uint64_t fuel;        // max fuel per batch call, 0 for the default
+  uint64_t max_memory;  // max linear memory bytes, 0 for the default
+
+  wasm_udf() : type(0), fuel(0), max_memory(0) {}
+
+  // serialize the fields into bufferlist to be sent over the wire
+  void encode(bufferlist& bl) const {
+    ENCODE_START(1, 1, bl);
+    ::encode(type, bl);
+    ::encode(module, bl);
+    ::encode(func, bl);
+    ::encode(cols, bl);
+    ::encode(fuel, bl);
+    ::encode(max_memory, bl);
+    ENCODE_FINISH(bl);
+  }
+
+  // deserialize the fields from the bufferlist into this struct
+  void decode(bufferlist::iterator& bl) {
+    DECODE_START(1, bl);
+    ::decode(type, bl);
+    ::decode(module, bl);
+    ::decode(func, bl);
+    ::decode(cols, bl);
+    ::decode(fuel, bl);
+    ::decode(max_memory, bl);
+    DECODE_FINISH(bl);
+  }
+
+  std::string toString() const {
+    std::string s;
+    s.append("wasm_udf:");
+    s.append(" .type=" + std::to_string(type));
+    s.append(" .module_bytes=" + std::to_string(module.size()));
+    s.append(" .func=" + func);
+    s.append(" .cols=" + cols);
+    s.append(" .fuel=" + std::to_string(fuel));
+    s.append(" .max_memory=" + std::to_string(max_memory));
+    return s;
+  }
+};
+WRITE_CLASS_ENCODER(wasm_udf)
+
+/*
+ * Layout of a range partitioned table, written by the flatflex writer with
+ * --range_col and stored as the object <oid_prefix>.<table>.partmap.
+ * Partition i holds the rows whose range col val is in
+ * [bounds[i-1], bounds[i]), the first and last partitions are unbounded.
+ * A partition is split into a new subpartition whenever its current object
+ * grows past the writer's split size (or run-query's --split-bytes when
+ * appending fbs), so partition i is stored in the objects
+ * <oid_prefix>.<table>.<i>.<j> for j in [0, nsubparts[i]).
+ * Range col vals are integral, dates as days.
+ */
+struct range_partition_map {
+  std::string col_name;
+  int col_type;
+  std::vector<int64_t> bounds;   // ascending, num partitions - 1
+  std::vector<int> nsubparts;    // per partition
+  uint64_t version;              // incremented on each update
+
+  range_partition_map() : col_type(0), version(0) {}
+
+  int partition(int64_t val) const {
+    return std::upper_bound(bounds.begin(), bounds.end(), val) -
+           bounds.begin();
+  }
+
+  // partitions that may hold rows with range col vals in [lo, hi]
+  std::vector<int> partitions(int64_t lo, int64_t hi) const {
+    std::vector<int> parts;
+    if (lo > hi)
+      return parts;
+    for (int i = partition(lo); i <= partition(hi); i++)
+      parts.push_back(i);
+    return parts;
+  }
+
+  // serialize the fields into bufferlist to be sent over the wire
+  void encode(bufferlist& bl) const {
+    ENCODE_START(1, 1, bl);
+    ::encode(col_name, bl);
+    ::encode(col_type, bl);
+    ::encode(bounds, bl);
+    ::encode(nsubparts, bl);
+    ::encode(version, bl);
+    ENCODE_FINISH(bl);
+  }
+
+  // deserialize the fields from the bufferlist into this struct
+  void decode(bufferlist::iterator& bl) {
+    DECODE_START(1, bl);
+    ::decode(col_name, bl);
+    ::decode(col_type, bl);
+    ::decode(bounds, bl);
+    ::decode(nsubparts, bl);
+    ::decode(version, bl);
+    DECODE_FINISH(bl);
+  }
+
+  std::string toString() const {
+    std::string s;
+    s.append("range_partition_map:");
+    s.append(" .col_name=" + col_name);
+    s.append(" .col_type=" + std::to_string(col_type));
+    s.append(" .nparts=" + std::to_string(nsubparts.size()));
+    s.append(" .bounds=");
+    for (unsigned i = 0; i < bounds.size(); i++)
+      s.append((i ? "," : "") + std::to_string(bounds[i]));
+    s.append(" .nsubparts=");
+    for (unsigned i = 0; i < nsubparts.size(); i++)
+      s.append((i ? "," : "") + std::to_string(nsubparts[i]));
+    s.append(" .version=" + std::to_string(version));
+    return s;
+  }
+};
+WRITE_CLASS_ENCODER(range_partition_map)
+
 /*
  * Stores the query request parameters.  This is encoded by the client and
  * decoded by server (osd node) for query processing.
@@ -134,12 +318,24 @@ struct query_op {
   std::string query_preds;
   std::string index_preds;
   std::string index2_preds;
-
-  query_op() {}
+  std::string query_exprs;  // computed cols, see exprsFromString
+  int pushback_max_inflight;  // decline processing above these osd loads,
+  double pushback_max_cpu;    // 0 disables, see exec_query_op
+  std::string semijoin_col;   // fact table join key col, empty if none
+  semijoin_filter semijoin;
+  std::string query_sort;  // order by keys, see sortKeysFromString
+  int sample_type;         // SkySampleType enum, SST_NONE for a full scan
+  double sample_fraction;  // of the rows or fbs kept
+  uint64_t sample_seed;    // for block sampling also mixed with the oid
+  wasm_udf wasm;           // filter udf, wasm.type SWU_NONE if none
+  std::string plan;  // QueryPlan of the above text fields, see encodeQueryPlan
+
+  query_op() : sample_type(0), sample_fraction(1), sample_seed(0) {}
 
   // serialize the fields into bufferlist to be sent over the wire
   void encode(bufferlist& bl) const {
-    ENCODE_START(1, 1, bl);
+    // older osds would ignore the plan, and its text fields are not sent
+    ENCODE_START(8, plan.empty() ? 1 : 8, bl);
     ::encode(debug, bl);
     ::encode(query, bl);
     ::encode(fastpath, bl);
@@ -159,12 +355,23 @@ struct query_op {
     ::encode(query_preds, bl);
     ::encode(index_preds, bl);
     ::encode(index2_preds, bl);
+    ::encode(query_exprs, bl);
+    ::encode(pushback_max_inflight, bl);
+    ::encode(pushback_max_cpu, bl);
+    ::encode(semijoin_col, bl);
+    ::encode(semijoin, bl);
+    ::encode(query_sort, bl);
+    ::encode(sample_type, bl);
+    ::encode(sample_fraction, bl);
+    ::encode(sample_seed, bl);
+    ::encode(wasm, bl);
+    ::encode(plan, bl);
     ENCODE_FINISH(bl);
   }
 
   // deserialize the fields from the bufferlist into this struct
   void decode(bufferlist::iterator& bl) {
-    DECODE_START(1, bl);
+    DECODE_START(8, bl);
     ::decode(debug, bl);
     ::decode(query, bl);
     ::decode(fastpath, bl);
@@ -184,6 +391,36 @@ struct query_op {
     ::decode(query_preds, bl);
     ::decode(index_preds, bl);
     ::decode(index2_preds, bl);
+    if (struct_v >= 2)
+      ::decode(query_exprs, bl);
+    pushback_max_inflight = 0;
+    pushback_max_cpu = 0;
+    if (struct_v >= 3) {
+      ::decode(pushback_max_inflight, bl);
+      ::decode(pushback_max_cpu, bl);
+    }
+    semijoin_col.clear();
+    if (struct_v >= 4) {
+      ::decode(semijoin_col, bl);
+      ::decode(semijoin, bl);
+    }
+    query_sort.clear();
+    if (struct_v >= 5)
+      ::decode(query_sort, bl);
+    sample_type = 0;
+    sample_fraction = 1;
+    sample_seed = 0;
+    if (struct_v >= 6) {
+      ::decode(sample_type, bl);
+      ::decode(sample_fraction, bl);
+      ::decode(sample_seed, bl);
+    }
+    wasm = wasm_udf();
+    if (struct_v >= 7)
+      ::decode(wasm, bl);
+    plan.clear();
+    if (struct_v >= 8)
+      ::decode(plan, bl);
     DECODE_FINISH(bl);
   }
 
@@ -207,6 +444,19 @@ struct query_op {
     s.append(" .query_preds=" + query_preds);
     s.append(" .index_preds=" + index_preds);
     s.append(" .index2_preds=" + index2_preds);
+    s.append(" .query_exprs=" + query_exprs);
+    s.append(" .pushback_max_inflight=" + std::to_string(pushback_max_inflight));
+    s.append(" .pushback_max_cpu=" + std::to_string(pushback_max_cpu));
+    s.append(" .semijoin_col=" + semijoin_col);
+    if (!semijoin_col.empty())
+      s.append(" .semijoin=" + semijoin.toString());
+    s.append(" .query_sort=" + query_sort);
+    s.append(" .sample_type=" + std::to_string(sample_type));
+    s.append(" .sample_fraction=" + std::to_string(sample_fraction));
+    s.append(" .sample_seed=" + std::to_string(sample_seed));
+    if (wasm.type)
+      s.append(" .wasm=" + wasm.toString());
+    s.append(" .plan.size=" + std::to_string(plan.size()));
     return s;
   }
 };
@@ -339,26 +589,34 @@ struct transform_op {
   std::string table_name;
   std::string query_schema;
   int required_type;
+  bool col_chunks;  // SFT_ARROW only, store each col as a separate extent
 
-  transform_op() {}
-  transform_op(std::string tname, std::string qrscma, int req_type) :
-    table_name(tname), query_schema(qrscma), required_type(req_type) { }
+  transform_op() : col_chunks(false) {}
+  transform_op(std::string tname, std::string qrscma, int req_type,
+               bool colchunks=false) :
+    table_name(tname), query_schema(qrscma), required_type(req_type),
+    col_chunks(colchunks) { }
 
   // serialize the fields into bufferlist to be sent over the wire
   void encode(bufferlist& bl) const {
-    ENCODE_START(1, 1, bl);
+    ENCODE_START(2, 1, bl);
     ::encode(table_name, bl);
     ::encode(query_schema, bl);
     ::encode(required_type, bl);
+    ::encode(col_chunks, bl);
     ENCODE_FINISH(bl);
   }
 
   // deserialize the fields from the bufferlist into this struct
   void decode(bufferlist::iterator& bl) {
-    DECODE_START(1, bl);
+    DECODE_START(2, bl);
     ::decode(table_name, bl);
     ::decode(query_schema, bl);
     ::decode(required_type, bl);
+    if (struct_v >= 2)
+      ::decode(col_chunks, bl);
+    else
+      col_chunks = false;
     DECODE_FINISH(bl);
   }
 
@@ -368,6 +626,7 @@ struct transform_op {
     s.append(" .table_name=" + table_name);
     s.append(" .query_schema=" + query_schema);
     s.append(" .required_type=" + std::to_string(required_type));
+    s.append(" .col_chunks=" + std::to_string(col_chunks));
     return s;
   }
 };
@@ -522,12 +781,17 @@ WRITE_CLASS_ENCODER(idx_fb_entry)
 
 // holds an omap entry for indexed col values
 // this index entry type contains logical location info
-// idx_key = idx_prefix + column data value(s) (ints)
+// idx_key = idx_prefix + column data value(s)
 // val = this struct containing to LOGICAL location of row within an fb
+// for covering indexes (see idx_op.idx_include_str) the entry also holds
+// the row's vals of the index and include cols, as a flexbuf row of the
+// data schema width with nulls for the other cols, plus its nullbits.
 struct idx_rec_entry {
     uint32_t fb_num;
     uint32_t row_num;
     uint64_t rid;
+    std::string cols_data;
+    std::vector<uint64_t> nullbits;
 
     idx_rec_entry() {}
     idx_rec_entry(uint32_t fb, uint32_t row, uint64_t rec_id) :
@@ -536,18 +800,24 @@ struct idx_rec_entry {
             rid(rec_id){}
 
     void encode(bufferlist& bl) const {
-        ENCODE_START(1, 1, bl);
+        ENCODE_START(2, 1, bl);
         ::encode(fb_num, bl);
         ::encode(row_num, bl);
         ::encode(rid, bl);
+        ::encode(cols_data, bl);
+        ::encode(nullbits, bl);
         ENCODE_FINISH(bl);
     }
 
     void decode(bufferlist::iterator& bl) {
-        DECODE_START(1, bl);
+        DECODE_START(2, bl);
         ::decode(fb_num, bl);
         ::decode(row_num, bl);
         ::decode(rid, bl);
+        if (struct_v >= 2) {
+            ::decode(cols_data, bl);
+            ::decode(nullbits, bl);
+        }
         DECODE_FINISH(bl);
     }
 
@@ -556,6 +826,8 @@ struct idx_rec_entry {
         s.append("idx_rec_entry.fb_num=" + std::to_string(fb_num));
         s.append("; idx_rec_entry.row_num=" + std::to_string(row_num));
         s.append("; idx_rec_entry.rid=" + std::to_string(rid));
+        s.append("; idx_rec_entry.cols_data.size=" +
+                 std::to_string(cols_data.size()));
         return s;
     }
 };
@@ -615,37 +887,43 @@ struct idx_op {
     int idx_type;
     std::string idx_schema_str;
     std::string idx_text_delims; // for text indexing
+    std::string idx_include_str; // IDX_REC only, cols stored in the entries
 
     idx_op() {}
     idx_op(bool unq, bool ign, int batsz, int index_type,
-           std::string schema_str, std::string delimiters) :
+           std::string schema_str, std::string delimiters,
+           std::string include_str="") :
         idx_unique(unq),
         idx_ignore_stopwords(ign),
         idx_batch_size(batsz),
         idx_type(index_type),
         idx_schema_str(schema_str),
-        idx_text_delims(delimiters) {}
+        idx_text_delims(delimiters),
+        idx_include_str(include_str) {}
 
     void encode(bufferlist& bl) const {
-        ENCODE_START(1, 1, bl);
+        ENCODE_START(2, 1, bl);
         ::encode(idx_unique, bl);
         ::encode(idx_ignore_stopwords, bl);
         ::encode(idx_batch_size, bl);
         ::encode(idx_type, bl);
         ::encode(idx_schema_str, bl);
         ::encode(idx_text_delims, bl);
+        ::encode(idx_include_str, bl);
         ENCODE_FINISH(bl);
     }
 
     void decode(bufferlist::iterator& bl) {
         std::string s;
-        DECODE_START(1, bl);
+        DECODE_START(2, bl);
         ::decode(idx_unique, bl);
         ::decode(idx_ignore_stopwords, bl);
         ::decode(idx_batch_size, bl);
         ::decode(idx_type, bl);
         ::decode(idx_schema_str, bl);
         ::decode(idx_text_delims, bl);
+        if (struct_v >= 2)
+            ::decode(idx_include_str, bl);
         DECODE_FINISH(bl);
     }
 
@@ -658,6 +936,7 @@ struct idx_op {
         s.append("; idx_op.idx_type=" + std::to_string(idx_type));
         s.append("; idx_op.idx_schema_str=\n" + idx_schema_str);
         s.append("; idx_op.text_delims=\n" + idx_text_delims);
+        s.append("; idx_op.idx_include_str=\n" + idx_include_str);
         return s;
     }
 };
@@ -763,121 +1042,187 @@ struct col_stats {
 };
 WRITE_CLASS_ENCODER(col_stats)
 
-// Example struct to store and serialize read/write info
-// for custom cls class methods
-struct inbl_sample_op {
+/*
+ * ROLLUPS: pre-aggregated sum/cnt/min/max aggs of a table per group of
+ * group col vals, kept in the omap of each obj.  A rollup is built over the
+ * fbs of the obj (build_rollup_op) then updated with each fb appended by
+ * append_fb_op.  exec_query_op answers a global agg query from a rollup with
+ * its aggs if the other query preds are all on its group cols, as long as
+ * the rollup covers the whole obj (its fb_seq and obj_size are current).
+ */
+struct rollup_op {
 
-  std::string message;
-  std::string instructions;
-  int counter;
-  int func_id;
+  bool debug;
+  std::string db_schema_name;
+  std::string table_name;
+  std::string data_schema;
+  std::string name;
+  std::string group_cols;  // col names, e.g., "returnflag,linestatus"
+  std::string agg_preds;   // preds format, e.g., "quantity,sum,0;quantity,cnt,0"
 
-  inbl_sample_op() {}
-  inbl_sample_op(
-    std::string _message,
-    std::string _instructions,
-    int _counter,
-    int _func_id)
-    :
-    message(_message),
-    instructions(_instructions),
-    counter(_counter),
-    func_id(_func_id) { }
+  rollup_op() : debug(false) {}
+  rollup_op(bool dbg, std::string dbscma, std::string tname,
+            std::string dtscma, std::string rname, std::string gcols,
+            std::string aggs) :
+    debug(dbg), db_schema_name(dbscma), table_name(tname),
+    data_schema(dtscma), name(rname), group_cols(gcols), agg_preds(aggs) { }
 
   // serialize the fields into bufferlist to be sent over the wire
   void encode(bufferlist& bl) const {
     ENCODE_START(1, 1, bl);
-    ::encode(message, bl);
-    ::encode(instructions, bl);
-    ::encode(counter, bl);
-    ::encode(func_id, bl);
+    ::encode(debug, bl);
+    ::encode(db_schema_name, bl);
+    ::encode(table_name, bl);
+    ::encode(data_schema, bl);
+    ::encode(name, bl);
+    ::encode(group_cols, bl);
+    ::encode(agg_preds, bl);
     ENCODE_FINISH(bl);
   }
 
   // deserialize the fields from the bufferlist into this struct
   void decode(bufferlist::iterator& bl) {
     DECODE_START(1, bl);
-    ::decode(message, bl);
-    ::decode(instructions, bl);
-    ::decode(counter, bl);
-    ::decode(func_id, bl);
+    ::decode(debug, bl);
+    ::decode(db_schema_name, bl);
+    ::decode(table_name, bl);
+    ::decode(data_schema, bl);
+    ::decode(name, bl);
+    ::decode(group_cols, bl);
+    ::decode(agg_preds, bl);
     DECODE_FINISH(bl);
   }
 
   std::string toString() {
     std::string s;
-    s.append("inbl_sample_op:");
-    s.append(" .message=" + message);
-    s.append(" .instructions=" + instructions);
-    s.append(" .counter=" + std::to_string(counter));
-    s.append(" .func_id=" + std::to_string(func_id));
+    s.append("rollup_op:");
+    s.append(" .debug=" + std::to_string(debug));
+    s.append(" .db_schema_name=" + db_schema_name);
+    s.append(" .table_name=" + table_name);
+    s.append(" .data_schema=" + data_schema);
+    s.append(" .name=" + name);
+    s.append(" .group_cols=" + group_cols);
+    s.append(" .agg_preds=" + agg_preds);
     return s;
   }
 };
-WRITE_CLASS_ENCODER(inbl_sample_op)
+WRITE_CLASS_ENCODER(rollup_op)
 
-// Example struct to store and serialize output info that
-// can be returned from custom cls class read/write methods.
-struct outbl_sample_info {
+// omap val of a rollup, the partial agg row of each group (as returned by
+// exec_query_op for an fb, see mergeAggRows) keyed by its group col vals.
+struct rollup_info {
 
-  std::string message;
-  int rows_processed;
-  uint64_t read_time_ns;
-  uint64_t eval_time_ns;
+  std::string data_schema;  // of the fbs, the group cols and aggs refer to it
+  std::string group_cols;
+  std::string agg_preds;
+  uint32_t fb_seq;    // num of fbs covered
+  uint64_t obj_size;  // obj bytes covered, stale if not the obj size
+  std::map<std::string, std::string> groups;
 
-  outbl_sample_info() {}
-  outbl_sample_info(
-    std::string _message,
-    int _rows_processed,
-    uint64_t _read_time_ns,
-    uint64_t _eval_time_ns)
-    :
-    message(_message),
-    rows_processed(_rows_processed),
-    read_time_ns(_read_time_ns),
-    eval_time_ns(_eval_time_ns) { }
+  rollup_info() : fb_seq(0), obj_size(0) {}
 
   // serialize the fields into bufferlist to be sent over the wire
   void encode(bufferlist& bl) const {
     ENCODE_START(1, 1, bl);
-    ::encode(message, bl);
-    ::encode(rows_processed, bl);
-    ::encode(read_time_ns, bl);
-    ::encode(eval_time_ns, bl);
+    ::encode(data_schema, bl);
+    ::encode(group_cols, bl);
+    ::encode(agg_preds, bl);
+    ::encode(fb_seq, bl);
+    ::encode(obj_size, bl);
+    ::encode(groups, bl);
     ENCODE_FINISH(bl);
   }
 
   // deserialize the fields from the bufferlist into this struct
   void decode(bufferlist::iterator& bl) {
     DECODE_START(1, bl);
-    ::decode(message, bl);
-    ::decode(rows_processed, bl);
-    ::decode(read_time_ns, bl);
-    ::decode(eval_time_ns, bl);
+    ::decode(data_schema, bl);
+    ::decode(group_cols, bl);
+    ::decode(agg_preds, bl);
+    ::decode(fb_seq, bl);
+    ::decode(obj_size, bl);
+    ::decode(groups, bl);
     DECODE_FINISH(bl);
   }
 
   std::string toString() {
     std::string s;
-    s.append("outbl_sample_info:");
-    s.append(" .message=" + message);
-    s.append(" .rows_processed=" + rows_processed);
-    s.append(" .read_time_ns=" + std::to_string(read_time_ns));
-    s.append(" .eval_time_ns=" + std::to_string(eval_time_ns));
+    s.append("rollup_info:");
+    s.append(" .group_cols=" + group_cols);
+    s.append(" .agg_preds=" + agg_preds);
+    s.append(" .fb_seq=" + std::to_string(fb_seq));
+    s.append(" .obj_size=" + std::to_string(obj_size));
+    s.append(" .groups=" + std::to_string(groups.size()));
     return s;
   }
 };
-WRITE_CLASS_ENCODER(outbl_sample_info)
+WRITE_CLASS_ENCODER(rollup_info)
 
-struct wasm_inbl_sample_op {
+// fbs appended to an obj by append_fb_op, which also updates the obj's
+// rollups of the table.
+struct append_op {
+
+  bool debug;
+  std::string db_schema_name;
+  std::string table_name;
+  bufferlist data;  // seq of encoded fbmeta bls, as stored in the obj
+  uint64_t max_obj_size;  // refuse to grow a non-empty obj past it, 0 if none
+
+  append_op() : debug(false), max_obj_size(0) {}
+  append_op(bool dbg, std::string dbscma, std::string tname, bufferlist bl,
+            uint64_t max_size=0) :
+    debug(dbg), db_schema_name(dbscma), table_name(tname), data(bl),
+    max_obj_size(max_size) { }
+
+  // serialize the fields into bufferlist to be sent over the wire
+  void encode(bufferlist& bl) const {
+    ENCODE_START(2, 1, bl);
+    ::encode(debug, bl);
+    ::encode(db_schema_name, bl);
+    ::encode(table_name, bl);
+    ::encode(data, bl);
+    ::encode(max_obj_size, bl);
+    ENCODE_FINISH(bl);
+  }
+
+  // deserialize the fields from the bufferlist into this struct
+  void decode(bufferlist::iterator& bl) {
+    DECODE_START(2, bl);
+    ::decode(debug, bl);
+    ::decode(db_schema_name, bl);
+    ::decode(table_name, bl);
+    ::decode(data, bl);
+    if (struct_v >= 2)
+      ::decode(max_obj_size, bl);
+    else
+      max_obj_size = 0;
+    DECODE_FINISH(bl);
+  }
+
+  std::string toString() {
+    std::string s;
+    s.append("append_op:");
+    s.append(" .debug=" + std::to_string(debug));
+    s.append(" .db_schema_name=" + db_schema_name);
+    s.append(" .table_name=" + table_name);
+    s.append(" .data.length=" + std::to_string(data.length()));
+    s.append(" .max_obj_size=" + std::to_string(max_obj_size));
+    return s;
+  }
+};
+WRITE_CLASS_ENCODER(append_op)
+
+// Example struct to store and serialize read/write info
+// for custom cls class methods
+struct inbl_sample_op {
 
   std::string message;
   std::string instructions;
   int counter;
   int func_id;
 
-  wasm_inbl_sample_op() {}
-  wasm_inbl_sample_op(
+  inbl_sample_op() {}
+  inbl_sample_op(
     std::string _message,
     std::string _instructions,
     int _counter,
@@ -918,19 +1263,19 @@ struct wasm_inbl_sample_op {
     return s;
   }
 };
-WRITE_CLASS_ENCODER(wasm_inbl_sample_op)
+WRITE_CLASS_ENCODER(inbl_sample_op)
 
 // Example struct to store and serialize output info that
 // can be returned from custom cls class read/write methods.
-struct wasm_outbl_sample_info {
+struct outbl_sample_info {
 
   std::string message;
   int rows_processed;
   uint64_t read_time_ns;
   uint64_t eval_time_ns;
 
-  wasm_outbl_sample_info() {}
-  wasm_outbl_sample_info(
+  outbl_sample_info() {}
+  outbl_sample_info(
     std::string _message,
     int _rows_processed,
     uint64_t _read_time_ns,
@@ -971,7 +1316,50 @@ struct wasm_outbl_sample_info {
     return s;
   }
 };
-WRITE_CLASS_ENCODER(wasm_outbl_sample_info)
+WRITE_CLASS_ENCODER(outbl_sample_info)
+
+// Stores the params of a wasm udf run over all the rows of an object, see
+// wasm_query_op.  Map udf vals are returned as a table of RID,val rows.
+struct wasm_udf_op {
+
+  bool debug;
+  std::string table_name;
+  std::string data_schema;
+  wasm_udf udf;
+
+  wasm_udf_op() : debug(false) {}
+
+  // serialize the fields into bufferlist to be sent over the wire
+  void encode(bufferlist& bl) const {
+    ENCODE_START(1, 1, bl);
+    ::encode(debug, bl);
+    ::encode(table_name, bl);
+    ::encode(data_schema, bl);
+    ::encode(udf, bl);
+    ENCODE_FINISH(bl);
+  }
+
+  // deserialize the fields from the bufferlist into this struct
+  void decode(bufferlist::iterator& bl) {
+    DECODE_START(1, bl);
+    ::decode(debug, bl);
+    ::decode(table_name, bl);
+    ::decode(data_schema, bl);
+    ::decode(udf, bl);
+    DECODE_FINISH(bl);
+  }
+
+  std::string toString() {
+    std::string s;
+    s.append("wasm_udf_op:");
+    s.append(" .debug=" + std::to_string(debug));
+    s.append(" .table_name=" + table_name);
+    s.append(" .data_schema=" + data_schema);
+    s.append(" .udf=" + udf.toString());
+    return s;
+  }
+};
+WRITE_CLASS_ENCODER(wasm_udf_op)
 
 // Custom op struct for HEP data queries.
 struct hep_op {
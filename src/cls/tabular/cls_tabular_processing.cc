@@ -8,6 +8,8 @@
 *
 */
 
+#include <queue>
+
 #include "cls_tabular_processing.h"
 
 
@@ -37,13 +39,49 @@ int processSkyFb(
     const char* dataptr,
     const size_t datasz,
     std::string& errmsg,
-    const std::vector<uint32_t>& row_nums)
+    const std::vector<uint32_t>& row_nums,
+    const expr_vec& exprs,
+    const sort_vec& sort_keys)
 {
     int errcode = 0;
     delete_vector dead_rows;
     std::vector<flatbuffers::Offset<Tables::Record>> offs;
     sky_root root = getSkyRoot(dataptr, datasz, SFT_FLATBUF_FLEX_ROW);
 
+    // dictionary encoded cols (see getSkyDicts), preds over them are applied
+    // to the codes and their projected codes are returned still encoded, with
+    // their dicts. aggs and sort keys over them need the vals, so then the
+    // fb is decoded first.
+    flexbuffers::Vector dicts = getSkyDicts(dataptr);
+    auto is_dict_col = [&](int idx) {
+        return idx >= 0 and idx < static_cast<int>(dicts.size()) and
+               dicts[idx].IsVector();
+    };
+    if (dicts.size() > 0) {
+        bool need_vals = false;
+        for (auto it = preds.begin(); it != preds.end(); ++it) {
+            if ((*it)->isGlobalAgg() and is_dict_col((*it)->colIdx()))
+                need_vals = true;
+        }
+        for (auto it = sort_keys.begin(); it != sort_keys.end(); ++it) {
+            if (is_dict_col(it->col.idx))
+                need_vals = true;
+        }
+        if (need_vals) {
+            flatbuffers::FlatBufferBuilder decoded(datasz);
+            errcode = decodeSkyDicts(dataptr, datasz, decoded, errmsg);
+            if (errcode != 0)
+                return errcode;
+            return processSkyFb(flatbldr, data_schema, query_schema, preds,
+                    reinterpret_cast<const char*>(decoded.GetBufferPointer()),
+                    decoded.GetSize(), errmsg, row_nums, exprs, sort_keys);
+        }
+    }
+
+    // the preds applied to each row, with those over encoded cols rewritten
+    // once for this fb's dicts.
+    predicate_vec row_preds = dictPredicates(preds, dicts);
+
     // identify the max col idx, to prevent flexbuf vector oob error
     int col_idx_max = -1;
     for (auto it=data_schema.begin(); it!=data_schema.end(); ++it) {
@@ -51,6 +89,13 @@ int processSkyFb(
             col_idx_max = it->idx;
     }
 
+    // computed cols follow the data cols, they are evaluated per row
+    int expr_idx_min = col_idx_max + 1;
+    if (!exprs.empty()) {
+        expr_idx_min = exprs.front().col.idx;
+        col_idx_max = std::max(col_idx_max, exprs.back().col.idx);
+    }
+
     bool project_all = std::equal(data_schema.begin(), data_schema.end(),
                                   query_schema.begin(), compareColInfo);
 
@@ -60,6 +105,13 @@ int processSkyFb(
     if (hasAggPreds(preds)) encode_aggs = true;
     bool encode_rows = !encode_aggs;
 
+    // order by keys of each encoded row, result rows are sorted below
+    sort_cols sort_vals;
+    if (encode_rows) {
+        for (auto it = sort_keys.begin(); it != sort_keys.end(); ++it)
+            sort_vals.push_back(sort_col(*it));
+    }
+
     // determines if we process specific rows or all rows, since
     // row_nums vector is optional parameter - default process all rows.
     bool process_all_rows = true;
@@ -81,6 +133,7 @@ int processSkyFb(
         if (rnum > root.nrows) {
             errmsg += "ERROR: rnum(" + std::to_string(rnum) +
                       ") > root.nrows(" + to_string(root.nrows) + ")";
+            deleteDictPredicates(row_preds);
             return RowIndexOOB;
         }
 
@@ -91,8 +144,8 @@ int processSkyFb(
         sky_rec rec = getSkyRec(static_cast<row_offs>(root.data_vec)->Get(rnum));
 
         // apply predicates to this record
-        if (!preds.empty()) {
-            bool pass = applyPredicates(preds, rec);
+        if (!row_preds.empty()) {
+            bool pass = applyPredicates(row_preds, rec, exprs);
             if (!pass) continue;  // skip non matching rows.
         }
 
@@ -110,6 +163,20 @@ int processSkyFb(
 
         // build the return projection for this row.
         auto row = rec.data.AsVector();
+        for (unsigned k = 0; k < sort_vals.size(); k++) {
+            const col_info& kc = sort_keys[k].col;
+            if (kc.idx >= expr_idx_min) {
+                const expr_info& ei = exprs.at(kc.idx - expr_idx_min);
+                if (ei.col.type == SDT_DOUBLE)
+                    sortColAddNorm(sort_vals[k], sortNormDouble(
+                        evalArithExprDouble(ei.expr, row)));
+                else
+                    sortColAddNorm(sort_vals[k], sortNormInt(
+                        evalArithExprInt(ei.expr, row)));
+            } else {
+                sortColAddFlex(sort_vals[k], row[kc.idx], kc.type);
+            }
+        }
         flexbuffers::Builder *flexbldr = new flexbuffers::Builder();
         flatbuffers::Offset<flatbuffers::Vector<unsigned char>> datavec;
 
@@ -126,6 +193,15 @@ int processSkyFb(
                             std::to_string(rec.RID) + " col.idx=" +
                             std::to_string(col.idx) + " OOB.");
 
+                } else if (col.idx >= expr_idx_min) {
+
+                    // computed col, encode its expr val for this row
+                    const expr_info& ei = exprs.at(col.idx - expr_idx_min);
+                    if (ei.col.type == SDT_DOUBLE)
+                        flexbldr->Add(evalArithExprDouble(ei.expr, row));
+                    else
+                        flexbldr->Add(evalArithExprInt(ei.expr, row));
+
                 } else {
 
                     switch(col.type) {  // encode data val into flexbuf
@@ -170,10 +246,28 @@ int processSkyFb(
                             flexbldr->Add(row[col.idx].AsDouble());
                             break;
                         case SDT_DATE:
-                            flexbldr->Add(row[col.idx].AsString().str());
+                            flexbldr->Add(flexDateToDays(row[col.idx]));
                             break;
                         case SDT_STRING:
-                            flexbldr->Add(row[col.idx].AsString().str());
+                            if (is_dict_col(col.idx))
+                                flexbldr->Add(row[col.idx].AsUInt64());
+                            else
+                                flexbldr->Add(row[col.idx].AsString().str());
+                            break;
+                        case SDT_JAGGEDARRAY_BOOL:
+                        case SDT_JAGGEDARRAY_CHAR:
+                        case SDT_JAGGEDARRAY_UCHAR:
+                        case SDT_JAGGEDARRAY_INT8:
+                        case SDT_JAGGEDARRAY_INT16:
+                        case SDT_JAGGEDARRAY_INT32:
+                        case SDT_JAGGEDARRAY_INT64:
+                        case SDT_JAGGEDARRAY_UINT8:
+                        case SDT_JAGGEDARRAY_UNT16:
+                        case SDT_JAGGEDARRAY_UINT32:
+                        case SDT_JAGGEDARRAY_UINT64:
+                        case SDT_JAGGEDARRAY_FLOAT:
+                        case SDT_JAGGEDARRAY_DOUBLE:
+                            flexAddJaggedVal(*flexbldr, row[col.idx], col.type);
                             break;
                         default: {
                             errcode = TablesErrCodes::UnsupportedSkyDataType;
@@ -205,6 +299,18 @@ int processSkyFb(
         offs.push_back(row_off);
     }
 
+    // order the result rows, the client merges the sorted results
+    // of each object.
+    if (!sort_vals.empty() and offs.size() > 1) {
+        std::vector<uint32_t> perm;
+        sortPermutation(sort_vals, perm);
+        std::vector<flatbuffers::Offset<Tables::Record>> sorted_offs;
+        sorted_offs.reserve(offs.size());
+        for (auto it = perm.begin(); it != perm.end(); ++it)
+            sorted_offs.push_back(offs[*it]);
+        offs.swap(sorted_offs);
+    }
+
     // here we build the return flatbuf result with agg values that were
     // accumulated above in applyPredicates (agg predicates do not return
     // true false but update their internal values each time processed
@@ -217,13 +323,69 @@ int processSkyFb(
                 // assumes preds appear in same order as return schema
                 if (!(*itp)->isGlobalAgg()) continue;
                 pb = *itp;
+                if (isSketchAgg(pb->opType())) {
+                    // partial state, merged by the client
+                    SketchPredicate* p = dynamic_cast<SketchPredicate*>(pb);
+                    std::string state = p->state();
+                    flexbldr->Blob(state.data(), state.size());
+                    p->resetAgg();
+                    continue;
+                }
                 switch(pb->colType()) {  // encode agg data val into flexbuf
                     case SDT_INT64: {
                         TypedPredicate<int64_t>* p = \
                                 dynamic_cast<TypedPredicate<int64_t>*>(pb);
                         int64_t agg_val = p->Val();
                         flexbldr->Add(agg_val);
-                        p->updateAgg(0);  // reset accumulated add val
+                        p->resetAgg();  // restore the initial agg val
+                        break;
+                    }
+                    case SDT_INT8: {
+                        TypedPredicate<int8_t>* p = \
+                                dynamic_cast<TypedPredicate<int8_t>*>(pb);
+                        int8_t agg_val = p->Val();
+                        flexbldr->Add(agg_val);
+                        p->resetAgg();  // restore the initial agg val
+                        break;
+                    }
+                    case SDT_INT16: {
+                        TypedPredicate<int16_t>* p = \
+                                dynamic_cast<TypedPredicate<int16_t>*>(pb);
+                        int16_t agg_val = p->Val();
+                        flexbldr->Add(agg_val);
+                        p->resetAgg();  // restore the initial agg val
+                        break;
+                    }
+                    case SDT_INT32: {
+                        TypedPredicate<int32_t>* p = \
+                                dynamic_cast<TypedPredicate<int32_t>*>(pb);
+                        int32_t agg_val = p->Val();
+                        flexbldr->Add(agg_val);
+                        p->resetAgg();  // restore the initial agg val
+                        break;
+                    }
+                    case SDT_UINT8: {
+                        TypedPredicate<uint8_t>* p = \
+                                dynamic_cast<TypedPredicate<uint8_t>*>(pb);
+                        uint8_t agg_val = p->Val();
+                        flexbldr->Add(agg_val);
+                        p->resetAgg();  // restore the initial agg val
+                        break;
+                    }
+                    case SDT_UINT16: {
+                        TypedPredicate<uint16_t>* p = \
+                                dynamic_cast<TypedPredicate<uint16_t>*>(pb);
+                        uint16_t agg_val = p->Val();
+                        flexbldr->Add(agg_val);
+                        p->resetAgg();  // restore the initial agg val
+                        break;
+                    }
+                    case SDT_DATE: {
+                        TypedPredicate<int32_t>* p = \
+                                dynamic_cast<TypedPredicate<int32_t>*>(pb);
+                        int32_t agg_val = p->Val();
+                        flexbldr->Add(agg_val);
+                        p->resetAgg();  // restore the initial agg val
                         break;
                     }
                     case SDT_UINT32: {
@@ -231,7 +393,7 @@ int processSkyFb(
                                 dynamic_cast<TypedPredicate<uint32_t>*>(pb);
                         uint32_t agg_val = p->Val();
                         flexbldr->Add(agg_val);
-                        p->updateAgg(0);  // reset accumulated add val
+                        p->resetAgg();  // restore the initial agg val
                         break;
                     }
                     case SDT_UINT64: {
@@ -239,7 +401,7 @@ int processSkyFb(
                                 dynamic_cast<TypedPredicate<uint64_t>*>(pb);
                         uint64_t agg_val = p->Val();
                         flexbldr->Add(agg_val);
-                        p->updateAgg(0);  // reset accumulated add val
+                        p->resetAgg();  // restore the initial agg val
                         break;
                     }
                     case SDT_FLOAT: {
@@ -247,7 +409,7 @@ int processSkyFb(
                                 dynamic_cast<TypedPredicate<float>*>(pb);
                         float agg_val = p->Val();
                         flexbldr->Add(agg_val);
-                        p->updateAgg(0);  // reset accumulated add val
+                        p->resetAgg();  // restore the initial agg val
                         break;
                     }
                     case SDT_DOUBLE: {
@@ -255,7 +417,7 @@ int processSkyFb(
                                 dynamic_cast<TypedPredicate<double>*>(pb);
                         double agg_val = p->Val();
                         flexbldr->Add(agg_val);
-                        p->updateAgg(0);  // reset accumulated add val
+                        p->resetAgg();  // restore the initial agg val
                         break;
                     }
                     default:  assert(UnsupportedAggDataType==0);
@@ -281,6 +443,39 @@ int processSkyFb(
         offs.push_back(row_off);
     }
 
+    deleteDictPredicates(row_preds);
+
+    // the dicts of the projected encoded cols, at their result row positions
+    flatbuffers::Offset<flatbuffers::Vector<uint8_t>> dicts_v = 0;
+    bool project_dicts = false;
+    if (encode_rows) {
+        for (auto it = query_schema.begin(); it != query_schema.end(); ++it) {
+            if (is_dict_col(it->idx))
+                project_dicts = true;
+        }
+    }
+    if (project_dicts) {
+        flexbuffers::Builder dictbldr;
+        dictbldr.Vector([&]() {
+            for (auto it = query_schema.begin();
+                      it != query_schema.end(); ++it) {
+                if (!is_dict_col(it->idx)) {
+                    dictbldr.Null();
+                    continue;
+                }
+                auto dict = dicts[it->idx].AsVector();
+                dictbldr.Vector([&]() {
+                    for (size_t c = 0; c < dict.size(); c++) {
+                        auto str = dict[c].AsString();
+                        dictbldr.String(str.c_str(), str.length());
+                    }
+                });
+            }
+        });
+        dictbldr.Finish();
+        dicts_v = flatbldr.CreateVector(dictbldr.GetBuffer());
+    }
+
     // now build the return ROOT flatbuf wrapper
     std::string query_schema_str;
     for (auto it = query_schema.begin(); it != query_schema.end(); ++it) {
@@ -304,7 +499,8 @@ int processSkyFb(
         table_name,
         delete_v,
         rows_v,
-        offs.size());
+        offs.size(),
+        dicts_v);
 
     // NOTE: the fb may be incomplete/empty, but must finish() else internal
     // fb lib assert finished() fails, hence we must always return a valid fb
@@ -315,6 +511,506 @@ int processSkyFb(
 }
 
 
+// gather the selected rows of a primitive arrow column into builder with a
+// single bulk append, nulls are only materialized if the col is nullable.
+template <typename ArrayType, typename BuilderType>
+static void takeArrowColVals(std::shared_ptr<arrow::Array> col_array,
+                             const std::vector<uint32_t>& rows,
+                             bool nullable,
+                             arrow::ArrayBuilder* builder)
+{
+    auto arr = std::static_pointer_cast<ArrayType>(col_array);
+    auto bldr = static_cast<BuilderType*>(builder);
+    const auto* vals = arr->raw_values();
+    std::vector<typename BuilderType::value_type> out(rows.size());
+    for (size_t i = 0; i < rows.size(); i++)
+        out[i] = vals[rows[i]];
+
+    if (nullable && arr->null_count() > 0) {
+        std::vector<uint8_t> valid(rows.size());
+        for (size_t i = 0; i < rows.size(); i++)
+            valid[i] = !arr->IsNull(rows[i]);
+        bldr->AppendValues(out.data(), out.size(), valid.data());
+    }
+    else {
+        bldr->AppendValues(out.data(), out.size());
+    }
+}
+
+static void takeArrowColBools(std::shared_ptr<arrow::Array> col_array,
+                              const std::vector<uint32_t>& rows,
+                              bool nullable,
+                              arrow::ArrayBuilder* builder)
+{
+    auto arr = std::static_pointer_cast<arrow::BooleanArray>(col_array);
+    auto bldr = static_cast<arrow::BooleanBuilder*>(builder);
+    std::vector<uint8_t> out(rows.size());
+    for (size_t i = 0; i < rows.size(); i++)
+        out[i] = arr->Value(rows[i]);
+
+    if (nullable && arr->null_count() > 0) {
+        std::vector<uint8_t> valid(rows.size());
+        for (size_t i = 0; i < rows.size(); i++)
+            valid[i] = !arr->IsNull(rows[i]);
+        bldr->AppendValues(out.data(), out.size(), valid.data());
+    }
+    else {
+        bldr->AppendValues(out.data(), out.size());
+    }
+}
+
+static void takeArrowColStrings(std::shared_ptr<arrow::Array> col_array,
+                                const std::vector<uint32_t>& rows,
+                                bool nullable,
+                                arrow::ArrayBuilder* builder)
+{
+    auto arr = std::static_pointer_cast<arrow::StringArray>(col_array);
+    auto bldr = static_cast<arrow::StringBuilder*>(builder);
+
+    // size the offsets and data buffers once for all selected rows.
+    int64_t nbytes = 0;
+    for (size_t i = 0; i < rows.size(); i++)
+        nbytes += arr->value_length(rows[i]);
+    bldr->Reserve(rows.size());
+    bldr->ReserveData(nbytes);
+
+    bool check_nulls = nullable && arr->null_count() > 0;
+    for (size_t i = 0; i < rows.size(); i++) {
+        if (check_nulls && arr->IsNull(rows[i])) {
+            bldr->AppendNull();
+            continue;
+        }
+        int32_t len = 0;
+        const uint8_t* val = arr->GetValue(rows[i], &len);
+        bldr->Append(val, len);
+    }
+}
+
+// gather the selected rows of a list (jagged array) column, copying each
+// row's values as a contiguous slice of the child array, with the validity
+// of the values if any are null.
+template <typename ArrayType, typename BuilderType>
+static void takeArrowColLists(std::shared_ptr<arrow::Array> col_array,
+                              const std::vector<uint32_t>& rows,
+                              arrow::ArrayBuilder* builder)
+{
+    auto arr = std::static_pointer_cast<arrow::ListArray>(col_array);
+    auto values = std::static_pointer_cast<ArrayType>(arr->values());
+    auto lb = static_cast<arrow::ListBuilder*>(builder);
+    auto vb = static_cast<BuilderType*>(lb->value_builder());
+    const auto* vals = values->raw_values();
+    const bool check_nulls = values->null_count() > 0;
+    std::vector<uint8_t> valid;
+    lb->Reserve(rows.size());
+    for (size_t i = 0; i < rows.size(); i++) {
+        if (arr->IsNull(rows[i])) {
+            lb->AppendNull();
+            continue;
+        }
+        lb->Append();
+        int32_t offset = arr->value_offset(rows[i]);
+        int32_t len = arr->value_length(rows[i]);
+        if (!check_nulls) {
+            vb->AppendValues(vals + offset, len);
+            continue;
+        }
+        valid.resize(len);
+        for (int32_t j = 0; j < len; j++)
+            valid[j] = !values->IsNull(offset + j);
+        vb->AppendValues(vals + offset, len, valid.data());
+    }
+}
+
+static void takeArrowColBoolLists(std::shared_ptr<arrow::Array> col_array,
+                                  const std::vector<uint32_t>& rows,
+                                  arrow::ArrayBuilder* builder)
+{
+    auto arr = std::static_pointer_cast<arrow::ListArray>(col_array);
+    auto values = std::static_pointer_cast<arrow::BooleanArray>(arr->values());
+    auto lb = static_cast<arrow::ListBuilder*>(builder);
+    auto vb = static_cast<arrow::BooleanBuilder*>(lb->value_builder());
+    lb->Reserve(rows.size());
+    for (size_t i = 0; i < rows.size(); i++) {
+        if (arr->IsNull(rows[i])) {
+            lb->AppendNull();
+            continue;
+        }
+        lb->Append();
+        int32_t offset = arr->value_offset(rows[i]);
+        int32_t len = arr->value_length(rows[i]);
+        for (int32_t j = 0; j < len; j++) {
+            if (values->IsNull(offset + j))
+                vb->AppendNull();
+            else
+                vb->Append(values->Value(offset + j));
+        }
+    }
+}
+
+// create the array builder and field of a result col, for its data type.
+static int makeArrowColBuilder(const col_info& col,
+                               arrow::MemoryPool* pool,
+                               arrow::ArrayBuilder** builder,
+                               std::shared_ptr<arrow::Field>* field)
+{
+    switch(col.type) {
+
+        case SDT_BOOL: {
+            *builder = new arrow::BooleanBuilder(pool);
+            *field = arrow::field(col.name, arrow::boolean());
+            break;
+        }
+        case SDT_INT8: {
+            *builder = new arrow::Int8Builder(pool);
+            *field = arrow::field(col.name, arrow::int8());
+            break;
+        }
+        case SDT_INT16: {
+            *builder = new arrow::Int16Builder(pool);
+            *field = arrow::field(col.name, arrow::int16());
+            break;
+        }
+        case SDT_INT32: {
+            *builder = new arrow::Int32Builder(pool);
+            *field = arrow::field(col.name, arrow::int32());
+            break;
+        }
+        case SDT_INT64: {
+            *builder = new arrow::Int64Builder(pool);
+            *field = arrow::field(col.name, arrow::int64());
+            break;
+        }
+        case SDT_UINT8: {
+            *builder = new arrow::UInt8Builder(pool);
+            *field = arrow::field(col.name, arrow::uint8());
+            break;
+        }
+        case SDT_UINT16: {
+            *builder = new arrow::UInt16Builder(pool);
+            *field = arrow::field(col.name, arrow::uint16());
+            break;
+        }
+        case SDT_UINT32: {
+            *builder = new arrow::UInt32Builder(pool);
+            *field = arrow::field(col.name, arrow::uint32());
+            break;
+        }
+        case SDT_UINT64: {
+            *builder = new arrow::UInt64Builder(pool);
+            *field = arrow::field(col.name, arrow::uint64());
+            break;
+        }
+        case SDT_FLOAT: {
+            *builder = new arrow::FloatBuilder(pool);
+            *field = arrow::field(col.name, arrow::float32());
+            break;
+        }
+        case SDT_DOUBLE: {
+            *builder = new arrow::DoubleBuilder(pool);
+            *field = arrow::field(col.name, arrow::float64());
+            break;
+        }
+        case SDT_CHAR: {
+            *builder = new arrow::Int8Builder(pool);
+            *field = arrow::field(col.name, arrow::int8());
+            break;
+        }
+        case SDT_UCHAR: {
+            *builder = new arrow::UInt8Builder(pool);
+            *field = arrow::field(col.name, arrow::uint8());
+            break;
+        }
+        case SDT_DATE: {
+            *builder = new arrow::Date32Builder(pool);
+            *field = arrow::field(col.name, arrow::date32());
+            break;
+        }
+        case SDT_STRING: {
+            *builder = new arrow::StringBuilder(pool);
+            *field = arrow::field(col.name, arrow::utf8());
+            break;
+        }
+        case SDT_JAGGEDARRAY_BOOL: {
+            *builder = new arrow::ListBuilder(pool,std::make_shared<arrow::BooleanBuilder>(pool));
+            *field = arrow::field(col.name, arrow::list(arrow::boolean()));
+            break;
+        }
+        case SDT_JAGGEDARRAY_CHAR: {
+            *builder = new arrow::ListBuilder(pool,std::make_shared<arrow::Int8Builder>(pool));
+            *field = arrow::field(col.name, arrow::list(arrow::int8()));
+            break;
+        }
+        case SDT_JAGGEDARRAY_UCHAR: {
+            *builder = new arrow::ListBuilder(pool,std::make_shared<arrow::UInt8Builder>(pool));
+            *field = arrow::field(col.name, arrow::list(arrow::uint8()));
+            break;
+        }
+        case SDT_JAGGEDARRAY_INT8: {
+            *builder = new arrow::ListBuilder(pool,std::make_shared<arrow::Int8Builder>(pool));
+            *field = arrow::field(col.name, arrow::list(arrow::int8()));
+            break;
+        }
+        case SDT_JAGGEDARRAY_INT16: {
+            *builder = new arrow::ListBuilder(pool,std::make_shared<arrow::Int16Builder>(pool));
+            *field = arrow::field(col.name, arrow::list(arrow::int16()));
+            break;
+        }
+        case SDT_JAGGEDARRAY_UINT8: {
+            *builder = new arrow::ListBuilder(pool,std::make_shared<arrow::UInt8Builder>(pool));
+            *field = arrow::field(col.name, arrow::list(arrow::uint8()));
+            break;
+        }
+        case SDT_JAGGEDARRAY_UNT16: {
+            *builder = new arrow::ListBuilder(pool,std::make_shared<arrow::UInt16Builder>(pool));
+            *field = arrow::field(col.name, arrow::list(arrow::uint16()));
+            break;
+        }
+        case SDT_JAGGEDARRAY_INT32: {
+            *builder = new arrow::ListBuilder(pool,std::make_shared<arrow::Int32Builder>(pool));
+            *field = arrow::field(col.name, arrow::list(arrow::int32()));
+            break;
+        }
+         case SDT_JAGGEDARRAY_UINT32: {
+            *builder = new arrow::ListBuilder(pool,std::make_shared<arrow::UInt32Builder>(pool));
+            *field = arrow::field(col.name, arrow::list(arrow::uint32()));
+            break;
+        }
+        case SDT_JAGGEDARRAY_INT64: {
+            *builder = new arrow::ListBuilder(pool,std::make_shared<arrow::Int64Builder>(pool));
+            *field = arrow::field(col.name, arrow::list(arrow::int64()));
+            break;
+        }
+        case SDT_JAGGEDARRAY_UINT64: {
+            *builder = new arrow::ListBuilder(pool,std::make_shared<arrow::UInt64Builder>(pool));
+            *field = arrow::field(col.name, arrow::list(arrow::uint64()));
+            break;
+        }
+        case SDT_JAGGEDARRAY_FLOAT: {
+            *builder = new arrow::ListBuilder(pool,std::make_shared<arrow::FloatBuilder>(pool));
+            *field = arrow::field(col.name, arrow::list(arrow::float32()));
+            break;
+        }
+        case SDT_JAGGEDARRAY_DOUBLE: {
+            *builder = new arrow::ListBuilder(pool,std::make_shared<arrow::DoubleBuilder>(pool));
+            *field = arrow::field(col.name, arrow::list(arrow::float64()));
+            break;
+        }
+        default:
+            return TablesErrCodes::UnsupportedSkyDataType;
+    }
+    return 0;
+}
+
+// the single row of agg vals of processArrowCol, one col per agg pred in
+// pred order.  exact aggs are their col type, sketch aggs their state.
+template <typename BuilderType, typename T>
+static std::shared_ptr<arrow::Array> makeArrowAggArray(PredicateBase* pb,
+                                                       arrow::MemoryPool* pool)
+{
+    BuilderType builder(pool);
+    std::shared_ptr<arrow::Array> array;
+    builder.Append(dynamic_cast<TypedPredicate<T>*>(pb)->Val());
+    builder.Finish(&array);
+    pb->resetAgg();
+    return array;
+}
+
+static int takeArrowAggs(predicate_vec& preds,
+                         arrow::MemoryPool* pool,
+                         std::vector<std::shared_ptr<arrow::Array>>& arrays,
+                         std::vector<std::shared_ptr<arrow::Field>>& fields)
+{
+    for (auto it = preds.begin(); it != preds.end(); ++it) {
+        PredicateBase* pb = *it;
+        if (!pb->isGlobalAgg()) continue;
+
+        std::string name = skyOpTypeToString(pb->opType());
+        if (isSketchAgg(pb->opType())) {
+            SketchPredicate* p = dynamic_cast<SketchPredicate*>(pb);
+            std::string state = p->state();
+            arrow::BinaryBuilder builder(pool);
+            std::shared_ptr<arrow::Array> array;
+            builder.Append(state);
+            builder.Finish(&array);
+            p->resetAgg();
+            arrays.push_back(array);
+            fields.push_back(arrow::field(name, arrow::binary()));
+            continue;
+        }
+        switch(pb->colType()) {
+            case SDT_INT8:
+                arrays.push_back(makeArrowAggArray<arrow::Int8Builder,
+                                 int8_t>(pb, pool));
+                fields.push_back(arrow::field(name, arrow::int8()));
+                break;
+            case SDT_INT16:
+                arrays.push_back(makeArrowAggArray<arrow::Int16Builder,
+                                 int16_t>(pb, pool));
+                fields.push_back(arrow::field(name, arrow::int16()));
+                break;
+            case SDT_INT32:
+                arrays.push_back(makeArrowAggArray<arrow::Int32Builder,
+                                 int32_t>(pb, pool));
+                fields.push_back(arrow::field(name, arrow::int32()));
+                break;
+            case SDT_INT64:
+                arrays.push_back(makeArrowAggArray<arrow::Int64Builder,
+                                 int64_t>(pb, pool));
+                fields.push_back(arrow::field(name, arrow::int64()));
+                break;
+            case SDT_UINT8:
+                arrays.push_back(makeArrowAggArray<arrow::UInt8Builder,
+                                 uint8_t>(pb, pool));
+                fields.push_back(arrow::field(name, arrow::uint8()));
+                break;
+            case SDT_UINT16:
+                arrays.push_back(makeArrowAggArray<arrow::UInt16Builder,
+                                 uint16_t>(pb, pool));
+                fields.push_back(arrow::field(name, arrow::uint16()));
+                break;
+            case SDT_DATE:
+                arrays.push_back(makeArrowAggArray<arrow::Date32Builder,
+                                 int32_t>(pb, pool));
+                fields.push_back(arrow::field(name, arrow::date32()));
+                break;
+            case SDT_UINT32:
+                arrays.push_back(makeArrowAggArray<arrow::UInt32Builder,
+                                 uint32_t>(pb, pool));
+                fields.push_back(arrow::field(name, arrow::uint32()));
+                break;
+            case SDT_UINT64:
+                arrays.push_back(makeArrowAggArray<arrow::UInt64Builder,
+                                 uint64_t>(pb, pool));
+                fields.push_back(arrow::field(name, arrow::uint64()));
+                break;
+            case SDT_FLOAT:
+                arrays.push_back(makeArrowAggArray<arrow::FloatBuilder,
+                                 float>(pb, pool));
+                fields.push_back(arrow::field(name, arrow::float32()));
+                break;
+            case SDT_DOUBLE:
+                arrays.push_back(makeArrowAggArray<arrow::DoubleBuilder,
+                                 double>(pb, pool));
+                fields.push_back(arrow::field(name, arrow::float64()));
+                break;
+            default:
+                return TablesErrCodes::UnsupportedAggDataType;
+        }
+    }
+    return 0;
+}
+
+// gather the given rows of a col chunk into builder, per the col data type.
+static int takeArrowCol(const col_info& col,
+                        std::shared_ptr<arrow::Array> chunk,
+                        const std::vector<uint32_t>& rows,
+                        arrow::ArrayBuilder* builder)
+{
+    switch(col.type) {
+
+        case SDT_BOOL:
+            takeArrowColBools(chunk, rows, col.nullable, builder);
+            break;
+        case SDT_INT8:
+        case SDT_CHAR:
+            takeArrowColVals<arrow::Int8Array, arrow::Int8Builder>(
+                chunk, rows, col.nullable, builder);
+            break;
+        case SDT_INT16:
+            takeArrowColVals<arrow::Int16Array, arrow::Int16Builder>(
+                chunk, rows, col.nullable, builder);
+            break;
+        case SDT_INT32:
+            takeArrowColVals<arrow::Int32Array, arrow::Int32Builder>(
+                chunk, rows, col.nullable, builder);
+            break;
+        case SDT_INT64:
+            takeArrowColVals<arrow::Int64Array, arrow::Int64Builder>(
+                chunk, rows, col.nullable, builder);
+            break;
+        case SDT_UINT8:
+        case SDT_UCHAR:
+            takeArrowColVals<arrow::UInt8Array, arrow::UInt8Builder>(
+                chunk, rows, col.nullable, builder);
+            break;
+        case SDT_UINT16:
+            takeArrowColVals<arrow::UInt16Array, arrow::UInt16Builder>(
+                chunk, rows, col.nullable, builder);
+            break;
+        case SDT_UINT32:
+            takeArrowColVals<arrow::UInt32Array, arrow::UInt32Builder>(
+                chunk, rows, col.nullable, builder);
+            break;
+        case SDT_UINT64:
+            takeArrowColVals<arrow::UInt64Array, arrow::UInt64Builder>(
+                chunk, rows, col.nullable, builder);
+            break;
+        case SDT_FLOAT:
+            takeArrowColVals<arrow::FloatArray, arrow::FloatBuilder>(
+                chunk, rows, col.nullable, builder);
+            break;
+        case SDT_DOUBLE:
+            takeArrowColVals<arrow::DoubleArray, arrow::DoubleBuilder>(
+                chunk, rows, col.nullable, builder);
+            break;
+        case SDT_DATE:
+            takeArrowColVals<arrow::Date32Array, arrow::Date32Builder>(
+                chunk, rows, col.nullable, builder);
+            break;
+        case SDT_STRING:
+            takeArrowColStrings(chunk, rows, col.nullable, builder);
+            break;
+        case SDT_JAGGEDARRAY_BOOL:
+            takeArrowColBoolLists(chunk, rows, builder);
+            break;
+        case SDT_JAGGEDARRAY_CHAR:
+        case SDT_JAGGEDARRAY_INT8:
+            takeArrowColLists<arrow::Int8Array, arrow::Int8Builder>(
+                chunk, rows, builder);
+            break;
+        case SDT_JAGGEDARRAY_UCHAR:
+        case SDT_JAGGEDARRAY_UINT8:
+            takeArrowColLists<arrow::UInt8Array, arrow::UInt8Builder>(
+                chunk, rows, builder);
+            break;
+        case SDT_JAGGEDARRAY_INT16:
+            takeArrowColLists<arrow::Int16Array, arrow::Int16Builder>(
+                chunk, rows, builder);
+            break;
+        case SDT_JAGGEDARRAY_UNT16:
+            takeArrowColLists<arrow::UInt16Array, arrow::UInt16Builder>(
+                chunk, rows, builder);
+            break;
+        case SDT_JAGGEDARRAY_INT32:
+            takeArrowColLists<arrow::Int32Array, arrow::Int32Builder>(
+                chunk, rows, builder);
+            break;
+        case SDT_JAGGEDARRAY_UINT32:
+            takeArrowColLists<arrow::UInt32Array, arrow::UInt32Builder>(
+                chunk, rows, builder);
+            break;
+        case SDT_JAGGEDARRAY_INT64:
+            takeArrowColLists<arrow::Int64Array, arrow::Int64Builder>(
+                chunk, rows, builder);
+            break;
+        case SDT_JAGGEDARRAY_UINT64:
+            takeArrowColLists<arrow::UInt64Array, arrow::UInt64Builder>(
+                chunk, rows, builder);
+            break;
+        case SDT_JAGGEDARRAY_FLOAT:
+            takeArrowColLists<arrow::FloatArray, arrow::FloatBuilder>(
+                chunk, rows, builder);
+            break;
+        case SDT_JAGGEDARRAY_DOUBLE:
+            takeArrowColLists<arrow::DoubleArray, arrow::DoubleBuilder>(
+                chunk, rows, builder);
+            break;
+        default:
+            return TablesErrCodes::UnsupportedSkyDataType;
+    }
+    return 0;
+}
+
 /*
  * Function: processArrowCol
  * Description: Process the input arrow table columnwise for the corresponding
@@ -338,7 +1034,37 @@ int processArrowCol(
         const char* dataptr,
         const size_t datasz,
         std::string& errmsg,
-        const std::vector<uint32_t>& row_nums)
+        const std::vector<uint32_t>& row_nums,
+        const expr_vec& exprs,
+        const sort_vec& sort_keys)
+{
+    std::shared_ptr<arrow::Buffer> buffer =                             \
+        arrow::MutableBuffer::Wrap(reinterpret_cast<uint8_t*>(const_cast<char*>(dataptr)), datasz);
+    std::shared_ptr<arrow::Table> input_table;
+
+    // Get input table from dataptr
+    extract_arrow_from_buffer(&input_table, buffer);
+
+    return processArrowCol(table, tbl_schema, query_schema, preds,
+                           input_table, errmsg, row_nums, exprs, sort_keys);
+}
+
+/*
+ * Function: processArrowCol
+ * Description: As above, for an input table already in memory, e.g., one
+ *              merged from col chunks (see merge_arrow_col_chunks).
+ * @param[in] input_table  : Input arrow table
+ */
+int processArrowCol(
+        std::shared_ptr<arrow::Table>* table,
+        schema_vec& tbl_schema,
+        schema_vec& query_schema,
+        predicate_vec& preds,
+        std::shared_ptr<arrow::Table> input_table,
+        std::string& errmsg,
+        const std::vector<uint32_t>& row_nums,
+        const expr_vec& exprs,
+        const sort_vec& sort_keys)
 {
    int errcode = 0;
     int processed_rows = 0;
@@ -347,14 +1073,9 @@ int processArrowCol(
     std::vector<arrow::ArrayBuilder *> builder_list;
     std::vector<std::shared_ptr<arrow::Array>> array_list;
     std::vector<std::shared_ptr<arrow::Field>> output_tbl_fields_vec;
-    std::shared_ptr<arrow::Buffer> buffer =                             \
-        arrow::MutableBuffer::Wrap(reinterpret_cast<uint8_t*>(const_cast<char*>(dataptr)), datasz);
-    std::shared_ptr<arrow::Table> input_table, temp_table;
+    std::shared_ptr<arrow::Table> temp_table;
     std::vector<uint32_t> result_rows;
 
-    // Get input table from dataptr
-    extract_arrow_from_buffer(&input_table, buffer);
-
     auto schema = input_table->schema();
     auto metadata = schema->metadata();
     uint32_t nrows = atoi(metadata->value(METADATA_NUM_ROWS).c_str());
@@ -362,11 +1083,6 @@ int processArrowCol(
     // TODO: should we verify these are the same as nrows
     // int64_t nrows_from_api = input_table->num_rows();
 
-    // Get number of rows to be processed
-    if (!row_nums.empty()) {
-        result_rows = row_nums;
-    }
-
     // identify the max col idx, to prevent flexbuf vector oob error
     int col_idx_max = -1;
     for (auto it = tbl_schema.begin(); it != tbl_schema.end(); ++it) {
@@ -374,287 +1090,116 @@ int processArrowCol(
             col_idx_max = it->idx;
     }
 
+    // computed cols are evaluated columnwise and appended to the input
+    // table after the data cols, then handled the same as data cols below.
+    if (!exprs.empty()) {
+        errcode = addExprColsArrow(&input_table, num_cols, exprs, errmsg);
+        if (errcode)
+            return errcode;
+        num_cols += exprs.size();
+        col_idx_max = std::max(col_idx_max, exprs.back().col.idx);
+    }
+
+    // Late materialization: first build a selection bitmap of the candidate
+    // rows (the specified rows, minus dead rows), then evaluate the
+    // predicates columnwise over the bitmap, and only then gather the
+    // projected values of the surviving rows below.
+    std::vector<uint8_t> sel(nrows, row_nums.empty() ? 1 : 0);
+    for (auto it = row_nums.begin(); it != row_nums.end(); ++it) {
+        if (*it < nrows)
+            sel[*it] = 1;
+    }
+
+    // skip dead rows.
+    auto delvec = std::static_pointer_cast<arrow::BooleanArray>(
+        input_table->column(ARROW_DELVEC_INDEX(num_cols))->chunk(0));
+    for (uint32_t i = 0; i < nrows; i++) {
+        if (sel[i] and delvec->Value(i))
+            sel[i] = 0;
+    }
+
     // Apply predicates to all the columns and get the rows which
     // satifies the condition
-    if (!preds.empty()) {
-        // Iterate through each column in print the data inside it
-        for (auto it = tbl_schema.begin(); it != tbl_schema.end(); ++it) {
-            col_info col = *it;
+    if (!preds.empty())
+        applyPredicatesArrowColSel(preds, input_table, sel);
 
-            applyPredicatesArrowCol(preds,
-                                    input_table->column(col.idx)->chunk(0),
-                                    col.idx,
-                                    result_rows);
+    for (uint32_t i = 0; i < nrows; i++) {
+        if (sel[i])
+            result_rows.push_back(i);
+    }
+    processed_rows = result_rows.size();
+
+    // order the selected rows by the sort keys, the projected cols are
+    // then gathered below in sorted order.
+    if (!sort_keys.empty() and !hasAggPreds(preds) and processed_rows > 1) {
+        sort_cols sort_vals;
+        for (auto it = sort_keys.begin(); it != sort_keys.end(); ++it) {
+            sort_col sc(*it);
+            auto arr = input_table->column(it->col.idx)->chunk(0);
+            for (auto r = result_rows.begin(); r != result_rows.end(); ++r)
+                sortColAddArrow(sc, arr, it->col.type, *r);
+            sort_vals.push_back(sc);
         }
-        nrows = result_rows.size();
+        std::vector<uint32_t> perm;
+        sortPermutation(sort_vals, perm);
+        std::vector<uint32_t> sorted_rows;
+        sorted_rows.reserve(perm.size());
+        for (auto it = perm.begin(); it != perm.end(); ++it)
+            sorted_rows.push_back(result_rows[*it]);
+        result_rows.swap(sorted_rows);
     }
 
-    // At this point we have rows which satisfied the required predicates.
-    // Now create the output arrow table from input table.
-
-    // Iterate through query schema vector to get the details of columns i.e name and type.
-    // Also, get the builder arrays required for each data type
-    for (auto it = query_schema.begin(); it != query_schema.end() && !errcode; ++it) {
-        col_info col = *it;
+    // global aggs are accumulated over the selected rows and returned as a
+    // single row of their vals (sketch aggs as their partial state), the
+    // same as processSkyFb.
+    if (hasAggPreds(preds)) {
+        applyAggPredsArrowCol(preds, input_table, result_rows);
+        errcode = takeArrowAggs(preds, pool, array_list,
+                                output_tbl_fields_vec);
+        if (errcode) {
+            errmsg.append("ERROR processArrowCol()");
+            return errcode;
+        }
+        processed_rows = 1;
+    }
+    else {
+        // At this point we have rows which satisfied the required predicates.
+        // Now create the output arrow table from input table.
 
         // Create the array builders for respective datatypes. Use these array
         // builders to store data to array vectors. These array vectors holds the
         // actual column values. Also, add the details of column (Name and Datatype)
-        switch(col.type) {
-
-            case SDT_BOOL: {
-                auto ptr = std::unique_ptr<arrow::ArrayBuilder>(new arrow::BooleanBuilder(pool));
-                builder_list.emplace_back(ptr.get());
-                ptr.release();
-                output_tbl_fields_vec.push_back(arrow::field(col.name, arrow::boolean()));
-                break;
-            }
-            case SDT_INT8: {
-                auto ptr = std::unique_ptr<arrow::ArrayBuilder>(new arrow::Int8Builder(pool));
-                builder_list.emplace_back(ptr.get());
-                ptr.release();
-                output_tbl_fields_vec.push_back(arrow::field(col.name, arrow::int8()));
-                break;
-            }
-            case SDT_INT16: {
-                auto ptr = std::unique_ptr<arrow::ArrayBuilder>(new arrow::Int16Builder(pool));
-                builder_list.emplace_back(ptr.get());
-                ptr.release();
-                output_tbl_fields_vec.push_back(arrow::field(col.name, arrow::int16()));
-                break;
-            }
-            case SDT_INT32: {
-                auto ptr = std::unique_ptr<arrow::ArrayBuilder>(new arrow::Int32Builder(pool));
-                builder_list.emplace_back(ptr.get());
-                ptr.release();
-                output_tbl_fields_vec.push_back(arrow::field(col.name, arrow::int32()));
-                break;
-            }
-            case SDT_INT64: {
-                auto ptr = std::unique_ptr<arrow::ArrayBuilder>(new arrow::Int64Builder(pool));
-                builder_list.emplace_back(ptr.get());
-                ptr.release();
-                output_tbl_fields_vec.push_back(arrow::field(col.name, arrow::int64()));
-                break;
-            }
-            case SDT_UINT8: {
-                auto ptr = std::unique_ptr<arrow::ArrayBuilder>(new arrow::UInt8Builder(pool));
-                builder_list.emplace_back(ptr.get());
-                ptr.release();
-                output_tbl_fields_vec.push_back(arrow::field(col.name, arrow::uint8()));
-                break;
+        for (auto it = query_schema.begin(); it != query_schema.end() && !errcode; ++it) {
+            arrow::ArrayBuilder* builder = nullptr;
+            std::shared_ptr<arrow::Field> field;
+            errcode = makeArrowColBuilder(*it, pool, &builder, &field);
+            if (errcode) {
+                errmsg.append("ERROR processArrow()");
+                return errcode;
             }
-            case SDT_UINT16: {
-                auto ptr = std::unique_ptr<arrow::ArrayBuilder>(new arrow::UInt16Builder(pool));
-                builder_list.emplace_back(ptr.get());
-                ptr.release();
-                output_tbl_fields_vec.push_back(arrow::field(col.name, arrow::uint16()));
-                break;
+            builder_list.push_back(builder);
+            output_tbl_fields_vec.push_back(field);
+        }
+
+        // Copy values of the selected rows from input table columns to the
+        // output table columns, one bulk gather per projected column.
+        for (auto it = query_schema.begin(); it != query_schema.end() && !errcode; ++it) {
+            col_info col = *it;
+            auto builder = builder_list[std::distance(query_schema.begin(), it)];
+
+            if (col.idx < AGG_COL_LAST or col.idx > col_idx_max) {
+                errcode = TablesErrCodes::RequestedColIndexOOB;
+                errmsg.append("ERROR processArrowCol()");
+                return errcode;
             }
-            case SDT_UINT32: {
-                auto ptr = std::unique_ptr<arrow::ArrayBuilder>(new arrow::UInt32Builder(pool));
-                builder_list.emplace_back(ptr.get());
-                ptr.release();
-                output_tbl_fields_vec.push_back(arrow::field(col.name, arrow::uint32()));
-                break;
-            }
-            case SDT_UINT64: {
-                auto ptr = std::unique_ptr<arrow::ArrayBuilder>(new arrow::UInt64Builder(pool));
-                builder_list.emplace_back(ptr.get());
-                ptr.release();
-                output_tbl_fields_vec.push_back(arrow::field(col.name, arrow::uint64()));
-                break;
-            }
-            case SDT_FLOAT: {
-                auto ptr = std::unique_ptr<arrow::ArrayBuilder>(new arrow::FloatBuilder(pool));
-                builder_list.emplace_back(ptr.get());
-                ptr.release();
-                output_tbl_fields_vec.push_back(arrow::field(col.name, arrow::float32()));
-                break;
-            }
-            case SDT_DOUBLE: {
-                auto ptr = std::unique_ptr<arrow::ArrayBuilder>(new arrow::DoubleBuilder(pool));
-                builder_list.emplace_back(ptr.get());
-                ptr.release();
-                output_tbl_fields_vec.push_back(arrow::field(col.name, arrow::float64()));
-                break;
-            }
-            case SDT_CHAR: {
-                auto ptr = std::unique_ptr<arrow::ArrayBuilder>(new arrow::Int8Builder(pool));
-                builder_list.emplace_back(ptr.get());
-                ptr.release();
-                output_tbl_fields_vec.push_back(arrow::field(col.name, arrow::int8()));
-                break;
-            }
-            case SDT_UCHAR: {
-                auto ptr = std::unique_ptr<arrow::ArrayBuilder>(new arrow::UInt8Builder(pool));
-                builder_list.emplace_back(ptr.get());
-                ptr.release();
-                output_tbl_fields_vec.push_back(arrow::field(col.name, arrow::uint8()));
-                break;
-            }
-            case SDT_DATE:
-            case SDT_STRING: {
-                auto ptr = std::unique_ptr<arrow::ArrayBuilder>(new arrow::StringBuilder(pool));
-                builder_list.emplace_back(ptr.get());
-                ptr.release();
-                output_tbl_fields_vec.push_back(arrow::field(col.name, arrow::utf8()));
-                break;
-            }
-            case SDT_JAGGEDARRAY_BOOL: {
-                auto ptr = std::unique_ptr<arrow::ArrayBuilder>(new arrow::ListBuilder(pool,std::make_shared<arrow::BooleanBuilder>(pool)));
-                builder_list.emplace_back(ptr.get());
-                ptr.release();
-                output_tbl_fields_vec.push_back(arrow::field(col.name, arrow::list(arrow::boolean())));
-                break;
-            }
-            case SDT_JAGGEDARRAY_INT32: {
-                auto ptr = std::unique_ptr<arrow::ArrayBuilder>(new arrow::ListBuilder(pool,std::make_shared<arrow::Int32Builder>(pool)));
-                builder_list.emplace_back(ptr.get());
-                ptr.release();
-                output_tbl_fields_vec.push_back(arrow::field(col.name, arrow::list(arrow::int32())));
-                break;
-            }
-             case SDT_JAGGEDARRAY_UINT32: {
-                auto ptr = std::unique_ptr<arrow::ArrayBuilder>(new arrow::ListBuilder(pool,std::make_shared<arrow::UInt32Builder>(pool)));
-                builder_list.emplace_back(ptr.get());
-                ptr.release();
-                output_tbl_fields_vec.push_back(arrow::field(col.name, arrow::list(arrow::uint32())));
-                break;
-            }
-            case SDT_JAGGEDARRAY_INT64: {
-                auto ptr = std::unique_ptr<arrow::ArrayBuilder>(new arrow::ListBuilder(pool,std::make_shared<arrow::Int64Builder>(pool)));
-                builder_list.emplace_back(ptr.get());
-                ptr.release();
-                output_tbl_fields_vec.push_back(arrow::field(col.name, arrow::list(arrow::int64())));
-                break;
-            }
-            case SDT_JAGGEDARRAY_UINT64: {
-                auto ptr = std::unique_ptr<arrow::ArrayBuilder>(new arrow::ListBuilder(pool,std::make_shared<arrow::UInt64Builder>(pool)));
-                builder_list.emplace_back(ptr.get());
-                ptr.release();
-                output_tbl_fields_vec.push_back(arrow::field(col.name, arrow::list(arrow::uint64())));
-                break;
-            }
-            case SDT_JAGGEDARRAY_FLOAT: {
-                auto ptr = std::unique_ptr<arrow::ArrayBuilder>(new arrow::ListBuilder(pool,std::make_shared<arrow::FloatBuilder>(pool)));
-                builder_list.emplace_back(ptr.get());
-                ptr.release();
-                output_tbl_fields_vec.push_back(arrow::field(col.name, arrow::list(arrow::float32())));
-                break;
-            }
-            case SDT_JAGGEDARRAY_DOUBLE: {
-                auto ptr = std::unique_ptr<arrow::ArrayBuilder>(new arrow::ListBuilder(pool,std::make_shared<arrow::DoubleBuilder>(pool)));
-                builder_list.emplace_back(ptr.get());
-                ptr.release();
-                output_tbl_fields_vec.push_back(arrow::field(col.name, arrow::list(arrow::float64())));
-                break;
-            }
-            default: {
-                errcode = TablesErrCodes::UnsupportedSkyDataType;
-                errmsg.append("ERROR processArrow()");
-                return errcode;
-            }
-        }
-    }
-
-    // Copy values from input table rows to the output table rows
-    for (uint32_t i = 0; i < nrows; i++) {
-
-        uint32_t rnum = i;
-        if (!preds.empty())
-            rnum = result_rows[i];
-
-        // skip dead rows.
-        auto delvec_chunk = input_table->column(ARROW_DELVEC_INDEX(num_cols))->chunk(0);
-        if (std::static_pointer_cast<arrow::BooleanArray>(delvec_chunk)->Value(rnum) == true) continue;
-
-        processed_rows++;
-
-        // iter over the query schema and add the values from input table
-        // to output table
-        for (auto it = query_schema.begin(); it != query_schema.end() && !errcode; ++it) {
-            col_info col = *it;
-            auto builder = builder_list[std::distance(query_schema.begin(), it)];
-
-            auto processing_chunk = input_table->column(col.idx)->chunk(0);
-
-            if (col.idx < AGG_COL_LAST or col.idx > col_idx_max) {
-                errcode = TablesErrCodes::RequestedColIndexOOB;
-                errmsg.append("ERROR processArrowCol()");
-                return errcode;
-            } else {
-                if (col.nullable) {  // check nullbit
-                    if (processing_chunk->IsNull(rnum)) {
-                        builder->AppendNull();
-                        continue;
-                    }
-                }
-
-                // Append data from input tbale to the respective data type builders
-                switch(col.type) {
-
-                    case SDT_BOOL:
-                        static_cast<arrow::BooleanBuilder *>(builder)->Append(std::static_pointer_cast<arrow::BooleanArray>(processing_chunk)->Value(rnum));
-                        break;
-                    case SDT_INT8:
-                        static_cast<arrow::Int8Builder *>(builder)->Append(std::static_pointer_cast<arrow::Int8Array>(processing_chunk)->Value(rnum));
-                        break;
-                    case SDT_INT16:
-                        static_cast<arrow::Int16Builder *>(builder)->Append(std::static_pointer_cast<arrow::Int16Array>(processing_chunk)->Value(rnum));
-                        break;
-                    case SDT_INT32:
-                        static_cast<arrow::Int32Builder *>(builder)->Append(std::static_pointer_cast<arrow::Int32Array>(processing_chunk)->Value(rnum));
-                        break;
-                    case SDT_INT64:
-                        static_cast<arrow::Int64Builder *>(builder)->Append(std::static_pointer_cast<arrow::Int64Array>(processing_chunk)->Value(rnum));
-                        break;
-                    case SDT_UINT8:
-                        static_cast<arrow::UInt8Builder *>(builder)->Append(std::static_pointer_cast<arrow::UInt8Array>(processing_chunk)->Value(rnum));
-                        break;
-                    case SDT_UINT16:
-                        static_cast<arrow::UInt16Builder *>(builder)->Append(std::static_pointer_cast<arrow::UInt16Array>(processing_chunk)->Value(rnum));
-                        break;
-                    case SDT_UINT32:
-                        static_cast<arrow::UInt32Builder *>(builder)->Append(std::static_pointer_cast<arrow::UInt32Array>(processing_chunk)->Value(rnum));
-                        break;
-                    case SDT_UINT64:
-                        static_cast<arrow::UInt64Builder *>(builder)->Append(std::static_pointer_cast<arrow::UInt64Array>(processing_chunk)->Value(rnum));
-                        break;
-                    case SDT_FLOAT:
-                        static_cast<arrow::FloatBuilder *>(builder)->Append(std::static_pointer_cast<arrow::FloatArray>(processing_chunk)->Value(rnum));
-                        break;
-                    case SDT_DOUBLE:
-                        static_cast<arrow::DoubleBuilder *>(builder)->Append(std::static_pointer_cast<arrow::DoubleArray>(processing_chunk)->Value(rnum));
-                        break;
-                    case SDT_CHAR:
-                        static_cast<arrow::Int8Builder *>(builder)->Append(std::static_pointer_cast<arrow::Int8Array>(processing_chunk)->Value(rnum));
-                        break;
-                    case SDT_UCHAR:
-                        static_cast<arrow::UInt8Builder *>(builder)->Append(std::static_pointer_cast<arrow::UInt8Array>(processing_chunk)->Value(rnum));
-                        break;
-                    case SDT_DATE:
-                    case SDT_STRING:
-                        static_cast<arrow::StringBuilder *>(builder)->Append(std::static_pointer_cast<arrow::StringArray>(processing_chunk)->GetString(rnum));
-                        break;
-                    case SDT_JAGGEDARRAY_FLOAT: {
-                        // advance to the start of a new list row
-                        static_cast<arrow::ListBuilder *>(builder)->Append();
-
-                        // extract list builder as int32 builder
-                        arrow::ListBuilder* lb = static_cast<arrow::ListBuilder *>(builder);
-                        arrow::Int32Builder* ib = static_cast<arrow::Int32Builder *>(lb->value_builder());
-
-                        // TODO: extract prev values and append to ib
-                        // ib->AppendValues(vector.data(), vector.size());
-                        break;
-                    }
-                    default: {
-                        errcode = TablesErrCodes::UnsupportedSkyDataType;
-                        errmsg.append("ERROR processArrow()");
-                        return errcode;
-                    }
-                }
+
+            auto processing_chunk = input_table->column(col.idx)->chunk(0);
+
+            // Append data from input table to the respective data type builders
+            errcode = takeArrowCol(col, processing_chunk, result_rows, builder);
+            if (errcode) {
+                errmsg.append("ERROR processArrow()");
+                return errcode;
             }
         }
     }
@@ -698,6 +1243,148 @@ int processArrowCol(
 }
 
 
+/*
+ * Function: mergeArrowSortRuns
+ * Description: Merge the sorted result tables (runs) of the objects of a query
+ *              into a single sorted output, with a min heap over a cursor on
+ *              the current row of each run, i.e., O(n log k) key compares for
+ *              n rows over k runs.  The merged rows are streamed out as tables
+ *              of at most batch_rows rows, gathered directly from the runs,
+ *              until all rows are done or emit returns false (e.g., at the row
+ *              limit).  Each run (and its keys) is released once consumed.
+ * @param[in,out] runs     : Sorted arrow tables of query_schema cols
+ * @param[in] query_schema : Schema of the result cols
+ * @param[in] sort_keys    : Order by keys, located by their pos in query_schema
+ * @param[in] batch_rows   : Max rows of each emitted table
+ * @param[in] emit         : Called with each merged table, false stops merge
+ * @param[out] errmsg      : Error message
+ *
+ * Return Value: error code
+ */
+int mergeArrowSortRuns(
+        std::vector<std::shared_ptr<arrow::Table>>& runs,
+        schema_vec& query_schema,
+        const sort_vec& sort_keys,
+        uint32_t batch_rows,
+        std::function<bool(std::shared_ptr<arrow::Table>)> emit,
+        std::string& errmsg)
+{
+    int errcode = 0;
+    auto pool = arrow::default_memory_pool();
+    const size_t k = runs.size();
+    if (k == 0 or batch_rows == 0)
+        return errcode;
+
+    std::shared_ptr<arrow::KeyValueMetadata> metadata;
+    std::vector<std::shared_ptr<arrow::Field>> fields;
+    for (unsigned c = 0; c < query_schema.size(); c++) {
+        arrow::ArrayBuilder* builder = nullptr;
+        std::shared_ptr<arrow::Field> field;
+        errcode = makeArrowColBuilder(query_schema[c], pool, &builder, &field);
+        if (errcode) {
+            errmsg.append("ERROR mergeArrowSortRuns()");
+            return errcode;
+        }
+        delete builder;
+        fields.push_back(field);
+    }
+
+    // normalized keys and the cursor (next row) of each run.
+    std::vector<sort_cols> run_keys(k);
+    std::vector<uint32_t> run_rows(k, 0);
+    std::vector<uint32_t> next(k, 0);
+    for (size_t r = 0; r < k; r++) {
+        if (!runs[r] or runs[r]->num_rows() == 0)
+            continue;
+        if (!metadata)
+            metadata = runs[r]->schema()->metadata();
+        run_rows[r] = runs[r]->num_rows();
+        for (auto it = sort_keys.begin(); it != sort_keys.end(); ++it) {
+            sort_col sc(*it);
+            auto arr = runs[r]->column(it->pos)->chunk(0);
+            for (uint32_t i = 0; i < run_rows[r]; i++)
+                sortColAddArrow(sc, arr, it->col.type, i);
+            run_keys[r].push_back(sc);
+        }
+    }
+
+    // min heap of the runs by their current row, ties go to the lower run.
+    auto greater = [&](size_t a, size_t b) {
+        int cmp = compareSortCols(run_keys[a], next[a], run_keys[b], next[b]);
+        return cmp > 0 or (cmp == 0 and a > b);
+    };
+    std::priority_queue<size_t, std::vector<size_t>, decltype(greater)>
+        heap(greater);
+    for (size_t r = 0; r < k; r++) {
+        if (run_rows[r])
+            heap.push(r);
+    }
+
+    // a batch is a seq of segments, i.e., consecutive rows from one run, so
+    // each segment is a single bulk gather per col.
+    std::vector<std::pair<size_t, std::vector<uint32_t>>> segments;
+    std::vector<size_t> consumed;
+    while (!heap.empty()) {
+        segments.clear();
+        uint32_t nrows = 0;
+        while (!heap.empty() and nrows < batch_rows) {
+            size_t r = heap.top();
+            heap.pop();
+            if (segments.empty() or segments.back().first != r)
+                segments.push_back(std::make_pair(r, std::vector<uint32_t>()));
+            segments.back().second.push_back(next[r]++);
+            nrows++;
+            if (next[r] < run_rows[r])
+                heap.push(r);
+            else
+                consumed.push_back(r);
+        }
+
+        std::vector<std::shared_ptr<arrow::Array>> array_list;
+        for (unsigned c = 0; c < query_schema.size() and !errcode; c++) {
+            arrow::ArrayBuilder* builder = nullptr;
+            std::shared_ptr<arrow::Field> field;
+            makeArrowColBuilder(query_schema[c], pool, &builder, &field);
+            for (auto it = segments.begin();
+                 it != segments.end() and !errcode; ++it) {
+                errcode = takeArrowCol(query_schema[c],
+                                       runs[it->first]->column(c)->chunk(0),
+                                       it->second, builder);
+            }
+            std::shared_ptr<arrow::Array> arr;
+            builder->Finish(&arr);
+            delete builder;
+            array_list.push_back(arr);
+        }
+        if (errcode) {
+            errmsg.append("ERROR mergeArrowSortRuns()");
+            return errcode;
+        }
+
+        // release the runs consumed by this batch
+        for (auto r : consumed) {
+            runs[r].reset();
+            sort_cols().swap(run_keys[r]);
+        }
+        consumed.clear();
+
+        // same skyhook metadata as the runs, for the batch num rows
+        std::shared_ptr<arrow::KeyValueMetadata> batch_metadata(
+            new arrow::KeyValueMetadata);
+        for (int64_t i = 0; i < metadata->size(); i++) {
+            if (metadata->key(i) == ToString(METADATA_NUM_ROWS))
+                batch_metadata->Append(metadata->key(i),
+                                       std::to_string(nrows));
+            else
+                batch_metadata->Append(metadata->key(i), metadata->value(i));
+        }
+        auto schema = std::make_shared<arrow::Schema>(fields, batch_metadata);
+        if (!emit(arrow::Table::Make(schema, array_list)))
+            break;
+    }
+    return errcode;
+}
+
 /*
  * Function: processArrow
  * Description: Process the input arrow table rowwise for the corresponding input
@@ -855,7 +1542,13 @@ int processArrow(
                 output_tbl_fields_vec.push_back(arrow::field(col.name, arrow::uint8()));
                 break;
             }
-            case SDT_DATE:
+            case SDT_DATE: {
+                auto ptr = std::unique_ptr<arrow::ArrayBuilder>(new arrow::Date32Builder(pool));
+                builder_list.emplace_back(ptr.get());
+                ptr.release();
+                output_tbl_fields_vec.push_back(arrow::field(col.name, arrow::date32()));
+                break;
+            }
             case SDT_STRING: {
                 auto ptr = std::unique_ptr<arrow::ArrayBuilder>(new arrow::StringBuilder(pool));
                 builder_list.emplace_back(ptr.get());
@@ -1006,6 +1699,8 @@ int processArrow(
                     static_cast<arrow::UInt8Builder *>(builder)->Append(std::static_pointer_cast<arrow::UInt8Array>(processing_chunk)->Value(i));
                     break;
                 case SDT_DATE:
+                    static_cast<arrow::Date32Builder *>(builder)->Append(std::static_pointer_cast<arrow::Date32Array>(processing_chunk)->Value(i));
+                    break;
                 case SDT_STRING:
                     static_cast<arrow::StringBuilder *>(builder)->Append(std::static_pointer_cast<arrow::StringArray>(processing_chunk)->GetString(i));
                     break;
@@ -1055,343 +1750,5 @@ int processArrow(
     return errcode;
 }
 
-
-
-/*
- * For wasm execution testing.
- * Method is otherwise identical to processSkyFb, except signature is only
- * int or char for wasm compatibility.  We convert these back to their typical
- * types then proceed with same flatbuffer processing code.
- * Just before returning we also copy the local string error message back into
- * the caller's char* ptr.
- */
-int processSkyFbWASM(
-        char* _flatbldr,
-        int _flatbldr_len,
-        char* _data_schema,
-        int _data_schema_len,
-        char* _query_schema,
-        int _query_schema_len,
-        char* _preds,
-        int _preds_len,
-        char* _fb,
-        int _fb_size,
-        char* _errmsg,
-        int _errmsg_len,
-        int* _row_nums,
-        int _row_nums_size)
-{
-
-    // this is the result builder
-    flatbuffers::FlatBufferBuilder *flatbldr = (flatbuffers::FlatBufferBuilder*) _flatbldr;
-
-    // query params strings to skyhook types.
-    schema_vec data_schema = schemaFromString(std::string(_data_schema, _data_schema_len));
-    schema_vec query_schema = schemaFromString(std::string(_query_schema, _query_schema_len));
-    predicate_vec preds = predsFromString(data_schema, std::string(_preds, _preds_len));
-
-    // this is the in-mem data (as a flatbuffer)
-    const char* fb = _fb;
-    int fb_size = _fb_size;
-
-    // local var, need to copy back into our errmsg ptr before returning
-    // append messages with errmsg.append();
-    // but only max  _errmsg_len will be copied back into caller's ptr
-    std::string errmsg;
-
-    // row_nums array represents those found by an index, if any.
-    std::vector<uint32_t> row_nums(&_row_nums[0], &_row_nums[_row_nums_size]);
-
-    int errcode = 0;
-    delete_vector dead_rows;
-    std::vector<flatbuffers::Offset<Tables::Record>> offs;
-    sky_root root = getSkyRoot(fb, fb_size, SFT_FLATBUF_FLEX_ROW);
-
-    // identify the max col idx, to prevent flexbuf vector oob error
-    int col_idx_max = -1;
-    for (auto it=data_schema.begin(); it!=data_schema.end(); ++it) {
-        if (it->idx > col_idx_max)
-            col_idx_max = it->idx;
-    }
-
-    bool project_all = std::equal(data_schema.begin(), data_schema.end(),
-                                  query_schema.begin(), compareColInfo);
-
-    // build the flexbuf with computed aggregates, aggs are computed for
-    // each row that passes, and added to flexbuf after loop below.
-    bool encode_aggs = false;
-    if (hasAggPreds(preds)) encode_aggs = true;
-    bool encode_rows = !encode_aggs;
-
-    // determines if we process specific rows (from index lookup) or all rows
-    bool process_all_rows = false;
-    uint32_t nrows = 0;
-    if (row_nums.empty()) {         // default is empty, so process them all
-        process_all_rows = true;
-        nrows = root.nrows;
-    }
-    else {
-        process_all_rows = false;  // process only specific rows
-        nrows = row_nums.size();
-    }
-
-    // 1. check the preds for passing
-    // 2a. accumulate agg preds (return flexbuf built after all rows) or
-    // 2b. build the return flatbuf inline below from each row's projection
-    for (uint32_t i = 0; i < nrows; i++) {
-
-        // process row i or the specified row number
-        uint32_t rnum = 0;
-        if (process_all_rows) rnum = i;
-        else rnum = row_nums[i];
-
-        if (rnum > root.nrows) {
-            errmsg += "ERROR: rnum(" + std::to_string(rnum) +
-                      ") > root.nrows(" + to_string(root.nrows) + ")";
-            //  copy finite len errmsg into caller's char ptr
-            size_t len = _errmsg_len;
-            if(errmsg.length()+1 < len)
-                len = errmsg.length()+1;
-            strncpy(_errmsg, errmsg.c_str(), len);
-            return RowIndexOOB;
-        }
-
-         // skip dead rows.
-        if (root.delete_vec[rnum] == 1) continue;
-
-        // get a skyhook record struct
-        sky_rec rec = getSkyRec(static_cast<row_offs>(root.data_vec)->Get(rnum));
-
-        // apply predicates to this record
-        if (!preds.empty()) {
-            bool pass = applyPredicates(preds, rec);
-            if (!pass) continue;  // skip non matching rows.
-        }
-
-        // note: agg preds are accumlated in the predicate itself during
-        // applyPredicates above, then later added to result fb outside
-        // of this loop (i.e., they are not encoded into the result fb yet)
-        // thus we can skip the below encoding of rows into the result fb
-        // and just continue accumulating agg preds in this processing loop.
-        if (!encode_rows) continue;
-
-        if (project_all) {
-            // TODO:  just pass through row table offset to new data_vec
-            // (which is also type offs), do not rebuild row table and flexbuf
-        }
-
-        // build the return projection for this row.
-        auto row = rec.data.AsVector();
-        flexbuffers::Builder *flexbldr = new flexbuffers::Builder();
-        flatbuffers::Offset<flatbuffers::Vector<unsigned char>> datavec;
-
-        flexbldr->Vector([&]() {
-
-            // iter over the query schema, locating it within the data schema
-            for (auto it=query_schema.begin();
-                      it!=query_schema.end() && !errcode; ++it) {
-                col_info col = *it;
-                if (col.idx < AGG_COL_LAST or col.idx > col_idx_max) {
-                    errcode = TablesErrCodes::RequestedColIndexOOB;
-                    errmsg.append("ERROR processSkyFb(): table=" +
-                            root.table_name + "; rid=" +
-                            std::to_string(rec.RID) + " col.idx=" +
-                            std::to_string(col.idx) + " OOB.");
-
-                } else {
-
-                    switch(col.type) {  // encode data val into flexbuf
-
-                        case SDT_INT8:
-                            flexbldr->Add(row[col.idx].AsInt8());
-                            break;
-                        case SDT_INT16:
-                            flexbldr->Add(row[col.idx].AsInt16());
-                            break;
-                        case SDT_INT32:
-                            flexbldr->Add(row[col.idx].AsInt32());
-                            break;
-                        case SDT_INT64:
-                            flexbldr->Add(row[col.idx].AsInt64());
-                            break;
-                        case SDT_UINT8:
-                            flexbldr->Add(row[col.idx].AsUInt8());
-                            break;
-                        case SDT_UINT16:
-                            flexbldr->Add(row[col.idx].AsUInt16());
-                            break;
-                        case SDT_UINT32:
-                            flexbldr->Add(row[col.idx].AsUInt32());
-                            break;
-                        case SDT_UINT64:
-                            flexbldr->Add(row[col.idx].AsUInt64());
-                            break;
-                        case SDT_CHAR:
-                            flexbldr->Add(row[col.idx].AsInt8());
-                            break;
-                        case SDT_UCHAR:
-                            flexbldr->Add(row[col.idx].AsUInt8());
-                            break;
-                        case SDT_BOOL:
-                            flexbldr->Add(row[col.idx].AsBool());
-                            break;
-                        case SDT_FLOAT:
-                            flexbldr->Add(row[col.idx].AsFloat());
-                            break;
-                        case SDT_DOUBLE:
-                            flexbldr->Add(row[col.idx].AsDouble());
-                            break;
-                        case SDT_DATE:
-                            flexbldr->Add(row[col.idx].AsString().str());
-                            break;
-                        case SDT_STRING:
-                            flexbldr->Add(row[col.idx].AsString().str());
-                            break;
-                        default: {
-                            errcode = TablesErrCodes::UnsupportedSkyDataType;
-                            errmsg.append("ERROR processSkyFb(): table=" +
-                                    root.table_name + "; rid=" +
-                                    std::to_string(rec.RID) + " col.type=" +
-                                    std::to_string(col.type) +
-                                    " UnsupportedSkyDataType.");
-                        }
-                    }
-                }
-            }
-        });
-
-        // finalize the row's projected data within our flexbuf
-        flexbldr->Finish();
-
-        // build the return ROW flatbuf that contains the flexbuf data
-        auto row_data = flatbldr->CreateVector(flexbldr->GetBuffer());
-        delete flexbldr;
-
-        // TODO: update nullbits
-        auto nullbits = flatbldr->CreateVector(rec.nullbits);
-        flatbuffers::Offset<Tables::Record> row_off = \
-                Tables::CreateRecord(*flatbldr, rec.RID, nullbits, row_data);
-
-        // Continue building the ROOT flatbuf's dead vector and rowOffsets vec
-        dead_rows.push_back(0);
-        offs.push_back(row_off);
-    }
-
-    // here we build the return flatbuf result with agg values that were
-    // accumulated above in applyPredicates (agg predicates do not return
-    // true false but update their internal values each time processed
-    if (encode_aggs) { //  encode accumulated agg pred val into return flexbuf
-        PredicateBase* pb;
-        flexbuffers::Builder *flexbldr = new flexbuffers::Builder();
-        flexbldr->Vector([&]() {
-            for (auto itp = preds.begin(); itp != preds.end(); ++itp) {
-
-                // assumes preds appear in same order as return schema
-                if (!(*itp)->isGlobalAgg()) continue;
-                pb = *itp;
-                switch(pb->colType()) {  // encode agg data val into flexbuf
-                    case SDT_INT64: {
-                        TypedPredicate<int64_t>* p = \
-                                dynamic_cast<TypedPredicate<int64_t>*>(pb);
-                        int64_t agg_val = p->Val();
-                        flexbldr->Add(agg_val);
-                        p->updateAgg(0);  // reset accumulated add val
-                        break;
-                    }
-                    case SDT_UINT32: {
-                        TypedPredicate<uint32_t>* p = \
-                                dynamic_cast<TypedPredicate<uint32_t>*>(pb);
-                        uint32_t agg_val = p->Val();
-                        flexbldr->Add(agg_val);
-                        p->updateAgg(0);  // reset accumulated add val
-                        break;
-                    }
-                    case SDT_UINT64: {
-                        TypedPredicate<uint64_t>* p = \
-                                dynamic_cast<TypedPredicate<uint64_t>*>(pb);
-                        uint64_t agg_val = p->Val();
-                        flexbldr->Add(agg_val);
-                        p->updateAgg(0);  // reset accumulated add val
-                        break;
-                    }
-                    case SDT_FLOAT: {
-                        TypedPredicate<float>* p = \
-                                dynamic_cast<TypedPredicate<float>*>(pb);
-                        float agg_val = p->Val();
-                        flexbldr->Add(agg_val);
-                        p->updateAgg(0);  // reset accumulated add val
-                        break;
-                    }
-                    case SDT_DOUBLE: {
-                        TypedPredicate<double>* p = \
-                                dynamic_cast<TypedPredicate<double>*>(pb);
-                        double agg_val = p->Val();
-                        flexbldr->Add(agg_val);
-                        p->updateAgg(0);  // reset accumulated add val
-                        break;
-                    }
-                    default:  assert(UnsupportedAggDataType==0);
-                }
-            }
-        });
-        // finalize the row's projected data within our flexbuf
-        flexbldr->Finish();
-
-        // build the return ROW flatbuf that contains the flexbuf data
-        auto row_data = flatbldr->CreateVector(flexbldr->GetBuffer());
-        delete flexbldr;
-
-        // assume no nullbits in the agg results. ?
-        nullbits_vector nb(2,0);
-        auto nullbits = flatbldr->CreateVector(nb);
-        int RID = -1;  // agg recs only, since these are derived data
-        flatbuffers::Offset<Tables::Record> row_off = \
-            Tables::CreateRecord(*flatbldr, RID, nullbits, row_data);
-
-        // Continue building the ROOT flatbuf's dead vector and rowOffsets vec
-        dead_rows.push_back(0);
-        offs.push_back(row_off);
-    }
-
-    // now build the return ROOT flatbuf wrapper
-    std::string query_schema_str;
-    for (auto it = query_schema.begin(); it != query_schema.end(); ++it) {
-        query_schema_str.append(it->toString() + "\n");
-    }
-
-    auto return_data_schema = flatbldr->CreateString(query_schema_str);
-    auto db_schema_name = flatbldr->CreateString(root.db_schema_name);
-    auto table_name = flatbldr->CreateString(root.table_name);
-    auto delete_v = flatbldr->CreateVector(dead_rows);
-    auto rows_v = flatbldr->CreateVector(offs);
-
-    auto table = CreateTable(
-        *flatbldr,
-        root.data_format_type,
-        root.skyhook_version,
-        root.data_structure_version,
-        root.data_schema_version,
-        return_data_schema,
-        db_schema_name,
-        table_name,
-        delete_v,
-        rows_v,
-        offs.size());
-
-    // NOTE: the fb may be incomplete/empty, but must finish() else internal
-    // fb lib assert finished() fails, hence we must always return a valid fb
-    // and catch any ret error code upstream
-    flatbldr->Finish(table);
-
-    // copy finite len errmsg into caller's char ptr
-    size_t len = _errmsg_len;
-    if(errmsg.length()+1 < len)
-        len = errmsg.length()+1;
-    strncpy(_errmsg, errmsg.c_str(), len);
-
-    return errcode;
-}
-
-
 }  // end namepace Tables
 
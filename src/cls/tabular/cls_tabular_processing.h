@@ -20,7 +20,6 @@
 
 
 // Processing code for different data formats, since each has their own API
-// Also processing for WASM, which requires arguments of C types, not C++
 
 
 namespace Tables {
@@ -35,7 +34,9 @@ int processSkyFb(
         const char* fb,
         const size_t fb_size,
         std::string& errmsg,
-        const std::vector<uint32_t>& row_nums=std::vector<uint32_t>());
+        const std::vector<uint32_t>& row_nums=std::vector<uint32_t>(),
+        const expr_vec& exprs=expr_vec(),
+        const sort_vec& sort_keys=sort_vec());
 
 // process arrow format data blob, col access style
 int processArrowCol(
@@ -46,7 +47,30 @@ int processArrowCol(
         const char* dataptr,
         const size_t datasz,
         std::string& errmsg,
-        const std::vector<uint32_t>& row_nums=std::vector<uint32_t>());
+        const std::vector<uint32_t>& row_nums=std::vector<uint32_t>(),
+        const expr_vec& exprs=expr_vec(),
+        const sort_vec& sort_keys=sort_vec());
+
+// process arrow table already in memory, col access style
+int processArrowCol(
+        std::shared_ptr<arrow::Table>* table,
+        schema_vec& tbl_schema,
+        schema_vec& query_schema,
+        predicate_vec& preds,
+        std::shared_ptr<arrow::Table> input_table,
+        std::string& errmsg,
+        const std::vector<uint32_t>& row_nums=std::vector<uint32_t>(),
+        const expr_vec& exprs=expr_vec(),
+        const sort_vec& sort_keys=sort_vec());
+
+// merge sorted result tables into sorted batches of at most batch_rows rows
+int mergeArrowSortRuns(
+        std::vector<std::shared_ptr<arrow::Table>>& runs,
+        schema_vec& query_schema,
+        const sort_vec& sort_keys,
+        uint32_t batch_rows,
+        std::function<bool(std::shared_ptr<arrow::Table>)> emit,
+        std::string& errmsg);
 
 // process arrow format data blob, row access style
 int processArrow(
@@ -59,23 +83,6 @@ int processArrow(
         std::string& errmsg,
         const std::vector<uint32_t>& row_nums=std::vector<uint32_t>());
 
-// process flatbuffer format data blob with wasm
-int processSkyFbWASM(
-        char* _flatbldr,
-        int _flatbldr_len,
-        char* _data_schema,
-        int _data_schema_len,
-        char* _query_schema,
-        int _query_schema_len,
-        char* _preds,
-        int _preds_len,
-        char* _fb,
-        int _fb_size,
-        char* _errmsg,
-        int _errmsg_len,
-        int* _row_nums,
-        int _row_nums_size);
-
 } // end namespace Tables
 
 
@@ -110,6 +110,281 @@ schema_vec schemaFromString(std::string schema_string) {
     return schema;
 }
 
+template <typename T, typename F>
+static PredicateBase* newListPredicate(const col_info& ci, int op_type,
+                                       const vector<std::string>& items,
+                                       F conv) {
+    std::vector<T> vals;
+    vals.reserve(items.size());
+    for (auto it = items.begin(); it != items.end(); ++it)
+        vals.push_back(static_cast<T>(conv(*it)));
+    return new TypedPredicate<T>(ci.idx, ci.type, op_type, vals);
+}
+
+// in/not_in/between preds, vals are delimited by PRED_DELIM_LIST
+// e.g., orderkey,in,1|5|9 or shipdate,between,1994-01-01|1994-12-31
+static PredicateBase* listPredFromString(const col_info& ci, int op_type,
+                                         std::string val) {
+    vector<std::string> items;
+    boost::split(items, val, boost::is_any_of(PRED_DELIM_LIST),
+                 boost::token_compress_on);
+    if (ci.type != SDT_STRING) {
+        for (auto it = items.begin(); it != items.end(); ++it)
+            boost::trim(*it);
+        items.erase(std::remove(items.begin(), items.end(), ""), items.end());
+    }
+    if (items.empty() or (op_type == SOT_between and items.size() != 2)) {
+        cerr << "Error: pred vals=" << val << " expected "
+             << (op_type == SOT_between ? "lo|hi" : "v1|v2|...") << std::endl;
+        assert (TablesErrCodes::BadPredListFormat == 0);
+    }
+
+    auto to_l = [](const std::string& v) { return std::stol(v); };
+    auto to_ll = [](const std::string& v) { return std::stoll(v); };
+    auto to_ul = [](const std::string& v) { return std::stoul(v); };
+    auto to_ull = [](const std::string& v) { return std::stoull(v); };
+    auto to_d = [](const std::string& v) { return std::stod(v); };
+    auto to_c = [](const std::string& v) { return v.at(0); };
+
+    switch (ci.type) {
+        case SDT_BOOL:
+            return newListPredicate<bool>(ci, op_type, items, to_l);
+        case SDT_INT8:
+            return newListPredicate<int8_t>(ci, op_type, items, to_l);
+        case SDT_INT16:
+            return newListPredicate<int16_t>(ci, op_type, items, to_l);
+        case SDT_INT32:
+            return newListPredicate<int32_t>(ci, op_type, items, to_l);
+        case SDT_INT64:
+            return newListPredicate<int64_t>(ci, op_type, items, to_ll);
+        case SDT_UINT8:
+            return newListPredicate<uint8_t>(ci, op_type, items, to_ul);
+        case SDT_UINT16:
+            return newListPredicate<uint16_t>(ci, op_type, items, to_ul);
+        case SDT_UINT32:
+            return newListPredicate<uint32_t>(ci, op_type, items, to_ul);
+        case SDT_UINT64:
+            return newListPredicate<uint64_t>(ci, op_type, items, to_ull);
+        case SDT_FLOAT:
+            return newListPredicate<float>(ci, op_type, items, to_d);
+        case SDT_DOUBLE:
+            return newListPredicate<double>(ci, op_type, items, to_d);
+        case SDT_CHAR:
+            return newListPredicate<char>(ci, op_type, items, to_c);
+        case SDT_UCHAR:
+            return newListPredicate<unsigned char>(ci, op_type, items, to_c);
+        case SDT_DATE:
+            return newListPredicate<int32_t>(ci, op_type, items, dateToDays);
+        case SDT_STRING:
+            return new TypedPredicate<std::string>(ci.idx, ci.type,
+                                                   op_type, items);
+        default: assert (TablesErrCodes::UnknownSkyDataType==0);
+    }
+    return nullptr;
+}
+
+// the param of a sketch agg, the hll/kll error or the quantile rank, in [0,1]
+static int sketchParamFromString(const std::string& val, double& param,
+                                 std::string& errmsg) {
+    size_t pos = 0;
+    try {
+        param = std::stod(val, &pos);
+    } catch (const std::exception& e) {
+        pos = 0;
+    }
+    if (pos == 0 or pos != val.length() or !(param >= 0 and param <= 1)) {
+        errmsg.append("sketch agg param '" + val + "' is not a number in "
+                      "[0,1]");
+        return TablesErrCodes::BadSketchParam;
+    }
+    return 0;
+}
+
+// add the pred of col ci with op_type and the pred val text to preds, or to
+// agg_preds for global aggs, which are applied after all other preds.
+// returns 0 or a TablesErrCodes error with errmsg set.
+static int addPredFromString(const col_info& ci,
+                             int op_type,
+                             const std::string& val,
+                             predicate_vec& preds,
+                             predicate_vec& agg_preds,
+                             std::string& errmsg) {
+
+    if (isListOp(op_type)) {
+        preds.push_back(listPredFromString(ci, op_type, val));
+        return 0;
+    }
+
+    // Bernoulli sample of the rows, val is "fraction:seed"
+    if (op_type == SOT_sample) {
+        size_t pos = val.find(':');
+        double fraction = std::stod(val.substr(0, pos));
+        uint64_t seed = 0;
+        if (pos != std::string::npos)
+            seed = std::stoull(val.substr(pos + 1));
+        preds.push_back(new SamplePredicate(fraction, seed));
+        return 0;
+    }
+
+    // approx aggs over any col type, val is the agg param
+    if (isSketchAgg(op_type)) {
+        double param = 0;
+        int ret = sketchParamFromString(val, param, errmsg);
+        if (ret)
+            return ret;
+        agg_preds.push_back(new SketchPredicate(ci.idx, ci.type, op_type,
+                                                param));
+        return 0;
+    }
+
+    switch (ci.type) {
+
+        case SDT_BOOL: {
+            TypedPredicate<bool>* p = \
+                    new TypedPredicate<bool> \
+                    (ci.idx, ci.type, op_type, std::stol(val));
+            if (p->isGlobalAgg()) agg_preds.push_back(p);
+            else preds.push_back(p);
+            break;
+        }
+        case SDT_INT8: {
+            TypedPredicate<int8_t>* p = \
+                    new TypedPredicate<int8_t> \
+                    (ci.idx, ci.type, op_type, \
+                    static_cast<int8_t>(std::stol(val)));
+            if (p->isGlobalAgg()) agg_preds.push_back(p);
+            else preds.push_back(p);
+            break;
+        }
+        case SDT_INT16: {
+            TypedPredicate<int16_t>* p = \
+                    new TypedPredicate<int16_t> \
+                    (ci.idx, ci.type, op_type, \
+                    static_cast<int16_t>(std::stol(val)));
+            if (p->isGlobalAgg()) agg_preds.push_back(p);
+            else preds.push_back(p);
+            break;
+        }
+        case SDT_INT32: {
+            TypedPredicate<int32_t>* p = \
+                    new TypedPredicate<int32_t> \
+                    (ci.idx, ci.type, op_type, \
+                    static_cast<int32_t>(std::stol(val)));
+            if (p->isGlobalAgg()) agg_preds.push_back(p);
+            else preds.push_back(p);
+            break;
+        }
+        case SDT_INT64: {
+            TypedPredicate<int64_t>* p = \
+                    new TypedPredicate<int64_t> \
+                    (ci.idx, ci.type, op_type, \
+                    static_cast<int64_t>(std::stoll(val)));
+            if (p->isGlobalAgg()) agg_preds.push_back(p);
+            else preds.push_back(p);
+            break;
+        }
+        case SDT_UINT8: {
+            TypedPredicate<uint8_t>* p = \
+                    new TypedPredicate<uint8_t> \
+                    (ci.idx, ci.type, op_type, \
+                    static_cast<uint8_t>(std::stoul(val)));
+            if (p->isGlobalAgg()) agg_preds.push_back(p);
+            else preds.push_back(p);
+            break;
+        }
+        case SDT_UINT16: {
+            TypedPredicate<uint16_t>* p = \
+                    new TypedPredicate<uint16_t> \
+                    (ci.idx, ci.type, op_type,
+                    static_cast<uint16_t>(std::stoul(val)));
+            if (p->isGlobalAgg()) agg_preds.push_back(p);
+            else preds.push_back(p);
+            break;
+        }
+        case SDT_UINT32: {
+            TypedPredicate<uint32_t>* p = \
+                    new TypedPredicate<uint32_t> \
+                    (ci.idx, ci.type, op_type,
+                    static_cast<uint32_t>(std::stoul(val)));
+            if (p->isGlobalAgg()) agg_preds.push_back(p);
+            else preds.push_back(p);
+            break;
+        }
+        case SDT_UINT64: {
+            TypedPredicate<uint64_t>* p = \
+                    new TypedPredicate<uint64_t> \
+                    (ci.idx, ci.type, op_type, \
+                    static_cast<uint64_t>(std::stoull(val)));
+            if (p->isGlobalAgg()) agg_preds.push_back(p);
+            else preds.push_back(p);
+            break;
+        }
+        case SDT_FLOAT: {
+            TypedPredicate<float>* p = \
+                    new TypedPredicate<float> \
+                    (ci.idx, ci.type, op_type, std::stof(val));
+            if (p->isGlobalAgg()) agg_preds.push_back(p);
+            else preds.push_back(p);
+            break;
+        }
+        case SDT_DOUBLE: {
+            TypedPredicate<double>* p = \
+                    new TypedPredicate<double> \
+                    (ci.idx, ci.type, op_type, std::stod(val));
+            if (p->isGlobalAgg()) agg_preds.push_back(p);
+            else preds.push_back(p);
+            break;
+        }
+        case SDT_CHAR: {
+            assert (val.length() > 0);
+            TypedPredicate<char>* p = \
+                    new TypedPredicate<char> \
+                    (ci.idx, ci.type, op_type, val[0]);
+            if (p->isGlobalAgg()) agg_preds.push_back(p);
+            else preds.push_back(p);
+            break;
+        }
+        case SDT_UCHAR: {
+            assert (val.length() > 0);
+            TypedPredicate<unsigned char>* p = \
+                    new TypedPredicate<unsigned char> \
+                    (ci.idx, ci.type, op_type, val[0]);
+            if (p->isGlobalAgg()) agg_preds.push_back(p);
+            else preds.push_back(p);
+            break;
+        }
+        case SDT_STRING: {
+            TypedPredicate<std::string>* p = \
+                    new TypedPredicate<std::string> \
+                    (ci.idx, ci.type, op_type, val);
+            preds.push_back(p);
+            break;
+        }
+        case SDT_DATE: {
+            TypedPredicate<int32_t>* p = \
+                    new TypedPredicate<int32_t> \
+                    (ci.idx, ci.type, op_type, dateToDays(val));
+            if (p->isGlobalAgg()) agg_preds.push_back(p);
+            else preds.push_back(p);
+            break;
+        }
+        default: assert (TablesErrCodes::UnknownSkyDataType==0);
+    }
+    return 0;
+}
+
+// add agg preds to end so they are only updated if all other preds pass.
+// currently in apply_predicates they are applied in order.
+static void appendAggPreds(predicate_vec& preds, predicate_vec& agg_preds) {
+    if (!agg_preds.empty()) {
+        preds.reserve(preds.size() + agg_preds.size());
+        std::move(agg_preds.begin(), agg_preds.end(),
+                  std::inserter(preds, preds.end()));
+        agg_preds.clear();
+        agg_preds.shrink_to_fit();
+    }
+}
+
 predicate_vec predsFromString(schema_vec &schema, std::string preds_string) {
     // format: ;colname,opname,value;colname,opname,value;...
     // e.g.,;orderkey,eq,5;comment,like,hello world;..
@@ -147,150 +422,16 @@ predicate_vec predsFromString(schema_vec &schema, std::string preds_string) {
         }
         col_info ci = sv.at(0);
         int op_type = skyOpTypeFromString(opname);
-
-        switch (ci.type) {
-
-            case SDT_BOOL: {
-                TypedPredicate<bool>* p = \
-                        new TypedPredicate<bool> \
-                        (ci.idx, ci.type, op_type, std::stol(val));
-                if (p->isGlobalAgg()) agg_preds.push_back(p);
-                else preds.push_back(p);
-                break;
-            }
-            case SDT_INT8: {
-                TypedPredicate<int8_t>* p = \
-                        new TypedPredicate<int8_t> \
-                        (ci.idx, ci.type, op_type, \
-                        static_cast<int8_t>(std::stol(val)));
-                if (p->isGlobalAgg()) agg_preds.push_back(p);
-                else preds.push_back(p);
-                break;
-            }
-            case SDT_INT16: {
-                TypedPredicate<int16_t>* p = \
-                        new TypedPredicate<int16_t> \
-                        (ci.idx, ci.type, op_type, \
-                        static_cast<int16_t>(std::stol(val)));
-                if (p->isGlobalAgg()) agg_preds.push_back(p);
-                else preds.push_back(p);
-                break;
-            }
-            case SDT_INT32: {
-                TypedPredicate<int32_t>* p = \
-                        new TypedPredicate<int32_t> \
-                        (ci.idx, ci.type, op_type, \
-                        static_cast<int32_t>(std::stol(val)));
-                if (p->isGlobalAgg()) agg_preds.push_back(p);
-                else preds.push_back(p);
-                break;
-            }
-            case SDT_INT64: {
-                TypedPredicate<int64_t>* p = \
-                        new TypedPredicate<int64_t> \
-                        (ci.idx, ci.type, op_type, \
-                        static_cast<int64_t>(std::stoll(val)));
-                if (p->isGlobalAgg()) agg_preds.push_back(p);
-                else preds.push_back(p);
-                break;
-            }
-            case SDT_UINT8: {
-                TypedPredicate<uint8_t>* p = \
-                        new TypedPredicate<uint8_t> \
-                        (ci.idx, ci.type, op_type, \
-                        static_cast<uint8_t>(std::stoul(val)));
-                if (p->isGlobalAgg()) agg_preds.push_back(p);
-                else preds.push_back(p);
-                break;
-            }
-            case SDT_UINT16: {
-                TypedPredicate<uint16_t>* p = \
-                        new TypedPredicate<uint16_t> \
-                        (ci.idx, ci.type, op_type,
-                        static_cast<uint16_t>(std::stoul(val)));
-                if (p->isGlobalAgg()) agg_preds.push_back(p);
-                else preds.push_back(p);
-                break;
-            }
-            case SDT_UINT32: {
-                TypedPredicate<uint32_t>* p = \
-                        new TypedPredicate<uint32_t> \
-                        (ci.idx, ci.type, op_type,
-                        static_cast<uint32_t>(std::stoul(val)));
-                if (p->isGlobalAgg()) agg_preds.push_back(p);
-                else preds.push_back(p);
-                break;
-            }
-            case SDT_UINT64: {
-                TypedPredicate<uint64_t>* p = \
-                        new TypedPredicate<uint64_t> \
-                        (ci.idx, ci.type, op_type, \
-                        static_cast<uint64_t>(std::stoull(val)));
-                if (p->isGlobalAgg()) agg_preds.push_back(p);
-                else preds.push_back(p);
-                break;
-            }
-            case SDT_FLOAT: {
-                TypedPredicate<float>* p = \
-                        new TypedPredicate<float> \
-                        (ci.idx, ci.type, op_type, std::stof(val));
-                if (p->isGlobalAgg()) agg_preds.push_back(p);
-                else preds.push_back(p);
-                break;
-            }
-            case SDT_DOUBLE: {
-                TypedPredicate<double>* p = \
-                        new TypedPredicate<double> \
-                        (ci.idx, ci.type, op_type, std::stod(val));
-                if (p->isGlobalAgg()) agg_preds.push_back(p);
-                else preds.push_back(p);
-                break;
-            }
-            case SDT_CHAR: {
-                assert (val.length() > 0);
-                TypedPredicate<char>* p = \
-                        new TypedPredicate<char> \
-                        (ci.idx, ci.type, op_type, val[0]);
-                if (p->isGlobalAgg()) agg_preds.push_back(p);
-                else preds.push_back(p);
-                break;
-            }
-            case SDT_UCHAR: {
-                assert (val.length() > 0);
-                TypedPredicate<unsigned char>* p = \
-                        new TypedPredicate<unsigned char> \
-                        (ci.idx, ci.type, op_type, val[0]);
-                if (p->isGlobalAgg()) agg_preds.push_back(p);
-                else preds.push_back(p);
-                break;
-            }
-            case SDT_STRING: {
-                TypedPredicate<std::string>* p = \
-                        new TypedPredicate<std::string> \
-                        (ci.idx, ci.type, op_type, val);
-                preds.push_back(p);
-                break;
-            }
-            case SDT_DATE: {
-                TypedPredicate<std::string>* p = \
-                        new TypedPredicate<std::string> \
-                        (ci.idx, ci.type, op_type, val);
-                preds.push_back(p);
-                break;
-            }
-            default: assert (TablesErrCodes::UnknownSkyDataType==0);
+        std::string errmsg;
+        int ret = addPredFromString(ci, op_type, val, preds, agg_preds,
+                                    errmsg);
+        if (ret) {
+            cerr << "Error: " << errmsg << std::endl;
+            assert (ret == 0);
         }
     }
 
-    // add agg preds to end so they are only updated if all other preds pass.
-    // currently in apply_predicates they are applied in order.
-    if (!agg_preds.empty()) {
-        preds.reserve(preds.size() + agg_preds.size());
-        std::move(agg_preds.begin(), agg_preds.end(),
-                  std::inserter(preds, preds.end()));
-        agg_preds.clear();
-        agg_preds.shrink_to_fit();
-    }
+    appendAggPreds(preds, agg_preds);
     return preds;
 }
 
@@ -315,936 +456,2895 @@ std::vector<std::string> colnamesFromSchema(schema_vec &schema) {
     return colnames;
 }
 
-std::string predsToString(predicate_vec &preds, schema_vec &schema) {
-    // output format:  "|orderkey,lt,5|comment,like,he|extendedprice,gt,2.01|"
-    // where '|' and ',' are denoted as PRED_DELIM_OUTER and PRED_DELIM_INNER
+// recursive descent parser for the arithmetic exprs of computed cols:
+//   expr   := term (('+'|'-') term)*
+//   term   := factor (('*'|'/') factor)*
+//   factor := number | colname | reduce '(' colname ')' | '(' expr ')' |
+//             '-' factor
+//   reduce := count | cnt | sum | min | max, over a jagged array col
+struct expr_parser {
+    const std::string& str;
+    size_t pos;
+    schema_vec& schema;
+    expr_vec& exprs;  // preceding computed cols, which may be referenced
+    bool is_double;   // set if any operand is floating point or a division
+    int errcode;      // first error, parsing stops once set
+    std::string errmsg;
+
+    expr_parser(const std::string& s, schema_vec& sc, expr_vec& ev) :
+        str(s), pos(0), schema(sc), exprs(ev), is_double(false),
+        errcode(0) {}
+
+    char peek() {
+        while (pos < str.length() and std::isspace(str[pos])) pos++;
+        return pos < str.length() ? str[pos] : '\0';
+    }
 
-    std::string preds_str;
+    void error(std::string msg,
+               int code=TablesErrCodes::BadExprFormat) {
+        if (errcode) return;
+        errcode = code;
+        errmsg = "expr=" + str + " " + msg + " at pos " + std::to_string(pos);
+    }
+};
 
-    // for each pred specified, we iterate over the schema to find its
-    // correpsonding column index so we can build the col value string
-    // based on col type.
-    for (auto it_prd = preds.begin(); it_prd != preds.end(); ++it_prd) {
-        for (auto it_sch = schema.begin(); it_sch != schema.end(); ++it_sch) {
-            col_info ci = *it_sch;
+static arith_expr_ptr parseExprSum(expr_parser& p);
 
-            // if col indexes match then build the value string.
-            if (((*it_prd)->colIdx() == ci.idx) or
-                ((*it_prd)->colIdx() == RID_COL_INDEX)) {
-                preds_str.append(PRED_DELIM_OUTER);
-                std::string colname;
+static arith_expr_ptr newExprNode(int op, arith_expr_ptr l, arith_expr_ptr r) {
+    arith_expr_ptr e = std::make_shared<arith_expr>();
+    e->op = op;
+    e->left = l;
+    e->right = r;
+    return e;
+}
 
-                // set the column name string
-                if ((*it_prd)->colIdx() == RID_COL_INDEX)
-                    colname = RID_INDEX;  // special col index for RID 'col'
-                else
-                    colname = ci.name;
-                preds_str.append(colname);
-                preds_str.append(PRED_DELIM_INNER);
-                preds_str.append(skyOpTypeToString((*it_prd)->opType()));
-                preds_str.append(PRED_DELIM_INNER);
+// reduce the inner list of a jagged array col to one val per row,
+// e.g., count(MUON_PT). count is an int, others take the element type.
+static arith_expr_ptr parseExprReduce(expr_parser& p, std::string fname) {
+    boost::to_lower(fname);
+    arith_expr_ptr e = std::make_shared<arith_expr>();
+    if (fname == "count" or fname == "cnt")
+        e->agg = SOT_cnt;
+    else if (fname == "sum")
+        e->agg = SOT_sum;
+    else if (fname == "min")
+        e->agg = SOT_min;
+    else if (fname == "max")
+        e->agg = SOT_max;
+    else {
+        p.error("unknown function " + fname);
+        return e;
+    }
 
-                // set the col's value as string based on data type
-                std::string val;
-                switch ((*it_prd)->colType()) {
+    p.pos++;  // '('
+    p.peek();
+    size_t start = p.pos;
+    while (p.pos < p.str.length() and
+           (std::isalnum(p.str[p.pos]) or p.str[p.pos] == '_'))
+        p.pos++;
+    std::string colname = p.str.substr(start, p.pos - start);
+    if (p.peek() != ')') {
+        p.error("missing ')'");
+        return e;
+    }
+    p.pos++;
+
+    boost::to_upper(colname);
+    schema_vec sv = schemaFromColNames(p.schema, colname);
+    if (sv.empty()) {
+        p.error("col " + colname + " not present in schema",
+                TablesErrCodes::RequestedColNotPresent);
+        return e;
+    }
+    const col_info& ci = sv.at(0);
+    int elem_type = jaggedElemType(ci.type);
+    if (!elem_type) {
+        p.error("col " + colname + " is not a jagged array type");
+        return e;
+    }
+    if (e->agg != SOT_cnt and
+        (elem_type == SDT_FLOAT or elem_type == SDT_DOUBLE))
+        p.is_double = true;
 
-                    case SDT_BOOL: {
-                        TypedPredicate<bool>* p = \
-                            dynamic_cast<TypedPredicate<bool>*>(*it_prd);
-                        val = std::string(1, p->Val());
-                        break;
-                    }
-                    case SDT_INT8: {
-                        TypedPredicate<int8_t>* p = \
-                            dynamic_cast<TypedPredicate<int8_t>*>(*it_prd);
-                        val = std::to_string(p->Val());
-                        break;
-                    }
-                    case SDT_INT16: {
-                        TypedPredicate<int16_t>* p = \
-                            dynamic_cast<TypedPredicate<int16_t>*>(*it_prd);
-                        val = std::to_string(p->Val());
-                        break;
-                    }
-                    case SDT_INT32: {
-                        TypedPredicate<int32_t>* p = \
-                            dynamic_cast<TypedPredicate<int32_t>*>(*it_prd);
-                        val = std::to_string(p->Val());
-                        break;
-                    }
-                    case SDT_INT64: {
-                        TypedPredicate<int64_t>* p = \
-                            dynamic_cast<TypedPredicate<int64_t>*>(*it_prd);
-                        val = std::to_string(p->Val());
-                        break;
-                    }
-                    case SDT_UINT8: {
-                        TypedPredicate<uint8_t>* p = \
-                            dynamic_cast<TypedPredicate<uint8_t>*>(*it_prd);
-                        val = std::to_string(p->Val());
-                        break;
-                    }
-                    case SDT_UINT16: {
-                        TypedPredicate<uint16_t>* p = \
-                            dynamic_cast<TypedPredicate<uint16_t>*>(*it_prd);
-                        val = std::to_string(p->Val());
-                        break;
-                    }
-                    case SDT_UINT32: {
-                        TypedPredicate<uint32_t>* p = \
-                            dynamic_cast<TypedPredicate<uint32_t>*>(*it_prd);
-                        val = std::to_string(p->Val());
-                        break;
-                    }
-                    case SDT_UINT64: {
-                        TypedPredicate<uint64_t>* p = \
-                            dynamic_cast<TypedPredicate<uint64_t>*>(*it_prd);
-                        val = std::to_string(p->Val());
-                        break;
-                    }
-                    case SDT_CHAR: {
-                        TypedPredicate<char>* p = \
-                            dynamic_cast<TypedPredicate<char>*>(*it_prd);
-                        val = std::string(1, p->Val());
-                        break;
-                    }
-                    case SDT_UCHAR: {
-                        TypedPredicate<unsigned char>* p = \
-                            dynamic_cast<TypedPredicate<unsigned char>*>(*it_prd);
-                        val = std::string(1, p->Val());
-                        break;
-                    }
-                    case SDT_FLOAT: {
-                        TypedPredicate<float>* p = \
-                            dynamic_cast<TypedPredicate<float>*>(*it_prd);
-                        val = std::to_string(p->Val());
-                        break;
-                    }
-                    case SDT_DOUBLE: {
-                        TypedPredicate<double>* p = \
-                            dynamic_cast<TypedPredicate<double>*>(*it_prd);
-                        val = std::to_string(p->Val());
-                        break;
-                    }
-                    case SDT_STRING:
-                    case SDT_DATE: {
-                        TypedPredicate<std::string>* p = \
-                            dynamic_cast<TypedPredicate<std::string>*>(*it_prd);
-                        val = p->Val();
-                        break;
-                    }
-                    default: assert (!val.empty());
-                }
-                preds_str.append(val);
+    e->col_idx = ci.idx;
+    e->col_type = ci.type;
+    return e;
+}
+
+static arith_expr_ptr parseExprFactor(expr_parser& p) {
+    char c = p.peek();
+
+    if (c == '(') {
+        p.pos++;
+        arith_expr_ptr e = parseExprSum(p);
+        if (p.errcode)
+            return e;
+        if (p.peek() != ')') {
+            p.error("missing ')'");
+            return e;
+        }
+        p.pos++;
+        return e;
+    }
+
+    if (c == '-') {  // unary minus, as 0 - factor
+        p.pos++;
+        return newExprNode(SOT_sub, std::make_shared<arith_expr>(),
+                           parseExprFactor(p));
+    }
+
+    arith_expr_ptr e = std::make_shared<arith_expr>();
+    size_t start = p.pos;
+
+    if (std::isdigit(c) or c == '.') {
+        const std::string& s = p.str;
+        while (p.pos < s.length() and
+               (std::isdigit(s[p.pos]) or s[p.pos] == '.'))
+            p.pos++;
+
+        // optional exponent, e.g., 2e-3
+        if (p.pos < s.length() and (s[p.pos] == 'e' or s[p.pos] == 'E')) {
+            size_t exp = p.pos + 1;
+            if (exp < s.length() and (s[exp] == '+' or s[exp] == '-'))
+                exp++;
+            if (exp < s.length() and std::isdigit(s[exp])) {
+                p.pos = exp;
+                while (p.pos < s.length() and std::isdigit(s[p.pos]))
+                    p.pos++;
             }
-            if ((*it_prd)->colIdx() == RID_COL_INDEX)
-                break;  // only 1 RID col in the schema
         }
+        if (p.pos < s.length() and
+            (std::isalpha(s[p.pos]) or s[p.pos] == '_')) {
+            p.error("bad number");
+            return e;
+        }
+
+        std::string num = s.substr(start, p.pos - start);
+        bool is_double = num.find_first_of(".eE") != std::string::npos;
+        size_t used = 0;
+        try {
+            e->dval = std::stod(num, &used);
+            if (!is_double)
+                e->ival = static_cast<int64_t>(std::stoll(num, &used));
+        }
+        catch (const std::exception&) {
+            used = 0;
+        }
+        if (used != num.length()) {
+            p.error("bad number " + num);
+            return e;
+        }
+        if (is_double)
+            p.is_double = true;
+        return e;
     }
-    preds_str.append(PRED_DELIM_OUTER);
-    return preds_str;
+
+    if (std::isalpha(c) or c == '_') {
+        while (p.pos < p.str.length() and
+               (std::isalnum(p.str[p.pos]) or p.str[p.pos] == '_'))
+            p.pos++;
+        std::string colname = p.str.substr(start, p.pos - start);
+        if (p.peek() == '(')
+            return parseExprReduce(p, colname);
+        boost::to_upper(colname);
+        schema_vec sv = schemaFromColNames(p.schema, colname);
+        if (sv.empty()) {
+            p.error("col " + colname + " not present in schema",
+                    TablesErrCodes::RequestedColNotPresent);
+            return e;
+        }
+        const col_info& ci = sv.at(0);
+
+        // a preceding computed col, substitute its expr tree
+        for (auto it = p.exprs.begin(); it != p.exprs.end(); ++it) {
+            if (it->col.idx == ci.idx) {
+                if (it->col.type == SDT_DOUBLE)
+                    p.is_double = true;
+                return it->expr;
+            }
+        }
+
+        switch (ci.type) {
+            case SDT_FLOAT:
+            case SDT_DOUBLE:
+                p.is_double = true;
+                break;
+            case SDT_INT8:
+            case SDT_INT16:
+            case SDT_INT32:
+            case SDT_INT64:
+            case SDT_UINT8:
+            case SDT_UINT16:
+            case SDT_UINT32:
+            case SDT_UINT64:
+            case SDT_CHAR:
+            case SDT_UCHAR:
+            case SDT_BOOL:
+            case SDT_DATE:
+                break;
+            default:
+                p.error("col " + colname + " is not a numeric type");
+                return e;
+        }
+        e->col_idx = ci.idx;
+        e->col_type = ci.type;
+        return e;
+    }
+
+    p.error("unexpected char");
+    return e;
 }
 
-int skyOpTypeFromString(std::string op) {
-    int op_type = 0;
-    if (op=="lt") op_type = SOT_lt;
-    else if (op=="gt") op_type = SOT_gt;
-    else if (op=="eq") op_type = SOT_eq;
-    else if (op=="ne") op_type = SOT_ne;
-    else if (op=="leq") op_type = SOT_leq;
-    else if (op=="geq") op_type = SOT_geq;
-    else if (op=="add") op_type = SOT_add;
-    else if (op=="sub") op_type = SOT_sub;
-    else if (op=="mul") op_type = SOT_mul;
-    else if (op=="div") op_type = SOT_div;
-    else if (op=="min") op_type = SOT_min;
-    else if (op=="max") op_type = SOT_max;
-    else if (op=="sum") op_type = SOT_sum;
-    else if (op=="cnt") op_type = SOT_cnt;
-    else if (op=="like") op_type = SOT_like;
-    else if (op=="in") op_type = SOT_in;
-    else if (op=="not_in") op_type = SOT_not_in;
-    else if (op=="before") op_type = SOT_before;
-    else if (op=="between") op_type = SOT_between;
-    else if (op=="after") op_type = SOT_after;
-    else if (op=="logical_or") op_type = SOT_logical_or;
-    else if (op=="logical_and") op_type = SOT_logical_and;
-    else if (op=="logical_not") op_type = SOT_logical_not;
-    else if (op=="logical_nor") op_type = SOT_logical_nor;
-    else if (op=="logical_xor") op_type = SOT_logical_xor;
-    else if (op=="logical_nand") op_type = SOT_logical_nand;
-    else if (op=="bitwise_and") op_type = SOT_bitwise_and;
-    else if (op=="bitwise_or") op_type = SOT_bitwise_or;
-    else assert (TablesErrCodes::OpNotRecognized==0);
-    return op_type;
+static arith_expr_ptr parseExprProduct(expr_parser& p) {
+    arith_expr_ptr e = parseExprFactor(p);
+    for (char c = p.peek(); !p.errcode and (c == '*' or c == '/');
+         c = p.peek()) {
+        p.pos++;
+        if (c == '/')
+            p.is_double = true;
+        e = newExprNode(c == '*' ? SOT_mul : SOT_div, e, parseExprFactor(p));
+    }
+    return e;
 }
 
-std::string skyOpTypeToString(int op) {
-    std::string op_str;
-    if (op==SOT_lt) op_str = "lt";
-    else if (op==SOT_gt) op_str = "gt";
-    else if (op==SOT_eq) op_str = "eq";
-    else if (op==SOT_ne) op_str = "ne";
-    else if (op==SOT_leq) op_str = "leq";
-    else if (op==SOT_geq) op_str = "geq";
-    else if (op==SOT_add) op_str = "add";
-    else if (op==SOT_sub) op_str = "sub";
-    else if (op==SOT_mul) op_str = "mul";
-    else if (op==SOT_div) op_str = "div";
-    else if (op==SOT_min) op_str = "min";
-    else if (op==SOT_max) op_str = "max";
-    else if (op==SOT_sum) op_str = "sum";
-    else if (op==SOT_cnt) op_str = "cnt";
-    else if (op==SOT_like) op_str = "like";
-    else if (op==SOT_in) op_str = "in";
-    else if (op==SOT_not_in) op_str = "not_in";
-    else if (op==SOT_before) op_str = "before";
-    else if (op==SOT_between) op_str = "between";
-    else if (op==SOT_after) op_str = "after";
-    else if (op==SOT_logical_or) op_str = "logical_or";
-    else if (op==SOT_logical_and) op_str = "logical_and";
-    else if (op==SOT_logical_not) op_str = "logical_not";
-    else if (op==SOT_logical_nor) op_str = "logical_nor";
-    else if (op==SOT_logical_xor) op_str = "logical_xor";
-    else if (op==SOT_logical_nand) op_str = "logical_nand";
-    else if (op==SOT_bitwise_and) op_str = "bitwise_and";
-    else if (op==SOT_bitwise_or) op_str = "bitwise_or";
-    else assert (!op_str.empty());
-    return op_str;
+static arith_expr_ptr parseExprSum(expr_parser& p) {
+    arith_expr_ptr e = parseExprProduct(p);
+    for (char c = p.peek(); !p.errcode and (c == '+' or c == '-');
+         c = p.peek()) {
+        p.pos++;
+        e = newExprNode(c == '+' ? SOT_add : SOT_sub, e, parseExprProduct(p));
+    }
+    return e;
 }
 
-void printSkyRootHeader(sky_root &r) {
+int exprsFromString(schema_vec &schema,
+                    std::string exprs_string,
+                    expr_vec& exprs,
+                    std::string& errmsg) {
+    // format: NAME=expr;NAME=expr;...
+    // e.g., DISC_PRICE=EXTENDEDPRICE*(1-DISCOUNT);CHARGE=DISC_PRICE*(1+TAX)
 
-    std::cout << "\n\nSKYHOOK_ROOT HEADER"<< std::endl;
-    std::cout << "skyhook_version: "<< r.skyhook_version << std::endl;
-    std::cout << "data_format_type: "<< r.data_format_type << std::endl;
-    std::cout << "data_structure_version: "<< r.data_structure_version << std::endl;
-    std::cout << "data_schema_version: "<< r.data_schema_version << std::endl;
-    std::cout << "db_schema_name: "<< r.db_schema_name << std::endl;
-    std::cout << "table name: "<< r.table_name << std::endl;
-    std::cout << "data_schema: \n"<< r.data_schema << std::endl;
-    std::cout << "delete vector: [";
-        for (int i=0; i< (int)r.delete_vec.size(); i++) {
-            std::cout << (int)r.delete_vec[i];
-            if (i != (int)r.delete_vec.size()-1)
-                std::cout <<", ";
-        }
-    std::cout << "]" << std::endl;
-    std::cout << "nrows: " << r.nrows << std::endl;
-    std::cout << std::endl;
-}
+    exprs.clear();
+    boost::trim(exprs_string);
+    boost::trim_if(exprs_string, boost::is_any_of(PRED_DELIM_OUTER));
+    if (exprs_string.empty()) return 0;
 
-void printSkyRecHeader(sky_rec &r) {
+    vector<std::string> expr_items;
+    boost::split(expr_items, exprs_string, boost::is_any_of(PRED_DELIM_OUTER),
+                 boost::token_compress_on);
 
-    std::cout << "\nSKYHOOK_REC HEADER" << std::endl;
-    std::cout << "RID: "<< r.RID << std::endl;
-    std::string bitstring = "";
-    int64_t val = 0;
-    uint64_t bit = 0;
-    for(int j = 0; j < (int)r.nullbits.size(); j++) {
-        val = r.nullbits.at(j);
-        for (uint64_t k=0; k < 8 * sizeof(r.nullbits.at(j)); k++) {
-            uint64_t mask =  1 << k;
-            ((val&mask)>0) ? bit=1 : bit=0;
-            bitstring.append(std::to_string(bit));
+    // computed cols are appended after the data cols (col idxs need not be
+    // contiguous), and may refer to the computed cols preceding them.
+    int next_idx = 0;
+    for (auto it = schema.begin(); it != schema.end(); ++it)
+        next_idx = std::max(next_idx, it->idx + 1);
+    schema_vec sc = schema;
+    for (auto it = expr_items.begin(); it != expr_items.end(); ++it) {
+        size_t eq = it->find('=');
+        if (eq == std::string::npos) {
+            errmsg.append("expr=" + *it + " expected NAME=expr");
+            exprs.clear();
+            return TablesErrCodes::BadExprFormat;
         }
-        std::cout << "nullbits ["<< j << "]: val=" << val << ": bits="
-                  << bitstring;
-        std::cout << std::endl;
-        bitstring.clear();
+        std::string name = it->substr(0, eq);
+        std::string expr_str = it->substr(eq + 1);
+        boost::trim(name);
+        boost::trim(expr_str);
+        boost::to_upper(name);
+
+        expr_parser p(expr_str, sc, exprs);
+        arith_expr_ptr e = parseExprSum(p);
+        if (p.peek() != '\0')
+            p.error("unexpected trailing chars");
+        if (p.errcode) {
+            errmsg.append(p.errmsg);
+            exprs.clear();
+            return p.errcode;
+        }
+
+        const col_info ci(next_idx++, p.is_double ? SDT_DOUBLE : SDT_INT64,
+                          false, false, name);
+        exprs.push_back(expr_info(ci, e, expr_str));
+        sc.push_back(ci);
     }
+    return 0;
 }
 
-long long int printFlatbufFlexRowAsCsv(
-        const char* dataptr,
-        const size_t datasz,
-        bool print_header,
-        bool print_verbose,
-        long long int max_to_print) {
+std::string exprsToString(expr_vec &exprs) {
+    std::string exprs_str;
+    for (auto it = exprs.begin(); it != exprs.end(); ++it) {
+        exprs_str.append(PRED_DELIM_OUTER);
+        exprs_str.append(it->col.name + "=" + it->expr_str);
+    }
+    return exprs_str;
+}
 
-    // get root table ptr as sky struct
-    sky_root root = getSkyRoot(dataptr, datasz, SFT_FLATBUF_FLEX_ROW);
-    schema_vec sc = schemaFromString(root.data_schema);
-    assert(!sc.empty());
+schema_vec schemaWithExprs(schema_vec &schema, expr_vec &exprs) {
+    schema_vec sc = schema;
+    for (auto it = exprs.begin(); it != exprs.end(); ++it)
+        sc.push_back(it->col);
+    return sc;
+}
 
-    if (print_verbose)
-        printSkyRootHeader(root);
+sort_vec sortKeysFromString(schema_vec &query_schema, std::string sort_string) {
+    // format: ;COL,dir;COL,dir;...
+    // e.g., ;L_SHIPDATE,desc;L_ORDERKEY
 
-    // print header row showing schema
-    if (print_header) {
-        bool first = true;
-        for (schema_vec::iterator it = sc.begin(); it != sc.end(); ++it) {
-            if (!first) std::cout << CSV_DELIM;
-            first = false;
-            std::cout << it->name;
-            if (it->is_key) std::cout << "(key)";
-            if (!it->nullable) std::cout << "(NOT NULL)";
+    sort_vec keys;
+    boost::trim(sort_string);
+    boost::trim_if(sort_string, boost::is_any_of(PRED_DELIM_OUTER));
+    if (sort_string.empty()) return keys;
+
+    vector<std::string> key_items;
+    boost::split(key_items, sort_string, boost::is_any_of(PRED_DELIM_OUTER),
+                 boost::token_compress_on);
 
+    for (auto it = key_items.begin(); it != key_items.end(); ++it) {
+        vector<std::string> parts;
+        boost::split(parts, *it, boost::is_any_of(PRED_DELIM_INNER));
+        std::string name = parts[0];
+        std::string dir = parts.size() > 1 ? parts[1] : "asc";
+        boost::trim(name);
+        boost::trim(dir);
+        boost::to_upper(name);
+        boost::to_lower(dir);
+        if (parts.size() > 2 or (dir != "asc" and dir != "desc")) {
+            cerr << "Error: sort key=" << *it << " expected COL,asc|desc"
+                 << std::endl;
+            assert (TablesErrCodes::BadSortKey == 0);
         }
-        std::cout << std::endl; // newline to start first row.
-    }
 
-    long long int counter = 0;
-    for (uint32_t i = 0; i < root.nrows; i++, counter++) {
-        if (counter >= max_to_print)
+        bool found = false;
+        for (unsigned i = 0; i < query_schema.size(); i++) {
+            col_info& col = query_schema[i];
+            if (!col.compareName(name)) continue;
+            if (col.idx < 0 or col.type < SDT_FIRST or
+                col.type >= SDT_JAGGEDARRAY_BOOL) {
+                cerr << "Error: sort key=" << name << " col type="
+                     << col.type << " is not orderable" << std::endl;
+                assert (TablesErrCodes::BadSortKey == 0);
+            }
+            keys.push_back(sort_key(col, dir == "desc", i));
+            found = true;
             break;
+        }
+        if (!found) {
+            cerr << "Error: sort key=" << name
+                 << " must be a projected col" << std::endl;
+            assert (TablesErrCodes::BadSortKey == 0);
+        }
+    }
+    return keys;
+}
 
-        if (root.delete_vec.at(i) == 1) continue;  // skip dead rows.
+std::string sortKeysToString(const sort_vec &keys) {
+    std::string sort_str;
+    for (auto it = keys.begin(); it != keys.end(); ++it) {
+        sort_str.append(PRED_DELIM_OUTER);
+        sort_str.append(it->col.name + PRED_DELIM_INNER +
+                        (it->desc ? "desc" : "asc"));
+    }
+    return sort_str;
+}
 
-        // get the record struct
-        sky_rec skyrec = \
-            getSkyRec(static_cast<row_offs>(root.data_vec)->Get(i));
+static flatbuffers::Offset<flatbuffers::Vector<flatbuffers::Offset<PlanCol>>>
+planColsFromSchema(flatbuffers::FlatBufferBuilder& fbb,
+                   const schema_vec& schema) {
+    std::vector<flatbuffers::Offset<PlanCol>> cols;
+    for (auto it = schema.begin(); it != schema.end(); ++it) {
+        cols.push_back(CreatePlanCol(fbb, it->idx, it->type, it->is_key,
+                                     it->nullable,
+                                     fbb.CreateString(it->name)));
+    }
+    return fbb.CreateVector(cols);
+}
 
-        // now get the flexbuf row's data as a flexbuf vec
-        auto row = skyrec.data.AsVector();
+// the pred text triples as plan preds, their col names resolved to col idxs
+static int planPredsFromString(flatbuffers::FlatBufferBuilder& fbb,
+                               schema_vec& schema,
+                               std::string preds_string,
+                               flatbuffers::Offset<flatbuffers::Vector<
+                                   flatbuffers::Offset<PlanPred>>>& plan_preds,
+                               std::string& errmsg) {
+    std::vector<flatbuffers::Offset<PlanPred>> preds;
+    boost::trim(preds_string);
+    boost::trim_if(preds_string, boost::is_any_of(PRED_DELIM_OUTER));
+    if (!preds_string.empty() and preds_string != SELECT_DEFAULT) {
+        vector<std::string> pred_items;
+        boost::split(pred_items, preds_string,
+                     boost::is_any_of(PRED_DELIM_OUTER),
+                     boost::token_compress_on);
+        for (auto it = pred_items.begin(); it != pred_items.end(); ++it) {
+            vector<std::string> select_descr;
+            boost::split(select_descr, *it, boost::is_any_of(PRED_DELIM_INNER),
+                         boost::token_compress_on);
+            if (select_descr.size() != 3) {
+                errmsg.append("pred=" + *it + " expected col,op,val");
+                return TablesErrCodes::BadQueryPlan;
+            }
+            std::string colname = select_descr.at(0);
+            boost::to_upper(colname);
+            schema_vec sv = schemaFromColNames(schema, colname);
+            if (sv.empty()) {
+                errmsg.append("col " + colname + " not present in schema");
+                return TablesErrCodes::RequestedColNotPresent;
+            }
+            preds.push_back(CreatePlanPred(fbb, sv.at(0).idx,
+                skyOpTypeFromString(select_descr.at(1)),
+                fbb.CreateString(select_descr.at(2))));
+        }
+    }
+    plan_preds = fbb.CreateVector(preds);
+    return 0;
+}
 
-        if (print_verbose)
-            printSkyRecHeader(skyrec);
+int encodeQueryPlan(const std::string& data_schema,
+                    const std::string& query_schema,
+                    const std::string& query_exprs,
+                    const std::string& query_preds,
+                    bool index_read,
+                    const std::string& index_schema,
+                    const std::string& index_preds,
+                    const std::string& index2_schema,
+                    const std::string& index2_preds,
+                    const std::string& query_sort,
+                    std::string& plan,
+                    std::string& errmsg) {
+
+    schema_vec data_sc = schemaFromString(data_schema);
+    expr_vec exprs;
+    int ret = exprsFromString(data_sc, query_exprs, exprs, errmsg);
+    if (ret)
+        return ret;
+    schema_vec expr_sc = schemaWithExprs(data_sc, exprs);
+
+    flatbuffers::FlatBufferBuilder fbb(1024);
+    auto data_cols = planColsFromSchema(fbb, data_sc);
+    auto query_cols = planColsFromSchema(fbb, schemaFromString(query_schema));
+    auto index_cols = planColsFromSchema(fbb, index_read ?
+        schemaFromString(index_schema) : schema_vec());
+    auto index2_cols = planColsFromSchema(fbb, index_read ?
+        schemaFromString(index2_schema) : schema_vec());
+
+    flatbuffers::Offset<flatbuffers::Vector<flatbuffers::Offset<PlanPred>>>
+        qpreds, ipreds, i2preds;
+    ret = planPredsFromString(fbb, expr_sc, query_preds, qpreds, errmsg);
+    if (!ret)
+        ret = planPredsFromString(fbb, data_sc,
+                                  index_read ? index_preds : "", ipreds,
+                                  errmsg);
+    if (!ret)
+        ret = planPredsFromString(fbb, data_sc,
+                                  index_read ? index2_preds : "", i2preds,
+                                  errmsg);
+    if (ret)
+        return ret;
 
-        // for each col in the row, print a NULL or the col's value/
-        bool first = true;
-        for (uint32_t j = 0; j < sc.size(); j++) {
-            if (!first) std::cout << CSV_DELIM;
-            first = false;
-            col_info col = sc.at(j);
+    auto root = CreateQueryPlan(fbb, QUERY_PLAN_VERSION, index_read,
+                                data_cols, query_cols,
+                                fbb.CreateString(query_exprs), qpreds,
+                                index_cols, ipreds, index2_cols, i2preds,
+                                fbb.CreateString(query_sort));
+    FinishQueryPlanBuffer(fbb, root);
+    plan.assign(reinterpret_cast<const char*>(fbb.GetBufferPointer()),
+                fbb.GetSize());
+    return 0;
+}
 
-            if (col.nullable) {  // check nullbit
-                bool is_null = false;
-                int pos = col.idx / (8*sizeof(skyrec.nullbits.at(0)));
-                int col_bitmask = 1 << col.idx;
-                if ((col_bitmask & skyrec.nullbits.at(pos)) != 0)  {
-                    is_null =true;
-                }
-                if (is_null) {
-                    std::cout << "NULL";
-                    continue;
-                }
-            }
-            switch (col.type) {
-                case SDT_BOOL: std::cout << row[j].AsBool(); break;
-                case SDT_INT8: std::cout << row[j].AsInt8(); break;
-                case SDT_INT16: std::cout << row[j].AsInt16(); break;
-                case SDT_INT32: std::cout << row[j].AsInt32(); break;
-                case SDT_INT64: std::cout << row[j].AsInt64(); break;
-                case SDT_UINT8: std::cout << row[j].AsUInt8(); break;
-                case SDT_UINT16: std::cout << row[j].AsUInt16(); break;
-                case SDT_UINT32: std::cout << row[j].AsUInt32(); break;
-                case SDT_UINT64: std::cout << row[j].AsUInt64(); break;
-                case SDT_FLOAT: std::cout << row[j].AsFloat(); break;
-                case SDT_DOUBLE: std::cout << row[j].AsDouble(); break;
-                case SDT_CHAR: std::cout <<
-                    std::string(1, row[j].AsInt8()); break;
-                case SDT_UCHAR: std::cout <<
-                    std::string(1, row[j].AsUInt8()); break;
-                case SDT_DATE: std::cout <<
-                    row[j].AsString().str(); break;
-                case SDT_STRING: std::cout <<
-                    row[j].AsString().str(); break;
-                default: assert (TablesErrCodes::UnknownSkyDataType);
-            }
-        }
-        std::cout << std::endl;  // newline to start next row.
-    }
-    return counter;
+const QueryPlan* verifyQueryPlan(const char* plan, size_t plan_sz) {
+    flatbuffers::Verifier verifier(reinterpret_cast<const uint8_t*>(plan),
+                                   plan_sz);
+    if (!VerifyQueryPlanBuffer(verifier))
+        return nullptr;
+    const QueryPlan* qp = GetQueryPlan(plan);
+    if (qp->version() < 1 or qp->version() > QUERY_PLAN_VERSION)
+        return nullptr;
+    return qp;
 }
 
-long long int printFlatbufFlexRowAsPGBinary(
-        const char* dataptr,
-        const size_t datasz,
-        bool print_header,
-        bool print_verbose,
-        long long int max_to_print) {
-
-    // get root table ptr as sky struct
-    sky_root root = getSkyRoot(dataptr, datasz, SFT_FLATBUF_FLEX_ROW);
-    schema_vec sc = schemaFromString(root.data_schema);
-    assert(!sc.empty());
-
-    // postgres fstreams expect big endianness
-    bool big_endian = is_big_endian();
-    stringstream ss(std::stringstream::in |
-                    std::stringstream::out|
-                    std::stringstream::binary);
-
-    // print binary stream header sequence first time only
-    if (print_header) {
-
-        // 11 byte signature sequence
-        const char* header_signature = "PGCOPY\n\377\r\n\0";
-        ss.write(header_signature, 11);
-
-        // 32 bit flags field, set bit#16=1 only if OIDs included in data
-        int flags_field = 0;
-        ss.write(reinterpret_cast<const char*>(&flags_field),
-                 sizeof(flags_field));
+schema_vec schemaFromPlan(const flatbuffers::Vector<
+                              flatbuffers::Offset<PlanCol>>* cols) {
+    schema_vec schema;
+    if (!cols)
+        return schema;
+    schema.reserve(cols->size());
+    for (auto it = cols->begin(); it != cols->end(); ++it) {
+        if (it->type() < SDT_FIRST or it->type() > SDT_LAST)
+            return schema_vec();
+        schema.push_back(col_info(it->idx(), it->type(), it->is_key(),
+                                  it->nullable(),
+                                  it->name() ? it->name()->str() : ""));
+    }
+    return schema;
+}
 
-        // 32 bit extra header len
-        int header_extension_len = 0;
-        ss.write(reinterpret_cast<const char*>(&header_extension_len),
-                 sizeof(header_extension_len));
+int predsFromPlan(schema_vec& schema,
+                  const flatbuffers::Vector<flatbuffers::Offset<PlanPred>>* pp,
+                  predicate_vec& preds,
+                  std::string& errmsg) {
+    if (!pp)
+        return 0;
+    predicate_vec agg_preds;
+    for (auto it = pp->begin(); it != pp->end(); ++it) {
+        const col_info* ci = nullptr;
+        col_info rid(RID_COL_INDEX, SDT_UINT64, true, false, RID_INDEX);
+        if (it->col_idx() == RID_COL_INDEX)
+            ci = &rid;
+        for (auto c = schema.begin(); c != schema.end() and !ci; ++c) {
+            if (c->idx == it->col_idx())
+                ci = &(*c);
+        }
+        if (!ci) {
+            errmsg.append("pred col idx " + std::to_string(it->col_idx()) +
+                          " not present in schema");
+            for (auto p : preds) delete p;
+            for (auto p : agg_preds) delete p;
+            preds.clear();
+            return TablesErrCodes::RequestedColNotPresent;
+        }
+        if (it->op() < SOT_FIRST or it->op() > SOT_LAST) {
+            errmsg.append("pred op " + std::to_string(it->op()) +
+                          " not recognized");
+            for (auto p : preds) delete p;
+            for (auto p : agg_preds) delete p;
+            preds.clear();
+            return TablesErrCodes::OpNotRecognized;
+        }
+        int ret = addPredFromString(*ci, it->op(),
+                                    it->val() ? it->val()->str() : "",
+                                    preds, agg_preds, errmsg);
+        if (ret) {
+            for (auto p : preds) delete p;
+            for (auto p : agg_preds) delete p;
+            preds.clear();
+            return ret;
+        }
     }
+    appendAggPreds(preds, agg_preds);
+    return 0;
+}
 
-    // 16 bit int, assumes same num cols for all rows below.
-    int16_t ncols = static_cast<int16_t>(sc.size());
-    if (!big_endian)
-        ncols = __builtin_bswap16(ncols);
+// flip the sign bit so that signed order is unsigned order
+uint64_t sortNormInt(int64_t v) {
+    return static_cast<uint64_t>(v) ^ (1ULL << 63);
+}
 
-    // row printing counter, used with --limit flag
-    long long int counter = 0;
-    for (uint32_t i = 0; i < root.nrows; i++, counter++) {
-        if (counter >= max_to_print) break;
-        if (root.delete_vec.at(i) == 1) continue;
+// ieee754: set the sign bit of positives, invert all bits of negatives
+uint64_t sortNormDouble(double v) {
+    uint64_t u;
+    memcpy(&u, &v, sizeof(u));
+    return (u & (1ULL << 63)) ? ~u : (u | (1ULL << 63));
+}
 
-        // get the record struct
-        sky_rec skyrec = \
-            getSkyRec(static_cast<row_offs>(root.data_vec)->Get(i));
+void sortColAddNorm(sort_col& sc, uint64_t v) {
+    sc.nvals.push_back(sc.desc ? ~v : v);
+}
 
-        // 16 bit int num cols in this row (all rows same ncols currently)
-        ss.write(reinterpret_cast<const char*>(&ncols), sizeof(ncols));
+void sortColAddStr(sort_col& sc, const std::string& v) {
+    uint64_t prefix = 0;
+    for (unsigned i = 0; i < sizeof(prefix); i++) {
+        prefix <<= 8;
+        if (i < v.length())
+            prefix |= static_cast<uint8_t>(v[i]);
+    }
+    sortColAddNorm(sc, prefix);
+    sc.svals.push_back(v);
+}
 
-        // get the flexbuf row's data as a flexbuf vec
-        auto row = skyrec.data.AsVector();
+void sortColAddFlex(sort_col& sc, const flexbuffers::Reference& ref, int type) {
+    switch (type) {
+        case SDT_INT8:
+        case SDT_INT16:
+        case SDT_INT32:
+        case SDT_INT64:
+        case SDT_CHAR:
+            sortColAddNorm(sc, sortNormInt(ref.AsInt64()));
+            break;
+        case SDT_UINT8:
+        case SDT_UINT16:
+        case SDT_UINT32:
+        case SDT_UINT64:
+        case SDT_UCHAR:
+            sortColAddNorm(sc, ref.AsUInt64());
+            break;
+        case SDT_BOOL:
+            sortColAddNorm(sc, ref.AsBool());
+            break;
+        case SDT_FLOAT:
+        case SDT_DOUBLE:
+            sortColAddNorm(sc, sortNormDouble(ref.AsDouble()));
+            break;
+        case SDT_DATE:
+            sortColAddNorm(sc, sortNormInt(flexDateToDays(ref)));
+            break;
+        case SDT_STRING:
+            sortColAddStr(sc, ref.AsString().str());
+            break;
+        default:
+            assert (TablesErrCodes::BadSortKey == 0);
+    }
+}
 
-        // for each col in the row, print a NULL or the col's value/
-        for (unsigned j = 0; j < sc.size(); j++ ) {
+// nulls take the least normalized key, so they sort first for asc and last
+// for desc keys, tied with the min val of the type (e.g. INT64_MIN or "")
+void sortColAddArrow(sort_col& sc,
+                     const std::shared_ptr<arrow::Array>& arr,
+                     int type,
+                     uint32_t row) {
+    if (arr->IsNull(row)) {
+        if (sc.is_str)
+            sortColAddStr(sc, "");
+        else
+            sortColAddNorm(sc, 0);
+        return;
+    }
+    switch (type) {
+        case SDT_BOOL:
+            sortColAddNorm(sc,
+                std::static_pointer_cast<arrow::BooleanArray>(arr)->Value(row));
+            break;
+        case SDT_INT8:
+        case SDT_CHAR:
+            sortColAddNorm(sc, sortNormInt(
+                std::static_pointer_cast<arrow::Int8Array>(arr)->Value(row)));
+            break;
+        case SDT_INT16:
+            sortColAddNorm(sc, sortNormInt(
+                std::static_pointer_cast<arrow::Int16Array>(arr)->Value(row)));
+            break;
+        case SDT_INT32:
+            sortColAddNorm(sc, sortNormInt(
+                std::static_pointer_cast<arrow::Int32Array>(arr)->Value(row)));
+            break;
+        case SDT_INT64:
+            sortColAddNorm(sc, sortNormInt(
+                std::static_pointer_cast<arrow::Int64Array>(arr)->Value(row)));
+            break;
+        case SDT_UINT8:
+        case SDT_UCHAR:
+            sortColAddNorm(sc,
+                std::static_pointer_cast<arrow::UInt8Array>(arr)->Value(row));
+            break;
+        case SDT_UINT16:
+            sortColAddNorm(sc,
+                std::static_pointer_cast<arrow::UInt16Array>(arr)->Value(row));
+            break;
+        case SDT_UINT32:
+            sortColAddNorm(sc,
+                std::static_pointer_cast<arrow::UInt32Array>(arr)->Value(row));
+            break;
+        case SDT_UINT64:
+            sortColAddNorm(sc,
+                std::static_pointer_cast<arrow::UInt64Array>(arr)->Value(row));
+            break;
+        case SDT_FLOAT:
+            sortColAddNorm(sc, sortNormDouble(
+                std::static_pointer_cast<arrow::FloatArray>(arr)->Value(row)));
+            break;
+        case SDT_DOUBLE:
+            sortColAddNorm(sc, sortNormDouble(
+                std::static_pointer_cast<arrow::DoubleArray>(arr)->Value(row)));
+            break;
+        case SDT_DATE:
+            sortColAddNorm(sc, sortNormInt(
+                std::static_pointer_cast<arrow::Date32Array>(arr)->Value(row)));
+            break;
+        case SDT_STRING:
+            sortColAddStr(sc,
+                std::static_pointer_cast<arrow::StringArray>(arr)->GetString(row));
+            break;
+        default:
+            assert (TablesErrCodes::BadSortKey == 0);
+    }
+}
 
-            col_info col = sc.at(j);
+// LSD radix sort of keys (carrying perm along) with 8 bit digits.  digits
+// that are the same for all keys are skipped, so narrow key ranges such as
+// dates or small ints only take a pass or two over the rows.
+static void radixSortKeys(std::vector<uint64_t>& keys,
+                          std::vector<uint32_t>& perm) {
+    const int DIGIT_BITS = 8;
+    const int NDIGITS = 64 / DIGIT_BITS;
+    const uint32_t NBUCKETS = 1 << DIGIT_BITS;
+    const size_t n = keys.size();
+
+    std::vector<uint32_t> counts(NDIGITS * NBUCKETS, 0);
+    for (size_t i = 0; i < n; i++) {
+        uint64_t k = keys[i];
+        for (int d = 0; d < NDIGITS; d++, k >>= DIGIT_BITS)
+            counts[d * NBUCKETS + (k & (NBUCKETS - 1))]++;
+    }
 
-            if (col.nullable) {  // check nullbit
-                bool is_null = false;
-                int pos = col.idx / (8*sizeof(skyrec.nullbits.at(0)));
-                int col_bitmask = 1 << col.idx;
-                if ((col_bitmask & skyrec.nullbits.at(pos)) != 0)  {
-                    is_null = true;
-                }
-                if (is_null) {
-                    // for null we only write the int representation of null,
-                    // followed by no data
-                    ss.write(reinterpret_cast<const char*>(&PGNULLBINARY),
-                             sizeof(PGNULLBINARY));
-                    continue;
-                }
-            }
+    std::vector<uint64_t> keys_out(n);
+    std::vector<uint32_t> perm_out(n);
+    for (int d = 0; d < NDIGITS; d++) {
+        uint32_t* cnt = &counts[d * NBUCKETS];
+        int shift = d * DIGIT_BITS;
+        if (cnt[(keys[0] >> shift) & (NBUCKETS - 1)] == n)
+            continue;
+        uint32_t sum = 0;
+        for (uint32_t b = 0; b < NBUCKETS; b++) {
+            uint32_t c = cnt[b];
+            cnt[b] = sum;
+            sum += c;
+        }
+        for (size_t i = 0; i < n; i++) {
+            uint32_t dst = cnt[(keys[i] >> shift) & (NBUCKETS - 1)]++;
+            keys_out[dst] = keys[i];
+            perm_out[dst] = perm[i];
+        }
+        keys.swap(keys_out);
+        perm.swap(perm_out);
+    }
+}
 
-            // for each col, write 32 bit data len followed by data as char*
-            switch (col.type) {
+void sortPermutation(sort_cols& cols, std::vector<uint32_t>& perm) {
+    perm.clear();
+    if (cols.empty()) return;
+    const uint32_t n = cols[0].nvals.size();
+    perm.resize(n);
+    for (uint32_t i = 0; i < n; i++)
+        perm[i] = i;
+    if (n < 2) return;
+
+    // radix sort pays off for a single non-string key past a few rows
+    const uint32_t RADIX_SORT_MIN_ROWS = 256;
+    if (cols.size() == 1 and !cols[0].is_str and n >= RADIX_SORT_MIN_ROWS) {
+        std::vector<uint64_t> keys = cols[0].nvals;
+        radixSortKeys(keys, perm);
+        return;
+    }
 
-            case SDT_BOOL: {
-                uint8_t val = row[j].AsBool();
-                int32_t len = sizeof(val);
-                if (!big_endian) {
-                    // val is single byte, has no endianness
-                    len = __builtin_bswap32(len);
-                }
-                ss.write(reinterpret_cast<const char*>(&len), sizeof(len));
-                ss.write(reinterpret_cast<const char*>(&val), sizeof(val));
-                break;
-            }
-            case SDT_INT8: {
-                int8_t val = row[j].AsInt8();
-                int32_t len = sizeof(val);
-                if (!big_endian) {
-                    // val is single byte, has no endianness
-                    len = __builtin_bswap32(len);
-                }
-                ss.write(reinterpret_cast<const char*>(&len), sizeof(len));
-                ss.write(reinterpret_cast<const char*>(&val), sizeof(val));
-                break;
-            }
-            case SDT_INT16: {
-                int16_t val = row[j].AsInt16();
-                int32_t len = sizeof(val);
-                if (!big_endian) {
-                    val = __builtin_bswap16(val);
-                    len = __builtin_bswap32(len);
-                }
-                ss.write(reinterpret_cast<const char*>(&len), sizeof(len));
-                ss.write(reinterpret_cast<const char*>(&val), sizeof(val));
-                break;
-            }
-            case SDT_INT32: {
-                int32_t val = row[j].AsInt32();
-                int32_t len = sizeof(val);
-                if (!big_endian) {
-                    val = __builtin_bswap32(val);
-                    len = __builtin_bswap32(len);
-                }
-                ss.write(reinterpret_cast<const char*>(&len), sizeof(len));
-                ss.write(reinterpret_cast<const char*>(&val), sizeof(val));
-                break;
-            }
-            case SDT_INT64: {
-                int64_t val = row[j].AsInt64();
-                int32_t len = sizeof(val);
-                if (!big_endian) {
-                    val = __builtin_bswap64(val);
-                    len = __builtin_bswap32(len);
-                }
-                ss.write(reinterpret_cast<const char*>(&len), sizeof(len));
-                ss.write(reinterpret_cast<const char*>(&val), sizeof(val));
-                break;
-            }
-            case SDT_UINT8: {
-                uint8_t val = row[j].AsUInt8();
-                int32_t len = sizeof(val);
-                if (!big_endian) {
-                    // val is single byte, has no endianness
-                    len = __builtin_bswap32(len);
-                }
-                ss.write(reinterpret_cast<const char*>(&len), sizeof(len));
-                ss.write(reinterpret_cast<const char*>(&val), sizeof(val));
-                break;
-            }
-            case SDT_UINT16: {
-                uint16_t val = row[j].AsUInt16();
-                int32_t len = sizeof(val);
-                if (!big_endian) {
-                    val = __builtin_bswap16(val);
-                    len = __builtin_bswap32(len);
-                }
-                ss.write(reinterpret_cast<const char*>(&len), sizeof(len));
-                ss.write(reinterpret_cast<const char*>(&val), sizeof(val));
-                break;
-            }
-            case SDT_UINT32: {
-                uint32_t val = row[j].AsUInt32();
-                int32_t len = sizeof(val);
-                if (!big_endian) {
-                    val = __builtin_bswap32(val);
-                    len = __builtin_bswap32(len);
-                }
-                ss.write(reinterpret_cast<const char*>(&len), sizeof(len));
-                ss.write(reinterpret_cast<const char*>(&val), sizeof(val));
-                break;
-            }
-            case SDT_UINT64: {
-                uint64_t val = row[j].AsUInt64();
-                int32_t len = sizeof(val);
-                if (!big_endian) {
-                    val = __builtin_bswap64(val);
-                    len = __builtin_bswap32(len);
-                }
-                ss.write(reinterpret_cast<const char*>(&len), sizeof(len));
-                ss.write(reinterpret_cast<const char*>(&val), sizeof(val));
-                break;
-            }
-            case SDT_FLOAT:    // postgres float is alias for double
-            case SDT_DOUBLE: {
+    // otherwise sort (key, row) pairs so most compares are decided on the
+    // contiguous leading normalized key, falling back to the remaining
+    // key cols (and full string vals) on ties.  row breaks final ties to
+    // keep the sort stable.
+    struct sort_ent {
+        uint64_t key;
+        uint32_t row;
+    };
+    std::vector<sort_ent> ents(n);
+    for (uint32_t i = 0; i < n; i++)
+        ents[i] = {cols[0].nvals[i], i};
+
+    std::sort(ents.begin(), ents.end(),
+        [&cols](const sort_ent& a, const sort_ent& b) {
+            if (a.key != b.key) return a.key < b.key;
+            int cmp = compareSortCols(cols, a.row, cols, b.row);
+            return cmp != 0 ? cmp < 0 : a.row < b.row;
+        });
+    for (uint32_t i = 0; i < n; i++)
+        perm[i] = ents[i].row;
+}
 
-                double val = 0.0;
-                if (col.type == SDT_FLOAT)
-                    val = row[j].AsFloat();  // flexbuf api requires type
-                else
-                    val = row[j].AsDouble();
-                int32_t len = sizeof(val);
-                if (!big_endian) {
-                    char val_bigend[len];
-                    char* vptr = (char*)&val;
-                    val_bigend[0]=vptr[7];
-                    val_bigend[1]=vptr[6];
-                    val_bigend[2]=vptr[5];
-                    val_bigend[3]=vptr[4];
-                    val_bigend[4]=vptr[3];
-                    val_bigend[5]=vptr[2];
-                    val_bigend[6]=vptr[1];
-                    val_bigend[7]=vptr[0];
-                    len = __builtin_bswap32(len);
-                    ss.write(reinterpret_cast<const char*>(&len), sizeof(len));
-                    ss.write(val_bigend, sizeof(val));
-                }
-                else {
-                    ss.write(reinterpret_cast<const char*>(&len), sizeof(len));
-                    ss.write(reinterpret_cast<const char*>(&val), sizeof(val));
-                }
-                break;
-            }
-            case SDT_CHAR: {
-                int8_t val = row[j].AsInt8();
-                int32_t len = sizeof(val);
-                if (!big_endian) {
-                    // val is single byte, has no endianness
-                    len = __builtin_bswap32(len);
-                }
-                ss.write(reinterpret_cast<const char*>(&len), sizeof(len));
-                ss.write(reinterpret_cast<const char*>(&val), sizeof(val));
-                break;
-            }
-            case SDT_UCHAR: {
-                uint8_t val = row[j].AsUInt8();
-                int32_t len = sizeof(val);
-                if (!big_endian) {
-                    // val is single byte, has no endianness
-                    len = __builtin_bswap32(len);
-                }
-                ss.write(reinterpret_cast<const char*>(&len), sizeof(len));
-                ss.write(reinterpret_cast<const char*>(&val), sizeof(val));
-                break;
-            }
-            case SDT_DATE: {
-                // postgres uses 4 byte int date vals, offset by pg epoch
-                std::string strdate = row[j].AsString().str();
-                int32_t len = 4;  // fixed, postgres date specification
-                boost::gregorian::date d = \
-                    boost::gregorian::from_string(strdate);
-                int32_t val = d.julian_day() - Tables::POSTGRES_EPOCH_JDATE;
-                if (!big_endian) {
-                    val = __builtin_bswap32(val);
-                    len = __builtin_bswap32(len);
-                }
-                ss.write(reinterpret_cast<const char*>(&len), sizeof(len));
-                ss.write(reinterpret_cast<const char*>(&val), sizeof(val));
-                break;
-            }
-            case SDT_STRING: {
-                std::string val = row[j].AsString().str();
-                int32_t len = val.length();
-                if (!big_endian) {
-                    // val is byte array, has no endianness
-                    len = __builtin_bswap32(len);
-                }
-                ss.write(reinterpret_cast<const char*>(&len), sizeof(len));
-                ss.write(val.c_str(), static_cast<int>(val.length()));
-                break;
-            }
-            default: assert (TablesErrCodes::UnknownSkyDataType);
-            }
+int compareSortCols(const sort_cols& a, uint32_t ra,
+                    const sort_cols& b, uint32_t rb) {
+    for (unsigned c = 0; c < a.size(); c++) {
+        uint64_t va = a[c].nvals[ra];
+        uint64_t vb = b[c].nvals[rb];
+        if (va != vb)
+            return va < vb ? -1 : 1;
+        if (a[c].is_str) {
+            int cmp = a[c].svals[ra].compare(b[c].svals[rb]);
+            if (cmp != 0)
+                return a[c].desc ? -cmp : cmp;
         }
     }
-
-    // rewind and output all row data for this fb
-    ss.seekg (0, ios::beg);
-    std::cout << ss.rdbuf();
-    ss.flush();
-    return counter;
+    return 0;
 }
 
-long long int printJSONAsCsv(
-        const char* dataptr,
-        const size_t datasz,
-        bool print_header,
-        bool print_verbose,
-        long long int max_to_print) {
-
-    // get root table ptr as sky struct
-    sky_root root = getSkyRoot(dataptr, datasz, SFT_JSON);
-    schema_vec sc = schemaFromString(root.data_schema);
-    assert(!sc.empty());
-
-    if (print_verbose)
-        printSkyRootHeader(root);
+template <typename T>
+static std::string joinPredVals(PredicateBase* pb) {
+    TypedPredicate<T>* p = dynamic_cast<TypedPredicate<T>*>(pb);
+    std::string s;
+    for (auto it = p->Vals().begin(); it != p->Vals().end(); ++it) {
+        if (it != p->Vals().begin()) s.append(PRED_DELIM_LIST);
+        if (p->colType() == SDT_DATE)
+            s.append(daysToDate(*it));
+        else
+            s.append(std::to_string(*it));
+    }
+    return s;
+}
 
-    // print header row showing schema
-    if (print_header) {
-        bool first = true;
-        for (schema_vec::iterator it = sc.begin(); it != sc.end(); ++it) {
-            if (!first) std::cout << CSV_DELIM;
-            first = false;
-            std::cout << it->name;
-            if (it->is_key) std::cout << "(key)";
-            if (!it->nullable) std::cout << "(NOT NULL)";
+template <>
+std::string joinPredVals<std::string>(PredicateBase* pb) {
+    TypedPredicate<std::string>* p = \
+        dynamic_cast<TypedPredicate<std::string>*>(pb);
+    return boost::algorithm::join(p->Vals(), PRED_DELIM_LIST);
+}
 
+// in/not_in/between vals, see listPredFromString
+static std::string listPredValsToString(PredicateBase* pb) {
+    switch (pb->colType()) {
+        case SDT_BOOL: return joinPredVals<bool>(pb);
+        case SDT_INT8: return joinPredVals<int8_t>(pb);
+        case SDT_INT16: return joinPredVals<int16_t>(pb);
+        case SDT_INT32: return joinPredVals<int32_t>(pb);
+        case SDT_INT64: return joinPredVals<int64_t>(pb);
+        case SDT_UINT8: return joinPredVals<uint8_t>(pb);
+        case SDT_UINT16: return joinPredVals<uint16_t>(pb);
+        case SDT_UINT32: return joinPredVals<uint32_t>(pb);
+        case SDT_UINT64: return joinPredVals<uint64_t>(pb);
+        case SDT_FLOAT: return joinPredVals<float>(pb);
+        case SDT_DOUBLE: return joinPredVals<double>(pb);
+        case SDT_DATE: return joinPredVals<int32_t>(pb);
+        case SDT_STRING: return joinPredVals<std::string>(pb);
+        case SDT_CHAR: {
+            TypedPredicate<char>* p = \
+                dynamic_cast<TypedPredicate<char>*>(pb);
+            std::vector<std::string> vals;
+            for (auto c : p->Vals()) vals.push_back(std::string(1, c));
+            return boost::algorithm::join(vals, PRED_DELIM_LIST);
         }
-        std::cout << std::endl; // newline to start first row.
+        case SDT_UCHAR: {
+            TypedPredicate<unsigned char>* p = \
+                dynamic_cast<TypedPredicate<unsigned char>*>(pb);
+            std::vector<std::string> vals;
+            for (auto c : p->Vals()) vals.push_back(std::string(1, c));
+            return boost::algorithm::join(vals, PRED_DELIM_LIST);
+        }
+        default: assert (TablesErrCodes::UnknownSkyDataType==0);
     }
+    return std::string();
+}
 
-    // iterate over each row data (Record_FBX)
-    // NOTE: JSON stores all rows (json objs) in single record currently.
-    long long int counter = 0;
-    for (uint32_t i = 0; i < root.nrows; i++, counter++) {
-        if (counter >= max_to_print)
-            break;
-
-        if (root.delete_vec.at(i) == 1) continue;  // skip dead rows.
-
-        // get the root pointer from skyhookv2_csv.fbs, used for json and
-        // csv text data
-        const Table_FBX* rootfbx = GetTable_FBX(dataptr);
+std::string predsToString(predicate_vec &preds, schema_vec &schema) {
+    // output format:  "|orderkey,lt,5|comment,like,he|extendedprice,gt,2.01|"
+    // where '|' and ',' are denoted as PRED_DELIM_OUTER and PRED_DELIM_INNER
 
-        // ptr to records offsets
-        const flatbuffers::Vector<flatbuffers::Offset<Record_FBX>>* \
-            offs = rootfbx->rows_vec();
+    std::string preds_str;
+
+    // for each pred specified, we iterate over the schema to find its
+    // correpsonding column index so we can build the col value string
+    // based on col type.
+    for (auto it_prd = preds.begin(); it_prd != preds.end(); ++it_prd) {
+        for (auto it_sch = schema.begin(); it_sch != schema.end(); ++it_sch) {
+            col_info ci = *it_sch;
+
+            // if col indexes match then build the value string.
+            if (((*it_prd)->colIdx() == ci.idx) or
+                ((*it_prd)->colIdx() == RID_COL_INDEX)) {
+                preds_str.append(PRED_DELIM_OUTER);
+                std::string colname;
+
+                // set the column name string
+                if ((*it_prd)->colIdx() == RID_COL_INDEX)
+                    colname = RID_INDEX;  // special col index for RID 'col'
+                else
+                    colname = ci.name;
+                preds_str.append(colname);
+                preds_str.append(PRED_DELIM_INNER);
+                preds_str.append(skyOpTypeToString((*it_prd)->opType()));
+                preds_str.append(PRED_DELIM_INNER);
+
+                // set the col's value as string based on data type
+                std::string val;
+                if (isListOp((*it_prd)->opType()))
+                    val = listPredValsToString(*it_prd);
+                else if (isSketchAgg((*it_prd)->opType()))
+                    val = std::to_string(dynamic_cast<TypedPredicate<double>*>(
+                                            *it_prd)->Val());
+                else if ((*it_prd)->opType() == SOT_sample) {
+                    SamplePredicate* p = \
+                        dynamic_cast<SamplePredicate*>(*it_prd);
+                    std::ostringstream ss;
+                    ss.precision(17);  // to_string keeps only 6 decimals
+                    ss << p->Fraction() << ":" << p->Val();
+                    val = ss.str();
+                }
+                else switch ((*it_prd)->colType()) {
+
+                    case SDT_BOOL: {
+                        TypedPredicate<bool>* p = \
+                            dynamic_cast<TypedPredicate<bool>*>(*it_prd);
+                        val = std::string(1, p->Val());
+                        break;
+                    }
+                    case SDT_INT8: {
+                        TypedPredicate<int8_t>* p = \
+                            dynamic_cast<TypedPredicate<int8_t>*>(*it_prd);
+                        val = std::to_string(p->Val());
+                        break;
+                    }
+                    case SDT_INT16: {
+                        TypedPredicate<int16_t>* p = \
+                            dynamic_cast<TypedPredicate<int16_t>*>(*it_prd);
+                        val = std::to_string(p->Val());
+                        break;
+                    }
+                    case SDT_INT32: {
+                        TypedPredicate<int32_t>* p = \
+                            dynamic_cast<TypedPredicate<int32_t>*>(*it_prd);
+                        val = std::to_string(p->Val());
+                        break;
+                    }
+                    case SDT_INT64: {
+                        TypedPredicate<int64_t>* p = \
+                            dynamic_cast<TypedPredicate<int64_t>*>(*it_prd);
+                        val = std::to_string(p->Val());
+                        break;
+                    }
+                    case SDT_UINT8: {
+                        TypedPredicate<uint8_t>* p = \
+                            dynamic_cast<TypedPredicate<uint8_t>*>(*it_prd);
+                        val = std::to_string(p->Val());
+                        break;
+                    }
+                    case SDT_UINT16: {
+                        TypedPredicate<uint16_t>* p = \
+                            dynamic_cast<TypedPredicate<uint16_t>*>(*it_prd);
+                        val = std::to_string(p->Val());
+                        break;
+                    }
+                    case SDT_UINT32: {
+                        TypedPredicate<uint32_t>* p = \
+                            dynamic_cast<TypedPredicate<uint32_t>*>(*it_prd);
+                        val = std::to_string(p->Val());
+                        break;
+                    }
+                    case SDT_UINT64: {
+                        TypedPredicate<uint64_t>* p = \
+                            dynamic_cast<TypedPredicate<uint64_t>*>(*it_prd);
+                        val = std::to_string(p->Val());
+                        break;
+                    }
+                    case SDT_CHAR: {
+                        TypedPredicate<char>* p = \
+                            dynamic_cast<TypedPredicate<char>*>(*it_prd);
+                        val = std::string(1, p->Val());
+                        break;
+                    }
+                    case SDT_UCHAR: {
+                        TypedPredicate<unsigned char>* p = \
+                            dynamic_cast<TypedPredicate<unsigned char>*>(*it_prd);
+                        val = std::string(1, p->Val());
+                        break;
+                    }
+                    case SDT_FLOAT: {
+                        TypedPredicate<float>* p = \
+                            dynamic_cast<TypedPredicate<float>*>(*it_prd);
+                        val = std::to_string(p->Val());
+                        break;
+                    }
+                    case SDT_DOUBLE: {
+                        TypedPredicate<double>* p = \
+                            dynamic_cast<TypedPredicate<double>*>(*it_prd);
+                        val = std::to_string(p->Val());
+                        break;
+                    }
+                    case SDT_DATE: {
+                        TypedPredicate<int32_t>* p = \
+                            dynamic_cast<TypedPredicate<int32_t>*>(*it_prd);
+                        val = daysToDate(p->Val());
+                        break;
+                    }
+                    case SDT_STRING: {
+                        TypedPredicate<std::string>* p = \
+                            dynamic_cast<TypedPredicate<std::string>*>(*it_prd);
+                        val = p->Val();
+                        break;
+                    }
+                    default: assert (!val.empty());
+                }
+                preds_str.append(val);
+            }
+            if ((*it_prd)->colIdx() == RID_COL_INDEX)
+                break;  // only 1 RID col in the schema
+        }
+    }
+    preds_str.append(PRED_DELIM_OUTER);
+    return preds_str;
+}
+
+int skyOpTypeFromString(std::string op) {
+    int op_type = 0;
+    if (op=="lt") op_type = SOT_lt;
+    else if (op=="gt") op_type = SOT_gt;
+    else if (op=="eq") op_type = SOT_eq;
+    else if (op=="ne") op_type = SOT_ne;
+    else if (op=="leq") op_type = SOT_leq;
+    else if (op=="geq") op_type = SOT_geq;
+    else if (op=="add") op_type = SOT_add;
+    else if (op=="sub") op_type = SOT_sub;
+    else if (op=="mul") op_type = SOT_mul;
+    else if (op=="div") op_type = SOT_div;
+    else if (op=="min") op_type = SOT_min;
+    else if (op=="max") op_type = SOT_max;
+    else if (op=="sum") op_type = SOT_sum;
+    else if (op=="cnt") op_type = SOT_cnt;
+    else if (op=="like") op_type = SOT_like;
+    else if (op=="in") op_type = SOT_in;
+    else if (op=="not_in") op_type = SOT_not_in;
+    else if (op=="before") op_type = SOT_before;
+    else if (op=="between") op_type = SOT_between;
+    else if (op=="after") op_type = SOT_after;
+    else if (op=="logical_or") op_type = SOT_logical_or;
+    else if (op=="logical_and") op_type = SOT_logical_and;
+    else if (op=="logical_not") op_type = SOT_logical_not;
+    else if (op=="logical_nor") op_type = SOT_logical_nor;
+    else if (op=="logical_xor") op_type = SOT_logical_xor;
+    else if (op=="logical_nand") op_type = SOT_logical_nand;
+    else if (op=="bitwise_and") op_type = SOT_bitwise_and;
+    else if (op=="bitwise_or") op_type = SOT_bitwise_or;
+    else if (op=="approx_distinct") op_type = SOT_approx_distinct;
+    else if (op=="approx_quantile") op_type = SOT_approx_quantile;
+    else if (op=="sample") op_type = SOT_sample;
+    else assert (TablesErrCodes::OpNotRecognized==0);
+    return op_type;
+}
+
+std::string skyOpTypeToString(int op) {
+    std::string op_str;
+    if (op==SOT_lt) op_str = "lt";
+    else if (op==SOT_gt) op_str = "gt";
+    else if (op==SOT_eq) op_str = "eq";
+    else if (op==SOT_ne) op_str = "ne";
+    else if (op==SOT_leq) op_str = "leq";
+    else if (op==SOT_geq) op_str = "geq";
+    else if (op==SOT_add) op_str = "add";
+    else if (op==SOT_sub) op_str = "sub";
+    else if (op==SOT_mul) op_str = "mul";
+    else if (op==SOT_div) op_str = "div";
+    else if (op==SOT_min) op_str = "min";
+    else if (op==SOT_max) op_str = "max";
+    else if (op==SOT_sum) op_str = "sum";
+    else if (op==SOT_cnt) op_str = "cnt";
+    else if (op==SOT_like) op_str = "like";
+    else if (op==SOT_in) op_str = "in";
+    else if (op==SOT_not_in) op_str = "not_in";
+    else if (op==SOT_before) op_str = "before";
+    else if (op==SOT_between) op_str = "between";
+    else if (op==SOT_after) op_str = "after";
+    else if (op==SOT_logical_or) op_str = "logical_or";
+    else if (op==SOT_logical_and) op_str = "logical_and";
+    else if (op==SOT_logical_not) op_str = "logical_not";
+    else if (op==SOT_logical_nor) op_str = "logical_nor";
+    else if (op==SOT_logical_xor) op_str = "logical_xor";
+    else if (op==SOT_logical_nand) op_str = "logical_nand";
+    else if (op==SOT_bitwise_and) op_str = "bitwise_and";
+    else if (op==SOT_bitwise_or) op_str = "bitwise_or";
+    else if (op==SOT_approx_distinct) op_str = "approx_distinct";
+    else if (op==SOT_approx_quantile) op_str = "approx_quantile";
+    else if (op==SOT_sample) op_str = "sample";
+    else if (op==SOT_dict_code) op_str = "dict_code";
+    else assert (!op_str.empty());
+    return op_str;
+}
+
+void printSkyRootHeader(sky_root &r) {
+
+    std::cout << "\n\nSKYHOOK_ROOT HEADER"<< std::endl;
+    std::cout << "skyhook_version: "<< r.skyhook_version << std::endl;
+    std::cout << "data_format_type: "<< r.data_format_type << std::endl;
+    std::cout << "data_structure_version: "<< r.data_structure_version << std::endl;
+    std::cout << "data_schema_version: "<< r.data_schema_version << std::endl;
+    std::cout << "db_schema_name: "<< r.db_schema_name << std::endl;
+    std::cout << "table name: "<< r.table_name << std::endl;
+    std::cout << "data_schema: \n"<< r.data_schema << std::endl;
+    std::cout << "delete vector: [";
+        for (int i=0; i< (int)r.delete_vec.size(); i++) {
+            std::cout << (int)r.delete_vec[i];
+            if (i != (int)r.delete_vec.size()-1)
+                std::cout <<", ";
+        }
+    std::cout << "]" << std::endl;
+    std::cout << "nrows: " << r.nrows << std::endl;
+    std::cout << std::endl;
+}
+
+void printSkyRecHeader(sky_rec &r) {
+
+    std::cout << "\nSKYHOOK_REC HEADER" << std::endl;
+    std::cout << "RID: "<< r.RID << std::endl;
+    std::string bitstring = "";
+    int64_t val = 0;
+    uint64_t bit = 0;
+    for(int j = 0; j < (int)r.nullbits.size(); j++) {
+        val = r.nullbits.at(j);
+        for (uint64_t k=0; k < 8 * sizeof(r.nullbits.at(j)); k++) {
+            uint64_t mask =  1 << k;
+            ((val&mask)>0) ? bit=1 : bit=0;
+            bitstring.append(std::to_string(bit));
+        }
+        std::cout << "nullbits ["<< j << "]: val=" << val << ": bits="
+                  << bitstring;
+        std::cout << std::endl;
+        bitstring.clear();
+    }
+}
+
+long long int printFlatbufFlexRowAsCsv(
+        const char* dataptr,
+        const size_t datasz,
+        bool print_header,
+        bool print_verbose,
+        long long int max_to_print) {
+
+    // get root table ptr as sky struct
+    sky_root root = getSkyRoot(dataptr, datasz, SFT_FLATBUF_FLEX_ROW);
+    schema_vec sc = schemaFromString(root.data_schema);
+    assert(!sc.empty());
+
+    if (print_verbose)
+        printSkyRootHeader(root);
+
+    // print header row showing schema
+    if (print_header) {
+        bool first = true;
+        for (schema_vec::iterator it = sc.begin(); it != sc.end(); ++it) {
+            if (!first) std::cout << CSV_DELIM;
+            first = false;
+            std::cout << it->name;
+            if (it->is_key) std::cout << "(key)";
+            if (!it->nullable) std::cout << "(NOT NULL)";
+
+        }
+        std::cout << std::endl; // newline to start first row.
+    }
+
+    long long int counter = 0;
+    for (uint32_t i = 0; i < root.nrows; i++, counter++) {
+        if (counter >= max_to_print)
+            break;
+
+        if (root.delete_vec.at(i) == 1) continue;  // skip dead rows.
+
+        // get the record struct
+        sky_rec skyrec = \
+            getSkyRec(static_cast<row_offs>(root.data_vec)->Get(i));
+
+        // now get the flexbuf row's data as a flexbuf vec
+        auto row = skyrec.data.AsVector();
+
+        if (print_verbose)
+            printSkyRecHeader(skyrec);
+
+        // for each col in the row, print a NULL or the col's value/
+        bool first = true;
+        for (uint32_t j = 0; j < sc.size(); j++) {
+            if (!first) std::cout << CSV_DELIM;
+            first = false;
+            col_info col = sc.at(j);
+
+            if (col.nullable) {  // check nullbit
+                bool is_null = false;
+                int pos = col.idx / (8*sizeof(skyrec.nullbits.at(0)));
+                int col_bitmask = 1 << col.idx;
+                if ((col_bitmask & skyrec.nullbits.at(pos)) != 0)  {
+                    is_null =true;
+                }
+                if (is_null) {
+                    std::cout << "NULL";
+                    continue;
+                }
+            }
+            switch (col.type) {
+                case SDT_BOOL: std::cout << row[j].AsBool(); break;
+                case SDT_INT8: std::cout << row[j].AsInt8(); break;
+                case SDT_INT16: std::cout << row[j].AsInt16(); break;
+                case SDT_INT32: std::cout << row[j].AsInt32(); break;
+                case SDT_INT64: std::cout << row[j].AsInt64(); break;
+                case SDT_UINT8: std::cout << row[j].AsUInt8(); break;
+                case SDT_UINT16: std::cout << row[j].AsUInt16(); break;
+                case SDT_UINT32: std::cout << row[j].AsUInt32(); break;
+                case SDT_UINT64: std::cout << row[j].AsUInt64(); break;
+                case SDT_FLOAT: std::cout << row[j].AsFloat(); break;
+                case SDT_DOUBLE: std::cout << row[j].AsDouble(); break;
+                case SDT_CHAR: std::cout <<
+                    std::string(1, row[j].AsInt8()); break;
+                case SDT_UCHAR: std::cout <<
+                    std::string(1, row[j].AsUInt8()); break;
+                case SDT_DATE: std::cout <<
+                    daysToDate(flexDateToDays(row[j])); break;
+                case SDT_STRING: std::cout <<
+                    row[j].AsString().str(); break;
+                default: assert (TablesErrCodes::UnknownSkyDataType);
+            }
+        }
+        std::cout << std::endl;  // newline to start next row.
+    }
+    return counter;
+}
+
+/*
+ * PostgreSQL binary COPY encoding. Each row is a 16 bit field count and then
+ * each field as a 32 bit len (-1 for NULL) followed by its val, all big
+ * endian. The result rows of an fb are encoded together colwise: the vals of
+ * each col are first converted to big endian in one pass over the col (see
+ * pgCopyFixedCol), then the row lens are summed so that the rows are encoded
+ * into a single buffer of the exact size, written to the output at once.
+ */
+struct pg_copy_col {
+    int width;                      // of each val, 0 if var len
+    std::vector<char> vals;         // fixed width vals, big endian
+    std::vector<uint8_t> nulls;     // 1 if NULL, empty if none
+    std::vector<int32_t> lens;      // var len vals, -1 if NULL
+    std::vector<const char*> ptrs;  // var len vals
+
+    pg_copy_col() : width(0) {}
+};
+
+static inline uint8_t pgBigEndian(uint8_t v) { return v; }
+static inline uint16_t pgBigEndian(uint16_t v) { return __builtin_bswap16(v); }
+static inline uint32_t pgBigEndian(uint32_t v) { return __builtin_bswap32(v); }
+static inline uint64_t pgBigEndian(uint64_t v) { return __builtin_bswap64(v); }
+
+// postgres float is alias for double, so floats are always output as double.
+static inline uint64_t pgDoubleBits(double d)
+{
+    uint64_t bits;
+    memcpy(&bits, &d, sizeof(bits));
+    return bits;
+}
+
+// set the n fixed width vals of a col, get(i) returns the i'th val as the
+// unsigned int of its pg width (doubles as their bits).
+template <typename U, typename Get>
+static void pgCopyFixedCol(pg_copy_col& c, size_t n, bool swap, Get get)
+{
+    c.width = sizeof(U);
+    c.vals.resize(n * sizeof(U));
+    U* out = reinterpret_cast<U*>(c.vals.data());
+    if (swap) {
+        for (size_t i = 0; i < n; i++)
+            out[i] = pgBigEndian(get(i));
+    }
+    else {
+        for (size_t i = 0; i < n; i++)
+            out[i] = get(i);
+    }
+}
+
+// vals of an arrow numeric col, plus add (the pg epoch offset of dates)
+template <typename ArrayType, typename U>
+static void pgCopyArrowCol(pg_copy_col& c,
+                           const std::shared_ptr<arrow::Array>& array,
+                           size_t n, bool swap, U add = 0)
+{
+    const auto* v = std::static_pointer_cast<ArrayType>(array)->raw_values();
+    pgCopyFixedCol<U>(c, n, swap, [v, add](size_t i) {
+        return static_cast<U>(static_cast<U>(v[i]) + add);
+    });
+}
+
+template <int W>
+static void pgCopyPutFixedCol(const pg_copy_col& c, size_t nrows, bool swap,
+                              char* buf, std::vector<size_t>& pos)
+{
+    int32_t len = swap ? __builtin_bswap32(W) : W;
+    const char* v = c.vals.data();
+    for (size_t i = 0; i < nrows; i++, v += W) {
+        char* p = buf + pos[i];
+        if (!c.nulls.empty() and c.nulls[i]) {
+            memcpy(p, &PGNULLBINARY, sizeof(PGNULLBINARY));
+            pos[i] += sizeof(PGNULLBINARY);
+            continue;
+        }
+        memcpy(p, &len, sizeof(len));
+        memcpy(p + sizeof(len), v, W);
+        pos[i] += sizeof(len) + W;
+    }
+}
+
+static void pgCopyPutVarCol(const pg_copy_col& c, size_t nrows, bool swap,
+                            char* buf, std::vector<size_t>& pos)
+{
+    for (size_t i = 0; i < nrows; i++) {
+        int32_t len = c.lens[i];
+        int32_t len_be = swap ? __builtin_bswap32(len) : len;
+        memcpy(buf + pos[i], &len_be, sizeof(len_be));
+        pos[i] += sizeof(len_be);
+        if (len > 0) {
+            memcpy(buf + pos[i], c.ptrs[i], len);
+            pos[i] += len;
+        }
+    }
+}
+
+// encode nrows rows of the cols into out, preceded by the binary stream
+// header if print_header.
+static void pgCopyEncode(const std::vector<pg_copy_col>& cols, size_t nrows,
+                         bool print_header, bool swap, std::string& out)
+{
+    const size_t header_len = print_header ? 19 : 0;
+
+    // len of each row, field count and field lens plus the vals
+    size_t fixed_len = sizeof(int16_t) + sizeof(int32_t) * cols.size();
+    for (auto it = cols.begin(); it != cols.end(); ++it)
+        fixed_len += it->width;
+    std::vector<size_t> pos(nrows, fixed_len);
+    for (auto it = cols.begin(); it != cols.end(); ++it) {
+        if (it->width and !it->nulls.empty()) {
+            for (size_t i = 0; i < nrows; i++)
+                pos[i] -= it->nulls[i] * it->width;
+        }
+        else if (!it->width) {
+            for (size_t i = 0; i < nrows; i++)
+                pos[i] += std::max(it->lens[i], 0);
+        }
+    }
+
+    // then the offset of each row in the buffer
+    size_t off = header_len;
+    for (size_t i = 0; i < nrows; i++) {
+        size_t len = pos[i];
+        pos[i] = off;
+        off += len;
+    }
+    out.resize(off);
+    char* buf = &out[0];
+
+    if (print_header) {
+        // 11 byte signature sequence
+        memcpy(buf, "PGCOPY\n\377\r\n\0", 11);
+
+        // 32 bit flags field, set bit#16=1 only if OIDs included in data,
+        // and 32 bit extra header len
+        memset(buf + 11, 0, 8);
+    }
+
+    // 16 bit int num cols in each row (all rows same ncols currently)
+    int16_t ncols = static_cast<int16_t>(cols.size());
+    if (swap)
+        ncols = __builtin_bswap16(ncols);
+    for (size_t i = 0; i < nrows; i++) {
+        memcpy(buf + pos[i], &ncols, sizeof(ncols));
+        pos[i] += sizeof(ncols);
+    }
+
+    for (auto it = cols.begin(); it != cols.end(); ++it) {
+        switch (it->width) {
+            case 1: pgCopyPutFixedCol<1>(*it, nrows, swap, buf, pos); break;
+            case 2: pgCopyPutFixedCol<2>(*it, nrows, swap, buf, pos); break;
+            case 4: pgCopyPutFixedCol<4>(*it, nrows, swap, buf, pos); break;
+            case 8: pgCopyPutFixedCol<8>(*it, nrows, swap, buf, pos); break;
+            default: pgCopyPutVarCol(*it, nrows, swap, buf, pos);
+        }
+    }
+}
+
+long long int printFlatbufFlexRowAsPGBinary(
+        const char* dataptr,
+        const size_t datasz,
+        bool print_header,
+        bool print_verbose,
+        long long int max_to_print) {
+
+    // get root table ptr as sky struct
+    sky_root root = getSkyRoot(dataptr, datasz, SFT_FLATBUF_FLEX_ROW);
+    schema_vec sc = schemaFromString(root.data_schema);
+    assert(!sc.empty());
+
+    // postgres fstreams expect big endianness
+    bool swap = !is_big_endian();
+
+    // the live rows to be printed, and the nulls of the nullable cols
+    std::vector<flexbuffers::Vector> rows;
+    std::vector<pg_copy_col> cols(sc.size());
+
+    // row printing counter, used with --limit flag
+    long long int counter = 0;
+    for (uint32_t i = 0; i < root.nrows; i++, counter++) {
+        if (counter >= max_to_print) break;
+        if (root.delete_vec.at(i) == 1) continue;
+
+        // get the record struct
+        sky_rec skyrec = \
+            getSkyRec(static_cast<row_offs>(root.data_vec)->Get(i));
+        rows.push_back(skyrec.data.AsVector());
+
+        for (unsigned j = 0; j < sc.size(); j++) {
+            const col_info& col = sc[j];
+            if (col.nullable) {  // check nullbit
+                int pos = col.idx / (8*sizeof(skyrec.nullbits.at(0)));
+                uint64_t col_bitmask = uint64_t(1) <<
+                    (col.idx % (8*sizeof(skyrec.nullbits.at(0))));
+                cols[j].nulls.push_back(
+                    (col_bitmask & skyrec.nullbits.at(pos)) != 0);
+            }
+        }
+    }
+    size_t n = rows.size();
+
+    // gather each col's vals from the rows
+    for (unsigned j = 0; j < sc.size(); j++) {
+        pg_copy_col& c = cols[j];
+        switch (sc[j].type) {
+        case SDT_BOOL:
+            pgCopyFixedCol<uint8_t>(c, n, swap, [&](size_t i) {
+                return static_cast<uint8_t>(rows[i][j].AsBool()); });
+            break;
+        case SDT_INT8:
+        case SDT_CHAR:
+            pgCopyFixedCol<uint8_t>(c, n, swap, [&](size_t i) {
+                return static_cast<uint8_t>(rows[i][j].AsInt8()); });
+            break;
+        case SDT_UINT8:
+        case SDT_UCHAR:
+            pgCopyFixedCol<uint8_t>(c, n, swap, [&](size_t i) {
+                return rows[i][j].AsUInt8(); });
+            break;
+        case SDT_INT16:
+            pgCopyFixedCol<uint16_t>(c, n, swap, [&](size_t i) {
+                return static_cast<uint16_t>(rows[i][j].AsInt16()); });
+            break;
+        case SDT_UINT16:
+            pgCopyFixedCol<uint16_t>(c, n, swap, [&](size_t i) {
+                return rows[i][j].AsUInt16(); });
+            break;
+        case SDT_INT32:
+            pgCopyFixedCol<uint32_t>(c, n, swap, [&](size_t i) {
+                return static_cast<uint32_t>(rows[i][j].AsInt32()); });
+            break;
+        case SDT_UINT32:
+            pgCopyFixedCol<uint32_t>(c, n, swap, [&](size_t i) {
+                return rows[i][j].AsUInt32(); });
+            break;
+        case SDT_INT64:
+            pgCopyFixedCol<uint64_t>(c, n, swap, [&](size_t i) {
+                return static_cast<uint64_t>(rows[i][j].AsInt64()); });
+            break;
+        case SDT_UINT64:
+            pgCopyFixedCol<uint64_t>(c, n, swap, [&](size_t i) {
+                return rows[i][j].AsUInt64(); });
+            break;
+        case SDT_FLOAT:  // flexbuf api requires type
+            pgCopyFixedCol<uint64_t>(c, n, swap, [&](size_t i) {
+                return pgDoubleBits(rows[i][j].AsFloat()); });
+            break;
+        case SDT_DOUBLE:
+            pgCopyFixedCol<uint64_t>(c, n, swap, [&](size_t i) {
+                return pgDoubleBits(rows[i][j].AsDouble()); });
+            break;
+        case SDT_DATE:
+            // postgres uses 4 byte int date vals, offset by pg epoch
+            pgCopyFixedCol<uint32_t>(c, n, swap, [&](size_t i) {
+                return static_cast<uint32_t>(flexDateToDays(rows[i][j]) +
+                    (Tables::UNIX_EPOCH_JDATE - Tables::POSTGRES_EPOCH_JDATE));
+            });
+            break;
+        case SDT_STRING:
+            c.lens.resize(n);
+            c.ptrs.resize(n);
+            for (size_t i = 0; i < n; i++) {
+                if (!c.nulls.empty() and c.nulls[i]) {
+                    c.lens[i] = PGNULLBINARY;
+                    continue;
+                }
+                auto str = rows[i][j].AsString();
+                c.ptrs[i] = str.c_str();
+                c.lens[i] = str.length();
+            }
+            break;
+        default: assert (TablesErrCodes::UnknownSkyDataType==0);
+        }
+    }
+
+    // output all row data for this fb
+    std::string out;
+    pgCopyEncode(cols, n, print_header, swap, out);
+    std::cout.write(out.data(), out.size());
+    return counter;
+}
+
+long long int printJSONAsCsv(
+        const char* dataptr,
+        const size_t datasz,
+        bool print_header,
+        bool print_verbose,
+        long long int max_to_print) {
+
+    // get root table ptr as sky struct
+    sky_root root = getSkyRoot(dataptr, datasz, SFT_JSON);
+    schema_vec sc = schemaFromString(root.data_schema);
+    assert(!sc.empty());
+
+    if (print_verbose)
+        printSkyRootHeader(root);
+
+    // print header row showing schema
+    if (print_header) {
+        bool first = true;
+        for (schema_vec::iterator it = sc.begin(); it != sc.end(); ++it) {
+            if (!first) std::cout << CSV_DELIM;
+            first = false;
+            std::cout << it->name;
+            if (it->is_key) std::cout << "(key)";
+            if (!it->nullable) std::cout << "(NOT NULL)";
+
+        }
+        std::cout << std::endl; // newline to start first row.
+    }
+
+    // iterate over each row data (Record_FBX)
+    // NOTE: JSON stores all rows (json objs) in single record currently.
+    long long int counter = 0;
+    for (uint32_t i = 0; i < root.nrows; i++, counter++) {
+        if (counter >= max_to_print)
+            break;
+
+        if (root.delete_vec.at(i) == 1) continue;  // skip dead rows.
+
+        // get the root pointer from skyhookv2_csv.fbs, used for json and
+        // csv text data
+        const Table_FBX* rootfbx = GetTable_FBX(dataptr);
+
+        // ptr to records offsets
+        const flatbuffers::Vector<flatbuffers::Offset<Record_FBX>>* \
+            offs = rootfbx->rows_vec();
 
         // get the next record
         const Record_FBX* rec = offs->Get(i);
 
-        // NOTE:
-        // rec->RID() and rec->nullbits() are set but not yet used for JSON
+        // NOTE:
+        // rec->RID() and rec->nullbits() are set but not yet used for JSON
+
+        // NOTE: this a vector of strings, but for now JSON data will be stored
+        // as single string in elem[0], so data vector size here is only 1.
+        const flatbuffers::Vector<flatbuffers::Offset<flatbuffers::String>>* \
+            data = rec->data();
+
+        // iterate over json data, extracting from flatbuffers vec as a string.
+        std::string json_str("");
+        for (unsigned j = 0; j < data->size(); j++) {
+
+            // TODO: Assuming a flatflex object...
+            // for each row, extract as json string and print cols
+            // from each row according to schema_vec sc.
+            json_str = data->Get(j)->str();
+            std::cout << "row[" << i << "]=" << json_str << std::endl;
+
+            rapidjson::Document doc;
+            doc.Parse(json_str.c_str());
+
+            // TODO: right now this crashes due to a malformed JSON test obj.
+            //assert(doc.IsObject());
+
+            // static example of using rapidjson lib in ceph
+            rapidjson::Document d;
+            d.Parse(JSON_SAMPLE.c_str());
+            assert(d.IsObject());
+
+            assert(d.HasMember("V"));
+            assert(d["V"].IsString());
+            std::cout << d["V"].GetString() << std::endl;
+
+            assert(d.HasMember("S"));
+            assert(d["S"].IsString());
+            std::cout << d["S"].GetString() << std::endl;
+        }
+    }
+    return counter;
+}
+
+
+long long int printExampleFormatAsCsv(
+        const char* dataptr,
+        const size_t datasz,
+        bool print_header,
+        bool print_verbose,
+        long long int max_to_print) {
+
+    // convert dataptr to desired format, here just a char string.
+    std::string formatted_data(dataptr);
+
+    // print extra info from result data.
+    if (print_verbose)
+        std::cout << "EXAMPLE VERBOSE METADATA";
+
+    // print header row showing data schema
+    if (print_header) {
+        std::cout << "EXAMPLE SCHEMA HEADER";
+        std::cout << std::endl; // newline to start first data row.
+    }
+
+    std::vector<std::string> data_rows;
+    boost::split(data_rows, formatted_data, boost::is_any_of(" "),
+                                                boost::token_compress_on);
+
+    long long int counter = 0;
+    for (uint32_t i = 0; i < data_rows.size(); i++, counter++) {
+        if (counter >= max_to_print)
+            break;
+        std::cout << data_rows[i] <<std::endl;  // newline to start next row.
+    }
+    return counter;
+}
+
+
+// creates an fb meta data structure to wrap the underlying data
+// format (SkyFormatType)
+void
+createFbMeta(
+    flatbuffers::FlatBufferBuilder* meta_builder,
+    int data_format,
+    unsigned char *data,               // formatted, serialized data as char*
+    size_t data_size,                  // formatted data size in bytes
+    bool data_deleted,                 // def=false
+    size_t data_orig_off,              // def=0
+    size_t data_orig_len,              // def=0
+    CompressionType data_compression)  // def=none
+{
+    flatbuffers::Offset<flatbuffers::Vector<unsigned char>> data_blob = \
+            meta_builder->CreateVector(data, data_size);
+
+    flatbuffers::Offset<FB_Meta> meta_offset = Tables::CreateFB_Meta( \
+            *meta_builder,
+            data_format,
+            data_blob,
+            data_size,
+            data_deleted,
+            data_orig_off,
+            data_orig_len,
+            data_compression);
+    meta_builder->Finish(meta_offset);
+    assert (meta_builder->GetSize()>0);   // temp check for debug only
+}
+
+
+// Highest level abstraction over our data on disk.
+// Wraps a supported format (flatbuf, arrow, csv, parquet,...)
+// along with its metadata.  This unified structure is used as the primary
+// store/send/retreive data structure for many supported formats
+// format type is ignored if is_meta=true
+sky_meta getSkyMeta(bufferlist *bl, bool is_meta, int data_format) {
+
+    if (is_meta) {
+        const FB_Meta* meta = GetFB_Meta(bl->c_str());
+
+        return sky_meta(
+            meta->blob_orig_off(),     // data position in original file
+            meta->blob_orig_len(),     // data len in original file
+            meta->blob_compression(),  // blob compression
+            meta->blob_format(),       // blob's format (i.e.,SkyFormatType)
+            meta->blob_deleted(),      // blob valid (not deleted)
+            meta->blob_data()->size(), // blob actual size
+
+            // serialized blob data
+            reinterpret_cast<const char*>(meta->blob_data()->Data()));
+    }
+    else {
+        return sky_meta(    // for testing new raw formats without meta wrapper
+            0,              // off
+            0,              // len
+            none,           // no compression
+            data_format,    // user specified arg for testing formats
+            false,          // deleted?
+            bl->length(),    // formatted data size in bytes
+            bl->c_str());    // get data as contiguous bytes before accessing
+    }
+}
+
+// get the info from the flatbuf ROOT (top-level) table.
+// it is extraced differently for some formats in the cases below.
+sky_root getSkyRoot(const char *ds, size_t ds_size, int ds_format) {
+
+    int skyhook_version;
+    int data_format_type;
+    int data_structure_version;
+    int data_schema_version;
+    std::string data_schema;
+    std::string db_schema_name;
+    std::string table_name;
+    delete_vector delete_vec;
+    const void* data_vec;
+    uint32_t nrows;
+
+    switch (ds_format) {
+
+        case SFT_FLATBUF_FLEX_ROW: {
+            const Table* root = GetTable(ds);
+            skyhook_version = root->skyhook_version();
+            data_format_type = root->data_format_type();
+            data_structure_version = root->data_structure_version();
+            data_schema_version = root->data_schema_version();
+            data_schema = root->data_schema()->str();
+            db_schema_name = root->db_schema()->str();
+            table_name = root->table_name()->str();
+            delete_vec = delete_vector(root->delete_vector()->begin(),
+                                       root->delete_vector()->end());
+            data_vec = root->rows();
+            nrows = root->nrows();
+            break;
+        }
+
+        case SFT_JSON: {
+            const Table_FBX* root = GetTable_FBX(ds);
+            skyhook_version = root->skyhook_version();
+            data_format_type = root->data_format_type();
+            data_structure_version = root->data_structure_version();
+            data_schema_version = root->data_schema_version();
+            data_schema = root->data_schema()->str();
+            db_schema_name = root->db_schema_name()->str();
+            table_name = root->table_name()->str();
+            delete_vec = delete_vector(root->delete_vector()->begin(),
+                                       root->delete_vector()->end());
+            data_vec = root->rows_vec();
+            nrows = root->nrows();
+            break;
+        }
+
+        case SFT_ARROW: {
+            std::shared_ptr<arrow::Table> table;
+            std::shared_ptr<arrow::Buffer> buffer = \
+                arrow::MutableBuffer::Wrap(reinterpret_cast<uint8_t*>(const_cast<char*>(ds)), ds_size);
+            extract_arrow_from_buffer(&table, buffer);
+            auto schema = table->schema();
+            auto metadata = schema->metadata();
+            skyhook_version = std::stoi(metadata->value(METADATA_SKYHOOK_VERSION));
+            data_format_type = std::stoi(metadata->value(METADATA_DATA_FORMAT_TYPE));
+            data_structure_version = std::stoi(metadata->value(METADATA_DATA_STRUCTURE_VERSION));
+            data_schema_version = std::stoi(metadata->value(METADATA_DATA_SCHEMA_VERSION));
+            data_schema = metadata->value(METADATA_DATA_SCHEMA);
+            db_schema_name = metadata->value(METADATA_DB_SCHEMA);
+            table_name = metadata->value(METADATA_TABLE_NAME);
+            data_vec = NULL;
+            nrows = std::stoi(metadata->value(METADATA_NUM_ROWS));
+            break;
+        }
+
+        case SFT_FLATBUF_CSV_ROW:
+        case SFT_PG_TUPLE:
+        case SFT_CSV:
+        default:
+            assert (SkyFormatTypeNotRecognized==0);
+    }
+
+    // this is our skyhook_root struct now, which is agnostic to the
+    // underlying format and can be operated upon generically.
+    return sky_root(
+        skyhook_version,
+        data_format_type,
+        data_structure_version,
+        data_schema_version,
+        data_schema,
+        db_schema_name,
+        table_name,
+        delete_vec,
+        data_vec,
+        nrows
+    );
+}
+
+// extracts a single record for formats flatbuf and json only, can also be
+// extended for csv format
+sky_rec getSkyRec(const Tables::Record* rec, int format) {
+
+    switch (format) {
+        case SFT_FLATBUF_FLEX_ROW:
+            return sky_rec(
+                rec->RID(),
+                nullbits_vector(rec->nullbits()->begin(),
+                                rec->nullbits()->end()),
+                rec->data_flexbuffer_root()
+            );
+            break;
+
+        case SFT_JSON:
+
+            break;
+
+        default:
+            assert (TablesErrCodes::SkyFormatTypeNotRecognized==0);
 
-        // NOTE: this a vector of strings, but for now JSON data will be stored
-        // as single string in elem[0], so data vector size here is only 1.
-        const flatbuffers::Vector<flatbuffers::Offset<flatbuffers::String>>* \
-            data = rec->data();
+    }
 
-        // iterate over json data, extracting from flatbuffers vec as a string.
-        std::string json_str("");
-        for (unsigned j = 0; j < data->size(); j++) {
+    // NOTE: default in declaration is SFT_FLATBUF_FLEX_ROW)
+    return sky_rec(
+        rec->RID(),
+        nullbits_vector(rec->nullbits()->begin(),
+                        rec->nullbits()->end()),
+        rec->data_flexbuffer_root()
+    );
+}
 
-            // TODO: Assuming a flatflex object...
-            // for each row, extract as json string and print cols
-            // from each row according to schema_vec sc.
-            json_str = data->Get(j)->str();
-            std::cout << "row[" << i << "]=" << json_str << std::endl;
+/* TODO:
+* update sky_rec struct for rec fbx
+* sky_rec getSkyRec(const Tables::Record_FBX *rec, int format) {
+*
+*}
+*/
 
-            rapidjson::Document doc;
-            doc.Parse(json_str.c_str());
+bool hasAggPreds(predicate_vec &preds) {
+    for (auto it=preds.begin(); it!=preds.end();++it)
+        if ((*it)->isGlobalAgg()) return true;
+    return false;
+}
 
-            // TODO: right now this crashes due to a malformed JSON test obj.
-            //assert(doc.IsObject());
+// raw (host order) fields of the serialized sketch states
+template <typename T>
+static void appendSketchField(std::string& out, const T& v) {
+    out.append(reinterpret_cast<const char*>(&v), sizeof(v));
+}
 
-            // static example of using rapidjson lib in ceph
-            rapidjson::Document d;
-            d.Parse(JSON_SAMPLE.c_str());
-            assert(d.IsObject());
+template <typename T>
+static bool readSketchField(const uint8_t*& p, const uint8_t* end, T& v) {
+    if (static_cast<size_t>(end - p) < sizeof(v))
+        return false;
+    memcpy(&v, p, sizeof(v));
+    p += sizeof(v);
+    return true;
+}
 
-            assert(d.HasMember("V"));
-            assert(d["V"].IsString());
-            std::cout << d["V"].GetString() << std::endl;
+const uint8_t SKETCH_STATE_VERSION = 1;
 
-            assert(d.HasMember("S"));
-            assert(d["S"].IsString());
-            std::cout << d["S"].GetString() << std::endl;
+void hll_sketch::merge(const hll_sketch& h) {
+    for (size_t i = 0; i < regs.size(); i++)
+        regs[i] = std::max(regs[i], h.regs[i]);
+}
+
+uint64_t hll_sketch::estimate() const {
+    const double m = regs.size();
+    double sum = 0;
+    size_t zeros = 0;
+    for (auto r : regs) {
+        sum += std::ldexp(1.0, -r);
+        if (r == 0) zeros++;
+    }
+    double e = (0.7213 / (1 + 1.079 / m)) * m * m / sum;
+
+    // small range correction, linear counting of the empty registers.
+    // no large range correction is needed with 64 bit hashes.
+    if (e <= 2.5 * m and zeros)
+        e = m * std::log(m / zeros);
+    return static_cast<uint64_t>(e + 0.5);
+}
+
+void hll_sketch::serialize(std::string& out) const {
+    appendSketchField(out, SKETCH_STATE_VERSION);
+    appendSketchField(out, static_cast<uint8_t>(HLL_PRECISION));
+    out.append(reinterpret_cast<const char*>(regs.data()), regs.size());
+}
+
+int hll_sketch::deserialize(const uint8_t* data, size_t len) {
+    const uint8_t* p = data;
+    const uint8_t* end = data + len;
+    uint8_t version = 0;
+    uint8_t precision = 0;
+    if (!readSketchField(p, end, version) or
+        !readSketchField(p, end, precision) or
+        version != SKETCH_STATE_VERSION or
+        precision != HLL_PRECISION or
+        static_cast<size_t>(end - p) != regs.size())
+        return TablesErrCodes::BadSketchState;
+    regs.assign(p, end);
+    return 0;
+}
+
+// levels below the top shrink by 2/3 each, down to 2 vals
+size_t kll_sketch::capacity(size_t level) const {
+    size_t depth = levels.size() - 1 - level;
+    return std::max<size_t>(2, std::ceil(KLL_K * std::pow(2.0 / 3, depth)));
+}
+
+// compact the lowest full level until the sketch is below its capacity
+void kll_sketch::compress() {
+    while (retained >= max_retained) {
+        size_t h = 0;
+        while (h + 1 < levels.size() and levels[h].size() < capacity(h))
+            h++;
+        if (h + 1 == levels.size())
+            levels.emplace_back();
+
+        // promote every other val, an odd val is kept at this level
+        std::vector<double>& lv = levels[h];
+        std::sort(lv.begin(), lv.end());
+        size_t npromote = lv.size() & ~size_t(1);
+        for (size_t i = coin; i < npromote; i += 2)
+            levels[h + 1].push_back(lv[i]);
+        coin ^= 1;
+        lv.erase(lv.begin(), lv.begin() + npromote);
+        retained -= npromote / 2;
+
+        max_retained = 0;
+        for (size_t i = 0; i < levels.size(); i++)
+            max_retained += capacity(i);
+    }
+}
+
+void kll_sketch::merge(const kll_sketch& k) {
+    if (levels.size() < k.levels.size())
+        levels.resize(k.levels.size());
+    max_retained = 0;
+    for (size_t h = 0; h < levels.size(); h++) {
+        if (h < k.levels.size()) {
+            levels[h].insert(levels[h].end(), k.levels[h].begin(),
+                             k.levels[h].end());
+            retained += k.levels[h].size();
+        }
+        max_retained += capacity(h);
+    }
+    n += k.n;
+    compress();
+}
+
+double kll_sketch::quantile(double rank) const {
+    std::vector<std::pair<double, uint64_t>> vals;  // val, weight
+    uint64_t total = 0;
+    for (size_t h = 0; h < levels.size(); h++) {
+        for (auto v : levels[h])
+            vals.push_back(std::make_pair(v, uint64_t(1) << h));
+        total += levels[h].size() << h;
+    }
+    if (vals.empty())
+        return 0;
+    std::sort(vals.begin(), vals.end());
+    uint64_t cum = 0;
+    for (auto it = vals.begin(); it != vals.end(); ++it) {
+        cum += it->second;
+        if (cum >= rank * total)
+            return it->first;
+    }
+    return vals.back().first;
+}
+
+void kll_sketch::serialize(std::string& out) const {
+    appendSketchField(out, SKETCH_STATE_VERSION);
+    appendSketchField(out, n);
+    appendSketchField(out, coin);
+    appendSketchField(out, static_cast<uint32_t>(levels.size()));
+    for (auto it = levels.begin(); it != levels.end(); ++it) {
+        appendSketchField(out, static_cast<uint32_t>(it->size()));
+        out.append(reinterpret_cast<const char*>(it->data()),
+                   it->size() * sizeof(double));
+    }
+}
+
+int kll_sketch::deserialize(const uint8_t* data, size_t len) {
+    const uint8_t* p = data;
+    const uint8_t* end = data + len;
+    uint8_t version = 0;
+    uint32_t nlevels = 0;
+    if (!readSketchField(p, end, version) or
+        version != SKETCH_STATE_VERSION or
+        !readSketchField(p, end, n) or
+        !readSketchField(p, end, coin) or
+        !readSketchField(p, end, nlevels) or
+        nlevels == 0 or nlevels > 64)
+        return TablesErrCodes::BadSketchState;
+    levels.assign(nlevels, std::vector<double>());
+    for (uint32_t h = 0; h < nlevels; h++) {
+        uint32_t size = 0;
+        if (!readSketchField(p, end, size) or
+            static_cast<size_t>(end - p) / sizeof(double) < size)
+            return TablesErrCodes::BadSketchState;
+        levels[h].resize(size);
+        memcpy(levels[h].data(), p, size * sizeof(double));
+        p += size * sizeof(double);
+    }
+    retained = 0;
+    max_retained = 0;
+    for (size_t h = 0; h < levels.size(); h++) {
+        retained += levels[h].size();
+        max_retained += capacity(h);
+    }
+    return p == end ? 0 : TablesErrCodes::BadSketchState;
+}
+
+void SketchPredicate::addFlex(const flexbuffers::Reference& v) {
+    switch (colType()) {
+        case SDT_BOOL:
+        case SDT_CHAR:
+        case SDT_INT8:
+        case SDT_INT16:
+        case SDT_INT32:
+        case SDT_INT64:
+            addInt(v.AsInt64());
+            break;
+        case SDT_UCHAR:
+        case SDT_UINT8:
+        case SDT_UINT16:
+        case SDT_UINT32:
+        case SDT_UINT64:
+            addUInt(v.AsUInt64());
+            break;
+        case SDT_FLOAT:
+        case SDT_DOUBLE:
+            addDouble(v.AsDouble());
+            break;
+        case SDT_DATE:
+            addInt(flexDateToDays(v));
+            break;
+        case SDT_STRING: {
+            auto s = v.AsString();
+            addString(s.c_str(), s.length());
+            break;
+        }
+        default: assert (TablesErrCodes::UnsupportedSkyDataType==0);
+    }
+}
+
+void SketchPredicate::addArrow(const std::shared_ptr<arrow::Array>& array,
+                               int64_t row) {
+    switch (colType()) {
+        case SDT_BOOL:
+            addInt(std::static_pointer_cast<arrow::BooleanArray>(array)->Value(row));
+            break;
+        case SDT_CHAR:
+        case SDT_INT8:
+            addInt(std::static_pointer_cast<arrow::Int8Array>(array)->Value(row));
+            break;
+        case SDT_INT16:
+            addInt(std::static_pointer_cast<arrow::Int16Array>(array)->Value(row));
+            break;
+        case SDT_INT32:
+            addInt(std::static_pointer_cast<arrow::Int32Array>(array)->Value(row));
+            break;
+        case SDT_INT64:
+            addInt(std::static_pointer_cast<arrow::Int64Array>(array)->Value(row));
+            break;
+        case SDT_UCHAR:
+        case SDT_UINT8:
+            addUInt(std::static_pointer_cast<arrow::UInt8Array>(array)->Value(row));
+            break;
+        case SDT_UINT16:
+            addUInt(std::static_pointer_cast<arrow::UInt16Array>(array)->Value(row));
+            break;
+        case SDT_UINT32:
+            addUInt(std::static_pointer_cast<arrow::UInt32Array>(array)->Value(row));
+            break;
+        case SDT_UINT64:
+            addUInt(std::static_pointer_cast<arrow::UInt64Array>(array)->Value(row));
+            break;
+        case SDT_FLOAT:
+            addDouble(std::static_pointer_cast<arrow::FloatArray>(array)->Value(row));
+            break;
+        case SDT_DOUBLE:
+            addDouble(std::static_pointer_cast<arrow::DoubleArray>(array)->Value(row));
+            break;
+        case SDT_DATE:
+            addInt(std::static_pointer_cast<arrow::Date32Array>(array)->Value(row));
+            break;
+        case SDT_STRING: {
+            int32_t len = 0;
+            const uint8_t* s = std::static_pointer_cast<arrow::StringArray>(
+                                    array)->GetValue(row, &len);
+            addString(reinterpret_cast<const char*>(s), len);
+            break;
+        }
+        default: assert (TablesErrCodes::UnsupportedSkyDataType==0);
+    }
+}
+
+std::string SketchPredicate::state() const {
+    std::string s;
+    if (opType() == SOT_approx_distinct)
+        hll.serialize(s);
+    else
+        kll.serialize(s);
+    return s;
+}
+
+int SketchPredicate::mergeState(const uint8_t* data, size_t len) {
+    int ret = 0;
+    if (opType() == SOT_approx_distinct) {
+        hll_sketch h;
+        ret = h.deserialize(data, len);
+        if (!ret)
+            hll.merge(h);
+    } else {
+        kll_sketch k;
+        ret = k.deserialize(data, len);
+        if (!ret)
+            kll.merge(k);
+    }
+    return ret;
+}
+
+// combine a partial exact agg val into the merged val, the cnt of each
+// partial is summed.
+template <typename T>
+static void mergeAggVal(PredicateBase* pb, T partial) {
+    TypedPredicate<T>* p = dynamic_cast<TypedPredicate<T>*>(pb);
+    int op = (pb->opType() == SOT_cnt) ? SOT_sum : pb->opType();
+    p->updateAgg(computeAgg(partial, p->Val(), op));
+}
+
+// combine a val of a partial agg row into the agg pred.
+static int mergeAggFlexVal(PredicateBase* pb,
+                           const flexbuffers::Reference& val) {
+    if (isSketchAgg(pb->opType())) {
+        auto b = val.AsBlob();
+        return dynamic_cast<SketchPredicate*>(pb)->mergeState(b.data(),
+                                                             b.size());
+    }
+    switch (pb->colType()) {
+        case SDT_INT64: mergeAggVal(pb, val.AsInt64()); break;
+        case SDT_INT8: mergeAggVal(pb, static_cast<int8_t>(val.AsInt64())); break;
+        case SDT_INT16: mergeAggVal(pb, static_cast<int16_t>(val.AsInt64())); break;
+        case SDT_INT32: mergeAggVal(pb, static_cast<int32_t>(val.AsInt64())); break;
+        case SDT_UINT8: mergeAggVal(pb, static_cast<uint8_t>(val.AsUInt64())); break;
+        case SDT_UINT16: mergeAggVal(pb, static_cast<uint16_t>(val.AsUInt64())); break;
+        case SDT_DATE: mergeAggVal(pb, static_cast<int32_t>(val.AsInt64())); break;
+        case SDT_UINT32: mergeAggVal(pb, val.AsUInt32()); break;
+        case SDT_UINT64: mergeAggVal(pb, val.AsUInt64()); break;
+        case SDT_FLOAT: mergeAggVal(pb, val.AsFloat()); break;
+        case SDT_DOUBLE: mergeAggVal(pb, val.AsDouble()); break;
+        default: return TablesErrCodes::UnsupportedAggDataType;
+    }
+    return 0;
+}
+
+int mergeAggRows(predicate_vec& agg_preds,
+                 const char* dataptr,
+                 const size_t datasz,
+                 const int format,
+                 std::string& errmsg) {
+
+    if (format == SFT_ARROW) {
+        std::shared_ptr<arrow::Table> table;
+        extract_arrow_from_string(&table, dataptr, datasz);
+        return mergeAggTable(agg_preds, table, errmsg);
+    }
+    if (format != SFT_FLATBUF_FLEX_ROW) {
+        errmsg.append("ERROR mergeAggRows(): format=" +
+                      std::to_string(format) + " not supported.");
+        return TablesErrCodes::SkyFormatTypeNotRecognized;
+    }
+
+    sky_root root = getSkyRoot(dataptr, datasz, format);
+    for (uint32_t i = 0; i < root.nrows; i++) {
+        if (root.delete_vec[i] == 1) continue;
+        sky_rec rec = getSkyRec(static_cast<row_offs>(root.data_vec)->Get(i));
+        auto row = rec.data.AsVector();
+        if (row.size() != agg_preds.size()) {
+            errmsg.append("ERROR mergeAggRows(): agg row has " +
+                          std::to_string(row.size()) + " vals, expected " +
+                          std::to_string(agg_preds.size()));
+            return TablesErrCodes::BadSketchState;
+        }
+        for (unsigned j = 0; j < agg_preds.size(); j++) {
+            int ret = mergeAggFlexVal(agg_preds[j], row[j]);
+            if (ret == TablesErrCodes::UnsupportedAggDataType)
+                return ret;
+            if (ret) {
+                errmsg.append("ERROR mergeAggRows(): bad sketch state");
+                return ret;
+            }
+        }
+    }
+    return 0;
+}
+
+int mergeAggTable(predicate_vec& agg_preds,
+                  const std::shared_ptr<arrow::Table>& table,
+                  std::string& errmsg) {
+
+    if (table->num_columns() < static_cast<int>(agg_preds.size())) {
+        errmsg.append("ERROR mergeAggTable(): agg table has " +
+                      std::to_string(table->num_columns()) +
+                      " cols, expected " + std::to_string(agg_preds.size()));
+        return TablesErrCodes::BadSketchState;
+    }
+    for (unsigned j = 0; j < agg_preds.size(); j++) {
+        PredicateBase* pb = agg_preds[j];
+        auto array = table->column(j)->chunk(0);
+        for (int64_t r = 0; r < array->length(); r++) {
+            if (isSketchAgg(pb->opType())) {
+                int32_t len = 0;
+                const uint8_t* s = std::static_pointer_cast<arrow::BinaryArray>(
+                                        array)->GetValue(r, &len);
+                int ret = dynamic_cast<SketchPredicate*>(pb)->mergeState(s, len);
+                if (ret) {
+                    errmsg.append("ERROR mergeAggTable(): bad sketch state");
+                    return ret;
+                }
+                continue;
+            }
+            switch (pb->colType()) {
+                case SDT_INT64:
+                    mergeAggVal(pb, std::static_pointer_cast<arrow::Int64Array>(array)->Value(r));
+                    break;
+                case SDT_INT8:
+                    mergeAggVal(pb, static_cast<int8_t>(std::static_pointer_cast<arrow::Int8Array>(array)->Value(r)));
+                    break;
+                case SDT_INT16:
+                    mergeAggVal(pb, static_cast<int16_t>(std::static_pointer_cast<arrow::Int16Array>(array)->Value(r)));
+                    break;
+                case SDT_INT32:
+                    mergeAggVal(pb, static_cast<int32_t>(std::static_pointer_cast<arrow::Int32Array>(array)->Value(r)));
+                    break;
+                case SDT_UINT8:
+                    mergeAggVal(pb, static_cast<uint8_t>(std::static_pointer_cast<arrow::UInt8Array>(array)->Value(r)));
+                    break;
+                case SDT_UINT16:
+                    mergeAggVal(pb, static_cast<uint16_t>(std::static_pointer_cast<arrow::UInt16Array>(array)->Value(r)));
+                    break;
+                case SDT_DATE:
+                    mergeAggVal(pb, static_cast<int32_t>(std::static_pointer_cast<arrow::Date32Array>(array)->Value(r)));
+                    break;
+                case SDT_UINT32:
+                    mergeAggVal(pb, std::static_pointer_cast<arrow::UInt32Array>(array)->Value(r));
+                    break;
+                case SDT_UINT64:
+                    mergeAggVal(pb, std::static_pointer_cast<arrow::UInt64Array>(array)->Value(r));
+                    break;
+                case SDT_FLOAT:
+                    mergeAggVal(pb, std::static_pointer_cast<arrow::FloatArray>(array)->Value(r));
+                    break;
+                case SDT_DOUBLE:
+                    mergeAggVal(pb, std::static_pointer_cast<arrow::DoubleArray>(array)->Value(r));
+                    break;
+                default: return TablesErrCodes::UnsupportedAggDataType;
+            }
+        }
+    }
+    return 0;
+}
+
+void buildAggResultFb(flatbuffers::FlatBufferBuilder& flatbldr,
+                      predicate_vec& agg_preds,
+                      schema_vec& query_schema,
+                      const std::string& db_schema_name,
+                      const std::string& table_name) {
+
+    flexbuffers::Builder flexbldr;
+    flexbldr.Vector([&]() {
+        for (auto it = agg_preds.begin(); it != agg_preds.end(); ++it) {
+            PredicateBase* pb = *it;
+            if (pb->opType() == SOT_approx_distinct) {
+                flexbldr.Add(dynamic_cast<SketchPredicate*>(pb)->distinct());
+                continue;
+            }
+            if (pb->opType() == SOT_approx_quantile) {
+                flexbldr.Add(dynamic_cast<SketchPredicate*>(pb)->quantile());
+                continue;
+            }
+            switch (pb->colType()) {
+                case SDT_INT64:
+                    flexbldr.Add(dynamic_cast<TypedPredicate<int64_t>*>(pb)->Val());
+                    break;
+                case SDT_INT8:
+                    flexbldr.Add(dynamic_cast<TypedPredicate<int8_t>*>(pb)->Val());
+                    break;
+                case SDT_INT16:
+                    flexbldr.Add(dynamic_cast<TypedPredicate<int16_t>*>(pb)->Val());
+                    break;
+                case SDT_INT32:
+                    flexbldr.Add(dynamic_cast<TypedPredicate<int32_t>*>(pb)->Val());
+                    break;
+                case SDT_UINT8:
+                    flexbldr.Add(dynamic_cast<TypedPredicate<uint8_t>*>(pb)->Val());
+                    break;
+                case SDT_UINT16:
+                    flexbldr.Add(dynamic_cast<TypedPredicate<uint16_t>*>(pb)->Val());
+                    break;
+                case SDT_DATE:
+                    flexbldr.Add(dynamic_cast<TypedPredicate<int32_t>*>(pb)->Val());
+                    break;
+                case SDT_UINT32:
+                    flexbldr.Add(dynamic_cast<TypedPredicate<uint32_t>*>(pb)->Val());
+                    break;
+                case SDT_UINT64:
+                    flexbldr.Add(dynamic_cast<TypedPredicate<uint64_t>*>(pb)->Val());
+                    break;
+                case SDT_FLOAT:
+                    flexbldr.Add(dynamic_cast<TypedPredicate<float>*>(pb)->Val());
+                    break;
+                case SDT_DOUBLE:
+                    flexbldr.Add(dynamic_cast<TypedPredicate<double>*>(pb)->Val());
+                    break;
+                default: assert (TablesErrCodes::UnsupportedAggDataType==0);
+            }
+        }
+    });
+    flexbldr.Finish();
+
+    std::vector<flatbuffers::Offset<Tables::Record>> offs;
+    delete_vector dead_rows(1, 0);
+    auto row_data = flatbldr.CreateVector(flexbldr.GetBuffer());
+    auto nullbits = flatbldr.CreateVector(nullbits_vector(2, 0));
+    offs.push_back(Tables::CreateRecord(flatbldr, -1, nullbits, row_data));
+
+    auto schema = flatbldr.CreateString(schemaToString(query_schema));
+    auto db_schema = flatbldr.CreateString(db_schema_name);
+    auto table_n = flatbldr.CreateString(table_name);
+    auto delete_v = flatbldr.CreateVector(dead_rows);
+    auto rows_v = flatbldr.CreateVector(offs);
+    auto table = CreateTable(flatbldr, SFT_FLATBUF_FLEX_ROW, 2, 1, 1,
+                             schema, db_schema, table_n, delete_v, rows_v,
+                             offs.size());
+    flatbldr.Finish(table);
+}
+
+// the partial agg row of the (exact) agg preds' vals, see mergeAggRows.
+static std::string aggPredsRow(predicate_vec& agg_preds) {
+    flexbuffers::Builder flexbldr;
+    flexbldr.Vector([&]() {
+        for (auto it = agg_preds.begin(); it != agg_preds.end(); ++it) {
+            PredicateBase* pb = *it;
+            switch (pb->colType()) {
+                case SDT_INT64:
+                    flexbldr.Add(dynamic_cast<TypedPredicate<int64_t>*>(pb)->Val());
+                    break;
+                case SDT_INT8:
+                    flexbldr.Add(dynamic_cast<TypedPredicate<int8_t>*>(pb)->Val());
+                    break;
+                case SDT_INT16:
+                    flexbldr.Add(dynamic_cast<TypedPredicate<int16_t>*>(pb)->Val());
+                    break;
+                case SDT_INT32:
+                    flexbldr.Add(dynamic_cast<TypedPredicate<int32_t>*>(pb)->Val());
+                    break;
+                case SDT_UINT8:
+                    flexbldr.Add(dynamic_cast<TypedPredicate<uint8_t>*>(pb)->Val());
+                    break;
+                case SDT_UINT16:
+                    flexbldr.Add(dynamic_cast<TypedPredicate<uint16_t>*>(pb)->Val());
+                    break;
+                case SDT_DATE:
+                    flexbldr.Add(dynamic_cast<TypedPredicate<int32_t>*>(pb)->Val());
+                    break;
+                case SDT_UINT32:
+                    flexbldr.Add(dynamic_cast<TypedPredicate<uint32_t>*>(pb)->Val());
+                    break;
+                case SDT_UINT64:
+                    flexbldr.Add(dynamic_cast<TypedPredicate<uint64_t>*>(pb)->Val());
+                    break;
+                case SDT_FLOAT:
+                    flexbldr.Add(dynamic_cast<TypedPredicate<float>*>(pb)->Val());
+                    break;
+                case SDT_DOUBLE:
+                    flexbldr.Add(dynamic_cast<TypedPredicate<double>*>(pb)->Val());
+                    break;
+                default: assert (TablesErrCodes::UnsupportedAggDataType==0);
+            }
+        }
+    });
+    flexbldr.Finish();
+    const std::vector<uint8_t>& buf = flexbldr.GetBuffer();
+    return std::string(buf.begin(), buf.end());
+}
+
+template <typename T>
+static bool aggValsEqual(PredicateBase* pb1, PredicateBase* pb2) {
+    return dynamic_cast<TypedPredicate<T>*>(pb1)->Val() ==
+           dynamic_cast<TypedPredicate<T>*>(pb2)->Val();
+}
+
+// same agg over the same col from the same initial val
+static bool sameAgg(PredicateBase* pb1, PredicateBase* pb2) {
+    if (pb1->colIdx() != pb2->colIdx() or
+        pb1->colType() != pb2->colType() or
+        pb1->opType() != pb2->opType())
+        return false;
+    switch (pb1->colType()) {
+        case SDT_INT64: return aggValsEqual<int64_t>(pb1, pb2);
+        case SDT_UINT32: return aggValsEqual<uint32_t>(pb1, pb2);
+        case SDT_UINT64: return aggValsEqual<uint64_t>(pb1, pb2);
+        case SDT_FLOAT: return aggValsEqual<float>(pb1, pb2);
+        case SDT_DOUBLE: return aggValsEqual<double>(pb1, pb2);
+        default: return false;
+    }
+}
+
+// copy a scalar flexbuf val
+static void flexAddRef(flexbuffers::Builder& flexbldr,
+                       const flexbuffers::Reference& ref) {
+    if (ref.IsBool())
+        flexbldr.Bool(ref.AsBool());
+    else if (ref.IsInt())
+        flexbldr.Int(ref.AsInt64());
+    else if (ref.IsUInt())
+        flexbldr.UInt(ref.AsUInt64());
+    else if (ref.IsFloat())
+        flexbldr.Double(ref.AsDouble());
+    else if (ref.IsString()) {
+        auto str = ref.AsString();
+        flexbldr.String(str.c_str(), str.length());
+    }
+    else
+        flexbldr.Null();
+}
+
+// a rollup group key is the nullbits of the group cols followed by a row of
+// the group col vals at their col idx (other cols null), so that the preds
+// on the group cols can be applied to the key as a row.
+static const size_t ROLLUP_KEY_NULLBITS = MAX_TABLE_COLS / 64;
+
+static void rollupGroupKey(sky_rec& rec,
+                           const std::vector<bool>& group_cols,
+                           flexbuffers::Builder& flexbldr,
+                           std::string& key) {
+    auto row = rec.data.AsVector();
+    nullbits_vector nullbits(ROLLUP_KEY_NULLBITS, 0);
+    flexbldr.Clear();
+    size_t start = flexbldr.StartVector();
+    for (unsigned i = 0; i < group_cols.size(); i++) {
+        if (!group_cols[i]) {
+            flexbldr.Null();
+            continue;
         }
+        uint64_t bit = 1ULL << (i % 64);
+        nullbits[i / 64] |= rec.nullbits.at(i / 64) & bit;
+        flexAddRef(flexbldr, row[i]);
     }
-    return counter;
+    flexbldr.EndVector(start, false, false);
+    flexbldr.Finish();
+    const std::vector<uint8_t>& buf = flexbldr.GetBuffer();
+    key.assign(reinterpret_cast<const char*>(nullbits.data()),
+               nullbits.size() * sizeof(nullbits[0]));
+    key.append(reinterpret_cast<const char*>(buf.data()), buf.size());
 }
 
+static sky_rec rollupGroupRec(const std::string& key) {
+    nullbits_vector nullbits(ROLLUP_KEY_NULLBITS, 0);
+    const size_t len = nullbits.size() * sizeof(nullbits[0]);
+    memcpy(nullbits.data(), key.data(), len);
+    return sky_rec(-1, nullbits, flexbuffers::GetRoot(
+        reinterpret_cast<const uint8_t*>(key.data()) + len, key.size() - len));
+}
 
-long long int printExampleFormatAsCsv(
-        const char* dataptr,
-        const size_t datasz,
-        bool print_header,
-        bool print_verbose,
-        long long int max_to_print) {
+int rollupCheckAggs(predicate_vec& agg_preds, std::string& errmsg) {
 
-    // convert dataptr to desired format, here just a char string.
-    std::string formatted_data(dataptr);
+    if (agg_preds.empty()) {
+        errmsg.append("ERROR rollupCheckAggs(): no aggs");
+        return TablesErrCodes::RollupAggNotSupported;
+    }
+    for (auto it = agg_preds.begin(); it != agg_preds.end(); ++it) {
+        PredicateBase* pb = *it;
+        int op = pb->opType();
+        if (!pb->isGlobalAgg() or isSketchAgg(op) or
+            !(pb->colType() == SDT_INT64 or pb->colType() == SDT_UINT32 or
+              pb->colType() == SDT_UINT64 or pb->colType() == SDT_FLOAT or
+              pb->colType() == SDT_DOUBLE)) {
+            errmsg.append("ERROR rollupCheckAggs(): not a mergeable agg: " +
+                          pb->toString());
+            return TablesErrCodes::RollupAggNotSupported;
+        }
+        if (op != SOT_sum and op != SOT_cnt)
+            continue;
+        predicate_vec v = {pb};
+        std::string row = aggPredsRow(v);
+        auto val = flexbuffers::GetRoot(
+            reinterpret_cast<const uint8_t*>(row.data()), row.size())
+            .AsVector()[0];
+        if (val.AsDouble() != 0) {
+            errmsg.append("ERROR rollupCheckAggs(): sum and cnt aggs must "
+                          "start at 0: " + pb->toString());
+            return TablesErrCodes::RollupAggNotSupported;
+        }
+    }
+    return 0;
+}
 
-    // print extra info from result data.
-    if (print_verbose)
-        std::cout << "EXAMPLE VERBOSE METADATA";
+int rollupAddRows(schema_vec& data_schema,
+                  schema_vec& group_schema,
+                  const std::string& agg_preds,
+                  const char* dataptr,
+                  const size_t datasz,
+                  rollup_groups& groups,
+                  std::string& errmsg) {
+
+    // groups are keyed by the col vals, not by the codes of one fb
+    if (hasSkyDicts(dataptr)) {
+        flatbuffers::FlatBufferBuilder decoded(datasz);
+        int ret = decodeSkyDicts(dataptr, datasz, decoded, errmsg);
+        if (ret != 0)
+            return ret;
+        return rollupAddRows(data_schema, group_schema, agg_preds,
+                    reinterpret_cast<const char*>(decoded.GetBufferPointer()),
+                    decoded.GetSize(), groups, errmsg);
+    }
 
-    // print header row showing data schema
-    if (print_header) {
-        std::cout << "EXAMPLE SCHEMA HEADER";
-        std::cout << std::endl; // newline to start first data row.
+    std::vector<bool> group_cols;
+    for (auto it = group_schema.begin(); it != group_schema.end(); ++it) {
+        if (it->idx >= static_cast<int>(group_cols.size()))
+            group_cols.resize(it->idx + 1, false);
+        group_cols[it->idx] = true;
     }
 
-    std::vector<std::string> data_rows;
-    boost::split(data_rows, formatted_data, boost::is_any_of(" "),
-                                                boost::token_compress_on);
+    // the rows of each group of the fb are accumulated by a copy of the agg
+    // preds, then merged with the group's partial agg row so far.
+    std::map<std::string, predicate_vec> fb_groups;
+    flexbuffers::Builder flexbldr;
+    std::string key;
+    sky_root root = getSkyRoot(dataptr, datasz, SFT_FLATBUF_FLEX_ROW);
+    for (uint32_t i = 0; i < root.nrows; i++) {
+        if (root.delete_vec[i] == 1) continue;
+        sky_rec rec = getSkyRec(static_cast<row_offs>(root.data_vec)->Get(i));
+        rollupGroupKey(rec, group_cols, flexbldr, key);
+        auto it = fb_groups.find(key);
+        if (it == fb_groups.end())
+            it = fb_groups.emplace(key, predsFromString(data_schema,
+                                                        agg_preds)).first;
+        applyPredicates(it->second, rec);
+    }
 
-    long long int counter = 0;
-    for (uint32_t i = 0; i < data_rows.size(); i++, counter++) {
-        if (counter >= max_to_print)
-            break;
-        std::cout << data_rows[i] <<std::endl;  // newline to start next row.
+    int ret = 0;
+    for (auto it = fb_groups.begin(); it != fb_groups.end(); ++it) {
+        predicate_vec& aggs = it->second;
+        auto g = groups.find(it->first);
+        if (ret == 0 and g != groups.end()) {
+            auto row = flexbuffers::GetRoot(
+                reinterpret_cast<const uint8_t*>(g->second.data()),
+                g->second.size()).AsVector();
+            if (row.size() != aggs.size()) {
+                errmsg.append("ERROR rollupAddRows(): group has " +
+                              std::to_string(row.size()) + " aggs, expected " +
+                              std::to_string(aggs.size()));
+                ret = TablesErrCodes::BadRollupState;
+            }
+            for (unsigned j = 0; ret == 0 and j < aggs.size(); j++)
+                ret = mergeAggFlexVal(aggs[j], row[j]);
+        }
+        if (ret == 0)
+            groups[it->first] = aggPredsRow(aggs);
+        for (auto p : aggs)
+            delete p;
     }
-    return counter;
+    return ret;
 }
 
-
-// creates an fb meta data structure to wrap the underlying data
-// format (SkyFormatType)
-void
-createFbMeta(
-    flatbuffers::FlatBufferBuilder* meta_builder,
-    int data_format,
-    unsigned char *data,               // formatted, serialized data as char*
-    size_t data_size,                  // formatted data size in bytes
-    bool data_deleted,                 // def=false
-    size_t data_orig_off,              // def=0
-    size_t data_orig_len,              // def=0
-    CompressionType data_compression)  // def=none
-{
-    flatbuffers::Offset<flatbuffers::Vector<unsigned char>> data_blob = \
-            meta_builder->CreateVector(data, data_size);
-
-    flatbuffers::Offset<FB_Meta> meta_offset = Tables::CreateFB_Meta( \
-            *meta_builder,
-            data_format,
-            data_blob,
-            data_size,
-            data_deleted,
-            data_orig_off,
-            data_orig_len,
-            data_compression);
-    meta_builder->Finish(meta_offset);
-    assert (meta_builder->GetSize()>0);   // temp check for debug only
+bool rollupMatchesQuery(predicate_vec& query_preds,
+                        predicate_vec& rollup_aggs,
+                        schema_vec& group_schema,
+                        std::vector<int>& agg_map) {
+
+    std::set<int> group_cols;
+    for (auto it = group_schema.begin(); it != group_schema.end(); ++it)
+        group_cols.insert(it->idx);
+
+    agg_map.clear();
+    for (auto it = query_preds.begin(); it != query_preds.end(); ++it) {
+        PredicateBase* pb = *it;
+        if (!pb->isGlobalAgg()) {
+            if (pb->opType() == SOT_sample or
+                group_cols.find(pb->colIdx()) == group_cols.end())
+                return false;
+            continue;
+        }
+        int k = -1;
+        for (unsigned j = 0; j < rollup_aggs.size(); j++) {
+            if (sameAgg(pb, rollup_aggs[j])) {
+                k = j;
+                break;
+            }
+        }
+        if (k < 0)
+            return false;
+        agg_map.push_back(k);
+    }
+    return !agg_map.empty();
 }
 
+int rollupMergeGroups(predicate_vec& query_preds,
+                      const std::vector<int>& agg_map,
+                      const rollup_groups& groups,
+                      std::string& errmsg) {
 
-// Highest level abstraction over our data on disk.
-// Wraps a supported format (flatbuf, arrow, csv, parquet,...)
-// along with its metadata.  This unified structure is used as the primary
-// store/send/retreive data structure for many supported formats
-// format type is ignored if is_meta=true
-sky_meta getSkyMeta(bufferlist *bl, bool is_meta, int data_format) {
+    predicate_vec preds;
+    predicate_vec aggs;
+    for (auto it = query_preds.begin(); it != query_preds.end(); ++it) {
+        if ((*it)->isGlobalAgg())
+            aggs.push_back(*it);
+        else
+            preds.push_back(*it);
+    }
+    assert (aggs.size() == agg_map.size());
 
-    if (is_meta) {
-        const FB_Meta* meta = GetFB_Meta(bl->c_str());
+    for (auto it = groups.begin(); it != groups.end(); ++it) {
+        if (!preds.empty()) {
+            sky_rec rec = rollupGroupRec(it->first);
+            if (!applyPredicates(preds, rec))
+                continue;
+        }
+        auto row = flexbuffers::GetRoot(
+            reinterpret_cast<const uint8_t*>(it->second.data()),
+            it->second.size()).AsVector();
+        for (unsigned j = 0; j < aggs.size(); j++) {
+            if (agg_map[j] >= static_cast<int>(row.size())) {
+                errmsg.append("ERROR rollupMergeGroups(): group has " +
+                              std::to_string(row.size()) + " aggs");
+                return TablesErrCodes::BadRollupState;
+            }
+            int ret = mergeAggFlexVal(aggs[j], row[agg_map[j]]);
+            if (ret)
+                return ret;
+        }
+    }
+    return 0;
+}
 
-        return sky_meta(
-            meta->blob_orig_off(),     // data position in original file
-            meta->blob_orig_len(),     // data len in original file
-            meta->blob_compression(),  // blob compression
-            meta->blob_format(),       // blob's format (i.e.,SkyFormatType)
-            meta->blob_deleted(),      // blob valid (not deleted)
-            meta->blob_data()->size(), // blob actual size
+bool rollupIsStale(const rollup_info& rollup, uint64_t obj_size) {
+    return rollup.obj_size != obj_size;
+}
 
-            // serialized blob data
-            reinterpret_cast<const char*>(meta->blob_data()->Data()));
+// uint64 vals above INT64_MAX saturate to INT64_MAX, as the writer does for the
+// range col, and set clamped since a strict bound on them is no longer strict
+template <typename T>
+static int64_t predIntVal(T v, bool& clamped) {
+    if (std::is_unsigned<T>::value and
+        static_cast<uint64_t>(v) > static_cast<uint64_t>(INT64_MAX)) {
+        clamped = true;
+        return INT64_MAX;
+    }
+    return static_cast<int64_t>(v);
+}
+
+template <typename T>
+static std::vector<int64_t> predIntVals(PredicateBase* pb, bool& clamped) {
+    TypedPredicate<T>* p = dynamic_cast<TypedPredicate<T>*>(pb);
+    std::vector<int64_t> vals;
+    if (isListOp(p->opType())) {
+        for (auto it = p->Vals().begin(); it != p->Vals().end(); ++it)
+            vals.push_back(predIntVal<T>(*it, clamped));
     }
     else {
-        return sky_meta(    // for testing new raw formats without meta wrapper
-            0,              // off
-            0,              // len
-            none,           // no compression
-            data_format,    // user specified arg for testing formats
-            false,          // deleted?
-            bl->length(),    // formatted data size in bytes
-            bl->c_str());    // get data as contiguous bytes before accessing
+        vals.push_back(predIntVal<T>(p->Val(), clamped));
     }
+    return vals;
 }
 
-// get the info from the flatbuf ROOT (top-level) table.
-// it is extraced differently for some formats in the cases below.
-sky_root getSkyRoot(const char *ds, size_t ds_size, int ds_format) {
-
-    int skyhook_version;
-    int data_format_type;
-    int data_structure_version;
-    int data_schema_version;
-    std::string data_schema;
-    std::string db_schema_name;
-    std::string table_name;
-    delete_vector delete_vec;
-    const void* data_vec;
-    uint32_t nrows;
-
-    switch (ds_format) {
+/*
+ * Function: predsKeyRange
+ * Description: Narrow the range [lo, hi] to the vals of col col_idx that may
+ *              satisfy the preds. Only comparison, eq, in and between preds
+ *              over the col restrict the range, and only if all preds are
+ *              chained with logical_and, otherwise the range is unchanged.
+ * @param[in] preds     : query predicates
+ * @param[in] col_idx   : an integral or SDT_DATE col (as days)
+ * @param[in,out] lo    : lowest val that may pass
+ * @param[in,out] hi    : highest val that may pass
+ * Return Value: none
+ */
+void predsKeyRange(predicate_vec &preds, int col_idx, int64_t& lo,
+                   int64_t& hi) {
+    for (auto it = preds.begin(); it != preds.end(); ++it) {
+        if ((*it)->chainOpType() != SOT_logical_and)
+            return;
+    }
 
-        case SFT_FLATBUF_FLEX_ROW: {
-            const Table* root = GetTable(ds);
-            skyhook_version = root->skyhook_version();
-            data_format_type = root->data_format_type();
-            data_structure_version = root->data_structure_version();
-            data_schema_version = root->data_schema_version();
-            data_schema = root->data_schema()->str();
-            db_schema_name = root->db_schema()->str();
-            table_name = root->table_name()->str();
-            delete_vec = delete_vector(root->delete_vector()->begin(),
-                                       root->delete_vector()->end());
-            data_vec = root->rows();
-            nrows = root->nrows();
-            break;
-        }
+    int64_t l = lo;
+    int64_t h = hi;
+    for (auto it = preds.begin(); it != preds.end(); ++it) {
+        PredicateBase* pb = *it;
+        if (pb->colIdx() != col_idx or pb->isGlobalAgg())
+            continue;
 
-        case SFT_JSON: {
-            const Table_FBX* root = GetTable_FBX(ds);
-            skyhook_version = root->skyhook_version();
-            data_format_type = root->data_format_type();
-            data_structure_version = root->data_structure_version();
-            data_schema_version = root->data_schema_version();
-            data_schema = root->data_schema()->str();
-            db_schema_name = root->db_schema_name()->str();
-            table_name = root->table_name()->str();
-            delete_vec = delete_vector(root->delete_vector()->begin(),
-                                       root->delete_vector()->end());
-            data_vec = root->rows_vec();
-            nrows = root->nrows();
-            break;
+        std::vector<int64_t> v;
+        bool clamped = false;
+        switch (pb->colType()) {
+            case SDT_INT8: v = predIntVals<int8_t>(pb, clamped); break;
+            case SDT_INT16: v = predIntVals<int16_t>(pb, clamped); break;
+            case SDT_INT32: v = predIntVals<int32_t>(pb, clamped); break;
+            case SDT_INT64: v = predIntVals<int64_t>(pb, clamped); break;
+            case SDT_UINT8: v = predIntVals<uint8_t>(pb, clamped); break;
+            case SDT_UINT16: v = predIntVals<uint16_t>(pb, clamped); break;
+            case SDT_UINT32: v = predIntVals<uint32_t>(pb, clamped); break;
+            case SDT_UINT64: v = predIntVals<uint64_t>(pb, clamped); break;
+            case SDT_DATE: v = predIntVals<int32_t>(pb, clamped); break;
+            default: continue;
         }
 
-        case SFT_ARROW: {
-            std::shared_ptr<arrow::Table> table;
-            std::shared_ptr<arrow::Buffer> buffer = \
-                arrow::MutableBuffer::Wrap(reinterpret_cast<uint8_t*>(const_cast<char*>(ds)), ds_size);
-            extract_arrow_from_buffer(&table, buffer);
-            auto schema = table->schema();
-            auto metadata = schema->metadata();
-            skyhook_version = std::stoi(metadata->value(METADATA_SKYHOOK_VERSION));
-            data_format_type = std::stoi(metadata->value(METADATA_DATA_FORMAT_TYPE));
-            data_structure_version = std::stoi(metadata->value(METADATA_DATA_STRUCTURE_VERSION));
-            data_schema_version = std::stoi(metadata->value(METADATA_DATA_SCHEMA_VERSION));
-            data_schema = metadata->value(METADATA_DATA_SCHEMA);
-            db_schema_name = metadata->value(METADATA_DB_SCHEMA);
-            table_name = metadata->value(METADATA_TABLE_NAME);
-            data_vec = NULL;
-            nrows = std::stoi(metadata->value(METADATA_NUM_ROWS));
-            break;
+        switch (pb->opType()) {
+            case SOT_lt:
+                if (clamped)
+                    break;  // saturated keys equal v[0], keep hi as is
+                if (v[0] > INT64_MIN) h = std::min(h, v[0] - 1);
+                else return;  // nothing passes, leave the range as is
+                break;
+            case SOT_leq:
+                h = std::min(h, v[0]);
+                break;
+            case SOT_gt:
+                if (v[0] < INT64_MAX) l = std::max(l, v[0] + 1);
+                else return;
+                break;
+            case SOT_geq:
+                l = std::max(l, v[0]);
+                break;
+            case SOT_eq:
+            case SOT_in:
+            case SOT_between:
+                l = std::max(l, *std::min_element(v.begin(), v.end()));
+                h = std::min(h, *std::max_element(v.begin(), v.end()));
+                break;
+            default:
+                break;
         }
-
-        case SFT_FLATBUF_CSV_ROW:
-        case SFT_PG_TUPLE:
-        case SFT_CSV:
-        default:
-            assert (SkyFormatTypeNotRecognized==0);
     }
-
-    // this is our skyhook_root struct now, which is agnostic to the
-    // underlying format and can be operated upon generically.
-    return sky_root(
-        skyhook_version,
-        data_format_type,
-        data_structure_version,
-        data_schema_version,
-        data_schema,
-        db_schema_name,
-        table_name,
-        delete_vec,
-        data_vec,
-        nrows
-    );
+    lo = l;
+    hi = h;
 }
 
-// extracts a single record for formats flatbuf and json only, can also be
-// extended for csv format
-sky_rec getSkyRec(const Tables::Record* rec, int format) {
+// reduce the inner list of a jagged array val in a flexbuf row, see arith_expr
+template <typename T, typename VecType>
+static T reduceFlexList(const VecType& v, int agg, int elem_type)
+{
+    if (agg == SOT_cnt)
+        return static_cast<T>(v.size());
 
-    switch (format) {
-        case SFT_FLATBUF_FLEX_ROW:
-            return sky_rec(
-                rec->RID(),
-                nullbits_vector(rec->nullbits()->begin(),
-                                rec->nullbits()->end()),
-                rec->data_flexbuffer_root()
-            );
-            break;
+    T acc = 0;
+    for (size_t j = 0; j < v.size(); j++) {
+        T val;
+        switch (elem_type) {
+            case SDT_FLOAT:
+            case SDT_DOUBLE:
+                val = static_cast<T>(v[j].AsDouble());
+                break;
+            case SDT_UINT64:
+                val = static_cast<T>(v[j].AsUInt64());
+                break;
+            default:
+                val = static_cast<T>(v[j].AsInt64());
+        }
+        if (agg == SOT_sum)
+            acc += val;
+        else if (j == 0 or (agg == SOT_min ? val < acc : val > acc))
+            acc = val;
+    }
+    return acc;
+}
 
-        case SFT_JSON:
+template <typename T>
+static T reduceFlexJagged(const flexbuffers::Reference& ref, int agg, int type)
+{
+    if (ref.IsTypedVector())
+        return reduceFlexList<T>(ref.AsTypedVector(), agg, jaggedElemType(type));
+    return reduceFlexList<T>(ref.AsVector(), agg, jaggedElemType(type));
+}
 
+template <typename T>
+static T evalArithExprRow(const arith_expr_ptr& e, const flexbuffers::Vector& row)
+{
+    // note: only double exprs may contain a division, see exprsFromString
+    switch (e->op) {
+        case SOT_add:
+            return evalArithExprRow<T>(e->left, row) +
+                   evalArithExprRow<T>(e->right, row);
+        case SOT_sub:
+            return evalArithExprRow<T>(e->left, row) -
+                   evalArithExprRow<T>(e->right, row);
+        case SOT_mul:
+            return evalArithExprRow<T>(e->left, row) *
+                   evalArithExprRow<T>(e->right, row);
+        case SOT_div:
+            return evalArithExprRow<T>(e->left, row) /
+                   evalArithExprRow<T>(e->right, row);
+        default:
             break;
+    }
 
+    // leaf node
+    if (e->col_idx < 0) {
+        if (std::is_floating_point<T>::value)
+            return static_cast<T>(e->dval);
+        return static_cast<T>(e->ival);
+    }
+    if (e->agg)
+        return reduceFlexJagged<T>(row[e->col_idx], e->agg, e->col_type);
+    switch (e->col_type) {
+        case SDT_FLOAT:
+        case SDT_DOUBLE:
+            return static_cast<T>(row[e->col_idx].AsDouble());
+        case SDT_UINT64:
+            return static_cast<T>(row[e->col_idx].AsUInt64());
+        case SDT_DATE:
+            return static_cast<T>(flexDateToDays(row[e->col_idx]));
         default:
-            assert (TablesErrCodes::SkyFormatTypeNotRecognized==0);
-
+            return static_cast<T>(row[e->col_idx].AsInt64());
     }
+}
 
-    // NOTE: default in declaration is SFT_FLATBUF_FLEX_ROW)
-    return sky_rec(
-        rec->RID(),
-        nullbits_vector(rec->nullbits()->begin(),
-                        rec->nullbits()->end()),
-        rec->data_flexbuffer_root()
-    );
+int64_t evalArithExprInt(const arith_expr_ptr& e, const flexbuffers::Vector& row) {
+    return evalArithExprRow<int64_t>(e, row);
+}
+
+double evalArithExprDouble(const arith_expr_ptr& e, const flexbuffers::Vector& row) {
+    return evalArithExprRow<double>(e, row);
 }
 
-/* TODO:
-* update sky_rec struct for rec fbx
-* sky_rec getSkyRec(const Tables::Record_FBX *rec, int format) {
-*
-*}
-*/
+void exprColIdxs(const arith_expr_ptr& e, std::set<int>& cols) {
+    if (e->op) {
+        exprColIdxs(e->left, cols);
+        exprColIdxs(e->right, cols);
+    }
+    else if (e->col_idx >= 0) {
+        cols.insert(e->col_idx);
+    }
+}
 
-bool hasAggPreds(predicate_vec &preds) {
-    for (auto it=preds.begin(); it!=preds.end();++it)
-        if ((*it)->isGlobalAgg()) return true;
+// apply a predicate over a computed col to a flexbuf row
+static bool applyExprPredicate(PredicateBase* pb, const expr_info& ei,
+                               const flexbuffers::Vector& row) {
+    bool colpass = false;
+    if (isSketchAgg(pb->opType())) {
+        SketchPredicate* p = dynamic_cast<SketchPredicate*>(pb);
+        if (ei.col.type == SDT_DOUBLE)
+            p->addDouble(evalArithExprDouble(ei.expr, row));
+        else
+            p->addInt(evalArithExprInt(ei.expr, row));
+        return colpass;
+    }
+    if (ei.col.type == SDT_DOUBLE) {
+        TypedPredicate<double>* p = \
+                dynamic_cast<TypedPredicate<double>*>(pb);
+        double colval = evalArithExprDouble(ei.expr, row);
+        double predval = p->Val();
+        if (p->isGlobalAgg())
+            p->updateAgg(computeAgg(colval,predval,p->opType()));
+        else if (isListOp(p->opType()))
+            colpass = p->probe(colval);
+        else
+            colpass = compare(colval,predval,p->opType());
+    }
+    else {
+        TypedPredicate<int64_t>* p = \
+                dynamic_cast<TypedPredicate<int64_t>*>(pb);
+        int64_t colval = evalArithExprInt(ei.expr, row);
+        int64_t predval = p->Val();
+        if (p->isGlobalAgg())
+            p->updateAgg(computeAgg(colval,predval,p->opType()));
+        else if (isListOp(p->opType()))
+            colpass = p->probe(colval);
+        else
+            colpass = compare(colval,predval,p->opType());
+    }
+    return colpass;
+}
+
+// apply an in/not_in/between predicate to a flexbuf row
+static bool applyListPredicate(PredicateBase* pb,
+                               const flexbuffers::Vector& row,
+                               sky_rec& rec) {
+    const int idx = pb->colIdx();
+    switch (pb->colType()) {
+        case SDT_BOOL:
+            return dynamic_cast<TypedPredicate<bool>*>(pb)->
+                probe(row[idx].AsBool());
+        case SDT_INT8:
+            return dynamic_cast<TypedPredicate<int8_t>*>(pb)->
+                probe(row[idx].AsInt8());
+        case SDT_INT16:
+            return dynamic_cast<TypedPredicate<int16_t>*>(pb)->
+                probe(row[idx].AsInt16());
+        case SDT_INT32:
+            return dynamic_cast<TypedPredicate<int32_t>*>(pb)->
+                probe(row[idx].AsInt32());
+        case SDT_INT64:
+            return dynamic_cast<TypedPredicate<int64_t>*>(pb)->
+                probe(idx == RID_COL_INDEX ? static_cast<int64_t>(rec.RID) :
+                                             row[idx].AsInt64());
+        case SDT_UINT8:
+            return dynamic_cast<TypedPredicate<uint8_t>*>(pb)->
+                probe(row[idx].AsUInt8());
+        case SDT_UINT16:
+            return dynamic_cast<TypedPredicate<uint16_t>*>(pb)->
+                probe(row[idx].AsUInt16());
+        case SDT_UINT32:
+            return dynamic_cast<TypedPredicate<uint32_t>*>(pb)->
+                probe(row[idx].AsUInt32());
+        case SDT_UINT64:
+            return dynamic_cast<TypedPredicate<uint64_t>*>(pb)->
+                probe(idx == RID_COL_INDEX ? rec.RID : row[idx].AsUInt64());
+        case SDT_FLOAT:
+            return dynamic_cast<TypedPredicate<float>*>(pb)->
+                probe(row[idx].AsFloat());
+        case SDT_DOUBLE:
+            return dynamic_cast<TypedPredicate<double>*>(pb)->
+                probe(row[idx].AsDouble());
+        case SDT_CHAR:
+            return dynamic_cast<TypedPredicate<char>*>(pb)->
+                probe(static_cast<char>(row[idx].AsInt8()));
+        case SDT_UCHAR:
+            return dynamic_cast<TypedPredicate<unsigned char>*>(pb)->
+                probe(row[idx].AsUInt8());
+        case SDT_DATE:
+            return dynamic_cast<TypedPredicate<int32_t>*>(pb)->
+                probe(flexDateToDays(row[idx]));
+        case SDT_STRING:
+            return dynamic_cast<TypedPredicate<std::string>*>(pb)->
+                probe(row[idx].AsString().str());
+        default: assert (TablesErrCodes::PredicateComparisonNotDefined==0);
+    }
     return false;
 }
 
 // used by processFormat_X methods
 // returns true if the record passes all of the predicates (and/or)
-bool applyPredicates(predicate_vec& pv, sky_rec& rec) {
+bool applyPredicates(predicate_vec& pv, sky_rec& rec, const expr_vec& exprs) {
 
     bool rowpass = false;
     bool init_rowpass = false;
@@ -1267,7 +3367,30 @@ bool applyPredicates(predicate_vec& pv, sky_rec& rec) {
         if ((chain_optype == SOT_logical_and) and !rowpass) break;
 
         bool colpass = false;
-        switch((*it)->colType()) {
+        if (!exprs.empty() and (*it)->colIdx() >= exprs.front().col.idx) {
+            // computed col, evaluate its expr over this row
+            colpass = applyExprPredicate(*it,
+                        exprs.at((*it)->colIdx() - exprs.front().col.idx),
+                        row);
+        }
+        else if (isListOp((*it)->opType())) {
+            colpass = applyListPredicate(*it, row, rec);
+        }
+        else if (isSketchAgg((*it)->opType())) {
+            SketchPredicate* p = dynamic_cast<SketchPredicate*>(*it);
+            if (p->colIdx() == RID_COL_INDEX)
+                p->addInt(rec.RID);  // RID val not in the row
+            else
+                p->addFlex(row[p->colIdx()]);
+        }
+        else if ((*it)->opType() == SOT_sample) {
+            colpass = dynamic_cast<SamplePredicate*>(*it)->keep(rec.RID);
+        }
+        else if ((*it)->opType() == SOT_dict_code) {
+            colpass = dynamic_cast<DictPredicate*>(*it)->
+                keep(row[(*it)->colIdx()].AsUInt64());
+        }
+        else switch((*it)->colType()) {
 
             // NOTE: predicates have typed ints but our int comparison
             // functions are defined on 64bit ints.
@@ -1471,8 +3594,21 @@ bool applyPredicates(predicate_vec& pv, sky_rec& rec) {
                 break;
             }
 
-            case SDT_STRING:
             case SDT_DATE: {
+                TypedPredicate<int32_t>* p = \
+                        dynamic_cast<TypedPredicate<int32_t>*>(*it);
+                int32_t colval = flexDateToDays(row[p->colIdx()]);
+                int32_t predval = p->Val();
+                if (p->isGlobalAgg())
+                    p->updateAgg(computeAgg(colval,predval,p->opType()));
+                else
+                    colpass = compare(colval,
+                                      static_cast<int64_t>(predval),
+                                      p->opType());
+                break;
+            }
+
+            case SDT_STRING: {
                 TypedPredicate<std::string>* p = \
                         dynamic_cast<TypedPredicate<std::string>*>(*it);
                 string colval = row[p->colIdx()].AsString().str();
@@ -1483,6 +3619,10 @@ bool applyPredicates(predicate_vec& pv, sky_rec& rec) {
             default: assert (TablesErrCodes::PredicateComparisonNotDefined==0);
         }
 
+        // agg preds only accumulate the rows that reach them, they do not
+        // decide the row, so each agg pred that follows is also updated.
+        if ((*it)->isGlobalAgg()) continue;
+
         // incorporate local col passing into the decision to pass row.
         switch (chain_optype) {
             case SOT_logical_or:
@@ -1499,6 +3639,61 @@ bool applyPredicates(predicate_vec& pv, sky_rec& rec) {
 }
 
 
+template <typename ArrayType, typename T>
+static bool probeArrowColVal(PredicateBase* pb,
+                             std::shared_ptr<arrow::Array> array,
+                             int element_index)
+{
+    TypedPredicate<T>* p = dynamic_cast<TypedPredicate<T>*>(pb);
+    auto arr = std::static_pointer_cast<ArrayType>(array);
+    return p->probe(static_cast<T>(arr->Value(element_index)));
+}
+
+// apply an in/not_in/between predicate to one row of an arrow table
+static bool applyListPredicateArrow(PredicateBase* pb,
+                                    std::shared_ptr<arrow::Array> array,
+                                    int element_index)
+{
+    switch (pb->colType()) {
+        case SDT_BOOL:
+            return probeArrowColVal<arrow::BooleanArray, bool>(pb, array, element_index);
+        case SDT_INT8:
+            return probeArrowColVal<arrow::Int8Array, int8_t>(pb, array, element_index);
+        case SDT_INT16:
+            return probeArrowColVal<arrow::Int16Array, int16_t>(pb, array, element_index);
+        case SDT_INT32:
+            return probeArrowColVal<arrow::Int32Array, int32_t>(pb, array, element_index);
+        case SDT_INT64:
+            return probeArrowColVal<arrow::Int64Array, int64_t>(pb, array, element_index);
+        case SDT_UINT8:
+            return probeArrowColVal<arrow::UInt8Array, uint8_t>(pb, array, element_index);
+        case SDT_UINT16:
+            return probeArrowColVal<arrow::UInt16Array, uint16_t>(pb, array, element_index);
+        case SDT_UINT32:
+            return probeArrowColVal<arrow::UInt32Array, uint32_t>(pb, array, element_index);
+        case SDT_UINT64:
+            return probeArrowColVal<arrow::UInt64Array, uint64_t>(pb, array, element_index);
+        case SDT_FLOAT:
+            return probeArrowColVal<arrow::FloatArray, float>(pb, array, element_index);
+        case SDT_DOUBLE:
+            return probeArrowColVal<arrow::DoubleArray, double>(pb, array, element_index);
+        case SDT_CHAR:
+            return probeArrowColVal<arrow::Int8Array, char>(pb, array, element_index);
+        case SDT_UCHAR:
+            return probeArrowColVal<arrow::UInt8Array, unsigned char>(pb, array, element_index);
+        case SDT_DATE:
+            return probeArrowColVal<arrow::Date32Array, int32_t>(pb, array, element_index);
+        case SDT_STRING: {
+            TypedPredicate<std::string>* p = \
+                    dynamic_cast<TypedPredicate<std::string>*>(pb);
+            auto arr = std::static_pointer_cast<arrow::StringArray>(array);
+            return p->probe(arr->GetString(element_index));
+        }
+        default: assert (TablesErrCodes::PredicateComparisonNotDefined==0);
+    }
+    return false;
+}
+
 // used by processArrow methods only
 // returns true if the record passes all of the predicates (and/or)
 // TODO: Merge with applyPredicates, mostly duplicated functionality
@@ -1526,7 +3721,23 @@ bool applyPredicatesArrow(predicate_vec& pv, std::shared_ptr<arrow::Table>& tabl
         if ((chain_optype == SOT_logical_and) and !rowpass) break;
 
         bool colpass = false;
-        switch((*it)->colType()) {
+        if (isListOp((*it)->opType())) {
+            colpass = applyListPredicateArrow(*it,
+                        table->column((*it)->colIdx())->chunk(0),
+                        element_index);
+        }
+        else if (isSketchAgg((*it)->opType())) {
+            dynamic_cast<SketchPredicate*>(*it)->addArrow(
+                table->column((*it)->colIdx())->chunk(0), element_index);
+        }
+        else if ((*it)->opType() == SOT_sample) {
+            // the RID and delete vector cols follow the data cols
+            auto rids = std::static_pointer_cast<arrow::Int64Array>(
+                table->column(ARROW_RID_INDEX(num_cols - 2))->chunk(0));
+            colpass = dynamic_cast<SamplePredicate*>(*it)->keep(
+                rids->Value(element_index));
+        }
+        else switch((*it)->colType()) {
 
             // NOTE: predicates have typed ints but our int comparison
             // functions are defined on 64bit ints.
@@ -1719,317 +3930,769 @@ bool applyPredicatesArrow(predicate_vec& pv, std::shared_ptr<arrow::Table>& tabl
                 }
                 break;
             }
-
+
+            case SDT_UCHAR: {
+                TypedPredicate<unsigned char>* p = \
+                        dynamic_cast<TypedPredicate<unsigned char>*>(*it);
+                auto array = table->column(p->colIdx())->chunk(0);
+                if (p->opType() == SOT_like) {
+                    // use strings for regex
+                    std::string colval = std::to_string((char)std::static_pointer_cast<arrow::UInt8Array>(array)->Value(element_index));
+                    std::string predval = std::to_string(p->Val());
+                    colpass = compare(colval,predval,p->opType(),p->colType());
+                }
+                else {
+                    // use int val comparision method
+                    uint8_t colval = std::static_pointer_cast<arrow::UInt8Array>(array)->Value(element_index);
+                    uint8_t predval = p->Val();
+                    if (p->isGlobalAgg())
+                        p->updateAgg(computeAgg(colval,predval,p->opType()));
+                    else
+                        colpass = compare(colval,
+                                          static_cast<uint64_t>(predval),
+                                          p->opType());
+                }
+                break;
+            }
+
+            case SDT_DATE: {
+                TypedPredicate<int32_t>* p = \
+                        dynamic_cast<TypedPredicate<int32_t>*>(*it);
+                auto array = table->column(p->colIdx())->chunk(0);
+                int32_t colval = std::static_pointer_cast<arrow::Date32Array>(array)->Value(element_index);
+                int32_t predval = p->Val();
+                if (p->isGlobalAgg())
+                    p->updateAgg(computeAgg(colval,predval,p->opType()));
+                else
+                    colpass = compare(colval,
+                                      static_cast<int64_t>(predval),
+                                      p->opType());
+                break;
+            }
+
+            case SDT_STRING: {
+                TypedPredicate<std::string>* p = \
+                        dynamic_cast<TypedPredicate<std::string>*>(*it);
+                auto array = table->column(p->colIdx())->chunk(0);
+                string colval = std::static_pointer_cast<arrow::StringArray>(array)->GetString(element_index);
+                colpass = compare(colval,p->Val(),p->opType(),p->colType());
+                break;
+            }
+
+            default: assert (TablesErrCodes::PredicateComparisonNotDefined==0);
+        }
+
+        // agg preds only accumulate the rows that reach them, they do not
+        // decide the row, so each agg pred that follows is also updated.
+        if ((*it)->isGlobalAgg()) continue;
+
+        // incorporate local col passing into the decision to pass row.
+        switch (chain_optype) {
+            case SOT_logical_or:
+                rowpass |= colpass;
+                break;
+            case SOT_logical_and:
+                rowpass &= colpass;
+                break;
+            default: // should not be reachable
+                rowpass &= colpass;
+        }
+    }
+    return rowpass;
+}
+
+// evaluate one predicate over a primitive arrow column into the selection
+// bitmap. Only rows whose current selection state equals 'want' are
+// evaluated, i.e., selected rows for an AND chain and unselected rows for an
+// OR chain, the other rows are already decided by the preceding predicates.
+template <typename ArrayType, typename T>
+static void selectArrowColVals(std::shared_ptr<arrow::Array> col_array,
+                               T predval, int op, uint8_t want,
+                               std::vector<uint8_t>& sel)
+{
+    auto arr = std::static_pointer_cast<ArrayType>(col_array);
+    const auto* vals = arr->raw_values();
+    const int64_t n = std::min<int64_t>(arr->length(), sel.size());
+    uint8_t* s = sel.data();
+
+    // hoist the op dispatch out of the row loop for the common ops.
+    switch (op) {
+        case SOT_lt:
+            for (int64_t r = 0; r < n; r++)
+                if (s[r] == want) s[r] = static_cast<T>(vals[r]) < predval;
+            break;
+        case SOT_gt:
+            for (int64_t r = 0; r < n; r++)
+                if (s[r] == want) s[r] = static_cast<T>(vals[r]) > predval;
+            break;
+        case SOT_eq:
+            for (int64_t r = 0; r < n; r++)
+                if (s[r] == want) s[r] = static_cast<T>(vals[r]) == predval;
+            break;
+        case SOT_ne:
+            for (int64_t r = 0; r < n; r++)
+                if (s[r] == want) s[r] = static_cast<T>(vals[r]) != predval;
+            break;
+        case SOT_leq:
+            for (int64_t r = 0; r < n; r++)
+                if (s[r] == want) s[r] = static_cast<T>(vals[r]) <= predval;
+            break;
+        case SOT_geq:
+            for (int64_t r = 0; r < n; r++)
+                if (s[r] == want) s[r] = static_cast<T>(vals[r]) >= predval;
+            break;
+        default:
+            for (int64_t r = 0; r < n; r++)
+                if (s[r] == want)
+                    s[r] = compare(static_cast<T>(vals[r]), predval, op);
+    }
+}
+
+// evaluate an in/not_in/between predicate over a primitive arrow column into
+// the selection bitmap, same as selectArrowColVals.
+template <typename ArrayType, typename T>
+static void selectArrowColList(std::shared_ptr<arrow::Array> col_array,
+                               PredicateBase* pb, uint8_t want,
+                               std::vector<uint8_t>& sel)
+{
+    TypedPredicate<T>* p = dynamic_cast<TypedPredicate<T>*>(pb);
+    auto arr = std::static_pointer_cast<ArrayType>(col_array);
+    const int64_t n = std::min<int64_t>(arr->length(), sel.size());
+    uint8_t* s = sel.data();
+    for (int64_t r = 0; r < n; r++)
+        if (s[r] == want) s[r] = p->probe(static_cast<T>(arr->Value(r)));
+}
+
+static void selectArrowColListPred(PredicateBase* pb,
+                                   std::shared_ptr<arrow::Array> col_array,
+                                   uint8_t want,
+                                   std::vector<uint8_t>& sel)
+{
+    switch (pb->colType()) {
+        case SDT_BOOL:
+            selectArrowColList<arrow::BooleanArray, bool>(col_array, pb, want, sel);
+            break;
+        case SDT_INT8:
+            selectArrowColList<arrow::Int8Array, int8_t>(col_array, pb, want, sel);
+            break;
+        case SDT_INT16:
+            selectArrowColList<arrow::Int16Array, int16_t>(col_array, pb, want, sel);
+            break;
+        case SDT_INT32:
+            selectArrowColList<arrow::Int32Array, int32_t>(col_array, pb, want, sel);
+            break;
+        case SDT_INT64:
+            selectArrowColList<arrow::Int64Array, int64_t>(col_array, pb, want, sel);
+            break;
+        case SDT_UINT8:
+            selectArrowColList<arrow::UInt8Array, uint8_t>(col_array, pb, want, sel);
+            break;
+        case SDT_UINT16:
+            selectArrowColList<arrow::UInt16Array, uint16_t>(col_array, pb, want, sel);
+            break;
+        case SDT_UINT32:
+            selectArrowColList<arrow::UInt32Array, uint32_t>(col_array, pb, want, sel);
+            break;
+        case SDT_UINT64:
+            selectArrowColList<arrow::UInt64Array, uint64_t>(col_array, pb, want, sel);
+            break;
+        case SDT_FLOAT:
+            selectArrowColList<arrow::FloatArray, float>(col_array, pb, want, sel);
+            break;
+        case SDT_DOUBLE:
+            selectArrowColList<arrow::DoubleArray, double>(col_array, pb, want, sel);
+            break;
+        case SDT_CHAR:
+            selectArrowColList<arrow::Int8Array, char>(col_array, pb, want, sel);
+            break;
+        case SDT_UCHAR:
+            selectArrowColList<arrow::UInt8Array, unsigned char>(col_array, pb, want, sel);
+            break;
+        case SDT_DATE:
+            selectArrowColList<arrow::Date32Array, int32_t>(col_array, pb, want, sel);
+            break;
+        case SDT_STRING: {
+            TypedPredicate<std::string>* p = \
+                dynamic_cast<TypedPredicate<std::string>*>(pb);
+            auto arr = std::static_pointer_cast<arrow::StringArray>(col_array);
+            const int64_t n = std::min<int64_t>(arr->length(), sel.size());
+            for (int64_t r = 0; r < n; r++)
+                if (sel[r] == want) sel[r] = p->probe(arr->GetString(r));
+            break;
+        }
+        default: assert (TablesErrCodes::PredicateComparisonNotDefined==0);
+    }
+}
+
+/*
+ * Function: applyPredicatesArrowColSel
+ * Description: Columnwise predicate evaluation for processArrowCol. Each
+ *              predicate is evaluated over its entire column into a selection
+ *              bitmap (one byte per row), chained with the same and/or
+ *              semantics as applyPredicates, so that no row values are
+ *              materialized until the final set of rows is known.
+ * @param[in] pv      : Predicates to apply, agg predicates are ignored
+ * @param[in] table   : Input arrow table
+ * @param[in,out] sel : On input the candidate rows (1=candidate), on output
+ *                      the candidate rows that also pass the predicates.
+ * Return Value: none
+ */
+void applyPredicatesArrowColSel(predicate_vec& pv,
+                                std::shared_ptr<arrow::Table>& table,
+                                std::vector<uint8_t>& sel)
+{
+    // first non-agg predicate determines the initial pass value, the same
+    // as applyPredicates.
+    int first_chain_optype = -1;
+    for (auto it = pv.begin(); it != pv.end(); ++it) {
+        if (!(*it)->isGlobalAgg()) {
+            first_chain_optype = (*it)->chainOpType();
+            break;
+        }
+    }
+    if (first_chain_optype == -1)
+        return;
+
+    std::vector<uint8_t> pass(sel.size(),
+                              first_chain_optype == SOT_logical_or ? 0 : 1);
+
+    for (auto it = pv.begin(); it != pv.end(); ++it) {
+
+        if ((*it)->isGlobalAgg())
+            continue;
+
+        // AND chains only need to look at rows that have passed so far, OR
+        // chains only at rows that have not yet passed.
+        uint8_t want = ((*it)->chainOpType() == SOT_logical_or) ? 0 : 1;
+        int op = (*it)->opType();
+
+        // the RID and delete vector cols follow the data cols
+        if (op == SOT_sample) {
+            SamplePredicate* p = dynamic_cast<SamplePredicate*>(*it);
+            auto rids = std::static_pointer_cast<arrow::Int64Array>(
+                table->column(ARROW_RID_INDEX(table->num_columns() - 2))
+                    ->chunk(0));
+            const int64_t n = std::min<int64_t>(rids->length(), pass.size());
+            for (int64_t r = 0; r < n; r++)
+                if (pass[r] == want)
+                    pass[r] = p->keep(rids->Value(r));
+            continue;
+        }
+
+        auto col_array = table->column((*it)->colIdx())->chunk(0);
+
+        if (isListOp(op)) {
+            selectArrowColListPred(*it, col_array, want, pass);
+            continue;
+        }
+
+        switch((*it)->colType()) {
+
+            case SDT_BOOL: {
+                TypedPredicate<bool>* p =                               \
+                    dynamic_cast<TypedPredicate<bool>*>(*it);
+                auto arr = std::static_pointer_cast<arrow::BooleanArray>(col_array);
+                const int64_t n = std::min<int64_t>(arr->length(), pass.size());
+                for (int64_t r = 0; r < n; r++)
+                    if (pass[r] == want)
+                        pass[r] = compare(arr->Value(r), p->Val(), op);
+                break;
+            }
+            case SDT_INT8: {
+                TypedPredicate<int8_t>* p =                             \
+                    dynamic_cast<TypedPredicate<int8_t>*>(*it);
+                selectArrowColVals<arrow::Int8Array>(col_array,
+                        static_cast<int64_t>(p->Val()), op, want, pass);
+                break;
+            }
+            case SDT_INT16: {
+                TypedPredicate<int16_t>* p =                            \
+                    dynamic_cast<TypedPredicate<int16_t>*>(*it);
+                selectArrowColVals<arrow::Int16Array>(col_array,
+                        static_cast<int64_t>(p->Val()), op, want, pass);
+                break;
+            }
+            case SDT_INT32: {
+                TypedPredicate<int32_t>* p =                            \
+                    dynamic_cast<TypedPredicate<int32_t>*>(*it);
+                selectArrowColVals<arrow::Int32Array>(col_array,
+                        static_cast<int64_t>(p->Val()), op, want, pass);
+                break;
+            }
+            case SDT_INT64: {
+                TypedPredicate<int64_t>* p =                            \
+                    dynamic_cast<TypedPredicate<int64_t>*>(*it);
+                selectArrowColVals<arrow::Int64Array>(col_array,
+                        static_cast<int64_t>(p->Val()), op, want, pass);
+                break;
+            }
+            case SDT_UINT8: {
+                TypedPredicate<uint8_t>* p =                            \
+                    dynamic_cast<TypedPredicate<uint8_t>*>(*it);
+                selectArrowColVals<arrow::UInt8Array>(col_array,
+                        static_cast<uint64_t>(p->Val()), op, want, pass);
+                break;
+            }
+            case SDT_UINT16: {
+                TypedPredicate<uint16_t>* p =                           \
+                    dynamic_cast<TypedPredicate<uint16_t>*>(*it);
+                selectArrowColVals<arrow::UInt16Array>(col_array,
+                        static_cast<uint64_t>(p->Val()), op, want, pass);
+                break;
+            }
+            case SDT_UINT32: {
+                TypedPredicate<uint32_t>* p =                           \
+                    dynamic_cast<TypedPredicate<uint32_t>*>(*it);
+                selectArrowColVals<arrow::UInt32Array>(col_array,
+                        static_cast<uint64_t>(p->Val()), op, want, pass);
+                break;
+            }
+            case SDT_UINT64: {
+                TypedPredicate<uint64_t>* p =                           \
+                    dynamic_cast<TypedPredicate<uint64_t>*>(*it);
+                selectArrowColVals<arrow::UInt64Array>(col_array,
+                        static_cast<uint64_t>(p->Val()), op, want, pass);
+                break;
+            }
+            case SDT_FLOAT: {
+                TypedPredicate<float>* p =                              \
+                    dynamic_cast<TypedPredicate<float>*>(*it);
+                selectArrowColVals<arrow::FloatArray>(col_array,
+                        static_cast<double>(p->Val()), op, want, pass);
+                break;
+            }
+            case SDT_DOUBLE: {
+                TypedPredicate<double>* p =                             \
+                    dynamic_cast<TypedPredicate<double>*>(*it);
+                selectArrowColVals<arrow::DoubleArray>(col_array,
+                        static_cast<double>(p->Val()), op, want, pass);
+                break;
+            }
+            case SDT_CHAR: {
+                TypedPredicate<char>* p =                               \
+                    dynamic_cast<TypedPredicate<char>*>(*it);
+                if (op == SOT_like) {
+                    // use strings for regex
+                    auto arr = std::static_pointer_cast<arrow::Int8Array>(col_array);
+                    std::string predval = std::to_string(p->Val());
+                    const int64_t n = std::min<int64_t>(arr->length(), pass.size());
+                    for (int64_t r = 0; r < n; r++)
+                        if (pass[r] == want)
+                            pass[r] = compare(std::to_string((char)arr->Value(r)),
+                                              predval, op, p->colType());
+                }
+                else {
+                    selectArrowColVals<arrow::Int8Array>(col_array,
+                            static_cast<int64_t>(p->Val()), op, want, pass);
+                }
+                break;
+            }
             case SDT_UCHAR: {
-                TypedPredicate<unsigned char>* p = \
-                        dynamic_cast<TypedPredicate<unsigned char>*>(*it);
-                auto array = table->column(p->colIdx())->chunk(0);
-                if (p->opType() == SOT_like) {
+                TypedPredicate<unsigned char>* p =                      \
+                    dynamic_cast<TypedPredicate<unsigned char>*>(*it);
+                if (op == SOT_like) {
                     // use strings for regex
-                    std::string colval = std::to_string((char)std::static_pointer_cast<arrow::UInt8Array>(array)->Value(element_index));
+                    auto arr = std::static_pointer_cast<arrow::UInt8Array>(col_array);
                     std::string predval = std::to_string(p->Val());
-                    colpass = compare(colval,predval,p->opType(),p->colType());
+                    const int64_t n = std::min<int64_t>(arr->length(), pass.size());
+                    for (int64_t r = 0; r < n; r++)
+                        if (pass[r] == want)
+                            pass[r] = compare(std::to_string((char)arr->Value(r)),
+                                              predval, op, p->colType());
                 }
                 else {
-                    // use int val comparision method
-                    uint8_t colval = std::static_pointer_cast<arrow::UInt8Array>(array)->Value(element_index);
-                    uint8_t predval = p->Val();
-                    if (p->isGlobalAgg())
-                        p->updateAgg(computeAgg(colval,predval,p->opType()));
-                    else
-                        colpass = compare(colval,
-                                          static_cast<uint64_t>(predval),
-                                          p->opType());
+                    selectArrowColVals<arrow::UInt8Array>(col_array,
+                            static_cast<uint64_t>(p->Val()), op, want, pass);
                 }
                 break;
             }
-
-            case SDT_STRING:
             case SDT_DATE: {
-                TypedPredicate<std::string>* p = \
-                        dynamic_cast<TypedPredicate<std::string>*>(*it);
-                auto array = table->column(p->colIdx())->chunk(0);
-                string colval = std::static_pointer_cast<arrow::StringArray>(array)->GetString(element_index);
-                colpass = compare(colval,p->Val(),p->opType(),p->colType());
+                TypedPredicate<int32_t>* p =                            \
+                    dynamic_cast<TypedPredicate<int32_t>*>(*it);
+                selectArrowColVals<arrow::Date32Array>(col_array,
+                        static_cast<int64_t>(p->Val()), op, want, pass);
                 break;
             }
-
-            default: assert (TablesErrCodes::PredicateComparisonNotDefined==0);
-        }
-
-        // incorporate local col passing into the decision to pass row.
-        switch (chain_optype) {
-            case SOT_logical_or:
-                rowpass |= colpass;
-                break;
-            case SOT_logical_and:
-                rowpass &= colpass;
+            case SDT_STRING: {
+                TypedPredicate<std::string>* p =                        \
+                    dynamic_cast<TypedPredicate<std::string>*>(*it);
+                auto arr = std::static_pointer_cast<arrow::StringArray>(col_array);
+                const int64_t n = std::min<int64_t>(arr->length(), pass.size());
+                for (int64_t r = 0; r < n; r++)
+                    if (pass[r] == want)
+                        pass[r] = compare(arr->GetString(r), p->Val(), op,
+                                          p->colType());
                 break;
-            default: // should not be reachable
-                rowpass &= colpass;
+            }
+            default: assert (TablesErrCodes::PredicateComparisonNotDefined==0);
         }
     }
-    return rowpass;
+
+    // restrict to the candidate rows, an OR chain may have selected others.
+    for (size_t r = 0; r < sel.size(); r++)
+        sel[r] &= pass[r];
 }
 
-// used by processArrow column-wise methods only
-// returns true if the record passes all of the predicates (and/or)
-void applyPredicatesArrowCol(predicate_vec& pv,
-                             std::shared_ptr<arrow::Array> col_array,
-                             int col_idx, std::vector<uint32_t>& row_nums)
+// accumulate an exact agg over the rows of a primitive arrow col
+template <typename ArrayType, typename T>
+static void aggArrowColVals(PredicateBase* pb,
+                            std::shared_ptr<arrow::Array> col_array,
+                            const std::vector<uint32_t>& rows)
 {
-    std::vector<uint32_t> input_rows = row_nums;
-    std::vector<uint32_t> passed_rows;
-    int nrows = 0;
-    int prev_chain_optype = 0;
-    int row_idx;
-
-    if (row_nums.empty()) {
-        // Considering each columns have same number of rows
-        nrows = col_array->length();
-    }
-    else {
-        nrows = row_nums.size();
-    }
+    TypedPredicate<T>* p = dynamic_cast<TypedPredicate<T>*>(pb);
+    auto arr = std::static_pointer_cast<ArrayType>(col_array);
+    T agg = p->Val();
+    for (auto r = rows.begin(); r != rows.end(); ++r)
+        agg = computeAgg(static_cast<T>(arr->Value(*r)), agg, p->opType());
+    p->updateAgg(agg);
+}
 
+/*
+ * Function: applyAggPredsArrowCol
+ * Description: Columnwise accumulation of the global agg predicates for
+ *              processArrowCol, over the rows selected by the other
+ *              predicates (see applyPredicatesArrowColSel).
+ * @param[in] pv    : Predicates, only the agg predicates are applied
+ * @param[in] table : Input arrow table
+ * @param[in] rows  : Selected rows
+ * Return Value: none
+ */
+void applyAggPredsArrowCol(predicate_vec& pv,
+                           std::shared_ptr<arrow::Table>& table,
+                           const std::vector<uint32_t>& rows)
+{
     for (auto it = pv.begin(); it != pv.end(); ++it) {
 
-        if (col_idx != (*it)->colIdx()) {
-            // This will be useful to do union or intersection of rows
-            prev_chain_optype = (*it)->chainOpType();
+        if (!(*it)->isGlobalAgg())
             continue;
-        }
-
-        for (int i = 0; i < nrows; i++) {
-
-            if (row_nums.empty())
-                row_idx = i;
-            else
-                row_idx = row_nums[i];
-
-            switch((*it)->colType()) {
-
-                case SDT_BOOL: {
-                    TypedPredicate<bool>* p =                       \
-                        dynamic_cast<TypedPredicate<bool>*>(*it);
-                    bool colval =                                       \
-                        std::static_pointer_cast<arrow::BooleanArray>(col_array)->Value(row_idx);
-                    bool predval = p->Val();
-                    if (compare(colval, predval, p->opType()))
-                        passed_rows.push_back(row_idx);
-                    break;
-                }
-
-                case SDT_INT8: {
-                    TypedPredicate<int8_t>* p =                     \
-                        dynamic_cast<TypedPredicate<int8_t>*>(*it);
-                    int8_t colval =                                     \
-                        std::static_pointer_cast<arrow::Int8Array>(col_array)->Value(row_idx);
-                    int8_t predval = p->Val();
-                    if (compare(colval, static_cast<int64_t>(predval), p->opType()))
-                        passed_rows.push_back(row_idx);
-                    break;
-                }
-
-                case SDT_INT16: {
-                    TypedPredicate<int16_t>* p =                        \
-                        dynamic_cast<TypedPredicate<int16_t>*>(*it);
-                    int16_t colval =                                    \
-                        std::static_pointer_cast<arrow::Int16Array>(col_array)->Value(row_idx);
-                    int16_t predval = p->Val();
-                    if (compare(colval, static_cast<int64_t>(predval), p->opType()))
-                        passed_rows.push_back(row_idx);
-                    break;
-                }
 
-                case SDT_INT32: {
-                    TypedPredicate<int32_t>* p =                        \
-                        dynamic_cast<TypedPredicate<int32_t>*>(*it);
-                    int32_t colval =                                    \
-                        std::static_pointer_cast<arrow::Int32Array>(col_array)->Value(row_idx);
-                    int32_t predval = p->Val();
-                    if (compare(colval, static_cast<int64_t>(predval), p->opType()))
-                        passed_rows.push_back(row_idx);
-                    break;
-                }
-
-                case SDT_INT64: {
-                    TypedPredicate<int64_t>* p =                        \
-                        dynamic_cast<TypedPredicate<int64_t>*>(*it);
-                    int64_t colval =                                    \
-                        std::static_pointer_cast<arrow::Int64Array>(col_array)->Value(row_idx);
-                    int64_t predval = p->Val();
-                    if (compare(colval, predval, p->opType()))
-                        passed_rows.push_back(row_idx);
-                    break;
-                }
+        auto col_array = table->column((*it)->colIdx())->chunk(0);
+        if (isSketchAgg((*it)->opType())) {
+            SketchPredicate* p = dynamic_cast<SketchPredicate*>(*it);
+            for (auto r = rows.begin(); r != rows.end(); ++r)
+                p->addArrow(col_array, *r);
+            continue;
+        }
 
-                case SDT_UINT8: {
-                    TypedPredicate<uint8_t>* p =                        \
-                        dynamic_cast<TypedPredicate<uint8_t>*>(*it);
-                    uint8_t colval =                                    \
-                        std::static_pointer_cast<arrow::UInt8Array>(col_array)->Value(row_idx);
-                    uint8_t predval = p->Val();
-                    if (compare(colval, static_cast<uint64_t>(predval), p->opType()))
-                        passed_rows.push_back(row_idx);
-                    break;
-                }
+        switch((*it)->colType()) {
+            case SDT_INT8:
+                aggArrowColVals<arrow::Int8Array, int8_t>(*it, col_array, rows);
+                break;
+            case SDT_INT16:
+                aggArrowColVals<arrow::Int16Array, int16_t>(*it, col_array, rows);
+                break;
+            case SDT_INT32:
+                aggArrowColVals<arrow::Int32Array, int32_t>(*it, col_array, rows);
+                break;
+            case SDT_INT64:
+                aggArrowColVals<arrow::Int64Array, int64_t>(*it, col_array, rows);
+                break;
+            case SDT_UINT8:
+                aggArrowColVals<arrow::UInt8Array, uint8_t>(*it, col_array, rows);
+                break;
+            case SDT_UINT16:
+                aggArrowColVals<arrow::UInt16Array, uint16_t>(*it, col_array, rows);
+                break;
+            case SDT_UINT32:
+                aggArrowColVals<arrow::UInt32Array, uint32_t>(*it, col_array, rows);
+                break;
+            case SDT_UINT64:
+                aggArrowColVals<arrow::UInt64Array, uint64_t>(*it, col_array, rows);
+                break;
+            case SDT_CHAR:
+                aggArrowColVals<arrow::Int8Array, char>(*it, col_array, rows);
+                break;
+            case SDT_UCHAR:
+                aggArrowColVals<arrow::UInt8Array, unsigned char>(*it, col_array, rows);
+                break;
+            case SDT_FLOAT:
+                aggArrowColVals<arrow::FloatArray, float>(*it, col_array, rows);
+                break;
+            case SDT_DOUBLE:
+                aggArrowColVals<arrow::DoubleArray, double>(*it, col_array, rows);
+                break;
+            case SDT_DATE:
+                aggArrowColVals<arrow::Date32Array, int32_t>(*it, col_array, rows);
+                break;
+            default: assert (TablesErrCodes::UnsupportedAggDataType==0);
+        }
+    }
+}
 
-                case SDT_UINT16: {
-                    TypedPredicate<uint16_t>* p =                       \
-                        dynamic_cast<TypedPredicate<uint16_t>*>(*it);
-                    uint16_t colval =                                   \
-                        std::static_pointer_cast<arrow::UInt16Array>(col_array)->Value(row_idx);
-                    uint16_t predval = p->Val();
-                    if (compare(colval, static_cast<uint64_t>(predval), p->opType()))
-                        passed_rows.push_back(row_idx);
-                    break;
-                }
+template <typename ArrayType, typename T>
+static void gatherArrowColVals(std::shared_ptr<arrow::Array> col_array,
+                               std::vector<T>& out)
+{
+    auto arr = std::static_pointer_cast<ArrayType>(col_array);
+    const auto* vals = arr->raw_values();
+    const int64_t n = std::min<int64_t>(arr->length(), out.size());
+    for (int64_t i = 0; i < n; i++)
+        out[i] = static_cast<T>(vals[i]);
+}
 
-                case SDT_UINT32: {
-                    TypedPredicate<uint32_t>* p =                   \
-                        dynamic_cast<TypedPredicate<uint32_t>*>(*it);
-                    uint32_t colval =                                   \
-                        std::static_pointer_cast<arrow::UInt32Array>(col_array)->Value(row_idx);
-                    uint32_t predval = p->Val();
-                    if (compare(colval, static_cast<uint64_t>(predval), p->opType()))
-                        passed_rows.push_back(row_idx);
-                    break;
-                }
+// reduce the inner list of each row of a jagged array (arrow list) col into
+// out, directly over the list offsets and the flat values array. null lists
+// are empty and null list entries are skipped.
+template <typename ArrayType, typename T>
+static void reduceArrowColLists(std::shared_ptr<arrow::Array> col_array,
+                                int agg,
+                                std::vector<T>& out)
+{
+    auto arr = std::static_pointer_cast<arrow::ListArray>(col_array);
+    auto values = std::static_pointer_cast<ArrayType>(arr->values());
+    const int32_t* offs = arr->raw_value_offsets();
+    const int64_t n = std::min<int64_t>(arr->length(), out.size());
+    const bool check_nulls = values->null_count() > 0;
+
+    if (agg == SOT_cnt and !check_nulls) {
+        for (int64_t i = 0; i < n; i++)
+            out[i] = static_cast<T>(offs[i + 1] - offs[i]);
+        return;
+    }
+    for (int64_t i = 0; i < n; i++) {
+        T acc = 0;
+        bool first = true;
+        for (int32_t j = offs[i]; j < offs[i + 1]; j++) {
+            if (check_nulls and values->IsNull(j))
+                continue;
+            T val = static_cast<T>(values->Value(j));
+            if (agg == SOT_cnt)
+                acc += 1;
+            else if (agg == SOT_sum)
+                acc += val;
+            else if (first or (agg == SOT_min ? val < acc : val > acc))
+                acc = val;
+            first = false;
+        }
+        out[i] = acc;
+    }
+}
 
-                case SDT_UINT64: {
-                    TypedPredicate<uint64_t>* p =                       \
-                        dynamic_cast<TypedPredicate<uint64_t>*>(*it);
-                    uint64_t colval =                                   \
-                        std::static_pointer_cast<arrow::UInt64Array>(col_array)->Value(row_idx);
-                    uint64_t predval = p->Val();
-                    if (compare(colval, predval, p->opType()))
-                        passed_rows.push_back(row_idx);
-                    break;
-                }
+template <typename T>
+static void reduceArrowColJagged(std::shared_ptr<arrow::Array> col_array,
+                                 int type, int agg, std::vector<T>& out)
+{
+    switch (jaggedElemType(type)) {
+        case SDT_BOOL:
+            reduceArrowColLists<arrow::BooleanArray>(col_array, agg, out);
+            break;
+        case SDT_INT8:
+        case SDT_CHAR:
+            reduceArrowColLists<arrow::Int8Array>(col_array, agg, out);
+            break;
+        case SDT_INT16:
+            reduceArrowColLists<arrow::Int16Array>(col_array, agg, out);
+            break;
+        case SDT_INT32:
+            reduceArrowColLists<arrow::Int32Array>(col_array, agg, out);
+            break;
+        case SDT_INT64:
+            reduceArrowColLists<arrow::Int64Array>(col_array, agg, out);
+            break;
+        case SDT_UINT8:
+        case SDT_UCHAR:
+            reduceArrowColLists<arrow::UInt8Array>(col_array, agg, out);
+            break;
+        case SDT_UINT16:
+            reduceArrowColLists<arrow::UInt16Array>(col_array, agg, out);
+            break;
+        case SDT_UINT32:
+            reduceArrowColLists<arrow::UInt32Array>(col_array, agg, out);
+            break;
+        case SDT_UINT64:
+            reduceArrowColLists<arrow::UInt64Array>(col_array, agg, out);
+            break;
+        case SDT_FLOAT:
+            reduceArrowColLists<arrow::FloatArray>(col_array, agg, out);
+            break;
+        case SDT_DOUBLE:
+            reduceArrowColLists<arrow::DoubleArray>(col_array, agg, out);
+            break;
+        default:
+            assert (TablesErrCodes::UnsupportedSkyDataType==0);
+    }
+}
 
-                case SDT_FLOAT: {
-                    TypedPredicate<float>* p =                      \
-                        dynamic_cast<TypedPredicate<float>*>(*it);
-                    float colval =                                      \
-                        std::static_pointer_cast<arrow::FloatArray>(col_array)->Value(row_idx);
-                    float predval = p->Val();
-                    if (compare(colval, static_cast<double>(predval), p->opType()))
-                        passed_rows.push_back(row_idx);
-                    break;
-                }
+// evaluate an expr columnwise over all rows of the table into out, which
+// must be sized to the number of rows.
+template <typename T>
+static void evalArithExprCol(const arith_expr_ptr& e,
+                             std::shared_ptr<arrow::Table>& table,
+                             std::vector<T>& out)
+{
+    const int64_t n = out.size();
+
+    // leaf node
+    if (e->op == 0) {
+        if (e->col_idx < 0) {
+            T val = std::is_floating_point<T>::value ?
+                    static_cast<T>(e->dval) : static_cast<T>(e->ival);
+            std::fill(out.begin(), out.end(), val);
+            return;
+        }
+        auto col_array = table->column(e->col_idx)->chunk(0);
+        if (e->agg) {
+            reduceArrowColJagged<T>(col_array, e->col_type, e->agg, out);
+            return;
+        }
+        switch (e->col_type) {
+            case SDT_BOOL: {
+                auto arr = std::static_pointer_cast<arrow::BooleanArray>(col_array);
+                for (int64_t i = 0; i < n; i++)
+                    out[i] = static_cast<T>(arr->Value(i));
+                break;
+            }
+            case SDT_INT8:
+            case SDT_CHAR:
+                gatherArrowColVals<arrow::Int8Array>(col_array, out);
+                break;
+            case SDT_INT16:
+                gatherArrowColVals<arrow::Int16Array>(col_array, out);
+                break;
+            case SDT_INT32:
+                gatherArrowColVals<arrow::Int32Array>(col_array, out);
+                break;
+            case SDT_INT64:
+                gatherArrowColVals<arrow::Int64Array>(col_array, out);
+                break;
+            case SDT_UINT8:
+            case SDT_UCHAR:
+                gatherArrowColVals<arrow::UInt8Array>(col_array, out);
+                break;
+            case SDT_UINT16:
+                gatherArrowColVals<arrow::UInt16Array>(col_array, out);
+                break;
+            case SDT_UINT32:
+                gatherArrowColVals<arrow::UInt32Array>(col_array, out);
+                break;
+            case SDT_UINT64:
+                gatherArrowColVals<arrow::UInt64Array>(col_array, out);
+                break;
+            case SDT_FLOAT:
+                gatherArrowColVals<arrow::FloatArray>(col_array, out);
+                break;
+            case SDT_DOUBLE:
+                gatherArrowColVals<arrow::DoubleArray>(col_array, out);
+                break;
+            case SDT_DATE:
+                gatherArrowColVals<arrow::Date32Array>(col_array, out);
+                break;
+            default:
+                assert (TablesErrCodes::UnsupportedSkyDataType==0);
+        }
+        return;
+    }
 
-                case SDT_DOUBLE: {
-                    TypedPredicate<double>* p =                     \
-                        dynamic_cast<TypedPredicate<double>*>(*it);
-                    double colval =                                     \
-                        std::static_pointer_cast<arrow::DoubleArray>(col_array)->Value(row_idx);
-                    double predval = p->Val();
-                    if (compare(colval, predval, p->opType()))
-                        passed_rows.push_back(row_idx);
-                    break;
-                }
+    evalArithExprCol<T>(e->left, table, out);
+
+    // a constant right operand is applied as a scalar, e.g., (1-DISCOUNT)
+    // otherwise evaluate the right subtree into its own col first.
+    std::vector<T> rhs;
+    const T* r = nullptr;
+    T scalar = 0;
+    bool is_scalar = (e->right->op == 0 and e->right->col_idx < 0);
+    if (is_scalar) {
+        scalar = std::is_floating_point<T>::value ?
+                 static_cast<T>(e->right->dval) :
+                 static_cast<T>(e->right->ival);
+    }
+    else {
+        rhs.resize(n);
+        evalArithExprCol<T>(e->right, table, rhs);
+        r = rhs.data();
+    }
 
-                case SDT_CHAR: {
-                    TypedPredicate<char>* p=                        \
-                        dynamic_cast<TypedPredicate<char>*>(*it);
-                    if (p->opType() == SOT_like) {
-                        // use strings for regex
-                        std::string colval =                            \
-                            std::to_string((char)std::static_pointer_cast<arrow::Int8Array>(col_array)->Value(row_idx));
-                        std::string predval = std::to_string(p->Val());
-                        if (compare(colval,predval,p->opType(),p->colType()))
-                            passed_rows.push_back(row_idx);
-                    }
-                    else {
-                        // use int val comparision method
-                        int8_t colval =                                 \
-                            std::static_pointer_cast<arrow::Int8Array>(col_array)->Value(row_idx);
-                        int8_t predval = p->Val();
-                        if (compare(colval, static_cast<int64_t>(predval), p->opType()))
-                            passed_rows.push_back(row_idx);
-                    }
-                    break;
-                }
+    T* l = out.data();
+    switch (e->op) {
+        case SOT_add:
+            for (int64_t i = 0; i < n; i++) l[i] += is_scalar ? scalar : r[i];
+            break;
+        case SOT_sub:
+            for (int64_t i = 0; i < n; i++) l[i] -= is_scalar ? scalar : r[i];
+            break;
+        case SOT_mul:
+            for (int64_t i = 0; i < n; i++) l[i] *= is_scalar ? scalar : r[i];
+            break;
+        case SOT_div:
+            for (int64_t i = 0; i < n; i++) l[i] /= is_scalar ? scalar : r[i];
+            break;
+        default:
+            assert (TablesErrCodes::OpNotImplemented==0);
+    }
+}
 
-                case SDT_UCHAR: {
-                    TypedPredicate<unsigned char>* p =                  \
-                        dynamic_cast<TypedPredicate<unsigned char>*>(*it);
-                    if (p->opType() == SOT_like) {
-                        // use strings for regex
-                        std::string colval = std::to_string((char)std::static_pointer_cast<arrow::UInt8Array>(col_array)->Value(row_idx));
-                        std::string predval = std::to_string(p->Val());
-                        if (compare(colval, predval, p->opType(), p->colType()))
-                            passed_rows.push_back(row_idx);
-                    }
-                    else {
-                        // use int val comparision method
-                        uint8_t colval = std::static_pointer_cast<arrow::UInt8Array>(col_array)->Value(row_idx);
-                        uint8_t predval = p->Val();
-                        if (compare(colval, static_cast<uint64_t>(predval), p->opType()))
-                            passed_rows.push_back(row_idx);
-                    }
-                    break;
-                }
+/*
+ * Function: addExprColsArrow
+ * Description: Evaluate the computed col exprs columnwise over the input
+ *              table and return a new table with the computed cols placed
+ *              after the data cols, i.e., at their col.idx, followed by the
+ *              RID and delete vector cols. Null data vals are not
+ *              considered, the raw values are used.
+ * @param[in,out] table : Input table, replaced by the new table
+ * @param[in] num_cols  : Number of data cols in the input table
+ * @param[in] exprs     : Computed cols
+ * @param[out] errmsg   : Error message
+ * Return Value: error code
+ */
+int addExprColsArrow(std::shared_ptr<arrow::Table>* table,
+                     int num_cols,
+                     const expr_vec& exprs,
+                     std::string& errmsg)
+{
+    std::shared_ptr<arrow::Table> input_table = *table;
+    auto pool = arrow::default_memory_pool();
+    int64_t nrows = input_table->num_rows();
+    std::vector<std::shared_ptr<arrow::Field>> fields;
+    std::vector<std::shared_ptr<arrow::ChunkedArray>> columns;
 
-                case SDT_STRING:
-                case SDT_DATE: {
-                    TypedPredicate<std::string>* p =                    \
-                        dynamic_cast<TypedPredicate<std::string>*>(*it);
-                    string colval = std::static_pointer_cast<arrow::StringArray>(col_array)->GetString(row_idx);
-                    if (compare(colval, p->Val(), p->opType(), p->colType()))
-                            passed_rows.push_back(row_idx);
-                    break;
-                }
-                default: assert (TablesErrCodes::PredicateComparisonNotDefined==0);
-            }
-        }
+    for (int i = 0; i < num_cols; i++) {
+        fields.push_back(input_table->schema()->field(i));
+        columns.push_back(input_table->column(i));
+    }
 
-        // If input rows are empty then this is the first predicate. In that
-        // case return the passed rows
-        if (input_rows.empty()) {
-            row_nums = passed_rows;
+    for (auto it = exprs.begin(); it != exprs.end(); ++it) {
+        std::shared_ptr<arrow::Array> array;
+        arrow::Status s;
+        if (it->col.type == SDT_DOUBLE) {
+            std::vector<double> vals(nrows);
+            evalArithExprCol<double>(it->expr, input_table, vals);
+            arrow::DoubleBuilder builder(pool);
+            builder.AppendValues(vals);
+            s = builder.Finish(&array);
+            fields.push_back(arrow::field(it->col.name, arrow::float64()));
         }
         else {
-            switch (prev_chain_optype) {
-                case SOT_logical_or: {
-                    auto set_it = std::set_union(
-                                      input_rows.begin(),
-                                      input_rows.end(),
-                                      passed_rows.begin(),
-                                      passed_rows.end(),
-                                      row_nums.begin());
-                    row_nums.resize(set_it - row_nums.begin());
-                    break;
-                }
-                case SOT_logical_and: {
-                    auto set_it = std::set_intersection(
-                                      input_rows.begin(),
-                                      input_rows.end(),
-                                      passed_rows.begin(),
-                                      passed_rows.end(),
-                                      row_nums.begin());
-                    row_nums.resize(set_it - row_nums.begin());
-                    break;
-                }
-                default: {
-                    auto set_it = std::set_intersection(
-                                      input_rows.begin(),
-                                      input_rows.end(),
-                                      passed_rows.begin(),
-                                      passed_rows.end(),
-                                      row_nums.begin());
-                    row_nums.resize(set_it - row_nums.begin());
-                }
-            }
+            std::vector<int64_t> vals(nrows);
+            evalArithExprCol<int64_t>(it->expr, input_table, vals);
+            arrow::Int64Builder builder(pool);
+            builder.AppendValues(vals);
+            s = builder.Finish(&array);
+            fields.push_back(arrow::field(it->col.name, arrow::int64()));
         }
-        break;
+        if (!s.ok()) {
+            errmsg.append("ERROR addExprColsArrow(): " + s.ToString());
+            return TablesErrCodes::ArrowStatusErr;
+        }
+        columns.push_back(std::make_shared<arrow::ChunkedArray>(array));
+    }
+
+    // RID and delete vector cols
+    for (int i = num_cols; i < input_table->num_columns(); i++) {
+        fields.push_back(input_table->schema()->field(i));
+        columns.push_back(input_table->column(i));
     }
+
+    auto schema = std::make_shared<arrow::Schema>(
+                    fields, input_table->schema()->metadata());
+    *table = arrow::Table::Make(schema, columns);
+    return 0;
 }
 
 bool compare(const int64_t& val1, const int64_t& val2, const int& op) {
     switch (op) {
+        case SOT_before:  // dates, as days since epoch
         case SOT_lt: return val1 < val2;
+        case SOT_after:
         case SOT_gt: return val1 > val2;
         case SOT_eq: return val1 == val2;
         case SOT_ne: return val1 != val2;
@@ -2134,241 +4797,1092 @@ bool compare(const bool& val1, const bool& val2, const int& op) {
 // values and create a representative string.
 // Format of keys is like IDX_REC:*-LINEITEM:LINENUMBER-ORDERKEY:00000000000000000001-00000000000000000006
 // the data portion of this key is: "00000000000000000001-00000000000000000006"
+// this is the version 1 key data of IDX_REC/IDX_RID, see IDX_KEY_DATA_VERSION,
+// later versions use appendIndexKeyData.
 std::string buildKeyData(int data_type, uint64_t new_data) {
     std::string data_str = u64tostr(new_data);
     int len = data_str.length();
     int pos = 0;  // pos in u64string to get the minimum keychars for type
     switch (data_type) {
         case SDT_BOOL:
-            pos = len-1;
-            break;
-        case SDT_CHAR:
-        case SDT_UCHAR:
+            pos = len-1;
+            break;
+        case SDT_CHAR:
+        case SDT_UCHAR:
+        case SDT_INT8:
+        case SDT_UINT8:
+            pos = len-3;
+            break;
+        case SDT_INT16:
+        case SDT_UINT16:
+            pos = len-5;
+            break;
+        case SDT_INT32:
+        case SDT_UINT32:
+        case SDT_DATE:
+            pos = len-10;
+            break;
+        case SDT_INT64:
+        case SDT_UINT64:
+            pos = 0;
+            break;
+    }
+    return data_str.substr(pos, len);
+}
+
+// for IDX_REC keys, the data portion is built from the typed col vals so
+// that the byte order of the keys is the order of the vals for every type,
+// which is what the omap range scans of read_sky_index rely on.
+// ints are fixed width big-endian with the sign bit flipped for signed types
+// (dates are int32 days), floats flip the sign bit when positive and all the
+// bits when negative, and strings escape 0x00 as 0x00 0xFF and end with
+// 0x00 0x01 so that no string key is a prefix of another string key.
+static int indexKeyWidth(int data_type) {
+    switch (data_type) {
+        case SDT_BOOL:
+        case SDT_CHAR:
+        case SDT_UCHAR:
+        case SDT_INT8:
+        case SDT_UINT8:
+            return 1;
+        case SDT_INT16:
+        case SDT_UINT16:
+            return 2;
+        case SDT_INT32:
+        case SDT_UINT32:
+        case SDT_DATE:
+        case SDT_FLOAT:
+            return 4;
+        case SDT_INT64:
+        case SDT_UINT64:
+        case SDT_DOUBLE:
+            return 8;
+        default:
+            assert (BuildSkyIndexUnsupportedColType==0);
+    }
+    return 0;
+}
+
+static void appendIndexKeyBytes(std::string& key_data, uint64_t bits,
+                                int width) {
+    for (int i = width - 1; i >= 0; i--)
+        key_data.push_back(static_cast<char>((bits >> (i * 8)) & 0xFF));
+}
+
+void appendIndexKeyData(std::string& key_data, int data_type, uint64_t val) {
+    appendIndexKeyBytes(key_data, val, indexKeyWidth(data_type));
+}
+
+void appendIndexKeyData(std::string& key_data, int data_type, int64_t val) {
+    int width = indexKeyWidth(data_type);
+    uint64_t bits = static_cast<uint64_t>(val) ^ (1ULL << (width * 8 - 1));
+    appendIndexKeyBytes(key_data, bits, width);
+}
+
+void appendIndexKeyData(std::string& key_data, int data_type, double val) {
+    if (val == 0)
+        val = 0;  // -0.0 and 0.0 are the same key
+    uint64_t bits;
+    int width = indexKeyWidth(data_type);
+    if (data_type == SDT_FLOAT) {
+        float f = static_cast<float>(val);
+        uint32_t b;
+        memcpy(&b, &f, sizeof(b));
+        bits = b;
+    }
+    else {
+        memcpy(&bits, &val, sizeof(bits));
+    }
+    uint64_t sign = 1ULL << (width * 8 - 1);
+    if (bits & sign)
+        bits = ~bits;
+    else
+        bits |= sign;
+    appendIndexKeyBytes(key_data, bits, width);
+}
+
+void appendIndexKeyData(std::string& key_data, int data_type,
+                        const std::string& val) {
+    assert (data_type == SDT_STRING);
+    for (auto c : val) {
+        key_data.push_back(c);
+        if (c == '\0')
+            key_data.push_back('\xFF');
+    }
+    key_data.push_back('\0');
+    key_data.push_back('\x01');
+}
+
+void appendIndexKeyData(std::string& key_data, int data_type,
+                        const flexbuffers::Reference& ref) {
+    switch (data_type) {
+        case SDT_BOOL:
+        case SDT_UCHAR:
+        case SDT_UINT8:
+        case SDT_UINT16:
+        case SDT_UINT32:
+        case SDT_UINT64:
+            appendIndexKeyData(key_data, data_type, ref.AsUInt64());
+            break;
+        case SDT_CHAR:
+        case SDT_INT8:
+        case SDT_INT16:
+        case SDT_INT32:
+        case SDT_INT64:
+            appendIndexKeyData(key_data, data_type, ref.AsInt64());
+            break;
+        case SDT_DATE:
+            appendIndexKeyData(key_data, data_type,
+                               static_cast<int64_t>(flexDateToDays(ref)));
+            break;
+        case SDT_FLOAT:
+        case SDT_DOUBLE:
+            appendIndexKeyData(key_data, data_type, ref.AsDouble());
+            break;
+        case SDT_STRING:
+            appendIndexKeyData(key_data, data_type, ref.AsString().str());
+            break;
+        default:
+            assert (BuildSkyIndexUnsupportedColType==0);
+    }
+}
+
+void tokenizeText(const char* text, size_t len, const std::string& delims,
+                  std::vector<text_token>& tokens) {
+    size_t b = 0;
+    size_t e = len;
+    while (b < e and std::isspace(static_cast<unsigned char>(text[b])))
+        b++;
+    while (e > b and std::isspace(static_cast<unsigned char>(text[e - 1])))
+        e--;
+
+    bool is_delim[256] = {false};
+    for (auto c : delims)
+        is_delim[static_cast<unsigned char>(c)] = true;
+
+    int pos = 0;
+    while (b < e) {
+        size_t w = b;
+        while (w < e and !is_delim[static_cast<unsigned char>(text[w])])
+            w++;
+        if (w > b)
+            tokens.push_back(text_token{text + b, w - b, pos++});
+        b = w + 1;
+    }
+}
+
+// len of the key data of a val of the given type at pos, see
+// appendIndexKeyData, or npos if the key data is too short.
+static size_t indexKeyDataLen(int data_type, const std::string& key_data,
+                              size_t pos) {
+    if (data_type != SDT_STRING) {
+        size_t len = indexKeyWidth(data_type);
+        return pos + len <= key_data.size() ? len : std::string::npos;
+    }
+    for (size_t i = pos; i + 1 < key_data.size(); i++) {
+        if (key_data[i] != '\0')
+            continue;
+        if (key_data[i + 1] == '\x01')
+            return i + 2 - pos;
+        i++;  // escaped 0x00
+    }
+    return std::string::npos;
+}
+
+index_range_vec indexColRanges(const schema_vec& index_schema,
+                               const predicate_vec& index_preds) {
+
+    index_range_vec ranges(index_schema.size());
+    for (auto it = index_preds.begin(); it != index_preds.end(); ++it) {
+        PredicateBase* pb = *it;
+        unsigned j = 0;
+        while (j < index_schema.size() and
+               index_schema[j].idx != pb->colIdx())
+            j++;
+        assert (j < index_schema.size());  // see SkyIndexColNotPresent
+        index_col_range& r = ranges[j];
+        std::vector<std::string> vals = extract_typedpred_key_data(pb);
+
+        // keep the tightest bounds, exclusive if equal to an inclusive one
+        auto set_lo = [&r](const std::string& v, bool incl) {
+            if (!r.has_lo or v > r.lo or (v == r.lo and !incl)) {
+                r.has_lo = true;
+                r.lo = v;
+                r.lo_incl = incl;
+            }
+        };
+        auto set_hi = [&r](const std::string& v, bool incl) {
+            if (!r.has_hi or v < r.hi or (v == r.hi and !incl)) {
+                r.has_hi = true;
+                r.hi = v;
+                r.hi_incl = incl;
+            }
+        };
+        switch (pb->opType()) {
+            case SOT_eq:
+            case SOT_in: {
+                std::sort(vals.begin(), vals.end());
+                vals.erase(std::unique(vals.begin(), vals.end()), vals.end());
+                if (r.has_eq) {  // several eq preds on a col, must match all
+                    std::vector<std::string> both;
+                    std::set_intersection(r.eq_vals.begin(), r.eq_vals.end(),
+                                          vals.begin(), vals.end(),
+                                          std::back_inserter(both));
+                    vals.swap(both);
+                }
+                r.has_eq = true;
+                r.eq_vals.swap(vals);
+                break;
+            }
+            case SOT_gt:
+            case SOT_geq:
+                set_lo(vals[0], pb->opType() == SOT_geq);
+                break;
+            case SOT_lt:
+            case SOT_leq:
+                set_hi(vals[0], pb->opType() == SOT_leq);
+                break;
+            case SOT_between:
+                set_lo(vals[0], true);
+                set_hi(vals[1], true);
+                break;
+            default:
+                assert (SkyIndexUnsupportedOpType==0);
+        }
+    }
+
+    // eq vals outside of any bounds on the same col cannot match
+    for (auto it = ranges.begin(); it != ranges.end(); ++it) {
+        if (!it->has_eq)
+            continue;
+        index_col_range bounds = *it;
+        bounds.has_eq = false;
+        std::vector<std::string> vals;
+        for (auto v = it->eq_vals.begin(); v != it->eq_vals.end(); ++v) {
+            if (indexColInRange(bounds, *v))
+                vals.push_back(*v);
+        }
+        it->eq_vals.swap(vals);
+    }
+    return ranges;
+}
+
+bool splitIndexKeyData(const schema_vec& index_schema,
+                       const std::string& key_data,
+                       std::vector<std::string>& col_vals) {
+    col_vals.clear();
+    size_t pos = 0;
+    for (unsigned j = 0; j < index_schema.size(); j++) {
+        if (j > 0) {
+            if (key_data.compare(pos, IDX_KEY_DELIM_INNER.size(),
+                                 IDX_KEY_DELIM_INNER) != 0)
+                return false;
+            pos += IDX_KEY_DELIM_INNER.size();
+        }
+        size_t len = indexKeyDataLen(index_schema[j].type, key_data, pos);
+        if (len == std::string::npos)
+            return false;
+        col_vals.push_back(key_data.substr(pos, len));
+        pos += len;
+    }
+    return true;
+}
+
+bool indexColInRange(const index_col_range& r, const std::string& val) {
+    if (r.has_eq and
+        !std::binary_search(r.eq_vals.begin(), r.eq_vals.end(), val))
+        return false;
+    if (r.has_lo and (val < r.lo or (val == r.lo and !r.lo_incl)))
+        return false;
+    if (r.has_hi and (val > r.hi or (val == r.hi and !r.hi_incl)))
+        return false;
+    return true;
+}
+
+bool indexColPastRange(const index_col_range& r, const std::string& val) {
+    if (r.has_eq)
+        return r.eq_vals.empty() or val > r.eq_vals.back();
+    return r.has_hi and (val > r.hi or (val == r.hi and !r.hi_incl));
+}
+
+// for our rocksdb key, create the prefix based on the index type, the
+// dbschema name (Table Group), the table name, and the cols contained
+// in the key, for multi-col indexes.
+// Format of keys is like IDX_REC2:*-LINEITEM:LINENUMBER-ORDERKEY:<key data>
+// the prefix portion of this key is: "IDX_REC2:*-LINEITEM:LINENUMBER-ORDERKEY"
+// the IDX_RID/IDX_REC type carries the key_data_version, if over 1.
+std::string buildKeyPrefix(
+        int idx_type,
+        std::string schema_name,
+        std::string table_name,
+        std::vector<string> colnames,
+        int key_data_version) {
+
+    boost::trim(schema_name);
+    boost::trim(table_name);
+
+    std::string idx_type_str;
+    std::string key_cols_str;
+
+    if (schema_name.empty())
+        schema_name = DBSCHEMA_NAME_DEFAULT;
+
+    if (table_name.empty())
+        table_name = TABLE_NAME_DEFAULT;
+
+    if (colnames.empty())
+        key_cols_str = IDX_KEY_COLS_DEFAULT;
+
+    switch (idx_type) {
+    case SIT_IDX_FB:
+        idx_type_str = SkyIdxTypeMap.at(SIT_IDX_FB);
+        break;
+    case SIT_IDX_RID:
+        idx_type_str = SkyIdxTypeMap.at(SIT_IDX_RID);
+        for (unsigned i = 0; i < colnames.size(); i++) {
+            if (i > 0) key_cols_str += Tables::IDX_KEY_DELIM_INNER;
+            key_cols_str += colnames[i];
+        }
+        break;
+    case SIT_IDX_REC:
+        idx_type_str =  SkyIdxTypeMap.at(SIT_IDX_REC);
+        // stitch the colnames together
+        for (unsigned i = 0; i < colnames.size(); i++) {
+            if (i > 0) key_cols_str += Tables::IDX_KEY_DELIM_INNER;
+            key_cols_str += colnames[i];
+        }
+        break;
+    case SIT_IDX_TXT:
+        idx_type_str =  SkyIdxTypeMap.at(SIT_IDX_TXT);
+        break;
+    case SIT_IDX_COL:
+        idx_type_str =  SkyIdxTypeMap.at(SIT_IDX_COL);
+        for (unsigned i = 0; i < colnames.size(); i++) {
+            if (i > 0) key_cols_str += Tables::IDX_KEY_DELIM_INNER;
+            key_cols_str += colnames[i];
+        }
+        break;
+    default:
+        idx_type_str = "IDX_UNK";
+    }
+    if ((idx_type == SIT_IDX_RID or idx_type == SIT_IDX_REC) and
+        key_data_version > 1)
+        idx_type_str += std::to_string(key_data_version);
+
+    // TODO: this prefix should be encoded as a unique index number
+    // to minimize key length/redundancy across keys
+    return (
+        idx_type_str + IDX_KEY_DELIM_OUTER +
+        schema_name + IDX_KEY_DELIM_INNER +
+        table_name + IDX_KEY_DELIM_OUTER +
+        key_cols_str + IDX_KEY_DELIM_OUTER
+    );
+}
+
+// omap key prefix of the rollups of a table, see rollup_info
+std::string buildRollupKeyPrefix(std::string schema_name,
+                                 std::string table_name) {
+
+    boost::trim(schema_name);
+    boost::trim(table_name);
+
+    if (schema_name.empty())
+        schema_name = DBSCHEMA_NAME_DEFAULT;
+
+    if (table_name.empty())
+        table_name = TABLE_NAME_DEFAULT;
+
+    return (
+        ROLLUP_KEY_TYPE + IDX_KEY_DELIM_OUTER +
+        schema_name + IDX_KEY_DELIM_INNER +
+        table_name + IDX_KEY_DELIM_OUTER
+    );
+}
+
+// K is the widened type the key data is built from, see appendIndexKeyData
+template <typename T, typename K>
+static void append_typedpred_key_data(Tables::PredicateBase* pb,
+                                      std::vector<std::string>& keys_data) {
+    TypedPredicate<T>* p = dynamic_cast<TypedPredicate<T>*>(pb);
+    std::vector<T> vals;
+    if (isListOp(p->opType()))
+        vals = p->Vals();
+    else
+        vals.push_back(p->Val());
+    for (auto it = vals.begin(); it != vals.end(); ++it) {
+        std::string kd;
+        appendIndexKeyData(kd, pb->colType(), static_cast<K>(*it));
+        keys_data.push_back(kd);
+    }
+}
+
+// index key data of an index predicate, i.e., for each val of an in or
+// between predicate or else the single predicate val.
+std::vector<std::string> extract_typedpred_key_data(Tables::PredicateBase* pb) {
+
+    std::vector<std::string> keys_data;
+    switch(pb->colType()) {
+        case SDT_BOOL:
+            append_typedpred_key_data<bool, uint64_t>(pb, keys_data);
+            break;
+        case SDT_CHAR:
+            append_typedpred_key_data<char, int64_t>(pb, keys_data);
+            break;
+        case SDT_UCHAR:
+            append_typedpred_key_data<unsigned char, uint64_t>(pb, keys_data);
+            break;
+        case SDT_INT8:
+            append_typedpred_key_data<int8_t, int64_t>(pb, keys_data);
+            break;
+        case SDT_INT16:
+            append_typedpred_key_data<int16_t, int64_t>(pb, keys_data);
+            break;
+        case SDT_INT32:
+        case SDT_DATE:
+            append_typedpred_key_data<int32_t, int64_t>(pb, keys_data);
+            break;
+        case SDT_INT64:
+            append_typedpred_key_data<int64_t, int64_t>(pb, keys_data);
+            break;
+        case SDT_UINT8:
+            append_typedpred_key_data<uint8_t, uint64_t>(pb, keys_data);
+            break;
+        case SDT_UINT16:
+            append_typedpred_key_data<uint16_t, uint64_t>(pb, keys_data);
+            break;
+        case SDT_UINT32:
+            append_typedpred_key_data<uint32_t, uint64_t>(pb, keys_data);
+            break;
+        case SDT_UINT64:
+            append_typedpred_key_data<uint64_t, uint64_t>(pb, keys_data);
+            break;
+        case SDT_FLOAT:
+            append_typedpred_key_data<float, double>(pb, keys_data);
+            break;
+        case SDT_DOUBLE:
+            append_typedpred_key_data<double, double>(pb, keys_data);
+            break;
+        case SDT_STRING:
+            append_typedpred_key_data<std::string, std::string>(pb, keys_data);
+            break;
+        default:
+            assert (BuildSkyIndexUnsupportedColType==0);
+    }
+    return keys_data;
+}
+
+// semi-join keys are canonical int64 or double bytes, see semiJoinKey
+template <class T>
+static void semiJoinKeyVal(const std::string& key, T& val) {
+    if (std::is_floating_point<T>::value) {
+        double d;
+        assert (key.size() == sizeof(d));
+        memcpy(&d, key.data(), sizeof(d));
+        val = static_cast<T>(d);
+    }
+    else {
+        int64_t i;
+        assert (key.size() == sizeof(i));
+        memcpy(&i, key.data(), sizeof(i));
+        val = static_cast<T>(i);
+    }
+}
+
+static void semiJoinKeyVal(const std::string& key, std::string& val) {
+    val = key;
+}
+
+template <class T>
+static PredicateBase* newSemiJoinPredicate(const col_info& ci,
+                                           const semijoin_filter& f) {
+    if (f.use_bloom) {
+        auto bf = std::make_shared<const bloom_filter>(f.bloom);
+        return new TypedPredicate<T>(ci.idx, ci.type, PredicateValueSet<T>(bf));
+    }
+    std::vector<T> vals(f.keys.size());
+    for (unsigned i = 0; i < f.keys.size(); i++)
+        semiJoinKeyVal(f.keys[i], vals[i]);
+    return new TypedPredicate<T>(ci.idx, ci.type, PredicateValueSet<T>(vals));
+}
+
+PredicateBase* semiJoinPredicate(const col_info& key_col,
+                                 const semijoin_filter& f) {
+
+    if (semiJoinKeyKind(key_col.type) != semiJoinKeyKind(f.key_type)) {
+        cerr << "Error: semi-join key col " << key_col.name << " type="
+             << key_col.type << " cannot be compared to build key type="
+             << f.key_type << std::endl;
+        assert (TablesErrCodes::SemiJoinKeyTypeMismatch == 0);
+    }
+
+    switch (key_col.type) {
+        case SDT_BOOL: return newSemiJoinPredicate<bool>(key_col, f);
+        case SDT_INT8: return newSemiJoinPredicate<int8_t>(key_col, f);
+        case SDT_INT16: return newSemiJoinPredicate<int16_t>(key_col, f);
+        case SDT_INT32: return newSemiJoinPredicate<int32_t>(key_col, f);
+        case SDT_INT64: return newSemiJoinPredicate<int64_t>(key_col, f);
+        case SDT_UINT8: return newSemiJoinPredicate<uint8_t>(key_col, f);
+        case SDT_UINT16: return newSemiJoinPredicate<uint16_t>(key_col, f);
+        case SDT_UINT32: return newSemiJoinPredicate<uint32_t>(key_col, f);
+        case SDT_UINT64: return newSemiJoinPredicate<uint64_t>(key_col, f);
+        case SDT_FLOAT: return newSemiJoinPredicate<float>(key_col, f);
+        case SDT_DOUBLE: return newSemiJoinPredicate<double>(key_col, f);
+        case SDT_CHAR: return newSemiJoinPredicate<char>(key_col, f);
+        case SDT_UCHAR: return newSemiJoinPredicate<unsigned char>(key_col, f);
+        case SDT_DATE: return newSemiJoinPredicate<int32_t>(key_col, f);
+        case SDT_STRING: return newSemiJoinPredicate<std::string>(key_col, f);
+        default: assert (TablesErrCodes::UnknownSkyDataType==0);
+    }
+    return nullptr;
+}
+
+static std::string semiJoinKeyFromFlex(const flexbuffers::Reference& ref,
+                                       int type) {
+    switch (type) {
+        case SDT_BOOL: return semiJoinKey(ref.AsBool());
+        case SDT_UINT8:
+        case SDT_UINT16:
+        case SDT_UINT32:
+        case SDT_UINT64:
+        case SDT_UCHAR: return semiJoinKey(ref.AsUInt64());
+        case SDT_FLOAT:
+        case SDT_DOUBLE: return semiJoinKey(ref.AsDouble());
+        case SDT_DATE: return semiJoinKey(flexDateToDays(ref));
+        case SDT_STRING: return ref.AsString().str();
+        default: return semiJoinKey(ref.AsInt64());
+    }
+}
+
+static std::string semiJoinKeyFromArrow(const std::shared_ptr<arrow::Array>& a,
+                                        int type, int64_t i) {
+    switch (type) {
+        case SDT_BOOL:
+            return semiJoinKey(std::static_pointer_cast<arrow::BooleanArray>(a)->Value(i));
         case SDT_INT8:
-        case SDT_UINT8:
-            pos = len-3;
-            break;
+        case SDT_CHAR:
+            return semiJoinKey(std::static_pointer_cast<arrow::Int8Array>(a)->Value(i));
         case SDT_INT16:
-        case SDT_UINT16:
-            pos = len-5;
-            break;
+            return semiJoinKey(std::static_pointer_cast<arrow::Int16Array>(a)->Value(i));
         case SDT_INT32:
-        case SDT_UINT32:
-            pos = len-10;
-            break;
+            return semiJoinKey(std::static_pointer_cast<arrow::Int32Array>(a)->Value(i));
         case SDT_INT64:
+            return semiJoinKey(std::static_pointer_cast<arrow::Int64Array>(a)->Value(i));
+        case SDT_UINT8:
+        case SDT_UCHAR:
+            return semiJoinKey(std::static_pointer_cast<arrow::UInt8Array>(a)->Value(i));
+        case SDT_UINT16:
+            return semiJoinKey(std::static_pointer_cast<arrow::UInt16Array>(a)->Value(i));
+        case SDT_UINT32:
+            return semiJoinKey(std::static_pointer_cast<arrow::UInt32Array>(a)->Value(i));
         case SDT_UINT64:
-            pos = 0;
-            break;
+            return semiJoinKey(std::static_pointer_cast<arrow::UInt64Array>(a)->Value(i));
+        case SDT_FLOAT:
+            return semiJoinKey(std::static_pointer_cast<arrow::FloatArray>(a)->Value(i));
+        case SDT_DOUBLE:
+            return semiJoinKey(std::static_pointer_cast<arrow::DoubleArray>(a)->Value(i));
+        case SDT_DATE:
+            return semiJoinKey(std::static_pointer_cast<arrow::Date32Array>(a)->Value(i));
+        case SDT_STRING:
+            return std::static_pointer_cast<arrow::StringArray>(a)->GetString(i);
+        default:
+            assert (TablesErrCodes::UnsupportedSkyDataType==0);
     }
-    return data_str.substr(pos, len);
+    return std::string();
 }
 
-// for our rocksdb key, create the prefix based on the index type, the
-// dbschema name (Table Group), the table name, and the cols contained
-// in the key, for multi-col indexes.
-// Format of keys is like IDX_REC:*-LINEITEM:LINENUMBER-ORDERKEY:00000000000000000001-00000000000000000006
-// the prefix portion of this key is: "IDX_REC:*-LINEITEM:LINENUMBER-ORDERKEY"
-std::string buildKeyPrefix(
-        int idx_type,
-        std::string schema_name,
-        std::string table_name,
-        std::vector<string> colnames) {
-
-    boost::trim(schema_name);
-    boost::trim(table_name);
+/*
+ * Function: semiJoinCollectKeys
+ * Description: Add the distinct non-null join keys found in a (processed)
+ *              result blob to keys, in their canonical semi-join form.
+ * @param[in] dataptr    : result blob, as returned to the client
+ * @param[in] datasz     : size of the blob
+ * @param[in] ds_format  : SFT_FLATBUF_FLEX_ROW or SFT_ARROW
+ * @param[in] key_colname: build side join key col, must be in the result
+ * @param[out] key_type  : SDT type of the key col
+ * @param[out] keys      : accumulated canonical keys
+ * @param[out] errmsg    : error message, if any
+ * Return Value: 0 or TablesErrCodes
+ */
+int semiJoinCollectKeys(const char* dataptr,
+                        const size_t datasz,
+                        const int ds_format,
+                        const std::string& key_colname,
+                        int& key_type,
+                        std::unordered_set<std::string>& keys,
+                        std::string& errmsg) {
 
-    std::string idx_type_str;
-    std::string key_cols_str;
+    switch (ds_format) {
 
-    if (schema_name.empty())
-        schema_name = DBSCHEMA_NAME_DEFAULT;
+        case SFT_FLATBUF_FLEX_ROW: {
+            if (hasSkyDicts(dataptr)) {
+                flatbuffers::FlatBufferBuilder decoded(datasz);
+                int ret = decodeSkyDicts(dataptr, datasz, decoded, errmsg);
+                if (ret != 0)
+                    return ret;
+                return semiJoinCollectKeys(
+                    reinterpret_cast<const char*>(decoded.GetBufferPointer()),
+                    decoded.GetSize(), ds_format, key_colname, key_type,
+                    keys, errmsg);
+            }
+            sky_root root = getSkyRoot(dataptr, datasz, SFT_FLATBUF_FLEX_ROW);
+            schema_vec sc = schemaFromString(root.data_schema);
+            int pos = -1;
+            for (unsigned j = 0; j < sc.size(); j++) {
+                if (boost::iequals(sc[j].name, key_colname))
+                    pos = j;
+            }
+            if (pos < 0) {
+                errmsg.append("semi-join key col " + key_colname +
+                              " not present in result");
+                return TablesErrCodes::RequestedColNotPresent;
+            }
+            const col_info& col = sc.at(pos);
+            key_type = col.type;
+
+            // result rows keep the nullbits of their data rows, set by the
+            // data schema col idx (kept by the result schema cols), while
+            // the row vals are at their pos in the result.
+            const int data_idx = col.idx;
+            for (uint32_t i = 0; i < root.nrows; i++) {
+                if (root.delete_vec.at(i) == 1) continue;
+                sky_rec skyrec = \
+                    getSkyRec(static_cast<row_offs>(root.data_vec)->Get(i));
+                if (col.nullable) {
+                    int bit = data_idx / (8*sizeof(skyrec.nullbits.at(0)));
+                    uint64_t col_bitmask = uint64_t(1) <<
+                        (data_idx % (8*sizeof(skyrec.nullbits.at(0))));
+                    if ((col_bitmask & skyrec.nullbits.at(bit)) != 0)
+                        continue;
+                }
+                auto row = skyrec.data.AsVector();
+                keys.insert(semiJoinKeyFromFlex(row[pos], col.type));
+            }
+            break;
+        }
 
-    if (table_name.empty())
-        table_name = TABLE_NAME_DEFAULT;
+        case SFT_ARROW: {
+            std::shared_ptr<arrow::Table> table;
+            extract_arrow_from_string(&table, dataptr, datasz);
+            auto metadata = table->schema()->metadata();
+            schema_vec sc = schemaFromString(metadata->value(METADATA_DATA_SCHEMA));
+            int pos = -1;
+            for (unsigned j = 0; j < sc.size(); j++) {
+                if (boost::iequals(sc[j].name, key_colname))
+                    pos = j;
+            }
+            if (pos < 0) {
+                errmsg.append("semi-join key col " + key_colname +
+                              " not present in result");
+                return TablesErrCodes::RequestedColNotPresent;
+            }
+            key_type = sc.at(pos).type;
+
+            auto col = table->column(pos);
+            for (int c = 0; c < col->num_chunks(); c++) {
+                auto array = col->chunk(c);
+                for (int64_t i = 0; i < array->length(); i++) {
+                    if (array->IsNull(i)) continue;
+                    keys.insert(semiJoinKeyFromArrow(array, key_type, i));
+                }
+            }
+            break;
+        }
 
-    if (colnames.empty())
-        key_cols_str = IDX_KEY_COLS_DEFAULT;
+        default:
+            errmsg.append("semi-join build not supported for format " +
+                          std::to_string(ds_format));
+            return TablesErrCodes::SkyFormatTypeNotRecognized;
+    }
+    return 0;
+}
 
-    switch (idx_type) {
-    case SIT_IDX_FB:
-        idx_type_str = SkyIdxTypeMap.at(SIT_IDX_FB);
-        break;
-    case SIT_IDX_RID:
-        idx_type_str = SkyIdxTypeMap.at(SIT_IDX_RID);
-        for (unsigned i = 0; i < colnames.size(); i++) {
-            if (i > 0) key_cols_str += Tables::IDX_KEY_DELIM_INNER;
-            key_cols_str += colnames[i];
-        }
-        break;
-    case SIT_IDX_REC:
-        idx_type_str =  SkyIdxTypeMap.at(SIT_IDX_REC);
-        // stitch the colnames together
-        for (unsigned i = 0; i < colnames.size(); i++) {
-            if (i > 0) key_cols_str += Tables::IDX_KEY_DELIM_INNER;
-            key_cols_str += colnames[i];
-        }
-        break;
-    case SIT_IDX_TXT:
-        idx_type_str =  SkyIdxTypeMap.at(SIT_IDX_TXT);
-        break;
-    default:
-        idx_type_str = "IDX_UNK";
+/*
+ * Function: semiJoinBuildFilter
+ * Description: Build the filter sent with the probe side query from the
+ *              collected build side keys, exact if there are at most
+ *              SEMIJOIN_EXACT_MAX keys, else a bloom filter with a false
+ *              positive rate of SEMIJOIN_BLOOM_FPP.
+ * @param[in] key_type : SDT type of the build side key col
+ * @param[in] keys     : canonical keys from semiJoinCollectKeys
+ * Return Value: the filter
+ */
+semijoin_filter semiJoinBuildFilter(int key_type,
+                                    const std::unordered_set<std::string>& keys) {
+    semijoin_filter f;
+    f.key_type = key_type;
+    if (keys.size() <= SEMIJOIN_EXACT_MAX) {
+        f.keys.assign(keys.begin(), keys.end());
+        std::sort(f.keys.begin(), f.keys.end());
+        return f;
     }
+    f.use_bloom = true;
+    f.bloom = bloom_filter(keys.size(), SEMIJOIN_BLOOM_FPP, 0);
+    for (auto it = keys.begin(); it != keys.end(); ++it)
+        f.bloom.insert(*it);
+    return f;
+}
 
-    // TODO: this prefix should be encoded as a unique index number
-    // to minimize key length/redundancy across keys
-    return (
-        idx_type_str + IDX_KEY_DELIM_OUTER +
-        schema_name + IDX_KEY_DELIM_INNER +
-        table_name + IDX_KEY_DELIM_OUTER +
-        key_cols_str + IDX_KEY_DELIM_OUTER
-    );
+/*
+ * Function: addSamplePredicate
+ * Description: Add a Bernoulli sample pred to the query preds, ahead of the
+ *              first agg pred since agg preds accumulate each row that
+ *              reaches them, and AND chained so it samples the rows passing
+ *              the preds before it.
+ * @param[in,out] preds   : query predicates
+ * @param[in] sample_pred : a SamplePredicate, owned by the caller
+ * Return Value: none
+ */
+void addSamplePredicate(predicate_vec& preds, PredicateBase* sample_pred) {
+    assert (sample_pred->opType() == SOT_sample);
+    auto it = preds.begin();
+    while (it != preds.end() and !(*it)->isGlobalAgg())
+        ++it;
+    preds.insert(it, sample_pred);
 }
 
 /*
- * Given a predicate vector, check if the opType provided is present therein.
-   Used to compare idx ops, for special handling of leq case, etc.
-*/
-bool check_predicate_ops(predicate_vec index_preds, int opType)
-{
-    for (unsigned i = 0; i < index_preds.size(); i++) {
-        if(index_preds[i]->opType() != opType)
-            return false;
-    }
-    return true;
+ * Function: addSemiJoinPredicate
+ * Description: Add a semi-join probe pred to the query preds, ahead of the
+ *              first agg pred (as addSamplePredicate) so that the aggs only
+ *              accumulate the rows whose join key is in the filter.
+ * @param[in,out] preds     : query predicates
+ * @param[in] semijoin_pred : see semiJoinPredicate, owned by the caller
+ * Return Value: none
+ */
+void addSemiJoinPredicate(predicate_vec& preds, PredicateBase* semijoin_pred) {
+    assert (!semijoin_pred->isGlobalAgg());
+    auto it = preds.begin();
+    while (it != preds.end() and !(*it)->isGlobalAgg())
+        ++it;
+    preds.insert(it, semijoin_pred);
+}
+
+int32_t dateToDays(const std::string& date) {
+
+    // also accept a plain (signed) day count, e.g., for agg predicate vals,
+    // before its '-' sign could be taken for a date delim.
+    size_t sign = (!date.empty() and (date[0] == '-' or date[0] == '+'));
+    if (date.size() > sign and
+        date.find_first_not_of("0123456789", sign) == std::string::npos)
+        return static_cast<int32_t>(std::stoi(date));
+
+    boost::gregorian::date d = boost::gregorian::from_string(date);
+    return static_cast<int32_t>(d.julian_day() - UNIX_EPOCH_JDATE);
 }
 
-// check if all predicates contain equality ops
-bool check_predicate_ops_all_include_equality(predicate_vec index_preds)
+std::string daysToDate(int32_t days) {
+    boost::gregorian::date d = boost::gregorian::date(1970, 1, 1) +
+                               boost::gregorian::days(days);
+    return boost::gregorian::to_iso_extended_string(d);
+}
+
+template <typename VecType>
+static void flexAddList(flexbuffers::Builder& flexbldr, const VecType& v,
+                        int elem_type)
 {
-    for (unsigned i = 0; i < index_preds.size(); i++) {
-        switch (index_preds[i]->opType()) {
-            case SOT_eq:
-            case SOT_leq:
-            case SOT_geq:
-                break;
-            default:
-                return false;
+    flexbldr.Vector([&]() {
+        for (size_t j = 0; j < v.size(); j++) {
+            switch (elem_type) {
+                case SDT_BOOL:
+                    flexbldr.Add(v[j].AsBool());
+                    break;
+                case SDT_FLOAT:
+                    flexbldr.Add(v[j].AsFloat());
+                    break;
+                case SDT_DOUBLE:
+                    flexbldr.Add(v[j].AsDouble());
+                    break;
+                case SDT_UCHAR:
+                case SDT_UINT8:
+                case SDT_UINT16:
+                case SDT_UINT32:
+                case SDT_UINT64:
+                    flexbldr.Add(v[j].AsUInt64());
+                    break;
+                default:
+                    flexbldr.Add(v[j].AsInt64());
+            }
         }
-    }
-    return true;
+    });
 }
 
-// check if all predicates contain only equal op
-bool check_predicate_ops_all_equality(predicate_vec index_preds)
+void flexAddColVal(flexbuffers::Builder& flexbldr,
+                   const flexbuffers::Reference& ref,
+                   int type)
 {
-    for (unsigned i = 0; i < index_preds.size(); i++) {
-        switch (index_preds[i]->opType()) {
-            case SOT_eq:
-                break;
-            default:
-                return false;
-        }
+    switch (type) {
+        case SDT_INT8: flexbldr.Add(ref.AsInt8()); break;
+        case SDT_INT16: flexbldr.Add(ref.AsInt16()); break;
+        case SDT_INT32: flexbldr.Add(ref.AsInt32()); break;
+        case SDT_INT64: flexbldr.Add(ref.AsInt64()); break;
+        case SDT_UINT8: flexbldr.Add(ref.AsUInt8()); break;
+        case SDT_UINT16: flexbldr.Add(ref.AsUInt16()); break;
+        case SDT_UINT32: flexbldr.Add(ref.AsUInt32()); break;
+        case SDT_UINT64: flexbldr.Add(ref.AsUInt64()); break;
+        case SDT_CHAR: flexbldr.Add(ref.AsInt8()); break;
+        case SDT_UCHAR: flexbldr.Add(ref.AsUInt8()); break;
+        case SDT_BOOL: flexbldr.Add(ref.AsBool()); break;
+        case SDT_FLOAT: flexbldr.Add(ref.AsFloat()); break;
+        case SDT_DOUBLE: flexbldr.Add(ref.AsDouble()); break;
+        case SDT_DATE: flexbldr.Add(flexDateToDays(ref)); break;
+        case SDT_STRING: flexbldr.Add(ref.AsString().str()); break;
+        default:
+            if (type >= SDT_JAGGEDARRAY_BOOL and
+                type <= SDT_JAGGEDARRAY_DOUBLE)
+                flexAddJaggedVal(flexbldr, ref, type);
+            else
+                assert (TablesErrCodes::UnsupportedSkyDataType == 0);
     }
-    return true;
 }
 
-// used for index prefix matching during index range queries
-bool compare_keys(std::string key1, std::string key2)
+void flexAddJaggedVal(flexbuffers::Builder& flexbldr,
+                      const flexbuffers::Reference& ref,
+                      int type)
 {
+    if (ref.IsTypedVector())
+        flexAddList(flexbldr, ref.AsTypedVector(), jaggedElemType(type));
+    else
+        flexAddList(flexbldr, ref.AsVector(), jaggedElemType(type));
+}
 
-    // Format of keys is like IDX_REC:*-LINEITEM:LINENUMBER-ORDERKEY:00000000000000000001-00000000000000000006
-    // First splitting both the string on the basis of ':' delimiter
-    vector<std::string> elems1;
-    boost::split(elems1, key1, boost::is_any_of(IDX_KEY_DELIM_OUTER),
-                                                boost::token_compress_on);
+int32_t flexDateToDays(const flexbuffers::Reference& ref) {
+    if (ref.IsString())
+        return dateToDays(ref.AsString().str());
+    return ref.AsInt32();
+}
 
-    vector<std::string> elems2;
-    boost::split(elems2, key2, boost::is_any_of(IDX_KEY_DELIM_OUTER),
-                                                boost::token_compress_on);
+flexbuffers::Vector getSkyDicts(const char* dataptr) {
+    const Table* root = GetTable(dataptr);
+    if (root->dicts() == nullptr or root->dicts()->size() == 0)
+        return flexbuffers::Vector::EmptyVector();
+    return root->dicts_flexbuffer_root().AsVector();
+}
 
-    // 4th entry in vector represents the value vector i.e after prefix
-    vector<std::string> value1;
-    vector<std::string> value2;
+bool hasSkyDicts(const char* dataptr) {
+    return getSkyDicts(dataptr).size() > 0;
+}
 
-    // Now splitting value field on the basis of '-' delimiter
-    boost::split(value1,
-                 elems1[IDX_FIELD_Value],
-                 boost::is_any_of(IDX_KEY_DELIM_INNER),
-                 boost::token_compress_on);
-    boost::split(value2,
-                 elems2[IDX_FIELD_Value],
-                 boost::is_any_of(IDX_KEY_DELIM_INNER),
-                 boost::token_compress_on);
+// copy the val at row position j, by the type of its col in the fb's schema
+static void flexAddRowVal(flexbuffers::Builder& flexbldr,
+                          const flexbuffers::Reference& ref,
+                          const schema_vec& sc,
+                          size_t j) {
+    if (j < sc.size())
+        flexAddColVal(flexbldr, ref, sc[j].type);
+    else
+        flexAddRef(flexbldr, ref);
+}
 
-   // Compare first token of both field value
-    if (!value1.empty() and !value2.empty()) {
-        if(value1[0] == value2[0])
-            return true;
+// rebuild the fb of root, all of its rows (dead rows keep their position for
+// the row nums of the indexes) with their vals added by add_row, along with
+// the dicts flexbuf, if any.
+template <typename AddRow>
+static int rebuildSkyFb(sky_root& root,
+                        const std::vector<uint8_t>& dicts,
+                        flatbuffers::FlatBufferBuilder& flatbldr,
+                        AddRow add_row) {
+    int errcode = 0;
+    std::vector<flatbuffers::Offset<Tables::Record>> offs;
+    flexbuffers::Builder flexbldr;
+    for (uint32_t i = 0; i < root.nrows; i++) {
+        sky_rec rec = getSkyRec(static_cast<row_offs>(root.data_vec)->Get(i));
+        flexbldr.Clear();
+        size_t start = flexbldr.StartVector();
+        int ret = add_row(flexbldr, rec.data.AsVector());
+        if (ret != 0)
+            errcode = ret;
+        flexbldr.EndVector(start, false, false);
+        flexbldr.Finish();
+        auto row_data = flatbldr.CreateVector(flexbldr.GetBuffer());
+        auto nullbits = flatbldr.CreateVector(rec.nullbits);
+        offs.push_back(Tables::CreateRecord(flatbldr, rec.RID, nullbits,
+                                            row_data));
     }
-    return false;
+
+    auto data_schema = flatbldr.CreateString(root.data_schema);
+    auto db_schema_name = flatbldr.CreateString(root.db_schema_name);
+    auto table_name = flatbldr.CreateString(root.table_name);
+    auto delete_v = flatbldr.CreateVector(root.delete_vec);
+    auto rows_v = flatbldr.CreateVector(offs);
+    flatbuffers::Offset<flatbuffers::Vector<uint8_t>> dicts_v = 0;
+    if (!dicts.empty())
+        dicts_v = flatbldr.CreateVector(dicts);
+    auto table = CreateTable(
+        flatbldr,
+        root.data_format_type,
+        root.skyhook_version,
+        root.data_structure_version,
+        root.data_schema_version,
+        data_schema,
+        db_schema_name,
+        table_name,
+        delete_v,
+        rows_v,
+        root.nrows,
+        dicts_v);
+    flatbldr.Finish(table);
+    return errcode;
 }
 
-void extract_typedpred_val(Tables::PredicateBase* pb, int64_t& val) {
+int encodeSkyDicts(const char* dataptr,
+                   const size_t datasz,
+                   schema_vec& dict_cols,
+                   flatbuffers::FlatBufferBuilder& flatbldr,
+                   std::string& errmsg) {
 
-    switch(pb->colType()) {
+    if (hasSkyDicts(dataptr)) {
+        errmsg.append("ERROR encodeSkyDicts(): fb is already encoded");
+        return TablesErrCodes::BadDictEncoding;
+    }
+    sky_root root = getSkyRoot(dataptr, datasz, SFT_FLATBUF_FLEX_ROW);
+    schema_vec sc = schemaFromString(root.data_schema);
 
-        case SDT_INT8: {
-            TypedPredicate<int8_t>* p = \
-                dynamic_cast<TypedPredicate<int8_t>*>(pb);
-            val = static_cast<int64_t>(p->Val());
-            break;
-        }
-        case SDT_INT16: {
-            TypedPredicate<int16_t>* p = \
-                dynamic_cast<TypedPredicate<int16_t>*>(pb);
-            val = static_cast<int64_t>(p->Val());
-            break;
-        }
-        case SDT_INT32: {
-            TypedPredicate<int32_t>* p = \
-                dynamic_cast<TypedPredicate<int32_t>*>(pb);
-            val = static_cast<uint64_t>(p->Val());
-            break;
+    // the codes of each encoded col, in the order its vals first appear
+    std::vector<std::map<std::string, uint32_t>> codes(sc.size());
+    std::vector<std::vector<std::string>> vals(sc.size());
+    std::vector<bool> encoded(sc.size(), false);
+    for (auto it = dict_cols.begin(); it != dict_cols.end(); ++it) {
+        if (it->type != SDT_STRING or it->idx < 0 or
+            it->idx >= static_cast<int>(sc.size())) {
+            errmsg.append("ERROR encodeSkyDicts(): col " + it->name +
+                          " is not a string col of the fb");
+            return TablesErrCodes::BadDictEncoding;
         }
-        case SDT_INT64: {
-            TypedPredicate<int64_t>* p = \
-                dynamic_cast<TypedPredicate<int64_t>*>(pb);
-            val = static_cast<int64_t>(p->Val());
-            break;
+        encoded[it->idx] = true;
+    }
+
+    // high cardinality cols gain little from a dict, they fall back to plain
+    // strings as soon as their distinct vals are over the limit.
+    const size_t max_vals = std::min<size_t>(DICT_MAX_VALS,
+                                             DICT_MAX_VALS_RATIO * root.nrows);
+    for (uint32_t i = 0; i < root.nrows; i++) {
+        sky_rec rec = getSkyRec(static_cast<row_offs>(root.data_vec)->Get(i));
+        auto row = rec.data.AsVector();
+        for (size_t j = 0; j < encoded.size(); j++) {
+            if (!encoded[j]) continue;
+            std::string val = row[j].AsString().str();
+            if (codes[j].emplace(val, vals[j].size()).second)
+                vals[j].push_back(val);
+            if (vals[j].size() > max_vals) {
+                encoded[j] = false;
+                codes[j].clear();
+                vals[j].clear();
+            }
         }
-        default:
-            assert (BuildSkyIndexUnsupportedColType==0);
     }
+
+    // no dicts at all if no col is encoded
+    std::vector<uint8_t> dicts;
+    if (std::find(encoded.begin(), encoded.end(), true) != encoded.end()) {
+        flexbuffers::Builder dictbldr;
+        dictbldr.Vector([&]() {
+            for (size_t j = 0; j < encoded.size(); j++) {
+                if (!encoded[j]) {
+                    dictbldr.Null();
+                    continue;
+                }
+                dictbldr.Vector([&]() {
+                    for (auto it = vals[j].begin(); it != vals[j].end(); ++it)
+                        dictbldr.String(*it);
+                });
+            }
+        });
+        dictbldr.Finish();
+        dicts = dictbldr.GetBuffer();
+    }
+
+    return rebuildSkyFb(root, dicts, flatbldr,
+        [&](flexbuffers::Builder& flexbldr, const flexbuffers::Vector& row) {
+            for (size_t j = 0; j < row.size(); j++) {
+                if (j < encoded.size() and encoded[j])
+                    flexbldr.UInt(codes[j].at(row[j].AsString().str()));
+                else
+                    flexAddRowVal(flexbldr, row[j], sc, j);
+            }
+            return 0;
+        });
 }
 
-void extract_typedpred_val(Tables::PredicateBase* pb, uint64_t& val) {
+int decodeSkyDicts(const char* dataptr,
+                   const size_t datasz,
+                   flatbuffers::FlatBufferBuilder& flatbldr,
+                   std::string& errmsg) {
 
-    switch(pb->colType()) {
+    sky_root root = getSkyRoot(dataptr, datasz, SFT_FLATBUF_FLEX_ROW);
+    schema_vec sc = schemaFromString(root.data_schema);
+    flexbuffers::Vector dicts = getSkyDicts(dataptr);
+
+    int errcode = rebuildSkyFb(root, std::vector<uint8_t>(), flatbldr,
+        [&](flexbuffers::Builder& flexbldr, const flexbuffers::Vector& row) {
+            int ret = 0;
+            for (size_t j = 0; j < row.size(); j++) {
+                if (j >= dicts.size() or !dicts[j].IsVector()) {
+                    flexAddRowVal(flexbldr, row[j], sc, j);
+                    continue;
+                }
+                auto dict = dicts[j].AsVector();
+                uint64_t code = row[j].AsUInt64();
+                if (code >= dict.size()) {
+                    ret = TablesErrCodes::BadDictEncoding;
+                    flexbldr.Null();
+                    continue;
+                }
+                auto str = dict[code].AsString();
+                flexbldr.String(str.c_str(), str.length());
+            }
+            return ret;
+        });
+    if (errcode != 0)
+        errmsg.append("ERROR decodeSkyDicts(): table=" + root.table_name +
+                      "; code not in its dict");
+    return errcode;
+}
 
-        case SDT_UINT8: {
-            TypedPredicate<uint8_t>* p = \
-                dynamic_cast<TypedPredicate<uint8_t>*>(pb);
-            val = static_cast<uint64_t>(p->Val());
-            break;
-        }
-        case SDT_UINT16: {
-            TypedPredicate<uint16_t>* p = \
-                dynamic_cast<TypedPredicate<uint16_t>*>(pb);
-            val = static_cast<uint64_t>(p->Val());
-            break;
-        }
-        case SDT_UINT32: {
-            TypedPredicate<uint32_t>* p = \
-                dynamic_cast<TypedPredicate<uint32_t>*>(pb);
-            val = static_cast<uint64_t>(p->Val());
-            break;
+predicate_vec dictPredicates(predicate_vec& preds,
+                             const flexbuffers::Vector& dicts) {
+
+    predicate_vec dict_preds;
+    flexbuffers::Builder flexbldr;
+    for (auto it = preds.begin(); it != preds.end(); ++it) {
+        PredicateBase* pb = *it;
+        int idx = pb->colIdx();
+        if (pb->isGlobalAgg() or pb->colType() != SDT_STRING or idx < 0 or
+            idx >= static_cast<int>(dicts.size()) or
+            !dicts[idx].IsVector()) {
+            dict_preds.push_back(pb);
+            continue;
         }
-        case SDT_UINT64: {
-            TypedPredicate<uint64_t>* p = \
-                dynamic_cast<TypedPredicate<uint64_t>*>(pb);
-            val = static_cast<uint64_t>(p->Val());
-            break;
+
+        // apply the pred once to each dict val, as the col val of a row
+        // that is null elsewhere, to find the codes of the passing vals.
+        predicate_vec pv(1, pb);
+        auto dict = dicts[idx].AsVector();
+        std::vector<uint8_t> pass(dict.size(), 0);
+        for (size_t code = 0; code < dict.size(); code++) {
+            flexbldr.Clear();
+            size_t start = flexbldr.StartVector();
+            for (int j = 0; j < idx; j++)
+                flexbldr.Null();
+            auto str = dict[code].AsString();
+            flexbldr.String(str.c_str(), str.length());
+            flexbldr.EndVector(start, false, false);
+            flexbldr.Finish();
+            sky_rec rec(0, nullbits_vector(MAX_TABLE_COLS / 64, 0),
+                        flexbuffers::GetRoot(flexbldr.GetBuffer()));
+            pass[code] = applyPredicates(pv, rec);
         }
-        default:
-            assert (BuildSkyIndexUnsupportedColType==0);
+        dict_preds.push_back(new DictPredicate(idx, pass,
+                                               pb->chainOpType()));
+    }
+    return dict_preds;
+}
+
+void deleteDictPredicates(predicate_vec& dict_preds) {
+    for (auto it = dict_preds.begin(); it != dict_preds.end(); ++it) {
+        if ((*it)->opType() == SOT_dict_code)
+            delete *it;
     }
+    dict_preds.clear();
 }
 
 /* @todo: This is a temporary function to demonstrate buffer is read from the file.
@@ -2453,6 +5967,24 @@ int extract_arrow_from_buffer(std::shared_ptr<arrow::Table>* table, const std::s
     return 0;
 }
 
+/*
+ * Function: extract_arrow_from_string
+ * Description: Extract arrow table from serialized data without copying it,
+ *              the table's arrays refer to ds, which must outlive the table.
+ * @param[out] table  : Arrow table
+ * @param[in] ds      : Serialized arrow ipc stream, e.g., from a bufferlist
+ * @param[in] ds_size : Size of the data
+ * Return Value: error code
+ */
+int extract_arrow_from_string(std::shared_ptr<arrow::Table>* table,
+                              const char *ds,
+                              const size_t ds_size)
+{
+    auto buffer = std::make_shared<arrow::Buffer>(
+        reinterpret_cast<const uint8_t*>(ds), ds_size);
+    return extract_arrow_from_buffer(table, buffer);
+}
+
 /*
  * Function: flatten_table
  * Description: Flatten the input table i.e. merged chunks for a column into
@@ -2577,7 +6109,13 @@ int flatten_table(const std::shared_ptr<arrow::Table> &input_table,
                 output_tbl_fields_vec.push_back(arrow::field(col.name, arrow::uint8()));
                 break;
             }
-            case SDT_DATE:
+            case SDT_DATE: {
+                auto ptr = std::unique_ptr<arrow::ArrayBuilder>(new arrow::Date32Builder(pool));
+                builder_list.emplace_back(ptr.get());
+                ptr.release();
+                output_tbl_fields_vec.push_back(arrow::field(col.name, arrow::date32()));
+                break;
+            }
             case SDT_STRING: {
                 auto ptr = std::unique_ptr<arrow::ArrayBuilder>(new arrow::StringBuilder(pool));
                 builder_list.emplace_back(ptr.get());
@@ -2690,6 +6228,8 @@ int flatten_table(const std::shared_ptr<arrow::Table> &input_table,
                 static_cast<arrow::UInt8Builder *>(builder)->Append(std::static_pointer_cast<arrow::UInt8Array>(processing_chunk)->Value(element_index));
                 break;
             case SDT_DATE:
+                static_cast<arrow::Date32Builder *>(builder)->Append(std::static_pointer_cast<arrow::Date32Array>(processing_chunk)->Value(element_index));
+                break;
             case SDT_STRING:
                 static_cast<arrow::StringBuilder *>(builder)->Append(std::static_pointer_cast<arrow::StringArray>(processing_chunk)->GetString(element_index));
                 break;
@@ -2854,11 +6394,101 @@ int split_arrow_table(std::shared_ptr<arrow::Table> &table, int max_rows,
         }
         offset += max_rows;
 
-        // Finally, create the arrow table based on schema and column vector
-        std::shared_ptr<arrow::Table> table = arrow::Table::Make(schema, column_list);
-        table_vec->push_back(table);
-        remaining_rows -= max_rows;
+        // Finally, create the arrow table based on schema and column vector
+        std::shared_ptr<arrow::Table> table = arrow::Table::Make(schema, column_list);
+        table_vec->push_back(table);
+        remaining_rows -= max_rows;
+    }
+    return 0;
+}
+
+/*
+ * Function: split_arrow_col_chunks
+ * Description: Split the given arrow table into one single col table per data
+ * col, followed by one table holding its RID and delete vector cols. Each
+ * chunk keeps the skyhook metadata of the original table.
+ * @param[in] table   : Table to be split.
+ * @param[out] chunks : Data col chunks in col order, then the RID chunk.
+ * Return Value: error code
+ */
+int split_arrow_col_chunks(std::shared_ptr<arrow::Table> &table,
+                           std::vector<std::shared_ptr<arrow::Table>>* chunks)
+{
+    auto orig_schema = table->schema();
+    int num_cols = table->num_columns() - 2;  // less RID and delete vector
+    if (num_cols < 0)
+        return TablesErrCodes::ArrowStatusErr;
+
+    for (int i = 0; i < num_cols; i++) {
+        auto schema = std::make_shared<arrow::Schema>(
+            std::vector<std::shared_ptr<arrow::Field>>{orig_schema->field(i)},
+            orig_schema->metadata());
+        chunks->push_back(arrow::Table::Make(schema, {table->column(i)}));
+    }
+
+    auto schema = std::make_shared<arrow::Schema>(
+        std::vector<std::shared_ptr<arrow::Field>>{
+            orig_schema->field(ARROW_RID_INDEX(num_cols)),
+            orig_schema->field(ARROW_DELVEC_INDEX(num_cols))},
+        orig_schema->metadata());
+    chunks->push_back(arrow::Table::Make(schema,
+                                         {table->column(ARROW_RID_INDEX(num_cols)),
+                                          table->column(ARROW_DELVEC_INDEX(num_cols))}));
+    return 0;
+}
+
+/*
+ * Function: merge_arrow_col_chunks
+ * Description: Rebuild a table in the layout expected by processArrowCol from
+ * the col chunks read for a query. Data cols without a chunk are not used by
+ * the query and are filled with a null array of the same length.
+ * @param[in] chunks     : Col chunks read, keyed by data col idx.
+ * @param[in] rid_chunk  : The RID and delete vector chunk.
+ * @param[in] tbl_schema : Schema of the table.
+ * @param[out] table     : Output arrow table.
+ * @param[out] errmsg    : Error message
+ * Return Value: error code
+ */
+int merge_arrow_col_chunks(std::map<int, std::shared_ptr<arrow::Table>>& chunks,
+                           std::shared_ptr<arrow::Table>& rid_chunk,
+                           schema_vec& tbl_schema,
+                           std::shared_ptr<arrow::Table>* table,
+                           std::string& errmsg)
+{
+    int64_t nrows = rid_chunk->num_rows();
+    std::vector<std::shared_ptr<arrow::Field>> fields(tbl_schema.size());
+    std::vector<std::shared_ptr<arrow::ChunkedArray>> columns(tbl_schema.size());
+
+    for (auto it = tbl_schema.begin(); it != tbl_schema.end(); ++it) {
+        if (it->idx < 0 or it->idx >= static_cast<int>(tbl_schema.size())) {
+            errmsg.append("ERROR merge_arrow_col_chunks(): col idx " +
+                          std::to_string(it->idx));
+            return TablesErrCodes::RequestedColIndexOOB;
+        }
+        auto chunk = chunks.find(it->idx);
+        if (chunk != chunks.end()) {
+            if (chunk->second->num_rows() != nrows) {
+                errmsg.append("ERROR merge_arrow_col_chunks(): rows mismatch " +
+                              it->name);
+                return TablesErrCodes::ArrowStatusErr;
+            }
+            fields[it->idx] = chunk->second->schema()->field(0);
+            columns[it->idx] = chunk->second->column(0);
+        }
+        else {
+            fields[it->idx] = arrow::field(it->name, arrow::null());
+            columns[it->idx] = std::make_shared<arrow::ChunkedArray>(
+                arrow::ArrayVector{std::make_shared<arrow::NullArray>(nrows)});
+        }
     }
+    fields.push_back(rid_chunk->schema()->field(0));
+    fields.push_back(rid_chunk->schema()->field(1));
+    columns.push_back(rid_chunk->column(0));
+    columns.push_back(rid_chunk->column(1));
+
+    auto schema = std::make_shared<arrow::Schema>(fields,
+                                                  rid_chunk->schema()->metadata());
+    *table = arrow::Table::Make(schema, columns);
     return 0;
 }
 
@@ -3010,7 +6640,16 @@ int print_arrowbuf_colwise(std::shared_ptr<arrow::Table>& table)
                 }
                 break;
             }
-            case SDT_DATE:
+            case SDT_DATE: {
+                for (auto it = array_list.begin(); it != array_list.end(); ++it) {
+                    auto array = *it;
+                    for (int j = 0; j < array->length(); j++) {
+                        std::cout << daysToDate(std::static_pointer_cast<arrow::Date32Array>(array)->Value(j));
+                        std::cout << CSV_DELIM;
+                    }
+                }
+                break;
+            }
             case SDT_STRING: {
                 for (auto it = array_list.begin(); it != array_list.end(); ++it) {
                     auto array = *it;
@@ -3056,12 +6695,7 @@ long long int printArrowbufRowAsCsv(const char* dataptr,
     // Declare vector for columns (i.e. chunked_arrays)
     std::vector<std::shared_ptr<arrow::Array>> chunk_vec;
     std::shared_ptr<arrow::Table> table;
-    std::shared_ptr<arrow::Buffer> buffer;
-
-    std::string str_buff(dataptr, datasz);
-    arrow::Buffer::FromString(str_buff, &buffer);
-
-    extract_arrow_from_buffer(&table, buffer);
+    extract_arrow_from_string(&table, dataptr, datasz);
     // From Table get the schema and from schema get the skyhook schema
     // which is stored as a metadata
     auto schema = table->schema();
@@ -3170,7 +6804,10 @@ long long int printArrowbufRowAsCsv(const char* dataptr,
                     std::cout << std::to_string(std::static_pointer_cast<arrow::DoubleArray>(print_array)->Value(i));
                     break;
                 }
-                case SDT_DATE:
+                case SDT_DATE: {
+                    std::cout << daysToDate(std::static_pointer_cast<arrow::Date32Array>(print_array)->Value(i));
+                    break;
+                }
                 case SDT_STRING: {
                     std::cout << std::static_pointer_cast<arrow::StringArray>(print_array)->GetString(i);
                     break;
@@ -3203,19 +6840,8 @@ long long int printArrowbufRowAsPGBinary(
         bool print_verbose,
         long long int max_to_print)
 {
-
-    // Each column in arrow is represented using Chunked Array. A chunked array is
-    // a vector of chunks i.e. arrays which holds actual data.
-
-    // Declare vector for columns (i.e. chunked_arrays)
-    std::vector<std::shared_ptr<arrow::Array>> chunk_vec;
     std::shared_ptr<arrow::Table> table;
-    std::shared_ptr<arrow::Buffer> buffer;
-
-    std::string str_buff(dataptr, datasz);
-    arrow::Buffer::FromString(str_buff, &buffer);
-
-    extract_arrow_from_buffer(&table, buffer);
+    extract_arrow_from_string(&table, dataptr, datasz);
     // From Table get the schema and from schema get the skyhook schema
     // which is stored as a metadata
     auto schema = table->schema();
@@ -3224,250 +6850,103 @@ long long int printArrowbufRowAsPGBinary(
     int num_rows = std::stoi(metadata->value(METADATA_NUM_ROWS));
 
     // postgres fstreams expect big endianness
-    bool big_endian = is_big_endian();
-    stringstream ss(std::stringstream::in |
-                    std::stringstream::out|
-                    std::stringstream::binary);
-
-    // print binary stream header sequence first time only
-    if (print_header) {
-
-        // 11 byte signature sequence
-        const char* header_signature = "PGCOPY\n\377\r\n\0";
-        ss.write(header_signature, 11);
-
-        // 32 bit flags field, set bit#16=1 only if OIDs included in data
-        int flags_field = 0;
-        ss.write(reinterpret_cast<const char*>(&flags_field),
-                 sizeof(flags_field));
-
-        // 32 bit extra header len
-        int header_extension_len = 0;
-        ss.write(reinterpret_cast<const char*>(&header_extension_len),
-                 sizeof(header_extension_len));
-    }
-
-    // Get the names of each column and get the vector of chunks
-    for (auto it = sc.begin(); it != sc.end(); ++it) {
-        chunk_vec.emplace_back(table->column(std::distance(sc.begin(), it))->chunk(0));
-    }
-
-    // 16 bit int, assumes same num cols for all rows below.
-    int16_t ncols = static_cast<int16_t>(sc.size());
-    if (!big_endian)
-        ncols = __builtin_bswap16(ncols);
+    bool swap = !is_big_endian();
 
     // row printing counter, used with --limit flag
-    long long int counter = 0;
-    for (int i = 0; i < num_rows; i++, counter++) {
-        if (counter >= max_to_print) break;
-        // TODO: if (root.delete_vec.at(i) == 1) continue;
+    // TODO: skip deleted rows
+    long long int counter = std::max(0LL,
+        std::min(static_cast<long long int>(num_rows), max_to_print));
+    size_t n = counter;
 
-        // 16 bit int num cols in this row (all rows same ncols currently)
-        ss.write(reinterpret_cast<const char*>(&ncols), sizeof(ncols));
-
-        // For this row get the data from each columns
-        for (auto it = sc.begin(); it != sc.end(); ++it) {
-            col_info col = *it;
-            auto print_array = chunk_vec[std::distance(sc.begin(), it)];
+    // each col's vals, already contiguous in arrow
+    std::vector<pg_copy_col> cols(sc.size());
+    for (auto it = sc.begin(); it != sc.end(); ++it) {
+        int k = std::distance(sc.begin(), it);
+        pg_copy_col& c = cols[k];
+        auto array = table->column(k)->chunk(0);
+
+        if (array->null_count() > 0) {
+            c.nulls.resize(n);
+            for (size_t i = 0; i < n; i++)
+                c.nulls[i] = array->IsNull(i);
+        }
 
-            if (print_array->IsNull(i)) {
-                // for null we only write the int representation of null,
-                // followed by no data
-                ss.write(reinterpret_cast<const char*>(&PGNULLBINARY),
-                         sizeof(PGNULLBINARY));
-                continue;
+        switch(it->type) {
+            case SDT_BOOL: {
+                auto arr = std::static_pointer_cast<arrow::BooleanArray>(array);
+                pgCopyFixedCol<uint8_t>(c, n, swap, [&](size_t i) {
+                    return static_cast<uint8_t>(arr->Value(i)); });
+                break;
             }
-
-            switch(col.type) {
-                case SDT_BOOL: {
-                    uint8_t val = std::static_pointer_cast<arrow::BooleanArray>(print_array)->Value(i);
-                    int32_t len = sizeof(val);
-                    if (!big_endian) {
-                        // val is single byte, has no endianness
-                        len = __builtin_bswap32(len);
-                    }
-                    ss.write(reinterpret_cast<const char*>(&len), sizeof(len));
-                    ss.write(reinterpret_cast<const char*>(&val), sizeof(val));
-                    break;
-                }
-                case SDT_INT8: {
-                    int8_t val = std::static_pointer_cast<arrow::Int8Array>(print_array)->Value(i);
-                    int32_t len = sizeof(val);
-                    if (!big_endian) {
-                        // val is single byte, has no endianness
-                        len = __builtin_bswap32(len);
-                    }
-                    ss.write(reinterpret_cast<const char*>(&len), sizeof(len));
-                    ss.write(reinterpret_cast<const char*>(&val), sizeof(val));
-                    break;
-                }
-                case SDT_INT16: {
-                    int16_t val = std::static_pointer_cast<arrow::Int16Array>(print_array)->Value(i);
-                    int32_t len = sizeof(val);
-                    if (!big_endian) {
-                        val = __builtin_bswap16(val);
-                        len = __builtin_bswap32(len);
-                    }
-                    ss.write(reinterpret_cast<const char*>(&len), sizeof(len));
-                    ss.write(reinterpret_cast<const char*>(&val), sizeof(val));
-                    break;
-                }
-                case SDT_INT32: {
-                    int32_t val = std::static_pointer_cast<arrow::Int32Array>(print_array)->Value(i);
-                    int32_t len = sizeof(val);
-                    if (!big_endian) {
-                        val = __builtin_bswap32(val);
-                        len = __builtin_bswap32(len);
-                    }
-                    ss.write(reinterpret_cast<const char*>(&len), sizeof(len));
-                    ss.write(reinterpret_cast<const char*>(&val), sizeof(val));
-                    break;
-                }
-                case SDT_INT64: {
-                    int64_t val = std::static_pointer_cast<arrow::Int64Array>(print_array)->Value(i);
-                    int32_t len = sizeof(val);
-                    if (!big_endian) {
-                        val = __builtin_bswap64(val);
-                        len = __builtin_bswap32(len);
-                    }
-                    ss.write(reinterpret_cast<const char*>(&len), sizeof(len));
-                    ss.write(reinterpret_cast<const char*>(&val), sizeof(val));
-                    break;
-                }
-                case SDT_UINT8: {
-                    uint8_t val = std::static_pointer_cast<arrow::UInt8Array>(print_array)->Value(i);
-                    int32_t len = sizeof(val);
-                    if (!big_endian) {
-                        // val is single byte, has no endianness
-                        len = __builtin_bswap32(len);
-                    }
-                    ss.write(reinterpret_cast<const char*>(&len), sizeof(len));
-                    ss.write(reinterpret_cast<const char*>(&val), sizeof(val));
-                    break;
-                }
-                case SDT_UINT16: {
-                    uint16_t val = std::static_pointer_cast<arrow::UInt16Array>(print_array)->Value(i);
-                    int32_t len = sizeof(val);
-                    if (!big_endian) {
-                        val = __builtin_bswap16(val);
-                        len = __builtin_bswap32(len);
-                    }
-                    ss.write(reinterpret_cast<const char*>(&len), sizeof(len));
-                    ss.write(reinterpret_cast<const char*>(&val), sizeof(val));
-                    break;
-                }
-                case SDT_UINT32: {
-                    uint32_t val =std::static_pointer_cast<arrow::UInt32Array>(print_array)->Value(i);
-                    int32_t len = sizeof(val);
-                    if (!big_endian) {
-                        val = __builtin_bswap32(val);
-                        len = __builtin_bswap32(len);
-                    }
-                    ss.write(reinterpret_cast<const char*>(&len), sizeof(len));
-                    ss.write(reinterpret_cast<const char*>(&val), sizeof(val));
-                    break;
-                }
-                case SDT_UINT64: {
-                    uint64_t val = std::static_pointer_cast<arrow::UInt64Array>(print_array)->Value(i);
-                    int32_t len = sizeof(val);
-                    if (!big_endian) {
-                        val = __builtin_bswap64(val);
-                        len = __builtin_bswap32(len);
-                    }
-                    ss.write(reinterpret_cast<const char*>(&len), sizeof(len));
-                    ss.write(reinterpret_cast<const char*>(&val), sizeof(val));
-                    break;
-                }
-                case SDT_CHAR: {
-                    int8_t val = static_cast<char>(std::static_pointer_cast<arrow::Int8Array>(print_array)->Value(i));
-                    int32_t len = sizeof(val);
-                    if (!big_endian) {
-                        // val is single byte, has no endianness
-                        len = __builtin_bswap32(len);
-                    }
-                    ss.write(reinterpret_cast<const char*>(&len), sizeof(len));
-                    ss.write(reinterpret_cast<const char*>(&val), sizeof(val));
-                    break;
-                }
-                case SDT_UCHAR: {
-                    uint8_t val = static_cast<unsigned char>(std::static_pointer_cast<arrow::UInt8Array>(print_array)->Value(i));
-                    int32_t len = sizeof(val);
-                    if (!big_endian) {
-                        // val is single byte, has no endianness
-                        len = __builtin_bswap32(len);
-                    }
-                    ss.write(reinterpret_cast<const char*>(&len), sizeof(len));
-                    ss.write(reinterpret_cast<const char*>(&val), sizeof(val));
-                    break;
-                }
-                case SDT_FLOAT:
-                case SDT_DOUBLE: {
-                    // postgres float is alias for double, so we always output a binary double.
-                    double val = 0.0;
-                    if (col.type == SDT_FLOAT)
-                        val = std::static_pointer_cast<arrow::FloatArray>(print_array)->Value(i);
-                    else
-                        val = std::static_pointer_cast<arrow::DoubleArray>(print_array)->Value(i);
-                    int32_t len = 8;
-                    if (!big_endian) {
-                        char val_bigend[len];
-                        char* vptr = (char*)&val;
-                        val_bigend[0]=vptr[7];
-                        val_bigend[1]=vptr[6];
-                        val_bigend[2]=vptr[5];
-                        val_bigend[3]=vptr[4];
-                        val_bigend[4]=vptr[3];
-                        val_bigend[5]=vptr[2];
-                        val_bigend[6]=vptr[1];
-                        val_bigend[7]=vptr[0];
-                        len = __builtin_bswap32(len);
-                        ss.write(reinterpret_cast<const char*>(&len), sizeof(len));
-                        ss.write(val_bigend, sizeof(val));
-                    }
-                    else {
-                        ss.write(reinterpret_cast<const char*>(&len), sizeof(len));
-                        ss.write(reinterpret_cast<const char*>(&val), sizeof(val));
-                    }
-                    break;
-                }
-                case SDT_DATE: {
-                    // postgres uses 4 byte int date vals, offset by pg epoch
-                    std::string strdate = std::static_pointer_cast<arrow::StringArray>(print_array)->GetString(i);
-                    int32_t len = sizeof(int32_t);
-                    boost::gregorian::date d = \
-                        boost::gregorian::from_string(strdate);
-                    int32_t val = d.julian_day() - Tables::POSTGRES_EPOCH_JDATE;
-                    if (!big_endian) {
-                        val = __builtin_bswap32(val);
-                        len = __builtin_bswap32(len);
-                    }
-                    ss.write(reinterpret_cast<const char*>(&len), sizeof(len));
-                    ss.write(reinterpret_cast<const char*>(&val), sizeof(val));
-                    break;
-                }
-                case SDT_STRING: {
-                    std::string val = std::static_pointer_cast<arrow::StringArray>(print_array)->GetString(i);
-                    int32_t len = val.length();
-                    if (!big_endian) {
-                        // val is byte array, has no endianness
-                        len = __builtin_bswap32(len);
-                    }
-                    ss.write(reinterpret_cast<const char*>(&len), sizeof(len));
-                    ss.write(val.c_str(), static_cast<int>(val.length()));
-                    break;
+            case SDT_INT8:
+            case SDT_CHAR:
+                pgCopyArrowCol<arrow::Int8Array, uint8_t>(c, array, n, swap);
+                break;
+            case SDT_UINT8:
+            case SDT_UCHAR:
+                pgCopyArrowCol<arrow::UInt8Array, uint8_t>(c, array, n, swap);
+                break;
+            case SDT_INT16:
+                pgCopyArrowCol<arrow::Int16Array, uint16_t>(c, array, n, swap);
+                break;
+            case SDT_UINT16:
+                pgCopyArrowCol<arrow::UInt16Array, uint16_t>(c, array, n, swap);
+                break;
+            case SDT_INT32:
+                pgCopyArrowCol<arrow::Int32Array, uint32_t>(c, array, n, swap);
+                break;
+            case SDT_UINT32:
+                pgCopyArrowCol<arrow::UInt32Array, uint32_t>(c, array, n, swap);
+                break;
+            case SDT_INT64:
+                pgCopyArrowCol<arrow::Int64Array, uint64_t>(c, array, n, swap);
+                break;
+            case SDT_UINT64:
+                pgCopyArrowCol<arrow::UInt64Array, uint64_t>(c, array, n, swap);
+                break;
+            case SDT_FLOAT: {
+                const float* v = std::static_pointer_cast<arrow::FloatArray>(
+                    array)->raw_values();
+                pgCopyFixedCol<uint64_t>(c, n, swap, [v](size_t i) {
+                    return pgDoubleBits(v[i]); });
+                break;
+            }
+            case SDT_DOUBLE: {
+                const double* v = std::static_pointer_cast<arrow::DoubleArray>(
+                    array)->raw_values();
+                pgCopyFixedCol<uint64_t>(c, n, swap, [v](size_t i) {
+                    return pgDoubleBits(v[i]); });
+                break;
+            }
+            case SDT_DATE:
+                // postgres uses 4 byte int date vals, offset by pg epoch
+                pgCopyArrowCol<arrow::Date32Array, uint32_t>(c, array, n, swap,
+                    Tables::UNIX_EPOCH_JDATE - Tables::POSTGRES_EPOCH_JDATE);
+                break;
+            case SDT_STRING: {
+                auto arr = std::static_pointer_cast<arrow::StringArray>(array);
+                c.lens.resize(n);
+                c.ptrs.resize(n);
+                for (size_t i = 0; i < n; i++) {
+                    if (!c.nulls.empty() and c.nulls[i]) {
+                        c.lens[i] = PGNULLBINARY;
+                        continue;
                     }
-                default: {
-                    return TablesErrCodes::UnsupportedSkyDataType;
+                    c.ptrs[i] = reinterpret_cast<const char*>(
+                        arr->GetValue(i, &c.lens[i]));
                 }
+                break;
+            }
+            default: {
+                return TablesErrCodes::UnsupportedSkyDataType;
             }
         }
     }
 
-    // rewind and output all row data for this fb
-    ss.seekg (0, ios::beg);
-    std::cout << ss.rdbuf();
-    ss.flush();
+    // output all row data for this fb
+    std::string out;
+    pgCopyEncode(cols, n, print_header, swap, out);
+    std::cout.write(out.data(), out.size());
     return counter;
 }
 
@@ -3486,10 +6965,7 @@ long long int printArrowbufRowAsPyArrowBinary(
     // Declare vector for columns (i.e. chunked_arrays)
     std::vector<std::shared_ptr<arrow::Array>> chunk_vec;
     std::shared_ptr<arrow::Table> table;
-    std::shared_ptr<arrow::Buffer> buffer;
-    std::string str_buff(dataptr, datasz);
-    arrow::Buffer::FromString(str_buff, &buffer);
-    extract_arrow_from_buffer(&table, buffer);
+    extract_arrow_from_string(&table, dataptr, datasz);
 
     // From Table get the schema and from schema get the skyhook schema
     // which is stored as a metadata
@@ -3505,23 +6981,11 @@ long long int printArrowbufRowAsPyArrowBinary(
                   << std::endl;
     }
 
-    // output binary buffer as sstream for pyarrow consumption.
-    stringstream ss(std::stringstream::in  |
-                    std::stringstream::out |
-                    std::stringstream::binary);
-
-
-    // add buf len to output
+    // output the buf len then the arrow buf as is for pyarrow consumption,
+    // the arrow ipc stream is contiguous so this is written without a copy.
     uint64_t buf_len = static_cast<uint64_t>(datasz);
-    ss.write(reinterpret_cast<const char*>(&buf_len), sizeof(buf_len));
-
-    // add const char* arrow buf
-    ss.write(dataptr, datasz);
-
-    // rewind and output the stream
-    ss.seekg (0, ios::beg);
-    std::cout << ss.rdbuf();
-    ss.flush();
+    std::cout.write(reinterpret_cast<const char*>(&buf_len), sizeof(buf_len));
+    std::cout.write(dataptr, datasz);
 
     // TODO: ignores deleted rows for now.
     // max_to_print unused here, we just output the existing arrow table
@@ -3530,6 +6994,51 @@ long long int printArrowbufRowAsPyArrowBinary(
 }
 
 
+// append a jagged array val of a flexbuf row to an arrow list builder.
+// untyped flexbuf vectors may hold null elements.
+template <typename BuilderType, typename VecType>
+static void appendFlexListVals(arrow::ListBuilder* lb, const VecType& v,
+                               int elem_type)
+{
+    typedef typename BuilderType::value_type value_type;
+    auto vb = static_cast<BuilderType*>(lb->value_builder());
+    lb->Append();
+    for (size_t j = 0; j < v.size(); j++) {
+        if (v[j].IsNull()) {
+            vb->AppendNull();
+            continue;
+        }
+        switch (elem_type) {
+            case SDT_FLOAT:
+            case SDT_DOUBLE:
+                vb->Append(static_cast<value_type>(v[j].AsDouble()));
+                break;
+            case SDT_UINT32:
+            case SDT_UINT64:
+                vb->Append(static_cast<value_type>(v[j].AsUInt64()));
+                break;
+            default:
+                vb->Append(static_cast<value_type>(v[j].AsInt64()));
+        }
+    }
+}
+
+template <typename BuilderType>
+static void appendFlexJagged(arrow::ArrayBuilder* builder,
+                             const flexbuffers::Reference& ref,
+                             int type)
+{
+    auto lb = static_cast<arrow::ListBuilder*>(builder);
+    if (ref.IsNull())  // a null list, rather than an empty one
+        lb->AppendNull();
+    else if (ref.IsTypedVector())
+        appendFlexListVals<BuilderType>(lb, ref.AsTypedVector(),
+                                        jaggedElemType(type));
+    else
+        appendFlexListVals<BuilderType>(lb, ref.AsVector(),
+                                        jaggedElemType(type));
+}
+
 /*
  * Function: transform_fb_to_arrow
  * Description: Build arrow schema vector using skyhook schema information. Get the
@@ -3548,6 +7057,17 @@ int transform_fb_to_arrow(const char* fb,
                           std::string& errmsg,
                           std::shared_ptr<arrow::Table>* table)
 {
+    // arrow cols hold the vals, dict encoded cols are decoded first
+    if (hasSkyDicts(fb)) {
+        flatbuffers::FlatBufferBuilder decoded(fb_size);
+        int ret = decodeSkyDicts(fb, fb_size, decoded, errmsg);
+        if (ret != 0)
+            return ret;
+        return transform_fb_to_arrow(
+            reinterpret_cast<const char*>(decoded.GetBufferPointer()),
+            decoded.GetSize(), query_schema, errmsg, table);
+    }
+
     int errcode = 0;
     sky_root root = getSkyRoot(fb, fb_size);
     schema_vec sc = schemaFromString(root.data_schema);
@@ -3696,7 +7216,13 @@ int transform_fb_to_arrow(const char* fb,
                 schema_vector.push_back(arrow::field(col.name, arrow::uint8()));
                 break;
             }
-            case SDT_DATE:
+            case SDT_DATE: {
+                auto ptr = std::unique_ptr<arrow::ArrayBuilder>(new arrow::Date32Builder(pool));
+                builder_list.emplace_back(ptr.get());
+                ptr.release();
+                schema_vector.push_back(arrow::field(col.name, arrow::date32()));
+                break;
+            }
             case SDT_STRING: {
                 auto ptr = std::unique_ptr<arrow::ArrayBuilder>(new arrow::StringBuilder(pool));
                 builder_list.emplace_back(ptr.get());
@@ -3704,6 +7230,97 @@ int transform_fb_to_arrow(const char* fb,
                 schema_vector.push_back(arrow::field(col.name, arrow::utf8()));
                 break;
             }
+            case SDT_JAGGEDARRAY_BOOL: {
+                auto ptr = std::unique_ptr<arrow::ArrayBuilder>(new arrow::ListBuilder(pool,std::make_shared<arrow::BooleanBuilder>(pool)));
+                builder_list.emplace_back(ptr.get());
+                ptr.release();
+                schema_vector.push_back(arrow::field(col.name, arrow::list(arrow::boolean())));
+                break;
+            }
+            case SDT_JAGGEDARRAY_CHAR: {
+                auto ptr = std::unique_ptr<arrow::ArrayBuilder>(new arrow::ListBuilder(pool,std::make_shared<arrow::Int8Builder>(pool)));
+                builder_list.emplace_back(ptr.get());
+                ptr.release();
+                schema_vector.push_back(arrow::field(col.name, arrow::list(arrow::int8())));
+                break;
+            }
+            case SDT_JAGGEDARRAY_UCHAR: {
+                auto ptr = std::unique_ptr<arrow::ArrayBuilder>(new arrow::ListBuilder(pool,std::make_shared<arrow::UInt8Builder>(pool)));
+                builder_list.emplace_back(ptr.get());
+                ptr.release();
+                schema_vector.push_back(arrow::field(col.name, arrow::list(arrow::uint8())));
+                break;
+            }
+            case SDT_JAGGEDARRAY_INT8: {
+                auto ptr = std::unique_ptr<arrow::ArrayBuilder>(new arrow::ListBuilder(pool,std::make_shared<arrow::Int8Builder>(pool)));
+                builder_list.emplace_back(ptr.get());
+                ptr.release();
+                schema_vector.push_back(arrow::field(col.name, arrow::list(arrow::int8())));
+                break;
+            }
+            case SDT_JAGGEDARRAY_INT16: {
+                auto ptr = std::unique_ptr<arrow::ArrayBuilder>(new arrow::ListBuilder(pool,std::make_shared<arrow::Int16Builder>(pool)));
+                builder_list.emplace_back(ptr.get());
+                ptr.release();
+                schema_vector.push_back(arrow::field(col.name, arrow::list(arrow::int16())));
+                break;
+            }
+            case SDT_JAGGEDARRAY_UINT8: {
+                auto ptr = std::unique_ptr<arrow::ArrayBuilder>(new arrow::ListBuilder(pool,std::make_shared<arrow::UInt8Builder>(pool)));
+                builder_list.emplace_back(ptr.get());
+                ptr.release();
+                schema_vector.push_back(arrow::field(col.name, arrow::list(arrow::uint8())));
+                break;
+            }
+            case SDT_JAGGEDARRAY_UNT16: {
+                auto ptr = std::unique_ptr<arrow::ArrayBuilder>(new arrow::ListBuilder(pool,std::make_shared<arrow::UInt16Builder>(pool)));
+                builder_list.emplace_back(ptr.get());
+                ptr.release();
+                schema_vector.push_back(arrow::field(col.name, arrow::list(arrow::uint16())));
+                break;
+            }
+            case SDT_JAGGEDARRAY_INT32: {
+                auto ptr = std::unique_ptr<arrow::ArrayBuilder>(new arrow::ListBuilder(pool,std::make_shared<arrow::Int32Builder>(pool)));
+                builder_list.emplace_back(ptr.get());
+                ptr.release();
+                schema_vector.push_back(arrow::field(col.name, arrow::list(arrow::int32())));
+                break;
+            }
+            case SDT_JAGGEDARRAY_UINT32: {
+                auto ptr = std::unique_ptr<arrow::ArrayBuilder>(new arrow::ListBuilder(pool,std::make_shared<arrow::UInt32Builder>(pool)));
+                builder_list.emplace_back(ptr.get());
+                ptr.release();
+                schema_vector.push_back(arrow::field(col.name, arrow::list(arrow::uint32())));
+                break;
+            }
+            case SDT_JAGGEDARRAY_INT64: {
+                auto ptr = std::unique_ptr<arrow::ArrayBuilder>(new arrow::ListBuilder(pool,std::make_shared<arrow::Int64Builder>(pool)));
+                builder_list.emplace_back(ptr.get());
+                ptr.release();
+                schema_vector.push_back(arrow::field(col.name, arrow::list(arrow::int64())));
+                break;
+            }
+            case SDT_JAGGEDARRAY_UINT64: {
+                auto ptr = std::unique_ptr<arrow::ArrayBuilder>(new arrow::ListBuilder(pool,std::make_shared<arrow::UInt64Builder>(pool)));
+                builder_list.emplace_back(ptr.get());
+                ptr.release();
+                schema_vector.push_back(arrow::field(col.name, arrow::list(arrow::uint64())));
+                break;
+            }
+            case SDT_JAGGEDARRAY_FLOAT: {
+                auto ptr = std::unique_ptr<arrow::ArrayBuilder>(new arrow::ListBuilder(pool,std::make_shared<arrow::FloatBuilder>(pool)));
+                builder_list.emplace_back(ptr.get());
+                ptr.release();
+                schema_vector.push_back(arrow::field(col.name, arrow::list(arrow::float32())));
+                break;
+            }
+            case SDT_JAGGEDARRAY_DOUBLE: {
+                auto ptr = std::unique_ptr<arrow::ArrayBuilder>(new arrow::ListBuilder(pool,std::make_shared<arrow::DoubleBuilder>(pool)));
+                builder_list.emplace_back(ptr.get());
+                ptr.release();
+                schema_vector.push_back(arrow::field(col.name, arrow::list(arrow::float64())));
+                break;
+            }
             default: {
                 errcode = TablesErrCodes::UnsupportedSkyDataType;
                 errmsg.append("ERROR transform_row_to_col(): table=" +
@@ -3745,8 +7362,9 @@ int transform_fb_to_arrow(const char* fb,
             if (col.nullable) {  // check nullbit
                 bool is_null = false;
                 int pos = col.idx / (8*sizeof(rec.nullbits.at(0)));
-                int col_bitmask = 1 << col.idx;
-                if ((col_bitmask & rec.nullbits.at(pos)) == 1)  {
+                uint64_t col_bitmask = uint64_t(1) <<
+                    (col.idx % (8*sizeof(rec.nullbits.at(0))));
+                if ((col_bitmask & rec.nullbits.at(pos)) != 0)  {
                     is_null = true;
                 }
                 if (is_null) {
@@ -3798,9 +7416,46 @@ int transform_fb_to_arrow(const char* fb,
                     static_cast<arrow::UInt8Builder *>(builder)->Append(row[col.idx].AsUInt8());
                     break;
                 case SDT_DATE:
+                    static_cast<arrow::Date32Builder *>(builder)->Append(flexDateToDays(row[col.idx]));
+                    break;
                 case SDT_STRING:
                     static_cast<arrow::StringBuilder *>(builder)->Append(row[col.idx].AsString().str());
                     break;
+                case SDT_JAGGEDARRAY_BOOL:
+                    appendFlexJagged<arrow::BooleanBuilder>(builder, row[col.idx], col.type);
+                    break;
+                case SDT_JAGGEDARRAY_CHAR:
+                case SDT_JAGGEDARRAY_INT8:
+                    appendFlexJagged<arrow::Int8Builder>(builder, row[col.idx], col.type);
+                    break;
+                case SDT_JAGGEDARRAY_UCHAR:
+                case SDT_JAGGEDARRAY_UINT8:
+                    appendFlexJagged<arrow::UInt8Builder>(builder, row[col.idx], col.type);
+                    break;
+                case SDT_JAGGEDARRAY_INT16:
+                    appendFlexJagged<arrow::Int16Builder>(builder, row[col.idx], col.type);
+                    break;
+                case SDT_JAGGEDARRAY_UNT16:
+                    appendFlexJagged<arrow::UInt16Builder>(builder, row[col.idx], col.type);
+                    break;
+                case SDT_JAGGEDARRAY_INT32:
+                    appendFlexJagged<arrow::Int32Builder>(builder, row[col.idx], col.type);
+                    break;
+                case SDT_JAGGEDARRAY_UINT32:
+                    appendFlexJagged<arrow::UInt32Builder>(builder, row[col.idx], col.type);
+                    break;
+                case SDT_JAGGEDARRAY_INT64:
+                    appendFlexJagged<arrow::Int64Builder>(builder, row[col.idx], col.type);
+                    break;
+                case SDT_JAGGEDARRAY_UINT64:
+                    appendFlexJagged<arrow::UInt64Builder>(builder, row[col.idx], col.type);
+                    break;
+                case SDT_JAGGEDARRAY_FLOAT:
+                    appendFlexJagged<arrow::FloatBuilder>(builder, row[col.idx], col.type);
+                    break;
+                case SDT_JAGGEDARRAY_DOUBLE:
+                    appendFlexJagged<arrow::DoubleBuilder>(builder, row[col.idx], col.type);
+                    break;
                 default: {
                     errcode = TablesErrCodes::UnsupportedSkyDataType;
                     errmsg.append("ERROR transform_row_to_col(): table=" +
@@ -16,6 +16,12 @@
 #include <sstream>
 #include <type_traits>
 #include <bitset>
+#include <algorithm>
+#include <functional>
+#include <unordered_set>
+#include <set>
+#include <cstring>
+#include <cmath>
 
 #include <include/types.h>
 #include <errno.h>
@@ -40,6 +46,7 @@
 #include "skyhookv2_generated.h"
 #include "skyhookv2_csv_generated.h"
 #include "fb_meta_generated.h"
+#include "skyhook_plan_generated.h"
 
 namespace Tables {
 
@@ -82,7 +89,19 @@ enum TablesErrCodes {
     EINVALID_TRANSFORM_FORMAT,
     EDECODE_BUFFERLIST_FAILURE,
     ECLIENTSIDE_PROCESSING_FAILURE,
-    ESTORAGESIDE_PROCESSING_FAILURE
+    ESTORAGESIDE_PROCESSING_FAILURE,
+    BadExprFormat,
+    BadPredListFormat,
+    SemiJoinKeyTypeMismatch,
+    BadSortKey,
+    BadSketchState,
+    WasmUdfNotSupported,
+    WasmUdfError,
+    RollupAggNotSupported,
+    BadRollupState,
+    BadDictEncoding,
+    BadQueryPlan,
+    BadSketchParam
 };
 
 // skyhook data types, as supported by underlying data format
@@ -136,7 +155,7 @@ enum SkyOpType {
     SOT_ne,
     SOT_leq,
     SOT_geq,
-    // ARITHMETIC FUNCTIONS (TODO)
+    // ARITHMETIC FUNCTIONS (expression cols) and AGGREGATES
     SOT_add,
     SOT_sub,
     SOT_mul,
@@ -147,10 +166,10 @@ enum SkyOpType {
     SOT_cnt,
     // LEXICAL (regex)
     SOT_like,
-    // MEMBERSHIP (collections) (TODO)
+    // MEMBERSHIP (collections)
     SOT_in,
     SOT_not_in,
-    // RANGE (TODO)
+    // RANGE (inclusive)
     SOT_between,
     // DATE (SQL)
     SOT_before,
@@ -165,8 +184,15 @@ enum SkyOpType {
     // BITWISE
     SOT_bitwise_and,
     SOT_bitwise_or,
+    // APPROXIMATE AGGREGATES (mergeable sketches)
+    SOT_approx_distinct,
+    SOT_approx_quantile,
+    // SAMPLING, see SamplePredicate
+    SOT_sample,
+    // DICTIONARY CODES, see DictPredicate
+    SOT_dict_code,
     SOT_FIRST = SOT_lt,
-    SOT_LAST = SOT_bitwise_or,
+    SOT_LAST = SOT_dict_code,
 };
 
 enum SkyIdxType
@@ -175,6 +201,7 @@ enum SkyIdxType
     SIT_IDX_RID,
     SIT_IDX_REC,
     SIT_IDX_TXT,
+    SIT_IDX_COL,
     SIT_IDX_UNK
 };
 
@@ -192,11 +219,28 @@ enum SkyIdxPlanType
     SIP_IDX_UNION
 };
 
+// sampled scans (TABLESAMPLE), of the rows or of the fbs of each obj
+enum SkySampleType
+{
+    SST_NONE = 0,
+    SST_BERNOULLI,  // each row kept with the sample probability
+    SST_BLOCK       // each fb (or col chunk row group) kept, not read if not
+};
+
+// wasm udfs, see cls_tabular_wasm.h
+enum SkyWasmUdfType
+{
+    SWU_NONE = 0,
+    SWU_FILTER,  // keeps the rows it selects, applied with the query preds
+    SWU_MAP      // computes a val per row, see wasm_query_op
+};
+
 const std::map<SkyIdxType, std::string> SkyIdxTypeMap = {
     {SIT_IDX_FB, "IDX_FBF"},
     {SIT_IDX_RID, "IDX_RID"},
     {SIT_IDX_REC, "IDX_REC"},
     {SIT_IDX_TXT, "IDX_TXT"},
+    {SIT_IDX_COL, "IDX_COL"},
     {SIT_IDX_UNK, "IDX_UNK"}
 };
 
@@ -212,15 +256,19 @@ enum AggColIdx {
     AGG_COL_MAX = -2,
     AGG_COL_SUM = -3,
     AGG_COL_CNT = -4,
+    AGG_COL_DISTINCT = -5,
+    AGG_COL_QUANTILE = -6,
     AGG_COL_FIRST = AGG_COL_MIN,
-    AGG_COL_LAST = AGG_COL_CNT,
+    AGG_COL_LAST = AGG_COL_QUANTILE,
 };
 
 const std::map<std::string, int> AGG_COL_IDX = {
     {"min", AGG_COL_MIN},
     {"max", AGG_COL_MAX},
     {"sum", AGG_COL_SUM},
-    {"cnt", AGG_COL_CNT}
+    {"cnt", AGG_COL_CNT},
+    {"approx_distinct", AGG_COL_DISTINCT},
+    {"approx_quantile", AGG_COL_QUANTILE}
 };
 
 const std::unordered_map<std::string, bool> IDX_STOPWORDS= {
@@ -245,12 +293,35 @@ const int offset_to_nullbits_vec = 6;
 const int offset_to_data = 8;
 const std::string PRED_DELIM_OUTER = ";";
 const std::string PRED_DELIM_INNER = ",";
+const std::string PRED_DELIM_LIST = "|";  // in/not_in/between vals
 const std::string PROJECT_DEFAULT = "*";
 const std::string SELECT_DEFAULT = "*";
 const std::string REGEX_DEFAULT_PATTERN = "/.^/";  // matches nothing.
 const int MAX_COLSIZE = 4096; // primarily for text cols TODO: blobs
 const int MAX_TABLE_COLS = 128; // affects nullbits vector size (skyroot)
 const int MAX_INDEX_COLS = 4;
+const unsigned SKIP_SCAN_MAX_SEEKS = 64;  // index skip scan seeks, then scan
+const size_t INDEX_MAX_PROBE_KEYS = 1024;  // in val combinations, then scan
+const uint64_t INDEX_BUILD_READ_SIZE = 8 << 20;  // obj bytes read at once
+const int PUSHBACK_MAX_INFLIGHT_DEFAULT = 0;  // disabled, else query ops per osd
+const double PUSHBACK_MAX_CPU_DEFAULT = 0;  // disabled, else cores busy per osd
+const double PUSHBACK_CPU_DECAY_SEC = 1.0;    // time constant of cpu load avg
+const size_t SEMIJOIN_EXACT_MAX = 4096;       // larger builds use a bloom filter
+const double SEMIJOIN_BLOOM_FPP = 0.01;
+const size_t QUERY_PLAN_CACHE_MAX = 64;  // compiled query plans per osd
+const int QUERY_PLAN_VERSION = 1;  // QueryPlan encoding, skyhook_plan.fbs
+const size_t WASM_MODULE_CACHE_MAX = 16;  // compiled wasm udf modules per osd
+const size_t WASM_MODULE_MAX_BYTES = 1 << 20;  // larger modules are rejected
+const uint64_t WASM_MODULE_COMPILE_MAX_MS = 2000;  // slower compiles rejected
+const uint32_t WASM_UDF_BATCH_ROWS = 1024;  // rows per wasm udf call
+const uint64_t WASM_UDF_FUEL_DEFAULT = 100000000;  // per wasm udf call
+const uint64_t WASM_UDF_MEMORY_DEFAULT = 64 << 20;  // wasm udf memory bytes
+const int HLL_PRECISION = 12;  // 2^12 registers, ~1.6% distinct count error
+const int KLL_K = 200;         // quantile sketch size, ~1.7% rank error
+const size_t DICT_MAX_VALS = 4096;     // distinct vals of a dict encoded col
+const double DICT_MAX_VALS_RATIO = 0.5;  // distinct vals per row of the fb
+const int HOT_FB_READS = 2;         // index reads of an fb before it is hot
+const size_t HOT_FB_TRACK_MAX = 4096;  // fbs tracked for hotness per osd
 const int DATASTRUCT_SEQ_NUM_MIN = 0;
 const int DATASTRUCT_SEQ_NUM_MAX = 10000;  // max per obj, before compaction
 const char CSV_DELIM = '|';
@@ -258,6 +329,11 @@ const std::string IDX_KEY_DELIM_INNER = "-";
 const std::string IDX_KEY_DELIM_OUTER = ":";
 const std::string IDX_KEY_DELIM_UNIQUE = "ENFORCEUNIQ";
 const std::string IDX_KEY_COLS_DEFAULT = "*";
+// IDX_RID/IDX_REC key data format, see appendIndexKeyData. version 1 keys
+// (padded decimal) have no version in their type, e.g., "IDX_REC:", later
+// versions do, e.g., "IDX_REC2:", so older indexes are not found.
+const int IDX_KEY_DATA_VERSION = 2;
+const std::string ROLLUP_KEY_TYPE = "ROLLUP";
 const std::string DBSCHEMA_NAME_DEFAULT = "*";
 const std::string TABLE_NAME_DEFAULT = "*";
 const std::string RID_INDEX = "_RID_INDEX_";
@@ -272,6 +348,10 @@ const int32_t PGNULLBINARY = -1;
 // https://docs.huihoo.com/doxygen/postgresql/datatype_2timestamp_8h.html
 const long POSTGRES_EPOCH_JDATE = 2451545;
 
+// unix epoch (1970-01-01) as julian date, SDT_DATE vals are stored as int32
+// days since the unix epoch (same as arrow date32)
+const long UNIX_EPOCH_JDATE = 2440588;
+
 /*
  * Convert integer to string for index/omap of primary key
  */
@@ -311,6 +391,283 @@ public:
     PredicateValue& operator=(const PredicateValue& rhs);
 };
 
+// in/not_in/between take a list of vals, e.g., "orderkey,in,1|5|9"
+static inline bool isListOp(int op)
+{
+    return op == SOT_in or op == SOT_not_in or op == SOT_between;
+}
+
+// approx aggs, accumulate a mergeable sketch rather than a single val
+static inline bool isSketchAgg(int op)
+{
+    return op == SOT_approx_distinct or op == SOT_approx_quantile;
+}
+
+// type of the final val of an agg over a col of col_type
+static inline int aggResultType(int op, int col_type)
+{
+    switch (op) {
+        case SOT_approx_distinct: return SDT_UINT64;
+        case SOT_approx_quantile: return SDT_DOUBLE;
+        default: return col_type;
+    }
+}
+
+// element type of a jagged array col, e.g., SDT_JAGGEDARRAY_FLOAT is a list
+// of SDT_FLOAT per row, or 0 if type is not a jagged array.
+static inline int jaggedElemType(int type)
+{
+    switch (type) {
+        case SDT_JAGGEDARRAY_BOOL: return SDT_BOOL;
+        case SDT_JAGGEDARRAY_CHAR: return SDT_CHAR;
+        case SDT_JAGGEDARRAY_UCHAR: return SDT_UCHAR;
+        case SDT_JAGGEDARRAY_INT8: return SDT_INT8;
+        case SDT_JAGGEDARRAY_INT16: return SDT_INT16;
+        case SDT_JAGGEDARRAY_INT32: return SDT_INT32;
+        case SDT_JAGGEDARRAY_INT64: return SDT_INT64;
+        case SDT_JAGGEDARRAY_UINT8: return SDT_UINT8;
+        case SDT_JAGGEDARRAY_UNT16: return SDT_UINT16;
+        case SDT_JAGGEDARRAY_UINT32: return SDT_UINT32;
+        case SDT_JAGGEDARRAY_UINT64: return SDT_UINT64;
+        case SDT_JAGGEDARRAY_FLOAT: return SDT_FLOAT;
+        case SDT_JAGGEDARRAY_DOUBLE: return SDT_DOUBLE;
+        default: return 0;
+    }
+}
+
+// Semi-join keys are compared in a canonical form, so the build and probe
+// side key cols need only be of the same kind: integral (incl. dates, as
+// days) keys as int64 bytes, floating point keys as double bytes, and
+// strings as is.
+enum SemiJoinKeyKind {
+    SJK_INT = 1,
+    SJK_FLOAT,
+    SJK_STRING
+};
+
+static inline int semiJoinKeyKind(int col_type)
+{
+    switch (col_type) {
+        case SDT_FLOAT:
+        case SDT_DOUBLE:
+            return SJK_FLOAT;
+        case SDT_STRING:
+            return SJK_STRING;
+        default:
+            return SJK_INT;
+    }
+}
+
+template <class T>
+inline std::string semiJoinKey(const T& v)
+{
+    if (std::is_floating_point<T>::value) {
+        double d = static_cast<double>(v);
+        return std::string(reinterpret_cast<const char*>(&d), sizeof(d));
+    }
+    int64_t i = static_cast<int64_t>(v);
+    return std::string(reinterpret_cast<const char*>(&i), sizeof(i));
+}
+
+inline std::string semiJoinKey(const std::string& v) { return v; }
+
+// probe without building the canonical key string, hashes the same bytes
+template <class T>
+inline bool semiJoinBloomContains(const bloom_filter& bf, const T& v)
+{
+    if (std::is_floating_point<T>::value)
+        return bf.contains(static_cast<double>(v));
+    return bf.contains(static_cast<int64_t>(v));
+}
+
+inline bool semiJoinBloomContains(const bloom_filter& bf, const std::string& v)
+{
+    return bf.contains(v);
+}
+
+// Set of vals of an in/not_in predicate. Small sets are probed with a
+// branchless binary search over the sorted vals, larger sets with a
+// linear probing hash table of 2x the number of vals (power of 2 slots).
+const size_t PRED_VALUE_SET_SORTED_MAX = 32;
+
+template <class T>
+class PredicateValueSet
+{
+public:
+    std::vector<T> vals;    // sorted, unique
+    std::vector<T> slots;
+    std::vector<uint8_t> used;
+    int shift;              // 64 - log2(num slots)
+
+    std::shared_ptr<const bloom_filter> bloom;  // semi-join, replaces vals
+
+    PredicateValueSet() : shift(0) {}
+    PredicateValueSet(std::shared_ptr<const bloom_filter> bf) :
+        shift(0), bloom(bf) {}
+    PredicateValueSet(std::vector<T> v) : shift(0) {
+        std::sort(v.begin(), v.end());
+        v.erase(std::unique(v.begin(), v.end()), v.end());
+        vals = v;
+        if (vals.size() > PRED_VALUE_SET_SORTED_MAX) {
+            int bits = 1;
+            while ((size_t(1) << bits) < vals.size() * 2) bits++;
+            slots.resize(size_t(1) << bits);
+            used.resize(size_t(1) << bits, 0);
+            shift = 64 - bits;
+            for (auto it = vals.begin(); it != vals.end(); ++it) {
+                size_t h = slot(*it);
+                while (used[h]) h = (h + 1) & (slots.size() - 1);
+                slots[h] = *it;
+                used[h] = 1;
+            }
+        }
+    }
+
+    // fibonacci hashing, spreads sequential int keys over the slots
+    size_t slot(const T& v) const {
+        return (static_cast<uint64_t>(std::hash<T>()(v)) *
+                0x9E3779B97F4A7C15ULL) >> shift;
+    }
+
+    bool contains(const T& v) const {
+        if (bloom)
+            return semiJoinBloomContains(*bloom, v);
+        if (shift == 0) {
+            size_t n = vals.size();
+            if (n == 0) return false;
+            const T* base = vals.data();
+            while (n > 1) {
+                size_t half = n / 2;
+                base = (base[half] <= v) ? base + half : base;
+                n -= half;
+            }
+            return *base == v;
+        }
+        const size_t mask = slots.size() - 1;
+        for (size_t h = slot(v); used[h]; h = (h + 1) & mask) {
+            if (slots[h] == v) return true;
+        }
+        return false;
+    }
+};
+
+// 64 bit hash of the vals of an approx distinct agg, in the same canonical
+// form as semi-join keys: integral (incl. dates, as days) vals as int64,
+// floating point vals as double, and strings as is.
+static inline uint64_t skyHash64(uint64_t h)
+{
+    h ^= h >> 33;  // murmur3 finalizer
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ULL;
+    h ^= h >> 33;
+    return h;
+}
+
+static inline uint64_t skyHashInt(int64_t v)
+{
+    return skyHash64(static_cast<uint64_t>(v));
+}
+
+static inline uint64_t skyHashDouble(double v)
+{
+    if (v == 0) v = 0;  // -0.0 == 0.0
+    uint64_t bits;
+    memcpy(&bits, &v, sizeof(bits));
+    return skyHash64(bits);
+}
+
+static inline uint64_t skyHashString(const char* s, size_t len)
+{
+    uint64_t h = 0xcbf29ce484222325ULL;  // fnv-1a
+    for (size_t i = 0; i < len; i++) {
+        h ^= static_cast<unsigned char>(s[i]);
+        h *= 0x100000001b3ULL;
+    }
+    return skyHash64(h);
+}
+
+// Sampled scans keep a row (by RID) or an fb (by obj and seq num) when the
+// seeded hash of its id falls below the sample fraction of the hash range,
+// so a seed always selects the same rows/fbs, each independently.
+static inline uint64_t sampleThreshold(double fraction)
+{
+    if (fraction >= 1) return UINT64_MAX;
+    if (fraction <= 0) return 0;
+    return static_cast<uint64_t>(fraction * 18446744073709551616.0);  // 2^64
+}
+
+static inline bool sampleKeep(uint64_t id, uint64_t seed, uint64_t threshold)
+{
+    return threshold == UINT64_MAX or skyHash64(id ^ seed) < threshold;
+}
+
+// HyperLogLog distinct count sketch, of 2^HLL_PRECISION 1 byte registers.
+// Merged by taking the max of each register, so the sketches of each obj
+// (or fb) combine into the sketch of their union.
+struct hll_sketch {
+    std::vector<uint8_t> regs;
+
+    hll_sketch() : regs(size_t(1) << HLL_PRECISION, 0) {}
+
+    void add(uint64_t hash) {
+        size_t i = hash >> (64 - HLL_PRECISION);
+        uint64_t w = hash << HLL_PRECISION;
+        uint8_t rank = w ? __builtin_clzll(w) + 1 : 64 - HLL_PRECISION + 1;
+        if (rank > regs[i])
+            regs[i] = rank;
+    }
+    void merge(const hll_sketch& h);
+    uint64_t estimate() const;
+    void reset() { std::fill(regs.begin(), regs.end(), 0); }
+
+    // partial agg state, see SketchPredicate
+    void serialize(std::string& out) const;
+    int deserialize(const uint8_t* data, size_t len);
+};
+
+// KLL quantile sketch of at most ~3*KLL_K vals.  Level h holds vals of
+// weight 2^h, with a capacity that shrinks by 2/3 per level below the top.
+// When the sketch is full, its lowest full level is compacted by sorting it
+// and promoting every other val to the level above.  Merged by concatenating
+// the levels and compacting.  The offset of each compaction alternates
+// rather than being random, so results are repeatable.
+struct kll_sketch {
+    uint64_t n;     // vals added
+    uint32_t coin;  // compaction offset
+    std::vector<std::vector<double>> levels;
+
+    kll_sketch() : n(0), coin(0), levels(1), retained(0),
+                   max_retained(KLL_K) {}
+
+    void add(double v) {
+        levels[0].push_back(v);
+        n++;
+        if (++retained >= max_retained)
+            compress();
+    }
+    void merge(const kll_sketch& k);
+    double quantile(double rank) const;  // 0 if empty
+    void reset() {
+        n = 0;
+        coin = 0;
+        levels.assign(1, std::vector<double>());
+        retained = 0;
+        max_retained = KLL_K;
+    }
+
+    // partial agg state, see SketchPredicate
+    void serialize(std::string& out) const;
+    int deserialize(const uint8_t* data, size_t len);
+
+private:
+    size_t retained;      // vals in all levels
+    size_t max_retained;  // sum of the level capacities
+
+    size_t capacity(size_t level) const;
+    void compress();
+};
+
 // PredBase is not template typed, derived is type templated,
 // allows us to have vectors of chained base class predicates
 class PredicateBase
@@ -322,6 +679,7 @@ public:
     virtual int opType() = 0;
     virtual int chainOpType() = 0;
     virtual bool isGlobalAgg() = 0;
+    virtual void resetAgg() = 0;  // restore the initial agg val, for reuse
     virtual std::string toString() = 0;
 };
 typedef std::vector<class PredicateBase*> predicate_vec;
@@ -336,7 +694,10 @@ private:
     const bool is_global_agg;
     const re2::RE2* regx;
     PredicateValue<T> value;
+    T agg_init;                        // initial val of agg preds
     const int chain_op_type;
+    std::vector<T> list_vals;          // in/not_in/between vals, as given
+    PredicateValueSet<T> value_set;    // in/not_in probing
 
 public:
     TypedPredicate(int idx, int type, int op, const T& val, const int ch_op=SOT_logical_and) :
@@ -344,8 +705,10 @@ public:
         col_type(type),
         op_type(op),
         is_global_agg(op==SOT_min || op==SOT_max ||
-                      op==SOT_sum || op==SOT_cnt),
+                      op==SOT_sum || op==SOT_cnt || isSketchAgg(op)),
+        regx(nullptr),
         value(val),
+        agg_init(val),
         chain_op_type(ch_op) {
 
             // ONLY VERIFY op type is valid for specified col type and value
@@ -398,16 +761,20 @@ public:
                             );
                     break;
 
-                // MEMBERSHIP (collections)
+                // MEMBERSHIP (collections) and RANGE
                 case SOT_in:
                 case SOT_not_in:
-                    assert(((std::is_same<T, std::vector<T>>::value) == true));
-                    assert (TablesErrCodes::OpNotImplemented==0); // TODO
+                case SOT_between:
+                    assert (std::is_arithmetic<T>::value or
+                            std::is_same<T, std::string>::value);
+                    // single val form, the list ctor below replaces these
+                    list_vals.assign(op_type == SOT_between ? 2 : 1, val);
+                    if (op_type != SOT_between)
+                        value_set = PredicateValueSet<T>(list_vals);
                     break;
 
                 // DATE (SQL)
                 case SOT_before:
-                case SOT_between:
                 case SOT_after:
                     assert (col_type==SDT_DATE);  // TODO
                     break;
@@ -440,6 +807,30 @@ public:
                     assert (std::is_unsigned<T>::value);
                     break;
 
+                // APPROXIMATE AGGREGATES, val is the agg param (see
+                // SketchPredicate), over any scalar col
+                case SOT_approx_distinct:
+                case SOT_approx_quantile:
+                    assert ((std::is_same<T, double>::value));
+                    assert (col_type >= SDT_FIRST and
+                            col_type <= SDT_STRING and
+                            !(op_type == SOT_approx_quantile and
+                              col_type == SDT_STRING));
+                    break;
+
+                // SAMPLING, val is the seed (see SamplePredicate)
+                case SOT_sample:
+                    assert ((std::is_same<T, uint64_t>::value));
+                    assert (idx == RID_COL_INDEX);
+                    break;
+
+                // DICTIONARY CODES, over the codes of a dict encoded
+                // string col (see DictPredicate)
+                case SOT_dict_code:
+                    assert ((std::is_same<T, uint64_t>::value));
+                    assert (col_type == SDT_STRING);
+                    break;
+
                 // FALL THROUGH OP not recognized
                 default:
                     assert (TablesErrCodes::OpNotRecognized==0);
@@ -455,16 +846,42 @@ public:
             }
         }
 
+    // in/not_in/between, Val() is the first val of the list
+    TypedPredicate(int idx, int type, int op, const std::vector<T>& vals,
+                   const int ch_op=SOT_logical_and) :
+        TypedPredicate(idx, type, op, vals.at(0), ch_op) {
+            assert (isListOp(op));
+            if (op == SOT_between)
+                assert (vals.size() == 2);
+            list_vals = vals;
+            if (op != SOT_between)
+                value_set = PredicateValueSet<T>(vals);
+        }
+
+    // semi-join in pred over a prebuilt set, Vals() are its exact vals if any
+    TypedPredicate(int idx, int type, const PredicateValueSet<T>& vs,
+                   const int ch_op=SOT_logical_and) :
+        TypedPredicate(idx, type, SOT_in, T(), ch_op) {
+            list_vals = vs.vals;
+            value_set = vs;
+        }
+
     TypedPredicate(const TypedPredicate &p) : // copy constructor as needed
         col_idx(p.col_idx),
         col_type(p.col_type),
         op_type(p.op_type),
         is_global_agg(p.is_global_agg),
-        value(p.value.val) {
-            regx = new re2::RE2(p.regx->pattern());
+        regx(nullptr),
+        value(p.value.val),
+        agg_init(p.agg_init),
+        chain_op_type(p.chain_op_type),
+        list_vals(p.list_vals),
+        value_set(p.value_set) {
+            if (p.regx)
+                regx = new re2::RE2(p.regx->pattern());
         }
 
-    ~TypedPredicate() { }
+    ~TypedPredicate() { delete regx; }
     TypedPredicate& getThis() {return *this;}
     const TypedPredicate& getThis() const {return *this;}
     virtual int colIdx() {return col_idx;}
@@ -475,6 +892,19 @@ public:
     T Val() {return value.val;}
     const re2::RE2* getRegex() {return regx;}
     void updateAgg(T newval) {value.val = newval;}
+    virtual void resetAgg() {if (is_global_agg) value.val = agg_init;}
+    const std::vector<T>& Vals() {return list_vals;}
+
+    // in/not_in/between
+    bool probe(const T& v) {
+        switch (op_type) {
+            case SOT_in: return value_set.contains(v);
+            case SOT_not_in: return !value_set.contains(v);
+            case SOT_between: return list_vals[0] <= v and v <= list_vals[1];
+            default: assert (TablesErrCodes::PredicateComparisonNotDefined==0);
+        }
+        return false;
+    }
 
     std::string toString() {
         std::string s("TypedPredicate:");
@@ -483,13 +913,119 @@ public:
         s.append(" op_type=" + std::to_string(op_type));
         s.append(" val=");
         std::stringstream ss;
-        ss << this->Val();
+        if (isListOp(op_type)) {
+            for (unsigned i = 0; i < list_vals.size(); i++)
+                ss << (i ? PRED_DELIM_LIST : "") << list_vals[i];
+        }
+        else {
+            ss << this->Val();
+        }
         s.append(ss.str());
         s.append("\n");
         return s;
     }
 };
 
+// approx agg pred (SOT_approx_distinct, SOT_approx_quantile) over a scalar
+// col.  Rather than a single agg val (see computeAgg), it accumulates a
+// mergeable sketch of the vals of the passing rows.  Its state is returned
+// as the partial agg val of each fb processed, and the partial states of all
+// objs are merged by the client into the final val (see mergeAggRows).
+// Val() is the quantile rank in [0,1], and unused (0) for distinct.
+class SketchPredicate : public TypedPredicate<double>
+{
+private:
+    hll_sketch hll;
+    kll_sketch kll;
+
+public:
+    SketchPredicate(int idx, int type, int op, double param,
+                    const int ch_op=SOT_logical_and) :
+        TypedPredicate<double>(idx, type, op, param, ch_op) {
+            assert (isSketchAgg(op));
+            assert (param >= 0 and param <= 1);
+        }
+
+    // the col val of a row, in the canonical form of its col type
+    void addInt(int64_t v) {
+        if (opType() == SOT_approx_distinct) hll.add(skyHashInt(v));
+        else kll.add(static_cast<double>(v));
+    }
+    void addUInt(uint64_t v) {
+        if (opType() == SOT_approx_distinct)
+            hll.add(skyHashInt(static_cast<int64_t>(v)));
+        else kll.add(static_cast<double>(v));
+    }
+    void addDouble(double v) {
+        if (opType() == SOT_approx_distinct) hll.add(skyHashDouble(v));
+        else kll.add(v);
+    }
+    void addString(const char* s, size_t len) {
+        assert (opType() == SOT_approx_distinct);
+        hll.add(skyHashString(s, len));
+    }
+    void addFlex(const flexbuffers::Reference& v);
+    void addArrow(const std::shared_ptr<arrow::Array>& array, int64_t row);
+
+    // partial agg state, merged with the states of other fbs/objs
+    std::string state() const;
+    int mergeState(const uint8_t* data, size_t len);
+
+    // final agg val, the distinct count or the val at the quantile rank
+    uint64_t distinct() const { return hll.estimate(); }
+    double quantile() const { return kll.quantile(Val()); }
+
+    virtual void resetAgg() { hll.reset(); kll.reset(); }
+};
+
+// Bernoulli sampling pred over the RID col, passes each row with the sample
+// fraction probability. Val() is the seed, the string form of the pred is
+// "rid,sample,fraction:seed".
+class SamplePredicate : public TypedPredicate<uint64_t>
+{
+private:
+    double fraction;
+    uint64_t threshold;
+    uint64_t seed_hash;
+
+public:
+    SamplePredicate(double frac, uint64_t seed,
+                    const int ch_op=SOT_logical_and) :
+        TypedPredicate<uint64_t>(RID_COL_INDEX, SDT_UINT64, SOT_sample,
+                                 seed, ch_op),
+        fraction(frac),
+        threshold(sampleThreshold(frac)),
+        seed_hash(skyHash64(seed)) {
+            assert (frac >= 0 and frac <= 1);
+        }
+
+    double Fraction() const { return fraction; }
+    bool keep(uint64_t rid) const {
+        return sampleKeep(rid, seed_hash, threshold);
+    }
+};
+
+// a pred over a dict encoded string col (see getSkyDicts) rewritten for the
+// dictionary of one fb, it passes the rows whose code is that of a dict val
+// passing the original pred, so the row vals are never compared as strings.
+// only lives while its fb is processed, it has no string form.
+class DictPredicate : public TypedPredicate<uint64_t>
+{
+private:
+    std::vector<uint8_t> code_pass;
+
+public:
+    DictPredicate(int idx, const std::vector<uint8_t>& pass,
+                  const int ch_op=SOT_logical_and) :
+        TypedPredicate<uint64_t>(idx, SDT_STRING, SOT_dict_code,
+                                 pass.size(), ch_op),
+        code_pass(pass) {}
+
+    bool keep(uint64_t code) const {
+        return code < code_pass.size() and code_pass[code];
+    }
+};
+
 // col metadata used for the schema
 const int NUM_COL_INFO_FIELDS = 5;
 struct col_info {
@@ -572,6 +1108,128 @@ std::vector<std::string> colnamesFromPreds(predicate_vec &preds,
                                            schema_vec &schema);
 std::vector<std::string> colnamesFromSchema(schema_vec &schema);
 
+// arithmetic expression tree node, used to compute derived cols.
+// leaf nodes are a data col reference (col_idx >= 0) or a numeric constant,
+// inner nodes apply op (SOT_add, SOT_sub, SOT_mul, SOT_div) to their children.
+// A col leaf over a jagged array col must reduce the row's inner list to a
+// single val with agg (SOT_cnt, SOT_sum, SOT_min, SOT_max), e.g.,
+// count(MUON_PT), the min/max of an empty list is 0.
+struct arith_expr {
+    int op;         // 0 for leaf nodes
+    int col_idx;    // data col idx of col leaf, -1 for constants
+    int col_type;   // SkyDataType of col leaf
+    int agg;        // per row reduction of a jagged array col leaf, else 0
+    int64_t ival;   // constant leaf val, for int exprs
+    double dval;    // constant leaf val, for double exprs
+    std::shared_ptr<arith_expr> left;
+    std::shared_ptr<arith_expr> right;
+
+    arith_expr() : op(0), col_idx(-1), col_type(0), agg(0), ival(0),
+                   dval(0) {}
+};
+typedef std::shared_ptr<arith_expr> arith_expr_ptr;
+
+// a computed col specified as NAME=expr. These are appended after the data
+// cols (col.idx = max data col idx + 1 + position), so they may be used by
+// name in projections, predicates, and agg predicates like any other col.
+// col.type is SDT_DOUBLE if any operand is floating point or the expr
+// contains a division, else SDT_INT64.
+struct expr_info {
+    col_info col;
+    arith_expr_ptr expr;
+    std::string expr_str;  // original expr text
+
+    expr_info(const col_info& c, arith_expr_ptr e, std::string s) :
+        col(c), expr(e), expr_str(s) {}
+};
+typedef std::vector<struct expr_info> expr_vec;
+
+// convert provided exprs to/from skyhook internal representation
+// format: NAME=expr;NAME=expr;... e.g., DISC_PRICE=EXTENDEDPRICE*(1-DISCOUNT)
+// or over jagged array cols, e.g., NMUON=count(MUON_PT);HT=sum(JET_PT)
+// returns 0 or the TablesErrCodes error of a malformed expr, with errmsg set.
+int exprsFromString(schema_vec &schema,
+                    std::string exprs_string,
+                    expr_vec& exprs,
+                    std::string& errmsg);
+std::string exprsToString(expr_vec &exprs);
+
+// data schema with the computed expr cols appended
+schema_vec schemaWithExprs(schema_vec &schema, expr_vec &exprs);
+
+// order by key, col must be one of the query (result) cols
+struct sort_key {
+    col_info col;  // col.idx locates the key in the input data (or expr) cols
+    bool desc;
+    int pos;       // position of the key within the query schema result rows
+
+    sort_key(const col_info& c, bool d, int p) : col(c), desc(d), pos(p) {}
+};
+typedef std::vector<struct sort_key> sort_vec;
+
+// convert provided sort keys to/from skyhook internal representation
+// format: ;COL,dir;COL,dir;... where dir is asc (default) or desc
+// e.g., ;L_SHIPDATE,desc;L_ORDERKEY
+sort_vec sortKeysFromString(schema_vec &query_schema, std::string sort_string);
+std::string sortKeysToString(const sort_vec &keys);
+
+// binary query plan (QueryPlan flatbuffer) of the query_op text fields, so
+// the osd reads the schemas and preds in place rather than parsing text.
+// encodeQueryPlan returns 0 or a TablesErrCodes error with errmsg set.
+int encodeQueryPlan(const std::string& data_schema,
+                    const std::string& query_schema,
+                    const std::string& query_exprs,
+                    const std::string& query_preds,
+                    bool index_read,
+                    const std::string& index_schema,
+                    const std::string& index_preds,
+                    const std::string& index2_schema,
+                    const std::string& index2_preds,
+                    const std::string& query_sort,
+                    std::string& plan,
+                    std::string& errmsg);
+
+// the verified plan, or nullptr if malformed or of an unknown version
+const QueryPlan* verifyQueryPlan(const char* plan, size_t plan_sz);
+schema_vec schemaFromPlan(const flatbuffers::Vector<
+                              flatbuffers::Offset<PlanCol>>* cols);
+int predsFromPlan(schema_vec& schema,
+                  const flatbuffers::Vector<flatbuffers::Offset<PlanPred>>* pp,
+                  predicate_vec& preds,
+                  std::string& errmsg);
+
+// normalized key vals of one sort col over a set of rows.  values are
+// encoded as uint64 such that unsigned compare gives the requested order,
+// strings keep an 8 byte big-endian prefix and the full val for ties.
+struct sort_col {
+    bool desc;
+    bool is_str;
+    std::vector<uint64_t> nvals;
+    std::vector<std::string> svals;
+
+    sort_col(const sort_key& k) :
+        desc(k.desc), is_str(k.col.type == SDT_STRING) {}
+};
+typedef std::vector<struct sort_col> sort_cols;
+
+uint64_t sortNormInt(int64_t v);
+uint64_t sortNormDouble(double v);
+void sortColAddNorm(sort_col& sc, uint64_t v);
+void sortColAddStr(sort_col& sc, const std::string& v);
+void sortColAddFlex(sort_col& sc, const flexbuffers::Reference& ref, int type);
+void sortColAddArrow(sort_col& sc,
+                     const std::shared_ptr<arrow::Array>& arr,
+                     int type,
+                     uint32_t row);
+
+// compute the permutation of rows [0,n) given by the sort cols, radix sort
+// for a single fixed width key, else a sort over the normalized keys.
+void sortPermutation(sort_cols& cols, std::vector<uint32_t>& perm);
+
+// compare row ra of cols a to row rb of cols b (same sort keys), <0,0,>0
+int compareSortCols(const sort_cols& a, uint32_t ra,
+                    const sort_cols& b, uint32_t rb);
+
 // the below are used in our root table
 typedef vector<uint8_t> delete_vector;
 typedef const flatbuffers::Vector<flatbuffers::Offset<Record>>* row_offs;
@@ -879,18 +1537,128 @@ int transform_arrow_to_fb(
 
 bool hasAggPreds(predicate_vec &preds);
 
+// GLOBAL AGGS: each processed fb returns a single partial agg row, of the
+// agg preds' vals in pred order (sketch aggs as their state).  The client
+// merges the partial rows of all objs into agg_preds, a copy of the query's
+// agg preds used only as merge state, then builds the final agg row of
+// query_schema cols, where sketch aggs are their final val.
+int mergeAggRows(predicate_vec& agg_preds,
+                 const char* dataptr,
+                 const size_t datasz,
+                 const int format,
+                 std::string& errmsg);
+int mergeAggTable(predicate_vec& agg_preds,
+                  const std::shared_ptr<arrow::Table>& table,
+                  std::string& errmsg);
+void buildAggResultFb(flatbuffers::FlatBufferBuilder& flatbldr,
+                      predicate_vec& agg_preds,
+                      schema_vec& query_schema,
+                      const std::string& db_schema_name,
+                      const std::string& table_name);
+
+// ROLLUPS (see rollup_info): the groups of a rollup map the key of each
+// group, its group col vals as a row, to the partial agg row of its rows.
+typedef std::map<std::string, std::string> rollup_groups;
+
+// verify the aggs of a rollup can be kept as partial agg rows, i.e., are
+// sum/cnt/min/max of a mergeable agg type with sum and cnt starting at 0.
+int rollupCheckAggs(predicate_vec& agg_preds, std::string& errmsg);
+
+// add the live rows of a SFT_FLATBUF_FLEX_ROW fb to the groups, the aggs
+// are given as their preds string over data_schema.
+int rollupAddRows(schema_vec& data_schema,
+                  schema_vec& group_schema,
+                  const std::string& agg_preds,
+                  const char* dataptr,
+                  const size_t datasz,
+                  rollup_groups& groups,
+                  std::string& errmsg);
+
+// if the query can be answered from a rollup, i.e., its aggs are all aggs of
+// the rollup and its other preds are all on the group cols, set agg_map to
+// the rollup agg of each query agg, in the order of the query's agg preds.
+bool rollupMatchesQuery(predicate_vec& query_preds,
+                        predicate_vec& rollup_aggs,
+                        schema_vec& group_schema,
+                        std::vector<int>& agg_map);
+
+// merge the partial agg rows of the groups that pass the query's preds into
+// its agg preds.
+int rollupMergeGroups(predicate_vec& query_preds,
+                      const std::vector<int>& agg_map,
+                      const rollup_groups& groups,
+                      std::string& errmsg);
+
+// a rollup is stale once the obj was written to other than by append_fb_op,
+// i.e., it no longer covers exactly the obj's bytes.
+bool rollupIsStale(const rollup_info& rollup, uint64_t obj_size);
+
+// DICTIONARY ENCODING of low cardinality string cols per fb: Table.dicts is a
+// flexbuf vector aligned with the row positions, each elem either null (col
+// not encoded) or the vector of the col's distinct strings, and the row val
+// of an encoded col is then the UInt code (position) of its string.
+// processSkyFb evaluates preds on the codes and keeps projected codes
+// encoded, other readers of the row vals decode the fb first.
+flexbuffers::Vector getSkyDicts(const char* dataptr);
+bool hasSkyDicts(const char* dataptr);
+
+// rebuild a SFT_FLATBUF_FLEX_ROW fb with the given string cols dictionary
+// encoded, or with its encoded cols decoded to their strings.  A col with
+// over DICT_MAX_VALS distinct vals, or over DICT_MAX_VALS_RATIO of the rows,
+// stays plain strings, and the fb has no dicts if no col is encoded.
+int encodeSkyDicts(const char* dataptr,
+                   const size_t datasz,
+                   schema_vec& dict_cols,
+                   flatbuffers::FlatBufferBuilder& flatbldr,
+                   std::string& errmsg);
+int decodeSkyDicts(const char* dataptr,
+                   const size_t datasz,
+                   flatbuffers::FlatBufferBuilder& flatbldr,
+                   std::string& errmsg);
+
+// copy of preds with the (non agg) preds over encoded cols replaced by new
+// DictPredicates over the codes of dicts, deleted by deleteDictPredicates.
+predicate_vec dictPredicates(predicate_vec& preds,
+                             const flexbuffers::Vector& dicts);
+void deleteDictPredicates(predicate_vec& dict_preds);
+
+// narrow [lo, hi] to the vals of an integral or date col that may satisfy
+// the preds, e.g., to prune the partitions of a range partitioned table.
+void predsKeyRange(predicate_vec &preds, int col_idx, int64_t& lo,
+                   int64_t& hi);
+
 // convert provided ops to/from internal skyhook representation (simple enums)
 int skyOpTypeFromString(std::string s);
 std::string skyOpTypeToString(int op);
 
-bool applyPredicates(predicate_vec& pv, sky_rec& rec);
+bool applyPredicates(predicate_vec& pv, sky_rec& rec,
+                     const expr_vec& exprs=expr_vec());
+
+// evaluate an expr over a single flexbuf row
+int64_t evalArithExprInt(const arith_expr_ptr& e, const flexbuffers::Vector& row);
+double evalArithExprDouble(const arith_expr_ptr& e, const flexbuffers::Vector& row);
+
+// add the data col idxs referenced by the expr leaves to cols
+void exprColIdxs(const arith_expr_ptr& e, std::set<int>& cols);
+
+// evaluate the exprs columnwise and add them to the arrow table as new cols
+// after the num_cols data cols (i.e., before the RID and delete vector cols)
+int addExprColsArrow(std::shared_ptr<arrow::Table>* table,
+                     int num_cols,
+                     const expr_vec& exprs,
+                     std::string& errmsg);
 
 bool applyPredicatesArrow(predicate_vec& pv, std::shared_ptr<arrow::Table>& table,
                           int element_index);
 
-void applyPredicatesArrowCol(predicate_vec& pv,
-                             std::shared_ptr<arrow::Array> col_array,
-                             int col_idx, std::vector<uint32_t>& row_nums);
+void applyPredicatesArrowColSel(predicate_vec& pv,
+                                std::shared_ptr<arrow::Table>& table,
+                                std::vector<uint8_t>& sel);
+
+// accumulate the global agg preds over the given (selected) rows, columnwise
+void applyAggPredsArrowCol(predicate_vec& pv,
+                           std::shared_ptr<arrow::Table>& table,
+                           const std::vector<uint32_t>& rows);
 
 inline
 bool compare(const int64_t& val1, const int64_t& val2, const int& op);
@@ -911,8 +1679,8 @@ template <typename T>
 T computeAgg(const T& val, const T& oldval, const int& op) {
 
     switch (op) {
-        case SOT_min: if (val < oldval) return val;
-        case SOT_max: if (val > oldval) return val;
+        case SOT_min: return val < oldval ? val : oldval;
+        case SOT_max: return val > oldval ? val : oldval;
         case SOT_sum: return oldval + val;
         case SOT_cnt: return oldval + 1;
         default: assert (TablesErrCodes::OpNotImplemented);
@@ -924,21 +1692,111 @@ std::string buildKeyPrefix(
         int idx_type,
         std::string schema_name,
         std::string table_name,
-        std::vector<string> colnames=std::vector<string>());
+        std::vector<string> colnames=std::vector<string>(),
+        int key_data_version=IDX_KEY_DATA_VERSION);
 std::string buildKeyData(int data_type, uint64_t new_data);
+std::string buildRollupKeyPrefix(std::string schema_name,
+                                 std::string table_name);
+
+// order preserving (memcmp) key data of a typed val for IDX_REC keys,
+// appended to key_data. ints use the uint64/int64 overloads by signedness.
+void appendIndexKeyData(std::string& key_data, int data_type, uint64_t val);
+void appendIndexKeyData(std::string& key_data, int data_type, int64_t val);
+void appendIndexKeyData(std::string& key_data, int data_type, double val);
+void appendIndexKeyData(std::string& key_data, int data_type,
+                        const std::string& val);
+void appendIndexKeyData(std::string& key_data, int data_type,
+                        const flexbuffers::Reference& ref);
+
+// a word of a text col for IDX_TXT indexes, pointing into the col val.
+// pos is the word's relative position in the col, i.e., word number.
+struct text_token {
+    const char* data;
+    size_t len;
+    int pos;
+};
 
-// used for index prefix matching during index range queries
-bool compare_keys(std::string key1, std::string key2);
-
-// used for matching lt/leq index predicates
-bool check_predicate_ops(predicate_vec index_preds, int opType);
-bool check_predicate_ops_all_include_equality(predicate_vec index_preds);
-bool check_predicate_ops_all_equality(predicate_vec index_preds);
-
-// for extracting the typed value from a typed predicate then
-// returning as uint64, which is then used to build a key-data value string
-void extract_typedpred_val(Tables::PredicateBase* pb, uint64_t& val);
-void extract_typedpred_val(Tables::PredicateBase* pb, int64_t& val);
+// split text at runs of any of the delim chars into words, after trimming
+// whitespace from both ends, and append them to tokens. no words are copied,
+// so the text must outlive the tokens.
+void tokenizeText(const char* text, size_t len, const std::string& delims,
+                  std::vector<text_token>& tokens);
+
+// the bounds set by the index preds on one col of an index, as key data.
+// eq_vals are the sorted vals of eq/in preds, if any.
+struct index_col_range {
+    bool has_eq = false;
+    bool has_lo = false;
+    bool has_hi = false;
+    bool lo_incl = false;
+    bool hi_incl = false;
+    std::vector<std::string> eq_vals;
+    std::string lo;
+    std::string hi;
+
+    bool constrained() const { return has_eq or has_lo or has_hi; }
+};
+typedef std::vector<index_col_range> index_range_vec;
+
+// ranges of each index col (in index schema order) from the index preds.
+index_range_vec indexColRanges(const schema_vec& index_schema,
+                               const predicate_vec& index_preds);
+
+// split the data portion of an IDX_REC/IDX_RID key into the key data of each
+// index col, ignoring any uniqueness suffix. false if not a data key.
+bool splitIndexKeyData(const schema_vec& index_schema,
+                       const std::string& key_data,
+                       std::vector<std::string>& col_vals);
+
+// true if the key data of a col is within / beyond the upper bound of range
+bool indexColInRange(const index_col_range& r, const std::string& val);
+bool indexColPastRange(const index_col_range& r, const std::string& val);
+
+// IDX_REC key data of each val of an index predicate, see appendIndexKeyData
+std::vector<std::string> extract_typedpred_key_data(Tables::PredicateBase* pb);
+
+// semi-join reduction, see struct semijoin_filter. the probe pred is an in
+// pred over the fact table key col, applied during the scan like any other.
+PredicateBase* semiJoinPredicate(const col_info& key_col,
+                                 const semijoin_filter& f);
+int semiJoinCollectKeys(const char* dataptr,
+                        const size_t datasz,
+                        const int ds_format,
+                        const std::string& key_colname,
+                        int& key_type,
+                        std::unordered_set<std::string>& keys,
+                        std::string& errmsg);
+semijoin_filter semiJoinBuildFilter(int key_type,
+                                    const std::unordered_set<std::string>& keys);
+
+// the probe pred is added ahead of any agg preds, like the sample pred, so
+// the aggs only accumulate the rows passing it.
+void addSemiJoinPredicate(predicate_vec& preds, PredicateBase* semijoin_pred);
+
+// Bernoulli sampled scans, see SamplePredicate. the sample pred is added
+// ahead of any agg preds, so the aggs only accumulate the sampled rows.
+void addSamplePredicate(predicate_vec& preds, PredicateBase* sample_pred);
+
+// convert SDT_DATE vals between 'YYYY-MM-DD' strings and int32 days since
+// the unix epoch, the stored representation in both flatbuf and arrow.
+int32_t dateToDays(const std::string& date);
+std::string daysToDate(int32_t days);
+
+// get an SDT_DATE val from a flexbuf row, also accepts the string dates
+// written by earlier versions of the loaders.
+int32_t flexDateToDays(const flexbuffers::Reference& ref);
+
+// add a copy of a col val of the given type from a flexbuf row to the
+// vector being built by flexbldr.
+void flexAddColVal(flexbuffers::Builder& flexbldr,
+                   const flexbuffers::Reference& ref,
+                   int type);
+
+// jagged array vals are stored in a flexbuf row as a (typed or untyped)
+// flexbuf vector, add a copy of one to the vector being built by flexbldr.
+void flexAddJaggedVal(flexbuffers::Builder& flexbldr,
+                      const flexbuffers::Reference& ref,
+                      int type);
 
 /* Apache Arrow related functions */
 
@@ -950,7 +1808,7 @@ int write_to_file(const char *filename, arrow::Buffer* buffer);
 int extract_arrow_from_buffer(std::shared_ptr<arrow::Table>* table,
                               const std::shared_ptr<arrow::Buffer> &buffer);
 int extract_arrow_from_string(std::shared_ptr<arrow::Table>* table,
-                              const char *ds, int ds_size);
+                              const char *ds, const size_t ds_size);
 
 int convert_arrow_to_buffer(const std::shared_ptr<arrow::Table> &table,
                             std::shared_ptr<arrow::Buffer>* buffer);
@@ -960,6 +1818,16 @@ int compress_arrow_tables(std::vector<std::shared_ptr<arrow::Table>> &table_vec,
 int split_arrow_table(std::shared_ptr<arrow::Table> &table, int max_rows,
                       std::vector<std::shared_ptr<arrow::Table>>* table_vec);
 
+// Column chunk layout, each data col of a table and its RID/delete vector
+// cols are stored as separate single col tables (see transform_db_op)
+int split_arrow_col_chunks(std::shared_ptr<arrow::Table> &table,
+                           std::vector<std::shared_ptr<arrow::Table>>* chunks);
+int merge_arrow_col_chunks(std::map<int, std::shared_ptr<arrow::Table>>& chunks,
+                           std::shared_ptr<arrow::Table>& rid_chunk,
+                           schema_vec& tbl_schema,
+                           std::shared_ptr<arrow::Table>* table,
+                           std::string& errmsg);
+
 int example_func(int counter);
 
 } // end namespace Tables
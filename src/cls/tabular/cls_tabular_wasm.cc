@@ -0,0 +1,705 @@
+/*
+* Copyright (C) 2018 The Regents of the University of California
+* All Rights Reserved
+*
+* This library can redistribute it and/or modify under the terms
+* of the GNU Lesser General Public License Version 2.1 as published
+* by the Free Software Foundation.
+*
+*/
+
+#include <chrono>
+#include <cmath>
+#include <list>
+#include <mutex>
+
+#include "acconfig.h"
+#include "cls_tabular_wasm.h"
+
+#ifdef HAVE_WASMTIME
+#include <wasmtime.h>
+#endif
+
+
+namespace Tables {
+
+#ifdef HAVE_WASMTIME
+
+// shared by all of the modules and stores of the osd, with fuel metering.
+static wasm_engine_t* wasm_engine()
+{
+    static std::once_flag once;
+    static wasm_engine_t* engine = nullptr;
+    std::call_once(once, []() {
+        wasm_config_t* config = wasm_config_new();
+        wasmtime_config_consume_fuel_set(config, true);
+        // a module compile runs on the calling op thread only
+        wasmtime_config_parallel_compilation_set(config, false);
+        engine = wasm_engine_new_with_config(config);
+    });
+    return engine;
+}
+
+// message of a runtime error or trap, which is deleted
+static std::string wasm_error_msg(wasmtime_error_t* error, wasm_trap_t* trap)
+{
+    wasm_byte_vec_t msg;
+    if (error) {
+        wasmtime_error_message(error, &msg);
+        wasmtime_error_delete(error);
+    }
+    else {
+        wasm_trap_message(trap, &msg);
+        wasm_trap_delete(trap);
+    }
+    std::string s(msg.data, msg.size);
+    wasm_byte_vec_delete(&msg);
+    while (!s.empty() and s.back() == '\0')
+        s.pop_back();
+    return s;
+}
+
+// compiled modules, keyed by the hash of their binary.
+struct wasm_module_entry {
+    uint64_t hash;
+    std::string binary;
+    std::shared_ptr<wasmtime_module_t> module;
+};
+static std::mutex wasm_module_lock;
+static std::list<wasm_module_entry> wasm_module_cache;  // most recently used first
+
+// hashes of the modules whose compile took over WASM_MODULE_COMPILE_MAX_MS,
+// which are rejected without compiling them again.
+static std::list<uint64_t> wasm_module_slow;
+
+static std::shared_ptr<wasmtime_module_t>
+get_wasm_module(const std::string& binary, std::string& errmsg)
+{
+    // the compile time grows with the module size, so bound both.  A
+    // compile cannot be interrupted, the time bound is checked after it.
+    if (binary.size() > WASM_MODULE_MAX_BYTES) {
+        errmsg.append("ERROR: wasm module of " +
+                      std::to_string(binary.size()) +
+                      " bytes is over the max " +
+                      std::to_string(WASM_MODULE_MAX_BYTES));
+        return nullptr;
+    }
+
+    uint64_t hash = skyHashString(binary.data(), binary.size());
+    {
+        std::lock_guard<std::mutex> l(wasm_module_lock);
+        for (auto it = wasm_module_cache.begin();
+             it != wasm_module_cache.end(); ++it) {
+            if (it->hash == hash and it->binary == binary) {
+                wasm_module_cache.splice(wasm_module_cache.begin(),
+                                         wasm_module_cache, it);
+                return it->module;
+            }
+        }
+        if (std::find(wasm_module_slow.begin(), wasm_module_slow.end(),
+                      hash) != wasm_module_slow.end()) {
+            errmsg.append("ERROR: wasm module compile: over the max " +
+                          std::to_string(WASM_MODULE_COMPILE_MAX_MS) + "ms");
+            return nullptr;
+        }
+    }
+
+    // compiled outside of the lock, concurrent misses may both compile.
+    auto start = std::chrono::steady_clock::now();
+    wasmtime_module_t* m = nullptr;
+    wasmtime_error_t* error = wasmtime_module_new(
+        wasm_engine(),
+        reinterpret_cast<const uint8_t*>(binary.data()),
+        binary.size(),
+        &m);
+    if (error) {
+        errmsg.append("ERROR: wasm module compile: " +
+                      wasm_error_msg(error, nullptr));
+        return nullptr;
+    }
+    std::shared_ptr<wasmtime_module_t> module(m, wasmtime_module_delete);
+    auto compile_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - start).count();
+
+    std::lock_guard<std::mutex> l(wasm_module_lock);
+    if (static_cast<uint64_t>(compile_ms) > WASM_MODULE_COMPILE_MAX_MS) {
+        wasm_module_slow.push_front(hash);
+        if (wasm_module_slow.size() > WASM_MODULE_CACHE_MAX)
+            wasm_module_slow.pop_back();
+        errmsg.append("ERROR: wasm module compile: " +
+                      std::to_string(compile_ms) + "ms is over the max " +
+                      std::to_string(WASM_MODULE_COMPILE_MAX_MS) + "ms");
+        return nullptr;
+    }
+    wasm_module_cache.push_front({hash, binary, module});
+    if (wasm_module_cache.size() > WASM_MODULE_CACHE_MAX)
+        wasm_module_cache.pop_back();
+    return module;
+}
+
+struct WasmUdf::instance {
+    std::shared_ptr<wasmtime_module_t> module;
+    wasmtime_store_t* store;
+    wasmtime_context_t* ctx;
+    wasmtime_memory_t memory;
+    wasmtime_func_t alloc;
+    wasmtime_func_t func;
+    uint64_t fuel;     // per call
+    int32_t in_ptr;    // batch buffers in the module's memory
+    int32_t out_ptr;
+
+    instance() : store(nullptr), ctx(nullptr), fuel(0), in_ptr(0),
+                 out_ptr(0) {}
+    ~instance() {
+        if (store)
+            wasmtime_store_delete(store);
+    }
+
+    int getFunc(const std::string& name, wasmtime_func_t& f,
+                std::string& errmsg) {
+        wasmtime_extern_t item;
+        if (!wasmtime_instance_export_get(ctx, &inst, name.c_str(),
+                                          name.size(), &item) or
+            item.kind != WASMTIME_EXTERN_FUNC) {
+            errmsg.append("ERROR: wasm module has no func " + name);
+            return TablesErrCodes::WasmUdfError;
+        }
+        f = item.of.func;
+        return 0;
+    }
+
+    // call f(args) -> i32 with a full tank of fuel
+    int call(wasmtime_func_t& f, const std::vector<int32_t>& args,
+             int32_t& result, std::string& errmsg) {
+        wasmtime_error_t* error = wasmtime_context_set_fuel(ctx, fuel);
+        if (error) {
+            errmsg.append("ERROR: wasm set fuel: " +
+                          wasm_error_msg(error, nullptr));
+            return TablesErrCodes::WasmUdfError;
+        }
+        std::vector<wasmtime_val_t> argv(args.size());
+        for (unsigned i = 0; i < args.size(); i++) {
+            argv[i].kind = WASMTIME_I32;
+            argv[i].of.i32 = args[i];
+        }
+        wasmtime_val_t res;
+        wasm_trap_t* trap = nullptr;
+        error = wasmtime_func_call(ctx, &f, argv.data(), argv.size(),
+                                   &res, 1, &trap);
+        if (error or trap) {
+            errmsg.append("ERROR: wasm udf call: " +
+                          wasm_error_msg(error, trap));
+            return TablesErrCodes::WasmUdfError;
+        }
+        if (res.kind != WASMTIME_I32) {
+            errmsg.append("ERROR: wasm udf call: result is not i32");
+            return TablesErrCodes::WasmUdfError;
+        }
+        result = res.of.i32;
+        return 0;
+    }
+
+    // the len bytes at ptr in the module's memory, nullptr if out of bounds
+    char* mem(int32_t ptr, size_t len) {
+        uint8_t* data = wasmtime_memory_data(ctx, &memory);
+        size_t size = wasmtime_memory_data_size(ctx, &memory);
+        size_t off = static_cast<uint32_t>(ptr);
+        if (off > size or len > size - off)
+            return nullptr;
+        return reinterpret_cast<char*>(data + off);
+    }
+
+    wasmtime_instance_t inst;
+};
+
+size_t wasmModuleCacheSize()
+{
+    std::lock_guard<std::mutex> l(wasm_module_lock);
+    return wasm_module_cache.size();
+}
+
+#else
+
+struct WasmUdf::instance {};
+
+size_t wasmModuleCacheSize()
+{
+    return 0;
+}
+
+#endif
+
+WasmUdf::WasmUdf() : udf_type(SWU_NONE), data_ncols(0) {}
+
+WasmUdf::~WasmUdf() {}
+
+// udf input vals are f64, only numeric cols may be input
+static bool wasmUdfInputType(int type)
+{
+    switch (type) {
+        case SDT_BOOL:
+        case SDT_INT8:
+        case SDT_INT16:
+        case SDT_INT32:
+        case SDT_INT64:
+        case SDT_UINT8:
+        case SDT_UINT16:
+        case SDT_UINT32:
+        case SDT_UINT64:
+        case SDT_CHAR:
+        case SDT_UCHAR:
+        case SDT_FLOAT:
+        case SDT_DOUBLE:
+        case SDT_DATE:
+            return true;
+        default:
+            return false;
+    }
+}
+
+int WasmUdf::init(const wasm_udf& udf,
+                  schema_vec& data_schema,
+                  std::string& errmsg)
+{
+    udf_type = udf.type;
+    if (udf_type != SWU_FILTER and udf_type != SWU_MAP) {
+        errmsg.append("ERROR: WasmUdf: bad udf type " +
+                      std::to_string(udf_type));
+        return TablesErrCodes::OpNotRecognized;
+    }
+
+    data_ncols = data_schema.size();
+    input_cols = schemaFromColNames(data_schema, udf.cols);
+    if (input_cols.empty()) {
+        errmsg.append("ERROR: WasmUdf: no input cols " + udf.cols);
+        return TablesErrCodes::RequestedColNotPresent;
+    }
+    for (auto it = input_cols.begin(); it != input_cols.end(); ++it) {
+        if (!wasmUdfInputType(it->type)) {
+            errmsg.append("ERROR: WasmUdf: input col " + it->name +
+                          " is not numeric");
+            return TablesErrCodes::UnsupportedSkyDataType;
+        }
+    }
+    in_vals.resize(input_cols.size() * WASM_UDF_BATCH_ROWS);
+
+#ifdef HAVE_WASMTIME
+    inst.reset(new instance);
+    inst->module = get_wasm_module(udf.module, errmsg);
+    if (!inst->module)
+        return TablesErrCodes::WasmUdfError;
+
+    inst->fuel = udf.fuel ? udf.fuel : WASM_UDF_FUEL_DEFAULT;
+    uint64_t max_memory = udf.max_memory ? udf.max_memory :
+                                           WASM_UDF_MEMORY_DEFAULT;
+    inst->store = wasmtime_store_new(wasm_engine(), nullptr, nullptr);
+    inst->ctx = wasmtime_store_context(inst->store);
+
+    // a single instance and memory, of at most max_memory bytes
+    wasmtime_store_limiter(inst->store, max_memory, -1, 1, -1, 1);
+
+    // no imports are given, so modules importing anything fail here.
+    wasm_trap_t* trap = nullptr;
+    wasmtime_error_t* error = wasmtime_instance_new(inst->ctx,
+                                                    inst->module.get(),
+                                                    nullptr, 0,
+                                                    &inst->inst, &trap);
+    if (error or trap) {
+        errmsg.append("ERROR: wasm module instantiate: " +
+                      wasm_error_msg(error, trap));
+        return TablesErrCodes::WasmUdfError;
+    }
+
+    wasmtime_extern_t item;
+    if (!wasmtime_instance_export_get(inst->ctx, &inst->inst, "memory",
+                                      strlen("memory"), &item) or
+        item.kind != WASMTIME_EXTERN_MEMORY) {
+        errmsg.append("ERROR: wasm module does not export its memory");
+        return TablesErrCodes::WasmUdfError;
+    }
+    inst->memory = item.of.memory;
+
+    int ret = inst->getFunc("sky_alloc", inst->alloc, errmsg);
+    if (!ret)
+        ret = inst->getFunc(udf.func, inst->func, errmsg);
+    if (ret)
+        return ret;
+
+    // the batch buffers are allocated once, and reused by every call.
+    int32_t in_size = in_vals.size() * sizeof(double);
+    int32_t out_size = WASM_UDF_BATCH_ROWS * sizeof(double);
+    ret = inst->call(inst->alloc, {in_size}, inst->in_ptr, errmsg);
+    if (!ret)
+        ret = inst->call(inst->alloc, {out_size}, inst->out_ptr, errmsg);
+    if (ret)
+        return ret;
+    if (!inst->mem(inst->in_ptr, in_size) or
+        !inst->mem(inst->out_ptr, out_size)) {
+        errmsg.append("ERROR: wasm module sky_alloc out of bounds");
+        return TablesErrCodes::WasmUdfError;
+    }
+    return 0;
+#else
+    errmsg.append("ERROR: WasmUdf: built without a wasm runtime, "
+                  "see WITH_WASMTIME");
+    return TablesErrCodes::WasmUdfNotSupported;
+#endif
+}
+
+// call the udf on the nrows rows of in_vals, setting out_keep or out_vals
+int WasmUdf::callBatch(uint32_t nrows, std::string& errmsg)
+{
+#ifdef HAVE_WASMTIME
+    int32_t ncols = input_cols.size();
+    size_t in_size = ncols * nrows * sizeof(double);
+    char* in = inst->mem(inst->in_ptr, in_size);
+    if (!in) {
+        errmsg.append("ERROR: wasm udf in buffer out of bounds");
+        return TablesErrCodes::WasmUdfError;
+    }
+    memcpy(in, in_vals.data(), in_size);
+
+    int32_t rc = 0;
+    int ret = inst->call(inst->func,
+                         {inst->in_ptr, static_cast<int32_t>(nrows), ncols,
+                          inst->out_ptr},
+                         rc, errmsg);
+    if (ret)
+        return ret;
+    if (rc != 0) {
+        errmsg.append("ERROR: wasm udf returned " + std::to_string(rc));
+        return TablesErrCodes::WasmUdfError;
+    }
+
+    // the module's memory may have moved if it grew during the call
+    size_t width = (udf_type == SWU_FILTER) ? 1 : sizeof(double);
+    const char* out = inst->mem(inst->out_ptr, nrows * width);
+    if (!out) {
+        errmsg.append("ERROR: wasm udf out buffer out of bounds");
+        return TablesErrCodes::WasmUdfError;
+    }
+    if (udf_type == SWU_FILTER) {
+        out_keep.assign(out, out + nrows);
+    }
+    else {
+        out_vals.resize(nrows);
+        memcpy(out_vals.data(), out, nrows * sizeof(double));
+    }
+    return 0;
+#else
+    errmsg.append("ERROR: WasmUdf: built without a wasm runtime");
+    return TablesErrCodes::WasmUdfNotSupported;
+#endif
+}
+
+/*
+ * Function: runBatches
+ * Description: Run the udf over rows, one call per batch of up to
+ *              WASM_UDF_BATCH_ROWS rows so that the cost of entering the
+ *              module is amortized over the batch.
+ * @param[in] rows       : Row nums to run the udf on
+ * @param[in] fill       : fill(rows, n, in) sets the vals of the input cols
+ *                         of the n rows, col by col, into in
+ * @param[out] keep_rows : For filters, the passing rows are appended
+ * @param[out] vals      : For maps, the udf val of each row is appended
+ * @param[out] errmsg    : Error message
+ *
+ * Return Value: error code
+ */
+template <typename Fill>
+int WasmUdf::runBatches(const std::vector<uint32_t>& rows,
+                        Fill fill,
+                        std::vector<uint32_t>* keep_rows,
+                        std::vector<double>* vals,
+                        std::string& errmsg)
+{
+    for (size_t b = 0; b < rows.size(); b += WASM_UDF_BATCH_ROWS) {
+        uint32_t n = std::min<size_t>(WASM_UDF_BATCH_ROWS, rows.size() - b);
+        fill(&rows[b], n, in_vals.data());
+        int ret = callBatch(n, errmsg);
+        if (ret)
+            return ret;
+        if (keep_rows) {
+            for (uint32_t i = 0; i < n; i++) {
+                if (out_keep[i])
+                    keep_rows->push_back(rows[b + i]);
+            }
+        }
+        if (vals)
+            vals->insert(vals->end(), out_vals.begin(), out_vals.begin() + n);
+    }
+    return 0;
+}
+
+static double flexUdfVal(const flexbuffers::Reference& ref, int type)
+{
+    switch (type) {
+        case SDT_BOOL: return ref.AsBool();
+        case SDT_INT8:
+        case SDT_INT16:
+        case SDT_INT32:
+        case SDT_INT64:
+        case SDT_CHAR: return ref.AsInt64();
+        case SDT_UINT8:
+        case SDT_UINT16:
+        case SDT_UINT32:
+        case SDT_UINT64:
+        case SDT_UCHAR: return ref.AsUInt64();
+        case SDT_FLOAT: return ref.AsFloat();
+        case SDT_DOUBLE: return ref.AsDouble();
+        case SDT_DATE: return flexDateToDays(ref);
+        default: assert (TablesErrCodes::UnsupportedSkyDataType==0);
+    }
+    return NAN;
+}
+
+// set the input col vals of n flatbuf rows, col by col
+static void flexUdfFill(row_offs data_vec,
+                        const schema_vec& cols,
+                        const uint32_t* rows,
+                        uint32_t n,
+                        double* in)
+{
+    for (uint32_t i = 0; i < n; i++) {
+        sky_rec rec = getSkyRec(data_vec->Get(rows[i]));
+        auto row = rec.data.AsVector();
+        for (unsigned c = 0; c < cols.size(); c++) {
+            const col_info& col = cols[c];
+            bool is_null = false;
+            if (col.nullable) {  // check nullbit
+                int pos = col.idx / (8*sizeof(rec.nullbits.at(0)));
+                uint64_t col_bitmask = uint64_t(1) <<
+                    (col.idx % (8*sizeof(rec.nullbits.at(0))));
+                is_null = (col_bitmask & rec.nullbits.at(pos)) != 0;
+            }
+            in[c * n + i] = is_null ? NAN : flexUdfVal(row[col.idx], col.type);
+        }
+    }
+}
+
+// the live rows of a flatbuf, of row_nums if given
+static void flexUdfRows(const sky_root& root,
+                        const std::vector<uint32_t>& row_nums,
+                        std::vector<uint32_t>& rows)
+{
+    uint32_t nrows = row_nums.empty() ? root.nrows : row_nums.size();
+    rows.reserve(nrows);
+    for (uint32_t i = 0; i < nrows; i++) {
+        uint32_t rnum = row_nums.empty() ? i : row_nums[i];
+        if (rnum < root.nrows and root.delete_vec[rnum] != 1)
+            rows.push_back(rnum);
+    }
+}
+
+int WasmUdf::filterFlexRows(const char* dataptr,
+                            const size_t datasz,
+                            std::vector<uint32_t>& row_nums,
+                            std::string& errmsg)
+{
+    sky_root root = getSkyRoot(dataptr, datasz, SFT_FLATBUF_FLEX_ROW);
+    std::vector<uint32_t> rows;
+    flexUdfRows(root, row_nums, rows);
+
+    auto data_vec = static_cast<row_offs>(root.data_vec);
+    auto fill = [&](const uint32_t* r, uint32_t n, double* in) {
+        flexUdfFill(data_vec, input_cols, r, n, in);
+    };
+    std::vector<uint32_t> keep_rows;
+    int ret = runBatches(rows, fill, &keep_rows, nullptr, errmsg);
+    row_nums.swap(keep_rows);
+    return ret;
+}
+
+int WasmUdf::mapFlexRows(const char* dataptr,
+                         const size_t datasz,
+                         std::vector<uint64_t>& rids,
+                         std::vector<double>& vals,
+                         std::string& errmsg)
+{
+    sky_root root = getSkyRoot(dataptr, datasz, SFT_FLATBUF_FLEX_ROW);
+    std::vector<uint32_t> rows;
+    flexUdfRows(root, {}, rows);
+
+    auto data_vec = static_cast<row_offs>(root.data_vec);
+    for (auto it = rows.begin(); it != rows.end(); ++it)
+        rids.push_back(getSkyRec(data_vec->Get(*it)).RID);
+
+    auto fill = [&](const uint32_t* r, uint32_t n, double* in) {
+        flexUdfFill(data_vec, input_cols, r, n, in);
+    };
+    return runBatches(rows, fill, nullptr, &vals, errmsg);
+}
+
+template <typename ArrayType>
+static void arrowUdfNumVals(const std::shared_ptr<arrow::Array>& array,
+                            const uint32_t* rows,
+                            uint32_t n,
+                            double* out)
+{
+    const auto* v = std::static_pointer_cast<ArrayType>(array)->raw_values();
+    for (uint32_t i = 0; i < n; i++)
+        out[i] = static_cast<double>(v[rows[i]]);
+}
+
+// set the vals of n rows of an arrow col
+static void arrowUdfVals(const std::shared_ptr<arrow::Array>& array,
+                         int type,
+                         const uint32_t* rows,
+                         uint32_t n,
+                         double* out)
+{
+    switch (type) {
+        case SDT_BOOL: {
+            auto arr = std::static_pointer_cast<arrow::BooleanArray>(array);
+            for (uint32_t i = 0; i < n; i++)
+                out[i] = arr->Value(rows[i]);
+            break;
+        }
+        case SDT_INT8:
+        case SDT_CHAR:
+            arrowUdfNumVals<arrow::Int8Array>(array, rows, n, out);
+            break;
+        case SDT_INT16:
+            arrowUdfNumVals<arrow::Int16Array>(array, rows, n, out);
+            break;
+        case SDT_INT32:
+            arrowUdfNumVals<arrow::Int32Array>(array, rows, n, out);
+            break;
+        case SDT_INT64:
+            arrowUdfNumVals<arrow::Int64Array>(array, rows, n, out);
+            break;
+        case SDT_UINT8:
+        case SDT_UCHAR:
+            arrowUdfNumVals<arrow::UInt8Array>(array, rows, n, out);
+            break;
+        case SDT_UINT16:
+            arrowUdfNumVals<arrow::UInt16Array>(array, rows, n, out);
+            break;
+        case SDT_UINT32:
+            arrowUdfNumVals<arrow::UInt32Array>(array, rows, n, out);
+            break;
+        case SDT_UINT64:
+            arrowUdfNumVals<arrow::UInt64Array>(array, rows, n, out);
+            break;
+        case SDT_FLOAT:
+            arrowUdfNumVals<arrow::FloatArray>(array, rows, n, out);
+            break;
+        case SDT_DOUBLE:
+            arrowUdfNumVals<arrow::DoubleArray>(array, rows, n, out);
+            break;
+        case SDT_DATE:
+            arrowUdfNumVals<arrow::Date32Array>(array, rows, n, out);
+            break;
+        default: assert (TablesErrCodes::UnsupportedSkyDataType==0);
+    }
+    if (array->null_count() > 0) {
+        for (uint32_t i = 0; i < n; i++) {
+            if (array->IsNull(rows[i]))
+                out[i] = NAN;
+        }
+    }
+}
+
+// the live rows of an arrow table, of row_nums if given
+static void arrowUdfRows(std::shared_ptr<arrow::Table>& table,
+                         int data_ncols,
+                         const std::vector<uint32_t>& row_nums,
+                         std::vector<uint32_t>& rows)
+{
+    auto metadata = table->schema()->metadata();
+    uint32_t table_nrows = atoi(metadata->value(METADATA_NUM_ROWS).c_str());
+    auto delvec = std::static_pointer_cast<arrow::BooleanArray>(
+        table->column(ARROW_DELVEC_INDEX(data_ncols))->chunk(0));
+
+    uint32_t nrows = row_nums.empty() ? table_nrows : row_nums.size();
+    rows.reserve(nrows);
+    for (uint32_t i = 0; i < nrows; i++) {
+        uint32_t rnum = row_nums.empty() ? i : row_nums[i];
+        if (rnum < table_nrows and !delvec->Value(rnum))
+            rows.push_back(rnum);
+    }
+}
+
+int WasmUdf::filterArrowRows(std::shared_ptr<arrow::Table>& table,
+                             std::vector<uint32_t>& row_nums,
+                             std::string& errmsg)
+{
+    std::vector<uint32_t> rows;
+    arrowUdfRows(table, data_ncols, row_nums, rows);
+
+    auto fill = [&](const uint32_t* r, uint32_t n, double* in) {
+        for (unsigned c = 0; c < input_cols.size(); c++) {
+            const col_info& col = input_cols[c];
+            arrowUdfVals(table->column(col.idx)->chunk(0), col.type,
+                         r, n, in + c * n);
+        }
+    };
+    std::vector<uint32_t> keep_rows;
+    int ret = runBatches(rows, fill, &keep_rows, nullptr, errmsg);
+    row_nums.swap(keep_rows);
+    return ret;
+}
+
+int WasmUdf::mapArrowRows(std::shared_ptr<arrow::Table>& table,
+                          std::vector<uint64_t>& rids,
+                          std::vector<double>& vals,
+                          std::string& errmsg)
+{
+    std::vector<uint32_t> rows;
+    arrowUdfRows(table, data_ncols, {}, rows);
+
+    auto rid_array = std::static_pointer_cast<arrow::Int64Array>(
+        table->column(ARROW_RID_INDEX(data_ncols))->chunk(0));
+    for (auto it = rows.begin(); it != rows.end(); ++it)
+        rids.push_back(rid_array->Value(*it));
+
+    auto fill = [&](const uint32_t* r, uint32_t n, double* in) {
+        for (unsigned c = 0; c < input_cols.size(); c++) {
+            const col_info& col = input_cols[c];
+            arrowUdfVals(table->column(col.idx)->chunk(0), col.type,
+                         r, n, in + c * n);
+        }
+    };
+    return runBatches(rows, fill, nullptr, &vals, errmsg);
+}
+
+void buildWasmMapFb(flatbuffers::FlatBufferBuilder& flatbldr,
+                    const std::string& colname,
+                    const std::string& table_name,
+                    const std::vector<uint64_t>& rids,
+                    const std::vector<double>& vals)
+{
+    // NaN udf vals are NULL
+    schema_vec sc;
+    sc.push_back(col_info(0, SDT_DOUBLE, false, true, colname));
+
+    delete_vector dead_rows;
+    std::vector<flatbuffers::Offset<Tables::Record>> offs;
+    offs.reserve(rids.size());
+    for (unsigned i = 0; i < rids.size(); i++) {
+        flexbuffers::Builder flexbldr;
+        flexbldr.Vector([&]() {
+            flexbldr.Add(vals[i]);
+        });
+        flexbldr.Finish();
+        auto row_data = flatbldr.CreateVector(flexbldr.GetBuffer());
+        nullbits_vector nb(2, 0);
+        if (std::isnan(vals[i]))
+            nb[0] = 1;
+        auto nullbits = flatbldr.CreateVector(nb);
+        offs.push_back(CreateRecord(flatbldr, rids[i], nullbits, row_data));
+        dead_rows.push_back(0);
+    }
+
+    auto schema = flatbldr.CreateString(schemaToString(sc));
+    auto db_schema = flatbldr.CreateString("*");
+    auto table_n = flatbldr.CreateString(table_name);
+    auto delete_v = flatbldr.CreateVector(dead_rows);
+    auto rows_v = flatbldr.CreateVector(offs);
+    auto table = CreateTable(flatbldr, SFT_FLATBUF_FLEX_ROW, 2, 1, 1,
+                             schema, db_schema, table_n, delete_v, rows_v,
+                             offs.size());
+    flatbldr.Finish(table);
+}
+
+} // end namespace Tables
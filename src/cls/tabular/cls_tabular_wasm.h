@@ -0,0 +1,117 @@
+/*
+* Copyright (C) 2018 The Regents of the University of California
+* All Rights Reserved
+*
+* This library can redistribute it and/or modify under the terms
+* of the GNU Lesser General Public License Version 2.1 as published
+* by the Free Software Foundation.
+*
+*/
+
+
+#ifndef CLS_TABULAR_WASM_H
+#define CLS_TABULAR_WASM_H
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "cls_tabular_utils.h"
+#include "cls_tabular.h"
+
+
+// WebAssembly user defined functions (UDFs), run within the cls next to the
+// data by an embedded wasm runtime (wasmtime, built with -DWITH_WASMTIME=ON).
+//
+// A udf module exports its linear memory as "memory", an allocator
+// "sky_alloc(i32 size) -> i32" and the udf itself as
+// "<func>(i32 in, i32 nrows, i32 ncols, i32 out) -> i32", which is called
+// once per batch of up to WASM_UDF_BATCH_ROWS rows.  in holds the vals of
+// the udf's input cols as f64, col by col (col c at in + 8*c*nrows), with
+// NULLs as NaN.  A filter sets the u8 out[i] non-zero to keep row i, a map
+// sets the f64 out[i] to its val for row i.  Non-zero returns are errors.
+//
+// Modules are sandboxed: they may not import anything, so they see only the
+// batches given to them, and each batch call is limited by fuel (roughly
+// wasm instructions) and the module by its linear memory size.  Modules
+// over WASM_MODULE_MAX_BYTES are rejected, as are modules whose compile took
+// over WASM_MODULE_COMPILE_MAX_MS.  Compiled modules are cached per osd,
+// keyed by the hash of the module binary.
+
+
+namespace Tables {
+
+class WasmUdf {
+public:
+    WasmUdf();
+    ~WasmUdf();
+
+    // compile (or get from the cache) and instantiate the udf module,
+    // resolve the udf input cols in data_schema.
+    int init(const wasm_udf& udf,
+             schema_vec& data_schema,
+             std::string& errmsg);
+
+    int type() const { return udf_type; }
+    const schema_vec& inputCols() const { return input_cols; }
+
+    // filter the live rows of a flatbuf or arrow table in batches. row_nums
+    // are the rows to consider (empty for all) and are set to the passing
+    // rows, empty if none pass.
+    int filterFlexRows(const char* dataptr,
+                       const size_t datasz,
+                       std::vector<uint32_t>& row_nums,
+                       std::string& errmsg);
+    int filterArrowRows(std::shared_ptr<arrow::Table>& table,
+                        std::vector<uint32_t>& row_nums,
+                        std::string& errmsg);
+
+    // map the live rows of a flatbuf or arrow table in batches, setting
+    // the RID and udf val of each row.
+    int mapFlexRows(const char* dataptr,
+                    const size_t datasz,
+                    std::vector<uint64_t>& rids,
+                    std::vector<double>& vals,
+                    std::string& errmsg);
+    int mapArrowRows(std::shared_ptr<arrow::Table>& table,
+                     std::vector<uint64_t>& rids,
+                     std::vector<double>& vals,
+                     std::string& errmsg);
+
+private:
+    struct instance;  // the runtime's store and instance of the module
+
+    int udf_type;
+    int data_ncols;  // locates the arrow RID and delete vector cols
+    schema_vec input_cols;
+    std::unique_ptr<instance> inst;
+
+    // the batch input vals, col by col, and the output of the last call
+    std::vector<double> in_vals;
+    std::vector<uint8_t> out_keep;
+    std::vector<double> out_vals;
+
+    int callBatch(uint32_t nrows, std::string& errmsg);
+
+    template <typename Fill>
+    int runBatches(const std::vector<uint32_t>& rows, Fill fill,
+                   std::vector<uint32_t>* keep_rows,
+                   std::vector<double>* vals,
+                   std::string& errmsg);
+};
+
+// number of compiled modules in the osd's cache
+size_t wasmModuleCacheSize();
+
+// build a SFT_FLATBUF_FLEX_ROW table of the udf vals of a map, one row per
+// RID with the single SDT_DOUBLE col named by the udf.
+void buildWasmMapFb(flatbuffers::FlatBufferBuilder& flatbldr,
+                    const std::string& colname,
+                    const std::string& table_name,
+                    const std::vector<uint64_t>& rids,
+                    const std::vector<double>& vals);
+
+} // end namespace Tables
+
+
+#endif
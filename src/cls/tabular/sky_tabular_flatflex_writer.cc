@@ -31,6 +31,18 @@ bin/sky_tabular_flatflex_writer --input_file_name lineitem.txt --input_file_sche
 # for these, be sure to change num-objs to 1 in queries
 bin/sky_tabular_flatflex_writer --input_file_name lineitem.txt --input_file_schema lineitem_schema.txt --num_objs 1 --flush_rows 17 --read_rows 17 --csv_delim "|" --use_hashing false --rid_start_value 2 --table_name testdata --default_oid 111 --data_format SFT_FLATBUF_FLEX_ROW ;
 
+# range partition on orderkey into 3 partitions, starting a new subpartition
+# whenever a partition's object reaches 1MB. writes the objects as
+# skyhook.SFT_FLATBUF_FLEX_ROW.testdata.<part>.<subpart> along with the
+# partition map skyhook.SFT_FLATBUF_FLEX_ROW.testdata.partmap, store them as
+# obj.testdata.<part>.<subpart> and obj.testdata.partmap and query with
+# run-query --range-partitioned
+bin/sky_tabular_flatflex_writer --input_file_name lineitem.txt --input_file_schema lineitem_schema.txt --num_objs 3 --flush_rows 100000 --read_rows 17 --csv_delim "|" --use_hashing false --rid_start_value 2 --table_name testdata --default_oid 0 --data_format SFT_FLATBUF_FLEX_ROW --range_col orderkey --range_bounds "1000,2000" --split_bytes 1048576 ;
+
+# dictionary encode the low cardinality string cols of each fb, the preds on
+# them are then applied to the codes of their vals.
+bin/sky_tabular_flatflex_writer --input_file_name lineitem.txt --input_file_schema lineitem_schema.txt --num_objs 1 --flush_rows 17 --read_rows 17 --csv_delim "|" --use_hashing false --rid_start_value 2 --table_name testdata --default_oid 111 --data_format SFT_FLATBUF_FLEX_ROW --dict_cols "returnflag,linestatus,shipinstruct,shipmode" ;
+
 # setup
 bin/rados mkpool tpchdata;
 yes | PATH=$PATH:bin ../src/progly/rados-store-glob.sh tpchdata fbmeta.Skyhook.v2.SFT_FLATBUF_FLEX_ROW.testdata.* ;
@@ -44,8 +56,10 @@ yes | PATH=$PATH:bin ../src/progly/rados-store-glob.sh tpchdata fbmeta.Skyhook.v
 #include <map>
 #include <unistd.h>    // for getOpt
 #include <limits.h>
+#include <cstdio>      // rename
 #include <boost/program_options.hpp>
 
+#include "cls_tabular.h"
 #include "cls_tabular_utils.h"
 
 using namespace std;
@@ -55,6 +69,7 @@ namespace po = boost::program_options ;
 const uint8_t SKYHOOK_VERSION = 1;
 const uint8_t SCHEMA_VERSION = 1;
 string SCHEMA = "";
+Tables::schema_vec DICT_COLS;
 uint64_t RID = 1;
 typedef flatbuffers::FlatBufferBuilder fbBuilder;
 typedef flatbuffers::FlatBufferBuilder* fbb;
@@ -64,6 +79,7 @@ typedef vector<flatbuffers::Offset<Record>> rows_vector;
 
 typedef struct {
     uint64_t oid;
+    int subpart;        // range partitioned tables only, else -1
     uint64_t nrows;
     string table_name;
     fbb fb;
@@ -106,6 +122,8 @@ void finishFlatBuffer(fbb, uint8_t, uint8_t, string, string, delete_vector *,
 
 int writeToDisk(string, uint64_t, uint8_t, bucket_t*, uint64_t);
 
+int writePartitionMap(string, string, range_partition_map&);
+
 void deleteBucket(bucket_t *bucketPtr, fbb fbPtr, delete_vector *deletePtr,
                   rows_vector *rowsPtr);
 
@@ -135,6 +153,10 @@ int main(int argc, char *argv[])
     char csv_delim           = Tables::CSV_DELIM;
     bool use_hashing         = false;
     string data_format          = "";
+    string range_col         = "";
+    string range_bounds      = "";
+    uint64_t split_bytes     = 0;
+    string dict_cols         = "";
 
 // -------------- Get Variables ---------------
     po::options_description gen_opts("General options");
@@ -150,7 +172,11 @@ int main(int argc, char *argv[])
       ("use_hashing", po::value<bool>(&use_hashing)->required(), "use_hashing")
       ("table_name", po::value<string>(&table_name)->required(), "table_name")
       ("default_oid", po::value<uint64_t>(&default_oid)->required(), "default_oid")
-      ("data_format", po::value<string>(&data_format)->required(), "data_format");
+      ("data_format", po::value<string>(&data_format)->required(), "data_format")
+      ("range_col", po::value<string>(&range_col)->default_value(""), "range partition the rows on this integral or date col instead of hashing them")
+      ("range_bounds", po::value<string>(&range_bounds)->default_value(""), "ascending csv list of the lower bounds of partitions 1..n-1, e.g., \"1000,2000\"")
+      ("split_bytes", po::value<uint64_t>(&split_bytes)->default_value(0), "range partitions continue in a new subpartition when their object reaches this size, 0 splits every flush_rows only")
+      ("dict_cols", po::value<string>(&dict_cols)->default_value(""), "csv list of string cols to dictionary encode in each fb, e.g., \"returnflag,shipmode\"");
 
     po::options_description all_opts("Allowed options");
     all_opts.add(gen_opts);
@@ -170,6 +196,60 @@ int main(int argc, char *argv[])
     schema = getSchema(composite_key_indexes, input_file_schema);
     SCHEMA = Tables::schemaToString(schema);
 
+    // dictionary encoded cols, each fb holds the dicts of its own vals
+    if (!dict_cols.empty()) {
+        boost::to_upper(dict_cols);
+        DICT_COLS = Tables::schemaFromColNames(schema, dict_cols);
+        if (DICT_COLS.size() != line_split(dict_cols, ',').size()) {
+            std::cout << "dict_cols '" << dict_cols << "' not all in schema. aborting." << std::endl;
+            exit(1);
+        }
+        for (auto it = DICT_COLS.begin(); it != DICT_COLS.end(); ++it) {
+            if (it->type != SDT_STRING) {
+                std::cout << "dict_col '" << it->name << "' is not a string col. aborting." << std::endl;
+                exit(1);
+            }
+        }
+    }
+
+    // range partitioning, the partition map is rewritten after each flush
+    bool use_range = !range_col.empty();
+    int range_col_idx = -1;
+    range_partition_map partmap;
+    if (use_range) {
+        boost::to_upper(range_col);
+        Tables::schema_vec sv = Tables::schemaFromColNames(schema, range_col);
+        if (sv.size() != 1) {
+            std::cout << "range_col '" << range_col << "' not in schema. aborting." << std::endl;
+            exit(1);
+        }
+        switch (sv[0].type) {
+            case SDT_INT8: case SDT_INT16: case SDT_INT32: case SDT_INT64:
+            case SDT_UINT8: case SDT_UINT16: case SDT_UINT32: case SDT_UINT64:
+            case SDT_DATE:
+                break;
+            default:
+                std::cout << "range_col '" << range_col << "' is not an integral or date col. aborting." << std::endl;
+                exit(1);
+        }
+        range_col_idx = sv[0].idx;
+        partmap.col_name = sv[0].name;
+        partmap.col_type = sv[0].type;
+        for (auto& b : line_split(range_bounds, ',')) {
+            if (sv[0].type == SDT_DATE)
+                partmap.bounds.push_back(Tables::dateToDays(b));
+            else
+                partmap.bounds.push_back(std::stoll(b));
+            if (partmap.bounds.size() > 1 and
+                partmap.bounds.back() <= partmap.bounds[partmap.bounds.size() - 2]) {
+                std::cout << "range_bounds must be ascending. aborting." << std::endl;
+                exit(1);
+            }
+        }
+        partmap.nsubparts.assign(partmap.bounds.size() + 1, 0);
+        num_objs = partmap.nsubparts.size();
+    }
+
 // ----------- Read Rows and Load into Corresponding FlatBuffer -----------
     map<uint64_t, bucket_t *> FBmap;
     bucket_t *bucketPtr;
@@ -190,7 +270,23 @@ int main(int argc, char *argv[])
                                                           nullbits);
 
             uint64_t oid     = -1 ;
-            if(use_hashing) {
+            if(use_range) {
+              // --------- Get Oid (partition) from the range col ----------
+              const string& key = parsedRow[range_col_idx];
+              int64_t val = 0;
+              if (key == "NULL")
+                  val = 0;
+              else if (partmap.col_type == SDT_DATE)
+                  val = Tables::dateToDays(key);
+              else if (partmap.col_type == SDT_UINT64)
+                  // saturate at INT64_MAX, see Tables::predsKeyRange
+                  val = std::min(std::stoull(key),
+                                 static_cast<unsigned long long>(INT64_MAX));
+              else
+                  val = std::stoll(key);
+              oid = partmap.partition(val);
+            }
+            else if(use_hashing) {
               // --------- Hash Composite Key ----------
               uint64_t hashKey = hashCompositeKey(composite_key_indexes, parsedRow);
 
@@ -215,9 +311,15 @@ int main(int argc, char *argv[])
             //       otherwise, when flush_rows < read_rows,
             //       this will flush everything to the same object,
             //       which overwrites previously written data.
-            if( bucketPtr->rowsv->size() >= flush_rows) {
+            // range partitions also split when their object is too large,
+            // later rows of the partition continue in the next subpartition.
+            if( bucketPtr->rowsv->size() >= flush_rows or
+                (use_range and split_bytes > 0 and
+                 bucketPtr->fb->GetSize() >= split_bytes)) {
                 printf("\tFlushing bucket %ld to Ceph with %ld rows\n",
                        oid, bucketPtr->nrows);
+                if (use_range)
+                    bucketPtr->subpart = partmap.nsubparts[oid]++;
 
                 // Flush FlatBuffer to Ceph (currently writes to a file on disk)
                 flushFlatBuffer(data_format,
@@ -227,6 +329,9 @@ int main(int argc, char *argv[])
                                 SCHEMA,
                                 num_objs);
                 FBmap.erase(oid);
+                if (use_range and
+                    writePartitionMap(data_format, table_name, partmap) < 0)
+                    exit(EXIT_FAILURE);
             } // if need to flush
             delete nullbits;
         } // if in rid range
@@ -239,16 +344,21 @@ int main(int argc, char *argv[])
     } // while get a row
 
 // ------------- Iterate over map and flush each bucket --------------
-   if(use_hashing) {
+   if(use_hashing or use_range) {
         printf("\nFlush the remaining buckets in map\n");
         for (auto& x: FBmap) {
             bucket_t *b = x.second;
             printf("\tFlushing bucket %ld to Ceph with %ld rows\n",
                    b->oid, b->nrows);
+            if (use_range)
+                b->subpart = partmap.nsubparts[b->oid]++;
 
             flushFlatBuffer(data_format, SKYHOOK_VERSION, SCHEMA_VERSION, b, SCHEMA, num_objs);
         } // for every FBmap key
-    } // if using hashing
+        if (use_range and
+            writePartitionMap(data_format, table_name, partmap) < 0)
+            exit(EXIT_FAILURE);
+    } // if using hashing or ranges
 
     FBmap.clear();
     printf("Done flushing all the objects\n");
@@ -464,7 +574,7 @@ void getFlxBuffer(flxBuilder *flx,
                     flx->Add(static_cast<double>(0));
                     break;
                 case Tables::SDT_DATE:
-                    flx->Add("0000-00-00");
+                    flx->Add(static_cast<int32_t>(0));
                     break;
                 case Tables::SDT_STRING:
                     flx->Add("This will be pooled with strings.");
@@ -516,7 +626,8 @@ void getFlxBuffer(flxBuilder *flx,
                     flx->Add(static_cast<double>(stod(parsedRow[col.idx].c_str())));
                     break;
                 case Tables::SDT_DATE:
-                    flx->Add(parsedRow[col.idx].c_str());
+                    // stored as int32 days since epoch
+                    flx->Add(Tables::dateToDays(parsedRow[col.idx]));
                     break;
                 case Tables::SDT_STRING:
                     flx->Add(parsedRow[col.idx].c_str());
@@ -597,6 +708,7 @@ retrieveBucketFromOID(map<uint64_t, bucket_t *> &FBmap, uint64_t oid, string tab
     {
         bucketPtr = new bucket_t();
         bucketPtr->oid = oid;
+        bucketPtr->subpart = -1;
         bucketPtr->nrows = 0;
         bucketPtr->table_name = tablename;
         bucketPtr->fb = new fbBuilder();
@@ -675,6 +787,21 @@ flushFlatBuffer(
 
     fbPtr->Finish(tableOffset);
 
+    // rebuild the fb with its dict cols encoded
+    if (!DICT_COLS.empty()) {
+        fbb encodedPtr = new fbBuilder();
+        std::string errmsg;
+        if (encodeSkyDicts(
+                reinterpret_cast<const char*>(fbPtr->GetBufferPointer()),
+                fbPtr->GetSize(), DICT_COLS, *encodedPtr, errmsg) != 0) {
+            std::cout << errmsg << " aborting." << std::endl;
+            exit(EXIT_FAILURE);
+        }
+        fbPtr->Reset();
+        delete fbPtr;
+        fbPtr = bucketPtr->fb = encodedPtr;
+    }
+
     // -----------------------------------
 
     uint64_t oid = bucketPtr->oid;
@@ -769,6 +896,8 @@ writeToDisk(
     string fname = "skyhook." + data_format
                                         + "." + bucket->table_name
                                         + "." + std::to_string(oid);
+    if (bucket->subpart >= 0)
+        fname += "." + std::to_string(bucket->subpart);
 
     // write to disk as binary bl data.
     int mode = 0600;
@@ -783,6 +912,40 @@ writeToDisk(
     return 0;
 }
 
+/*
+ * Write the partition map of a range partitioned table next to its objects.
+ * It is written to a temp file first and renamed over the previous version,
+ * so the map is replaced atomically and only ever lists subpartitions whose
+ * objects have been written.
+ */
+int
+writePartitionMap(
+    string data_format,
+    string table_name,
+    range_partition_map& partmap) {
+
+    partmap.version++;
+    bufferlist bl;
+    ::encode(partmap, bl);
+
+    string fname = "skyhook." + data_format + "." + table_name + ".partmap";
+    string tmp_fname = fname + ".tmp";
+    int ret = bl.write_file(tmp_fname.c_str(), 0600);
+    if (ret < 0) {
+        std::cout << "writing " << tmp_fname << " failed: "
+                  << strerror(-ret) << std::endl;
+        return ret;
+    }
+    if (::rename(tmp_fname.c_str(), fname.c_str()) < 0) {
+        ret = -errno;
+        std::cout << "renaming " << tmp_fname << " failed: "
+                  << strerror(-ret) << std::endl;
+        return ret;
+    }
+    std::cout << "wrote " << fname << ": " << partmap.toString() << std::endl;
+    return 0;
+}
+
 void
 deleteBucket(
     bucket_t *bucketPtr,
@@ -0,0 +1,414 @@
+// automatically generated by the FlatBuffers compiler, do not modify
+
+
+#ifndef FLATBUFFERS_GENERATED_SKYHOOKPLAN_TABLES_H_
+#define FLATBUFFERS_GENERATED_SKYHOOKPLAN_TABLES_H_
+
+#include "flatbuffers/flatbuffers.h"
+
+namespace Tables {
+
+struct QueryPlan;
+
+struct PlanCol;
+
+struct PlanPred;
+
+struct QueryPlan FLATBUFFERS_FINAL_CLASS : private flatbuffers::Table {
+  enum FlatBuffersVTableOffset FLATBUFFERS_VTABLE_UNDERLYING_TYPE {
+    VT_VERSION = 4,
+    VT_INDEX_READ = 6,
+    VT_DATA_SCHEMA = 8,
+    VT_QUERY_SCHEMA = 10,
+    VT_QUERY_EXPRS = 12,
+    VT_QUERY_PREDS = 14,
+    VT_INDEX_SCHEMA = 16,
+    VT_INDEX_PREDS = 18,
+    VT_INDEX2_SCHEMA = 20,
+    VT_INDEX2_PREDS = 22,
+    VT_QUERY_SORT = 24
+  };
+  int32_t version() const {
+    return GetField<int32_t>(VT_VERSION, 0);
+  }
+  bool index_read() const {
+    return GetField<uint8_t>(VT_INDEX_READ, 0) != 0;
+  }
+  const flatbuffers::Vector<flatbuffers::Offset<Tables::PlanCol>> *data_schema() const {
+    return GetPointer<const flatbuffers::Vector<flatbuffers::Offset<Tables::PlanCol>> *>(VT_DATA_SCHEMA);
+  }
+  const flatbuffers::Vector<flatbuffers::Offset<Tables::PlanCol>> *query_schema() const {
+    return GetPointer<const flatbuffers::Vector<flatbuffers::Offset<Tables::PlanCol>> *>(VT_QUERY_SCHEMA);
+  }
+  const flatbuffers::String *query_exprs() const {
+    return GetPointer<const flatbuffers::String *>(VT_QUERY_EXPRS);
+  }
+  const flatbuffers::Vector<flatbuffers::Offset<Tables::PlanPred>> *query_preds() const {
+    return GetPointer<const flatbuffers::Vector<flatbuffers::Offset<Tables::PlanPred>> *>(VT_QUERY_PREDS);
+  }
+  const flatbuffers::Vector<flatbuffers::Offset<Tables::PlanCol>> *index_schema() const {
+    return GetPointer<const flatbuffers::Vector<flatbuffers::Offset<Tables::PlanCol>> *>(VT_INDEX_SCHEMA);
+  }
+  const flatbuffers::Vector<flatbuffers::Offset<Tables::PlanPred>> *index_preds() const {
+    return GetPointer<const flatbuffers::Vector<flatbuffers::Offset<Tables::PlanPred>> *>(VT_INDEX_PREDS);
+  }
+  const flatbuffers::Vector<flatbuffers::Offset<Tables::PlanCol>> *index2_schema() const {
+    return GetPointer<const flatbuffers::Vector<flatbuffers::Offset<Tables::PlanCol>> *>(VT_INDEX2_SCHEMA);
+  }
+  const flatbuffers::Vector<flatbuffers::Offset<Tables::PlanPred>> *index2_preds() const {
+    return GetPointer<const flatbuffers::Vector<flatbuffers::Offset<Tables::PlanPred>> *>(VT_INDEX2_PREDS);
+  }
+  const flatbuffers::String *query_sort() const {
+    return GetPointer<const flatbuffers::String *>(VT_QUERY_SORT);
+  }
+  bool Verify(flatbuffers::Verifier &verifier) const {
+    return VerifyTableStart(verifier) &&
+           VerifyField<int32_t>(verifier, VT_VERSION) &&
+           VerifyField<uint8_t>(verifier, VT_INDEX_READ) &&
+           VerifyOffset(verifier, VT_DATA_SCHEMA) &&
+           verifier.VerifyVector(data_schema()) &&
+           verifier.VerifyVectorOfTables(data_schema()) &&
+           VerifyOffset(verifier, VT_QUERY_SCHEMA) &&
+           verifier.VerifyVector(query_schema()) &&
+           verifier.VerifyVectorOfTables(query_schema()) &&
+           VerifyOffset(verifier, VT_QUERY_EXPRS) &&
+           verifier.VerifyString(query_exprs()) &&
+           VerifyOffset(verifier, VT_QUERY_PREDS) &&
+           verifier.VerifyVector(query_preds()) &&
+           verifier.VerifyVectorOfTables(query_preds()) &&
+           VerifyOffset(verifier, VT_INDEX_SCHEMA) &&
+           verifier.VerifyVector(index_schema()) &&
+           verifier.VerifyVectorOfTables(index_schema()) &&
+           VerifyOffset(verifier, VT_INDEX_PREDS) &&
+           verifier.VerifyVector(index_preds()) &&
+           verifier.VerifyVectorOfTables(index_preds()) &&
+           VerifyOffset(verifier, VT_INDEX2_SCHEMA) &&
+           verifier.VerifyVector(index2_schema()) &&
+           verifier.VerifyVectorOfTables(index2_schema()) &&
+           VerifyOffset(verifier, VT_INDEX2_PREDS) &&
+           verifier.VerifyVector(index2_preds()) &&
+           verifier.VerifyVectorOfTables(index2_preds()) &&
+           VerifyOffset(verifier, VT_QUERY_SORT) &&
+           verifier.VerifyString(query_sort()) &&
+           verifier.EndTable();
+  }
+};
+
+struct QueryPlanBuilder {
+  flatbuffers::FlatBufferBuilder &fbb_;
+  flatbuffers::uoffset_t start_;
+  void add_version(int32_t version) {
+    fbb_.AddElement<int32_t>(QueryPlan::VT_VERSION, version, 0);
+  }
+  void add_index_read(bool index_read) {
+    fbb_.AddElement<uint8_t>(QueryPlan::VT_INDEX_READ, static_cast<uint8_t>(index_read), 0);
+  }
+  void add_data_schema(flatbuffers::Offset<flatbuffers::Vector<flatbuffers::Offset<Tables::PlanCol>>> data_schema) {
+    fbb_.AddOffset(QueryPlan::VT_DATA_SCHEMA, data_schema);
+  }
+  void add_query_schema(flatbuffers::Offset<flatbuffers::Vector<flatbuffers::Offset<Tables::PlanCol>>> query_schema) {
+    fbb_.AddOffset(QueryPlan::VT_QUERY_SCHEMA, query_schema);
+  }
+  void add_query_exprs(flatbuffers::Offset<flatbuffers::String> query_exprs) {
+    fbb_.AddOffset(QueryPlan::VT_QUERY_EXPRS, query_exprs);
+  }
+  void add_query_preds(flatbuffers::Offset<flatbuffers::Vector<flatbuffers::Offset<Tables::PlanPred>>> query_preds) {
+    fbb_.AddOffset(QueryPlan::VT_QUERY_PREDS, query_preds);
+  }
+  void add_index_schema(flatbuffers::Offset<flatbuffers::Vector<flatbuffers::Offset<Tables::PlanCol>>> index_schema) {
+    fbb_.AddOffset(QueryPlan::VT_INDEX_SCHEMA, index_schema);
+  }
+  void add_index_preds(flatbuffers::Offset<flatbuffers::Vector<flatbuffers::Offset<Tables::PlanPred>>> index_preds) {
+    fbb_.AddOffset(QueryPlan::VT_INDEX_PREDS, index_preds);
+  }
+  void add_index2_schema(flatbuffers::Offset<flatbuffers::Vector<flatbuffers::Offset<Tables::PlanCol>>> index2_schema) {
+    fbb_.AddOffset(QueryPlan::VT_INDEX2_SCHEMA, index2_schema);
+  }
+  void add_index2_preds(flatbuffers::Offset<flatbuffers::Vector<flatbuffers::Offset<Tables::PlanPred>>> index2_preds) {
+    fbb_.AddOffset(QueryPlan::VT_INDEX2_PREDS, index2_preds);
+  }
+  void add_query_sort(flatbuffers::Offset<flatbuffers::String> query_sort) {
+    fbb_.AddOffset(QueryPlan::VT_QUERY_SORT, query_sort);
+  }
+  explicit QueryPlanBuilder(flatbuffers::FlatBufferBuilder &_fbb)
+        : fbb_(_fbb) {
+    start_ = fbb_.StartTable();
+  }
+  QueryPlanBuilder &operator=(const QueryPlanBuilder &);
+  flatbuffers::Offset<QueryPlan> Finish() {
+    const auto end = fbb_.EndTable(start_);
+    auto o = flatbuffers::Offset<QueryPlan>(end);
+    return o;
+  }
+};
+
+inline flatbuffers::Offset<QueryPlan> CreateQueryPlan(
+    flatbuffers::FlatBufferBuilder &_fbb,
+    int32_t version = 0,
+    bool index_read = false,
+    flatbuffers::Offset<flatbuffers::Vector<flatbuffers::Offset<Tables::PlanCol>>> data_schema = 0,
+    flatbuffers::Offset<flatbuffers::Vector<flatbuffers::Offset<Tables::PlanCol>>> query_schema = 0,
+    flatbuffers::Offset<flatbuffers::String> query_exprs = 0,
+    flatbuffers::Offset<flatbuffers::Vector<flatbuffers::Offset<Tables::PlanPred>>> query_preds = 0,
+    flatbuffers::Offset<flatbuffers::Vector<flatbuffers::Offset<Tables::PlanCol>>> index_schema = 0,
+    flatbuffers::Offset<flatbuffers::Vector<flatbuffers::Offset<Tables::PlanPred>>> index_preds = 0,
+    flatbuffers::Offset<flatbuffers::Vector<flatbuffers::Offset<Tables::PlanCol>>> index2_schema = 0,
+    flatbuffers::Offset<flatbuffers::Vector<flatbuffers::Offset<Tables::PlanPred>>> index2_preds = 0,
+    flatbuffers::Offset<flatbuffers::String> query_sort = 0) {
+  QueryPlanBuilder builder_(_fbb);
+  builder_.add_query_sort(query_sort);
+  builder_.add_index2_preds(index2_preds);
+  builder_.add_index2_schema(index2_schema);
+  builder_.add_index_preds(index_preds);
+  builder_.add_index_schema(index_schema);
+  builder_.add_query_preds(query_preds);
+  builder_.add_query_exprs(query_exprs);
+  builder_.add_query_schema(query_schema);
+  builder_.add_data_schema(data_schema);
+  builder_.add_version(version);
+  builder_.add_index_read(index_read);
+  return builder_.Finish();
+}
+
+inline flatbuffers::Offset<QueryPlan> CreateQueryPlanDirect(
+    flatbuffers::FlatBufferBuilder &_fbb,
+    int32_t version = 0,
+    bool index_read = false,
+    const std::vector<flatbuffers::Offset<Tables::PlanCol>> *data_schema = nullptr,
+    const std::vector<flatbuffers::Offset<Tables::PlanCol>> *query_schema = nullptr,
+    const char *query_exprs = nullptr,
+    const std::vector<flatbuffers::Offset<Tables::PlanPred>> *query_preds = nullptr,
+    const std::vector<flatbuffers::Offset<Tables::PlanCol>> *index_schema = nullptr,
+    const std::vector<flatbuffers::Offset<Tables::PlanPred>> *index_preds = nullptr,
+    const std::vector<flatbuffers::Offset<Tables::PlanCol>> *index2_schema = nullptr,
+    const std::vector<flatbuffers::Offset<Tables::PlanPred>> *index2_preds = nullptr,
+    const char *query_sort = nullptr) {
+  auto data_schema__ = data_schema ? _fbb.CreateVector<flatbuffers::Offset<Tables::PlanCol>>(*data_schema) : 0;
+  auto query_schema__ = query_schema ? _fbb.CreateVector<flatbuffers::Offset<Tables::PlanCol>>(*query_schema) : 0;
+  auto query_exprs__ = query_exprs ? _fbb.CreateString(query_exprs) : 0;
+  auto query_preds__ = query_preds ? _fbb.CreateVector<flatbuffers::Offset<Tables::PlanPred>>(*query_preds) : 0;
+  auto index_schema__ = index_schema ? _fbb.CreateVector<flatbuffers::Offset<Tables::PlanCol>>(*index_schema) : 0;
+  auto index_preds__ = index_preds ? _fbb.CreateVector<flatbuffers::Offset<Tables::PlanPred>>(*index_preds) : 0;
+  auto index2_schema__ = index2_schema ? _fbb.CreateVector<flatbuffers::Offset<Tables::PlanCol>>(*index2_schema) : 0;
+  auto index2_preds__ = index2_preds ? _fbb.CreateVector<flatbuffers::Offset<Tables::PlanPred>>(*index2_preds) : 0;
+  auto query_sort__ = query_sort ? _fbb.CreateString(query_sort) : 0;
+  return Tables::CreateQueryPlan(
+      _fbb,
+      version,
+      index_read,
+      data_schema__,
+      query_schema__,
+      query_exprs__,
+      query_preds__,
+      index_schema__,
+      index_preds__,
+      index2_schema__,
+      index2_preds__,
+      query_sort__);
+}
+
+struct PlanCol FLATBUFFERS_FINAL_CLASS : private flatbuffers::Table {
+  enum FlatBuffersVTableOffset FLATBUFFERS_VTABLE_UNDERLYING_TYPE {
+    VT_IDX = 4,
+    VT_TYPE = 6,
+    VT_IS_KEY = 8,
+    VT_NULLABLE = 10,
+    VT_NAME = 12
+  };
+  int32_t idx() const {
+    return GetField<int32_t>(VT_IDX, 0);
+  }
+  int32_t type() const {
+    return GetField<int32_t>(VT_TYPE, 0);
+  }
+  bool is_key() const {
+    return GetField<uint8_t>(VT_IS_KEY, 0) != 0;
+  }
+  bool nullable() const {
+    return GetField<uint8_t>(VT_NULLABLE, 0) != 0;
+  }
+  const flatbuffers::String *name() const {
+    return GetPointer<const flatbuffers::String *>(VT_NAME);
+  }
+  bool Verify(flatbuffers::Verifier &verifier) const {
+    return VerifyTableStart(verifier) &&
+           VerifyField<int32_t>(verifier, VT_IDX) &&
+           VerifyField<int32_t>(verifier, VT_TYPE) &&
+           VerifyField<uint8_t>(verifier, VT_IS_KEY) &&
+           VerifyField<uint8_t>(verifier, VT_NULLABLE) &&
+           VerifyOffset(verifier, VT_NAME) &&
+           verifier.VerifyString(name()) &&
+           verifier.EndTable();
+  }
+};
+
+struct PlanColBuilder {
+  flatbuffers::FlatBufferBuilder &fbb_;
+  flatbuffers::uoffset_t start_;
+  void add_idx(int32_t idx) {
+    fbb_.AddElement<int32_t>(PlanCol::VT_IDX, idx, 0);
+  }
+  void add_type(int32_t type) {
+    fbb_.AddElement<int32_t>(PlanCol::VT_TYPE, type, 0);
+  }
+  void add_is_key(bool is_key) {
+    fbb_.AddElement<uint8_t>(PlanCol::VT_IS_KEY, static_cast<uint8_t>(is_key), 0);
+  }
+  void add_nullable(bool nullable) {
+    fbb_.AddElement<uint8_t>(PlanCol::VT_NULLABLE, static_cast<uint8_t>(nullable), 0);
+  }
+  void add_name(flatbuffers::Offset<flatbuffers::String> name) {
+    fbb_.AddOffset(PlanCol::VT_NAME, name);
+  }
+  explicit PlanColBuilder(flatbuffers::FlatBufferBuilder &_fbb)
+        : fbb_(_fbb) {
+    start_ = fbb_.StartTable();
+  }
+  PlanColBuilder &operator=(const PlanColBuilder &);
+  flatbuffers::Offset<PlanCol> Finish() {
+    const auto end = fbb_.EndTable(start_);
+    auto o = flatbuffers::Offset<PlanCol>(end);
+    return o;
+  }
+};
+
+inline flatbuffers::Offset<PlanCol> CreatePlanCol(
+    flatbuffers::FlatBufferBuilder &_fbb,
+    int32_t idx = 0,
+    int32_t type = 0,
+    bool is_key = false,
+    bool nullable = false,
+    flatbuffers::Offset<flatbuffers::String> name = 0) {
+  PlanColBuilder builder_(_fbb);
+  builder_.add_name(name);
+  builder_.add_type(type);
+  builder_.add_idx(idx);
+  builder_.add_nullable(nullable);
+  builder_.add_is_key(is_key);
+  return builder_.Finish();
+}
+
+inline flatbuffers::Offset<PlanCol> CreatePlanColDirect(
+    flatbuffers::FlatBufferBuilder &_fbb,
+    int32_t idx = 0,
+    int32_t type = 0,
+    bool is_key = false,
+    bool nullable = false,
+    const char *name = nullptr) {
+  auto name__ = name ? _fbb.CreateString(name) : 0;
+  return Tables::CreatePlanCol(
+      _fbb,
+      idx,
+      type,
+      is_key,
+      nullable,
+      name__);
+}
+
+struct PlanPred FLATBUFFERS_FINAL_CLASS : private flatbuffers::Table {
+  enum FlatBuffersVTableOffset FLATBUFFERS_VTABLE_UNDERLYING_TYPE {
+    VT_COL_IDX = 4,
+    VT_OP = 6,
+    VT_VAL = 8
+  };
+  int32_t col_idx() const {
+    return GetField<int32_t>(VT_COL_IDX, 0);
+  }
+  int32_t op() const {
+    return GetField<int32_t>(VT_OP, 0);
+  }
+  const flatbuffers::String *val() const {
+    return GetPointer<const flatbuffers::String *>(VT_VAL);
+  }
+  bool Verify(flatbuffers::Verifier &verifier) const {
+    return VerifyTableStart(verifier) &&
+           VerifyField<int32_t>(verifier, VT_COL_IDX) &&
+           VerifyField<int32_t>(verifier, VT_OP) &&
+           VerifyOffset(verifier, VT_VAL) &&
+           verifier.VerifyString(val()) &&
+           verifier.EndTable();
+  }
+};
+
+struct PlanPredBuilder {
+  flatbuffers::FlatBufferBuilder &fbb_;
+  flatbuffers::uoffset_t start_;
+  void add_col_idx(int32_t col_idx) {
+    fbb_.AddElement<int32_t>(PlanPred::VT_COL_IDX, col_idx, 0);
+  }
+  void add_op(int32_t op) {
+    fbb_.AddElement<int32_t>(PlanPred::VT_OP, op, 0);
+  }
+  void add_val(flatbuffers::Offset<flatbuffers::String> val) {
+    fbb_.AddOffset(PlanPred::VT_VAL, val);
+  }
+  explicit PlanPredBuilder(flatbuffers::FlatBufferBuilder &_fbb)
+        : fbb_(_fbb) {
+    start_ = fbb_.StartTable();
+  }
+  PlanPredBuilder &operator=(const PlanPredBuilder &);
+  flatbuffers::Offset<PlanPred> Finish() {
+    const auto end = fbb_.EndTable(start_);
+    auto o = flatbuffers::Offset<PlanPred>(end);
+    return o;
+  }
+};
+
+inline flatbuffers::Offset<PlanPred> CreatePlanPred(
+    flatbuffers::FlatBufferBuilder &_fbb,
+    int32_t col_idx = 0,
+    int32_t op = 0,
+    flatbuffers::Offset<flatbuffers::String> val = 0) {
+  PlanPredBuilder builder_(_fbb);
+  builder_.add_val(val);
+  builder_.add_op(op);
+  builder_.add_col_idx(col_idx);
+  return builder_.Finish();
+}
+
+inline flatbuffers::Offset<PlanPred> CreatePlanPredDirect(
+    flatbuffers::FlatBufferBuilder &_fbb,
+    int32_t col_idx = 0,
+    int32_t op = 0,
+    const char *val = nullptr) {
+  auto val__ = val ? _fbb.CreateString(val) : 0;
+  return Tables::CreatePlanPred(
+      _fbb,
+      col_idx,
+      op,
+      val__);
+}
+
+inline const Tables::QueryPlan *GetQueryPlan(const void *buf) {
+  return flatbuffers::GetRoot<Tables::QueryPlan>(buf);
+}
+
+inline const Tables::QueryPlan *GetSizePrefixedQueryPlan(const void *buf) {
+  return flatbuffers::GetSizePrefixedRoot<Tables::QueryPlan>(buf);
+}
+
+inline bool VerifyQueryPlanBuffer(
+    flatbuffers::Verifier &verifier) {
+  return verifier.VerifyBuffer<Tables::QueryPlan>(nullptr);
+}
+
+inline bool VerifySizePrefixedQueryPlanBuffer(
+    flatbuffers::Verifier &verifier) {
+  return verifier.VerifySizePrefixedBuffer<Tables::QueryPlan>(nullptr);
+}
+
+inline void FinishQueryPlanBuffer(
+    flatbuffers::FlatBufferBuilder &fbb,
+    flatbuffers::Offset<Tables::QueryPlan> root) {
+  fbb.Finish(root);
+}
+
+inline void FinishSizePrefixedQueryPlanBuffer(
+    flatbuffers::FlatBufferBuilder &fbb,
+    flatbuffers::Offset<Tables::QueryPlan> root) {
+  fbb.FinishSizePrefixed(root);
+}
+
+}  // namespace Tables
+
+#endif  // FLATBUFFERS_GENERATED_SKYHOOKPLAN_TABLES_H_
@@ -24,7 +24,8 @@ struct Table FLATBUFFERS_FINAL_CLASS : private flatbuffers::Table {
     VT_TABLE_NAME = 16,
     VT_DELETE_VECTOR = 18,
     VT_ROWS = 20,
-    VT_NROWS = 22
+    VT_NROWS = 22,
+    VT_DICTS = 24
   };
   int32_t data_format_type() const {
     return GetField<int32_t>(VT_DATA_FORMAT_TYPE, 0);
@@ -56,6 +57,12 @@ struct Table FLATBUFFERS_FINAL_CLASS : private flatbuffers::Table {
   uint32_t nrows() const {
     return GetField<uint32_t>(VT_NROWS, 0);
   }
+  const flatbuffers::Vector<uint8_t> *dicts() const {
+    return GetPointer<const flatbuffers::Vector<uint8_t> *>(VT_DICTS);
+  }
+  flexbuffers::Reference dicts_flexbuffer_root() const {
+    return flexbuffers::GetRoot(dicts()->Data(), dicts()->size());
+  }
   bool Verify(flatbuffers::Verifier &verifier) const {
     return VerifyTableStart(verifier) &&
            VerifyField<int32_t>(verifier, VT_DATA_FORMAT_TYPE) &&
@@ -74,6 +81,8 @@ struct Table FLATBUFFERS_FINAL_CLASS : private flatbuffers::Table {
            verifier.VerifyVector(rows()) &&
            verifier.VerifyVectorOfTables(rows()) &&
            VerifyField<uint32_t>(verifier, VT_NROWS) &&
+           VerifyOffset(verifier, VT_DICTS) &&
+           verifier.VerifyVector(dicts()) &&
            verifier.EndTable();
   }
 };
@@ -111,6 +120,9 @@ struct TableBuilder {
   void add_nrows(uint32_t nrows) {
     fbb_.AddElement<uint32_t>(Table::VT_NROWS, nrows, 0);
   }
+  void add_dicts(flatbuffers::Offset<flatbuffers::Vector<uint8_t>> dicts) {
+    fbb_.AddOffset(Table::VT_DICTS, dicts);
+  }
   explicit TableBuilder(flatbuffers::FlatBufferBuilder &_fbb)
         : fbb_(_fbb) {
     start_ = fbb_.StartTable();
@@ -134,8 +146,10 @@ inline flatbuffers::Offset<Table> CreateTable(
     flatbuffers::Offset<flatbuffers::String> table_name = 0,
     flatbuffers::Offset<flatbuffers::Vector<uint8_t>> delete_vector = 0,
     flatbuffers::Offset<flatbuffers::Vector<flatbuffers::Offset<Tables::Record>>> rows = 0,
-    uint32_t nrows = 0) {
+    uint32_t nrows = 0,
+    flatbuffers::Offset<flatbuffers::Vector<uint8_t>> dicts = 0) {
   TableBuilder builder_(_fbb);
+  builder_.add_dicts(dicts);
   builder_.add_nrows(nrows);
   builder_.add_rows(rows);
   builder_.add_delete_vector(delete_vector);
@@ -160,12 +174,14 @@ inline flatbuffers::Offset<Table> CreateTableDirect(
     const char *table_name = nullptr,
     const std::vector<uint8_t> *delete_vector = nullptr,
     const std::vector<flatbuffers::Offset<Tables::Record>> *rows = nullptr,
-    uint32_t nrows = 0) {
+    uint32_t nrows = 0,
+    const std::vector<uint8_t> *dicts = nullptr) {
   auto data_schema__ = data_schema ? _fbb.CreateString(data_schema) : 0;
   auto db_schema__ = db_schema ? _fbb.CreateString(db_schema) : 0;
   auto table_name__ = table_name ? _fbb.CreateString(table_name) : 0;
   auto delete_vector__ = delete_vector ? _fbb.CreateVector<uint8_t>(*delete_vector) : 0;
   auto rows__ = rows ? _fbb.CreateVector<flatbuffers::Offset<Tables::Record>>(*rows) : 0;
+  auto dicts__ = dicts ? _fbb.CreateVector<uint8_t>(*dicts) : 0;
   return Tables::CreateTable(
       _fbb,
       data_format_type,
@@ -177,7 +193,8 @@ inline flatbuffers::Offset<Table> CreateTableDirect(
       table_name__,
       delete_vector__,
       rows__,
-      nrows);
+      nrows,
+      dicts__);
 }
 
 struct Record FLATBUFFERS_FINAL_CLASS : private flatbuffers::Table {
@@ -3693,6 +3693,12 @@ std::vector<Option> get_global_options() {
     .set_safe()
     .set_description("Cache writes by default (unless hinted NOCACHE or WONTNEED)"),
 
+    Option("bluestore_cache_scan_resistant", Option::TYPE_BOOL, Option::LEVEL_ADVANCED)
+    .set_default(true)
+    .set_safe()
+    .set_description("Cache reads hinted SEQUENTIAL at the cold end of the cache")
+    .set_long_description("Buffers read with the FADVISE_SEQUENTIAL hint (and not WILLNEED) are inserted at the cold end of the cache and hits on cached buffers are not promoted, so one large scan does not evict the working set."),
+
     Option("bluestore_debug_misc", Option::TYPE_BOOL, Option::LEVEL_DEV)
     .set_default(false)
     .set_description(""),
@@ -108,6 +108,9 @@
 /* PMEM conditional compilation */
 #cmakedefine HAVE_PMEM
 
+/* WebAssembly UDFs conditional compilation */
+#cmakedefine HAVE_WASMTIME
+
 /* Defined if LevelDB supports bloom filters */
 #cmakedefine HAVE_LEVELDB_FILTER_POLICY
 
@@ -204,6 +204,13 @@ int cls_get_request_origin(cls_method_context_t hctx, entity_inst_t *origin)
   return 0;
 }
 
+int cls_get_oid(cls_method_context_t hctx, string *oid)
+{
+  PrimaryLogPG::OpContext **pctx = static_cast<PrimaryLogPG::OpContext **>(hctx);
+  *oid = (*pctx)->obs->oi.soid.oid.name;
+  return 0;
+}
+
 int cls_cxx_create(cls_method_context_t hctx, bool exclusive)
 {
   PrimaryLogPG::OpContext **pctx = (PrimaryLogPG::OpContext **)hctx;
@@ -162,6 +162,7 @@ extern uint64_t cls_current_version(cls_method_context_t hctx);
 extern int cls_current_subop_num(cls_method_context_t hctx);
 extern uint64_t cls_get_features(cls_method_context_t hctx);
 extern uint64_t cls_get_client_features(cls_method_context_t hctx);
+extern int cls_get_oid(cls_method_context_t hctx, string *oid);
 
 /* helpers */
 extern void cls_cxx_subop_version(cls_method_context_t hctx, string *s);
@@ -1358,7 +1358,8 @@ void BlueStore::BufferSpace::read(
   uint32_t offset,
   uint32_t length,
   BlueStore::ready_regions_t& res,
-  interval_set<uint32_t>& res_intervals)
+  interval_set<uint32_t>& res_intervals,
+  bool touch)
 {
   res.clear();
   res_intervals.clear();
@@ -1380,7 +1381,7 @@ void BlueStore::BufferSpace::read(
 	  res_intervals.insert(offset, l);
 	  offset += l;
 	  length -= l;
-	  if (!b->is_writing()) {
+	  if (touch && !b->is_writing()) {
 	    cache->_touch_buffer(b);
 	  }
 	  continue;
@@ -1393,7 +1394,7 @@ void BlueStore::BufferSpace::read(
 	  offset += gap;
 	  length -= gap;
         }
-        if (!b->is_writing()) {
+        if (touch && !b->is_writing()) {
 	  cache->_touch_buffer(b);
         }
         if (b->length > length) {
@@ -6519,6 +6520,13 @@ int BlueStore::_do_read(
     buffered = true;
   }
 
+  // scan resistant admission: sequential reads are cached at the cold end
+  // and do not promote the buffers they hit, so a large scan evicts its own
+  // data first instead of the working set.
+  bool scan = cct->_conf->bluestore_cache_scan_resistant &&
+    (op_flags & CEPH_OSD_OP_FLAG_FADVISE_SEQUENTIAL) &&
+    (op_flags & CEPH_OSD_OP_FLAG_FADVISE_WILLNEED) == 0;
+
   if (offset + length > o->onode.size) {
     length = o->onode.size - offset;
   }
@@ -6555,7 +6563,8 @@ int BlueStore::_do_read(
     ready_regions_t cache_res;
     interval_set<uint32_t> cache_interval;
     bptr->shared_blob->bc.read(
-      bptr->shared_blob->get_cache(), b_off, b_len, cache_res, cache_interval);
+      bptr->shared_blob->get_cache(), b_off, b_len, cache_res, cache_interval,
+      !scan);
     dout(20) << __func__ << "  blob " << *bptr << std::hex
 	     << " need 0x" << b_off << "~" << b_len
 	     << " cache has 0x" << cache_interval
@@ -6712,7 +6721,7 @@ int BlueStore::_do_read(
 	return r;
       if (buffered) {
 	bptr->shared_blob->bc.did_read(bptr->shared_blob->get_cache(), 0,
-				       raw_bl);
+				       raw_bl, scan ? 0 : 1);
       }
       for (auto& i : b2r_it->second) {
 	ready_regions[i.logical_offset].substr_of(
@@ -6726,7 +6735,7 @@ int BlueStore::_do_read(
 	}
 	if (buffered) {
 	  bptr->shared_blob->bc.did_read(bptr->shared_blob->get_cache(),
-					 reg.r_off, reg.bl);
+					 reg.r_off, reg.bl, scan ? 0 : 1);
 	}
 
 	// prune and keep result
@@ -10,6 +10,8 @@
 
 
 #include <fstream>
+#include <unistd.h>
+#include <arrow/io/file.h>
 #include "query.h"
 #include "../cls/tabular/cls_tabular_utils.h"
 
@@ -53,6 +55,8 @@ int qop_index_type;
 int qop_index2_type;
 int qop_index_plan_type;
 int qop_index_batch_size;
+int qop_pushback_max_inflight;
+double qop_pushback_max_cpu;
 int qop_result_format;   // SkyFormatType enum
 std::string qop_db_schema_name;
 std::string qop_table_name;
@@ -61,8 +65,17 @@ std::string qop_query_schema;
 std::string qop_index_schema;
 std::string qop_index2_schema;
 std::string qop_query_preds;
+std::string qop_query_exprs;
 std::string qop_index_preds;
 std::string qop_index2_preds;
+std::string qop_semijoin_col;
+semijoin_filter qop_semijoin;
+std::string qop_query_sort;
+int qop_sample_type;
+double qop_sample_fraction;
+uint64_t qop_sample_seed;
+wasm_udf qop_wasm;
+std::string qop_plan;
 
 // build index op params for flatbufs
 bool idx_op_idx_unique;
@@ -71,6 +84,7 @@ int idx_op_batch_size;
 int idx_op_idx_type;
 std::string idx_op_idx_schema;
 std::string idx_op_text_delims;
+std::string idx_op_include_schema;
 
 // transform op params
 int trans_op_format_type;
@@ -100,12 +114,22 @@ Tables::schema_vec sky_qry_schema;
 Tables::schema_vec sky_idx_schema;
 Tables::schema_vec sky_idx2_schema;
 Tables::predicate_vec sky_qry_preds;
+Tables::expr_vec sky_qry_exprs;
+Tables::sort_vec sky_sort_keys;
 Tables::predicate_vec sky_idx_preds;
 Tables::predicate_vec sky_idx2_preds;
+Tables::PredicateBase* sky_semijoin_pred;
+
+// semi-join build
+static std::mutex semijoin_lock;
+std::string semijoin_build_col;
+int semijoin_build_type;
+std::unordered_set<std::string> semijoin_build_keys;
 
  // these are all intialized in run-query
 std::atomic<unsigned> result_count;
 std::atomic<unsigned> rows_returned;
+std::atomic<unsigned> pushback_count;
 
 // used for print csv
 std::atomic<bool> print_header;
@@ -281,6 +305,299 @@ static void print_data(const char *dataptr,
     print_lock.unlock();
 }
 
+// add the join keys of a result to the semi-join build, if requested
+static void collect_semijoin_keys(const char *dataptr,
+                                  const size_t datasz,
+                                  const int ds_format)
+{
+    if (semijoin_build_col.empty())
+        return;
+
+    std::string errmsg;
+    int key_type = 0;
+    std::unordered_set<std::string> keys;
+    int ret = Tables::semiJoinCollectKeys(dataptr, datasz, ds_format,
+                                          semijoin_build_col, key_type,
+                                          keys, errmsg);
+    if (ret != 0) {
+        std::cerr << "ERROR: query.cc: semiJoinCollectKeys: " << errmsg
+                  << "\n ERR=" << ret << std::endl;
+        assert(Tables::TablesErrCodes::ECLIENTSIDE_PROCESSING_FAILURE==0);
+    }
+    std::lock_guard<std::mutex> l(semijoin_lock);
+    semijoin_build_type = key_type;
+    semijoin_build_keys.insert(keys.begin(), keys.end());
+}
+
+// SFT_ARROW output, the result tables of all objs are written as the record
+// batches of a single arrow ipc stream on stdout, see write_arrow_stream.
+static std::shared_ptr<arrow::io::FileOutputStream> arrow_stream_out;
+static std::shared_ptr<arrow::ipc::RecordBatchWriter> arrow_stream_writer;
+
+// the stream schema metadata, i.e., the skyhook metadata of the first table
+// minus the per obj fields (num_rows), which would be wrong for all others.
+static std::shared_ptr<const arrow::KeyValueMetadata> arrow_stream_metadata;
+
+static std::shared_ptr<const arrow::KeyValueMetadata>
+arrow_stream_schema_metadata(const std::shared_ptr<arrow::Table>& table)
+{
+    std::shared_ptr<arrow::KeyValueMetadata> metadata(
+        new arrow::KeyValueMetadata);
+    auto obj_metadata = table->schema()->metadata();
+    if (!obj_metadata)
+        return metadata;
+    for (int64_t i = 0; i < obj_metadata->size(); i++) {
+        if (obj_metadata->key(i) != ToString(METADATA_NUM_ROWS))
+            metadata->Append(obj_metadata->key(i), obj_metadata->value(i));
+    }
+    return metadata;
+}
+
+// the tables are decoded/converted by each worker in parallel, only the
+// writing of their batches to the stream is serialized by print_lock.
+static void write_arrow_stream(const std::shared_ptr<arrow::Table>& table)
+{
+    if (quiet)
+        return;
+
+    std::lock_guard<std::mutex> l(print_lock);
+    if (row_counter >= row_limit)
+        return;
+
+    // zero-copy slice to the row limit
+    std::shared_ptr<arrow::Table> t = table;
+    if (t->num_rows() > row_limit - row_counter)
+        t = t->Slice(0, row_limit - row_counter);
+
+    arrow::Status st;
+    if (!arrow_stream_metadata)
+        arrow_stream_metadata = arrow_stream_schema_metadata(t);
+    t = t->ReplaceSchemaMetadata(arrow_stream_metadata);
+    if (!arrow_stream_writer) {
+        std::cout.flush();
+        auto out = arrow::io::FileOutputStream::Open(STDOUT_FILENO);
+        if (!out.ok()) {
+            std::cerr << "ERROR: query.cc: opening arrow stream: "
+                      << out.status().ToString() << std::endl;
+            assert(Tables::TablesErrCodes::ECLIENTSIDE_PROCESSING_FAILURE==0);
+        }
+        arrow_stream_out = out.ValueOrDie();
+        st = arrow::ipc::RecordBatchStreamWriter::Open(arrow_stream_out.get(),
+                                                       t->schema(),
+                                                       &arrow_stream_writer);
+    }
+    if (st.ok())
+        st = arrow_stream_writer->WriteTable(*t);
+    if (!st.ok()) {
+        std::cerr << "ERROR: query.cc: writing arrow stream: "
+                  << st.ToString() << std::endl;
+        assert(Tables::TablesErrCodes::ECLIENTSIDE_PROCESSING_FAILURE==0);
+    }
+    row_counter += t->num_rows();
+    print_header = false;
+}
+
+// write a result blob to the arrow stream, its arrow tables are used
+// in place and flatbuf rows are converted here by the calling worker.
+static void write_arrow_stream(const char *dataptr,
+                               const size_t datasz,
+                               const int ds_format)
+{
+    if (quiet)
+        return;
+
+    std::shared_ptr<arrow::Table> table;
+    std::string errmsg;
+    int ret = 0;
+    switch (ds_format) {
+        case SFT_ARROW:
+            ret = Tables::extract_arrow_from_string(&table, dataptr, datasz);
+            break;
+        case SFT_FLATBUF_FLEX_ROW: {
+            Tables::sky_root root = Tables::getSkyRoot(dataptr, datasz,
+                                                       ds_format);
+            Tables::schema_vec sc = Tables::schemaFromString(root.data_schema);
+            ret = Tables::transform_fb_to_arrow(dataptr, datasz, sc, errmsg,
+                                                &table);
+            break;
+        }
+        default:
+            std::cerr << "Print format " << ds_format << ": "
+                      << "SFT_ARROW output not implemented" << std::endl;
+            assert (Tables::SkyOutputBinaryNotImplemented==0);
+    }
+    if (ret != 0) {
+        std::cerr << "ERROR: query.cc: write_arrow_stream: " << errmsg
+                  << "\n ERR=" << ret << std::endl;
+        assert(Tables::TablesErrCodes::ECLIENTSIDE_PROCESSING_FAILURE==0);
+    }
+    write_arrow_stream(table);
+}
+
+// end the arrow stream after all objs are done, if any batches were written
+void finish_arrow_stream()
+{
+    std::lock_guard<std::mutex> l(print_lock);
+    if (arrow_stream_writer)
+        arrow_stream_writer->Close();
+}
+
+// ORDER BY: the result of each obj is sorted, by the cls or else by the
+// client processing in the worker, and is kept as a run until all objs are
+// done, then the runs are merged into the output, see finish_sort_merge.
+static std::mutex sort_runs_lock;
+static std::vector<std::shared_ptr<arrow::Table>> sort_runs;
+static const uint32_t SORT_MERGE_BATCH_ROWS = 8192;
+
+static void add_sort_run(const std::shared_ptr<arrow::Table>& table)
+{
+    if (table->num_rows() == 0)
+        return;
+    std::lock_guard<std::mutex> l(sort_runs_lock);
+    sort_runs.push_back(table);
+}
+
+// the runs outlive the result bufferlist, so arrow blobs are copied and
+// flatbuf rows converted to arrow here by the calling worker.
+static void add_sort_run(const char *dataptr,
+                         const size_t datasz,
+                         const int ds_format)
+{
+    std::shared_ptr<arrow::Table> table;
+    std::string errmsg;
+    int ret = 0;
+    switch (ds_format) {
+        case SFT_ARROW: {
+            auto buffer = arrow::Buffer::FromString(
+                std::string(dataptr, datasz));
+            ret = Tables::extract_arrow_from_buffer(&table, buffer);
+            break;
+        }
+        case SFT_FLATBUF_FLEX_ROW: {
+            Tables::sky_root root = Tables::getSkyRoot(dataptr, datasz,
+                                                       ds_format);
+            if (root.nrows == 0)
+                return;
+            Tables::schema_vec sc = Tables::schemaFromString(root.data_schema);
+            ret = Tables::transform_fb_to_arrow(dataptr, datasz, sc, errmsg,
+                                                &table);
+            break;
+        }
+        default:
+            std::cerr << "Print format " << ds_format << ": "
+                      << "ORDER BY not implemented" << std::endl;
+            assert (Tables::TablesErrCodes::SkyFormatTypeNotRecognized==0);
+    }
+    if (ret != 0) {
+        std::cerr << "ERROR: query.cc: add_sort_run: " << errmsg
+                  << "\n ERR=" << ret << std::endl;
+        assert(Tables::TablesErrCodes::ECLIENTSIDE_PROCESSING_FAILURE==0);
+    }
+    add_sort_run(table);
+}
+
+// k-way merge of the sorted runs of all objs, output in merged batches up
+// to the row limit.
+void finish_sort_merge()
+{
+    std::string errmsg;
+    int ret = Tables::mergeArrowSortRuns(
+        sort_runs,
+        sky_qry_schema,
+        sky_sort_keys,
+        SORT_MERGE_BATCH_ROWS,
+        [](std::shared_ptr<arrow::Table> batch) {
+            if (skyhook_output_format == SFT_ARROW) {
+                write_arrow_stream(batch);
+            }
+            else {
+                std::shared_ptr<arrow::Buffer> buffer;
+                Tables::convert_arrow_to_buffer(batch, &buffer);
+                print_data(reinterpret_cast<const char*>(buffer->data()),
+                           buffer->size(), SFT_ARROW);
+            }
+            return row_counter < row_limit;
+        },
+        errmsg);
+    if (ret != 0) {
+        std::cerr << "ERROR: query.cc: mergeArrowSortRuns: " << errmsg
+                  << "\n ERR=" << ret << std::endl;
+        assert(Tables::TablesErrCodes::ECLIENTSIDE_PROCESSING_FAILURE==0);
+    }
+    sort_runs.clear();
+}
+
+// GLOBAL AGGS: each obj returns a partial agg row per fb it processed (sketch
+// aggs as their sketch state), which are merged here as the results arrive.
+// The single final agg row is output after all objs are done, see
+// finish_agg_merge.
+static std::mutex agg_merge_lock;
+static Tables::predicate_vec agg_merge_preds;  // merge state only
+
+// a copy of the query's agg preds, starting from no rows merged
+static Tables::predicate_vec& get_agg_merge_preds()
+{
+    using namespace Tables;
+    if (agg_merge_preds.empty()) {
+        schema_vec expr_schema = schemaWithExprs(sky_tbl_schema,
+                                                 sky_qry_exprs);
+        predicate_vec aggs;
+        for (auto p : sky_qry_preds) {
+            if (p->isGlobalAgg())
+                aggs.push_back(p);
+        }
+        agg_merge_preds = predsFromString(expr_schema,
+                                          predsToString(aggs, expr_schema));
+    }
+    return agg_merge_preds;
+}
+
+static void add_agg_partial(const char *dataptr,
+                            const size_t datasz,
+                            const int ds_format)
+{
+    std::string errmsg;
+    std::lock_guard<std::mutex> l(agg_merge_lock);
+    int ret = Tables::mergeAggRows(get_agg_merge_preds(), dataptr, datasz,
+                                   ds_format, errmsg);
+    if (ret != 0) {
+        std::cerr << "ERROR: query.cc: mergeAggRows: " << errmsg
+                  << "\n ERR=" << ret << std::endl;
+        assert(Tables::TablesErrCodes::ECLIENTSIDE_PROCESSING_FAILURE==0);
+    }
+}
+
+static void add_agg_partial(const std::shared_ptr<arrow::Table>& table)
+{
+    std::string errmsg;
+    std::lock_guard<std::mutex> l(agg_merge_lock);
+    int ret = Tables::mergeAggTable(get_agg_merge_preds(), table, errmsg);
+    if (ret != 0) {
+        std::cerr << "ERROR: query.cc: mergeAggTable: " << errmsg
+                  << "\n ERR=" << ret << std::endl;
+        assert(Tables::TablesErrCodes::ECLIENTSIDE_PROCESSING_FAILURE==0);
+    }
+}
+
+// output the final agg row, also when no obj returned any rows.
+void finish_agg_merge()
+{
+    std::lock_guard<std::mutex> l(agg_merge_lock);
+    flatbuffers::FlatBufferBuilder flatbldr(1024);
+    Tables::buildAggResultFb(flatbldr, get_agg_merge_preds(), sky_qry_schema,
+                             qop_db_schema_name, qop_table_name);
+    const char* dataptr =
+        reinterpret_cast<const char*>(flatbldr.GetBufferPointer());
+    result_count++;
+    if (skyhook_output_format == SFT_ARROW)
+        write_arrow_stream(dataptr, flatbldr.GetSize(), SFT_FLATBUF_FLEX_ROW);
+    else
+        print_data(dataptr, flatbldr.GetSize(), SFT_FLATBUF_FLEX_ROW);
+    for (auto p : agg_merge_preds)
+        delete p;
+    agg_merge_preds.clear();
+}
+
 /* NOTE: This function will be used by python driver for locking  */
 static void print_data(bufferlist out) {
     print_lock.lock();
@@ -412,6 +729,155 @@ void worker_exec_runstats_op(librados::IoCtx *ioctx, stats_op op)
   ioctx->close();
 }
 
+void worker_build_rollup_op(librados::IoCtx *ioctx, rollup_op op)
+{
+  while (true) {
+    work_lock.lock();
+    if (target_objects.empty()) {
+      work_lock.unlock();
+      break;
+    }
+    std::string oid = target_objects.back();
+    target_objects.pop_back();
+    std::cout << "building rollup..." << " name:" << op.name
+              << " oid: " << oid << std::endl;
+    work_lock.unlock();
+
+    ceph::bufferlist inbl, outbl;
+    ::encode(op, inbl);
+    int ret = ioctx->exec(oid, "tabular", "build_rollup_op", inbl, outbl);
+    checkret(ret, 0);
+  }
+  ioctx->close();
+}
+
+/*
+ * Continue partition part of a range partitioned table in a new subpartition,
+ * its current objects being full (see append_op.max_obj_size): append the fbs
+ * to the new object, then add it to the table's partition map. The partition
+ * map updates of this client's workers are serialized.
+ */
+static std::mutex partmap_lock;
+
+static int range_partition_append(librados::IoCtx *ioctx,
+                                  const std::string& prefix,
+                                  int part,
+                                  const append_op& op)
+{
+  std::lock_guard<std::mutex> l(partmap_lock);
+
+  ceph::bufferlist bl;
+  int ret = ioctx->read(prefix + ".partmap", bl, 0, 0);
+  if (ret < 0)
+    return ret;
+
+  range_partition_map partmap;
+  try {
+    ceph::bufferlist::iterator it = bl.begin();
+    ::decode(partmap, it);
+  } catch (const ceph::buffer::error &err) {
+    return -EINVAL;
+  }
+  if (part < 0 or part >= static_cast<int>(partmap.nsubparts.size()))
+    return -EINVAL;
+
+  const std::string oid = prefix + "." + std::to_string(part) + "." +
+                          std::to_string(partmap.nsubparts[part]);
+  std::cout << "appending fbs..." << " bytes:" << op.data.length()
+            << " new subpartition oid: " << oid << std::endl;
+  ceph::bufferlist inbl, outbl;
+  ::encode(op, inbl);
+  ret = ioctx->exec(oid, "tabular", "append_fb_op", inbl, outbl);
+  if (ret < 0)
+    return ret;
+
+  partmap.nsubparts[part]++;
+  partmap.version++;
+  bl.clear();
+  ::encode(partmap, bl);
+  return ioctx->write_full(prefix + ".partmap", bl);
+}
+
+void worker_append_fb_op(librados::IoCtx *ioctx, append_op op,
+                         std::string range_prefix)
+{
+  while (true) {
+    work_lock.lock();
+    if (target_objects.empty()) {
+      work_lock.unlock();
+      break;
+    }
+    std::string oid = target_objects.back();
+    target_objects.pop_back();
+    std::cout << "appending fbs..." << " bytes:" << op.data.length()
+              << " oid: " << oid << std::endl;
+    work_lock.unlock();
+
+    ceph::bufferlist inbl, outbl;
+    ::encode(op, inbl);
+    int ret = ioctx->exec(oid, "tabular", "append_fb_op", inbl, outbl);
+
+    // a full subpartition <range_prefix>.<part>.<subpart>, like the writer
+    // does at its split size the partition continues in a new one.
+    if (ret == -EFBIG and !range_prefix.empty() and
+        oid.compare(0, range_prefix.size() + 1, range_prefix + ".") == 0) {
+      std::string part = oid.substr(range_prefix.size() + 1);
+      size_t dot = part.find('.');
+      if (dot != std::string::npos) {
+        part.resize(dot);
+        ret = range_partition_append(ioctx, range_prefix, std::stoi(part),
+                                     op);
+      }
+    }
+    checkret(ret, 0);
+  }
+  ioctx->close();
+}
+
+/*
+ * The objects of a range partitioned table that may hold rows passing the
+ * query preds, i.e., all subpartitions of the partitions overlapping the
+ * range of the partition col vals allowed by the preds. The table's
+ * partition map is read from the object <oid_prefix>.<table>.partmap, see
+ * range_partition_map.
+ */
+int range_partition_targets(librados::IoCtx& ioctx,
+                            const std::string& oid_prefix,
+                            const std::string& table_name,
+                            Tables::schema_vec& schema,
+                            Tables::predicate_vec& preds,
+                            std::vector<std::string>& oids)
+{
+  const std::string prefix = oid_prefix + "." + table_name;
+  ceph::bufferlist bl;
+  int ret = ioctx.read(prefix + ".partmap", bl, 0, 0);
+  if (ret < 0)
+    return ret;
+
+  range_partition_map partmap;
+  try {
+    ceph::bufferlist::iterator it = bl.begin();
+    ::decode(partmap, it);
+  } catch (const ceph::buffer::error &err) {
+    return -EINVAL;
+  }
+
+  Tables::schema_vec sv = Tables::schemaFromColNames(schema, partmap.col_name);
+  if (sv.size() != 1 or sv[0].type != partmap.col_type)
+    return -EINVAL;
+
+  int64_t lo = INT64_MIN;
+  int64_t hi = INT64_MAX;
+  Tables::predsKeyRange(preds, sv[0].idx, lo, hi);
+
+  oids.clear();
+  for (int i : partmap.partitions(lo, hi)) {
+    for (int j = 0; j < partmap.nsubparts.at(i); j++)
+      oids.push_back(prefix + "." + std::to_string(i) + "." + std::to_string(j));
+  }
+  return 0;
+}
+
 void worker_lock_obj_init_op(librados::IoCtx *ioctx, lockobj_info op)
 {
     std::string oid = op.table_group;
@@ -591,18 +1057,59 @@ void worker_exec_query_op()
         if (debug)
             cout << "DEBUG: query.cc: worker: done with getSkyMeta(&result)." << endl;
 
-        // TODO: add any global aggs here.
         // TODO: check if any predicates or projects remain to be applied.
         bool more_processing = false;
 
         if (!use_cls) {
             // TODO: remove pushed-down preds from sky_qry_preds then we
             // can remove project flag and just check size of preds here.
-            if ((project_cols != PROJECT_DEFAULT) || (sky_qry_preds.size() > 0)) {
+            if ((project_cols != PROJECT_DEFAULT) || (sky_qry_preds.size() > 0) ||
+                !sky_sort_keys.empty()) {
                 more_processing = true;
             }
         }
 
+        // the cls declined to process this obj under osd load and returned
+        // its data as is, along with the preds remaining to be applied here.
+        predicate_vec pushback_preds;
+        bool own_preds = false;
+        if (use_cls and !info.push_back_reason.empty()) {
+            if (debug)
+                cout << "DEBUG: query.cc: worker: cls pushed back processing: "
+                     << info.push_back_reason << endl;
+            schema_vec expr_schema = schemaWithExprs(sky_tbl_schema,
+                                                     sky_qry_exprs);
+            pushback_preds = predsFromString(expr_schema,
+                                             info.push_back_predicates);
+            if (sky_semijoin_pred)
+                addSemiJoinPredicate(pushback_preds, sky_semijoin_pred);
+            if (qop_sample_type == SST_BERNOULLI)
+                addSamplePredicate(pushback_preds,
+                                   new SamplePredicate(qop_sample_fraction,
+                                                       qop_sample_seed));
+            pushback_count++;
+            more_processing = true;
+            own_preds = true;
+        }
+        // agg preds accumulate the rows processed into themselves, so each
+        // worker processing the objs itself uses its own copy of the preds.
+        else if (more_processing and hasAggPreds(sky_qry_preds)) {
+            schema_vec expr_schema = schemaWithExprs(sky_tbl_schema,
+                                                     sky_qry_exprs);
+            predicate_vec qry_preds;
+            for (auto p : sky_qry_preds) {
+                if (p != sky_semijoin_pred)
+                    qry_preds.push_back(p);
+            }
+            pushback_preds = predsFromString(expr_schema,
+                                             predsToString(qry_preds,
+                                                           expr_schema));
+            if (sky_semijoin_pred)
+                addSemiJoinPredicate(pushback_preds, sky_semijoin_pred);
+            own_preds = true;
+        }
+        predicate_vec& preds = own_preds ? pushback_preds : sky_qry_preds;
+
         // nothing left to do here, so we just print results
         if (!more_processing) {
 
@@ -614,16 +1121,55 @@ void worker_exec_query_op()
                 case SFT_FLATBUF_FLEX_ROW:
                 case SFT_ARROW: {
 
+                    if (hasAggPreds(sky_qry_preds)) {
+                        add_agg_partial(fbmeta.blob_data,
+                                        fbmeta.blob_size,
+                                        fbmeta.blob_format);
+                        break;
+                    }
+
+                    // dictionary encoded results are decoded once here,
+                    // the rows are read by val below.
+                    const char* dataptr = fbmeta.blob_data;
+                    size_t datasz = fbmeta.blob_size;
+                    flatbuffers::FlatBufferBuilder decoded;
+                    if (fbmeta.blob_format == SFT_FLATBUF_FLEX_ROW and
+                        hasSkyDicts(dataptr)) {
+                        std::string errmsg;
+                        int ret = decodeSkyDicts(dataptr, datasz, decoded,
+                                                 errmsg);
+                        if (ret != 0) {
+                            std::cerr << "ERROR: query.cc: decodeSkyDicts: "
+                                      << errmsg << "\n ERR=" << ret << endl;
+                            assert(Tables::TablesErrCodes::ECLIENTSIDE_PROCESSING_FAILURE==0);
+                        }
+                        dataptr = reinterpret_cast<const char*>(
+                                    decoded.GetBufferPointer());
+                        datasz = decoded.GetSize();
+                    }
+
                     sky_root root = \
-                        Tables::getSkyRoot(fbmeta.blob_data,
-                                           fbmeta.blob_size,
+                        Tables::getSkyRoot(dataptr,
+                                           datasz,
                                            fbmeta.blob_format);
 
                     result_count += root.nrows;
 
-                    print_data(fbmeta.blob_data,
-                               fbmeta.blob_size,
-                               fbmeta.blob_format);
+                    collect_semijoin_keys(dataptr,
+                                          datasz,
+                                          fbmeta.blob_format);
+                    if (!sky_sort_keys.empty())
+                        add_sort_run(dataptr,
+                                     datasz,
+                                     fbmeta.blob_format);
+                    else if (skyhook_output_format == SFT_ARROW)
+                        write_arrow_stream(dataptr,
+                                           datasz,
+                                           fbmeta.blob_format);
+                    else
+                        print_data(dataptr,
+                                   datasz,
+                                   fbmeta.blob_format);
                     break;
                 }
                 case SFT_FLATBUF_CSV_ROW:
@@ -652,10 +1198,13 @@ void worker_exec_query_op()
                 int ret = processSkyFb(flatbldr,
                                        sky_tbl_schema,
                                        sky_qry_schema,
-                                       sky_qry_preds,
+                                       preds,
                                        fbmeta.blob_data,
                                        fbmeta.blob_size,
-                                       errmsg);
+                                       errmsg,
+                                       std::vector<uint32_t>(),
+                                       sky_qry_exprs,
+                                       sky_sort_keys);
                 if (ret != 0) {
                     std::cerr << "ERROR: query.cc: processSkyFb: "
                               << errmsg << "\n ERR=" << ret
@@ -666,9 +1215,40 @@ void worker_exec_query_op()
                 // TODO: we should be using uint8_t here
                 const char* processed_data = \
                     reinterpret_cast<const char*>(flatbldr.GetBufferPointer());
+                size_t processed_size = flatbldr.GetSize();
+                if (hasAggPreds(sky_qry_preds)) {
+                    add_agg_partial(processed_data, processed_size,
+                                    SFT_FLATBUF_FLEX_ROW);
+                    break;
+                }
+
+                // the preds above were applied to the dict codes, the
+                // projected rows are decoded once here.
+                flatbuffers::FlatBufferBuilder decoded;
+                if (hasSkyDicts(processed_data)) {
+                    ret = decodeSkyDicts(processed_data, processed_size,
+                                         decoded, errmsg);
+                    if (ret != 0) {
+                        std::cerr << "ERROR: query.cc: decodeSkyDicts: "
+                                  << errmsg << "\n ERR=" << ret << endl;
+                        assert(Tables::TablesErrCodes::ECLIENTSIDE_PROCESSING_FAILURE==0);
+                    }
+                    processed_data = reinterpret_cast<const char*>(
+                                        decoded.GetBufferPointer());
+                    processed_size = decoded.GetSize();
+                }
                 sky_root root = getSkyRoot(processed_data, 0);
                 result_count += root.nrows;
-                print_data(processed_data, 0, SFT_FLATBUF_FLEX_ROW);
+                collect_semijoin_keys(processed_data, processed_size,
+                                      SFT_FLATBUF_FLEX_ROW);
+                if (!sky_sort_keys.empty())
+                    add_sort_run(processed_data, processed_size,
+                                 SFT_FLATBUF_FLEX_ROW);
+                else if (skyhook_output_format == SFT_ARROW)
+                    write_arrow_stream(processed_data, processed_size,
+                                       SFT_FLATBUF_FLEX_ROW);
+                else
+                    print_data(processed_data, 0, SFT_FLATBUF_FLEX_ROW);
                 break;
             }
 
@@ -682,23 +1262,51 @@ void worker_exec_query_op()
                               &table,
                               sky_tbl_schema,
                               sky_qry_schema,
-                              sky_qry_preds,
+                              preds,
                               fbmeta.blob_data,
                               fbmeta.blob_size,
-                              errmsg);
+                              errmsg,
+                              std::vector<uint32_t>(),
+                              sky_qry_exprs,
+                              sky_sort_keys);
                 if (ret != 0) {
                     std::cerr << "ERROR: query.cc: processArrowCol: "
                               << errmsg << "\n ERR=" << ret
                               << endl;
                     assert(Tables::TablesErrCodes::ECLIENTSIDE_PROCESSING_FAILURE==0);
                 }
+                else if (hasAggPreds(sky_qry_preds)) {
+                    add_agg_partial(table);
+                }
                 else {
                     std::shared_ptr<arrow::Buffer> buffer;
                     auto schema = table->schema();
                     auto metadata = schema->metadata();
                     result_count += std::stoi(metadata->value(METADATA_NUM_ROWS));
-                    convert_arrow_to_buffer(table, &buffer);
-                    print_data(buffer->ToString().c_str(), buffer->size(), SFT_ARROW);
+
+                    // the processed table is streamed (or kept as a sorted
+                    // run) as is, without serializing it, unless its keys
+                    // are needed.
+                    if (semijoin_build_col.empty() and
+                        (skyhook_output_format == SFT_ARROW or
+                         !sky_sort_keys.empty())) {
+                        if (!sky_sort_keys.empty())
+                            add_sort_run(table);
+                        else
+                            write_arrow_stream(table);
+                    }
+                    else {
+                        convert_arrow_to_buffer(table, &buffer);
+                        const char* bufptr = \
+                            reinterpret_cast<const char*>(buffer->data());
+                        collect_semijoin_keys(bufptr, buffer->size(), SFT_ARROW);
+                        if (!sky_sort_keys.empty())
+                            add_sort_run(table);
+                        else if (skyhook_output_format == SFT_ARROW)
+                            write_arrow_stream(table);
+                        else
+                            print_data(bufptr, buffer->size(), SFT_ARROW);
+                    }
                 }
                 break;
             }
@@ -713,6 +1321,10 @@ void worker_exec_query_op()
                 assert (Tables::TablesErrCodes::SkyFormatTypeNotRecognized==0);
             }
         }
+        for (auto p : pushback_preds) {
+            if (p != sky_semijoin_pred)
+                delete p;
+        }
     }
     else if (query == "example") {
 
@@ -758,19 +1370,13 @@ void worker_exec_query_op()
         using namespace Tables;
 
         // decode our raw results if not empty. cases when it could be empty include:
-        // (1) cls processing returned zero matching data
-        // (2) result was from a non-existing object/oid
-        // (3) result was from an existing object/oid that contained zero data
+        // (1) result was from a non-existing object/oid
+        // (2) result was from an existing object/oid that contained zero data
         if (raw_result.length() >0) {
             ceph::bufferlist::iterator it = raw_result.begin();
             try {
-                if (use_cls) {
-                    ::decode(info, it);     // unpack the cls_info struct
-                    ::decode(result, it);  // unpack the result data bufferlist
-                }
-                else {                          // standard ceph read, no cls info was added.
-                    ::decode(result, it); // unpack the result data bufferlist
-                }
+                ::decode(info, it);     // unpack the cls_info struct
+                ::decode(result, it);  // unpack the result data bufferlist
             }
             catch (ceph::buffer::error&) {
                 std::cerr << "DEBUG: query.cc: worker: failed to decode result data into a bufferlist" << std::endl;
@@ -790,8 +1396,17 @@ void worker_exec_query_op()
             break;
         }
 
-        print_data(result.c_str(), result.length(), SFT_EXAMPLE_FORMAT);
-
+        // the udf vals of a map are a single flatbuf of RID,val rows
+        if (result.length() > 0) {
+            sky_meta fbmeta = getSkyMeta(&result);
+            sky_root root = getSkyRoot(fbmeta.blob_data,
+                                       fbmeta.blob_size,
+                                       fbmeta.blob_format);
+            result_count += root.nrows;
+            print_data(fbmeta.blob_data,
+                       fbmeta.blob_size,
+                       fbmeta.blob_format);
+        }
     }
     else {   // older processing code below
 
@@ -85,6 +85,8 @@ extern int qop_index_type;
 extern int qop_index2_type;
 extern int qop_index_plan_type;
 extern int qop_index_batch_size;
+extern int qop_pushback_max_inflight;
+extern double qop_pushback_max_cpu;
 extern int qop_result_format;  // SkyFormatType enum
 extern std::string qop_db_schema_name;
 extern std::string qop_table_name;
@@ -93,8 +95,17 @@ extern std::string qop_query_schema;
 extern std::string qop_index_schema;
 extern std::string qop_index2_schema;
 extern std::string qop_query_preds;
+extern std::string qop_query_exprs;
 extern std::string qop_index_preds;
 extern std::string qop_index2_preds;
+extern std::string qop_semijoin_col;
+extern semijoin_filter qop_semijoin;
+extern std::string qop_query_sort;
+extern int qop_sample_type;
+extern double qop_sample_fraction;
+extern uint64_t qop_sample_seed;
+extern wasm_udf qop_wasm;
+extern std::string qop_plan;
 
 extern bool idx_op_idx_unique;
 extern bool idx_op_ignore_stopwords;
@@ -102,6 +113,7 @@ extern int idx_op_batch_size;
 extern int idx_op_idx_type;
 extern std::string idx_op_idx_schema;
 extern std::string idx_op_text_delims;
+extern std::string idx_op_include_schema;
 
 // Transform op params
 extern int trans_op_format_type;
@@ -131,11 +143,20 @@ extern Tables::schema_vec sky_qry_schema;
 extern Tables::schema_vec sky_idx_schema;
 extern Tables::schema_vec sky_idx2_schema;
 extern Tables::predicate_vec sky_qry_preds;
+extern Tables::expr_vec sky_qry_exprs;
+extern Tables::sort_vec sky_sort_keys;
 extern Tables::predicate_vec sky_idx_preds;
 extern Tables::predicate_vec sky_idx2_preds;
+extern Tables::PredicateBase* sky_semijoin_pred;  // also in sky_qry_preds
+
+// semi-join build, join keys collected from the results of this query
+extern std::string semijoin_build_col;
+extern int semijoin_build_type;
+extern std::unordered_set<std::string> semijoin_build_keys;
 
 extern std::atomic<unsigned> result_count;
 extern std::atomic<unsigned> rows_returned;
+extern std::atomic<unsigned> pushback_count;  // objs the cls pushed back
 
 // used for print csv
 extern std::atomic<bool> print_header;
@@ -159,8 +180,20 @@ extern bool stop;
 void worker_build_index(librados::IoCtx *ioctx);
 void worker_exec_build_sky_index_op(librados::IoCtx *ioctx, idx_op op);
 void worker_exec_runstats_op(librados::IoCtx *ioctx, stats_op op);
+void worker_build_rollup_op(librados::IoCtx *ioctx, rollup_op op);
+void worker_append_fb_op(librados::IoCtx *ioctx, append_op op,
+                         std::string range_prefix);
 void worker_transform_db_op(librados::IoCtx *ioctx, transform_op op);
 void worker_exec_query_op();  // default worker task for exec_query_op
+void finish_arrow_stream();  // ends SFT_ARROW output
+void finish_sort_merge();  // outputs the merged sorted results
+void finish_agg_merge();  // outputs the merged global agg row
+int range_partition_targets(librados::IoCtx& ioctx,
+                            const std::string& oid_prefix,
+                            const std::string& table_name,
+                            Tables::schema_vec& schema,
+                            Tables::predicate_vec& preds,
+                            std::vector<std::string>& oids);
 void handle_cb(librados::completion_t cb, void *arg);
 void worker_lock_obj_init_op(librados::IoCtx *ioctx, lockobj_info op);
 void worker_lock_obj_free_op(librados::IoCtx *ioctx, lockobj_info op);
@@ -9,6 +9,8 @@
 */
 
 #include <fstream>
+#include <sstream>
+#include <random>
 #include <boost/program_options.hpp>
 #include "query.h"
 
@@ -23,6 +25,7 @@ int main(int argc, char **argv)
   int wthreads;
   bool build_index;
   bool transform_db;
+  bool transform_col_chunks;
   std::string logfile;
   int qdepth;
   std::string direction;
@@ -47,10 +50,32 @@ int main(int argc, char **argv)
   std::string index_schema;
   std::string index2_schema;
   std::string query_preds;
+  std::string query_exprs;
+  std::string query_sort;
   std::string index_preds;
   std::string index2_preds;
   std::string index_cols;
   std::string index2_cols;
+  std::string index_include_cols;
+  int pushback_max_inflight;
+  double pushback_max_cpu;
+  std::string semijoin_col;
+  std::string semijoin_file;
+  std::string semijoin_build_file;
+  std::string sample_method;
+  double sample_pct;
+  uint64_t sample_seed = 0;
+  std::string rollup_create;
+  std::string rollup_group_cols;
+  std::string rollup_aggs;
+  std::string append_fbs_file;
+  uint64_t split_bytes;
+  std::string wasm_udf_file;
+  std::string wasm_udf_kind;
+  std::string wasm_func;
+  std::string wasm_cols;
+  uint64_t wasm_fuel;
+  uint64_t wasm_max_memory;
   bool lock_obj_free;
   bool lock_obj_init;
   bool lock_obj_get;
@@ -60,6 +85,8 @@ int main(int argc, char **argv)
   // set based upon program_options
   int index_type = Tables::SIT_IDX_UNK;
   int index2_type = Tables::SIT_IDX_UNK;
+  int sample_type = Tables::SST_NONE;
+  int wasm_udf_type = Tables::SWU_NONE;
   bool fastpath = false;
   bool idx_unique = false;
   bool header = false;  // print csv header
@@ -73,6 +100,7 @@ int main(int argc, char **argv)
   std::string file_name;
   std::string tree_name;
   int subpartitions;
+  bool range_partitioned;
 
   // final output format type for client consumption
   std::string client_format_str;
@@ -95,7 +123,16 @@ int main(int argc, char **argv)
      << "colname" << Tables::PRED_DELIM_INNER
      << "op" << Tables::PRED_DELIM_INNER
      << "value" << Tables::PRED_DELIM_OUTER
-     << "...>" << ops_help_msg;
+     << "...>" << ops_help_msg
+     << ". For in, not_in, between the values are delimited by '"
+     << Tables::PRED_DELIM_LIST << "', e.g., orderkey" << Tables::PRED_DELIM_INNER
+     << "in" << Tables::PRED_DELIM_INNER << "1" << Tables::PRED_DELIM_LIST
+     << "5" << Tables::PRED_DELIM_LIST << "9"
+     << ". Global aggs are min, max, sum, cnt (the value is the initial val),"
+     << " approx_distinct (HyperLogLog, the value is unused) and"
+     << " approx_quantile (KLL, the value is the quantile in [0,1]), e.g.,"
+     << " extendedprice" << Tables::PRED_DELIM_INNER << "approx_quantile"
+     << Tables::PRED_DELIM_INNER << "0.99";
   std::string select_help_msg = ss.str();
 
   std::string data_schema_format_help_msg("NOTE: schema format is: \"col_num  col_type (as SkyDataType enum)  col_is_key col_is_nullable  col_name; col_num col_type ...;\"");
@@ -113,6 +150,7 @@ int main(int argc, char **argv)
     ("num-objs", po::value<unsigned>(&num_objs)->required(), "num objects")
     ("start-obj", po::value<unsigned>(&start_obj)->default_value(0), "start object (for transform operation")
     ("subpartitions", po::value<int>(&subpartitions)->default_value(-1), "maximum num of subpartitions of object names e.g. obj.243.0 and obj.243.1 is one object that has subpartitions=2")
+    ("range-partitioned", po::bool_switch(&range_partitioned)->default_value(false), "table is range partitioned by the writer (--range_col), query only the objects listed in its partition map that may hold matching rows")
     ("use-cls", po::bool_switch(&use_cls)->default_value(false), "use cls")
     ("quiet,q", po::bool_switch(&quiet)->default_value(false), "quiet")
     ("query", po::value<std::string>(&query)->default_value("flatbuf"), "query name")
@@ -147,15 +185,39 @@ int main(int argc, char **argv)
     ("mem-constrain", po::bool_switch(&mem_constrain)->default_value(false), "Read/process data structs one at a time within object")
     ("index-cols", po::value<std::string>(&index_cols)->default_value(""), project_help_msg.c_str())
     ("index2-cols", po::value<std::string>(&index2_cols)->default_value(""), project_help_msg.c_str())
+    ("index-include-cols", po::value<std::string>(&index_include_cols)->default_value(""), "Cols whose vals are also stored in the index entries (IDX_REC only), queries using only index and include cols are answered from the index")
     ("project", po::value<std::string>(&project_cols)->default_value(Tables::PROJECT_DEFAULT), project_help_msg.c_str())
     ("index-preds", po::value<std::string>(&index_preds)->default_value(""), select_help_msg.c_str())
     ("index2-preds", po::value<std::string>(&index2_preds)->default_value(""), select_help_msg.c_str())
     ("select", po::value<std::string>(&query_preds)->default_value(Tables::SELECT_DEFAULT), select_help_msg.c_str())
+    ("pushback-max-inflight", po::value<int>(&pushback_max_inflight)->default_value(Tables::PUSHBACK_MAX_INFLIGHT_DEFAULT), "cls returns unprocessed data to the client when more query ops are in progress on the osd (0=never)")
+    ("pushback-max-cpu", po::value<double>(&pushback_max_cpu)->default_value(Tables::PUSHBACK_MAX_CPU_DEFAULT), "cls returns unprocessed data to the client when query ops keep more cores busy on the osd (0=never)")
+    ("semijoin-build-col", po::value<std::string>(&semijoin_build_col)->default_value(""), "Semi-join build side, collect the distinct vals of this result col (e.g., of a filtered dimension table) into --semijoin-build-file")
+    ("semijoin-build-file", po::value<std::string>(&semijoin_build_file)->default_value(""), "File to write the semi-join filter to")
+    ("semijoin-col", po::value<std::string>(&semijoin_col)->default_value(""), "Semi-join probe side, only return rows whose val of this col is in the --semijoin-file filter")
+    ("semijoin-file", po::value<std::string>(&semijoin_file)->default_value(""), "Semi-join filter file written by a --semijoin-build-col query")
+    ("expr", po::value<std::string>(&query_exprs)->default_value(""), "Computed cols usable by project/select, e.g., \"disc_price=extendedprice*(1-discount);tax_amt=extendedprice*tax\", or reductions of jagged array cols count/sum/min/max, e.g., \"nmuon=count(muon_pt)\"")
+    ("sample", po::value<std::string>(&sample_method)->default_value(""), "Sampled scan (TABLESAMPLE), \"bernoulli\" keeps each row and \"block\" each fb (not read otherwise) with --sample-pct probability")
+    ("sample-pct", po::value<double>(&sample_pct)->default_value(100), "Percent of the rows/fbs kept by a sampled scan")
+    ("sample-seed", po::value<uint64_t>(&sample_seed), "Seed of a sampled scan, the same seed samples the same rows/fbs (def=random)")
+    ("wasm-udf", po::value<std::string>(&wasm_udf_file)->default_value(""), "WebAssembly module file of a udf run by the cls, a \"filter\" selecting rows of a flatbuf query or a \"map\" computing a val per row with --query wasm")
+    ("wasm-udf-type", po::value<std::string>(&wasm_udf_kind)->default_value("filter"), "Type of the --wasm-udf, filter or map")
+    ("wasm-func", po::value<std::string>(&wasm_func)->default_value(""), "Name of the udf func exported by the --wasm-udf module")
+    ("wasm-cols", po::value<std::string>(&wasm_cols)->default_value(""), "Input cols of the --wasm-udf, e.g., \"muon_pt,muon_eta\"")
+    ("wasm-fuel", po::value<uint64_t>(&wasm_fuel)->default_value(Tables::WASM_UDF_FUEL_DEFAULT), "Max fuel (~wasm instructions) of each udf call on a batch of rows")
+    ("wasm-max-mem", po::value<uint64_t>(&wasm_max_memory)->default_value(Tables::WASM_UDF_MEMORY_DEFAULT), "Max linear memory bytes of the udf module")
+    ("order-by", po::value<std::string>(&query_sort)->default_value(""), "Return the rows sorted by these projected cols, asc unless desc is given, e.g., \"l_shipdate,desc;l_orderkey\"")
     ("index-delims", po::value<std::string>(&text_index_delims)->default_value(""), "Use delim for text indexes (def=whitespace")
     ("index-ignore-stopwords", po::bool_switch(&text_index_ignore_stopwords)->default_value(false), "Ignore stopwords when building text index. (def=false)")
     ("index-plan-type", po::value<int>(&index_plan_type)->default_value(Tables::SIP_IDX_STANDARD), "If 2 indexes, for intersection plan use '2', for union plan use '3' (def='1')")
     ("runstats", po::bool_switch(&runstats)->default_value(false), "Run statistics on the specified table name")
+    ("rollup-create", po::value<std::string>(&rollup_create)->default_value(""), "Build the named rollup of the table in each obj, the --rollup-aggs of the rows per group of --rollup-group-cols vals, kept current by appends and used by agg queries over them")
+    ("rollup-group-cols", po::value<std::string>(&rollup_group_cols)->default_value(""), "Group cols of the --rollup-create rollup, e.g., \"returnflag,linestatus\" (def=none, a single group)")
+    ("rollup-aggs", po::value<std::string>(&rollup_aggs)->default_value(""), "Sum/cnt/min/max aggs of the --rollup-create rollup, e.g., \"quantity,sum,0;quantity,cnt,0\"")
+    ("append-fbs", po::value<std::string>(&append_fbs_file)->default_value(""), "Append the fbs of this file (as written by sky_tabular_flatflex_writer) to each obj, also adding their rows to the obj's rollups of the table")
+    ("split-bytes", po::value<uint64_t>(&split_bytes)->default_value(0), "With --append-fbs on a --range-partitioned table, continue a partition in a new subpartition instead of growing its objects past this size, like the writer's --split_bytes (def=0, no limit)")
     ("transform-format-type", po::value<std::string>(&trans_format_str)->default_value("SFT_FLATBUF_FLEX_ROW"), "Destination format type ")
+    ("transform-col-chunks", po::bool_switch(&transform_col_chunks)->default_value(false), "With --transform-format-type SFT_ARROW, store each col of each row group as a separate extent, so queries only read the cols they use")
     ("verbose", po::bool_switch(&print_verbose)->default_value(false), "Print detailed record metadata.")
     ("header", po::bool_switch(&header)->default_value(false), "Print row header (i.e., row schema")
     ("limit", po::value<long long int>(&row_limit)->default_value(Tables::ROW_LIMIT_DEFAULT), "SQL limit option, limit num_rows of result set")
@@ -171,7 +233,7 @@ int main(int argc, char **argv)
     ("lock-obj-get", po::bool_switch(&lock_obj_get)->default_value(false), "Get table values")
     ("lock-obj-acquire", po::bool_switch(&lock_obj_acquire)->default_value(false), "Get table values")
     ("lock-obj-create", po::bool_switch(&lock_obj_create)->default_value(false), "Create Lock obj")
-    ("client-format", po::value<std::string>(&client_format_str)->default_value("SFT_ANY"), "Data format type to return to client (def=SFT_ANY)")
+    ("client-format", po::value<std::string>(&client_format_str)->default_value("SFT_ANY"), "Data format type to return to client, SFT_ARROW writes a single arrow ipc stream of all results (def=SFT_ANY)")
  ;
 
   po::options_description all_opts("Allowed options");
@@ -323,8 +385,11 @@ int main(int argc, char **argv)
     boost::trim(data_schema);
     boost::trim(index_cols);
     boost::trim(index2_cols);
+    boost::trim(index_include_cols);
     boost::trim(project_cols);
     boost::trim(query_preds);
+    boost::trim(query_exprs);
+    boost::trim(query_sort);
     boost::trim(index_preds);
     boost::trim(index2_preds);
     boost::trim(text_index_delims);
@@ -336,9 +401,14 @@ int main(int argc, char **argv)
     boost::to_upper(table_name);
     boost::to_upper(index_cols);
     boost::to_upper(index2_cols);
+    boost::to_upper(index_include_cols);
     boost::to_upper(project_cols);
     boost::to_upper(trans_format_str);
     boost::to_upper(client_format_str);
+    boost::trim(semijoin_col);
+    boost::trim(semijoin_build_col);
+    boost::to_upper(semijoin_col);
+    boost::to_upper(semijoin_build_col);
 
     // current minimum required info for formulating IO requests.
     assert (!db_schema_name.empty());
@@ -353,6 +423,66 @@ int main(int argc, char **argv)
     if (runstats) {
         assert (use_cls);
     }
+    boost::trim(rollup_create);
+    boost::to_upper(rollup_group_cols);
+    if (!rollup_create.empty()) {
+        assert (use_cls);
+        assert (!rollup_aggs.empty());
+    }
+    if (!append_fbs_file.empty())
+        assert (use_cls);
+    if (split_bytes > 0)
+        assert (!append_fbs_file.empty() and range_partitioned);
+    if (!semijoin_col.empty())
+        assert (!semijoin_file.empty());
+    if (!semijoin_build_col.empty())
+        assert (!semijoin_build_file.empty());
+
+    // verify the sampled scan, block sampling skips reads within the cls.
+    boost::trim(sample_method);
+    boost::to_lower(sample_method);
+    if (!sample_method.empty()) {
+        if (sample_method == "bernoulli")
+            sample_type = SST_BERNOULLI;
+        else if (sample_method == "block")
+            sample_type = SST_BLOCK;
+        assert (sample_type != SST_NONE);
+        assert (sample_pct >= 0 and sample_pct <= 100);
+        if (sample_type == SST_BLOCK)
+            assert (use_cls);
+        if (!vm.count("sample-seed"))
+            sample_seed = std::random_device()();
+    }
+
+    // read the wasm udf module, the cls compiles and runs it.
+    boost::trim(wasm_udf_kind);
+    boost::to_lower(wasm_udf_kind);
+    if (!wasm_udf_file.empty()) {
+        if (wasm_udf_kind == "filter")
+            wasm_udf_type = SWU_FILTER;
+        else if (wasm_udf_kind == "map")
+            wasm_udf_type = SWU_MAP;
+        assert (wasm_udf_type != SWU_NONE);
+        assert (use_cls);
+        assert (!wasm_func.empty() and !wasm_cols.empty());
+        std::ifstream f(wasm_udf_file, std::ios::binary);
+        assert (f.good());
+        std::stringstream ss;
+        ss << f.rdbuf();
+        qop_wasm.type = wasm_udf_type;
+        qop_wasm.module = ss.str();
+        if (qop_wasm.module.size() > Tables::WASM_MODULE_MAX_BYTES) {
+            std::cerr << "Error: --wasm-udf module is over the max "
+                      << Tables::WASM_MODULE_MAX_BYTES << " bytes" << std::endl;
+            assert (qop_wasm.module.size() <= Tables::WASM_MODULE_MAX_BYTES);
+        }
+        qop_wasm.func = wasm_func;
+        qop_wasm.cols = wasm_cols;
+        qop_wasm.fuel = wasm_fuel;
+        qop_wasm.max_memory = wasm_max_memory;
+        if (query == "flatbuf")
+            assert (wasm_udf_type == SWU_FILTER);
+    }
 
     // set and validate the desired format types
     trans_format_type = sky_format_type_from_string(trans_format_str);
@@ -373,6 +503,7 @@ int main(int argc, char **argv)
         case SFT_CSV:
         case SFT_PG_BINARY:
         case SFT_PYARROW_BINARY:
+        case SFT_ARROW:
         { // these are supported final output formats for the client
             break;
         }
@@ -389,9 +520,54 @@ int main(int argc, char **argv)
     // verify and set the index schema
     sky_idx_schema = schemaFromColNames(sky_tbl_schema, index_cols);
     sky_idx2_schema = schemaFromColNames(sky_tbl_schema, index2_cols);
+    schema_vec sky_idx_include_schema = \
+        schemaFromColNames(sky_tbl_schema, index_include_cols);
+
+    // verify and set the computed cols, these may be referenced by name
+    // in the query predicates and projection as if they were table cols.
+    {
+        std::string errmsg;
+        int ret = exprsFromString(sky_tbl_schema, query_exprs,
+                                  sky_qry_exprs, errmsg);
+        if (ret) {
+            std::cerr << "Error: " << errmsg << " (errcode=" << ret << ")"
+                      << std::endl;
+            exit(1);
+        }
+    }
+    schema_vec sky_expr_schema = schemaWithExprs(sky_tbl_schema,
+                                                 sky_qry_exprs);
 
     // verify and set the query predicates
-    sky_qry_preds = predsFromString(sky_tbl_schema, query_preds);
+    sky_qry_preds = predsFromString(sky_expr_schema, query_preds);
+
+    // verify and set the semi-join filter, applied as a query predicate
+    // over the join key col, see semiJoinPredicate.
+    if (!semijoin_col.empty()) {
+        bufferlist bl;
+        std::string err;
+        if (bl.read_file(semijoin_file.c_str(), &err) < 0) {
+            std::cerr << "Error: reading semi-join file " << semijoin_file
+                      << ": " << err << std::endl;
+            exit(1);
+        }
+        try {
+            bufferlist::iterator it = bl.begin();
+            ::decode(qop_semijoin, it);
+        } catch (const buffer::error &e) {
+            std::cerr << "Error: decoding semi-join file " << semijoin_file
+                      << std::endl;
+            exit(1);
+        }
+        schema_vec sv = schemaFromColNames(sky_tbl_schema, semijoin_col);
+        if (sv.size() != 1) {
+            std::cerr << "Error: semi-join col=" << semijoin_col
+                      << " not present in schema." << std::endl;
+            assert (TablesErrCodes::RequestedColNotPresent == 0);
+        }
+        sky_semijoin_pred = semiJoinPredicate(sv.at(0), qop_semijoin);
+        qop_semijoin_col = semijoin_col;
+    }
 
     if (debug) {
         std::cout << "DEBUG: run-query: query predicates:\n";
@@ -403,6 +579,27 @@ int main(int argc, char **argv)
     sky_idx_preds = predsFromString(sky_tbl_schema, index_preds);
     sky_idx2_preds = predsFromString(sky_tbl_schema, index2_preds);
 
+    // target only the partitions that may hold matching rows
+    if (range_partitioned) {
+        int ret = range_partition_targets(ioctx, oid_prefix, table_name,
+                                          sky_tbl_schema, sky_qry_preds,
+                                          target_objects);
+        if (ret < 0) {
+            std::cerr << "Error: reading partition map of table "
+                      << table_name << ": " << strerror(-ret) << std::endl;
+            exit(1);
+        }
+        if (direction == "fwd")
+            std::reverse(std::begin(target_objects),
+                         std::end(target_objects));
+        else if (direction == "rnd")
+            std::random_shuffle(std::begin(target_objects),
+                                std::end(target_objects));
+        if (debug)
+            std::cout << "DEBUG: run-query: range partitions targeted "
+                      << target_objects.size() << " objects" << std::endl;
+    }
+
     // verify and set the query schema, check for select *
     if (project_cols == PROJECT_DEFAULT) {
         for(auto it=sky_tbl_schema.begin(); it!=sky_tbl_schema.end(); ++it) {
@@ -413,7 +610,10 @@ int main(int argc, char **argv)
         // if project all cols and there are no selection preds, set fastpath
         if (sky_qry_preds.size() == 0 and
             sky_idx_preds.size() == 0 and
-            sky_idx2_preds.size() == 0) {
+            sky_idx2_preds.size() == 0 and
+            !sky_semijoin_pred and
+            sample_type != SST_BERNOULLI and
+            wasm_udf_type != SWU_FILTER) {
                 fastpath = true;
         }
     } else {
@@ -425,7 +625,8 @@ int main(int argc, char **argv)
                     // build col info for agg pred type, append to query schema
                     std::string op_str = skyOpTypeToString(p->opType());
                     int agg_idx = AGG_COL_IDX.at(op_str);
-                    int agg_val_type = p->colType();
+                    int agg_val_type = aggResultType(p->opType(),
+                                                     p->colType());
                     bool is_key = false;
                     bool nullable = false;
                     std::string agg_name = skyOpTypeToString(p->opType());
@@ -435,10 +636,18 @@ int main(int argc, char **argv)
                 }
             }
         } else {
-            sky_qry_schema = schemaFromColNames(sky_tbl_schema, project_cols);
+            sky_qry_schema = schemaFromColNames(sky_expr_schema, project_cols);
         }
     }
 
+    // verify and set the order by keys, the cls sorts the result of each obj
+    // and the client merges them, see finish_sort_merge.  aggs are merged
+    // into a single row (see finish_agg_merge) so are not sorted.
+    if (!query_sort.empty() and !hasAggPreds(sky_qry_preds)) {
+        sky_sort_keys = sortKeysFromString(sky_qry_schema, query_sort);
+        fastpath = false;
+    }
+
     // set the index type
     if (!index_cols.empty()) {
         if (index_cols == RID_INDEX) { // const value for colname=RID
@@ -477,7 +686,15 @@ int main(int argc, char **argv)
     // verify index predicates: op type supported and if all index
     // predicate cols are in the specified index.
     if (index_read) {
-        if (sky_idx_preds.size() > MAX_INDEX_COLS)
+        // txt index keys are the raw words, not the IDX_REC key encoding
+        // that index preds are looked up by, so txt indexes are not read.
+        if (index_type == SIT_IDX_TXT or index2_type == SIT_IDX_TXT) {
+            cerr << "Index reads are not supported for text indexes"
+                 << std::endl;
+            assert (SkyIndexUnsupportedOpType == 0);
+        }
+        // at most a lower and an upper bound pred per index col
+        if (sky_idx_preds.size() > 2 * MAX_INDEX_COLS)
             assert (BuildSkyIndexUnsupportedNumCols == 0);
         for (unsigned int i = 0; i < sky_idx_preds.size(); i++) {
             switch (sky_idx_preds[i]->opType()) {
@@ -486,9 +703,11 @@ int main(int argc, char **argv)
                 case SOT_eq:
                 case SOT_leq:
                 case SOT_geq:
+                case SOT_in:
+                case SOT_between:
                     break;  // all ok, supported index ops
                 default:
-                    cerr << "Only >, <, =, <=, >= predicates currently "
+                    cerr << "Only >, <, =, <=, >=, in, between predicates currently "
                          << "supported for Skyhook indexes" << std::endl;
                     assert (SkyIndexUnsupportedOpType == 0);
             }
@@ -503,7 +722,8 @@ int main(int argc, char **argv)
                 assert (SkyIndexColNotPresent == 0);
             }
         }
-        if (sky_idx2_preds.size() > MAX_INDEX_COLS)
+        // at most a lower and an upper bound pred per index col
+        if (sky_idx2_preds.size() > 2 * MAX_INDEX_COLS)
             assert (BuildSkyIndexUnsupportedNumCols == 0);
         for (unsigned int i = 0; i < sky_idx2_preds.size(); i++) {
             switch (sky_idx2_preds[i]->opType()) {
@@ -512,9 +732,11 @@ int main(int argc, char **argv)
                 case SOT_eq:
                 case SOT_leq:
                 case SOT_geq:
+                case SOT_in:
+                case SOT_between:
                     break;  // all ok, supported index ops
                 default:
-                    cerr << "Only >, <, =, <=, >= predicates currently "
+                    cerr << "Only >, <, =, <=, >=, in, between predicates currently "
                          << "supported for Skyhook indexes" << std::endl;
                     assert (SkyIndexUnsupportedOpType == 0);
             }
@@ -532,7 +754,7 @@ int main(int argc, char **argv)
 
     }
 
-    // verify index types are integral/string and check col idx bounds
+    // verify index types are scalar types and check col idx bounds
     if (index_create) {
         if (index_type == SIT_IDX_TXT) {
             if (sky_idx_schema.size() > 1)  // enforce TXT indexes are 1 column
@@ -540,6 +762,11 @@ int main(int argc, char **argv)
         }
         if (sky_idx_schema.size() > MAX_INDEX_COLS)
             assert (BuildSkyIndexUnsupportedNumCols == 0);
+        if (!sky_idx_include_schema.empty() and index_type != SIT_IDX_REC) {
+            cerr << "Include cols are only supported for IDX_REC indexes"
+                 << std::endl;
+            assert (BuildSkyIndexUnsupportedColType == 0);
+        }
         for (auto it = sky_idx_schema.begin();
                   it != sky_idx_schema.end(); ++it) {
             col_info ci = *it;
@@ -548,7 +775,8 @@ int main(int argc, char **argv)
                     assert (BuildSkyIndexUnsupportedColType == 0);
             }
             else if (index_type == SIT_IDX_REC or index_type == SIT_IDX_RID) {
-                if (ci.type < SDT_INT8 or ci.type > SDT_BOOL)
+                // any scalar type, see appendIndexKeyData
+                if (ci.type < SDT_INT8 or ci.type > SDT_STRING)
                     assert (BuildSkyIndexUnsupportedColType == 0);
             }
             if (ci.idx <= AGG_COL_LAST and ci.idx != RID_COL_INDEX)
@@ -585,24 +813,59 @@ int main(int argc, char **argv)
     qop_index2_type = index2_type;
     qop_index_plan_type = index_plan_type;
     qop_index_batch_size = index_batch_size;
+    qop_pushback_max_inflight = pushback_max_inflight;
+    qop_pushback_max_cpu = pushback_max_cpu;
     qop_db_schema_name = db_schema_name;
     qop_table_name = table_name;
     qop_data_schema = schemaToString(sky_tbl_schema);
     qop_query_schema = schemaToString(sky_qry_schema);
     qop_index_schema = schemaToString(sky_idx_schema);
     qop_index2_schema = schemaToString(sky_idx2_schema);
-    qop_query_preds = predsToString(sky_qry_preds, sky_tbl_schema);
+    qop_query_preds = predsToString(sky_qry_preds, sky_expr_schema);
+    qop_query_exprs = exprsToString(sky_qry_exprs);
+    qop_query_sort = sortKeysToString(sky_sort_keys);
+    qop_sample_type = sample_type;
+    qop_sample_fraction = sample_pct / 100;
+    qop_sample_seed = sample_seed;
     qop_index_preds = predsToString(sky_idx_preds, sky_tbl_schema);
     qop_index2_preds = predsToString(sky_idx2_preds, sky_tbl_schema);
     qop_result_format = skyhook_output_format;
+
+    // the schemas and preds are sent to the cls as one binary plan
+    {
+        std::string errmsg;
+        int ret = encodeQueryPlan(qop_data_schema, qop_query_schema,
+                                  qop_query_exprs, qop_query_preds,
+                                  qop_index_read, qop_index_schema,
+                                  qop_index_preds, qop_index2_schema,
+                                  qop_index2_preds, qop_query_sort,
+                                  qop_plan, errmsg);
+        if (ret) {
+            std::cerr << "Error: encoding query plan: " << errmsg
+                      << " (errcode=" << ret << ")" << std::endl;
+            exit(1);
+        }
+    }
     idx_op_idx_unique = idx_unique;
     idx_op_batch_size = index_batch_size;
     idx_op_idx_type = index_type;
     idx_op_idx_schema = schemaToString(sky_idx_schema);
     idx_op_ignore_stopwords = text_index_ignore_stopwords;
     idx_op_text_delims = text_index_delims;
+    idx_op_include_schema = schemaToString(sky_idx_include_schema);
     trans_op_format_type = trans_format_type;
 
+    // the semi-join pred is sent as qop_semijoin, but is applied by the
+    // client along with the other query preds when the cls does not.
+    if (sky_semijoin_pred)
+        addSemiJoinPredicate(sky_qry_preds, sky_semijoin_pred);
+
+    // likewise the Bernoulli sample pred, see SamplePredicate.
+    if (sample_type == SST_BERNOULLI)
+        addSamplePredicate(sky_qry_preds,
+                           new SamplePredicate(qop_sample_fraction,
+                                               qop_sample_seed));
+
     if (debug) {
         if (query == "flatbuf" || query == "fastpath") {
             cout << "DEBUG: run-query: qop_fastpath=" << qop_fastpath << endl;
@@ -618,6 +881,7 @@ int main(int argc, char **argv)
             cout << "DEBUG: run-query: qop_index_schema=\n" << qop_index_schema << endl;
             cout << "DEBUG: run-query: qop_index2_schema=\n" << qop_index2_schema << endl;
             cout << "DEBUG: run-query: qop_query_preds=" << qop_query_preds << endl;
+            cout << "DEBUG: run-query: qop_query_sort=" << qop_query_sort << endl;
             cout << "DEBUG: run-query: qop_index_preds=" << qop_index_preds << endl;
             cout << "DEBUG: run-query: qop_index2_preds=" << qop_index2_preds << endl;
             cout << "DEBUG: run-query: qop_result_format=" << qop_result_format << endl;
@@ -629,6 +893,7 @@ int main(int argc, char **argv)
             cout << "DEBUG: run-query: idx_op_idx_schema=" << idx_op_idx_schema << endl;
             cout << "DEBUG: run-query: idx_op_ignore_stopwords=" << idx_op_ignore_stopwords << endl;
             cout << "DEBUG: run-query: idx_op_text_delims=" << idx_op_text_delims << endl;
+            cout << "DEBUG: run-query: idx_op_include_schema=" << idx_op_include_schema << endl;
         }
     }
 
@@ -664,26 +929,18 @@ int main(int argc, char **argv)
 
   } else if (query == "wasm") {
 
-    /*
-      add input error checking here as needed, and
-      convert user input to query.h defined values,
-      and any other setup needed before encoding the function params
-    */
-
-    assert (example_counter >= 0);
-    assert (example_function_id >= 0);
+    // a map udf over all the rows of each obj, see wasm_query_op
+    boost::trim(data_schema);
+    assert (!data_schema.empty());
+    assert (use_cls);
+    assert (qop_wasm.type == Tables::SWU_MAP);
 
     // set client-local output value from user provided boost options
     print_header = header;
 
-    // total result counter from all objs that count using our cls function.
-    result_count = example_counter * num_objs;
-    cout << "Expect total count " << result_count
-         << " from all objects executing example cls method." << std::endl;
-
-    // set example op params from user provided boost options
-    expl_func_counter = example_counter;
-    expl_func_id = example_function_id;
+    qop_table_name = table_name;
+    qop_data_schema = data_schema;
+    result_count = 0;
 
   }
   else {
@@ -703,7 +960,8 @@ int main(int argc, char **argv)
               idx_op_batch_size,
               idx_op_idx_type,
               idx_op_idx_schema,
-              idx_op_text_delims);
+              idx_op_text_delims,
+              idx_op_include_schema);
 
     // kick off the workers
     std::vector<std::thread> threads;
@@ -747,12 +1005,80 @@ int main(int argc, char **argv)
     return 0;
   }
 
+  // for ROLLUP CREATE job
+  // launch rollup builds on given table here.
+  if (query == "flatbuf" && !rollup_create.empty()) {
+
+    // create rollup_op for workers
+    rollup_op op(debug, qop_db_schema_name, qop_table_name, qop_data_schema,
+                 rollup_create, rollup_group_cols, rollup_aggs);
+
+    if (debug)
+        cout << "DEBUG: rollup op=" << op.toString() << endl;
+
+    // kick off the workers
+    std::vector<std::thread> threads;
+    for (int i = 0; i < wthreads; i++) {
+      auto ioctx = new librados::IoCtx;
+      int ret = cluster.ioctx_create(pool.c_str(), *ioctx);
+      checkret(ret, 0);
+      threads.push_back(std::thread(worker_build_rollup_op, ioctx, op));
+    }
+
+    for (auto& thread : threads) {
+      thread.join();
+    }
+
+    return 0;
+  }
+
+  // for APPEND FBS job
+  // append the fbs of the file to each obj via the cls, keeping the obj's
+  // rollups current (a plain rados write leaves them stale).
+  if (query == "flatbuf" && !append_fbs_file.empty()) {
+
+    std::ifstream f(append_fbs_file, std::ios::binary);
+    assert (f.good());
+    std::stringstream ss;
+    ss << f.rdbuf();
+    ceph::bufferlist data;
+    data.append(ss.str());
+
+    append_op op(debug, qop_db_schema_name, qop_table_name, data,
+                 split_bytes);
+
+    // the prefix of the subpartition oids, to split the full ones
+    std::string range_prefix;
+    if (range_partitioned)
+        range_prefix = oid_prefix + "." + table_name;
+
+    if (debug)
+        cout << "DEBUG: append op=" << op.toString() << endl;
+
+    // kick off the workers
+    std::vector<std::thread> threads;
+    for (int i = 0; i < wthreads; i++) {
+      auto ioctx = new librados::IoCtx;
+      int ret = cluster.ioctx_create(pool.c_str(), *ioctx);
+      checkret(ret, 0);
+      threads.push_back(std::thread(worker_append_fb_op, ioctx, op,
+                                    range_prefix));
+    }
+
+    for (auto& thread : threads) {
+      thread.join();
+    }
+
+    return 0;
+  }
+
   // for TRANSFORM OBJECT FORMAT job
   // launch transform operation here.
   if (query == "flatbuf" && transform_db) {
 
     // create idx_op for workers
-    transform_op op(qop_table_name, qop_query_schema, trans_op_format_type);
+    transform_op op(qop_table_name, qop_query_schema, trans_op_format_type,
+                    transform_col_chunks);
 
     if (debug)
         cout << "DEBUG: transform op=" << op.toString() << endl;
@@ -831,6 +1157,7 @@ int main(int argc, char **argv)
   // this is the main method for read() queries
   result_count = 0;
   rows_returned = 0;
+  pushback_count = 0;
   outstanding_ios = 0;
   stop = false;
 
@@ -874,16 +1201,20 @@ int main(int argc, char **argv)
         op.index2_type = qop_index2_type;
         op.index_plan_type = qop_index_plan_type;
         op.index_batch_size = qop_index_batch_size;
+        op.pushback_max_inflight = qop_pushback_max_inflight;
+        op.pushback_max_cpu = qop_pushback_max_cpu;
         op.result_format = qop_result_format;
         op.db_schema_name = qop_db_schema_name;
         op.table_name = qop_table_name;
-        op.data_schema = qop_data_schema;
-        op.query_schema = qop_query_schema;
-        op.index_schema = qop_index_schema;
-        op.index2_schema = qop_index2_schema;
-        op.query_preds = qop_query_preds;
-        op.index_preds = qop_index_preds;
-        op.index2_preds = qop_index2_preds;
+        op.plan = qop_plan;  // schemas, exprs, preds and sort keys
+        op.semijoin_col = qop_semijoin_col;
+        op.semijoin = qop_semijoin;
+        op.sample_type = qop_sample_type;
+        op.sample_fraction = qop_sample_fraction;
+        op.sample_seed = qop_sample_seed;
+        if (qop_sample_type == Tables::SST_BLOCK)  // objs sample their fbs independently
+            op.sample_seed ^= Tables::skyHashString(oid.data(), oid.size());
+        op.wasm = qop_wasm;
         ceph::bufferlist inbl;
         ::encode(op, inbl);
 
@@ -979,15 +1310,15 @@ int main(int argc, char **argv)
         if (use_cls) {  // execute a cls read method
 
             // setup and encode our op params here.
-            wasm_inbl_sample_op op;
-            op.message = "This is an wasm op";
-            op.instructions = "Wasm instructions";
-            op.counter = example_counter;
-            op.func_id = example_function_id;
+            wasm_udf_op op;
+            op.debug = debug;
+            op.table_name = qop_table_name;
+            op.data_schema = qop_data_schema;
+            op.udf = qop_wasm;
             ceph::bufferlist inbl;
             ::encode(op, inbl);
 
-            // execute our example method on the object, passing in our op.
+            // run the udf on the object, passing in our op.
             int ret = ioctx.aio_exec(oid, s->c, "tabular",
                                      "wasm_query_op", inbl, &s->bl);
             checkret(ret, 0);
@@ -1041,6 +1372,14 @@ int main(int argc, char **argv)
   // to those corresponding clients.
   if (stop) {
 
+    // merge and output the sorted results of all objs
+    if (!sky_sort_keys.empty())
+        finish_sort_merge();
+
+    // merge and output the global aggs of all objs
+    if (Tables::hasAggPreds(sky_qry_preds))
+        finish_agg_merge();
+
     // after all objs done processing, if postgres binary fstream,
     // add final trailer to output.
 
@@ -1066,12 +1405,40 @@ int main(int argc, char **argv)
         // force any remaining output to the pipe
         std::cout << std::flush;
     }
+
+    if (skyhook_output_format == SkyFormatType::SFT_ARROW) {
+
+        // write the end of stream marker after the last record batch
+        finish_arrow_stream();
+    }
+  }
+
+  // write the semi-join filter built from the result join keys
+  if (!semijoin_build_col.empty()) {
+    semijoin_filter f = Tables::semiJoinBuildFilter(semijoin_build_type,
+                                                    semijoin_build_keys);
+    bufferlist bl;
+    ::encode(f, bl);
+    int ret = bl.write_file(semijoin_build_file.c_str());
+    if (ret < 0) {
+        std::cerr << "Error: writing semi-join file " << semijoin_build_file
+                  << ": " << strerror(-ret) << std::endl;
+        return 1;
+    }
+    if (debug)
+        cout << "DEBUG: run-query: " << f.toString() << endl;
   }
 
   // only report status messages during quiet operation
   // since otherwise we are printing as csv data to std out
   if (quiet) {
     std::cout << "total result row count: " << result_count << std::endl;
+    if (pushback_count > 0)
+        std::cout << "objects processed by client under osd load: "
+                  << pushback_count << std::endl;
+    if (!semijoin_build_col.empty())
+        std::cout << "semi-join build keys: "
+                  << semijoin_build_keys.size() << std::endl;
   }
 
 
@@ -0,0 +1,440 @@
+/*
+* Copyright (C) 2018 The Regents of the University of California
+* All Rights Reserved
+*
+* This library can redistribute it and/or modify under the terms
+* of the GNU Lesser General Public License Version 2.1 as published
+* by the Free Software Foundation.
+*
+*/
+
+/*
+ * In-process harness for the tabular cls methods.
+ *
+ * Runs libcls_tabular.so against the in-memory object store of the
+ * librados test stub (real object data, omap and xattr semantics, no OSD or
+ * network), so cls code paths can be profiled and timed in a single process.
+ * The stub loads all libcls_*.so found in $CEPH_LIB.
+ *
+ * Loads num_objs objects of lineitem rows from SampleData in both layouts:
+ *   - fixed width 141 byte rows, used by test_query_op (queries a-f)
+ *   - SFT_FLATBUF_FLEX_ROW fbmeta sequences, used by exec_query_op
+ * then replays every "bin/run-query" example from progly/queries.txt against
+ * both, repeat times per object, and reports per-op latency distributions
+ * along with the cls-reported read and eval times.
+ *
+ * Example:
+ *   CEPH_LIB=lib bin/ceph_bench_cls_tabular \
+ *     --schema-file src/cls/tabular/SampleData/lineitem.schema.txt \
+ *     --data-file src/cls/tabular/SampleData/lineitem.100rows.csv \
+ *     --queries-file src/progly/queries.txt --num-objs 4 --repeat 50
+ */
+
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <boost/program_options.hpp>
+
+#include "include/rados/librados.hpp"
+#include "cls/tabular/cls_tabular.h"
+#include "cls/tabular/cls_tabular_utils.h"
+#include "tabular_test_data.h"
+
+using namespace std;
+using namespace Tables;
+namespace po = boost::program_options;
+
+// test_query_op fixed width row layout, see test_query_op in cls_tabular.cc
+const size_t RAW_ROW_SIZE = 141;
+
+struct latency_stats {
+    std::vector<uint64_t> op_ns;    // client observed, per exec call
+    uint64_t read_ns = 0;           // cls reported totals
+    uint64_t eval_ns = 0;
+    uint64_t result_bytes = 0;
+};
+
+static uint64_t now_ns()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ((uint64_t)ts.tv_sec) * 1000000000ULL + ts.tv_nsec;
+}
+
+// dates as yyyymmdd ints, as compared by query e of test_query_op
+static int date_to_int(const std::string& d)
+{
+    std::string s(d);
+    s.erase(std::remove(s.begin(), s.end(), '-'), s.end());
+    return std::stoi(s);
+}
+
+static void append_raw_row(bufferlist& bl, const std::vector<std::string>& r)
+{
+    char row[RAW_ROW_SIZE];
+    memset(row, 0, sizeof(row));
+    int32_t ints[4] = {std::stoi(r[0]), std::stoi(r[1]),
+                       std::stoi(r[2]), std::stoi(r[3])};
+    double dbls[4] = {std::stod(r[4]), std::stod(r[5]),
+                      std::stod(r[6]), std::stod(r[7])};
+    int32_t dates[3] = {date_to_int(r[10]), date_to_int(r[11]),
+                        date_to_int(r[12])};
+    memcpy(row + 0, ints, sizeof(ints));
+    memcpy(row + 16, dbls, sizeof(dbls));
+    row[48] = r[8][0];
+    row[49] = r[9][0];
+    memcpy(row + 50, dates, sizeof(dates));
+    strncpy(row + 62, r[13].c_str(), 25);
+    strncpy(row + 87, r[14].c_str(), 10);
+    strncpy(row + 97, r[15].c_str(), 44);
+    bl.append(row, sizeof(row));
+}
+
+// extract the "bin/run-query ..." example lines from queries.txt as
+// option name -> value maps.
+static std::vector<std::map<std::string, std::string>>
+load_queries(const std::string& fname)
+{
+    std::vector<std::map<std::string, std::string>> queries;
+    std::ifstream f(fname);
+    std::string line;
+    std::string cmd;
+    while (getline(f, line)) {
+        boost::trim(line);
+        if (cmd.empty() && line.find("bin/run-query") == std::string::npos)
+            continue;
+        bool more = !line.empty() && line.back() == '\\';
+        if (more)
+            line.pop_back();
+        cmd += " " + line;
+        if (more)
+            continue;
+
+        std::vector<std::string> toks;
+        boost::split(toks, cmd, boost::is_any_of(" \t"),
+                     boost::token_compress_on);
+        std::map<std::string, std::string> opts;
+        for (size_t i = 0; i < toks.size(); i++) {
+            if (toks[i].compare(0, 2, "--") != 0)
+                continue;
+            std::string name = toks[i].substr(2);
+            std::replace(name.begin(), name.end(), '_', '-');
+            if (i + 1 < toks.size() && toks[i+1].compare(0, 2, "--") != 0)
+                opts[name] = toks[++i];
+            else
+                opts[name] = "true";
+        }
+        if (opts.count("query"))
+            queries.push_back(opts);
+        cmd.clear();
+    }
+    return queries;
+}
+
+static std::string opt(std::map<std::string, std::string>& q,
+                       const std::string& name, const std::string& dflt)
+{
+    auto it = q.find(name);
+    return it == q.end() ? dflt : it->second;
+}
+
+static test_op make_test_op(std::map<std::string, std::string>& q,
+                            bool use_index)
+{
+    test_op op;
+    op.query = q["query"];
+    op.extended_price = std::stod(opt(q, "extended-price", "0"));
+    op.order_key = std::stoi(opt(q, "order-key", "0"));
+    op.line_number = std::stoi(opt(q, "line-number", "0"));
+    op.ship_date_low = std::stoi(opt(q, "ship-date-low", "-9999"));
+    op.ship_date_high = std::stoi(opt(q, "ship-date-high", "-9999"));
+    op.discount_low = std::stod(opt(q, "discount-low", "-9999"));
+    op.discount_high = std::stod(opt(q, "discount-high", "-9999"));
+    op.quantity = std::stod(opt(q, "quantity", "0"));
+    op.comment_regex = opt(q, "comment-regex", "");
+    op.use_index = use_index && op.query == "d";
+    op.old_projection = false;
+    op.extra_row_cost = 0;
+    op.fastpath = false;
+    return op;
+}
+
+/*
+ * Function: make_query_op
+ * Description: Translate one of the fixed test queries a-f into the
+ *              equivalent exec_query_op request over the flatbuf layout,
+ *              building the query schema the same way run-query does.
+ *              The shipdate range of query e is not translated since the
+ *              test queries give it as ints rather than dates.
+ */
+static query_op make_query_op(std::map<std::string, std::string>& q,
+                              schema_vec& data_schema,
+                              const std::string& table_name)
+{
+    std::string query = q["query"];
+    std::string project = PROJECT_DEFAULT;
+    std::string preds;
+    std::string eprice = opt(q, "extended-price", "0");
+
+    if (query == "a") {
+        preds = ";EXTENDEDPRICE,gt," + eprice + ";EXTENDEDPRICE,cnt,0";
+        project = "";
+    }
+    else if (query == "b") {
+        preds = ";EXTENDEDPRICE,gt," + eprice;
+    }
+    else if (query == "c") {
+        project = "ORDERKEY,LINENUMBER,EXTENDEDPRICE";
+        preds = ";EXTENDEDPRICE,eq," + eprice;
+    }
+    else if (query == "d") {
+        project = "ORDERKEY,LINENUMBER,EXTENDEDPRICE";
+        preds = ";ORDERKEY,eq," + opt(q, "order-key", "0") +
+                ";LINENUMBER,eq," + opt(q, "line-number", "0");
+    }
+    else if (query == "e") {
+        project = "EXTENDEDPRICE,DISCOUNT";
+        preds = ";DISCOUNT,gt," + opt(q, "discount-low", "0") +
+                ";DISCOUNT,lt," + opt(q, "discount-high", "0") +
+                ";QUANTITY,lt," + opt(q, "quantity", "0");
+    }
+    else if (query == "f") {
+        project = "ORDERKEY,LINENUMBER,COMMENT";
+        preds = ";COMMENT,like," + opt(q, "comment-regex", "");
+    }
+
+    predicate_vec pv = predsFromString(data_schema, preds);
+    schema_vec query_schema;
+    if (hasAggPreds(pv)) {
+        for (auto p : pv) {
+            if (!p->isGlobalAgg()) continue;
+            std::string op_str = skyOpTypeToString(p->opType());
+            query_schema.push_back(col_info(AGG_COL_IDX.at(op_str),
+                                            p->colType(), false, false,
+                                            op_str));
+        }
+    }
+    else {
+        query_schema = schemaFromColNames(data_schema, project);
+    }
+
+    query_op op;
+    op.query = "flatbuf";
+    op.debug = false;
+    op.fastpath = (project == PROJECT_DEFAULT && pv.empty());
+    op.index_read = false;
+    op.mem_constrain = false;
+    op.index_type = SIT_IDX_UNK;
+    op.index2_type = SIT_IDX_UNK;
+    op.index_plan_type = SIP_IDX_STANDARD;
+    op.index_batch_size = 1000;
+    op.result_format = SFT_FLATBUF_FLEX_ROW;
+    op.db_schema_name = "*";
+    op.table_name = table_name;
+    op.data_schema = schemaToString(data_schema);
+    op.query_schema = schemaToString(query_schema);
+    op.index_schema = "";
+    op.index2_schema = "";
+    op.query_preds = predsToString(pv, data_schema);
+    op.index_preds = "";
+    op.index2_preds = "";
+    op.pushback_max_inflight = 0;  // always process in the cls
+    op.pushback_max_cpu = 0;
+
+    for (auto p : pv)
+        delete p;
+    return op;
+}
+
+static int run_op(librados::IoCtx& ioctx, const std::string& oid,
+                  const char* method, bufferlist& inbl, latency_stats& st)
+{
+    bufferlist outbl;
+    uint64_t start = now_ns();
+    int ret = ioctx.exec(oid, "tabular", method, inbl, outbl);
+    st.op_ns.push_back(now_ns() - start);
+    if (ret < 0)
+        return ret;
+
+    cls_info info;
+    bufferlist result_bl;
+    try {
+        bufferlist::iterator it = outbl.begin();
+        ::decode(info, it);
+        ::decode(result_bl, it);
+    } catch (const buffer::error &err) {
+        return -EINVAL;
+    }
+    st.read_ns += info.read_ns;
+    st.eval_ns += info.eval_ns;
+    st.result_bytes += result_bl.length();
+    return 0;
+}
+
+static double pct(std::vector<uint64_t>& v, double p)
+{
+    size_t i = std::min(v.size() - 1, static_cast<size_t>(p * v.size()));
+    return v[i] / 1000.0;
+}
+
+static void report(const std::string& label, latency_stats& st)
+{
+    std::vector<uint64_t>& v = st.op_ns;
+    if (v.empty())
+        return;
+    std::sort(v.begin(), v.end());
+    uint64_t total = 0;
+    for (auto ns : v)
+        total += ns;
+    size_t n = v.size();
+    std::cout << label << ","
+              << n << ","
+              << total / 1000.0 / n << ","
+              << pct(v, 0.0) << ","
+              << pct(v, 0.50) << ","
+              << pct(v, 0.90) << ","
+              << pct(v, 0.99) << ","
+              << v.back() / 1000.0 << ","
+              << st.read_ns / 1000.0 / n << ","
+              << st.eval_ns / 1000.0 / n << ","
+              << st.result_bytes / n << std::endl;
+}
+
+int main(int argc, char **argv)
+{
+    std::string schema_file;
+    std::string data_file;
+    std::string queries_file;
+    std::string pool;
+    std::string table_name;
+    char csv_delim;
+    int num_objs;
+    int rows_per_obj;
+    int rows_per_fb;
+    int repeat;
+
+    po::options_description gen_opts("General options");
+    gen_opts.add_options()
+        ("help,h", "show help message")
+        ("schema-file", po::value<std::string>(&schema_file)->required(), "lineitem schema file")
+        ("data-file", po::value<std::string>(&data_file)->required(), "lineitem csv rows to load")
+        ("queries-file", po::value<std::string>(&queries_file)->required(), "progly/queries.txt")
+        ("csv-delim", po::value<char>(&csv_delim)->default_value('|'), "csv delimiter")
+        ("pool", po::value<std::string>(&pool)->default_value("tpchdata"), "pool name")
+        ("table-name", po::value<std::string>(&table_name)->default_value("LINEITEM"), "table name")
+        ("num-objs", po::value<int>(&num_objs)->default_value(4), "objects per layout")
+        ("rows-per-obj", po::value<int>(&rows_per_obj)->default_value(1000), "rows per object")
+        ("rows-per-fb", po::value<int>(&rows_per_fb)->default_value(250), "rows per flatbuf within an object")
+        ("repeat", po::value<int>(&repeat)->default_value(20), "times each query is replayed per object");
+
+    po::variables_map vm;
+    po::store(po::parse_command_line(argc, argv, gen_opts), vm);
+    if (vm.count("help")) {
+        std::cout << gen_opts << std::endl;
+        return 1;
+    }
+    po::notify(vm);
+
+    schema_vec data_schema = tabular_test::load_schema(schema_file);
+    tabular_test::csv_rows csv = tabular_test::load_rows(data_file, csv_delim);
+    auto queries = load_queries(queries_file);
+    if (data_schema.size() != 16 || csv.empty() || queries.empty()) {
+        std::cerr << "expected lineitem schema/data and at least one query"
+                  << std::endl;
+        return 1;
+    }
+
+    librados::Rados cluster;
+    int ret = cluster.init(NULL);
+    checkret(ret, 0);
+    ret = cluster.connect();
+    checkret(ret, 0);
+    ret = cluster.pool_create(pool.c_str());
+    checkret(ret, 0);
+    librados::IoCtx ioctx;
+    ret = cluster.ioctx_create(pool.c_str(), ioctx);
+    checkret(ret, 0);
+
+    // load both layouts
+    for (int i = 0; i < num_objs; i++) {
+        uint64_t first = static_cast<uint64_t>(i) * rows_per_obj;
+
+        bufferlist raw_bl;
+        for (uint64_t r = first; r < first + rows_per_obj; r++)
+            append_raw_row(raw_bl, csv[r % csv.size()]);
+        ret = ioctx.write_full("raw." + std::to_string(i), raw_bl);
+        checkret(ret, 0);
+
+        bufferlist fb_bl;
+        for (int r = 0; r < rows_per_obj; r += rows_per_fb) {
+            flatbuffers::FlatBufferBuilder fbb;
+            tabular_test::build_flexrow_blob(
+                fbb, data_schema, csv, first + r,
+                std::min(rows_per_fb, rows_per_obj - r), table_name, false);
+            tabular_test::append_fbmeta(fb_bl, SFT_FLATBUF_FLEX_ROW,
+                                        fbb.GetBufferPointer(), fbb.GetSize());
+        }
+        ret = ioctx.write_full("fb." + std::to_string(i), fb_bl);
+        checkret(ret, 0);
+    }
+
+    // pk index into omap for query d, as done by run-query --build-index
+    latency_stats idx_stats;
+    for (int i = 0; i < num_objs; i++) {
+        bufferlist inbl, outbl;
+        ::encode(static_cast<uint32_t>(1000), inbl);
+        uint64_t start = now_ns();
+        ret = ioctx.exec("raw." + std::to_string(i), "tabular", "build_index",
+                         inbl, outbl);
+        idx_stats.op_ns.push_back(now_ns() - start);
+        checkret(ret, 0);
+    }
+
+    std::cout << "op,query,calls,mean_us,min_us,p50_us,p90_us,p99_us,max_us,"
+              << "cls_read_mean_us,cls_eval_mean_us,result_bytes_mean"
+              << std::endl;
+    report("build_index,-", idx_stats);
+
+    for (auto& q : queries) {
+        std::string label = q["query"];
+        if (label < "a" || label > "f")
+            continue;
+
+        latency_stats test_stats, test_idx_stats, exec_stats;
+        test_op top = make_test_op(q, false);
+        test_op top_idx = make_test_op(q, true);
+        query_op qop = make_query_op(q, data_schema, table_name);
+
+        for (int rep = 0; rep < repeat; rep++) {
+            for (int i = 0; i < num_objs; i++) {
+                bufferlist inbl;
+                ::encode(top, inbl);
+                ret = run_op(ioctx, "raw." + std::to_string(i),
+                             "test_query_op", inbl, test_stats);
+                checkret(ret, 0);
+
+                if (top_idx.use_index) {
+                    bufferlist inbl_idx;
+                    ::encode(top_idx, inbl_idx);
+                    ret = run_op(ioctx, "raw." + std::to_string(i),
+                                 "test_query_op", inbl_idx, test_idx_stats);
+                    checkret(ret, 0);
+                }
+
+                bufferlist qinbl;
+                ::encode(qop, qinbl);
+                ret = run_op(ioctx, "fb." + std::to_string(i),
+                             "exec_query_op", qinbl, exec_stats);
+                checkret(ret, 0);
+            }
+        }
+        report("test_query_op," + label, test_stats);
+        report("test_query_op+index," + label, test_idx_stats);
+        report("exec_query_op," + label, exec_stats);
+    }
+
+    ioctx.close();
+    cluster.shutdown();
+    return 0;
+}
@@ -0,0 +1,271 @@
+/*
+* Copyright (C) 2018 The Regents of the University of California
+* All Rights Reserved
+*
+* This library can redistribute it and/or modify under the terms
+* of the GNU Lesser General Public License Version 2.1 as published
+* by the Free Software Foundation.
+*
+*/
+
+/*
+ * Microbenchmark for the skyhook tabular processing kernels.
+ *
+ * Builds SFT_FLATBUF_FLEX_ROW and SFT_ARROW blobs entirely in memory from a
+ * SampleData schema/csv pair (e.g., lineitem or ncols100), replicating the csv
+ * rows up to the requested row count, then times the same kernels the cls
+ * invokes (processSkyFb, processArrowCol, applyPredicates,
+ * transform_fb_to_arrow) plus the client side print formatters.
+ *
+ * Selectivity is controlled exactly by overwriting the first column of each
+ * row with its row number and using a single "lt" predicate on that column.
+ * Projection width is the leading fraction of the data schema columns.
+ *
+ * Output is one csv line per (kernel, rows, selectivity, projection) config:
+ *   schema,format,kernel,rows,selectivity,proj_cols,in_bytes,
+ *   sec_per_iter,rows_per_sec,bytes_per_sec
+ *
+ * Example:
+ *   bin/ceph_bench_tabular_processing \
+ *     --schema-file src/cls/tabular/SampleData/lineitem.schema.txt \
+ *     --data-file src/cls/tabular/SampleData/lineitem.100rows.csv \
+ *     --rows 1000,100000 --selectivity 0.01,0.1,1.0 --projection 0.25,1.0
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <climits>
+#include <iostream>
+#include <sstream>
+#include <streambuf>
+#include <boost/program_options.hpp>
+
+#include "cls/tabular/cls_tabular_utils.h"
+#include "cls/tabular/cls_tabular_processing.h"
+#include "tabular_test_data.h"
+
+using namespace std;
+using namespace Tables;
+namespace po = boost::program_options;
+
+// discards everything written to it, used to take the terminal out of the
+// print formatter timings.
+class NullBuffer : public std::streambuf
+{
+public:
+    int overflow(int c) override { return c; }
+    std::streamsize xsputn(const char*, std::streamsize n) override { return n; }
+};
+
+struct bench_blob {
+    std::string name;      // schema name for reporting
+    schema_vec schema;
+    uint32_t nrows;
+    flatbuffers::FlatBufferBuilder fbb;    // SFT_FLATBUF_FLEX_ROW blob
+    std::shared_ptr<arrow::Buffer> arrow_buf;  // SFT_ARROW blob
+};
+
+static std::vector<double> parse_list(const std::string& s)
+{
+    std::vector<std::string> items;
+    std::vector<double> vals;
+    boost::split(items, s, boost::is_any_of(","), boost::token_compress_on);
+    for (auto& it : items) {
+        boost::trim(it);
+        if (!it.empty())
+            vals.push_back(std::stod(it));
+    }
+    return vals;
+}
+
+// build both blob formats for b.nrows rows, col 0 holds the row number.
+static int build_blobs(bench_blob& b, const tabular_test::csv_rows& csv,
+                       std::string& errmsg)
+{
+    tabular_test::build_flexrow_blob(b.fbb, b.schema, csv, 0, b.nrows,
+                                     b.name, true);
+    std::shared_ptr<arrow::Table> table;
+    int ret = transform_fb_to_arrow(
+        reinterpret_cast<const char*>(b.fbb.GetBufferPointer()),
+        b.fbb.GetSize(), b.schema, errmsg, &table);
+    if (ret != 0)
+        return ret;
+    return convert_arrow_to_buffer(table, &b.arrow_buf);
+}
+
+static double now_sec()
+{
+    return std::chrono::duration<double>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static void report(const bench_blob& b, const std::string& format,
+                   const std::string& kernel, double sel, int proj_cols,
+                   uint64_t rows, uint64_t bytes, double sec)
+{
+    std::cout << b.name << "," << format << "," << kernel << ","
+              << b.nrows << "," << sel << "," << proj_cols << ","
+              << bytes << "," << sec << ","
+              << (sec > 0 ? rows / sec : 0) << ","
+              << (sec > 0 ? bytes / sec : 0) << std::endl;
+}
+
+int main(int argc, char **argv)
+{
+    std::string schema_file;
+    std::string data_file;
+    std::string rows_str;
+    std::string sel_str;
+    std::string proj_str;
+    char csv_delim;
+    int iters;
+
+    po::options_description gen_opts("General options");
+    gen_opts.add_options()
+        ("help,h", "show help message")
+        ("schema-file", po::value<std::string>(&schema_file)->required(), "skyhook schema file (SampleData/*.schema.txt)")
+        ("data-file", po::value<std::string>(&data_file)->required(), "csv rows to replicate (SampleData/*.csv)")
+        ("csv-delim", po::value<char>(&csv_delim)->default_value('|'), "csv delimiter")
+        ("rows", po::value<std::string>(&rows_str)->default_value("1000,10000,100000"), "row counts to sweep")
+        ("selectivity", po::value<std::string>(&sel_str)->default_value("0.01,0.1,0.5,1.0"), "selectivities to sweep")
+        ("projection", po::value<std::string>(&proj_str)->default_value("0.1,0.5,1.0"), "fraction of cols projected")
+        ("iterations", po::value<int>(&iters)->default_value(5), "iterations per config");
+
+    po::variables_map vm;
+    po::store(po::parse_command_line(argc, argv, gen_opts), vm);
+    if (vm.count("help")) {
+        std::cout << gen_opts << std::endl;
+        return 1;
+    }
+    po::notify(vm);
+
+    schema_vec data_schema = tabular_test::load_schema(schema_file);
+    auto csv = tabular_test::load_rows(data_file, csv_delim);
+    if (data_schema.empty() || csv.empty()) {
+        std::cerr << "empty schema or data file" << std::endl;
+        return 1;
+    }
+    std::string name = schema_file.substr(schema_file.find_last_of('/') + 1);
+    name = name.substr(0, name.find('.'));
+
+    // formatters write to stdout, send them to a sink while timing.
+    NullBuffer null_buf;
+    std::streambuf* cout_buf = std::cout.rdbuf();
+
+    std::cout << "schema,format,kernel,rows,selectivity,proj_cols,in_bytes,"
+              << "sec_per_iter,rows_per_sec,bytes_per_sec" << std::endl;
+
+    for (double nrows : parse_list(rows_str)) {
+        bench_blob b;
+        b.name = name;
+        b.schema = data_schema;
+        b.nrows = static_cast<uint32_t>(nrows);
+        std::string errmsg;
+        if (build_blobs(b, csv, errmsg) != 0) {
+            std::cerr << "build_blobs failed: " << errmsg << std::endl;
+            return 1;
+        }
+        const char* fb = reinterpret_cast<const char*>(b.fbb.GetBufferPointer());
+        size_t fb_size = b.fbb.GetSize();
+        const char* ab = reinterpret_cast<const char*>(b.arrow_buf->data());
+        size_t ab_size = b.arrow_buf->size();
+
+        for (double proj : parse_list(proj_str)) {
+            int ncols = std::max(1, static_cast<int>(proj * data_schema.size() + 0.5));
+            ncols = std::min(ncols, static_cast<int>(data_schema.size()));
+            schema_vec query_schema(data_schema.begin(),
+                                    data_schema.begin() + ncols);
+
+            // transform is independent of selectivity
+            double t0 = now_sec();
+            for (int i = 0; i < iters; i++) {
+                std::shared_ptr<arrow::Table> t;
+                transform_fb_to_arrow(fb, fb_size, query_schema, errmsg, &t);
+            }
+            report(b, "SFT_FLATBUF_FLEX_ROW", "transform_fb_to_arrow", 1.0,
+                   ncols, b.nrows, fb_size, (now_sec() - t0) / iters);
+
+            for (double sel : parse_list(sel_str)) {
+                uint64_t k = static_cast<uint64_t>(sel * b.nrows);
+                predicate_vec preds = predsFromString(
+                    data_schema,
+                    ";" + data_schema[0].name + ",lt," + std::to_string(k));
+
+                // predicate evaluation only, flatbuf row access
+                t0 = now_sec();
+                for (int i = 0; i < iters; i++) {
+                    sky_root root = getSkyRoot(fb, fb_size);
+                    uint64_t passed = 0;
+                    for (uint32_t r = 0; r < root.nrows; r++) {
+                        sky_rec rec = getSkyRec(static_cast<row_offs>(root.data_vec)->Get(r));
+                        if (applyPredicates(preds, rec))
+                            passed++;
+                    }
+                    assert (passed == k);
+                }
+                report(b, "SFT_FLATBUF_FLEX_ROW", "applyPredicates", sel,
+                       ncols, b.nrows, fb_size, (now_sec() - t0) / iters);
+
+                flatbuffers::FlatBufferBuilder flatb(1024);
+                t0 = now_sec();
+                for (int i = 0; i < iters; i++) {
+                    flatb.Clear();
+                    processSkyFb(flatb, data_schema, query_schema, preds,
+                                 fb, fb_size, errmsg);
+                }
+                report(b, "SFT_FLATBUF_FLEX_ROW", "processSkyFb", sel,
+                       ncols, b.nrows, fb_size, (now_sec() - t0) / iters);
+
+                std::shared_ptr<arrow::Table> result;
+                t0 = now_sec();
+                for (int i = 0; i < iters; i++) {
+                    processArrowCol(&result, data_schema, query_schema, preds,
+                                    ab, ab_size, errmsg);
+                }
+                report(b, "SFT_ARROW", "processArrowCol", sel,
+                       ncols, b.nrows, ab_size, (now_sec() - t0) / iters);
+
+                // formatters run on the processed (client received) results
+                const char* fres = reinterpret_cast<const char*>(flatb.GetBufferPointer());
+                size_t fres_size = flatb.GetSize();
+                std::shared_ptr<arrow::Buffer> ares_buf;
+                convert_arrow_to_buffer(result, &ares_buf);
+                const char* ares = reinterpret_cast<const char*>(ares_buf->data());
+                size_t ares_size = ares_buf->size();
+
+                long long int nprinted = 0;
+                std::cout.rdbuf(&null_buf);
+                t0 = now_sec();
+                for (int i = 0; i < iters; i++)
+                    nprinted = printFlatbufFlexRowAsCsv(fres, fres_size, false, false, LLONG_MAX);
+                double fcsv = (now_sec() - t0) / iters;
+                t0 = now_sec();
+                for (int i = 0; i < iters; i++)
+                    printFlatbufFlexRowAsPGBinary(fres, fres_size, true, false, LLONG_MAX);
+                double fpg = (now_sec() - t0) / iters;
+                t0 = now_sec();
+                for (int i = 0; i < iters; i++)
+                    printArrowbufRowAsCsv(ares, ares_size, false, false, LLONG_MAX);
+                double acsv = (now_sec() - t0) / iters;
+                t0 = now_sec();
+                for (int i = 0; i < iters; i++)
+                    printArrowbufRowAsPGBinary(ares, ares_size, true, false, LLONG_MAX);
+                double apg = (now_sec() - t0) / iters;
+                std::cout.rdbuf(cout_buf);
+
+                report(b, "SFT_FLATBUF_FLEX_ROW", "printFlatbufFlexRowAsCsv",
+                       sel, ncols, nprinted, fres_size, fcsv);
+                report(b, "SFT_FLATBUF_FLEX_ROW", "printFlatbufFlexRowAsPGBinary",
+                       sel, ncols, nprinted, fres_size, fpg);
+                report(b, "SFT_ARROW", "printArrowbufRowAsCsv",
+                       sel, ncols, nprinted, ares_size, acsv);
+                report(b, "SFT_ARROW", "printArrowbufRowAsPGBinary",
+                       sel, ncols, nprinted, ares_size, apg);
+
+                for (auto p : preds)
+                    delete p;
+            }
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,81 @@
+;; Sample skyhook wasm udf module, see cls_tabular_wasm.h for the udf ABI.
+;; Used by unittest_cls_tabular_wasm.
+
+(module
+  (memory (export "memory") 2)
+
+  ;; bump allocator, 8 byte aligned, growing the memory as needed
+  (global $next (mut i32) (i32.const 1024))
+  (func (export "sky_alloc") (param $size i32) (result i32)
+    (local $p i32)
+    (local.set $p (global.get $next))
+    (global.set $next
+      (i32.and (i32.add (i32.add (local.get $p) (local.get $size))
+                        (i32.const 7))
+               (i32.const -8)))
+    (block $done
+      (loop $grow
+        (br_if $done (i32.le_u (global.get $next)
+                               (i32.mul (memory.size) (i32.const 65536))))
+        (br_if $done (i32.eq (memory.grow (i32.const 1)) (i32.const -1)))
+        (br $grow)))
+    (local.get $p))
+
+  ;; filter: keep the rows whose first input col is over 10
+  (func (export "over_10")
+        (param $in i32) (param $n i32) (param $ncols i32) (param $out i32)
+        (result i32)
+    (local $i i32)
+    (block $done
+      (loop $rows
+        (br_if $done (i32.ge_u (local.get $i) (local.get $n)))
+        (i32.store8
+          (i32.add (local.get $out) (local.get $i))
+          (f64.gt (f64.load (i32.add (local.get $in)
+                                     (i32.shl (local.get $i) (i32.const 3))))
+                  (f64.const 10)))
+        (local.set $i (i32.add (local.get $i) (i32.const 1)))
+        (br $rows)))
+    (i32.const 0))
+
+  ;; map: twice the first input col
+  (func (export "twice")
+        (param $in i32) (param $n i32) (param $ncols i32) (param $out i32)
+        (result i32)
+    (local $i i32)
+    (local $off i32)
+    (block $done
+      (loop $rows
+        (br_if $done (i32.ge_u (local.get $i) (local.get $n)))
+        (local.set $off (i32.shl (local.get $i) (i32.const 3)))
+        (f64.store
+          (i32.add (local.get $out) (local.get $off))
+          (f64.mul (f64.load (i32.add (local.get $in) (local.get $off)))
+                   (f64.const 2)))
+        (local.set $i (i32.add (local.get $i) (i32.const 1)))
+        (br $rows)))
+    (i32.const 0))
+
+  ;; filter: never returns, runs out of fuel
+  (func (export "spin")
+        (param $in i32) (param $n i32) (param $ncols i32) (param $out i32)
+        (result i32)
+    (loop $forever
+      (br $forever))
+    (i32.const 0))
+
+  ;; filter: keep all rows if the memory can grow by 1MB, else fail
+  (func (export "grow_1mb")
+        (param $in i32) (param $n i32) (param $ncols i32) (param $out i32)
+        (result i32)
+    (local $i i32)
+    (if (i32.eq (memory.grow (i32.const 16)) (i32.const -1))
+      (then (return (i32.const 1))))
+    (block $done
+      (loop $rows
+        (br_if $done (i32.ge_u (local.get $i) (local.get $n)))
+        (i32.store8 (i32.add (local.get $out) (local.get $i)) (i32.const 1))
+        (local.set $i (i32.add (local.get $i) (i32.const 1)))
+        (br $rows)))
+    (i32.const 0))
+)
@@ -0,0 +1,153 @@
+/*
+* Copyright (C) 2018 The Regents of the University of California
+* All Rights Reserved
+*
+* This library can redistribute it and/or modify under the terms
+* of the GNU Lesser General Public License Version 2.1 as published
+* by the Free Software Foundation.
+*
+*/
+
+#ifndef TEST_CLS_TABULAR_DATA_H
+#define TEST_CLS_TABULAR_DATA_H
+
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "cls/tabular/cls_tabular_utils.h"
+
+// Helpers to generate skyhook test data in memory from the SampleData
+// schema/csv files, shared by the tabular benchmarks.
+
+namespace tabular_test {
+
+typedef std::vector<std::vector<std::string>> csv_rows;
+
+inline Tables::schema_vec load_schema(const std::string& fname)
+{
+    std::ifstream f(fname);
+    std::stringstream ss;
+    ss << f.rdbuf();
+    Tables::schema_vec sc = Tables::schemaFromString(ss.str());
+
+    // predsFromString upper cases the col names it is given.
+    for (auto& col : sc)
+        boost::to_upper(col.name);
+    return sc;
+}
+
+inline csv_rows load_rows(const std::string& fname, char delim)
+{
+    csv_rows rows;
+    std::ifstream f(fname);
+    std::string line;
+    while (getline(f, line)) {
+        std::vector<std::string> fields;
+        std::istringstream ls(line);
+        std::string item;
+        while (getline(ls, item, delim))
+            fields.push_back(item);
+        rows.push_back(fields);
+    }
+    return rows;
+}
+
+// same encoding as sky_tabular_flatflex_writer, minus the null handling.
+inline void add_flex_field(flexbuffers::Builder& flx,
+                           const Tables::col_info& col,
+                           const std::string& v)
+{
+    using namespace Tables;
+    switch (col.type) {
+    case SDT_INT8:   flx.Add(static_cast<int8_t>(std::stoi(v))); break;
+    case SDT_INT16:  flx.Add(static_cast<int16_t>(std::stoi(v))); break;
+    case SDT_INT32:  flx.Add(static_cast<int32_t>(std::stoi(v))); break;
+    case SDT_INT64:  flx.Add(static_cast<int64_t>(std::stoll(v))); break;
+    case SDT_UINT8:  flx.Add(static_cast<uint8_t>(std::stoul(v))); break;
+    case SDT_UINT16: flx.Add(static_cast<uint16_t>(std::stoul(v))); break;
+    case SDT_UINT32: flx.Add(static_cast<uint32_t>(std::stoul(v))); break;
+    case SDT_UINT64: flx.Add(static_cast<uint64_t>(std::stoull(v))); break;
+    case SDT_CHAR:   flx.Add(static_cast<char>(v[0])); break;
+    case SDT_UCHAR:  flx.Add(static_cast<unsigned char>(v[0])); break;
+    case SDT_BOOL:   flx.Add(v == "1" || v == "true"); break;
+    case SDT_FLOAT:  flx.Add(std::stof(v)); break;
+    case SDT_DOUBLE: flx.Add(std::stod(v)); break;
+    case SDT_DATE:   flx.Add(dateToDays(v)); break;
+    case SDT_STRING: flx.Add(v.c_str()); break;
+    default:
+        assert (TablesErrCodes::UnsupportedSkyDataType == 0);
+    }
+}
+
+/*
+ * Function: build_flexrow_blob
+ * Description: Build a finished SFT_FLATBUF_FLEX_ROW table of nrows rows into
+ *              fbb, cycling over the csv rows starting at first_row. RIDs are
+ *              first_row..first_row+nrows-1. When rownum_col0 is set, col 0 of
+ *              each row is overwritten with its RID, so that a predicate
+ *              "col0 lt k" selects exactly k rows from a blob starting at 0.
+ */
+inline void build_flexrow_blob(flatbuffers::FlatBufferBuilder& fbb,
+                               const Tables::schema_vec& schema,
+                               const csv_rows& csv,
+                               uint64_t first_row,
+                               uint32_t nrows,
+                               const std::string& table_name,
+                               bool rownum_col0)
+{
+    std::vector<flatbuffers::Offset<Tables::Record>> rows;
+    Tables::delete_vector dv;
+    std::vector<uint64_t> nullbits(2, 0);
+
+    for (uint64_t i = first_row; i < first_row + nrows; i++) {
+        const std::vector<std::string>& r = csv[i % csv.size()];
+        flexbuffers::Builder flx;
+        flx.Vector([&]() {
+            for (auto it = schema.begin(); it != schema.end(); ++it) {
+                if (rownum_col0 && it->idx == 0)
+                    add_flex_field(flx, *it, std::to_string(i));
+                else
+                    add_flex_field(flx, *it, r.at(it->idx));
+            }
+        });
+        flx.Finish();
+        auto data = fbb.CreateVector(flx.GetBuffer());
+        auto nulls = fbb.CreateVector(nullbits);
+        rows.push_back(Tables::CreateRecord(fbb, i, nulls, data));
+        dv.push_back(0);
+    }
+
+    auto data_schema = fbb.CreateString(Tables::schemaToString(schema));
+    auto db_schema = fbb.CreateString("*");
+    auto table_n = fbb.CreateString(table_name);
+    auto delete_v = fbb.CreateVector(dv);
+    auto rows_v = fbb.CreateVector(rows);
+    auto root = Tables::CreateTable(fbb, Tables::SFT_FLATBUF_FLEX_ROW, 2, 1, 1,
+                                    data_schema, db_schema, table_n,
+                                    delete_v, rows_v, nrows);
+    fbb.Finish(root);
+}
+
+/*
+ * Function: append_fbmeta
+ * Description: Wrap a data blob in an FB_Meta and append it to bl encoded as
+ *              a bufferlist, i.e., the on-disk layout the cls reads back
+ *              (see writeToDisk in sky_tabular_flatflex_writer.cc).
+ */
+inline void append_fbmeta(bufferlist& bl, int format,
+                          const uint8_t* data, size_t len)
+{
+    flatbuffers::FlatBufferBuilder meta_builder;
+    Tables::createFbMeta(&meta_builder, format,
+                         const_cast<unsigned char*>(data), len);
+    bufferlist meta_bl;
+    meta_bl.append(reinterpret_cast<const char*>(meta_builder.GetBufferPointer()),
+                   meta_builder.GetSize());
+    ::encode(meta_bl, bl);
+}
+
+} // end namespace tabular_test
+
+#endif
@@ -0,0 +1,1325 @@
+/*
+* Copyright (C) 2018 The Regents of the University of California
+* All Rights Reserved
+*
+* This library can redistribute it and/or modify under the terms
+* of the GNU Lesser General Public License Version 2.1 as published
+* by the Free Software Foundation.
+*
+*/
+
+/*
+ * Unit tests of the skyhook tabular utils that need no osd, e.g., the data
+ * type conversions, sketches, rollups and fb encodings.
+ */
+
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <set>
+#include <sstream>
+
+#include "gtest/gtest.h"
+
+#include "cls/tabular/cls_tabular_utils.h"
+#include "cls/tabular/cls_tabular_processing.h"
+#include "tabular_test_data.h"
+
+using namespace Tables;
+
+TEST(ClsTabularUtils, date_to_days)
+{
+    ASSERT_EQ(0, dateToDays("1970-01-01"));
+    ASSERT_EQ(1, dateToDays("1970-01-02"));
+    ASSERT_EQ(-1, dateToDays("1969-12-31"));
+    ASSERT_EQ(8035, dateToDays("1992-01-01"));
+
+    // plain day counts, also negative ones
+    ASSERT_EQ(42, dateToDays("42"));
+    ASSERT_EQ(42, dateToDays("+42"));
+    ASSERT_EQ(-5, dateToDays("-5"));
+    ASSERT_EQ(0, dateToDays("0"));
+
+    for (int32_t days : {-36500, -5, 0, 8035, 20000})
+        ASSERT_EQ(days, dateToDays(daysToDate(days)));
+}
+
+TEST(ClsTabularUtils, exprs_from_string)
+{
+    // col idxs need not be contiguous, computed cols follow the max idx.
+    schema_vec sc;
+    sc.push_back(col_info(0, SDT_INT64, true, false, "ORDERKEY"));
+    sc.push_back(col_info(5, SDT_DOUBLE, false, false, "PRICE"));
+    sc.push_back(col_info(6, SDT_DOUBLE, false, false, "DISCOUNT"));
+
+    expr_vec exprs;
+    std::string errmsg;
+    ASSERT_EQ(0, exprsFromString(sc,
+        "DISC=PRICE*(1-DISCOUNT);SCALED=DISC*2e-3;K=ORDERKEY+1", exprs,
+        errmsg));
+    ASSERT_EQ(3u, exprs.size());
+    ASSERT_EQ(7, exprs[0].col.idx);
+    ASSERT_EQ(8, exprs[1].col.idx);
+    ASSERT_EQ(9, exprs[2].col.idx);
+    ASSERT_EQ(SDT_DOUBLE, exprs[1].col.type);
+    ASSERT_EQ(SDT_INT64, exprs[2].col.type);
+    ASSERT_DOUBLE_EQ(2e-3, exprs[1].expr->right->dval);
+
+    // malformed exprs return an error rather than asserting.
+    for (std::string bad : {"NOEQUALS", "X=PRICE*", "X=(PRICE", "X=NOSUCHCOL",
+                            "X=2e", "X=1.2.3", "X=12abc", "X=PRICE $",
+                            "X=nosuchfn(PRICE)", "X=sum(PRICE)"}) {
+        errmsg.clear();
+        int ret = exprsFromString(sc, bad, exprs, errmsg);
+        ASSERT_NE(0, ret) << bad;
+        ASSERT_FALSE(errmsg.empty()) << bad;
+        ASSERT_TRUE(exprs.empty()) << bad;
+    }
+    ASSERT_EQ(TablesErrCodes::RequestedColNotPresent,
+              exprsFromString(sc, "X=NOSUCHCOL", exprs, errmsg));
+}
+
+TEST(ClsTabularUtils, query_plan_round_trip)
+{
+    schema_vec sc;
+    sc.push_back(col_info(0, SDT_INT64, true, false, "ORDERKEY"));
+    sc.push_back(col_info(1, SDT_DOUBLE, false, true, "PRICE"));
+    sc.push_back(col_info(2, SDT_STRING, false, false, "COMMENT"));
+    sc.push_back(col_info(3, SDT_DATE, false, false, "SHIPDATE"));
+    std::string data_schema = schemaToString(sc);
+    std::string query_schema = schemaToString(schemaFromColNames(sc,
+                                                  "ORDERKEY,COMMENT"));
+    std::string exprs = "DISC=PRICE*0.9";
+    std::string preds = ";orderkey,in,1|5|9;price,gt,2.5;comment,like,abc"
+                        ";shipdate,lt,1995-01-01;disc,leq,100";
+    std::string idx_schema = schemaToString(schemaFromColNames(sc,
+                                                "ORDERKEY"));
+    std::string idx_preds = ";orderkey,geq,3";
+
+    std::string plan, errmsg;
+    ASSERT_EQ(0, encodeQueryPlan(data_schema, query_schema, exprs, preds,
+                                 true, idx_schema, idx_preds, "", "",
+                                 ";ORDERKEY,desc", plan, errmsg));
+    const QueryPlan* qp = verifyQueryPlan(plan.data(), plan.size());
+    ASSERT_NE(nullptr, qp);
+    ASSERT_EQ(QUERY_PLAN_VERSION, qp->version());
+    ASSERT_TRUE(qp->index_read());
+
+    // the same schemas and preds as from the text fields
+    schema_vec data_sc = schemaFromPlan(qp->data_schema());
+    ASSERT_EQ(data_schema, schemaToString(data_sc));
+    ASSERT_EQ(query_schema, schemaToString(schemaFromPlan(qp->query_schema())));
+    ASSERT_EQ(idx_schema, schemaToString(schemaFromPlan(qp->index_schema())));
+    ASSERT_EQ(exprs, qp->query_exprs()->str());
+    ASSERT_EQ(";ORDERKEY,desc", qp->query_sort()->str());
+
+    expr_vec ev;
+    ASSERT_EQ(0, exprsFromString(data_sc, exprs, ev, errmsg));
+    schema_vec expr_sc = schemaWithExprs(data_sc, ev);
+    predicate_vec from_plan, from_text = predsFromString(expr_sc, preds);
+    ASSERT_EQ(0, predsFromPlan(expr_sc, qp->query_preds(), from_plan,
+                               errmsg));
+    ASSERT_EQ(predsToString(from_text, expr_sc),
+              predsToString(from_plan, expr_sc));
+    predicate_vec idx_plan;
+    ASSERT_EQ(0, predsFromPlan(data_sc, qp->index_preds(), idx_plan, errmsg));
+    ASSERT_EQ(1u, idx_plan.size());
+    for (auto p : from_text) delete p;
+    for (auto p : from_plan) delete p;
+    for (auto p : idx_plan) delete p;
+
+    // truncated or corrupt plans are rejected, not read
+    ASSERT_EQ(nullptr, verifyQueryPlan(plan.data(), plan.size() / 2));
+    std::string bad = "not a query plan";
+    ASSERT_EQ(nullptr, verifyQueryPlan(bad.data(), bad.size()));
+
+    // a pred over a col the schema does not have is an error
+    predicate_vec none;
+    ASSERT_EQ(TablesErrCodes::RequestedColNotPresent,
+              predsFromPlan(data_sc, qp->query_preds(), none, errmsg));
+    ASSERT_TRUE(none.empty());
+}
+
+TEST(ClsTabularUtils, preds_key_range_uint64)
+{
+    schema_vec sc;
+    sc.push_back(col_info(0, SDT_UINT64, true, false, "ID"));
+    const std::string big = "18446744073709551000";  // > INT64_MAX
+
+    struct {
+        std::string preds;
+        int64_t lo, hi;
+    } cases[] = {
+        {";id,geq,10;id,lt,100", 10, 99},
+        // saturated vals must not wrap negative and prune everything
+        {";id,lt," + big, INT64_MIN, INT64_MAX},
+        {";id,leq," + big, INT64_MIN, INT64_MAX},
+        {";id,geq," + big, INT64_MAX, INT64_MAX},
+        {";id,eq," + big, INT64_MAX, INT64_MAX},
+        {";id,in,5|" + big, 5, INT64_MAX},
+    };
+    for (auto& c : cases) {
+        predicate_vec preds = predsFromString(sc, c.preds);
+        int64_t lo = INT64_MIN;
+        int64_t hi = INT64_MAX;
+        predsKeyRange(preds, 0, lo, hi);
+        EXPECT_EQ(c.lo, lo) << c.preds;
+        EXPECT_EQ(c.hi, hi) << c.preds;
+        for (auto p : preds) delete p;
+    }
+}
+
+static std::shared_ptr<arrow::Table> int64_run(const std::vector<int64_t>& v)
+{
+    arrow::Int64Builder builder;
+    for (auto x : v) {
+        if (x < 0)
+            builder.AppendNull();
+        else
+            builder.Append(x);
+    }
+    std::shared_ptr<arrow::Array> arr;
+    builder.Finish(&arr);
+    std::shared_ptr<arrow::KeyValueMetadata> metadata(
+        new arrow::KeyValueMetadata);
+    metadata->Append(ToString(METADATA_NUM_ROWS), std::to_string(v.size()));
+    auto schema = arrow::schema({arrow::field("ID", arrow::int64())},
+                                metadata);
+    return arrow::Table::Make(schema, {arr});
+}
+
+TEST(ClsTabularUtils, merge_arrow_sort_runs)
+{
+    schema_vec sc;
+    sc.push_back(col_info(0, SDT_INT64, true, true, "ID"));
+    sort_vec keys = sortKeysFromString(sc, ";ID");
+
+    // -1 is a null, which sorts first
+    std::vector<std::shared_ptr<arrow::Table>> runs;
+    runs.push_back(int64_run({1, 4, 7}));
+    runs.push_back(int64_run({}));
+    runs.push_back(int64_run({2, 5}));
+    runs.push_back(int64_run({-1, 3, 6, 8, 9}));
+
+    std::vector<int64_t> merged;
+    std::vector<int64_t> batch_sizes;
+    std::string errmsg;
+    ASSERT_EQ(0, mergeArrowSortRuns(runs, sc, keys, 4,
+        [&](std::shared_ptr<arrow::Table> batch) {
+            auto arr = std::static_pointer_cast<arrow::Int64Array>(
+                batch->column(0)->chunk(0));
+            for (int64_t i = 0; i < arr->length(); i++)
+                merged.push_back(arr->IsNull(i) ? -1 : arr->Value(i));
+            batch_sizes.push_back(batch->num_rows());
+            return true;
+        }, errmsg));
+    ASSERT_EQ(std::vector<int64_t>({-1, 1, 2, 3, 4, 5, 6, 7, 8, 9}), merged);
+    ASSERT_EQ(std::vector<int64_t>({4, 4, 2}), batch_sizes);
+
+    // consumed runs are released
+    for (auto& r : runs) {
+        if (r)
+            ASSERT_EQ(0, r->num_rows());
+    }
+
+    // emit returning false stops the merge
+    runs.clear();
+    runs.push_back(int64_run({1, 3}));
+    runs.push_back(int64_run({2, 4}));
+    int nbatches = 0;
+    ASSERT_EQ(0, mergeArrowSortRuns(runs, sc, keys, 1,
+        [&](std::shared_ptr<arrow::Table> batch) {
+            return ++nbatches < 2;
+        }, errmsg));
+    ASSERT_EQ(2, nbatches);
+}
+
+TEST(ClsTabularUtils, hll_sketch)
+{
+    hll_sketch a, b;
+    ASSERT_EQ(0u, a.estimate());
+    const int64_t n = 100000;
+    for (int64_t i = 0; i < n; i++) {
+        a.add(skyHashInt(i));
+        a.add(skyHashInt(i));  // repeats are not counted
+        b.add(skyHashInt(n / 2 + i));
+    }
+    // 4 std errs of 1.04 / sqrt(2^HLL_PRECISION), ~6.5%
+    EXPECT_NEAR(n, a.estimate(), 0.065 * n);
+
+    // merge is the sketch of the union
+    hll_sketch u = a;
+    u.merge(b);
+    EXPECT_NEAR(1.5 * n, u.estimate(), 0.065 * 1.5 * n);
+
+    // serialize/deserialize round trip, truncated states are rejected
+    std::string s;
+    u.serialize(s);
+    hll_sketch d;
+    ASSERT_EQ(0, d.deserialize(reinterpret_cast<const uint8_t*>(s.data()),
+                               s.size()));
+    ASSERT_EQ(u.regs, d.regs);
+    ASSERT_NE(0, d.deserialize(reinterpret_cast<const uint8_t*>(s.data()),
+                               s.size() / 2));
+}
+
+TEST(ClsTabularUtils, kll_sketch)
+{
+    kll_sketch a, b;
+    ASSERT_EQ(0.0, a.quantile(0.5));
+    const int n = 100000;
+    for (int i = 0; i < n; i++) {
+        a.add(i);
+        b.add(n + i);
+    }
+    ASSERT_EQ(uint64_t(n), a.n);
+    // rank error within ~3x the ~1.7% of KLL_K
+    EXPECT_NEAR(0.5 * n, a.quantile(0.5), 0.05 * n);
+    EXPECT_NEAR(0.9 * n, a.quantile(0.9), 0.05 * n);
+    EXPECT_LE(a.quantile(0), a.quantile(1));
+
+    // merge is the sketch of the concatenated vals
+    kll_sketch m = a;
+    m.merge(b);
+    ASSERT_EQ(uint64_t(2 * n), m.n);
+    EXPECT_NEAR(n, m.quantile(0.5), 0.1 * n);
+    EXPECT_NEAR(0.5 * n, m.quantile(0.25), 0.1 * n);
+
+    // serialize/deserialize round trip, truncated states are rejected
+    std::string s;
+    m.serialize(s);
+    kll_sketch d;
+    ASSERT_EQ(0, d.deserialize(reinterpret_cast<const uint8_t*>(s.data()),
+                               s.size()));
+    ASSERT_EQ(m.n, d.n);
+    ASSERT_EQ(m.levels, d.levels);
+    ASSERT_EQ(m.quantile(0.5), d.quantile(0.5));
+    ASSERT_NE(0, d.deserialize(reinterpret_cast<const uint8_t*>(s.data()),
+                               s.size() - 1));
+}
+
+TEST(ClsTabularUtils, sketch_param)
+{
+    schema_vec sc;
+    sc.push_back(col_info(0, SDT_INT64, true, false, "ID"));
+    std::string plan, errmsg;
+    ASSERT_EQ(0, encodeQueryPlan(schemaToString(sc), schemaToString(sc), "",
+                                 ";id,approx_quantile,0.5", false, "", "",
+                                 "", "", "", plan, errmsg));
+    const QueryPlan* qp = verifyQueryPlan(plan.data(), plan.size());
+    ASSERT_NE(nullptr, qp);
+    predicate_vec preds;
+    ASSERT_EQ(0, predsFromPlan(sc, qp->query_preds(), preds, errmsg));
+    ASSERT_EQ(1u, preds.size());
+    for (auto p : preds) delete p;
+
+    // a param that is not a number in [0,1] is an error, not an exception
+    for (std::string bad : {"abc", "0.5x", "2", "-0.1"}) {
+        plan.clear();
+        ASSERT_EQ(0, encodeQueryPlan(schemaToString(sc), schemaToString(sc),
+                                     "", ";id,approx_distinct," + bad, false,
+                                     "", "", "", "", "", plan, errmsg));
+        qp = verifyQueryPlan(plan.data(), plan.size());
+        ASSERT_NE(nullptr, qp);
+        predicate_vec none;
+        ASSERT_EQ(TablesErrCodes::BadSketchParam,
+                  predsFromPlan(sc, qp->query_preds(), none, errmsg)) << bad;
+        ASSERT_TRUE(none.empty());
+    }
+}
+
+// the row by row PG binary COPY encoding printFlatbufFlexRowAsPGBinary had
+// before it was made colwise, as the reference for its output bytes.
+static std::string pg_binary_rowwise(const char* dataptr, size_t datasz,
+                                     bool print_header,
+                                     long long int max_to_print)
+{
+    sky_root root = getSkyRoot(dataptr, datasz, SFT_FLATBUF_FLEX_ROW);
+    schema_vec sc = schemaFromString(root.data_schema);
+    std::string out;
+    auto put = [&out](const void* p, size_t n) {
+        out.append(reinterpret_cast<const char*>(p), n);
+    };
+    auto put_be = [&put](uint64_t v, size_t n) {
+        for (size_t b = n; b-- > 0; ) {
+            uint8_t c = v >> (8 * b);
+            put(&c, 1);
+        }
+    };
+    if (print_header) {
+        put("PGCOPY\n\377\r\n\0", 11);
+        put_be(0, 4);
+        put_be(0, 4);
+    }
+    long long int counter = 0;
+    for (uint32_t i = 0; i < root.nrows; i++, counter++) {
+        if (counter >= max_to_print) break;
+        if (root.delete_vec.at(i) == 1) continue;
+        sky_rec rec = getSkyRec(static_cast<row_offs>(root.data_vec)->Get(i));
+        auto row = rec.data.AsVector();
+        put_be(sc.size(), 2);
+        for (unsigned j = 0; j < sc.size(); j++) {
+            const col_info& col = sc[j];
+            if (col.nullable and
+                (rec.nullbits.at(col.idx / 64) >> (col.idx % 64)) & 1) {
+                put_be(static_cast<uint32_t>(PGNULLBINARY), 4);
+                continue;
+            }
+            switch (col.type) {
+                case SDT_BOOL: put_be(1, 4);
+                               put_be(row[j].AsBool(), 1); break;
+                case SDT_INT8:
+                case SDT_CHAR: put_be(1, 4);
+                               put_be(static_cast<uint8_t>(row[j].AsInt8()), 1);
+                               break;
+                case SDT_UINT8:
+                case SDT_UCHAR: put_be(1, 4); put_be(row[j].AsUInt8(), 1);
+                                break;
+                case SDT_INT16: put_be(2, 4);
+                                put_be(static_cast<uint16_t>(row[j].AsInt16()), 2);
+                                break;
+                case SDT_UINT16: put_be(2, 4); put_be(row[j].AsUInt16(), 2);
+                                 break;
+                case SDT_INT32: put_be(4, 4);
+                                put_be(static_cast<uint32_t>(row[j].AsInt32()), 4);
+                                break;
+                case SDT_UINT32: put_be(4, 4); put_be(row[j].AsUInt32(), 4);
+                                 break;
+                case SDT_INT64: put_be(8, 4); put_be(row[j].AsInt64(), 8);
+                                break;
+                case SDT_UINT64: put_be(8, 4); put_be(row[j].AsUInt64(), 8);
+                                 break;
+                case SDT_FLOAT:
+                case SDT_DOUBLE: {
+                    double d = col.type == SDT_FLOAT ? row[j].AsFloat() :
+                                                       row[j].AsDouble();
+                    uint64_t u;
+                    memcpy(&u, &d, sizeof(u));
+                    put_be(8, 4);
+                    put_be(u, 8);
+                    break;
+                }
+                case SDT_DATE:
+                    put_be(4, 4);
+                    put_be(static_cast<uint32_t>(flexDateToDays(row[j]) +
+                           (UNIX_EPOCH_JDATE - POSTGRES_EPOCH_JDATE)), 4);
+                    break;
+                case SDT_STRING: {
+                    std::string s = row[j].AsString().str();
+                    put_be(s.length(), 4);
+                    put(s.data(), s.length());
+                    break;
+                }
+                default:
+                    assert (TablesErrCodes::UnknownSkyDataType == 0);
+            }
+        }
+    }
+    return out;
+}
+
+TEST(ClsTabularUtils, pg_binary_matches_rowwise)
+{
+    // nullable cols on both nullbits words, i.e., beyond idx 31 and 63
+    schema_vec sc;
+    sc.push_back(col_info(0, SDT_INT64, true, false, "ID"));
+    sc.push_back(col_info(1, SDT_STRING, false, true, "NAME"));
+    sc.push_back(col_info(2, SDT_DATE, false, false, "DAY"));
+    sc.push_back(col_info(3, SDT_DOUBLE, false, true, "PRICE"));
+    sc.push_back(col_info(4, SDT_FLOAT, false, false, "RATE"));
+    sc.push_back(col_info(5, SDT_INT16, false, false, "QTY"));
+    sc.push_back(col_info(6, SDT_UINT8, false, false, "FLAG"));
+    sc.push_back(col_info(7, SDT_BOOL, false, false, "OK"));
+    sc.push_back(col_info(8, SDT_CHAR, false, false, "CODE"));
+    sc.push_back(col_info(9, SDT_UINT32, false, false, "CNT"));
+    sc.push_back(col_info(10, SDT_UINT64, false, false, "BIG"));
+    sc.push_back(col_info(33, SDT_INT32, false, true, "LATE"));
+    sc.push_back(col_info(70, SDT_STRING, false, true, "NOTE"));
+
+    flatbuffers::FlatBufferBuilder fbb;
+    std::vector<flatbuffers::Offset<Record>> rows;
+    delete_vector dv;
+    const uint32_t nrows = 12;
+    for (uint32_t i = 0; i < nrows; i++) {
+        std::vector<uint64_t> nullbits(2, 0);
+        if (i % 3 == 0) nullbits[0] |= uint64_t(1) << 1;
+        if (i % 4 == 1) nullbits[0] |= uint64_t(1) << 3;
+        if (i % 2 == 0) nullbits[0] |= uint64_t(1) << 33;
+        if (i % 5 == 2) nullbits[1] |= uint64_t(1) << (70 - 64);
+        flexbuffers::Builder flx;
+        flx.Vector([&]() {
+            flx.Add(static_cast<int64_t>(i) - 5);
+            flx.Add(nullbits[0] & (uint64_t(1) << 1) ? "" :
+                    std::string(i, 'a' + i).c_str());
+            flx.Add(dateToDays("1995-03-0" + std::to_string(1 + i % 9)));
+            flx.Add(i * 1.25);
+            flx.Add(static_cast<float>(i) / 3);
+            flx.Add(static_cast<int16_t>(-300 * i));
+            flx.Add(static_cast<uint8_t>(250 + i));
+            flx.Add(i % 2 == 1);
+            flx.Add(static_cast<char>('A' + i));
+            flx.Add(static_cast<uint32_t>(4000000000u - i));
+            flx.Add(static_cast<uint64_t>(UINT64_MAX - i));
+            flx.Add(static_cast<int32_t>(-70000 * static_cast<int>(i)));
+            flx.Add("note");
+        });
+        flx.Finish();
+        auto data = fbb.CreateVector(flx.GetBuffer());
+        auto nulls = fbb.CreateVector(nullbits);
+        rows.push_back(CreateRecord(fbb, i, nulls, data));
+        dv.push_back(i == 4 ? 1 : 0);  // a dead row is skipped
+    }
+    auto root = CreateTable(fbb, SFT_FLATBUF_FLEX_ROW, 2, 1, 1,
+                            fbb.CreateString(schemaToString(sc)),
+                            fbb.CreateString("*"), fbb.CreateString("t"),
+                            fbb.CreateVector(dv), fbb.CreateVector(rows),
+                            nrows);
+    fbb.Finish(root);
+    const char* data = reinterpret_cast<const char*>(fbb.GetBufferPointer());
+    size_t size = fbb.GetSize();
+
+    for (bool header : {true, false}) {
+        for (long long int limit : {LLONG_MAX, 7LL, 0LL}) {
+            std::stringstream ss;
+            std::streambuf* cout_buf = std::cout.rdbuf(ss.rdbuf());
+            long long int n = printFlatbufFlexRowAsPGBinary(data, size, header,
+                                                            false, limit);
+            std::cout.rdbuf(cout_buf);
+            ASSERT_EQ(std::min<long long int>(limit, nrows), n);
+            ASSERT_EQ(pg_binary_rowwise(data, size, header, limit), ss.str())
+                << "header=" << header << " limit=" << limit;
+        }
+    }
+}
+
+// the val of the global agg of preds (as double) after merging the groups
+static double rollup_agg(schema_vec& sc, const std::string& query,
+                         const std::vector<int>& agg_map,
+                         const rollup_groups& groups)
+{
+    predicate_vec preds = predsFromString(sc, query);
+    std::string errmsg;
+    EXPECT_EQ(0, rollupMergeGroups(preds, agg_map, groups, errmsg)) << errmsg;
+    double val = 0;
+    for (auto p : preds) {
+        if (p->isGlobalAgg())
+            val = dynamic_cast<TypedPredicate<double>*>(p)->Val();
+        delete p;
+    }
+    return val;
+}
+
+TEST(ClsTabularUtils, rollup)
+{
+    schema_vec sc;
+    sc.push_back(col_info(0, SDT_INT64, true, false, "ID"));
+    sc.push_back(col_info(1, SDT_INT64, false, false, "GRP"));
+    sc.push_back(col_info(2, SDT_STRING, false, false, "FLAG"));
+    sc.push_back(col_info(3, SDT_DOUBLE, false, false, "QTY"));
+    schema_vec group_sc = schemaFromColNames(sc, "FLAG,GRP");
+    ASSERT_EQ(2u, group_sc.size());
+    const std::string aggs = ";qty,sum,0;qty,cnt,0;qty,max,0";
+    csv_rows csv = {{"0", "1", "A", "1.5"},
+                    {"0", "2", "B", "2.5"},
+                    {"0", "1", "A", "3.0"},
+                    {"0", "2", "A", "4.0"}};
+
+    // two fbs, of 8 and 4 rows, so groups (1,A) (2,B) (2,A) have
+    // sums 13.5 7.5 12 and cnts 6 3 3
+    rollup_groups groups;
+    std::string errmsg;
+    for (uint32_t nrows : {8u, 4u}) {
+        flatbuffers::FlatBufferBuilder fbb;
+        build_flexrow_blob(fbb, sc, csv, 0, nrows, "t", true);
+        ASSERT_EQ(0, rollupAddRows(sc, group_sc, aggs,
+            reinterpret_cast<const char*>(fbb.GetBufferPointer()),
+            fbb.GetSize(), groups, errmsg)) << errmsg;
+    }
+    ASSERT_EQ(3u, groups.size());
+
+    predicate_vec rollup_aggs = predsFromString(sc, aggs);
+    ASSERT_EQ(0, rollupCheckAggs(rollup_aggs, errmsg)) << errmsg;
+
+    // aggs of the rollup, with preds on the group cols evaluated on the
+    // group keys, i.e., the group col vals round trip through the keys
+    struct {
+        std::string query;
+        std::vector<int> agg_map;
+        double val;
+    } cases[] = {
+        {";qty,sum,0", {0}, 33},
+        {";qty,cnt,0", {1}, 12},
+        {";qty,max,0", {2}, 4},
+        {";flag,eq,A;qty,sum,0", {0}, 25.5},
+        {";flag,eq,B;qty,max,0", {2}, 2.5},
+        {";grp,eq,2;qty,cnt,0", {1}, 6},
+        {";grp,eq,1;flag,eq,B;qty,cnt,0", {1}, 0},
+        {";grp,geq,2;flag,eq,A;qty,sum,0", {0}, 12},
+    };
+    for (auto& c : cases) {
+        predicate_vec query = predsFromString(sc, c.query);
+        std::vector<int> agg_map;
+        ASSERT_TRUE(rollupMatchesQuery(query, rollup_aggs, group_sc, agg_map))
+            << c.query;
+        ASSERT_EQ(c.agg_map, agg_map) << c.query;
+        for (auto p : query) delete p;
+        ASSERT_EQ(c.val, rollup_agg(sc, c.query, agg_map, groups)) << c.query;
+    }
+
+    // a pred on another col, an agg not in the rollup or no agg at all
+    // cannot be answered from the rollup
+    for (std::string q : {";id,lt,5;qty,sum,0", ";qty,min,0", ";flag,eq,A"}) {
+        predicate_vec query = predsFromString(sc, q);
+        std::vector<int> agg_map;
+        ASSERT_FALSE(rollupMatchesQuery(query, rollup_aggs, group_sc, agg_map))
+            << q;
+        for (auto p : query) delete p;
+    }
+    for (auto p : rollup_aggs) delete p;
+
+    // groups of other aggs are a bad state
+    flatbuffers::FlatBufferBuilder fbb;
+    build_flexrow_blob(fbb, sc, csv, 0, 4, "t", true);
+    ASSERT_EQ(TablesErrCodes::BadRollupState,
+              rollupAddRows(sc, group_sc, ";qty,sum,0",
+                  reinterpret_cast<const char*>(fbb.GetBufferPointer()),
+                  fbb.GetSize(), groups, errmsg));
+
+    // stale once the obj is not exactly the bytes the rollup covers
+    rollup_info rollup;
+    rollup.obj_size = 4096;
+    ASSERT_FALSE(rollupIsStale(rollup, 4096));
+    ASSERT_TRUE(rollupIsStale(rollup, 4096 + 512));
+    ASSERT_TRUE(rollupIsStale(rollup, 0));
+}
+
+// the rows of the fb passing preds
+static std::vector<uint32_t> passing_rows(const char* data, size_t size,
+                                          predicate_vec& preds)
+{
+    std::vector<uint32_t> rows;
+    sky_root root = getSkyRoot(data, size, SFT_FLATBUF_FLEX_ROW);
+    for (uint32_t i = 0; i < root.nrows; i++) {
+        sky_rec rec = getSkyRec(static_cast<row_offs>(root.data_vec)->Get(i));
+        if (applyPredicates(preds, rec))
+            rows.push_back(i);
+    }
+    return rows;
+}
+
+TEST(ClsTabularUtils, dict_encoding)
+{
+    schema_vec sc;
+    sc.push_back(col_info(0, SDT_INT64, true, false, "ID"));
+    sc.push_back(col_info(1, SDT_STRING, false, false, "FLAG"));
+    sc.push_back(col_info(2, SDT_STRING, false, false, "NAME"));
+    sc.push_back(col_info(3, SDT_DOUBLE, false, false, "QTY"));
+    const uint32_t nrows = 20;
+    const std::string flags[] = {"A", "B", "C", "A"};
+    csv_rows csv;
+    for (uint32_t i = 0; i < nrows; i++)
+        csv.push_back({"0", flags[i % 4], "name" + std::to_string(i),
+                       std::to_string(i * 0.5)});
+    flatbuffers::FlatBufferBuilder fbb;
+    build_flexrow_blob(fbb, sc, csv, 0, nrows, "t", true);
+    const char* data = reinterpret_cast<const char*>(fbb.GetBufferPointer());
+    ASSERT_FALSE(hasSkyDicts(data));
+
+    // FLAG has 3 distinct vals, NAME one per row, over DICT_MAX_VALS_RATIO
+    // of the rows, so it stays plain strings
+    schema_vec dict_cols = schemaFromColNames(sc, "FLAG,NAME");
+    flatbuffers::FlatBufferBuilder enc;
+    std::string errmsg;
+    ASSERT_EQ(0, encodeSkyDicts(data, fbb.GetSize(), dict_cols, enc, errmsg))
+        << errmsg;
+    const char* enc_data = reinterpret_cast<const char*>(enc.GetBufferPointer());
+    flexbuffers::Vector dicts = getSkyDicts(enc_data);
+    ASSERT_EQ(sc.size(), dicts.size());
+    ASSERT_TRUE(dicts[0].IsNull());
+    ASSERT_TRUE(dicts[1].IsVector());
+    ASSERT_TRUE(dicts[2].IsNull());
+    ASSERT_TRUE(dicts[3].IsNull());
+    auto flag_dict = dicts[1].AsVector();
+    ASSERT_EQ(3u, flag_dict.size());
+    ASSERT_EQ("A", flag_dict[0].AsString().str());
+    ASSERT_EQ("B", flag_dict[1].AsString().str());
+    ASSERT_EQ("C", flag_dict[2].AsString().str());
+
+    // an encoded fb is not encoded again
+    flatbuffers::FlatBufferBuilder enc2;
+    ASSERT_EQ(TablesErrCodes::BadDictEncoding,
+              encodeSkyDicts(enc_data, enc.GetSize(), dict_cols, enc2,
+                             errmsg));
+
+    // no dicts at all when no col is encoded
+    schema_vec name_col = schemaFromColNames(sc, "NAME");
+    flatbuffers::FlatBufferBuilder plain;
+    ASSERT_EQ(0, encodeSkyDicts(data, fbb.GetSize(), name_col, plain, errmsg))
+        << errmsg;
+    ASSERT_FALSE(hasSkyDicts(
+        reinterpret_cast<const char*>(plain.GetBufferPointer())));
+
+    // decode round trip
+    flatbuffers::FlatBufferBuilder dec;
+    ASSERT_EQ(0, decodeSkyDicts(enc_data, enc.GetSize(), dec, errmsg))
+        << errmsg;
+    const char* dec_data = reinterpret_cast<const char*>(dec.GetBufferPointer());
+    ASSERT_FALSE(hasSkyDicts(dec_data));
+    sky_root root = getSkyRoot(data, fbb.GetSize(), SFT_FLATBUF_FLEX_ROW);
+    sky_root enc_root = getSkyRoot(enc_data, enc.GetSize(),
+                                   SFT_FLATBUF_FLEX_ROW);
+    sky_root dec_root = getSkyRoot(dec_data, dec.GetSize(),
+                                   SFT_FLATBUF_FLEX_ROW);
+    ASSERT_EQ(root.nrows, dec_root.nrows);
+    ASSERT_EQ(root.data_schema, dec_root.data_schema);
+    for (uint32_t i = 0; i < nrows; i++) {
+        sky_rec rec = getSkyRec(static_cast<row_offs>(root.data_vec)->Get(i));
+        sky_rec enc_rec = getSkyRec(
+            static_cast<row_offs>(enc_root.data_vec)->Get(i));
+        sky_rec dec_rec = getSkyRec(
+            static_cast<row_offs>(dec_root.data_vec)->Get(i));
+        auto row = rec.data.AsVector();
+        auto enc_row = enc_rec.data.AsVector();
+        auto dec_row = dec_rec.data.AsVector();
+        ASSERT_EQ(rec.RID, dec_rec.RID);
+        ASSERT_EQ((i % 4 == 3) ? 0u : i % 4, enc_row[1].AsUInt64());
+        ASSERT_EQ(row[0].AsInt64(), dec_row[0].AsInt64());
+        ASSERT_EQ(row[1].AsString().str(), dec_row[1].AsString().str());
+        ASSERT_EQ(row[2].AsString().str(), dec_row[2].AsString().str());
+        ASSERT_EQ(row[3].AsDouble(), dec_row[3].AsDouble());
+    }
+
+    // preds over the codes pass the same rows as over the strings
+    std::vector<std::string> queries = {
+        ";flag,eq,B",
+        ";flag,ne,A",
+        ";flag,like,[BC]",
+        ";flag,in,A|C",
+        ";flag,in,C;qty,lt,5",
+        ";flag,eq,Z",
+    };
+    for (auto& q : queries) {
+        predicate_vec preds = predsFromString(sc, q);
+        predicate_vec dict_preds = dictPredicates(preds, dicts);
+        ASSERT_EQ(preds.size(), dict_preds.size());
+        ASSERT_EQ(SOT_dict_code, dict_preds[0]->opType()) << q;
+        std::vector<uint32_t> expect = passing_rows(data, fbb.GetSize(), preds);
+        ASSERT_EQ(expect, passing_rows(enc_data, enc.GetSize(), dict_preds))
+            << q;
+        deleteDictPredicates(dict_preds);
+        for (auto p : preds) delete p;
+    }
+
+    // a chained or, of a pred over the codes and one over plain strings
+    predicate_vec preds;
+    preds.push_back(new TypedPredicate<std::string>(1, SDT_STRING, SOT_eq,
+                                                    "C", SOT_logical_or));
+    preds.push_back(new TypedPredicate<std::string>(2, SDT_STRING, SOT_eq,
+                                                    "name0", SOT_logical_or));
+    predicate_vec dict_preds = dictPredicates(preds, dicts);
+    ASSERT_EQ(SOT_dict_code, dict_preds[0]->opType());
+    ASSERT_EQ(SOT_logical_or, dict_preds[0]->chainOpType());
+    ASSERT_EQ(preds[1], dict_preds[1]);
+    std::vector<uint32_t> expect = {0, 2, 6, 10, 14, 18};
+    ASSERT_EQ(expect, passing_rows(data, fbb.GetSize(), preds));
+    ASSERT_EQ(expect, passing_rows(enc_data, enc.GetSize(), dict_preds));
+    deleteDictPredicates(dict_preds);
+    for (auto p : preds) delete p;
+}
+
+TEST(ClsTabularUtils, semijoin_agg)
+{
+    schema_vec sc;
+    sc.push_back(col_info(0, SDT_INT64, true, false, "ID"));
+    sc.push_back(col_info(1, SDT_DOUBLE, false, false, "QTY"));
+    csv_rows csv = {{"0", "1.0"}, {"0", "2.0"}};
+
+    // build side, the keys of a dimension table of ids 0..99
+    flatbuffers::FlatBufferBuilder dim;
+    build_flexrow_blob(dim, sc, csv, 0, 100, "dim", true);
+    int key_type = 0;
+    std::unordered_set<std::string> keys;
+    std::string errmsg;
+    ASSERT_EQ(0, semiJoinCollectKeys(
+        reinterpret_cast<const char*>(dim.GetBufferPointer()), dim.GetSize(),
+        SFT_FLATBUF_FLEX_ROW, "ID", key_type, keys, errmsg)) << errmsg;
+    ASSERT_EQ(SDT_INT64, key_type);
+    ASSERT_EQ(100u, keys.size());
+    semijoin_filter f = semiJoinBuildFilter(key_type, keys);
+    ASSERT_FALSE(f.use_bloom);
+
+    // probe side, a fact table of ids 0..299 with qty 1, 2, 1, 2, ...
+    flatbuffers::FlatBufferBuilder fact;
+    build_flexrow_blob(fact, sc, csv, 0, 300, "fact", true);
+    sky_root root = getSkyRoot(
+        reinterpret_cast<const char*>(fact.GetBufferPointer()),
+        fact.GetSize(), SFT_FLATBUF_FLEX_ROW);
+
+    // the probe pred goes ahead of the aggs, so they only see the joined
+    // rows, ids 0..99 summing to 150
+    predicate_vec preds = predsFromString(sc, ";qty,sum,0;qty,cnt,0");
+    PredicateBase* probe = semiJoinPredicate(sc[0], f);
+    addSemiJoinPredicate(preds, probe);
+    ASSERT_EQ(3u, preds.size());
+    ASSERT_EQ(probe, preds[0]);
+    for (uint32_t i = 0; i < root.nrows; i++) {
+        sky_rec rec = getSkyRec(static_cast<row_offs>(root.data_vec)->Get(i));
+        ASSERT_EQ(i < 100, applyPredicates(preds, rec)) << i;
+    }
+    ASSERT_EQ(150, dynamic_cast<TypedPredicate<double>*>(preds[1])->Val());
+    ASSERT_EQ(100, dynamic_cast<TypedPredicate<double>*>(preds[2])->Val());
+    for (auto p : preds) delete p;
+
+    // also behind other preds, still ahead of the aggs
+    preds = predsFromString(sc, ";id,geq,50;qty,sum,0");
+    probe = semiJoinPredicate(sc[0], f);
+    addSemiJoinPredicate(preds, probe);
+    ASSERT_EQ(probe, preds[1]);
+    for (uint32_t i = 0; i < root.nrows; i++) {
+        sky_rec rec = getSkyRec(static_cast<row_offs>(root.data_vec)->Get(i));
+        applyPredicates(preds, rec);
+    }
+    ASSERT_EQ(75, dynamic_cast<TypedPredicate<double>*>(preds[2])->Val());
+    for (auto p : preds) delete p;
+}
+
+TEST(ClsTabularUtils, semijoin_bloom_vs_exact)
+{
+    // even keys, one set at the exact max and one over it
+    for (size_t nkeys : {SEMIJOIN_EXACT_MAX, 4 * SEMIJOIN_EXACT_MAX}) {
+        std::unordered_set<std::string> int_keys, str_keys;
+        for (int64_t i = 0; i < static_cast<int64_t>(nkeys); i++) {
+            int_keys.insert(semiJoinKey(2 * i));
+            str_keys.insert("k" + std::to_string(2 * i));
+        }
+        semijoin_filter fi = semiJoinBuildFilter(SDT_INT64, int_keys);
+        semijoin_filter fs = semiJoinBuildFilter(SDT_STRING, str_keys);
+        bool bloom = nkeys > SEMIJOIN_EXACT_MAX;
+        ASSERT_EQ(bloom, fi.use_bloom);
+        ASSERT_EQ(bloom, fs.use_bloom);
+        ASSERT_EQ(nkeys, fi.size());
+
+        // a filter survives its encoding, as sent to the cls
+        bufferlist bl;
+        ::encode(fi, bl);
+        semijoin_filter fd;
+        bufferlist::iterator it = bl.begin();
+        ::decode(fd, it);
+
+        col_info id_col(0, SDT_INT64, true, false, "ID");
+        col_info name_col(0, SDT_STRING, false, false, "NAME");
+        PredicateBase* pi = semiJoinPredicate(id_col, fd);
+        PredicateBase* ps = semiJoinPredicate(name_col, fs);
+        auto pvi = dynamic_cast<TypedPredicate<int64_t>*>(pi);
+        auto pvs = dynamic_cast<TypedPredicate<std::string>*>(ps);
+        ASSERT_TRUE(pvi and pvs);
+
+        // no false negatives, and only the bloom filter has false positives,
+        // within a few times SEMIJOIN_BLOOM_FPP
+        size_t fp_int = 0, fp_str = 0;
+        for (int64_t i = 0; i < static_cast<int64_t>(2 * nkeys); i++) {
+            bool member = (i % 2 == 0);
+            bool in_int = pvi->probe(i);
+            bool in_str = pvs->probe("k" + std::to_string(i));
+            if (member) {
+                ASSERT_TRUE(in_int) << i;
+                ASSERT_TRUE(in_str) << i;
+            }
+            else {
+                fp_int += in_int;
+                fp_str += in_str;
+            }
+        }
+        if (!bloom) {
+            ASSERT_EQ(0u, fp_int);
+            ASSERT_EQ(0u, fp_str);
+        }
+        else {
+            ASSERT_LT(fp_int, 3 * SEMIJOIN_BLOOM_FPP * nkeys);
+            ASSERT_LT(fp_str, 3 * SEMIJOIN_BLOOM_FPP * nkeys);
+        }
+        delete pi;
+        delete ps;
+    }
+}
+
+// each val's key data is memcmp ordered like the vals themselves
+template <typename T>
+static void check_key_order(int data_type, const std::vector<T>& vals)
+{
+    for (size_t i = 1; i < vals.size(); i++) {
+        std::string a, b;
+        appendIndexKeyData(a, data_type, vals[i - 1]);
+        appendIndexKeyData(b, data_type, vals[i]);
+        size_t n = std::min(a.size(), b.size());
+        int c = memcmp(a.data(), b.data(), n);
+        ASSERT_TRUE(c < 0 or (c == 0 and a.size() < b.size()))
+            << "type " << data_type << " val " << i;
+    }
+}
+
+TEST(ClsTabularUtils, index_key_order)
+{
+    check_key_order<int64_t>(SDT_INT64, {LLONG_MIN, -1000000, -2, -1, 0, 1,
+                                         255, 256, LLONG_MAX});
+    check_key_order<int64_t>(SDT_INT32, {INT_MIN, -70000, -1, 0, 1, INT_MAX});
+    check_key_order<int64_t>(SDT_INT8, {-128, -1, 0, 127});
+    check_key_order<uint64_t>(SDT_UINT64, {0, 1, 255, 256, 1ULL << 63,
+                                           ULLONG_MAX});
+    check_key_order<uint64_t>(SDT_UINT16, {0, 255, 256, 65535});
+    check_key_order<double>(SDT_DOUBLE, {-INFINITY, -1e300, -2.5, -1,
+                                         -1e-300, 0.0, 1e-300, 1, 2.5, 1e300,
+                                         INFINITY});
+    check_key_order<double>(SDT_FLOAT, {-1e30, -2.5, -0.5, 0.0, 0.5, 2.5,
+                                        1e30});
+    check_key_order<int64_t>(SDT_DATE, {dateToDays("1900-02-28"),
+                                        dateToDays("1969-12-31"),
+                                        dateToDays("1970-01-01"),
+                                        dateToDays("1992-01-01"),
+                                        dateToDays("1992-01-02"),
+                                        dateToDays("2038-01-20")});
+    check_key_order<std::string>(SDT_STRING, {std::string(""),
+                                              std::string("\0", 1),
+                                              std::string("\0\0", 2),
+                                              std::string("\x01", 1),
+                                              std::string("ab"),
+                                              std::string("ab\0", 3),
+                                              std::string("ab\0\0", 4),
+                                              std::string("ab\0a", 4),
+                                              std::string("abc"),
+                                              std::string("abc\xff"),
+                                              std::string("b")});
+
+    // -0.0 and 0.0 are the same key
+    std::string neg_zero, pos_zero;
+    appendIndexKeyData(neg_zero, SDT_DOUBLE, -0.0);
+    appendIndexKeyData(pos_zero, SDT_DOUBLE, 0.0);
+    ASSERT_EQ(pos_zero, neg_zero);
+    neg_zero.clear();
+    pos_zero.clear();
+    appendIndexKeyData(neg_zero, SDT_FLOAT, -0.0);
+    appendIndexKeyData(pos_zero, SDT_FLOAT, 0.0);
+    ASSERT_EQ(pos_zero, neg_zero);
+
+    // a multicol key is ordered by its first col, then the next, so a string
+    // is not ordered by a following col, e.g., ("ab", "z") < ("abc", "a")
+    std::string k1, k2;
+    appendIndexKeyData(k1, SDT_STRING, std::string("ab"));
+    appendIndexKeyData(k1, SDT_STRING, std::string("z"));
+    appendIndexKeyData(k2, SDT_STRING, std::string("abc"));
+    appendIndexKeyData(k2, SDT_STRING, std::string("a"));
+    ASSERT_LT(memcmp(k1.data(), k2.data(), std::min(k1.size(), k2.size())),
+              0);
+    k1.clear();
+    k2.clear();
+    appendIndexKeyData(k1, SDT_INT64, static_cast<int64_t>(-1));
+    appendIndexKeyData(k1, SDT_DOUBLE, 100.0);
+    appendIndexKeyData(k2, SDT_INT64, static_cast<int64_t>(0));
+    appendIndexKeyData(k2, SDT_DOUBLE, -100.0);
+    ASSERT_LT(memcmp(k1.data(), k2.data(), std::min(k1.size(), k2.size())),
+              0);
+
+    // the key data version is in the IDX_RID/IDX_REC prefix, so the indexes
+    // of an older key data format are not found, nor scanned with these
+    std::vector<std::string> cols = {"ORDERKEY"};
+    std::string rec = buildKeyPrefix(SIT_IDX_REC, "db", "t", cols);
+    std::string rec1 = buildKeyPrefix(SIT_IDX_REC, "db", "t", cols, 1);
+    std::string rid = buildKeyPrefix(SIT_IDX_RID, "db", "t", cols);
+    std::string rid1 = buildKeyPrefix(SIT_IDX_RID, "db", "t", cols, 1);
+    ASSERT_EQ(0u, rec1.find("IDX_REC" + IDX_KEY_DELIM_OUTER));
+    ASSERT_EQ(0u, rid1.find("IDX_RID" + IDX_KEY_DELIM_OUTER));
+    ASSERT_EQ(0u, rec.find("IDX_REC" + std::to_string(IDX_KEY_DATA_VERSION) +
+                           IDX_KEY_DELIM_OUTER));
+    ASSERT_EQ(0u, rid.find("IDX_RID" + std::to_string(IDX_KEY_DATA_VERSION) +
+                           IDX_KEY_DELIM_OUTER));
+    ASSERT_NE(0u, rec.find(rec1));
+    ASSERT_NE(0u, rec1.find(rec));
+    ASSERT_NE(0u, rid.find(rid1));
+
+    // the other index types are not versioned
+    ASSERT_EQ(buildKeyPrefix(SIT_IDX_TXT, "db", "t", cols),
+              buildKeyPrefix(SIT_IDX_TXT, "db", "t", cols, 1));
+    ASSERT_EQ(buildKeyPrefix(SIT_IDX_FB, "db", "t"),
+              buildKeyPrefix(SIT_IDX_FB, "db", "t", {}, 1));
+}
+
+// an in-memory omap of IDX_REC key data to RIDs, walked like read_sky_index
+// does: an eq prefix scan of the leading eq cols up to the range col, or a
+// skip scan of the leading col vals for the preds on the next cols.
+typedef std::map<std::string, uint64_t> index_omap;
+
+static void index_scan(const index_omap& omap, const schema_vec& sc,
+                       const index_range_vec& ranges,
+                       const std::string& prefix, const std::string& start,
+                       int range_col, std::set<uint64_t>& rids)
+{
+    std::vector<std::string> col_vals;
+    for (auto it = omap.lower_bound(start);
+         it != omap.end() and it->first.compare(0, prefix.size(), prefix) == 0;
+         ++it) {
+        if (!splitIndexKeyData(sc, it->first, col_vals))
+            continue;
+        if (range_col >= 0 and
+            indexColPastRange(ranges[range_col], col_vals[range_col]))
+            return;
+        bool match = true;
+        for (unsigned j = 0; j < ranges.size() and match; j++)
+            match = indexColInRange(ranges[j], col_vals[j]);
+        if (match)
+            rids.insert(it->second);
+    }
+}
+
+static void index_scan_prefixes(const index_omap& omap, const schema_vec& sc,
+                                const index_range_vec& ranges,
+                                const std::string& base, unsigned c0,
+                                std::set<uint64_t>& rids)
+{
+    std::vector<std::string> prefixes(1, base);
+    unsigned j = c0;
+    for (; j < ranges.size() and ranges[j].has_eq; j++) {
+        std::vector<std::string> next;
+        for (auto& p : prefixes) {
+            for (auto& v : ranges[j].eq_vals)
+                next.push_back(p + (j > 0 ? IDX_KEY_DELIM_INNER : "") + v);
+        }
+        prefixes.swap(next);
+    }
+    for (auto& p : prefixes) {
+        if (j == ranges.size()) {
+            index_scan(omap, sc, ranges, p, p, -1, rids);
+            continue;
+        }
+        std::string start = p + (j > 0 ? IDX_KEY_DELIM_INNER : "");
+        if (ranges[j].has_lo)
+            start += ranges[j].lo;
+        index_scan(omap, sc, ranges, p, start, j, rids);
+    }
+}
+
+static std::set<uint64_t> index_lookup(const index_omap& omap,
+                                       schema_vec& sc,
+                                       const std::string& preds_str)
+{
+    predicate_vec preds = predsFromString(sc, preds_str);
+    index_range_vec ranges = indexColRanges(sc, preds);
+    for (auto p : preds) delete p;
+
+    std::set<uint64_t> rids;
+    for (auto& r : ranges) {
+        if (r.has_eq and r.eq_vals.empty())
+            return rids;
+    }
+
+    // a col's vals past its range are never back in it, so the scans may
+    // stop at the first one
+    for (unsigned j = 0; j < ranges.size(); j++) {
+        std::set<std::string> vals;
+        std::vector<std::string> col_vals;
+        for (auto& kv : omap) {
+            if (splitIndexKeyData(sc, kv.first, col_vals))
+                vals.insert(col_vals[j]);
+        }
+        bool past = false;
+        for (auto& v : vals) {
+            bool p = indexColPastRange(ranges[j], v);
+            EXPECT_TRUE(p or !past) << preds_str << " col " << j;
+            EXPECT_FALSE(p and indexColInRange(ranges[j], v)) << preds_str;
+            past = p;
+        }
+    }
+
+    bool skip_scan = ranges.size() > 1 and !ranges[0].has_eq and
+                     ranges[1].constrained();
+    if (!skip_scan) {
+        index_scan_prefixes(omap, sc, ranges, "", 0, rids);
+        return rids;
+    }
+    std::vector<std::string> col_vals;
+    auto it = omap.lower_bound(ranges[0].has_lo ? ranges[0].lo : "");
+    while (it != omap.end()) {
+        EXPECT_TRUE(splitIndexKeyData(sc, it->first, col_vals));
+        if (indexColPastRange(ranges[0], col_vals[0]))
+            break;
+        if (indexColInRange(ranges[0], col_vals[0]))
+            index_scan_prefixes(omap, sc, ranges, col_vals[0], 1, rids);
+        std::string next = col_vals[0] + IDX_KEY_DELIM_INNER;
+        next.back()++;
+        it = omap.lower_bound(next);
+    }
+    return rids;
+}
+
+TEST(ClsTabularUtils, index_col_ranges)
+{
+    schema_vec sc;
+    sc.push_back(col_info(0, SDT_INT64, true, false, "A"));
+    sc.push_back(col_info(1, SDT_STRING, false, false, "B"));
+
+    // a non-unique index of (A, B), two rows per key
+    struct index_row {
+        int64_t a;
+        std::string b;
+        uint64_t rid;
+    };
+    std::vector<index_row> rows;
+    const std::vector<std::string> bs = {std::string("a"),
+                                         std::string("a\0b", 3),
+                                         std::string("a-b"),
+                                         std::string("ab"),
+                                         std::string("b"),
+                                         std::string("c")};
+    index_omap omap;
+    for (int64_t a = -3; a <= 3; a++) {
+        for (auto& b : bs) {
+            for (int k = 0; k < 2; k++) {
+                index_row r = {a, b, rows.size()};
+                rows.push_back(r);
+                std::string key;
+                appendIndexKeyData(key, SDT_INT64, a);
+                key += IDX_KEY_DELIM_INNER;
+                appendIndexKeyData(key, SDT_STRING, b);
+                key += IDX_KEY_DELIM_OUTER + IDX_KEY_DELIM_UNIQUE +
+                       IDX_KEY_DELIM_INNER + std::to_string(r.rid);
+                omap[key] = r.rid;
+            }
+        }
+    }
+
+    // the key data of each col, the RID suffix is not a col
+    std::vector<std::string> col_vals;
+    std::string a1, bnul;
+    appendIndexKeyData(a1, SDT_INT64, static_cast<int64_t>(1));
+    appendIndexKeyData(bnul, SDT_STRING, std::string("a\0b", 3));
+    ASSERT_TRUE(splitIndexKeyData(sc, a1 + IDX_KEY_DELIM_INNER + bnul +
+                                  IDX_KEY_DELIM_OUTER + IDX_KEY_DELIM_UNIQUE +
+                                  IDX_KEY_DELIM_INNER + "42", col_vals));
+    ASSERT_EQ(std::vector<std::string>({a1, bnul}), col_vals);
+    ASSERT_TRUE(splitIndexKeyData(sc, a1 + IDX_KEY_DELIM_INNER + bnul,
+                                  col_vals));
+    ASSERT_EQ(std::vector<std::string>({a1, bnul}), col_vals);
+    // the index exists marker and truncated keys are not data keys
+    ASSERT_FALSE(splitIndexKeyData(sc, "", col_vals));
+    ASSERT_FALSE(splitIndexKeyData(sc, a1, col_vals));
+    ASSERT_FALSE(splitIndexKeyData(sc, a1 + IDX_KEY_DELIM_INNER + "a",
+                                   col_vals));
+    ASSERT_FALSE(splitIndexKeyData(sc, a1.substr(1), col_vals));
+
+    // in lists are limited to the vals within any bounds on the col
+    auto key_of = [](int64_t v) {
+        std::string k;
+        appendIndexKeyData(k, SDT_INT64, v);
+        return k;
+    };
+    predicate_vec preds = predsFromString(sc,
+            ";a,in,-3|0|2|5;a,gt,-3;a,leq,2;b,geq,b");
+    index_range_vec ranges = indexColRanges(sc, preds);
+    for (auto p : preds) delete p;
+    ASSERT_EQ(2u, ranges.size());
+    ASSERT_TRUE(ranges[0].has_eq);
+    ASSERT_EQ(std::vector<std::string>({key_of(0), key_of(2)}),
+              ranges[0].eq_vals);
+    ASSERT_FALSE(ranges[1].has_eq);
+    ASSERT_TRUE(ranges[1].has_lo and ranges[1].lo_incl);
+    ASSERT_FALSE(ranges[1].has_hi);
+    ASSERT_FALSE(indexColPastRange(ranges[0], key_of(2)));
+    ASSERT_TRUE(indexColPastRange(ranges[0], key_of(3)));
+
+    // the tightest bound is kept, exclusive over inclusive on the same val
+    preds = predsFromString(sc, ";a,geq,0;a,gt,0;a,lt,2;a,leq,2");
+    ranges = indexColRanges(sc, preds);
+    for (auto p : preds) delete p;
+    ASSERT_TRUE(ranges[0].has_lo and !ranges[0].lo_incl);
+    ASSERT_TRUE(ranges[0].has_hi and !ranges[0].hi_incl);
+    ASSERT_EQ(key_of(0), ranges[0].lo);
+    ASSERT_EQ(key_of(2), ranges[0].hi);
+    ASSERT_FALSE(indexColInRange(ranges[0], key_of(0)));
+    ASSERT_TRUE(indexColInRange(ranges[0], key_of(1)));
+    ASSERT_FALSE(indexColInRange(ranges[0], key_of(2)));
+    ASSERT_FALSE(indexColPastRange(ranges[0], key_of(1)));
+    ASSERT_TRUE(indexColPastRange(ranges[0], key_of(2)));
+    ASSERT_FALSE(ranges[1].constrained());
+
+    preds = predsFromString(sc, ";a,between,-1|1");
+    ranges = indexColRanges(sc, preds);
+    for (auto p : preds) delete p;
+    ASSERT_TRUE(ranges[0].lo_incl and ranges[0].hi_incl);
+    ASSERT_TRUE(indexColInRange(ranges[0], key_of(-1)));
+    ASSERT_TRUE(indexColInRange(ranges[0], key_of(1)));
+    ASSERT_FALSE(indexColPastRange(ranges[0], key_of(1)));
+    ASSERT_TRUE(indexColPastRange(ranges[0], key_of(2)));
+
+    // the rows found through the index are those matching the preds
+    struct {
+        std::string preds;
+        std::function<bool(const index_row&)> match;
+    } cases[] = {
+        // leading col eq, trailing col range
+        {";a,eq,1;b,geq,a;b,lt,b",
+         [](const index_row& r) { return r.a == 1 and r.b >= "a" and
+                                         r.b < "b"; }},
+        {";a,eq,-2;b,gt,a;b,leq,ab",
+         [](const index_row& r) { return r.a == -2 and r.b > "a" and
+                                         r.b <= "ab"; }},
+        // leading col range, trailing col eq, a skip scan
+        {";a,gt,-2;a,leq,2;b,eq,b",
+         [](const index_row& r) { return r.a > -2 and r.a <= 2 and
+                                         r.b == "b"; }},
+        {";b,in,a|c",
+         [](const index_row& r) { return r.b == "a" or r.b == "c"; }},
+        {";a,lt,0;b,geq,ab",
+         [](const index_row& r) { return r.a < 0 and r.b >= "ab"; }},
+        // in lists with bounds
+        {";a,in,-3|0|2|5;a,gt,-3;a,leq,2;b,geq,b",
+         [](const index_row& r) { return (r.a == 0 or r.a == 2) and
+                                         r.b >= "b"; }},
+        {";a,in,-3|3;b,in,a-b|c|d",
+         [](const index_row& r) { return (r.a == -3 or r.a == 3) and
+                                         (r.b == "a-b" or r.b == "c"); }},
+        {";a,in,1|2;a,in,3",
+         [](const index_row&) { return false; }},
+        // exclusive vs inclusive bounds
+        {";a,geq,0;a,gt,0;a,lt,2;a,leq,2",
+         [](const index_row& r) { return r.a == 1; }},
+        {";a,between,-1|1;b,between,a|b",
+         [](const index_row& r) { return r.a >= -1 and r.a <= 1 and
+                                         r.b >= "a" and r.b <= "b"; }},
+        {";a,geq,3",
+         [](const index_row& r) { return r.a >= 3; }},
+        // all eq, each key with its RID suffix
+        {";a,eq,0;b,eq,a",
+         [](const index_row& r) { return r.a == 0 and r.b == "a"; }},
+    };
+    for (auto& c : cases) {
+        std::set<uint64_t> expected;
+        for (auto& r : rows) {
+            if (c.match(r))
+                expected.insert(r.rid);
+        }
+        ASSERT_EQ(expected, index_lookup(omap, sc, c.preds)) << c.preds;
+    }
+}
+
+// in/not_in preds over the vals (given with dups) agree with a std::set on
+// all probes, through the sorted or else hashed value set
+template <typename T>
+static void check_value_set(int type, const std::vector<T>& vals,
+                            const std::vector<T>& probes)
+{
+    std::set<T> expected(vals.begin(), vals.end());
+    std::vector<T> dup_vals(vals);
+    dup_vals.insert(dup_vals.end(), vals.rbegin(), vals.rend());
+
+    TypedPredicate<T> in(0, type, SOT_in, dup_vals);
+    TypedPredicate<T> not_in(0, type, SOT_not_in, dup_vals);
+    const PredicateValueSet<T> vs(dup_vals);
+    ASSERT_EQ(expected.size(), vs.vals.size());
+    ASSERT_TRUE(std::equal(expected.begin(), expected.end(),
+                           vs.vals.begin()));
+    if (expected.size() <= PRED_VALUE_SET_SORTED_MAX) {
+        ASSERT_EQ(0, vs.shift);
+        ASSERT_TRUE(vs.slots.empty());
+    }
+    else {
+        ASSERT_NE(0, vs.shift);
+        ASSERT_GE(vs.slots.size(), 2 * expected.size());
+        ASSERT_EQ(vs.slots.size(), size_t(1) << (64 - vs.shift));
+    }
+    for (auto& v : vals) {
+        ASSERT_TRUE(in.probe(v)) << expected.size() << " " << v;
+        ASSERT_FALSE(not_in.probe(v)) << expected.size() << " " << v;
+    }
+    for (auto& v : probes) {
+        bool member = expected.count(v) > 0;
+        ASSERT_EQ(member, in.probe(v)) << expected.size() << " " << v;
+        ASSERT_EQ(!member, not_in.probe(v)) << expected.size() << " " << v;
+    }
+}
+
+template <typename T>
+static void check_between(int type, const T& lo, const T& hi,
+                          const std::vector<T>& probes)
+{
+    TypedPredicate<T> between(0, type, SOT_between, std::vector<T>({lo, hi}));
+    for (auto& v : probes)
+        ASSERT_EQ(lo <= v and v <= hi, between.probe(v)) << v;
+}
+
+TEST(ClsTabularUtils, pred_value_set)
+{
+    // lists below, at and above PRED_VALUE_SET_SORTED_MAX
+    for (size_t n : {size_t(1), size_t(2), size_t(7), PRED_VALUE_SET_SORTED_MAX,
+                     PRED_VALUE_SET_SORTED_MAX + 1, size_t(100),
+                     size_t(5000)}) {
+        std::vector<uint64_t> uvals, uprobes = {UINT64_MAX, 1ULL << 63};
+        std::vector<double> dvals, dprobes = {-INFINITY, INFINITY, -0.0, 0.0,
+                                              1e-300, -1e-300};
+        std::vector<std::string> svals, sprobes = {"", "k", std::string(1, 0),
+                                                   std::string("k0\0", 3)};
+        for (size_t i = 0; i < n; i++) {
+            // sequential and spread out vals, both hash to all slots
+            uvals.push_back(i % 2 ? i * 8 : (i * 0x9E3779B97F4A7C15ULL));
+            dvals.push_back((static_cast<double>(i) - n / 2.0) * 0.5);
+            svals.push_back("k" + std::to_string(i * 3));
+        }
+        uvals.back() = UINT64_MAX;
+        svals.back() = std::string("k\0", 2);
+        for (size_t i = 0; i < 8 * n + 16; i++) {
+            uprobes.push_back(i);
+            uprobes.push_back(i * 0x9E3779B97F4A7C15ULL);
+            dprobes.push_back((static_cast<double>(i) - 4.0 * n) * 0.25);
+            sprobes.push_back("k" + std::to_string(i));
+        }
+        check_value_set<uint64_t>(SDT_UINT64, uvals, uprobes);
+        check_value_set<double>(SDT_DOUBLE, dvals, dprobes);
+        check_value_set<std::string>(SDT_STRING, svals, sprobes);
+
+        // -0.0 and 0.0 are the same val
+        if (n == 1) {
+            TypedPredicate<double> in(0, SDT_DOUBLE, SOT_in,
+                                      std::vector<double>({-0.0}));
+            ASSERT_TRUE(in.probe(0.0));
+        }
+        else if (n == 100) {
+            ASSERT_TRUE(std::find(dvals.begin(), dvals.end(), 0.0) !=
+                        dvals.end());
+            TypedPredicate<double> in(0, SDT_DOUBLE, SOT_in, dvals);
+            ASSERT_TRUE(in.probe(-0.0));
+        }
+
+        check_between<uint64_t>(SDT_UINT64, 3, n * 4, uprobes);
+        check_between<double>(SDT_DOUBLE, -0.5 * n, 0.25 * n, dprobes);
+        check_between<std::string>(SDT_STRING, "k1", "k5", sprobes);
+    }
+
+    // lists parsed from the pred string, over the hashed set
+    schema_vec sc;
+    sc.push_back(col_info(0, SDT_UINT64, true, false, "ID"));
+    sc.push_back(col_info(1, SDT_DOUBLE, false, false, "X"));
+    sc.push_back(col_info(2, SDT_STRING, false, false, "S"));
+    std::string ids, xs, ss;
+    for (int i = 0; i < 64; i++) {
+        ids += (i ? "|" : "") + std::to_string(i * 3);
+        xs += (i ? "|-" : "-") + std::to_string(i) + ".5";
+        ss += (i ? "|" : "") + std::string("s") + std::to_string(i);
+    }
+    predicate_vec preds = predsFromString(sc, ";id,in," + ids + ";x,not_in," +
+                                              xs + ";s,in," + ss);
+    ASSERT_EQ(3u, preds.size());
+    auto pid = dynamic_cast<TypedPredicate<uint64_t>*>(preds[0]);
+    auto px = dynamic_cast<TypedPredicate<double>*>(preds[1]);
+    auto ps = dynamic_cast<TypedPredicate<std::string>*>(preds[2]);
+    ASSERT_TRUE(pid and px and ps);
+    for (int i = 0; i < 200; i++) {
+        ASSERT_EQ(i % 3 == 0 and i < 192, pid->probe(i)) << i;
+        ASSERT_EQ(i >= 64, px->probe(-i - 0.5)) << i;
+        ASSERT_EQ(i < 64, ps->probe("s" + std::to_string(i))) << i;
+    }
+    ASSERT_TRUE(px->probe(0.5));
+    ASSERT_FALSE(ps->probe("s"));
+    for (auto p : preds) delete p;
+}
@@ -0,0 +1,203 @@
+/*
+* Copyright (C) 2018 The Regents of the University of California
+* All Rights Reserved
+*
+* This library can redistribute it and/or modify under the terms
+* of the GNU Lesser General Public License Version 2.1 as published
+* by the Free Software Foundation.
+*
+*/
+
+/*
+ * Unit tests of the wasm udfs run by cls_tabular, with the sample module
+ * sky_udf_test.wat.  Only built with a wasm runtime, see WITH_WASMTIME.
+ */
+
+#include <fstream>
+#include <sstream>
+
+#include <wasmtime.h>
+
+#include "gtest/gtest.h"
+
+#include "cls/tabular/cls_tabular_utils.h"
+#include "cls/tabular/cls_tabular_wasm.h"
+#include "tabular_test_data.h"
+
+using namespace Tables;
+
+static const uint32_t WASM_TEST_ROWS = 3000;  // a few udf batches
+
+// the binary of the sample module
+static std::string sample_module()
+{
+    std::ifstream f(SKY_WASM_TEST_WAT);
+    EXPECT_TRUE(f.good());
+    std::stringstream ss;
+    ss << f.rdbuf();
+    std::string wat = ss.str();
+
+    wasm_byte_vec_t wasm;
+    wasmtime_error_t* error = wasmtime_wat2wasm(wat.data(), wat.size(), &wasm);
+    EXPECT_EQ(nullptr, error);
+    if (error) {
+        wasmtime_error_delete(error);
+        return "";
+    }
+    std::string binary(wasm.data, wasm.size);
+    wasm_byte_vec_delete(&wasm);
+    return binary;
+}
+
+// a flatbuf of WASM_TEST_ROWS rows with the single col N, N = RID = row num
+static void sample_rows(flatbuffers::FlatBufferBuilder& fbb,
+                        schema_vec& schema)
+{
+    schema.push_back(col_info(0, SDT_INT64, true, false, "N"));
+    csv_rows csv = {{"0"}};
+    build_flexrow_blob(fbb, schema, csv, 0, WASM_TEST_ROWS, "t", true);
+}
+
+static wasm_udf sample_udf(int type, const std::string& func)
+{
+    wasm_udf udf;
+    udf.type = type;
+    udf.module = sample_module();
+    udf.func = func;
+    udf.cols = "N";
+    return udf;
+}
+
+TEST(ClsTabularWasm, filter_and_map)
+{
+    flatbuffers::FlatBufferBuilder fbb;
+    schema_vec schema;
+    sample_rows(fbb, schema);
+    const char* data = reinterpret_cast<const char*>(fbb.GetBufferPointer());
+    std::string errmsg;
+
+    WasmUdf filter;
+    ASSERT_EQ(0, filter.init(sample_udf(SWU_FILTER, "over_10"), schema,
+                             errmsg)) << errmsg;
+    std::vector<uint32_t> rows;
+    ASSERT_EQ(0, filter.filterFlexRows(data, fbb.GetSize(), rows, errmsg))
+        << errmsg;
+    ASSERT_EQ(WASM_TEST_ROWS - 11, rows.size());
+    ASSERT_EQ(11u, rows.front());
+    ASSERT_EQ(WASM_TEST_ROWS - 1, rows.back());
+
+    // only the given rows are considered
+    rows = {3, 12, 2048, WASM_TEST_ROWS + 5};
+    ASSERT_EQ(0, filter.filterFlexRows(data, fbb.GetSize(), rows, errmsg))
+        << errmsg;
+    ASSERT_EQ(std::vector<uint32_t>({12, 2048}), rows);
+
+    WasmUdf map;
+    ASSERT_EQ(0, map.init(sample_udf(SWU_MAP, "twice"), schema, errmsg))
+        << errmsg;
+    std::vector<uint64_t> rids;
+    std::vector<double> vals;
+    ASSERT_EQ(0, map.mapFlexRows(data, fbb.GetSize(), rids, vals, errmsg))
+        << errmsg;
+    ASSERT_EQ(WASM_TEST_ROWS, rids.size());
+    ASSERT_EQ(WASM_TEST_ROWS, vals.size());
+    for (uint32_t i = 0; i < WASM_TEST_ROWS; i++) {
+        ASSERT_EQ(i, rids[i]);
+        ASSERT_EQ(2.0 * i, vals[i]);
+    }
+}
+
+TEST(ClsTabularWasm, fuel_limit)
+{
+    flatbuffers::FlatBufferBuilder fbb;
+    schema_vec schema;
+    sample_rows(fbb, schema);
+    const char* data = reinterpret_cast<const char*>(fbb.GetBufferPointer());
+    std::string errmsg;
+
+    WasmUdf udf;
+    wasm_udf spin = sample_udf(SWU_FILTER, "spin");
+    spin.fuel = 100000;
+    ASSERT_EQ(0, udf.init(spin, schema, errmsg)) << errmsg;
+    std::vector<uint32_t> rows;
+    ASSERT_EQ(TablesErrCodes::WasmUdfError,
+              udf.filterFlexRows(data, fbb.GetSize(), rows, errmsg));
+    ASSERT_TRUE(rows.empty());
+    ASSERT_NE(std::string::npos, errmsg.find("wasm udf call"));
+}
+
+TEST(ClsTabularWasm, memory_limit)
+{
+    flatbuffers::FlatBufferBuilder fbb;
+    schema_vec schema;
+    sample_rows(fbb, schema);
+    const char* data = reinterpret_cast<const char*>(fbb.GetBufferPointer());
+    std::string errmsg;
+
+    // grows 1MB per batch, within the default max memory
+    WasmUdf grow;
+    ASSERT_EQ(0, grow.init(sample_udf(SWU_FILTER, "grow_1mb"), schema,
+                           errmsg)) << errmsg;
+    std::vector<uint32_t> rows;
+    ASSERT_EQ(0, grow.filterFlexRows(data, fbb.GetSize(), rows, errmsg))
+        << errmsg;
+    ASSERT_EQ(WASM_TEST_ROWS, rows.size());
+
+    // the grow fails over the max memory, the module's 2 pages and a bit
+    WasmUdf small;
+    wasm_udf udf = sample_udf(SWU_FILTER, "grow_1mb");
+    udf.max_memory = 4 * 65536;
+    ASSERT_EQ(0, small.init(udf, schema, errmsg)) << errmsg;
+    rows.clear();
+    ASSERT_EQ(TablesErrCodes::WasmUdfError,
+              small.filterFlexRows(data, fbb.GetSize(), rows, errmsg));
+    ASSERT_NE(std::string::npos, errmsg.find("wasm udf returned 1"));
+
+    // the module's initial memory is over the max
+    WasmUdf tiny;
+    udf.max_memory = 65536;
+    errmsg.clear();
+    ASSERT_EQ(TablesErrCodes::WasmUdfError, tiny.init(udf, schema, errmsg));
+    ASSERT_NE(std::string::npos, errmsg.find("wasm module instantiate"));
+}
+
+TEST(ClsTabularWasm, module_cache)
+{
+    schema_vec schema;
+    schema.push_back(col_info(0, SDT_INT64, true, false, "N"));
+    std::string errmsg;
+
+    // the same binary is compiled once
+    size_t cached = wasmModuleCacheSize();
+    WasmUdf a, b;
+    ASSERT_EQ(0, a.init(sample_udf(SWU_FILTER, "over_10"), schema, errmsg))
+        << errmsg;
+    size_t cached_a = wasmModuleCacheSize();
+    ASSERT_LE(cached_a, cached + 1);
+    ASSERT_GE(cached_a, 1u);
+    ASSERT_EQ(0, b.init(sample_udf(SWU_MAP, "twice"), schema, errmsg))
+        << errmsg;
+    ASSERT_EQ(cached_a, wasmModuleCacheSize());
+
+    // a different binary is another entry, up to WASM_MODULE_CACHE_MAX
+    for (unsigned i = 0; i < WASM_MODULE_CACHE_MAX + 2; i++) {
+        wasm_udf udf = sample_udf(SWU_FILTER, "over_10");
+        // a custom section named i, which does not change the udf
+        std::string name = std::to_string(i);
+        udf.module.push_back(0);
+        udf.module.push_back(static_cast<char>(name.size() + 1));
+        udf.module.push_back(static_cast<char>(name.size()));
+        udf.module.append(name);
+        WasmUdf c;
+        ASSERT_EQ(0, c.init(udf, schema, errmsg)) << errmsg;
+    }
+    ASSERT_EQ(WASM_MODULE_CACHE_MAX, wasmModuleCacheSize());
+
+    // modules over the max size are not compiled
+    wasm_udf big = sample_udf(SWU_FILTER, "over_10");
+    big.module.resize(WASM_MODULE_MAX_BYTES + 1);
+    WasmUdf c;
+    errmsg.clear();
+    ASSERT_EQ(TablesErrCodes::WasmUdfError, c.init(big, schema, errmsg));
+    ASSERT_NE(std::string::npos, errmsg.find("over the max"));
+}
@@ -1272,6 +1272,17 @@ int cls_cxx_read2(cls_method_context_t hctx, int ofs, int len,
   return ctx->io_ctx_impl->read(ctx->oid, len, ofs, outbl);
 }
 
+int cls_cxx_replace(cls_method_context_t hctx, int ofs, int len,
+                    bufferlist *inbl) {
+  librados::TestClassHandler::MethodContext *ctx =
+    reinterpret_cast<librados::TestClassHandler::MethodContext*>(hctx);
+  int r = ctx->io_ctx_impl->truncate(ctx->oid, 0, ctx->snapc);
+  if (r < 0) {
+    return r;
+  }
+  return ctx->io_ctx_impl->write(ctx->oid, *inbl, len, ofs, ctx->snapc);
+}
+
 int cls_cxx_setxattr(cls_method_context_t hctx, const char *name,
                      bufferlist *inbl) {
   librados::TestClassHandler::MethodContext *ctx =
@@ -1279,6 +1290,13 @@ int cls_cxx_setxattr(cls_method_context_t hctx, const char *name,
   return ctx->io_ctx_impl->xattr_set(ctx->oid, name, *inbl);
 }
 
+int cls_get_oid(cls_method_context_t hctx, std::string *oid) {
+  librados::TestClassHandler::MethodContext *ctx =
+    reinterpret_cast<librados::TestClassHandler::MethodContext*>(hctx);
+  *oid = ctx->oid;
+  return 0;
+}
+
 int cls_cxx_stat(cls_method_context_t hctx, uint64_t *size, time_t *mtime) {
   librados::TestClassHandler::MethodContext *ctx =
     reinterpret_cast<librados::TestClassHandler::MethodContext*>(hctx);
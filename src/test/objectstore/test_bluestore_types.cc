@@ -952,6 +952,64 @@ TEST(Blob, split)
   }
 }
 
+TEST(BufferSpace, scan_resistant_read)
+{
+  BlueStore::Cache *cache = BlueStore::Cache::create(
+    g_ceph_context, "lru", NULL);
+  BlueStore::BufferSpace hot, scan;
+  bufferlist bl;
+  bl.append(std::string(0x1000, 'a'));
+
+  // a scan admitted at the cold end evicts its own buffers first
+  hot.did_read(cache, 0, bl);
+  for (unsigned i = 0; i < 4; ++i) {
+    scan.did_read(cache, i * 0x1000, bl, 0);
+  }
+  {
+    std::lock_guard<std::recursive_mutex> l(cache->lock);
+    cache->_trim(0, 0x2000);
+  }
+  BlueStore::ready_regions_t res;
+  interval_set<uint32_t> res_intervals;
+  hot.read(cache, 0, 0x1000, res, res_intervals);
+  ASSERT_EQ(0x1000u, res_intervals.size());
+  scan.read(cache, 0, 0x4000, res, res_intervals, false);
+  ASSERT_EQ(0x1000u, res_intervals.size());
+
+  hot.truncate(cache, 0);
+  scan.truncate(cache, 0);
+  delete cache;
+}
+
+TEST(BufferSpace, scan_resistant_read_2q)
+{
+  BlueStore::Cache *cache = BlueStore::Cache::create(
+    g_ceph_context, "2q", NULL);
+  BlueStore::BufferSpace hot, scan;
+  bufferlist bl;
+  bl.append(std::string(0x1000, 'a'));
+
+  // scan buffers go to the back of warm_in and are trimmed first
+  hot.did_read(cache, 0, bl);
+  for (unsigned i = 0; i < 4; ++i) {
+    scan.did_read(cache, i * 0x1000, bl, 0);
+  }
+  {
+    std::lock_guard<std::recursive_mutex> l(cache->lock);
+    cache->_trim(0, 0x2000);
+  }
+  BlueStore::ready_regions_t res;
+  interval_set<uint32_t> res_intervals;
+  hot.read(cache, 0, 0x1000, res, res_intervals);
+  ASSERT_EQ(0x1000u, res_intervals.size());
+  scan.read(cache, 0, 0x4000, res, res_intervals, false);
+  ASSERT_EQ(0x1000u, res_intervals.size());
+
+  hot.truncate(cache, 0);
+  scan.truncate(cache, 0);
+  delete cache;
+}
+
 TEST(Blob, legacy_decode)
 {
   BlueStore store(g_ceph_context, "", 4096);